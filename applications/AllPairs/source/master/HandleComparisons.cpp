@@ -4,6 +4,8 @@
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
 #include "HandleComparisons.hpp"
+#include <boost/bind.hpp>
+#include "../../../common/wire.hpp"
 
 /*********************************************************
  * HandleComparisons tries to group together the proper files*
@@ -20,11 +22,40 @@ namespace AllPairs {
        useGraph_(useGraph),
        assignments_(assignments),
        files_(files),
-       serverURL_(serverURL), log_(log) {
-      assignmentChunksVector::iterator end = assignments.end();
-      for(assignmentChunksVector::iterator it = assignments.begin(); it != end; ++it) {
-         unassigned_.push_back(it->getId());
+       serverURL_(serverURL), log_(log), generator_(NULL),
+       staging_(NULL), tracker_(NULL), planner_(NULL),
+       checkpoint_(NULL), lastCheckpoint_(0), done_(false) {
+      distances_.rebuild(networkGraph_);
+      finished_.resize(assignments.size());
+      assigned_.resize(assignments.size());
+      unassigned_.resize(assignments.size());
+      unassigned_.set();
+      holder_.resize(assignments.size());
+      try {
+         service_ = new saga::stream::server(serverURL_);
+      }
+      catch(saga::exception const& e) {
+         std::cerr << "saga::exception caught: " << e.what() << std::endl;
       }
+   }
+   // Lazy variant: the pair space stays inside the generator and
+   // chunks are built per tile as workers ask for them
+   HandleComparisons::HandleComparisons(Graph &networkGraph, bool useGraph,
+                                      TiledAssignmentGenerator &generator,
+                                      std::map<int, std::vector<saga::url> > &files,
+                                      saga::url serverURL, LogWriter *log)
+    :  networkGraph_(networkGraph),
+       useGraph_(useGraph),
+       files_(files),
+       serverURL_(serverURL), log_(log), generator_(&generator),
+       staging_(NULL), tracker_(NULL), planner_(NULL),
+       checkpoint_(NULL), lastCheckpoint_(0), done_(false) {
+      distances_.rebuild(networkGraph_);
+      finished_.resize(generator.tileCount());
+      assigned_.resize(generator.tileCount());
+      unassigned_.resize(generator.tileCount());
+      unassigned_.set();
+      holder_.resize(generator.tileCount());
       try {
          service_ = new saga::stream::server(serverURL_);
       }
@@ -36,56 +67,291 @@ namespace AllPairs {
    {
       service_->close();
       delete service_;
+      delete checkpoint_;
+   }
+   //Must be called before assignWork when staging should run
+   //pipelined with comparisons instead of as its own phase
+   void HandleComparisons::attachStaging(HandleStaging *staging,
+                                         StageTracker *tracker) {
+      staging_ = staging;
+      tracker_ = tracker;
+   }
+   //Must be called before assignWork; without staging the network
+   //is unmeasured and the plan is built right away on uniform
+   //distances, otherwise it waits for the last staging report
+   void HandleComparisons::attachPlanner(StagingPlanner *planner) {
+      planner_ = planner;
+      if(staging_ == NULL) {
+         buildPlan_();
+      }
+   }
+   /*********************************************************
+   * buildPlan_ hands every chunk's file list to the planner *
+   * and logs the resulting transfer schedule.  Caller holds *
+   * stateMutex_ (or no dispatcher is running yet).          *
+   * ******************************************************/
+   void HandleComparisons::buildPlan_() {
+      if(planner_ == NULL || planner_->planned()) {
+         return;
+      }
+      std::vector<std::vector<int> > chunkFiles(chunkCount_());
+      for(unsigned int id = 0; id < chunkFiles.size(); ++id) {
+         chunkFiles[id] = chunkByID_(id).getFiles();
+      }
+      planner_->plan(chunkFiles, distances_);
+      log_->write(planner_->summary(), LOGLEVEL_INFO);
+      const std::vector<StagedTransfer> &schedule = planner_->schedule();
+      for(std::vector<StagedTransfer>::const_iterator it = schedule.begin();
+          it != schedule.end(); ++it) {
+         std::string line("  stage file ");
+         line += boost::lexical_cast<std::string>(it->fileID);
+         line += ": " + it->from + " -> " + it->to;
+         line += " (" + boost::lexical_cast<std::string>(it->bytes) + " bytes)";
+         log_->write(line, LOGLEVEL_INFO);
+      }
+   }
+   /*********************************************************
+   * attachCheckpoint enables periodic state snapshots and, *
+   * given a resume file, replays it: every chunk recorded  *
+   * as finished is marked so before the first worker asks, *
+   * and the staged-file map and per-worker counters carry  *
+   * over so reuse-aware scheduling keeps its memory too.   *
+   * Must be called before assignWork.                      *
+   * ******************************************************/
+   void HandleComparisons::attachCheckpoint(const std::string &writePath,
+                                            const std::string &resumePath) {
+      checkpoint_ = new MasterCheckpoint(writePath);
+      if(resumePath.empty()) {
+         return;
+      }
+      MasterCheckpoint previous(resumePath);
+      if(!previous.load()) {
+         log_->write("Cannot read checkpoint " + resumePath
+                     + " - starting from scratch", LOGLEVEL_WARNING);
+         return;
+      }
+      if(previous.chunkCount != chunkCount_()) {
+         //The session's pair space changed; trusting the old
+         //bitmap would silently drop comparisons
+         log_->write("Checkpoint " + resumePath + " covers "
+                     + boost::lexical_cast<std::string>(previous.chunkCount)
+                     + " chunks but this session has "
+                     + boost::lexical_cast<std::string>(chunkCount_())
+                     + " - ignoring it", LOGLEVEL_WARNING);
+         return;
+      }
+      unsigned int skipped = 0;
+      for(unsigned int id = 0; id < previous.chunkCount; ++id) {
+         if(previous.isFinished(id)) {
+            finished_.set(id);
+            unassigned_.reset(id);
+            if(generator_ != NULL) {
+               generator_->markFinished(id);
+            }
+            skipped++;
+         }
+      }
+      workerFiles_ = previous.workerFiles;
+      completed_   = previous.completed;
+      log_->write("Resumed from " + resumePath + ": "
+                  + boost::lexical_cast<std::string>(skipped) + " of "
+                  + boost::lexical_cast<std::string>(chunkCount_())
+                  + " chunks already finished", LOGLEVEL_INFO);
    }
    /*********************************************************
-   * assignReduces is the only public function that tries  *
-   * to assign reduce files to idle workers                *
+   * assignWork is the only public function.  A listener   *
+   * thread accepts worker connections and a pool of       *
+   * dispatcher threads holds the conversations, so        *
+   * comparison assignment scales with the worker count    *
+   * instead of serializing on a single serve() call.      *
    * ******************************************************/
    void HandleComparisons::assignWork()
    {
-      while(finished_.size() < assignments_.size()) {
-         issueCommand_();  // Try to assign the chunk to someone
+      done_ = false;
+      boost::thread listener(boost::bind(&HandleComparisons::listen_, this));
+      boost::thread_group dispatchers;
+      for(int i = 0; i < NUM_DISPATCH_THREADS; i++) {
+         dispatchers.create_thread(boost::bind(&HandleComparisons::dispatch_, this));
+      }
+      dispatchers.join_all();
+      //Closing the service unblocks the listener from serve()
+      service_->close();
+      listener.join();
+      {
+         //One last snapshot so a --resume of a completed run is a no-op
+         boost::mutex::scoped_lock lock(stateMutex_);
+         lastCheckpoint_ = 0;
+         checkpointNow_();
       }
    }
 
    /*********************************************************
-   * issue_command takes the grouped files and tries to    *
-   * assign them to an idel worker.  If a worker is done,  *
-   * the results are recorded                              *
+   * listen_ blocks in serve() and hands every accepted    *
+   * connection to the dispatcher pool via waiting_.       *
    * ******************************************************/
-   void HandleComparisons::issueCommand_() {
-      bool assigned = false; //Describes status of current file
-      while(assigned == false) {
+   void HandleComparisons::listen_() {
+      while(!done_) {
          try {
             saga::stream::stream worker = service_->serve();
+            boost::mutex::scoped_lock lock(queueMutex_);
+            waiting_.push_back(worker);
+            queueNotEmpty_.notify_one();
+         }
+         catch(saga::exception const &e) {
+            //assignWork closes the service to shut us down;
+            //anything else deserves a log line
+            if(!done_) {
+               log_->write(std::string(e.what()), LOGLEVEL_ERROR);
+            }
+         }
+      }
+   }
+
+   /*********************************************************
+   * allFinished_ checks completion under the state lock.  *
+   * ******************************************************/
+   bool HandleComparisons::allFinished_() {
+      boost::mutex::scoped_lock lock(stateMutex_);
+      return finished_.count() >= chunkCount_();
+   }
+
+   /*********************************************************
+   * chunkCount_/chunkByID_ hide whether chunks come from   *
+   * the eager assignment vector or are materialized per    *
+   * tile by the generator.                                 *
+   * ******************************************************/
+   unsigned int HandleComparisons::chunkCount_() {
+      return generator_ != NULL ? generator_->tileCount() : assignments_.size();
+   }
+   AssignmentChunk HandleComparisons::chunkByID_(int id) {
+      return generator_ != NULL ? generator_->getChunk(id) : assignments_[id];
+   }
+
+   /*********************************************************
+   * chunkReady_ is true once every host holding one of the *
+   * chunk's input files has finished staging; readySubset_ *
+   * filters a candidate set down to ready chunks.  Without *
+   * a tracker everything counts as ready.                  *
+   * ******************************************************/
+   bool HandleComparisons::chunkReady_(int id) {
+      AssignmentChunk chunk(chunkByID_(id));
+      std::vector<int> chunkFiles = chunk.getFiles();
+      std::vector<int>::iterator end = chunkFiles.end();
+      for(std::vector<int>::iterator it = chunkFiles.begin(); it != end; ++it) {
+         std::string host(files_[*it][0].get_host());
+         if(!host.empty() && !tracker_->hostReady(host)) {
+            return false;
+         }
+      }
+      return true;
+   }
+   boost::dynamic_bitset<> HandleComparisons::readySubset_(const boost::dynamic_bitset<> &set) {
+      if(tracker_ == NULL || staging_ == NULL || staging_->finished()) {
+         return set;
+      }
+      boost::dynamic_bitset<> ready(set.size());
+      for(boost::dynamic_bitset<>::size_type id = set.find_first();
+          id != boost::dynamic_bitset<>::npos; id = set.find_next(id)) {
+         if(chunkReady_(id)) {
+            ready.set(id);
+         }
+      }
+      return ready;
+   }
+
+   /*********************************************************
+   * dispatch_ is the body of one pool thread: it pops     *
+   * connections off waiting_ and holds one conversation   *
+   * per connection until every chunk has finished.        *
+   * ******************************************************/
+   void HandleComparisons::dispatch_() {
+      while(!allFinished_()) {
+         saga::stream::stream worker;
+         {
+            boost::mutex::scoped_lock lock(queueMutex_);
+            while(waiting_.empty()) {
+               if(allFinished_()) {
+                  queueNotEmpty_.notify_all();
+                  return;
+               }
+               boost::xtime xt;
+               boost::xtime_get(&xt, boost::TIME_UTC);
+               xt.sec += 1;
+               queueNotEmpty_.timed_wait(lock, xt);
+            }
+            worker = waiting_.front();
+            waiting_.pop_front();
+         }
+         serveWorker_(worker);
+      }
+      done_ = true;
+      queueNotEmpty_.notify_all();
+   }
+
+   /*********************************************************
+   * serveWorker_ holds one conversation: idle workers get *
+   * the closest available assignment chunk, finished ones *
+   * have their results recorded.  The chunk sets are only *
+   * touched under stateMutex_; the wire I/O is not, so    *
+   * conversations overlap.                                *
+   * ******************************************************/
+   void HandleComparisons::serveWorker_(saga::stream::stream worker) {
+         try {
             std::string message("Established connection!");
             log_->write(message, LOGLEVEL_INFO);
 
             //Ask worker for state
-            worker.write(saga::buffer(MASTER_QUESTION_STATE, 6));
-            std::string read(network::read(worker));
+            wire::receiver rx;
+            wire::send(worker, MSG_QUESTION_STATE);
+            wire::expect(worker, rx, MSG_STATE);
+            std::string read(rx.part());
             message.clear();
             log_->write(message, LOGLEVEL_INFO);
 
-            if(network::test(read, WORKER_STATE_IDLE)) {
-               if(finished_.size() == assignments_.size()) {
+            if(read == WORKER_STATE_IDLE) {
+               if(allFinished_()) {
                   //Prevent unneccessary work assignments
                   //std::cout << "all assigned already, don't dish out, we only want done ones" << std::endl;
-                  worker.write(saga::buffer(MASTER_REQUEST_IDLE, 5));
-                  network::expect(WORKER_RESPONSE_ACKNOLEDGE, network::read(worker));
+                  wire::send(worker, MSG_REQUEST_IDLE);
+                  wire::expect(worker, rx, MSG_ACKNOLEDGE);
                   return;
                }
                //Ask worker for location, then try to assign closest available assignment chunk
-               worker.write(saga::buffer(MASTER_QUESTION_LOCATION, 9));
-               read = network::read(worker);
+               wire::send(worker, MSG_QUESTION_LOCATION);
+               wire::expect(worker, rx, MSG_LOCATION);
+               read = rx.part();
                
                message.clear();
                message = "Worker: " + read + " has state " + WORKER_STATE_IDLE;
                log_->write(message, LOGLEVEL_INFO);
                
                //std::cout << "Just got location from worker as :" << read << std::endl;
-               
-               AssignmentChunk chunk(getChunk_(read));
+
+               if(staging_ != NULL && !staging_->finished()
+                  && !tracker_->hostReady(read)) {
+                  //Stage this host before it compares anything
+                  staging_->beginStaging(worker, read);
+                  return;
+               }
+               {
+                  //Nothing staged yet that we could hand out;
+                  //park the worker and let transfers catch up
+                  boost::mutex::scoped_lock lock(stateMutex_);
+                  if(staging_ != NULL && !staging_->finished()
+                     && readySubset_(unassigned_).none()
+                     && readySubset_(assigned_).none()) {
+                     wire::send(worker, MSG_REQUEST_IDLE);
+                     wire::expect(worker, rx, MSG_ACKNOLEDGE);
+                     return;
+                  }
+               }
+
+               AssignmentChunk chunk;
+               {
+                  //getChunk_ walks the shared chunk sets
+                  boost::mutex::scoped_lock lock(stateMutex_);
+                  chunk = getChunk_(read);
+               }
                int currentChunkID = chunk.getId();
                //Worker is idle
                message.clear();
@@ -97,28 +363,21 @@ namespace AllPairs {
                log_->write(message, LOGLEVEL_INFO); 
                
                //Ask where their advert is
-               worker.write(saga::buffer(MASTER_QUESTION_ADVERT, 7));
-               saga::url advert(network::read(worker));
-               
+               wire::send(worker, MSG_QUESTION_ADVERT);
+               wire::expect(worker, rx, MSG_ADVERT);
+               saga::url advert(rx.part());
+
                message.clear();
                message += worker.get_url().get_string();
                message += " <==> " + advert.get_string();
                message += " ... ";
-               log_->write(message, LOGLEVEL_INFO); 
-               
-               //Tell worker about data
-               worker.write(saga::buffer(WORKER_COMMAND_COMPARE, 7));
-               network::expect(network::read(worker), WORKER_RESPONSE_ACKNOLEDGE);
-               //Write chunk to worker
-               worker.write(saga::buffer(START_CHUNK, 5));
-               
-               network::expect(network::read(worker), WORKER_RESPONSE_ACKNOLEDGE);
-               
-               //Give the id first
-               std::string stringID = boost::lexical_cast<std::string>(currentChunkID);
-               worker.write(saga::buffer(stringID, stringID.size()));
-               network::expect(network::read(worker), WORKER_RESPONSE_ACKNOLEDGE);
-               std::cerr << "about to start!" << std::endl;
+               log_->write(message, LOGLEVEL_INFO);
+
+               //The whole chunk - id plus every to/from pair - goes
+               //out as the parts of one frame with one write and one
+               //ack, instead of a write-plus-ack round trip per url
+               wire::message assign(MSG_ASSIGN_COMPARE);
+               assign.add(boost::lexical_cast<std::string>(currentChunkID));
                std::vector<Assignment>::iterator it  = chunk.getBegin();
                std::vector<Assignment>::iterator end = chunk.getEnd();
                while(it != end) {
@@ -133,78 +392,156 @@ namespace AllPairs {
                       to   = files_[it->getTo()][0].get_string();
                       from = files_[it->getFrom()][0].get_string();
                   }
-                  worker.write(saga::buffer(to, to.size()));
-                  network::expect(network::read(worker), WORKER_RESPONSE_ACKNOLEDGE);
-                  worker.write(saga::buffer(from, from.size()));
-                  network::expect(network::read(worker), WORKER_RESPONSE_ACKNOLEDGE);
+                  assign.add(to);
+                  assign.add(from);
                   ++it;
-                  std::cerr << "just gave: (" << to << ", " << from << ")" << std::endl;
                }
-               std::cerr << "done" << std::endl;
-               worker.write(saga::buffer(END_CHUNK, 3));
-               network::expect(network::read(worker), WORKER_RESPONSE_ACKNOLEDGE);
+               assign.send(worker);
+               wire::expect(worker, rx, MSG_ACKNOLEDGE);
                
                std::string message("Success: ");
                message += advert.get_string() + " is comparing chunk ";
                message += boost::lexical_cast<std::string>(currentChunkID);
                log_->write(message, LOGLEVEL_INFO);
-               //If not in assigned, add it
-               if(std::find(assigned_.begin(), assigned_.end(), currentChunkID) == assigned_.end()) {
-                  assigned_.push_back(currentChunkID);
-               }
-               
-               //If from unassigned, remove it
-               std::vector<int>::iterator pos = std::find(unassigned_.begin(), unassigned_.end(), currentChunkID);
-               if(pos != unassigned_.end()) {
-                  unassigned_.erase(pos);
+               boost::mutex::scoped_lock lock(stateMutex_);
+               //Remember which input files this worker now holds so
+               //later chunks can be picked for reuse
+               std::vector<int> chunkFiles = chunk.getFiles();
+               workerFiles_[read].insert(chunkFiles.begin(), chunkFiles.end());
+               if(assigned_.test(currentChunkID)) {
+                  //Chunk re-issued; the previous holder is no
+                  //longer on the hook for it
+                  decrementOutstanding_(holder_[currentChunkID]);
                }
-               assigned = true;
+               assigned_.set(currentChunkID);
+               unassigned_.reset(currentChunkID);
+               holder_[currentChunkID] = read;
+               outstanding_[read]++;
                return;
             }
-            else if(network::test(read, WORKER_STATE_DONE)) {
+            else if(read == WORKER_STATE_DONE) {
                message.clear();
                message = "Worker has state " + std::string(WORKER_STATE_DONE);
                log_->write(message, LOGLEVEL_INFO);
-               
-               worker.write(saga::buffer(MASTER_QUESTION_RESULT, 7));
-               std::string result(network::read(worker));
-               worker.write(saga::buffer(MASTER_REQUEST_IDLE, 5));
+
+               wire::send(worker, MSG_QUESTION_RESULT);
+               wire::expect(worker, rx, MSG_RESULT);
+               std::string result(rx.part());
+               wire::send(worker, MSG_REQUEST_IDLE);
                
                std::string message("Worker finished chunk ");
                message += result;
                log_->write(message, LOGLEVEL_INFO);
                int resultInt = boost::lexical_cast<int>(result);
-               
-               //If in assigned, remove it
-               std::vector<int>::iterator pos = std::find(assigned_.begin(), assigned_.end(), resultInt);
-               if(pos != assigned_.end()) {
-                  assigned_.erase(pos);
+
+               boost::mutex::scoped_lock lock(stateMutex_);
+               if(assigned_.test(resultInt)) {
+                  assigned_.reset(resultInt);
+                  decrementOutstanding_(holder_[resultInt]);
                }
-               
-               //Make sure not already inserted into finished list
-               if(std::find(finished_.begin(), finished_.end(), resultInt) == finished_.end()) {
-                  finished_.push_back(resultInt);
+               if(!finished_.test(resultInt)) {
+                  finished_.set(resultInt);
+                  if(generator_ != NULL) {
+                     generator_->markFinished(resultInt);
+                  }
+                  if(!holder_[resultInt].empty()) {
+                     completed_[holder_[resultInt]]++;
+                  }
                }
+               checkpointNow_();
             }
-            else if(network::test(read, WORKER_STATE_DONE_STAGING))
+            else if(read == WORKER_STATE_DONE_STAGING)
 	    {
-               worker.write(saga::buffer(MASTER_REQUEST_IDLE, 5));
-               network::expect(WORKER_RESPONSE_ACKNOLEDGE, network::read(worker));
+               if(staging_ != NULL) {
+                  //Collect the staging results in-line so the host
+                  //becomes available to the chunk scheduler
+                  wire::send(worker, MSG_QUESTION_LOCATION);
+                  wire::expect(worker, rx, MSG_LOCATION);
+                  std::string location(rx.part());
+                  staging_->gatherResults(worker, location);
+                  //Topology changed: refresh the distance matrix
+                  boost::mutex::scoped_lock lock(stateMutex_);
+                  networkGraph_ = staging_->getNetwork();
+                  distances_.rebuild(networkGraph_);
+                  if(staging_->finished()) {
+                     //The network is fully measured: place the
+                     //remaining tiles jointly with their bases
+                     buildPlan_();
+                  }
+                  return;
+               }
+               wire::send(worker, MSG_REQUEST_IDLE);
+               wire::expect(worker, rx, MSG_ACKNOLEDGE);
 	    }
          }
+         catch(wire::error const & e) {
+            //out-of-sync stream: drop the connection, the worker
+            //reconnects for its next conversation
+            log_->write(std::string(e.what()), LOGLEVEL_ERROR);
+         }
          catch(saga::exception const & e) {
             std::string message(e.what());
             log_->write(message, LOGLEVEL_ERROR);
          }
+   }
+   /*********************************************************
+   * checkpointNow_ snapshots the assignment bitmap, the    *
+   * staged-file map and the per-worker counters if the     *
+   * checkpoint interval has passed.  Caller must hold      *
+   * stateMutex_; the atomic temp-file rename in save()     *
+   * keeps the previous snapshot intact on failure.         *
+   * ******************************************************/
+   void HandleComparisons::checkpointNow_() {
+      if(checkpoint_ == NULL) {
+         return;
+      }
+      time_t now = time(NULL);
+      if(now - lastCheckpoint_ < CHECKPOINT_INTERVAL) {
+         return;
+      }
+      checkpoint_->resize(chunkCount_());
+      for(boost::dynamic_bitset<>::size_type id = finished_.find_first();
+          id != boost::dynamic_bitset<>::npos; id = finished_.find_next(id)) {
+         checkpoint_->setFinished(id);
+      }
+      checkpoint_->workerFiles = workerFiles_;
+      checkpoint_->completed   = completed_;
+      if(!checkpoint_->save()) {
+         log_->write("Cannot write checkpoint " + checkpoint_->path(),
+                     LOGLEVEL_WARNING);
+      }
+      lastCheckpoint_ = now;
+   }
+   //Caller must hold stateMutex_
+   void HandleComparisons::decrementOutstanding_(const std::string &hostname) {
+      std::map<std::string, int>::iterator it = outstanding_.find(hostname);
+      if(it != outstanding_.end() && it->second > 0) {
+         it->second--;
       }
    }
+   //Caller must hold stateMutex_
    AssignmentChunk HandleComparisons::getChunk_(const std::string &hostname) {
       //std::cout << "worker hostname: " << hostname << std::endl;
-      if(unassigned_.size() > 0) {
+      //While staging is still running only chunks whose input
+      //hosts are ready may go out
+      boost::dynamic_bitset<> unassigned = readySubset_(unassigned_);
+      boost::dynamic_bitset<> assigned   = readySubset_(assigned_);
+      if(unassigned.any()) {
          std::cout << "unassigned..." << std::endl;
          AssignmentChunk ac;
          bool found = false;
-         boost::tie(ac, found) = AssignmentChunkCheck_(unassigned_, hostname);
+         //The staging plan placed this worker's tiles with their
+         //bases; serve those before falling back to heuristics
+         boost::tie(ac, found) = plannedCheck_(unassigned, hostname);
+         if(found == true) {
+            return ac;
+         }
+         //Prefer a chunk reusing files the worker already staged
+         boost::tie(ac, found) = reuseCheck_(unassigned, hostname);
+         if(found == true) {
+            return ac;
+         }
+         boost::tie(ac, found) = AssignmentChunkCheck_(unassigned, hostname);
          if(found == true) {
             std::cerr << "return from looking at locations of assignmentChunks..." << std::endl;
             return ac;
@@ -212,35 +549,116 @@ namespace AllPairs {
          else {
             std::cerr << "Couldn't Find an exact location, just give any assignment out" << std::endl;
             std::cerr << "returned first one" << std::endl;
-            return assignments_[unassigned_[0]];
+            return chunkByID_(unassigned.find_first());
          }
-      } else if(assigned_.size() > 0) {
+      } else if(assigned.any()) {
          //No more unassigned ones
          //Try to use locality information from graph
          AssignmentChunk ac;
          bool found = false;
-         boost::tie(ac, found) = AssignmentChunkCheck_(assigned_, hostname);
+         boost::tie(ac, found) = reuseCheck_(assigned, hostname);
+         if(found == true) {
+            return ac;
+         }
+         boost::tie(ac, found) = AssignmentChunkCheck_(assigned, hostname);
          if(found == true) {
             return ac;
          }
          else {
-            //Random so not to give out same assigned one every time
-            return assignments_[assigned_[rand() % assigned_.size()]];
+            //Duplicate a chunk of the most loaded holder, which
+            //is the likeliest straggler
+            boost::dynamic_bitset<>::size_type pick = assigned.find_first();
+            int most = -1;
+            for(boost::dynamic_bitset<>::size_type id = assigned.find_first();
+                id != boost::dynamic_bitset<>::npos; id = assigned.find_next(id)) {
+               std::map<std::string, int>::iterator load = outstanding_.find(holder_[id]);
+               int count = load == outstanding_.end() ? 0 : load->second;
+               if(count > most) {
+                  most = count;
+                  pick = id;
+               }
+            }
+            return chunkByID_(pick);
          }
-      } else if(finished_.size() > 0) {
+      } else if(finished_.any()) {
          //No more assigned or unassigned assignments
          //No one should be asking!
          std::cerr << "Asking for assignments when only finished ones exists" << std::endl;
          //Give random
-         return assignments_[finished_[rand() % finished_.size()]];
+         boost::dynamic_bitset<>::size_type skip = rand() % finished_.count();
+         boost::dynamic_bitset<>::size_type id = finished_.find_first();
+         while(skip-- > 0) {
+            id = finished_.find_next(id);
+         }
+         return chunkByID_(id);
       } else {
          std::cerr << "Stop asking for chunks!" << std::endl;
          APPLICATION_ABORT;
       }
    }
 
+   /*********************************************************
+   * plannedCheck_ serves the first chunk of set that the   *
+   * staging plan assigned to this host, so execution       *
+   * follows the min-bytes-moved placement.  Caller must    *
+   * hold stateMutex_.                                      *
+   * ******************************************************/
+   std::pair<AssignmentChunk, bool> HandleComparisons::plannedCheck_(
+      const boost::dynamic_bitset<> &set,
+      const std::string &hostname) {
+      if(planner_ == NULL || !planner_->planned()) {
+         return std::pair<AssignmentChunk, bool>(AssignmentChunk(), false);
+      }
+      for(boost::dynamic_bitset<>::size_type id = set.find_first();
+          id != boost::dynamic_bitset<>::npos; id = set.find_next(id)) {
+         if(planner_->hostForChunk(id) == hostname) {
+            return std::pair<AssignmentChunk, bool>(chunkByID_(id), true);
+         }
+      }
+      return std::pair<AssignmentChunk, bool>(AssignmentChunk(), false);
+   }
+
+   /*********************************************************
+   * reuseCheck_ picks the chunk from set whose input files *
+   * overlap most with what the worker already staged, so   *
+   * repeat assignments avoid re-staging bases.  Caller     *
+   * must hold stateMutex_.                                 *
+   * ******************************************************/
+   std::pair<AssignmentChunk, bool> HandleComparisons::reuseCheck_(
+      const boost::dynamic_bitset<> &set,
+      const std::string &hostname) {
+      std::map<std::string, std::set<int> >::iterator held = workerFiles_.find(hostname);
+      if(held == workerFiles_.end() || held->second.empty()) {
+         //Worker holds nothing yet; nothing to reuse
+         return std::pair<AssignmentChunk, bool>(AssignmentChunk(), false);
+      }
+      unsigned int bestOverlap = 0;
+      AssignmentChunk bestChunk;
+      for(boost::dynamic_bitset<>::size_type id = set.find_first();
+          id != boost::dynamic_bitset<>::npos; id = set.find_next(id)) {
+         AssignmentChunk candidate(chunkByID_(id));
+         std::vector<int> candidateFiles = candidate.getFiles();
+         unsigned int overlap = 0;
+         std::vector<int>::iterator fileEnd = candidateFiles.end();
+         for(std::vector<int>::iterator fileIt = candidateFiles.begin();
+             fileIt != fileEnd; ++fileIt) {
+            if(held->second.find(*fileIt) != held->second.end()) {
+               overlap++;
+            }
+         }
+         if(overlap > bestOverlap) {
+            bestOverlap = overlap;
+            bestChunk = candidate;
+         }
+      }
+      if(bestOverlap == 0) {
+         return std::pair<AssignmentChunk, bool>(AssignmentChunk(), false);
+      }
+      return std::pair<AssignmentChunk, bool>(bestChunk, true);
+   }
+
    std::pair<AssignmentChunk, bool> HandleComparisons::AssignmentChunkCheck_(
-      const std::vector<int> &set,
+      const boost::dynamic_bitset<> &set,
       const std::string &hostname) {
       AssignmentChunk result;
 
@@ -250,31 +668,26 @@ namespace AllPairs {
          std::cout << "entering false check" << std::endl;
          return std::pair<AssignmentChunk, bool>(result, false);
       }
-      std::vector<int>::const_iterator end = set.end();
       double minimum = -1;
       AssignmentChunk minimumAssignmentChunk;
-      for(std::vector<int>::const_iterator it  = set.begin(); it != end; ++it) {
-         std::vector<Assignment>::iterator AEnd = assignments_[*it].getEnd();
+      for(boost::dynamic_bitset<>::size_type id = set.find_first();
+          id != boost::dynamic_bitset<>::npos; id = set.find_next(id)) {
+         AssignmentChunk candidate(chunkByID_(id));
+         std::vector<Assignment>::iterator AEnd = candidate.getEnd();
          double chunkWeight = 0;
 
-         for(std::vector<Assignment>::iterator AIt  = assignments_[*it].getBegin();
+         for(std::vector<Assignment>::iterator AIt  = candidate.getBegin();
             AIt != AEnd; ++AIt) {
-            //Look through all known replicas, and find minimum dependency in graph
+            //Look through all known replicas, and find minimum dependency
+            //via the precomputed distance matrix
             saga::url from = files_[AIt->getFrom()][0];
-            saga::url to   = files_[AIt->getTo()][0];
-            boost::graph_traits<Graph>::edge_iterator EIt, EBegin, Eend;
-            boost::tie(EBegin, Eend) = boost::edges(networkGraph_);
-            for(EIt = EBegin; EIt != Eend; ++EIt) {
-               std::string sourceVertex(networkGraph_[boost::source(*EIt, networkGraph_)].name);
-               std::string targetVertex(networkGraph_[boost::target(*EIt, networkGraph_)].name);
-               if(sourceVertex == from.get_host() && targetVertex == hostname) {
-                  double weight = networkGraph_[*EIt].weight;
-                  chunkWeight += weight;
-               }
+            double weight = distances_.distance(from.get_host(), hostname);
+            if(weight >= 0) {
+               chunkWeight += weight;
             }
          }
          if(chunkWeight < minimum || minimum == -1) {
-            minimumAssignmentChunk = assignments_[*it];
+            minimumAssignmentChunk = candidate;
             minimum = chunkWeight;
          }
       }
@@ -8,13 +8,24 @@
 
 #include <string>
 #include <vector>
+#include <deque>
+#include <map>
+#include <set>
 #include <saga/saga.hpp>
+#include <boost/dynamic_bitset.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
 #include "../utils/LogWriter.hpp"
-#include "../utils/network.hpp"
 #include "../utils/Graph.hpp"
 #include "../utils/defines.hpp"
 #include "Assignment.hpp"
+#include "TiledAssignments.hpp"
+#include "HandleStaging.hpp"
+#include "StageTracker.hpp"
+#include "StagingPlanner.hpp"
+#include "MasterCheckpoint.hpp"
 
 namespace AllPairs {
    class HandleComparisons {
@@ -23,25 +34,96 @@ namespace AllPairs {
                         assignmentChunksVector &assignments,
                         std::map<int, std::vector<saga::url> > &files,
                         const saga::url serverURL_, LogWriter *log);
+      //Lazy variant: chunks are materialized per tile on demand
+      //instead of held in an eager assignment vector
+      HandleComparisons(Graph &networkGraph, bool useGraph_,
+                        TiledAssignmentGenerator &generator,
+                        std::map<int, std::vector<saga::url> > &files,
+                        const saga::url serverURL_, LogWriter *log);
       ~HandleComparisons();
+      //Pipelined mode: staging conversations are handled by our
+      //dispatchers and chunk selection is gated on host readiness
+      void attachStaging(HandleStaging *staging, StageTracker *tracker);
+      //Crash insurance: snapshots of the assignment state go to
+      //writePath periodically; a non-empty resumePath is loaded
+      //first and every chunk it records as finished is skipped
+      void attachCheckpoint(const std::string &writePath,
+                            const std::string &resumePath);
+      //Joint placement: once staging has measured the network the
+      //planner decides where each tile's bases should live, and
+      //chunk selection serves each worker its planned tiles first
+      void attachPlanner(StagingPlanner *planner);
       void assignWork();
      private:
-      void                             issueCommand_();
+      void                             listen_();
+      void                             dispatch_();
+      void                             serveWorker_(saga::stream::stream worker);
+      bool                             allFinished_();
+      unsigned int                     chunkCount_();
+      AssignmentChunk                  chunkByID_(int id);
+      bool                             chunkReady_(int id);
+      boost::dynamic_bitset<>          readySubset_(const boost::dynamic_bitset<> &set);
       AssignmentChunk                  getChunk_(const std::string &location);
-      std::pair<AssignmentChunk, bool> AssignmentChunkCheck_(const std::vector<int> &set,
+      void                             decrementOutstanding_(const std::string &hostname);
+      std::pair<AssignmentChunk, bool> plannedCheck_(const boost::dynamic_bitset<> &set,
+                                                     const std::string &hostname);
+      std::pair<AssignmentChunk, bool> reuseCheck_(const boost::dynamic_bitset<> &set,
+                                                   const std::string &hostname);
+      void                             buildPlan_();
+      std::pair<AssignmentChunk, bool> AssignmentChunkCheck_(const boost::dynamic_bitset<> &set,
                                                              const std::string &hostname);
-    
-      std::vector<int> finished_;
-      std::vector<int> assigned_;
-      std::vector<int> unassigned_;
+      void                             checkpointNow_();
+
+      //Chunk ids are dense, so finished/assigned/unassigned
+      //membership is one bit per chunk: updates are O(1) and
+      //scans walk set bits a word at a time instead of the
+      //linear std::find passes the int vectors needed.  Shared
+      //between the dispatcher threads and only touched under
+      //stateMutex_
+      boost::dynamic_bitset<> finished_;
+      boost::dynamic_bitset<> assigned_;
+      boost::dynamic_bitset<> unassigned_;
+      //How many handed-out chunks each worker has not finished
+      //yet, and which worker last received each chunk (guarded
+      //by stateMutex_)
+      std::map<std::string, int> outstanding_;
+      std::vector<std::string>   holder_;
+      //How many chunks each worker completed in total; survives
+      //restarts via the checkpoint (guarded by stateMutex_)
+      std::map<std::string, int> completed_;
+      //Non-NULL once attachCheckpoint enabled snapshots
+      MasterCheckpoint *checkpoint_;
+      time_t            lastCheckpoint_;
       Graph            networkGraph_;
+      //Flat O(1) lookup over networkGraph_; rebuilt when staging
+      //reports new measurements
+      DistanceMatrix   distances_;
       bool             useGraph_;
       assignmentChunksVector   assignments_;
+      //Non-NULL when running in lazy tiled mode
+      TiledAssignmentGenerator *generator_;
+      //Non-NULL when staging runs pipelined with comparisons
+      HandleStaging *staging_;
+      StageTracker  *tracker_;
+      //Non-NULL once attachPlanner enabled joint placement; the
+      //plan itself is built when staging completes
+      StagingPlanner *planner_;
       std::map<int, std::vector<saga::url> > files_;
+      //Input file ids each worker has staged so far, keyed by
+      //hostname (guarded by stateMutex_)
+      std::map<std::string, std::set<int> > workerFiles_;
       saga::stream::server    *service_;
       saga::advert::directory  workerDir_;
       saga::url serverURL_;
       LogWriter *log_;
+
+      //The listener thread queues accepted connections here for
+      //the dispatcher pool (guarded by queueMutex_)
+      std::deque<saga::stream::stream> waiting_;
+      boost::mutex     stateMutex_;
+      boost::mutex     queueMutex_;
+      boost::condition queueNotEmpty_;
+      bool             done_;
    };
 } //Namespace AllPairs
 
@@ -1,16 +1,18 @@
 //  Copyright (c) 2008 Michael Miceli and Christopher Miceli
-// 
-//  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
 #include "HandleStaging.hpp"
+#include "../../../common/wire.hpp"
 
 namespace AllPairs
 {
  HandleStaging::HandleStaging(const saga::url &serverURL,
                               const std::vector<std::string> &hosts,
                               LogWriter *log)
-    : serverURL_(serverURL), log_(log), hosts_(hosts)
+    : numWorkers_(hosts.size()), serverURL_(serverURL), log_(log),
+      service_(NULL), tracker_(NULL), hosts_(hosts)
  {
     for(std::vector<std::string>::iterator it = hosts_.begin(); it != hosts_.end(); ++it)
     {
@@ -23,10 +25,36 @@ namespace AllPairs
     }
  }
 
+ // Deferred mode: build the vertices only, the comparison
+ // dispatchers drive the conversations through beginStaging
+ // and gatherResults while comparisons are already running
+ HandleStaging::HandleStaging(const std::vector<std::string> &hosts,
+                              LogWriter *log, StageTracker *tracker)
+    : numWorkers_(hosts.size()), log_(log),
+      service_(NULL), tracker_(tracker), hosts_(hosts)
+ {
+    for(std::vector<std::string>::iterator it = hosts_.begin(); it != hosts_.end(); ++it)
+    {
+       Vertex v = boost::add_vertex(networkGraph_);
+       networkGraph_[v].name = *it;
+    }
+    if(hosts_.size() <= 1 && tracker_ != NULL)
+    {
+       //Nothing to measure, comparisons may use everything
+       tracker_->markAllReady();
+    }
+ }
+
  Graph HandleStaging::getNetwork(void) {
+    boost::mutex::scoped_lock lock(stageMutex_);
     return networkGraph_;
  }
 
+ bool HandleStaging::finished(void) {
+    boost::mutex::scoped_lock lock(stageMutex_);
+    return finishedHosts_.size() >= numWorkers_;
+ }
+
  HandleStaging::~HandleStaging()
  {
     std::cout << "before we close, what is our graph?" << std::endl;
@@ -49,106 +77,138 @@ namespace AllPairs
     }
  }
 
- void HandleStaging::assignStages_() 
+ /*********************************************************
+ * beginStaging sends one idle worker off to stage and    *
+ * measure against the host list.  The caller has already *
+ * asked for state and location.                          *
+ * ******************************************************/
+ void HandleStaging::beginStaging(saga::stream::stream &worker,
+                                  const std::string &location)
+ {
+    wire::receiver rx;
+    {
+       boost::mutex::scoped_lock lock(stageMutex_);
+       if(find(finishedHosts_.begin(), finishedHosts_.end(), location) != finishedHosts_.end()) {
+          //Got what we need, tell them to be idle
+          wire::send(worker, MSG_REQUEST_IDLE);
+          wire::expect(worker, rx, MSG_ACKNOLEDGE);
+          return;
+       }
+    }
+    std::string message("Begining staging for worker: ");
+    message += location;
+    log_->write(message, LOGLEVEL_INFO);
+    //Not yet finished finding information about this hosts; the
+    //whole host list travels as the parts of one frame
+    wire::message stage(MSG_ASSIGN_STAGE);
+    std::vector<std::string>::iterator it  = hosts_.begin();
+    std::vector<std::string>::iterator end = hosts_.end();
+    while(it != end) {
+       stage.add(*it);
+       ++it;
+    }
+    stage.send(worker);
+    wire::expect(worker, rx, MSG_ACKNOLEDGE);
+ }
+
+ /*********************************************************
+ * gatherResults records one worker's staging results in  *
+ * the network graph, marks its host finished and, when   *
+ * pipelined, posts readiness on the tracker so the       *
+ * comparison scheduler can start using the host's files. *
+ * ******************************************************/
+ void HandleStaging::gatherResults(saga::stream::stream &worker,
+                                   const std::string &location)
+ {
+    wire::receiver rx;
+    boost::mutex::scoped_lock lock(stageMutex_);
+    if(find(finishedHosts_.begin(), finishedHosts_.end(), location) != finishedHosts_.end()) {
+       //Got what we need already, tell them to be idle
+       wire::send(worker, MSG_REQUEST_IDLE);
+       wire::expect(worker, rx, MSG_ACKNOLEDGE);
+       return;
+    }
+    std::string message("Gathering results from staging with worker: ");
+    message += location;
+    log_->write(message, LOGLEVEL_INFO);
+    Vertex dest, source;
+    boost::graph_traits<Graph>::vertex_iterator vi, vbegin, vend;
+    //Find vertex of currently reporting worker
+    boost::tie(vbegin, vend) = boost::vertices(networkGraph_);
+    for(vi = vbegin; vi != vend; ++vi)
+    {
+       Vertex vertex = *vi;
+       if(networkGraph_[vertex].name == location) {
+          source = vertex;
+          break;
+       }
+    }
+    //One question, one answer: the worker reports the measurement
+    //for every host as the parts of a single frame
+    wire::send(worker, MSG_QUESTION_RESULT);
+    wire::expect(worker, rx, MSG_RESULT);
+    for(unsigned int i = 0; i < hosts_.size(); ++i)
+    {
+       std::string read(rx.part(i));
+       //Find vertex of currently in question host
+       boost::tie(vbegin, vend) = boost::vertices(networkGraph_);
+       if(hosts_[i] != location)
+       {
+          for(boost::graph_traits<Graph>::vertex_iterator vi = vbegin; vi != vend; ++vi)
+          {
+             Vertex vertex = *vi;
+             if(networkGraph_[vertex].name == hosts_[i]) {
+                dest = vertex;
+                break;
+             }
+          }
+          Edge edge;
+          boost::tie(edge, boost::tuples::ignore) = boost::add_edge(source, dest, networkGraph_);
+          networkGraph_[edge].weight = boost::lexical_cast<double>(read);
+       }
+    }
+    //Now finished, add to finished list
+    finishedHosts_.push_back(location);
+    if(tracker_ != NULL) {
+       tracker_->markHostReady(location);
+       if(finishedHosts_.size() >= numWorkers_) {
+          tracker_->markAllReady();
+       }
+    }
+    message = std::string("Gathered results from staging with worker: ");
+    message += location;
+    log_->write(message, LOGLEVEL_INFO);
+    wire::send(worker, MSG_REQUEST_IDLE);
+    wire::expect(worker, rx, MSG_ACKNOLEDGE);
+ }
+
+ void HandleStaging::assignStages_()
  {
     std::string read;
     try {
+       wire::receiver rx;
        service_ = new saga::stream::server(serverURL_);
-       while(finishedHosts_.size() < numWorkers_) {
+       while(finished() == false) {
           saga::stream::stream worker = service_->serve();
-          worker.write(saga::buffer(MASTER_QUESTION_STATE, 6));
-          read = network::read(worker);
-          if(network::test(read, WORKER_STATE_IDLE)) {
-             worker.write(saga::buffer(MASTER_QUESTION_LOCATION, 9));
-             read = network::read(worker);
-             if(find(finishedHosts_.begin(), finishedHosts_.end(), read) == finishedHosts_.end()) {
-                std::string message("Begining staging for worker: ");
-                message += read;
-                log_->write(message, LOGLEVEL_INFO);
-                //Not yet finished finding information about this hosts
-                worker.write(saga::buffer(WORKER_COMMAND_STAGE, 5));
-                network::expect(WORKER_RESPONSE_ACKNOLEDGE, network::read(worker));
-                worker.write(saga::buffer(START_CHUNK, 5));
-                network::expect(WORKER_RESPONSE_ACKNOLEDGE, network::read(worker));
-                std::vector<std::string>::iterator it  = hosts_.begin();
-                std::vector<std::string>::iterator end = hosts_.end();
-                while(it != end) {
-                   worker.write(saga::buffer(*it, it->size()));
-                   network::expect(WORKER_RESPONSE_ACKNOLEDGE, network::read(worker));
-                   ++it;
-                }
-                worker.write(saga::buffer(END_CHUNK, 3));
-                network::expect(WORKER_RESPONSE_ACKNOLEDGE, network::read(worker));
-             }
-             else {
-                //Got what we need, tell them to be idle
-                worker.write(saga::buffer(MASTER_REQUEST_IDLE, 5));
-                network::expect(WORKER_RESPONSE_ACKNOLEDGE, network::read(worker));
-             }
+          wire::send(worker, MSG_QUESTION_STATE);
+          wire::expect(worker, rx, MSG_STATE);
+          read = rx.part();
+          if(read == WORKER_STATE_IDLE) {
+             wire::send(worker, MSG_QUESTION_LOCATION);
+             wire::expect(worker, rx, MSG_LOCATION);
+             read = rx.part();
+             beginStaging(worker, read);
           }
-          else if(network::test(read, WORKER_STATE_DONE_STAGING)) {
-             worker.write(saga::buffer(MASTER_QUESTION_LOCATION, 9));
-             read = network::read(worker);
-             std::string location(read);
-             if(find(finishedHosts_.begin(), finishedHosts_.end(), read) == finishedHosts_.end()) {
-                std::string message("Gathering results from staging with worker: ");
-                message += location;
-                log_->write(message, LOGLEVEL_INFO);
-                Vertex dest, source;
-                boost::graph_traits<Graph>::vertex_iterator vi, vbegin, vend;
-                //Find vertex of currently reporting worker
-                boost::tie(vbegin, vend) = boost::vertices(networkGraph_);
-                for(vi = vbegin; vi != vend; ++vi)
-                {
-                   Vertex vertex = *vi;
-                   if(networkGraph_[vertex].name == location) {
-                      source = vertex;
-                      break;
-                   }
-                }
-                worker.write(saga::buffer(START_CHUNK, 5));
-                network::expect(WORKER_RESPONSE_ACKNOLEDGE, network::read(worker));
-                for(unsigned int i = 0; i < hosts_.size(); ++i)
-                {
-                   worker.write(saga::buffer(MASTER_QUESTION_RESULT, 7));
-                   read = network::read(worker);
-                   //Find vertex of currently in question host
-                   boost::tie(vbegin, vend) = boost::vertices(networkGraph_);
-                   if(hosts_[i] != location) 
-                   {
-                      for(boost::graph_traits<Graph>::vertex_iterator vi = vbegin; vi != vend; ++vi)
-                      {
-                         Vertex vertex = *vi;
-                         if(networkGraph_[vertex].name == hosts_[i]) {
-                            dest = vertex;
-                            break;
-                         }
-                      }
-                      Edge edge;
-                      boost::tie(edge, boost::tuples::ignore) = boost::add_edge(source, dest, networkGraph_);
-                      networkGraph_[edge].weight = boost::lexical_cast<double>(read);
-                   }
-                }
-                worker.write(saga::buffer(END_CHUNK, 3));
-                network::expect(WORKER_RESPONSE_ACKNOLEDGE, network::read(worker));
-                //Not yet finished, add to finished list
-                finishedHosts_.push_back(location);
-                message = std::string("Gathered results from staging with worker: ");
-                message += location;
-                log_->write(message, LOGLEVEL_INFO);
-                worker.write(saga::buffer(MASTER_REQUEST_IDLE, 5));
-                network::expect(WORKER_RESPONSE_ACKNOLEDGE, network::read(worker));
-             }
-             else {
-                //Got what we need already, tell them to be idle
-                worker.write(saga::buffer(MASTER_REQUEST_IDLE, 5));
-                network::expect(WORKER_RESPONSE_ACKNOLEDGE, network::read(worker));
-             }
+          else if(read == WORKER_STATE_DONE_STAGING) {
+             wire::send(worker, MSG_QUESTION_LOCATION);
+             wire::expect(worker, rx, MSG_LOCATION);
+             read = rx.part();
+             gatherResults(worker, read);
           }
        }
        delete service_;
     }
-    catch (const network::networkException &e) {
+    catch (const wire::error &e) {
        std::cerr << "Error: " << e.what() << std::endl;
        APPLICATION_ABORT;
     }
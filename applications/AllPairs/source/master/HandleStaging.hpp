@@ -10,11 +10,12 @@
 #include <vector>
 #include <saga/saga.hpp>
 #include <algorithm>
+#include <boost/thread/mutex.hpp>
 #include "../utils/LogWriter.hpp"
-#include "../utils/network.hpp"
 #include "../utils/Graph.hpp"
 #include "../utils/defines.hpp"
 #include "ConfigFileParser.hpp"
+#include "StageTracker.hpp"
 
 namespace AllPairs {
    class HandleStaging {
@@ -22,8 +23,18 @@ namespace AllPairs {
       HandleStaging(const saga::url &serverURL_,
                     const std::vector<std::string> &hosts,
                     LogWriter *log);
+      //Deferred mode for the pipelined master: no server is
+      //created, conversations are handed in by the comparison
+      //dispatchers and readiness is posted on the tracker
+      HandleStaging(const std::vector<std::string> &hosts,
+                    LogWriter *log, StageTracker *tracker);
       ~HandleStaging();
       Graph getNetwork(void);
+      void beginStaging(saga::stream::stream &worker,
+                        const std::string &location);
+      void gatherResults(saga::stream::stream &worker,
+                         const std::string &location);
+      bool finished(void);
      private:
       void assignStages_();
 
@@ -31,10 +42,14 @@ namespace AllPairs {
       saga::url                serverURL_;
       LogWriter               *log_;
       saga::stream::server    *service_;
+      StageTracker            *tracker_;
       std::vector<std::string> hosts_;
+      //finishedHosts_ and networkGraph_ are guarded by
+      //stageMutex_ once dispatchers hand conversations in
       std::vector<std::string> finishedHosts_;
       Graph                    networkGraph_;
-   };                                    
+      boost::mutex             stageMutex_;
+   };
 } //Namespace AllPairs
 
 #endif // AP_HANDLE_STAGING_HPP
@@ -6,9 +6,15 @@
 #ifndef MR_MASTER_HPP
 #define MR_MASTER_HPP
 
+#include <fstream>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include <saga/saga.hpp>
 #include "ConfigFileParser.hpp"
 #include "../utils/LogWriter.hpp"
+#include "../utils/ResultSegment.hpp"
 #include "../utils/defines.hpp"
 #include "version.hpp"
 #include "HandleComparisons.hpp"
@@ -43,6 +49,10 @@ namespace AllPairs {
             }
             std::string configFilePath (vm["config"].as<std::string>());
             staging_ = vm.count("staging") ? true : false;
+            resumePath_ = vm.count("resume") ? vm["resume"].as<std::string>() : std::string("");
+            benchmark_      = vm.count("benchmark") ? vm["benchmark"].as<int>() : 0;
+            benchSizeKB_    = vm.count("benchmark-size") ? vm["benchmark-size"].as<int>() : BENCH_FILE_SIZE_KB;
+            benchCompareMs_ = vm.count("benchmark-compare") ? vm["benchmark-compare"].as<int>() : BENCH_COMPARE_MS;
             AllPairs::LogWriter *initialLogger = new AllPairs::LogWriter(std::string(AP_MASTER_EXE_NAME), *(new saga::url("")));
             cfgFileParser_ = ConfigFileParser(configFilePath, *initialLogger);
             database_      = cfgFileParser_.getSessionDescription().orchestrator;
@@ -71,28 +81,52 @@ namespace AllPairs {
             // create a new session
             // create all necessary directories
             createNewSession_();
-            
+
             // add binaries to the Orchestrator DB
             // Take binaries from config file and
             // advertise them
             populateBinariesList_();
-            
-            // then advertise the chunk on the DB
-            populateFileList_();
+
+            // then advertise the chunk on the DB.  In benchmark mode
+            // the workload is synthetic: generated base files and an
+            // all-pairs assignment over them, with workers running the
+            // advertised busy-loop comparison instead of a real one
+            if(benchmark_ > 0)
+            {
+               sessionBaseDir_.set_attribute(ATTR_BENCH_COMPARE_MS,
+                  boost::lexical_cast<std::string>(benchCompareMs_));
+               populateBenchmarkFiles_();
+            }
+            else
+            {
+               populateFileList_();
+            }
 
             // Launch all worker command on all
             // host defined in config file
             spawnAgents_();
 
-            //Handle Staging
-            Graph network;
+            // Staging and comparisons run as a pipeline: comparison
+            // chunks whose input hosts have finished staging go out
+            // immediately while the remaining transfers proceed on
+            // the same dispatcher pool, with per-host readiness
+            // shared through a StageTracker
             if(staging_)
             {
-               network = runStaging_();
+               StageTracker tracker;
+               HandleStaging stage(collectHosts_(), log, &tracker);
+               runComparisons_(&stage, &tracker);
+               //The measured network is complete only now
+               stage.getNetwork();
+            }
+            else
+            {
+               runComparisons_(NULL, NULL);
             }
 
-            // Start comparing sources to targets 
-            runComparisons_(network);
+            // Merge the workers' result segments into the final
+            // similarity matrix file
+            aggregateResults_();
 
             //Tell all workers to quit
             sendQuit_();
@@ -104,6 +138,10 @@ namespace AllPairs {
          }
         private:
          bool        staging_;
+         std::string resumePath_;
+         int         benchmark_;      // synthetic base files to generate (0 = off)
+         int         benchSizeKB_;    // size of each synthetic file
+         int         benchCompareMs_; // advertised busy-loop cost per comparison
          time_t      startupTime_;
          std::string uuid_;
          std::string database_;
@@ -318,6 +356,76 @@ namespace AllPairs {
                APPLICATION_ABORT;
             }
          }
+         /*********************************************************
+          * populateBenchmarkFiles_ replaces populateFileList_ in *
+          * benchmark mode: it writes benchmark_ base files of    *
+          * benchSizeKB_ KB of pseudorandom data into a run-local *
+          * directory and builds a full all-pairs assignment over *
+          * them, BENCH_PAIRS_PER_CHUNK pairs per chunk.  The     *
+          * generated files flow through the same staging and     *
+          * caching paths as a real dataset.                      *
+          * ******************************************************/
+         void populateBenchmarkFiles_(void) {
+            std::string benchDir(uuid_ + "-bench");
+            ::mkdir(benchDir.c_str(), 0755);
+            char *cwdBuffer = ::getcwd(NULL, 0);
+            std::string base(std::string(cwdBuffer) + "/" + benchDir);
+            ::free(cwdBuffer);
+
+            std::string message("Generating " + boost::lexical_cast<std::string>(benchmark_)
+                                + " synthetic base files of "
+                                + boost::lexical_cast<std::string>(benchSizeKB_) + " KB...");
+            log->write(message, LOGLEVEL_INFO);
+
+            ::srand(42);  //deterministic content, runs stay comparable
+            std::vector<char> block(1024);
+            for(int f = 0; f < benchmark_; f++)
+            {
+               std::string path(base + "/base_" + boost::lexical_cast<std::string>(f) + ".dat");
+               std::ofstream out(path.c_str(), std::ios::binary);
+               for(int k = 0; k < benchSizeKB_; k++)
+               {
+                  for(unsigned int b = 0; b < block.size(); b++)
+                  {
+                     block[b] = static_cast<char>(::rand() & 0xff);
+                  }
+                  out.write(&block[0], block.size());
+               }
+               std::vector<saga::url> tempVector;
+               tempVector.push_back(saga::url("file://localhost/" + path));
+               Files_.insert(std::pair<int, std::vector<saga::url> >(f, tempVector));
+            }
+
+            // full all-pairs workload over the generated files
+            int assignmentChunkID = 0;
+            AssignmentChunk chunk(assignmentChunkID);
+            int pairsInChunk = 0;
+            long totalPairs = 0;
+            for(int from = 0; from < benchmark_; from++)
+            {
+               for(int to = 0; to < benchmark_; to++)
+               {
+                  chunk.push_back(Assignment(from, to));
+                  totalPairs++;
+                  if(++pairsInChunk == BENCH_PAIRS_PER_CHUNK)
+                  {
+                     assignments_.push_back(chunk);
+                     chunk = AssignmentChunk(++assignmentChunkID);
+                     pairsInChunk = 0;
+                  }
+               }
+            }
+            if(pairsInChunk > 0)
+            {
+               assignments_.push_back(chunk);
+            }
+
+            message  = "Benchmark workload: " + boost::lexical_cast<std::string>(totalPairs);
+            message += " comparisons in " + boost::lexical_cast<std::string>(assignments_.size());
+            message += " chunks";
+            log->write(message, LOGLEVEL_INFO);
+         }
+
          /*********************************************************
           * spawnAgents_ takes the host list and the binary list  *
           * from the config file and tries to match the proper    *
@@ -390,8 +498,12 @@ namespace AllPairs {
             }
          }
 
-         Graph runStaging_(void) {
-            log->write("Running Staging...", LOGLEVEL_INFO);
+         /*********************************************************
+          * collectHosts_ gathers every distinct host that either *
+          * runs a worker or holds an input file; these are the   *
+          * endpoints staging has to measure.                     *
+          * ******************************************************/
+         std::vector<std::string> collectHosts_(void) {
             std::vector<std::string> hosts;
             std::vector<HostDescription> hostList = cfgFileParser_.getTargetHostList();
             for(std::vector<HostDescription>::iterator hostIt = hostList.begin(); hostIt != hostList.end(); ++hostIt)
@@ -419,17 +531,111 @@ namespace AllPairs {
                std::cerr << "host: " << *it << std::endl;
                ++it;
             }
-            HandleStaging stage(serverURL_, hosts, log);
-            log->write("Success", LOGLEVEL_INFO);
-            return stage.getNetwork();
+            return hosts;
          }
 
-         void runComparisons_(Graph networkGraph) {
-            HandleComparisons comparisonHandler(networkGraph, staging_, assignments_, Files_, serverURL_, log);
+         void runComparisons_(HandleStaging *stage, StageTracker *tracker) {
+            // The network graph fills in while staging runs, so the
+            // graph heuristic stays off; reuse-aware scheduling
+            // covers locality in the meantime
+            Graph networkGraph;
+            HandleComparisons comparisonHandler(networkGraph, false, assignments_, Files_, serverURL_, log);
+            if(stage != NULL)
+            {
+               comparisonHandler.attachStaging(stage, tracker);
+            }
+            // Joint placement of bases and tiles: the planner emits
+            // a min-bytes-moved transfer schedule and the scheduler
+            // serves each worker its planned tiles first.  With
+            // staging attached the plan waits for the measured
+            // network; without it distances are uniform and the
+            // plan still shares bases across neighbouring tiles
+            StagingPlanner planner(Files_, collectHosts_());
+            comparisonHandler.attachPlanner(&planner);
+            // Snapshots go next to the similarity matrix; --resume
+            // replays an earlier run's file so finished tiles are
+            // never compared twice
+            comparisonHandler.attachCheckpoint(uuid_ + "-checkpoint.apck", resumePath_);
             std::string message("Running Comparisons ...");
             log->write(message, LOGLEVEL_INFO);
+            struct timeval tvStart, tvEnd;
+            ::gettimeofday(&tvStart, NULL);
             comparisonHandler.assignWork();
+            ::gettimeofday(&tvEnd, NULL);
             log->write("Success", LOGLEVEL_INFO);
+
+            // assignment throughput is the master-side number of the
+            // benchmark: how fast the dispatch fabric moves chunks,
+            // independent of what the workers compute
+            if(benchmark_ > 0)
+            {
+               double elapsed = (tvEnd.tv_sec  - tvStart.tv_sec)
+                  + (tvEnd.tv_usec - tvStart.tv_usec) / 1000000.0;
+               long pairs = 0;
+               for(unsigned int x = 0; x < assignments_.size(); x++)
+               {
+                  pairs += assignments_[x].size();
+               }
+               std::string report("Benchmark: assigned ");
+               report += boost::lexical_cast<std::string>(assignments_.size());
+               report += " chunks (" + boost::lexical_cast<std::string>(pairs);
+               report += " comparisons) in " + boost::lexical_cast<std::string>(elapsed);
+               report += " s - " + boost::lexical_cast<std::string>(assignments_.size() / elapsed);
+               report += " chunks/s, " + boost::lexical_cast<std::string>(pairs / elapsed);
+               report += " comparisons/s end-to-end";
+               log->write(report, LOGLEVEL_INFO);
+               std::cout << report << std::endl;
+            }
+         }
+
+         /*********************************************************
+          * aggregateResults_ walks every worker's advertised     *
+          * result segment and batch-merges the records into one  *
+          * similarity matrix file.  Workers append results to    *
+          * their segment locally, so the master does one         *
+          * sequential read per worker here instead of fielding   *
+          * one advert write per compared pair.                   *
+          * ******************************************************/
+         void aggregateResults_(void) {
+            log->write("Aggregating result segments...", LOGLEVEL_INFO);
+            std::string matrixPath(uuid_ + "-similarity.txt");
+            std::ofstream matrix(matrixPath.c_str());
+            int mode = saga::advert::ReadWrite;
+            std::vector<saga::url> workers = workersDir_.list("*");
+            for(std::vector<saga::url>::iterator it = workers.begin();
+                it != workers.end(); ++it)
+            {
+               try {
+                  saga::advert::directory worker(workersDir_.open_dir(*it, mode));
+                  saga::advert::directory results(worker.open_dir(saga::url(ADVERT_DIR_RESULTS), mode));
+                  saga::advert::entry seg(results.open(saga::url("segment"), mode));
+                  std::string located(seg.retrieve_string());
+                  std::string::size_type bar = located.find('|');
+                  std::string path(bar == std::string::npos
+                                    ? located : located.substr(bar + 1));
+                  ResultSegmentReader reader(path);
+                  if(!reader.good())
+                  {
+                     std::string message("Cannot read result segment ");
+                     message += path;
+                     log->write(message, LOGLEVEL_WARNING);
+                     continue;
+                  }
+                  std::string from, to;
+                  double value;
+                  while(reader.next(from, to, value))
+                  {
+                     matrix << from << " " << to << " " << value << "\n";
+                  }
+               }
+               catch(saga::exception const & e) {
+                  //Worker never compared anything or died early
+                  log->write(std::string(e.what()), LOGLEVEL_WARNING);
+               }
+            }
+            std::string message("Similarity matrix written to ");
+            message += matrixPath;
+            log->write(message, LOGLEVEL_INFO);
          }
 
          void sendQuit_(void) {
@@ -455,9 +661,9 @@ namespace AllPairs {
                   std::string message("Established connection to ");
                   message += worker.get_url().get_string();
                   log->write(message, LOGLEVEL_INFO);
-                  worker.write(saga::buffer(WORKER_COMMAND_QUIT, 4));
-                  std::string read(network::read(worker));
-                  network::expect(read, WORKER_RESPONSE_ACKNOLEDGE);
+                  wire::send(worker, MSG_QUIT);
+                  wire::receiver rx;
+                  wire::expect(worker, rx, MSG_ACKNOLEDGE);
                   successCounter++;
                   service->close();
                   delete service;
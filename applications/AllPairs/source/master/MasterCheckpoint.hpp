@@ -0,0 +1,217 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef AP_MASTER_CHECKPOINT_HPP
+#define AP_MASTER_CHECKPOINT_HPP
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace AllPairs {
+  /*********************************************************
+  * MasterCheckpoint is the master's crash insurance: a    *
+  * compact binary snapshot of the assignment bitmap, the  *
+  * staged-file map and the per-worker completion counts.  *
+  * The comparison scheduler saves one periodically, and a *
+  * master started with --resume loads it and skips every  *
+  * tile that already finished, so a master death costs    *
+  * one checkpoint interval instead of the whole run.      *
+  *                                                        *
+  * File layout (all integers little endian uint32):       *
+  *   byte 0-3  magic "APCK"                               *
+  *   byte 4    version (1)                                *
+  *   u32       chunk count                                *
+  *   u32       bitmap word count, then the bitmap words   *
+  *   u32       worker count, then per worker:             *
+  *             string  hostname (u32 length + bytes)      *
+  *             u32     completed chunk count              *
+  *             u32     staged file count + the file ids   *
+  *                                                        *
+  * save() writes to a temp file and renames it over the   *
+  * target, so a crash mid-write never corrupts the last   *
+  * good snapshot.                                         *
+  * ******************************************************/
+  class MasterCheckpoint {
+   public:
+     MasterCheckpoint(const std::string &path)
+      : chunkCount(0), path_(path) {
+     }
+
+     std::string path(void) const {
+        return path_;
+     }
+
+     void resize(unsigned int chunks) {
+        chunkCount = chunks;
+        finishedWords.assign((chunks + BITS_PER_WORD - 1) / BITS_PER_WORD, 0u);
+     }
+     void setFinished(unsigned int id) {
+        finishedWords[id / BITS_PER_WORD] |= 1u << (id % BITS_PER_WORD);
+     }
+     bool isFinished(unsigned int id) const {
+        return (finishedWords[id / BITS_PER_WORD]
+                & (1u << (id % BITS_PER_WORD))) != 0;
+     }
+
+     bool save(void) {
+        std::string tmpPath(path_ + ".tmp");
+        {
+           std::ofstream out(tmpPath.c_str(),
+                             std::ios::out | std::ios::binary | std::ios::trunc);
+           if(!out) {
+              return false;
+           }
+           out.write("APCK", 4);
+           out.put((char)VERSION);
+           writeU32_(out, chunkCount);
+           writeU32_(out, finishedWords.size());
+           for(unsigned int w = 0; w < finishedWords.size(); ++w) {
+              writeU32_(out, finishedWords[w]);
+           }
+           //Every worker seen in either map gets one record
+           std::set<std::string> workers;
+           for(std::map<std::string, std::set<int> >::iterator it = workerFiles.begin();
+               it != workerFiles.end(); ++it) {
+              workers.insert(it->first);
+           }
+           for(std::map<std::string, int>::iterator it = completed.begin();
+               it != completed.end(); ++it) {
+              workers.insert(it->first);
+           }
+           writeU32_(out, workers.size());
+           for(std::set<std::string>::iterator it = workers.begin();
+               it != workers.end(); ++it) {
+              writeString_(out, *it);
+              std::map<std::string, int>::iterator done = completed.find(*it);
+              writeU32_(out, done == completed.end() ? 0 : done->second);
+              std::map<std::string, std::set<int> >::iterator files = workerFiles.find(*it);
+              if(files == workerFiles.end()) {
+                 writeU32_(out, 0);
+              }
+              else {
+                 writeU32_(out, files->second.size());
+                 for(std::set<int>::iterator f = files->second.begin();
+                     f != files->second.end(); ++f) {
+                    writeU32_(out, (unsigned int)*f);
+                 }
+              }
+           }
+           if(!out) {
+              return false;
+           }
+        }
+        return 0 == ::rename(tmpPath.c_str(), path_.c_str());
+     }
+
+     bool load(void) {
+        std::ifstream in(path_.c_str(), std::ios::in | std::ios::binary);
+        if(!in) {
+           return false;
+        }
+        char magic[4];
+        in.read(magic, 4);
+        if(!in || 0 != ::memcmp(magic, "APCK", 4)) {
+           return false;
+        }
+        if(in.get() != VERSION) {
+           return false;
+        }
+        if(!readU32_(in, chunkCount)) {
+           return false;
+        }
+        unsigned int words = 0;
+        if(!readU32_(in, words)) {
+           return false;
+        }
+        finishedWords.assign(words, 0u);
+        for(unsigned int w = 0; w < words; ++w) {
+           if(!readU32_(in, finishedWords[w])) {
+              return false;
+           }
+        }
+        unsigned int workers = 0;
+        if(!readU32_(in, workers)) {
+           return false;
+        }
+        workerFiles.clear();
+        completed.clear();
+        for(unsigned int i = 0; i < workers; ++i) {
+           std::string host;
+           unsigned int done = 0, fileCount = 0;
+           if(!readString_(in, host) || !readU32_(in, done)
+              || !readU32_(in, fileCount)) {
+              return false;
+           }
+           completed[host] = (int)done;
+           std::set<int> &files = workerFiles[host];
+           for(unsigned int f = 0; f < fileCount; ++f) {
+              unsigned int id = 0;
+              if(!readU32_(in, id)) {
+                 return false;
+              }
+              files.insert((int)id);
+           }
+        }
+        return true;
+     }
+
+     unsigned int                          chunkCount;
+     std::vector<unsigned int>             finishedWords;
+     std::map<std::string, std::set<int> > workerFiles;
+     std::map<std::string, int>            completed;
+
+   private:
+     enum { VERSION = 1, BITS_PER_WORD = 32 };
+
+     static void writeU32_(std::ofstream &out, unsigned int v) {
+        char buf[4];
+        buf[0] = (char)(v & 0xFF);
+        buf[1] = (char)((v >> 8) & 0xFF);
+        buf[2] = (char)((v >> 16) & 0xFF);
+        buf[3] = (char)((v >> 24) & 0xFF);
+        out.write(buf, 4);
+     }
+     static bool readU32_(std::ifstream &in, unsigned int &v) {
+        unsigned char buf[4];
+        in.read((char *)buf, 4);
+        if(!in) {
+           return false;
+        }
+        v = (unsigned int)buf[0] | ((unsigned int)buf[1] << 8)
+          | ((unsigned int)buf[2] << 16) | ((unsigned int)buf[3] << 24);
+        return true;
+     }
+     static void writeString_(std::ofstream &out, const std::string &s) {
+        writeU32_(out, s.size());
+        out.write(s.data(), s.size());
+     }
+     static bool readString_(std::ifstream &in, std::string &s) {
+        unsigned int len = 0;
+        if(!readU32_(in, len) || len > MAX_STRING) {
+           return false;
+        }
+        std::vector<char> buf(len);
+        if(len > 0) {
+           in.read(&buf[0], len);
+           if(!in) {
+              return false;
+           }
+        }
+        s.assign(buf.begin(), buf.end());
+        return true;
+     }
+
+     enum { MAX_STRING = 65536 };   //sanity bound against corrupt files
+
+     std::string path_;
+  }; //Class MasterCheckpoint
+} //Namespace AllPairs
+
+#endif // AP_MASTER_CHECKPOINT_HPP
@@ -0,0 +1,44 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef AP_STAGE_TRACKER_HPP
+#define AP_STAGE_TRACKER_HPP
+
+#include <set>
+#include <string>
+#include <boost/thread/mutex.hpp>
+
+namespace AllPairs {
+  /*********************************************************
+  * StageTracker is the readiness board shared between     *
+  * HandleStaging and HandleComparisons when the two run   *
+  * as a pipeline: staging marks a host ready as soon as   *
+  * its transfers finish, and the comparison scheduler     *
+  * only hands out chunks whose input hosts are ready.     *
+  * ******************************************************/
+  class StageTracker {
+   public:
+     StageTracker() : allReady_(false) {
+     }
+     void markHostReady(const std::string &host) {
+        boost::mutex::scoped_lock lock(mutex_);
+        ready_.insert(host);
+     }
+     void markAllReady(void) {
+        boost::mutex::scoped_lock lock(mutex_);
+        allReady_ = true;
+     }
+     bool hostReady(const std::string &host) {
+        boost::mutex::scoped_lock lock(mutex_);
+        return allReady_ || ready_.find(host) != ready_.end();
+     }
+   private:
+     boost::mutex          mutex_;
+     std::set<std::string> ready_;
+     bool                  allReady_;
+  }; //Class StageTracker
+} //Namespace AllPairs
+
+#endif // AP_STAGE_TRACKER_HPP
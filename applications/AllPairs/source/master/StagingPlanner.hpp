@@ -0,0 +1,239 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef AP_STAGING_PLANNER_HPP
+#define AP_STAGING_PLANNER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <saga/saga.hpp>
+#include <boost/lexical_cast.hpp>
+#include "../utils/Graph.hpp"
+
+namespace AllPairs {
+   /*********************************************************
+   * One planned base-file movement: fileID travels from a  *
+   * current holder to the host that will compare with it.  *
+   * ******************************************************/
+   struct StagedTransfer {
+      int         fileID;
+      std::string from;
+      std::string to;
+      long long   bytes;
+   };
+
+   /*********************************************************
+   * StagingPlanner solves base-file placement jointly with *
+   * tile assignment.  Staging used to replicate files with *
+   * no view of which tiles a worker would actually run, so *
+   * typical layouts moved far more bytes than necessary.   *
+   * The planner walks the tiles greedily: each tile goes   *
+   * to the host where the fewest distance-weighted bytes   *
+   * must still be moved, counting files placed by earlier  *
+   * tiles as already there and respecting an optional      *
+   * per-host storage budget.  The result is a per-tile     *
+   * host preference (consulted by the chunk scheduler) and *
+   * an explicit transfer schedule with a bytes-moved       *
+   * total against the plan-free baseline.                  *
+   * ******************************************************/
+   class StagingPlanner {
+     public:
+      StagingPlanner(std::map<int, std::vector<saga::url> > &files,
+                     const std::vector<std::string> &hosts)
+         : files_(files), hosts_(hosts),
+           plannedBytes_(0), naiveBytes_(0), planned_(false) {
+      }
+      /*********************************************************
+      * setHostBudget caps the bytes the plan may stage onto   *
+      * one host; hosts without a budget are unlimited.        *
+      * ******************************************************/
+      void setHostBudget(const std::string &host, long long bytes) {
+         budget_[host] = bytes;
+      }
+      bool planned(void) const {
+         return planned_;
+      }
+      /*********************************************************
+      * plan runs the greedy placement.  chunkFiles[id] lists  *
+      * the input file ids of chunk id; distances is the       *
+      * measured network (unmeasured pairs count as weight 1). *
+      * File sizes are probed once each here - unreachable     *
+      * files fall back to a uniform size, degrading the       *
+      * metric to min-files-moved for them.                    *
+      * ******************************************************/
+      void plan(const std::vector<std::vector<int> > &chunkFiles,
+                const DistanceMatrix &distances) {
+         chunkHost_.assign(chunkFiles.size(), std::string(""));
+         for(unsigned int id = 0; id < chunkFiles.size(); ++id) {
+            std::string bestHost;
+            double bestCost = -1;
+            long long bestBytes = 0;
+            for(std::vector<std::string>::const_iterator host = hosts_.begin();
+                host != hosts_.end(); ++host) {
+               long long bytes = 0;
+               double cost = 0;
+               for(std::vector<int>::const_iterator file = chunkFiles[id].begin();
+                   file != chunkFiles[id].end(); ++file) {
+                  if(holds_(*host, *file)) {
+                     continue;
+                  }
+                  long long size = fileSize_(*file);
+                  bytes += size;
+                  cost  += size * weight_(distances,
+                                          nearestHolder_(distances, *file, *host),
+                                          *host);
+               }
+               if(!withinBudget_(*host, bytes)) {
+                  continue;
+               }
+               if(bestCost < 0 || cost < bestCost) {
+                  bestHost  = *host;
+                  bestCost  = cost;
+                  bestBytes = bytes;
+               }
+            }
+            if(bestHost.empty()) {
+               //Every host is over budget for this tile; leave it
+               //to the runtime reuse heuristics
+               continue;
+            }
+            chunkHost_[id] = bestHost;
+            plannedBytes_ += bestBytes;
+            for(std::vector<int>::const_iterator file = chunkFiles[id].begin();
+                file != chunkFiles[id].end(); ++file) {
+               //The baseline pulls every non-local input per tile,
+               //with no memory of earlier placements
+               if(homeOf_(*file) != bestHost) {
+                  naiveBytes_ += fileSize_(*file);
+               }
+               if(holds_(bestHost, *file)) {
+                  continue;
+               }
+               StagedTransfer transfer;
+               transfer.fileID = *file;
+               transfer.from   = nearestHolder_(distances, *file, bestHost);
+               transfer.to     = bestHost;
+               transfer.bytes  = fileSize_(*file);
+               schedule_.push_back(transfer);
+               placed_[bestHost].insert(*file);
+               used_[bestHost] += transfer.bytes;
+            }
+         }
+         planned_ = true;
+      }
+      /*********************************************************
+      * hostForChunk returns the planned host of a chunk, or   *
+      * the empty string when the plan left it unconstrained.  *
+      * ******************************************************/
+      const std::string &hostForChunk(unsigned int id) const {
+         static const std::string none;
+         return id < chunkHost_.size() ? chunkHost_[id] : none;
+      }
+      const std::vector<StagedTransfer> &schedule(void) const {
+         return schedule_;
+      }
+      long long plannedBytes(void) const {
+         return plannedBytes_;
+      }
+      long long naiveBytes(void) const {
+         return naiveBytes_;
+      }
+      std::string summary(void) const {
+         std::string text("Staging plan: ");
+         text += boost::lexical_cast<std::string>(schedule_.size());
+         text += " transfers, ";
+         text += boost::lexical_cast<std::string>(plannedBytes_);
+         text += " bytes moved (plan-free baseline ";
+         text += boost::lexical_cast<std::string>(naiveBytes_);
+         text += " bytes)";
+         return text;
+      }
+     private:
+      enum { DEFAULT_FILE_SIZE = 1 };
+
+      std::string homeOf_(int file) {
+         std::map<int, std::vector<saga::url> >::iterator it = files_.find(file);
+         if(it == files_.end() || it->second.empty()) {
+            return std::string("");
+         }
+         return it->second[0].get_host();
+      }
+      bool holds_(const std::string &host, int file) {
+         if(homeOf_(file) == host) {
+            return true;
+         }
+         std::map<std::string, std::set<int> >::iterator it = placed_.find(host);
+         return it != placed_.end()
+                && it->second.find(file) != it->second.end();
+      }
+      //Probed once per file; the result is cached for the whole plan
+      long long fileSize_(int file) {
+         std::map<int, long long>::iterator it = sizes_.find(file);
+         if(it != sizes_.end()) {
+            return it->second;
+         }
+         long long size = DEFAULT_FILE_SIZE;
+         try {
+            saga::filesystem::file f(files_[file][0], saga::filesystem::Read);
+            size = f.get_size();
+         }
+         catch(saga::exception const &) {
+            //size stays at the uniform fallback
+         }
+         sizes_[file] = size;
+         return size;
+      }
+      double weight_(const DistanceMatrix &distances,
+                     const std::string &from, const std::string &to) {
+         double d = distances.distance(from, to);
+         return d < 0 ? 1.0 : d;
+      }
+      //The cheapest current holder of file as seen from host: its
+      //home replica or any host an earlier tile staged it onto
+      std::string nearestHolder_(const DistanceMatrix &distances,
+                                 int file, const std::string &host) {
+         std::string best(homeOf_(file));
+         double bestDistance = weight_(distances, best, host);
+         for(std::map<std::string, std::set<int> >::iterator it = placed_.begin();
+             it != placed_.end(); ++it) {
+            if(it->second.find(file) == it->second.end()) {
+               continue;
+            }
+            double d = weight_(distances, it->first, host);
+            if(d < bestDistance) {
+               bestDistance = d;
+               best = it->first;
+            }
+         }
+         return best;
+      }
+      bool withinBudget_(const std::string &host, long long bytes) {
+         std::map<std::string, long long>::iterator it = budget_.find(host);
+         if(it == budget_.end() || it->second <= 0) {
+            return true;
+         }
+         std::map<std::string, long long>::iterator usedIt = used_.find(host);
+         long long used = usedIt == used_.end() ? 0 : usedIt->second;
+         return used + bytes <= it->second;
+      }
+
+      std::map<int, std::vector<saga::url> > &files_;
+      std::vector<std::string>                hosts_;
+      std::map<int, long long>                sizes_;
+      std::map<std::string, long long>        budget_;
+      std::map<std::string, long long>        used_;
+      //Files each host holds once the plan's transfers complete
+      std::map<std::string, std::set<int> >   placed_;
+      std::vector<std::string>                chunkHost_;
+      std::vector<StagedTransfer>             schedule_;
+      long long                               plannedBytes_;
+      long long                               naiveBytes_;
+      bool                                    planned_;
+   }; //Class StagingPlanner
+} //Namespace AllPairs
+
+#endif // AP_STAGING_PLANNER_HPP
@@ -0,0 +1,98 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef AP_TILED_ASSIGNMENTS_HPP
+#define AP_TILED_ASSIGNMENTS_HPP
+
+#include <vector>
+#include "Assignment.hpp"
+
+namespace AllPairs {
+  /*********************************************************
+  * TiledAssignmentGenerator covers the full source x     *
+  * target pair space without ever materializing it.  The *
+  * space is cut into 2D tiles (tileRows x tileCols       *
+  * pairs); an AssignmentChunk is built only when a tile  *
+  * is handed to a worker and thrown away afterwards, so  *
+  * master memory is proportional to the number of tiles  *
+  * rather than the number of pairs.  Tile completion is  *
+  * tracked in a bitmap, one bit per tile.                *
+  * ******************************************************/
+  class TiledAssignmentGenerator {
+   public:
+     TiledAssignmentGenerator()
+      : tileRows_(0), tileCols_(0), tilesDown_(0), tilesAcross_(0),
+        finishedCount_(0) {
+     }
+     TiledAssignmentGenerator(const std::vector<int> &sources,
+                              const std::vector<int> &targets,
+                              unsigned int tileRows, unsigned int tileCols)
+      : sources_(sources), targets_(targets),
+        tileRows_(tileRows), tileCols_(tileCols), finishedCount_(0) {
+        tilesDown_   = (sources_.size() + tileRows_ - 1) / tileRows_;
+        tilesAcross_ = (targets_.size() + tileCols_ - 1) / tileCols_;
+        finished_.resize((tileCount() + BITS_PER_WORD - 1) / BITS_PER_WORD, 0u);
+     }
+     unsigned int tileCount(void) const {
+        return tilesDown_ * tilesAcross_;
+     }
+     /*********************************************************
+     * getChunk materializes the tile's assignments.  Tile   *
+     * ids walk the matrix row block by row block, so        *
+     * consecutive ids share their source rows and a worker  *
+     * given neighboring tiles reuses staged bases.          *
+     * ******************************************************/
+     AssignmentChunk getChunk(int tileID) {
+        AssignmentChunk chunk(tileID);
+        unsigned int rowTile = tileID / tilesAcross_;
+        unsigned int colTile = tileID % tilesAcross_;
+        unsigned int rowEnd = (rowTile + 1) * tileRows_;
+        unsigned int colEnd = (colTile + 1) * tileCols_;
+        if(rowEnd > sources_.size()) {
+           rowEnd = sources_.size();
+        }
+        if(colEnd > targets_.size()) {
+           colEnd = targets_.size();
+        }
+        for(unsigned int row = rowTile * tileRows_; row < rowEnd; ++row) {
+           for(unsigned int col = colTile * tileCols_; col < colEnd; ++col) {
+              chunk.push_back(Assignment(sources_[row], targets_[col]));
+           }
+        }
+        return chunk;
+     }
+     void markFinished(int tileID) {
+        unsigned int word = tileID / BITS_PER_WORD;
+        unsigned int bit  = 1u << (tileID % BITS_PER_WORD);
+        if((finished_[word] & bit) == 0) {
+           finished_[word] |= bit;
+           finishedCount_++;
+        }
+     }
+     bool isFinished(int tileID) const {
+        return (finished_[tileID / BITS_PER_WORD]
+                & (1u << (tileID % BITS_PER_WORD))) != 0;
+     }
+     unsigned int finishedCount(void) const {
+        return finishedCount_;
+     }
+     bool allFinished(void) const {
+        return finishedCount_ >= tileCount();
+     }
+   private:
+     enum { BITS_PER_WORD = 32 };
+     std::vector<int> sources_;
+     std::vector<int> targets_;
+     unsigned int tileRows_;
+     unsigned int tileCols_;
+     unsigned int tilesDown_;
+     unsigned int tilesAcross_;
+     //One bit per tile; sized in the constructor
+     std::vector<unsigned int> finished_;
+     unsigned int finishedCount_;
+  }; //Class TiledAssignmentGenerator
+
+} //Namespace AllPairs
+#endif // AP_TILED_ASSIGNMENTS_HPP
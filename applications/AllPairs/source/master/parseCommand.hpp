@@ -29,6 +29,10 @@ bool parseCommand(int argCount, char *argList[], po::variables_map& vm) {
         ("config,c", po::value<std::string>(), "The config filename for this session")
         ("database,d", po::value<std::string>(), "Hostname of the orchestrator database")
         ("staging,s", "Enable staging")
+        ("resume,r", po::value<std::string>(), "Resume from the given checkpoint file, skipping finished tiles")
+        ("benchmark,b", po::value<int>(), "Benchmark mode: generate the given number of synthetic base files and run an all-pairs workload over them")
+        ("benchmark-size", po::value<int>(), "Benchmark mode: size of each synthetic base file in KB (default 1024)")
+        ("benchmark-compare", po::value<int>(), "Benchmark mode: calibrated busy-loop cost per comparison in milliseconds (default 50)")
         ;
       po::positional_options_description p;
       po::store(po::parse_command_line(argCount, argList, desc_cmdline), vm);
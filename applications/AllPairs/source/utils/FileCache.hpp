@@ -0,0 +1,132 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef AP_FILE_CACHE_HPP
+#define AP_FILE_CACHE_HPP
+
+#include <list>
+#include <map>
+#include <string>
+#include <saga/saga.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/mutex.hpp>
+#include "LogWriter.hpp"
+#include "defines.hpp"
+
+namespace AllPairs {
+   /*********************************************************
+   * FileCache keeps whole input files in worker memory    *
+   * across assignment chunks.  Consecutive chunks of the  *
+   * comparison matrix share most of their rows and        *
+   * columns, so reads consult the cache before touching   *
+   * saga::filesystem; once the configured memory budget   *
+   * is exceeded, the least recently used files are        *
+   * evicted first.                                        *
+   * ******************************************************/
+   class FileCache {
+     public:
+      typedef boost::shared_ptr<const std::string> content;
+      FileCache(saga::off_t budget = FILE_CACHE_BUDGET,
+                LogWriter *log = NULL)
+         : budget_(budget), used_(0), hits_(0), misses_(0), log_(log) {
+      }
+      /*********************************************************
+      * get returns the contents of url, from memory when the *
+      * file is cached and through saga::filesystem otherwise.*
+      * A file larger than the whole budget is read but never *
+      * cached.                                               *
+      * ******************************************************/
+      content get(const saga::url &url) {
+         std::string key(url.get_string());
+         {
+            boost::mutex::scoped_lock lock(mutex_);
+            std::map<std::string, Entry>::iterator hit = entries_.find(key);
+            if(hit != entries_.end()) {
+               hits_++;
+               //Move to the front of the recency list
+               lru_.erase(hit->second.position);
+               lru_.push_front(key);
+               hit->second.position = lru_.begin();
+               return hit->second.data;
+            }
+            misses_++;
+         }
+         //Read outside the lock so a miss does not stall hits
+         content data(read_(url));
+         boost::mutex::scoped_lock lock(mutex_);
+         if((saga::off_t)data->size() <= budget_
+            && entries_.find(key) == entries_.end()) {
+            used_ += data->size();
+            lru_.push_front(key);
+            Entry entry;
+            entry.data     = data;
+            entry.position = lru_.begin();
+            entries_[key]  = entry;
+            evict_();
+         }
+         return data;
+      }
+      int hits(void) {
+         return hits_;
+      }
+      int misses(void) {
+         return misses_;
+      }
+     private:
+      struct Entry {
+         content data;
+         std::list<std::string>::iterator position;
+      };
+      /*********************************************************
+      * read_ pulls the whole file into memory with the same  *
+      * large buffer the stager uses.                         *
+      * ******************************************************/
+      content read_(const saga::url &url) {
+         boost::shared_ptr<std::string> data(new std::string());
+         saga::filesystem::file f(url, saga::filesystem::Read);
+         data->reserve(f.get_size());
+         boost::scoped_array<char> buffer(new char[STAGING_BUFFER_SIZE]);
+         while(true) {
+            saga::ssize_t got = f.read(saga::buffer(buffer.get(),
+                                                    STAGING_BUFFER_SIZE));
+            if(got <= 0) {
+               break;
+            }
+            data->append(buffer.get(), got);
+         }
+         return data;
+      }
+      /*********************************************************
+      * evict_ drops least recently used entries until the    *
+      * cache fits its budget again (caller holds mutex_).    *
+      * ******************************************************/
+      void evict_(void) {
+         while(used_ > budget_ && !lru_.empty()) {
+            std::map<std::string, Entry>::iterator victim =
+               entries_.find(lru_.back());
+            used_ -= victim->second.data->size();
+            if(log_ != NULL) {
+               log_->write(std::string("Evicting ") + lru_.back(),
+                           LOGLEVEL_DEBUG);
+            }
+            entries_.erase(victim);
+            lru_.pop_back();
+         }
+      }
+
+      saga::off_t budget_;
+      saga::off_t used_;
+      int hits_;
+      int misses_;
+      LogWriter *log_;
+      //URLs ordered most recently used first
+      std::list<std::string> lru_;
+      std::map<std::string, Entry> entries_;
+      boost::mutex mutex_;
+   }; // class FileCache
+} // namespace AllPairs
+
+#endif // AP_FILE_CACHE_HPP
@@ -0,0 +1,153 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef AP_FILE_STAGER_HPP
+#define AP_FILE_STAGER_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <saga/saga.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
+#include "LogWriter.hpp"
+#include "defines.hpp"
+
+namespace AllPairs {
+   /*********************************************************
+   * FileStager copies a set of files to local disk using  *
+   * a pool of concurrent transfers instead of one file at *
+   * a time, so worker warm-up drives the full fabric      *
+   * bandwidth.  Reads go through STAGING_BUFFER_SIZE      *
+   * buffers, and files above STAGING_STRIPE_SIZE are      *
+   * split into stripes pulled by several transfer threads *
+   * at once into the same local file.                     *
+   * ******************************************************/
+   class FileStager {
+     public:
+      FileStager(int concurrency = STAGING_CONCURRENCY,
+                 LogWriter *log = NULL)
+         : concurrency_(concurrency), failures_(0), log_(log) {
+      }
+      void add(const saga::url &source, const std::string &localPath) {
+         files_.push_back(std::pair<saga::url, std::string>(source, localPath));
+      }
+      /*********************************************************
+      * run blocks until every added file is local.  Returns  *
+      * the number of failed transfers.                       *
+      * ******************************************************/
+      int run() {
+         //Size every source first so big files can be striped
+         std::vector<std::pair<saga::url, std::string> >::iterator end = files_.end();
+         for(std::vector<std::pair<saga::url, std::string> >::iterator it = files_.begin();
+             it != end; ++it) {
+            try {
+               saga::filesystem::file f(it->first, saga::filesystem::Read);
+               saga::off_t size = f.get_size();
+               //Create and pre-truncate the local file so stripe
+               //writers can seek into it independently
+               std::ofstream create(it->second.c_str(),
+                                    std::ios::binary | std::ios::trunc);
+               saga::off_t offset = 0;
+               do {
+                  Stripe stripe;
+                  stripe.source    = it->first;
+                  stripe.localPath = it->second;
+                  stripe.offset    = offset;
+                  stripe.length    = size - offset > STAGING_STRIPE_SIZE
+                                      ? (saga::off_t)STAGING_STRIPE_SIZE
+                                      : size - offset;
+                  stripes_.push_back(stripe);
+                  offset += stripe.length;
+               } while(offset < size);
+            }
+            catch(saga::exception const &e) {
+               report_(std::string("Cannot stage ") + it->first.get_string()
+                       + ": " + e.what());
+               failures_++;
+            }
+         }
+         boost::thread_group pool;
+         for(int i = 0; i < concurrency_; i++) {
+            pool.create_thread(boost::bind(&FileStager::transfer_, this));
+         }
+         pool.join_all();
+         return failures_;
+      }
+     private:
+      struct Stripe {
+         saga::url   source;
+         std::string localPath;
+         saga::off_t offset;
+         saga::off_t length;
+      };
+      void report_(const std::string &message) {
+         if(log_ != NULL) {
+            log_->write(message, LOGLEVEL_ERROR);
+         }
+         else {
+            std::cerr << message << std::endl;
+         }
+      }
+      /*********************************************************
+      * transfer_ is the body of one pool thread: it claims   *
+      * stripes and copies them with a large read buffer.     *
+      * ******************************************************/
+      void transfer_() {
+         boost::scoped_array<char> buffer(new char[STAGING_BUFFER_SIZE]);
+         while(true) {
+            Stripe stripe;
+            {
+               boost::mutex::scoped_lock lock(mutex_);
+               if(stripes_.empty()) {
+                  return;
+               }
+               stripe = stripes_.front();
+               stripes_.pop_front();
+            }
+            try {
+               saga::filesystem::file in(stripe.source, saga::filesystem::Read);
+               if(stripe.offset > 0) {
+                  in.seek(stripe.offset, saga::filesystem::Start);
+               }
+               std::fstream out(stripe.localPath.c_str(),
+                                std::ios::binary | std::ios::in | std::ios::out);
+               out.seekp(stripe.offset);
+               saga::off_t remaining = stripe.length;
+               while(remaining > 0) {
+                  saga::ssize_t want = remaining > STAGING_BUFFER_SIZE
+                                        ? (saga::ssize_t)STAGING_BUFFER_SIZE
+                                        : (saga::ssize_t)remaining;
+                  saga::ssize_t got = in.read(saga::buffer(buffer.get(), want));
+                  if(got <= 0) {
+                     break;
+                  }
+                  out.write(buffer.get(), got);
+                  remaining -= got;
+               }
+            }
+            catch(saga::exception const &e) {
+               report_(std::string("Transfer of ") + stripe.source.get_string()
+                       + " failed: " + e.what());
+               boost::mutex::scoped_lock lock(mutex_);
+               failures_++;
+            }
+         }
+      }
+
+      int concurrency_;
+      int failures_;
+      LogWriter *log_;
+      std::vector<std::pair<saga::url, std::string> > files_;
+      //Work list claimed by the transfer pool (guarded by mutex_)
+      std::deque<Stripe> stripes_;
+      boost::mutex mutex_;
+   }; // class FileStager
+} // namespace AllPairs
+
+#endif // AP_FILE_STAGER_HPP
@@ -7,6 +7,9 @@
 #define AP_GRAPH_HPP
 
 #define BOOST_NO_HASH
+#include <string>
+#include <vector>
+#include <map>
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/adjacency_list.hpp>
 
@@ -20,6 +23,48 @@ namespace AllPairs {
                                  EdgeProperty> Graph;
    typedef boost::graph_traits<Graph>::vertex_descriptor Vertex;
    typedef boost::graph_traits<Graph>::edge_descriptor Edge;
+
+   /*********************************************************
+   * DistanceMatrix flattens the measured network graph    *
+   * into a row-major array for O(1) host-to-host weight   *
+   * lookups.  It is built once after staging and can be   *
+   * rebuilt whenever the topology changes, so scheduling  *
+   * decisions stop scanning the edge list per assignment. *
+   * ******************************************************/
+   class DistanceMatrix {
+     public:
+      DistanceMatrix() : size_(0) {
+      }
+      void rebuild(const Graph &graph) {
+         indexOf_.clear();
+         size_ = boost::num_vertices(graph);
+         distances_.assign(size_ * size_, -1.0);
+         boost::graph_traits<Graph>::vertex_iterator vi, vend;
+         boost::tie(vi, vend) = boost::vertices(graph);
+         for(; vi != vend; ++vi) {
+            indexOf_[graph[*vi].name] = *vi;
+         }
+         boost::graph_traits<Graph>::edge_iterator ei, eend;
+         boost::tie(ei, eend) = boost::edges(graph);
+         for(; ei != eend; ++ei) {
+            distances_[boost::source(*ei, graph) * size_
+                       + boost::target(*ei, graph)] = graph[*ei].weight;
+         }
+      }
+      //Returns -1 when either host is unknown or unmeasured
+      double distance(const std::string &from, const std::string &to) const {
+         std::map<std::string, unsigned int>::const_iterator fromIt = indexOf_.find(from);
+         std::map<std::string, unsigned int>::const_iterator toIt   = indexOf_.find(to);
+         if(fromIt == indexOf_.end() || toIt == indexOf_.end()) {
+            return -1.0;
+         }
+         return distances_[fromIt->second * size_ + toIt->second];
+      }
+     private:
+      std::map<std::string, unsigned int> indexOf_;
+      std::vector<double> distances_;
+      unsigned int size_;
+   }; // class DistanceMatrix
 }
 
 #endif //AP_GRAPH_HPP
@@ -1,38 +1,61 @@
 //  Copyright (c) 2008 Michael Miceli and Christopher Miceli
-// 
-//  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
 #ifndef AP_LOG_WRITER_HPP
 #define AP_LOG_WRITER_HPP
 
 #include <string>
+#include <vector>
 #include <saga/saga.hpp>
 #include <time.h>
 #include <ostream>
 #include "defines.hpp"
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
 
 
-namespace AllPairs 
+namespace AllPairs
 {
+  /*********************************************************
+   * Asynchronous log writer: callers only format and push *
+   * onto a bounded ring, a background thread does the     *
+   * terminal I/O.  If the ring fills up, messages are     *
+   * counted as dropped instead of making the master wait. *
+   * ******************************************************/
   class LogWriter {
 
   private:
-    
+    static const std::size_t RING_SIZE = 1024;
+
     std::string appName_;
     saga::url   advURL_;
-    
+
+    std::vector<std::string> ring_;
+    std::size_t      head_;
+    std::size_t      queued_;
+    std::size_t      dropped_;
+    bool             running_;
+    boost::mutex     mutex_;
+    boost::condition notEmpty_;
+    boost::thread    writer_; //keep last so the ring exists first
+
+    std::string format_(std::string const &message, unsigned int logLevel);
+    void writerLoop_();
+
   public:
-    
+
     LogWriter(std::string appName, saga::url advURL);
     LogWriter(saga::url advURL);
-    
+
     ~LogWriter();
-    
+
     void write(std::string, unsigned int logLevel);
-    
+
   };
 }
 
-#endif // AP_LOG_WRITER_HPP 
+#endif // AP_LOG_WRITER_HPP
@@ -0,0 +1,150 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef AP_NUMA_TOPOLOGY_HPP
+#define AP_NUMA_TOPOLOGY_HPP
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace AllPairs {
+   /*********************************************************
+   * NumaTopology discovers the memory nodes of the host   *
+   * and lets worker threads pin themselves to one.  On    *
+   * Linux the node list and each node's cpus come from    *
+   * sysfs; everywhere else (and on single-socket hosts)   *
+   * the topology collapses to one node, pinning becomes a *
+   * no-op, and callers behave exactly as before.  The     *
+   * point of pinning is first-touch placement: a thread   *
+   * bound to a node allocates and touches its comparison  *
+   * buffers and cache pages in that node's memory, so the *
+   * kernel never has to serve them across the socket      *
+   * interconnect.                                         *
+   * ******************************************************/
+   class NumaTopology {
+     public:
+      NumaTopology() {
+         discover_();
+      }
+      int nodeCount(void) const {
+         return (int)cpusOfNode_.size();
+      }
+      /*********************************************************
+      * homeNode maps a key (an input url) to its node with a *
+      * stable hash, so every chunk of the comparison matrix  *
+      * sends the same base file to the same node's cache     *
+      * shard and threads.                                    *
+      * ******************************************************/
+      int homeNode(const std::string &key) const {
+         unsigned long hash = 5381;
+         for(std::string::size_type i = 0; i < key.size(); i++) {
+            hash = hash * 33 + (unsigned char)key[i];
+         }
+         return (int)(hash % cpusOfNode_.size());
+      }
+      /*********************************************************
+      * currentNode names the node of the cpu the calling     *
+      * thread runs on right now; 0 when that cannot be told. *
+      * ******************************************************/
+      int currentNode(void) const {
+#if defined(__linux__)
+         int cpu = sched_getcpu();
+         if(cpu >= 0 && cpu < (int)nodeOfCpu_.size()) {
+            return nodeOfCpu_[cpu];
+         }
+#endif
+         return 0;
+      }
+      /*********************************************************
+      * pinToNode restricts the calling thread to the node's  *
+      * cpus.  Returns whether the affinity call succeeded.   *
+      * ******************************************************/
+      bool pinToNode(int node) const {
+#if defined(__linux__)
+         if(node < 0 || node >= (int)cpusOfNode_.size()
+            || cpusOfNode_[node].empty()) {
+            return false;
+         }
+         cpu_set_t set;
+         CPU_ZERO(&set);
+         for(std::vector<int>::size_type c = 0;
+             c < cpusOfNode_[node].size(); c++) {
+            CPU_SET(cpusOfNode_[node][c], &set);
+         }
+         return 0 == pthread_setaffinity_np(pthread_self(),
+                                            sizeof(set), &set);
+#else
+         (void)node;
+         return false;
+#endif
+      }
+     private:
+      /*********************************************************
+      * discover_ walks /sys/devices/system/node; a host     *
+      * without that tree gets the one-node fallback.        *
+      * ******************************************************/
+      void discover_(void) {
+#if defined(__linux__)
+         for(int node = 0; ; node++) {
+            std::ostringstream path;
+            path << "/sys/devices/system/node/node" << node << "/cpulist";
+            std::ifstream in(path.str().c_str());
+            if(!in) {
+               break;
+            }
+            std::string list;
+            std::getline(in, list);
+            cpusOfNode_.push_back(parseCpuList_(list));
+            for(std::vector<int>::size_type c = 0;
+                c < cpusOfNode_.back().size(); c++) {
+               int cpu = cpusOfNode_.back()[c];
+               if(cpu >= (int)nodeOfCpu_.size()) {
+                  nodeOfCpu_.resize(cpu + 1, 0);
+               }
+               nodeOfCpu_[cpu] = node;
+            }
+         }
+#endif
+         if(cpusOfNode_.empty()) {
+            cpusOfNode_.push_back(std::vector<int>());
+         }
+      }
+      /*********************************************************
+      * parseCpuList_ reads the sysfs "0-3,8-11" range form.  *
+      * ******************************************************/
+      static std::vector<int> parseCpuList_(const std::string &list) {
+         std::vector<int> cpus;
+         std::istringstream in(list);
+         std::string range;
+         while(std::getline(in, range, ',')) {
+            std::string::size_type dash = range.find('-');
+            int first = std::atoi(range.substr(0, dash).c_str());
+            int last  = first;
+            if(dash != std::string::npos) {
+               last = std::atoi(range.substr(dash + 1).c_str());
+            }
+            for(int cpu = first; cpu <= last; cpu++) {
+               cpus.push_back(cpu);
+            }
+         }
+         return cpus;
+      }
+
+      //cpus per node, and the reverse map
+      std::vector<std::vector<int> > cpusOfNode_;
+      std::vector<int>               nodeOfCpu_;
+   }; // class NumaTopology
+} // namespace AllPairs
+
+#endif // AP_NUMA_TOPOLOGY_HPP
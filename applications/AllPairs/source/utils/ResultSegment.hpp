@@ -0,0 +1,95 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef AP_RESULT_SEGMENT_HPP
+#define AP_RESULT_SEGMENT_HPP
+
+#include <string>
+#include <fstream>
+
+namespace AllPairs {
+   /*********************************************************
+   * ResultSegmentWriter appends comparison results to a   *
+   * per-worker binary segment file.  Each record is       *
+   * length-prefixed from and to names followed by the raw *
+   * double value, so a chunk's worth of results costs one *
+   * buffered file append instead of one advert write per  *
+   * pair.                                                 *
+   * ******************************************************/
+   class ResultSegmentWriter {
+     public:
+      ResultSegmentWriter(const std::string &path)
+         : path_(path),
+           out_(path.c_str(), std::ios::binary | std::ios::app) {
+      }
+      void append(const std::string &from, const std::string &to,
+                  double value) {
+         writeLength_(from.size());
+         out_.write(from.data(), from.size());
+         writeLength_(to.size());
+         out_.write(to.data(), to.size());
+         out_.write(reinterpret_cast<const char *>(&value), sizeof(double));
+      }
+      void flush(void) {
+         out_.flush();
+      }
+      const std::string &path(void) const {
+         return path_;
+      }
+     private:
+      void writeLength_(unsigned int n) {
+         char bytes[4];
+         bytes[0] = static_cast<char>(n       & 0xff);
+         bytes[1] = static_cast<char>(n >>  8 & 0xff);
+         bytes[2] = static_cast<char>(n >> 16 & 0xff);
+         bytes[3] = static_cast<char>(n >> 24 & 0xff);
+         out_.write(bytes, 4);
+      }
+      std::string   path_;
+      std::ofstream out_;
+   }; // class ResultSegmentWriter
+
+   /*********************************************************
+   * ResultSegmentReader walks one segment file record by  *
+   * record; the master's aggregator uses it to merge all  *
+   * workers' segments into the final similarity matrix.   *
+   * ******************************************************/
+   class ResultSegmentReader {
+     public:
+      ResultSegmentReader(const std::string &path)
+         : in_(path.c_str(), std::ios::binary) {
+      }
+      bool good(void) {
+         return in_.good();
+      }
+      bool next(std::string &from, std::string &to, double &value) {
+         if(!readString_(from) || !readString_(to)) {
+            return false;
+         }
+         in_.read(reinterpret_cast<char *>(&value), sizeof(double));
+         return in_.gcount() == sizeof(double);
+      }
+     private:
+      bool readString_(std::string &result) {
+         char bytes[4];
+         in_.read(bytes, 4);
+         if(in_.gcount() != 4) {
+            return false;
+         }
+         unsigned int n = (unsigned char)bytes[0]
+                        | (unsigned char)bytes[1] <<  8
+                        | (unsigned char)bytes[2] << 16
+                        | (unsigned char)bytes[3] << 24;
+         result.resize(n);
+         if(n > 0) {
+            in_.read(&result[0], n);
+         }
+         return in_.gcount() == (std::streamsize)n;
+      }
+      std::ifstream in_;
+   }; // class ResultSegmentReader
+} // namespace AllPairs
+
+#endif // AP_RESULT_SEGMENT_HPP
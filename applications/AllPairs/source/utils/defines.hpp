@@ -24,16 +24,26 @@
 #define ATTR_EXE_ARCH              "EXE_ARCH"
 #define ATTR_EXE_LOCATION          "EXE_LOCATION"
 
-#define MASTER_QUESTION_STATE      "STATE?"
-#define MASTER_QUESTION_ADVERT     "ADVERT?"
-#define MASTER_QUESTION_LOCATION   "LOCATION?"
-#define MASTER_QUESTION_RESULT     "RESULT?"
-#define MASTER_REQUEST_IDLE        "IDLE!"
-
-#define WORKER_RESPONSE_ACKNOLEDGE "ACKNOLEDGE"
-#define WORKER_RESPONSE_REJECT     "REJECT"
-#define START_CHUNK                "START"
-#define END_CHUNK                  "END" 
+// Message types for the framed worker protocol (see common/wire.hpp).
+// Each conversation step is one frame; a whole assignment chunk or host
+// list travels as the parts of a single message instead of one
+// write-plus-ack round trip per item.
+#define MSG_QUESTION_STATE     1   // master->worker, no payload
+#define MSG_QUESTION_LOCATION  2   // master->worker, no payload
+#define MSG_QUESTION_ADVERT    3   // master->worker, no payload
+#define MSG_QUESTION_RESULT    4   // master->worker, no payload
+#define MSG_REQUEST_IDLE       5   // master->worker, no payload
+#define MSG_ACKNOLEDGE         6   // worker->master, no payload
+#define MSG_REJECT             7   // worker->master, no payload
+#define MSG_STATE              8   // worker->master, part 0 = WORKER_STATE_*
+#define MSG_LOCATION           9   // worker->master, part 0 = hostname
+#define MSG_ADVERT            10   // worker->master, part 0 = advert url
+#define MSG_RESULT            11   // worker->master, chunk id or one part
+                                   // per staging measurement
+#define MSG_ASSIGN_COMPARE    12   // master->worker, part 0 = chunk id,
+                                   // then to/from urls pairwise
+#define MSG_ASSIGN_STAGE      13   // master->worker, one part per host
+#define MSG_QUIT              14   // master->worker, no payload
 
 #define ADVERT_DIR_WORKERS         "WORKERS"
 #define ADVERT_DIR_BINARIES        "BINARIES"
@@ -51,6 +61,25 @@
 #define WORKER_STATE_FAIL          "FAIL"       // Assigned task failed 
 #define WORKER_STATE_COMPARING     "COMPARING"  // Done with assigned task
 
+#define NUM_DISPATCH_THREADS       16   // Concurrent worker conversations in the master
+#define CHECKPOINT_INTERVAL        60   // Seconds between master state snapshots
+
+#define STAGING_CONCURRENCY        8                  // Parallel transfers during worker warm-up
+#define STAGING_BUFFER_SIZE        (16*1024*1024)     // Per-transfer read buffer
+#define STAGING_STRIPE_SIZE        (64*1024*1024)     // Files above this are read in stripes
+
+#define FILE_CACHE_BUDGET          (512*1024*1024)    // Worker-resident input file cache (bytes)
+
+// Benchmark mode (master --benchmark): the session advertises the
+// calibrated per-comparison busy-loop cost, and workers replace their
+// real comparison with it while still staging inputs normally - so a
+// run reports staging bandwidth, assignment throughput and comparison
+// rate without a real dataset
+#define ATTR_BENCH_COMPARE_MS      "BENCH_COMPARE_MS"
+#define BENCH_FILE_SIZE_KB         1024  // Default synthetic base file size
+#define BENCH_COMPARE_MS           50    // Default busy-loop cost per comparison
+#define BENCH_PAIRS_PER_CHUNK      64    // Pairs per generated AssignmentChunk
+
 #define LOGLEVEL_FATAL             0x2   
 #define LOGLEVEL_ERROR             0x4  
 #define LOGLEVEL_WARNING           0x8   
@@ -10,14 +10,22 @@
 #include <string>
 #include <time.h>
 #include <saga/saga.hpp>
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
 #include "../utils/LogWriter.hpp"
 #include "../utils/defines.hpp"
-#include "../utils/network.hpp"
+#include "../utils/FileCache.hpp"
+#include "../utils/NumaTopology.hpp"
+#include "../utils/ResultSegment.hpp"
+#include "ComparisonTile.hpp"
 #include "RunComparison.hpp"
 #include "RunStaging.hpp"
 #include "SystemInfo.hpp"
 #include "parseCommand.hpp"
+#include "../../../common/wire.hpp"
+#include "../../../common/worker_runtime.hpp"
 
 namespace AllPairs {
    template <class Derived>
@@ -44,6 +52,18 @@ namespace AllPairs {
          logWriter_   = new LogWriter(AP_WORKER_EXE_NAME, logURL_);
          state_       = WORKER_STATE_IDLE;
          lastFinishedChunk_ = -1;
+         benchCompareMs_ = 0;
+         concurrentTiles_ = false;
+         //One cache shard per memory node, each with its slice of
+         //the budget: a tile thread pinned to a node populates its
+         //own shard, so cached pages stay local to the socket that
+         //reads them (one shard, same as before, on single-node
+         //hosts)
+         for(int node = 0; node < numa_.nodeCount(); node++) {
+            fileCaches_.push_back(boost::shared_ptr<FileCache>(
+               new FileCache(FILE_CACHE_BUDGET / numa_.nodeCount(),
+                             logWriter_)));
+         }
       }
       /*********************************************************
        * starts the worker and begins all neccessary setup with*
@@ -73,6 +93,51 @@ namespace AllPairs {
          value = d.compare(object1, object2);
          return value;
       };
+      /*********************************************************
+       * compareTile is the block-compare hook: it receives a  *
+       * whole rows x columns tile so a worker can load every  *
+       * input once and cache-block/vectorize its kernel.      *
+       * Workers that only implement compare() get this        *
+       * pair-at-a-time default.                               *
+       * ******************************************************/
+      void compareTile(ComparisonTile &tile) {
+         for(unsigned int pair = 0; pair < tile.pairCount(); ++pair) {
+            tile.setValue(pair, compare(saga::url(tile.pairFrom(pair)),
+                                        saga::url(tile.pairTo(pair))));
+         }
+      };
+     protected:
+      /*********************************************************
+       * fileCache gives comparison code the worker-resident  *
+       * input cache; it outlives any single AssignmentChunk, *
+       * so rows and columns shared by neighbouring chunks    *
+       * are read from disk only once.  The cache is sharded  *
+       * per memory node and this returns the shard local to  *
+       * the node the calling thread runs on.                 *
+       * ******************************************************/
+      FileCache& fileCache(void) {
+         return *fileCaches_[numa_.currentNode()];
+      }
+      /*********************************************************
+       * enableConcurrentTiles declares the derived compare/  *
+       * compareTile hooks thread safe, letting the per-node  *
+       * tiles of a chunk run in parallel (one pinned thread  *
+       * per socket) instead of one after the other.  Off by  *
+       * default: the stock hooks keep per-worker state (the  *
+       * resident base image, for one).                       *
+       * ******************************************************/
+      void enableConcurrentTiles(void) {
+         concurrentTiles_ = true;
+      }
+      /*********************************************************
+       * benchCompareMillis is nonzero when this session runs  *
+       * in benchmark mode: the comparison implementation      *
+       * should then burn this many milliseconds of calibrated *
+       * busy-loop work per pair instead of a real comparison. *
+       * ******************************************************/
+      int benchCompareMillis(void) {
+         return benchCompareMs_;
+      }
      private:
       std::string uuid_;
       std::string sessionUUID_;
@@ -81,6 +146,7 @@ namespace AllPairs {
       std::string state_;
       std::string location_;
       int lastFinishedChunk_;
+      int benchCompareMs_;
       saga::url   serverURL_;
    
       time_t startupTime_;
@@ -89,39 +155,95 @@ namespace AllPairs {
       saga::advert::directory workerDir_;
       saga::advert::directory resultDir_;
       saga::advert::directory sessionBaseDir_;
+
+      //Shared worker lifecycle pieces (see common/worker_runtime.hpp):
+      //registration transaction, adaptive keepalive, command stream
+      worker_runtime::registry         registry_;
+      worker_runtime::heartbeat        heartbeat_;
+      worker_runtime::stream_transport transport_;
+
       std::vector<double>     stageResult_;
       AllPairs::LogWriter*    logWriter_;
+      NumaTopology            numa_;
+      //one cache shard per memory node (see fileCache)
+      std::vector<boost::shared_ptr<FileCache> > fileCaches_;
+      bool                    concurrentTiles_;
       RunComparison*          runComparison_;
       Derived& derived() {
          return static_cast<Derived&>(*this);
       }
+      /*********************************************************
+       * runTileOnNode_ is the body of one tile thread: pin to *
+       * the tile's home node, then run the block-compare hook *
+       * there, so its buffers and the node's cache shard are  *
+       * touched - and from then on read - socket-locally.     *
+       * ******************************************************/
+      void runTileOnNode_(ComparisonTile *tile, int node) {
+         numa_.pinToNode(node);
+         derived().compareTile(*tile);
+      }
+      /*********************************************************
+       * compareTiles_ runs each node's tile of the chunk on a *
+       * thread pinned to that node.  Tiles run one at a time  *
+       * unless the derived worker called                      *
+       * enableConcurrentTiles - the placement win does not    *
+       * require kernels to be thread safe.                    *
+       * ******************************************************/
+      void compareTiles_(std::vector<ComparisonTile> &tiles) {
+         if(numa_.nodeCount() <= 1) {
+            derived().compareTile(tiles[0]);
+            return;
+         }
+         if(concurrentTiles_) {
+            boost::thread_group group;
+            for(std::vector<ComparisonTile>::size_type node = 0;
+                node < tiles.size(); node++) {
+               if(tiles[node].pairCount() > 0) {
+                  group.create_thread(boost::bind(
+                     &AllPairsBase::runTileOnNode_, this,
+                     &tiles[node], (int)node));
+               }
+            }
+            group.join_all();
+         }
+         else {
+            for(std::vector<ComparisonTile>::size_type node = 0;
+                node < tiles.size(); node++) {
+               if(tiles[node].pairCount() > 0) {
+                  boost::thread worker(boost::bind(
+                     &AllPairsBase::runTileOnNode_, this,
+                     &tiles[node], (int)node));
+                  worker.join();
+               }
+            }
+         }
+      }
+      /*********************************************************
+       * segmentPath_ names this worker's local result segment *
+       * file; all chunks append to the same segment.          *
+       * ******************************************************/
+      std::string segmentPath_(void) {
+         return std::string("ap-segment-") + uuid_ + ".dat";
+      }
       /*********************************************************
        * updateStatus_ updates the attributes in the database  *
        * to allow the master to know keepalive information.    *
        * ******************************************************/
       void updateStatus_(void) {
-         //(1) update the last seen (keep alive) timestamp 
-         time_t timestamp;
-         time(&timestamp);
-         try {
-             workerDir_.set_attribute(ATTR_LAST_SEEN, 
-             boost::lexical_cast<std::string>(timestamp)); 
-         }
-         catch(saga::exception const & e) {
-           std::cout << "FAILED (" << e.get_error() << ")" << std::endl;
-           throw;
-         }
-         //(2) update the current load average
+         //keepalive through the shared adaptive heartbeat: each due
+         //beat is one bulk write of LAST_SEEN plus the current load
+         //average; the cadence snaps to its minimum while work is in
+         //flight and backs off while the worker idles
          try {
-           workerDir_.set_attribute(ATTR_HOST_LOAD_AVG, 
-             systemInfo_.hostLoadAverage());
+           std::vector<std::pair<std::string, std::string> > extra;
+           extra.push_back(std::make_pair(std::string(ATTR_HOST_LOAD_AVG),
+             systemInfo_.hostLoadAverage()));
+           heartbeat_.beat(state_ != WORKER_STATE_IDLE, extra);
          }
          catch(saga::exception const & e) {
            std::cout << "FAILED (" << e.get_error() << ")" << std::endl;
            throw;
          }
-         //(3) update execution status
-         std::cout << "SUCCESSFUL" << std::endl;
       }
       void cleanup_(void) {
       }
@@ -131,40 +253,52 @@ namespace AllPairs {
        * attributes describing this session.                   *
        * ******************************************************/
       void registerWithDB(void) {
-         int mode = saga::advert::ReadWrite;
          std::cout << "Registering with OrchestratorDB" << std::flush;
-         //(1) connect to the orchestrator database
-         std::string advertKey(database_ + "//" + sessionUUID_ + "/");
+         //(1) register with the orchestrator database.  The shared
+         //worker runtime performs the whole transaction: session
+         //directory, worker directory, system-info attribute bulk,
+         //and the master endpoint lookup
          try {
-            sessionBaseDir_ = saga::advert::directory(advertKey, mode);
-            advertKey  += ADVERT_DIR_WORKERS;
-            advertKey  += "/" + uuid_ + "/";
-            workerDir_ = saga::advert::directory(advertKey, mode | saga::advert::Create);
-            resultDir_ = workerDir_.open_dir(saga::url(ADVERT_DIR_RESULTS), mode | saga::advert::Create);
-
-            // add some initial system information
-            workerDir_.set_attribute(ATTR_CPU_COUNT, 
-              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().nCpu));
-            workerDir_.set_attribute(ATTR_CPU_TYPE, 
-              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuType));
-            workerDir_.set_attribute(ATTR_CPU_SUBTYPE, 
-              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuSubtype));
-            workerDir_.set_attribute(ATTR_CPU_FREQ, 
-              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuFrequency));
-            workerDir_.set_attribute(ATTR_MEM_TOTAL, 
-              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().totalMemory));
-            workerDir_.set_attribute(ATTR_HOST_NAME,     systemInfo_.hostName());
-            workerDir_.set_attribute(ATTR_HOST_TYPE,     systemInfo_.hostType());
-            workerDir_.set_attribute(ATTR_HOST_LOAD_AVG, systemInfo_.hostLoadAverage());
-
-            // set the last seen (keep alive) timestamp
             time_t timestamp; time(&timestamp);
-            workerDir_.set_attribute(ATTR_LAST_SEEN, boost::lexical_cast<std::string>(timestamp));
+            std::vector<std::pair<std::string, std::string> > attributes;
+            attributes.push_back(std::make_pair(std::string(ATTR_CPU_COUNT),
+              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().nCpu)));
+            attributes.push_back(std::make_pair(std::string(ATTR_CPU_TYPE),
+              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuType)));
+            attributes.push_back(std::make_pair(std::string(ATTR_CPU_SUBTYPE),
+              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuSubtype)));
+            attributes.push_back(std::make_pair(std::string(ATTR_CPU_FREQ),
+              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuFrequency)));
+            attributes.push_back(std::make_pair(std::string(ATTR_MEM_TOTAL),
+              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().totalMemory)));
+            attributes.push_back(std::make_pair(std::string(ATTR_HOST_NAME),
+              systemInfo_.hostName()));
+            attributes.push_back(std::make_pair(std::string(ATTR_HOST_TYPE),
+              systemInfo_.hostType()));
+            attributes.push_back(std::make_pair(std::string(ATTR_HOST_LOAD_AVG),
+              systemInfo_.hostLoadAverage()));
+            attributes.push_back(std::make_pair(std::string(ATTR_LAST_SEEN),
+              boost::lexical_cast<std::string>(timestamp)));
+            registry_.connect(database_, sessionUUID_, uuid_, attributes);
 
-            saga::advert::entry server_name(sessionBaseDir_.open(ADVERT_ENTRY_SERVER, mode));
-            std::cerr << "SERVER_URL about to get" << std::endl;
-            serverURL_ = saga::url(server_name.retrieve_string());
+            sessionBaseDir_ = registry_.session_dir();
+            workerDir_      = registry_.worker_dir();
+            resultDir_      = registry_.open_subdir(ADVERT_DIR_RESULTS);
+            heartbeat_.bind(workerDir_);
+
+            //(2) the command endpoint came with the registration
+            serverURL_ = registry_.server_url();
+            transport_.set_url(serverURL_);
             std::cerr << "SERVER_URL = " << serverURL_.get_string() << std::endl;
+
+            // benchmark mode: the master advertises a calibrated
+            // busy-loop cost, and the comparison implementation is
+            // expected to honour it (see benchCompareMillis)
+            if(sessionBaseDir_.attribute_exists(ATTR_BENCH_COMPARE_MS))
+            {
+               benchCompareMs_ = boost::lexical_cast<int>(
+                  sessionBaseDir_.get_attribute(ATTR_BENCH_COMPARE_MS));
+            }
          }
          catch(saga::exception const & e) {
             std::cout << "FAILED (" << e.get_error() << ")" << std::endl;
@@ -185,98 +319,43 @@ namespace AllPairs {
             if(command == WORKER_COMMAND_COMPARE) {
                std::cerr << "GOT COMMAND COMPARE!" << std::endl;
                state_ = WORKER_STATE_COMPARING;
-               std::string resultString;
-               //double val;
+               //Group the chunk into one tile per memory node,
+               //keyed by the home node of each pair's row input:
+               //the socket whose cache shard holds (or will hold)
+               //the base file runs its comparisons.  Workers
+               //overriding compareTile still see each input once
+               //per tile.
+               std::vector<ComparisonTile> tiles(numa_.nodeCount());
                while(runComparison_->hasAssignment()) {
                   assignment asn(runComparison_->getAssignment());
-                  std::cerr << "BUILDING ASSIGNMENT AND COMMAND" << std::endl;
-                  double val = compare(asn.first, asn.second);
-                  //Here is where the headache beings
-                  //run perl script with runs a worker to compare
-                  /*std::string command("/work/mmicel2/saga/saga-projects/applications/AllPairs/samples/runner.pl");
-                  command += " -u " + saga::uuid().string();
-                  saga::url firstURL(asn.first);
-                  saga::url secondURL(asn.second);
-                  if(firstURL.get_scheme() == "gridftp")
-                  {
-                     if(location_ != firstURL.get_host())
-                     {
-                        //requires staging
-                        firstURL.set_scheme("gsiftp");
-                        command += " -y " + firstURL.get_string();
-                        firstURL.set_scheme("file");
-                        firstURL.set_host("localhost");
-                        command += ' ' + firstURL.get_string();
-                     }
-                     else
-                     {
-                        firstURL.set_scheme("file");
-                        firstURL.set_host("localhost");
-                        command += " -n " + firstURL.get_string();
-                     }
-                  }
-                  else if(firstURL.get_scheme() != "file")
-                  {
-                     //requires staging
-                     command += " -y " + asn.first;
-                     firstURL.set_scheme("file");
-                     firstURL.set_host("localhost");
-                     command += ' ' + firstURL.get_string();
-                  }
-                  else
-                  {
-                     //requires no staging
-                     command += " -n " + asn.first;
-                  }
-                  if(secondURL.get_scheme() == "gridftp")
-                  {
-                     if(location_ != secondURL.get_host())
-                     {
-                        //requires staging
-                        secondURL.set_scheme("gsiftp");
-                        command += " -y " + secondURL.get_string();
-                        secondURL.set_scheme("file");
-                        secondURL.set_host("localhost");
-                        command += ' ' + secondURL.get_string();
-                     }
-                     else
-                     {
-                        secondURL.set_scheme("file");
-                        secondURL.set_host("localhost");
-                        command += " -n " + secondURL.get_string();
-                     }
-                  }
-                  else if(secondURL.get_scheme() != "file")
-                  {
-                     //requires staging
-                     command += " -y " + asn.second;
-                     secondURL.set_scheme("file");
-                     secondURL.set_host("localhost");
-                     command += ' ' + secondURL.get_string();
+                  tiles[numa_.homeNode(asn.first)].addPair(asn.first,
+                                                           asn.second);
+               }
+               compareTiles_(tiles);
+               //Every pair's value goes into the local binary
+               //segment; the segment location is advertised once
+               //per chunk instead of one advert write per pair
+               ResultSegmentWriter segment(segmentPath_());
+               for(std::vector<ComparisonTile>::size_type node = 0;
+                   node < tiles.size(); node++) {
+                  ComparisonTile &tile = tiles[node];
+                  for(unsigned int pair = 0; pair < tile.pairCount(); ++pair) {
+                     segment.append(tile.pairFrom(pair), tile.pairTo(pair),
+                                    tile.value(pair));
                   }
-                  else
-                  {
-                     //requires no staging
-                     command += " -n " + asn.second;
-                  }*/
-                  saga::url result(std::string("result-") + boost::lexical_cast<std::string>(runComparison_->getChunkID()));
-                  saga::advert::entry fin_adv(resultDir_.open(result, mode | saga::advert::Create));
-                  command += " -a " + fin_adv.get_url().get_string();
-                  /*std::cerr << "ABOUT TO RUN PERL COMMAND: " << command << std::endl;
-                  FILE *job = popen(command.c_str(), "r");
-                  std::cerr << "WAITING FOR JOB TO FINISH NOW!" << std::endl;
-                  pclose(job);*/
-                  std::cout << "first: " << asn.first << std::endl;
-                  resultString += "(" + asn.first;
-                  std::cout << "second: " << asn.second << std::endl;
-                  resultString += + ", " + asn.second + "): ";
-                  std::cout << "value: " << boost::lexical_cast<std::string>(&val) << std::endl;
-                  resultString += boost::lexical_cast<std::string>(&val) + '\n';
                }
+               segment.flush();
                lastFinishedChunk_ = runComparison_->getChunkID();
                std::cout << "chunkId: " << runComparison_->getChunkID();
                delete runComparison_;
-               //fin_adv.store_string(boost::lexical_cast<std::string>(resultString));
+               try {
+                  saga::advert::entry seg(resultDir_.open(saga::url("segment"),
+                                                          mode | saga::advert::Create));
+                  seg.store_string(location_ + "|" + segment.path());
+               }
+               catch(saga::exception const & e) {
+                  logWriter_->write(std::string(e.what()), LOGLEVEL_ERROR);
+               }
                state_ = WORKER_STATE_DONE;
             }
             else if(command == WORKER_COMMAND_QUIT) {
@@ -296,103 +375,103 @@ namespace AllPairs {
        * ******************************************************/
       std::string getFrontendCommand_(void) {
          static int depth = 0;
-         std::string read;
          try {
-            saga::stream::stream server_(serverURL_);
-            server_.connect();
-            read = network::read(server_);
-            if(network::test(read, MASTER_QUESTION_STATE))
+            //The master expects one conversation per accepted
+            //connection, so each poll gets a fresh stream; the
+            //transport connects it with exponential backoff
+            saga::stream::stream server_ = transport_.fresh();
+            wire::receiver rx;
+            if(!rx.recv(server_))
             {
-               std::string state(state_);
-               server_.write(saga::buffer(state, state.size()));
-               read = network::read(server_);
-               if(network::test(read, MASTER_QUESTION_LOCATION))
+               APPLICATION_ABORT;
+            }
+            if(rx.type() == MSG_QUESTION_STATE)
+            {
+               wire::send(server_, MSG_STATE, state_);
+               if(!rx.recv(server_))
                {
-                  server_.write(saga::buffer(location_, location_.size()));
-                  read = network::read(server_);
-                  if(network::test(read, MASTER_QUESTION_ADVERT))
+                  APPLICATION_ABORT;
+               }
+               if(rx.type() == MSG_QUESTION_LOCATION)
+               {
+                  wire::send(server_, MSG_LOCATION, location_);
+                  if(!rx.recv(server_))
+                  {
+                     APPLICATION_ABORT;
+                  }
+                  if(rx.type() == MSG_QUESTION_ADVERT)
                   {
                      std::string advert(workerDir_.get_url().get_string());
-                     server_.write(saga::buffer(advert, advert.size()));
-                     read = network::read(server_);
-                     if(network::test(read, WORKER_COMMAND_COMPARE))
+                     wire::send(server_, MSG_ADVERT, advert);
+                     if(!rx.recv(server_))
+                     {
+                        APPLICATION_ABORT;
+                     }
+                     if(rx.type() == MSG_ASSIGN_COMPARE)
                      {
-                        server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-                        runComparison_ = new RunComparison(server_, logWriter_);
+                        //The whole chunk is already in this frame;
+                        //unpack it and ack the assignment as a whole
+                        runComparison_ = new RunComparison(rx, logWriter_);
+                        wire::send(server_, MSG_ACKNOLEDGE);
                         return WORKER_COMMAND_COMPARE;
                      }
-                     else if(network::test(read, WORKER_COMMAND_QUIT))
+                     else if(rx.type() == MSG_QUIT)
                      {
                         return WORKER_COMMAND_QUIT;
                      }
                   }
-                  else if(network::test(read, WORKER_COMMAND_STAGE)) 
+                  else if(rx.type() == MSG_ASSIGN_STAGE)
                   {
-                     server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-                     read = network::read(server_);
-                     if(network::test(read, START_CHUNK)) {
-                        std::vector<std::string> hosts;
-                        //Get lists of hosts to ping
-                        server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-                        read = network::read(server_);
-                        while(network::test(read, END_CHUNK) == false) {
-                           server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-                           //push_back hosts read
-                           hosts.push_back(read);
-                           //Call handleStaging
-                           read = network::read(server_);
-                        }
-                        server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-                        RunStaging runStaging(hosts, location_, logWriter_);
-                        stageResult_ = runStaging.getResults();
-                        state_ = WORKER_STATE_DONE_STAGING;
-                        return getFrontendCommand_();
+                     //One part per host to ping
+                     std::vector<std::string> hosts;
+                     for(std::size_t part = 0; part < rx.parts(); ++part) {
+                        hosts.push_back(rx.part(part));
                      }
+                     wire::send(server_, MSG_ACKNOLEDGE);
+                     RunStaging runStaging(hosts, location_, logWriter_);
+                     stageResult_ = runStaging.getResults();
+                     state_ = WORKER_STATE_DONE_STAGING;
+                     return getFrontendCommand_();
                   }
-                  else if(network::test(read, MASTER_REQUEST_IDLE))
+                  else if(rx.type() == MSG_REQUEST_IDLE)
                   {
                      state_ = WORKER_STATE_IDLE;
-                     server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
+                     wire::send(server_, MSG_ACKNOLEDGE);
                      sleep(5);
                      return getFrontendCommand_();
                   }
-                  else if(network::test(read, START_CHUNK)) {
-                     //our state is WORKER_STATE_DONE_STAGING
-                     server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
+                  else if(rx.type() == MSG_QUESTION_RESULT) {
+                     //our state is WORKER_STATE_DONE_STAGING: all
+                     //measurements go back as the parts of one frame
+                     wire::message results(MSG_RESULT);
                      for(std::vector<double>::iterator it = stageResult_.begin();
                          it != stageResult_.end(); ++it)
                      {
-                        read = network::read(server_);
-                        if(network::test(read, MASTER_QUESTION_RESULT)) {
-                           std::string result(boost::lexical_cast<std::string>(*it));
-                           server_.write(saga::buffer(result, result.size()));
-                        }
+                        results.add(boost::lexical_cast<std::string>(*it));
                      }
-                     network::expect(END_CHUNK, network::read(server_));
-                     server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-                     network::expect(MASTER_REQUEST_IDLE, network::read(server_));
-                     server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
+                     results.send(server_);
+                     wire::expect(server_, rx, MSG_REQUEST_IDLE);
+                     wire::send(server_, MSG_ACKNOLEDGE);
                      state_ = WORKER_STATE_IDLE;
                      sleep(5);
                      return getFrontendCommand_();
                   }
                }
-               else if(network::test(read, MASTER_QUESTION_RESULT))
+               else if(rx.type() == MSG_QUESTION_RESULT)
                {
                   std::string lastString = boost::lexical_cast<std::string>(lastFinishedChunk_);
-                  server_.write(saga::buffer(lastString, lastString.size()));
-                  read = network::read(server_);
-                  if(network::test(read, MASTER_REQUEST_IDLE))
+                  wire::send(server_, MSG_RESULT, lastString);
+                  if(rx.recv(server_) && rx.type() == MSG_REQUEST_IDLE)
                   {
                      std::cerr << "SETTING STATE TO IDLE AFTER DONE!" << std::endl;
                      state_ = WORKER_STATE_IDLE;
                   }
                   return getFrontendCommand_();
                }
-               if(network::test(read, MASTER_REQUEST_IDLE))
+               if(rx.type() == MSG_REQUEST_IDLE)
                {
                   state_ = WORKER_STATE_IDLE;
-                  server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
+                  wire::send(server_, MSG_ACKNOLEDGE);
                   return getFrontendCommand_();
                }
                else
@@ -400,13 +479,13 @@ namespace AllPairs {
                   APPLICATION_ABORT;
                }
             }
-            else if(network::test(read, WORKER_COMMAND_QUIT))
+            else if(rx.type() == MSG_QUIT)
             {
-               server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
+               wire::send(server_, MSG_ACKNOLEDGE);
                return WORKER_COMMAND_QUIT;
             }
          }
-         catch(network::networkException const &e) {
+         catch(wire::error const &e) {
             std::cout << "Error: " << e.what() << std::endl;
             APPLICATION_ABORT;
          }
@@ -419,8 +498,8 @@ namespace AllPairs {
             }
             return getFrontendCommand_();
          }
-         // get command number & reset the attribute to "" 
-         return read;
+         // get command number & reset the attribute to ""
+         return std::string("");
       }
    };
 }
@@ -0,0 +1,83 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef AP_COMPARISON_TILE_HPP
+#define AP_COMPARISON_TILE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace AllPairs {
+   /*********************************************************
+   * ComparisonTile groups one chunk's assignments into a  *
+   * rows x columns tile.  rows() and cols() list each     *
+   * distinct input once, so a block-compare kernel can    *
+   * load every base vector a single time and then work    *
+   * cache-blocked (and vectorized) across the whole tile  *
+   * instead of re-reading inputs pair by pair.            *
+   * ******************************************************/
+   class ComparisonTile {
+     public:
+      void addPair(const std::string &from, const std::string &to) {
+         pairs_.push_back(std::pair<int, int>(rowIndex_(from), colIndex_(to)));
+         values_.push_back(0);
+      }
+      const std::vector<std::string> &rows(void) const {
+         return rows_;
+      }
+      const std::vector<std::string> &cols(void) const {
+         return cols_;
+      }
+      unsigned int pairCount(void) const {
+         return pairs_.size();
+      }
+      int pairRow(unsigned int pair) const {
+         return pairs_[pair].first;
+      }
+      int pairCol(unsigned int pair) const {
+         return pairs_[pair].second;
+      }
+      const std::string &pairFrom(unsigned int pair) const {
+         return rows_[pairs_[pair].first];
+      }
+      const std::string &pairTo(unsigned int pair) const {
+         return cols_[pairs_[pair].second];
+      }
+      void setValue(unsigned int pair, double value) {
+         values_[pair] = value;
+      }
+      double value(unsigned int pair) const {
+         return values_[pair];
+      }
+     private:
+      int rowIndex_(const std::string &from) {
+         std::map<std::string, int>::iterator it = rowOf_.find(from);
+         if(it != rowOf_.end()) {
+            return it->second;
+         }
+         rows_.push_back(from);
+         rowOf_[from] = rows_.size() - 1;
+         return rows_.size() - 1;
+      }
+      int colIndex_(const std::string &to) {
+         std::map<std::string, int>::iterator it = colOf_.find(to);
+         if(it != colOf_.end()) {
+            return it->second;
+         }
+         cols_.push_back(to);
+         colOf_[to] = cols_.size() - 1;
+         return cols_.size() - 1;
+      }
+      std::vector<std::string> rows_;
+      std::vector<std::string> cols_;
+      std::map<std::string, int> rowOf_;
+      std::map<std::string, int> colOf_;
+      std::vector<std::pair<int, int> > pairs_;
+      std::vector<double> values_;
+   }; // class ComparisonTile
+} // namespace AllPairs
+
+#endif // AP_COMPARISON_TILE_HPP
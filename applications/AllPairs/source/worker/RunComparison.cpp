@@ -4,61 +4,24 @@
 namespace AllPairs {
 
 /*********************************************************
- * RunComparison constructor sets up the state and other info   *
- * for the worker.                                       *
+ * RunComparison constructor unpacks one MSG_ASSIGN_COMPARE    *
+ * frame: part 0 is the chunk id, then one to/from pair  *
+ * of urls per assignment.  The whole chunk arrived in a *
+ * single message, so there is no further wire I/O here. *
  * ******************************************************/
-   RunComparison::RunComparison(saga::stream::stream server, LogWriter *log) :
-      server_(server) , log_(log)
+   RunComparison::RunComparison(const wire::receiver &frame, LogWriter *log) :
+      log_(log)
    {
-      char buff[255];
-
-      saga::ssize_t read_bytes = server_.read(saga::buffer(buff));
-      std::string question(buff, read_bytes);
-      if(question == START_CHUNK)
+      chunkID_ = boost::lexical_cast<int>(frame.part(0));
+      std::cerr << "Got ID: " << chunkID_ << std::endl;
+      for(std::size_t part = 1; part + 1 < frame.parts(); part += 2)
       {
-         server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-         memset(buff, 0, 255);
-         read_bytes = server_.read(saga::buffer(buff));
-         std::string communication(buff, read_bytes);
-         //The first try is always ID
-         chunkID_ = boost::lexical_cast<int>(communication);
-         std::cerr<< "Got ID: " << communication << std::endl;
-         server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-
-         while(1)
-         {
-            std::string communication;
-
-            memset(buff, 0, 255);
-            read_bytes = server_.read(saga::buffer(buff));
-            communication = std::string(buff, read_bytes);
-            std::cerr << "just read as part of assignment: " << communication << std::endl;
-            if(communication == END_CHUNK)
-            {
-               break;
-            }
-            std::string url1(communication);
-            server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-            
-            memset(buff, 0, 255);
-            read_bytes = server_.read(saga::buffer(buff));
-            communication = std::string(buff, read_bytes);
-            std::string url2(communication);
-            server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-
-            std::cout << "got (" << url1 << ", " << url2 << ")" << std::endl;
-            chunk_.push_back(std::pair<std::string, std::string>(url1, url2));
-         }
-         //Ack end chunk
-         server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-         chunk_IT = chunk_.begin();
+         std::string url1(frame.part(part));
+         std::string url2(frame.part(part + 1));
+         std::cout << "got (" << url1 << ", " << url2 << ")" << std::endl;
+         chunk_.push_back(std::pair<std::string, std::string>(url1, url2));
       }
-      else
-      {
-         std::cerr << "Misbehaving master?" << std::endl;
-         //FIXME proper handling here
-     }
-
+      chunk_IT = chunk_.begin();
    }
 /*********************************************************
  * ~RunComparison destructor returns the state of the worker to *
@@ -91,5 +54,4 @@ namespace AllPairs {
    int RunComparison::getChunkID() {
       return chunkID_;
    }
-} // namespace AllPairs 
-
+} // namespace AllPairs
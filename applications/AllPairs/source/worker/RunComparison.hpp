@@ -1,6 +1,6 @@
 //  Copyright (c) 2008 Michael Miceli and Christopher Miceli
-// 
-//  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
 #ifndef AP_RUN_COMPARISON_HPP
@@ -11,6 +11,7 @@
 #include <saga/saga.hpp>
 #include <boost/lexical_cast.hpp>
 #include "../utils/LogWriter.hpp"
+#include "../../../common/wire.hpp"
 #include "version.hpp"
 
 namespace AllPairs {
@@ -19,7 +20,7 @@ namespace AllPairs {
    typedef std::vector<assignmentChunk> assignmentChunksVector;
    class RunComparison {
      public:
-      RunComparison(saga::stream::stream server, AllPairs::LogWriter *log);
+      RunComparison(const wire::receiver &frame, AllPairs::LogWriter *log);
       ~RunComparison();
       assignment getAssignment();
       assignmentChunk getAssignmentChunk();
@@ -30,11 +31,9 @@ namespace AllPairs {
       assignmentChunk::iterator chunk_IT;
       assignmentChunk           chunk_;
       int                       chunkID_;
-      saga::stream::stream      server_;
 
       AllPairs::LogWriter *log_;
    }; // class RunComparison
 } // namespace AllPairs
 
 #endif // MR_RUN_COMPARISON_HPP
-
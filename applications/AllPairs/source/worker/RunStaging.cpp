@@ -17,6 +17,28 @@ namespace AllPairs {
    RunStaging::~RunStaging() {
    }
 
+/*********************************************************
+ * stageFiles pulls the given inputs to targetDir with a *
+ * FileStager pool, so warm-up transfers run N at a time *
+ * with striped reads for big files instead of one       *
+ * single-stream copy after another.                     *
+ * ******************************************************/
+   int RunStaging::stageFiles(const std::vector<saga::url> &files,
+                              const std::string &targetDir,
+                              int concurrency) {
+      FileStager stager(concurrency, log_);
+      for(std::vector<saga::url>::const_iterator it = files.begin();
+          it != files.end(); ++it)
+      {
+         std::string path(it->get_path());
+         std::string::size_type slash = path.find_last_of('/');
+         std::string base(slash == std::string::npos
+                           ? path : path.substr(slash + 1));
+         stager.add(*it, targetDir + "/" + base);
+      }
+      return stager.run();
+   }
+
    std::vector<double> RunStaging::getResults() {
       std::vector<double> retval;
       for(std::vector<std::string>::const_iterator it = hosts_.begin();
@@ -8,6 +8,7 @@
 
 #include <saga/saga.hpp>
 #include "../utils/LogWriter.hpp"
+#include "../utils/FileStager.hpp"
 
 namespace AllPairs {
    class RunStaging {
@@ -15,6 +16,11 @@ namespace AllPairs {
       RunStaging(const std::vector<std::string> &hosts,
                  const std::string &location, AllPairs::LogWriter *log);
       std::vector<double> getResults();
+      //Prefetch input files to targetDir with a pool of parallel
+      //transfers; returns the number of failed transfers
+      int stageFiles(const std::vector<saga::url> &files,
+                     const std::string &targetDir,
+                     int concurrency = STAGING_CONCURRENCY);
       ~RunStaging();
 
      private:
@@ -7,23 +7,91 @@
 //#include "../utils/type.hpp"
 //#include <fstream>
 #include <unistd.h>
+#include <sys/time.h>
 //#include <wand/MagickWand.h>
 
 
  using namespace std;
  using namespace AllPairs;
- 
+
+/*********************************************************
+ * Benchmark support (master --benchmark): a calibrated  *
+ * busy loop stands in for the real comparison, and the  *
+ * worker keeps running totals of staging bandwidth and  *
+ * comparison rate so a slow run can be localized to     *
+ * staging, dispatch or compute.                         *
+ * ******************************************************/
+namespace {
+   double benchNow(void) {
+      struct timeval tv;
+      ::gettimeofday(&tv, NULL);
+      return tv.tv_sec + tv.tv_usec / 1000000.0;
+   }
+   //calibrated once per process: how many loop iterations
+   //burn one millisecond on this machine
+   long benchLoopsPerMs(void) {
+      static long loopsPerMs = 0;
+      if(loopsPerMs == 0) {
+         volatile double sink = 1.0;
+         const long probe = 10000000;
+         double t0 = benchNow();
+         for(long i = 0; i < probe; i++) {
+            sink = sink * 1.0000001 + 0.0000001;
+         }
+         double elapsed = benchNow() - t0;
+         loopsPerMs = (long)(probe / (elapsed * 1000.0));
+         if(loopsPerMs < 1) loopsPerMs = 1;
+      }
+      return loopsPerMs;
+   }
+   void benchSpin(int ms) {
+      volatile double sink = 1.0;
+      long loops = benchLoopsPerMs() * ms;
+      for(long i = 0; i < loops; i++) {
+         sink = sink * 1.0000001 + 0.0000001;
+      }
+   }
+   double benchStageBytes = 0, benchStageSecs = 0, benchCompareSecs = 0;
+   long   benchCompares = 0;
+}
+
  class AllPairsImpl : public AllPairsBase<AllPairsImpl> {
    public:
     AllPairsImpl(int argCount, char **argList)
       : AllPairsBase<AllPairsImpl>(argCount, argList) {
     }
+    /*********************************************************
+     * benchCompare stages both inputs through the regular   *
+     * file cache (timed, for the staging bandwidth number)  *
+     * and burns the advertised busy-loop cost; a summary    *
+     * line goes to stdout every 25 comparisons.             *
+     * ******************************************************/
+    double benchCompare(saga::url testUrl, saga::url baseUrl) {
+      double t0 = benchNow();
+      AllPairs::FileCache::content test(this->fileCache().get(testUrl));
+      AllPairs::FileCache::content base(this->fileCache().get(baseUrl));
+      double t1 = benchNow();
+      benchStageBytes += test->size() + base->size();
+      benchStageSecs  += t1 - t0;
+      benchSpin(this->benchCompareMillis());
+      benchCompareSecs += benchNow() - t1;
+      benchCompares++;
+      if(benchCompares % 25 == 0) {
+         std::cout << "benchmark: " << benchCompares << " comparisons, staging "
+                   << (benchStageSecs > 0 ? benchStageBytes / benchStageSecs / (1024*1024) : 0)
+                   << " MB/s, comparison rate "
+                   << (benchCompareSecs > 0 ? benchCompares / benchCompareSecs : 0)
+                   << "/s" << std::endl;
+      }
+      return benchCompares;
+    }
     double compare(saga::url testUrl, saga::url baseUrl) {
+      if(this->benchCompareMillis() > 0) {
+         return benchCompare(testUrl, baseUrl);
+      }
       std::cerr << "two strings are " << std::endl;
       std::cerr << testUrl.get_string() << std::endl;
       std::cerr << baseUrl.get_string() << std::endl;
-      saga::size_t const n = 1024*64;
-      saga::uint8_t data[n+1];
       if(testUrl.get_scheme().compare("gridftp") == 0)
       {
          std::cout << "Reading " << testUrl.get_string() << "!" << std::endl;
@@ -39,21 +107,13 @@
       }
       else
       {
-         saga::filesystem::file f (testUrl, saga::filesystem::Read);
-         saga::filesystem::file g (baseUrl, saga::filesystem::Read);
          try {
-            std::cout << "Reading " << baseUrl.get_string() << "!" << std::endl;
-            while (true) {
-               std::memset(data, n+1, '\0');
-               // read a chunk into the buffer
-               if ( f.read (saga::buffer (data, n), n) ) {
-                  //std::cout << data;
-               }
-               else {
-                  break;
-               }
-            }
-            std::cout << "Read " << testUrl.get_string() << "!" << std::endl;
+            std::cout << "Reading " << testUrl.get_string() << "!" << std::endl;
+            // The worker-resident cache only hits the filesystem when the
+            // file was not seen by a recent chunk
+            AllPairs::FileCache::content data(this->fileCache().get(testUrl));
+            std::cout << "Read " << testUrl.get_string() << " ("
+                      << data->size() << " bytes)!" << std::endl;
          }
          catch (saga::exception const& e) {
             std::cerr << "Saga:  exception caught: " << e.what() << std::endl;
@@ -83,21 +143,11 @@
       }
       else
       {
-         saga::filesystem::file f (testUrl, saga::filesystem::Read);
-         saga::filesystem::file g (baseUrl, saga::filesystem::Read);
          try {
             std::cout << "Reading " << baseUrl.get_string() << "!" << std::endl;
-            while (true) {
-               std::memset(data, n+1, '\0');
-               // read a chunk into the buffer
-               if ( g.read (saga::buffer (data, n), n) ) {
-                   //std::cout << data;
-               }
-               else {
-                   break;
-               }
-            }
-            std::cout << "Read " << baseUrl.get_string() << "!" << std::endl;
+            AllPairs::FileCache::content data(this->fileCache().get(baseUrl));
+            std::cout << "Read " << baseUrl.get_string() << " ("
+                      << data->size() << " bytes)!" << std::endl;
          }
          catch (saga::exception const& e) {
             std::cerr << "Saga:  exception caught: " << e.what() << std::endl;
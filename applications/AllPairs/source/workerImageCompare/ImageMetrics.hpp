@@ -0,0 +1,256 @@
+ //  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+ //
+ //  Distributed under the Boost Software License, Version 1.0. (See accompanying
+ //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef AP_IMAGEMETRICS_HPP
+#define AP_IMAGEMETRICS_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace AllPairs {
+namespace metrics {
+
+/*********************************************************
+ * Vectorized image distance kernels for the image       *
+ * compare worker.  The metrics run over planar          *
+ * grayscale buffers (8 bit for SAD/SSD, float for NCC)  *
+ * instead of per-pixel wand calls.  On x86 with SSE2    *
+ * available the kernels process 16 bytes (or 4 floats)  *
+ * per step; the scalar fallbacks keep non-x86 builds    *
+ * working.  Which path runs is decided once at runtime, *
+ * not per call.                                         *
+ *                                                       *
+ * All kernels accumulate in fixed-size blocks and flush *
+ * into wide (64 bit / double) accumulators between      *
+ * blocks, so neither the SSE lanes nor the float sums   *
+ * can overflow or drift on large images.                *
+ * ******************************************************/
+
+   // decoded grayscale image as the kernels want it
+   struct Image {
+      unsigned long rows;
+      unsigned long cols;
+      std::vector<unsigned char> gray8;
+      std::vector<float>         grayf;
+
+      Image() : rows(0), cols(0) {}
+   };
+
+   enum metric_t {
+      SAD = 0,   // mean absolute pixel difference
+      SSD = 1,   // mean squared pixel difference
+      NCC = 2    // normalized cross correlation, in [-1, 1]
+   };
+
+   inline metric_t metric_from_name(const char *name) {
+      if(NULL == name)                 return SAD;
+      if(0 == ::strcmp(name, "SSD"))   return SSD;
+      if(0 == ::strcmp(name, "NCC"))   return NCC;
+      return SAD;
+   }
+
+   // true if the SSE2 kernels can run on this cpu (decided once)
+   inline bool cpu_has_sse2() {
+#if !defined(__SSE2__)
+      return false;
+#elif defined(__x86_64__)
+      return true;   // SSE2 is part of the base x86-64 ISA
+#else
+      unsigned int eax, ebx, ecx, edx;
+      __asm__ __volatile__("cpuid"
+                           : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+                           : "a"(1));
+      return 0 != (edx & (1u << 26));
+#endif
+   }
+
+   namespace detail {
+
+      // pixels per accumulator flush - also the streaming block size
+      std::size_t const BLOCK = 65536;
+
+      inline double sad8_scalar(const unsigned char *a,
+                                const unsigned char *b, std::size_t n) {
+         unsigned long long total = 0;
+         for(std::size_t i = 0; i < n; ++i) {
+            int d = (int)a[i] - (int)b[i];
+            total += (unsigned long long)((d < 0) ? -d : d);
+         }
+         return (double)total;
+      }
+
+      inline double ssd8_scalar(const unsigned char *a,
+                                const unsigned char *b, std::size_t n) {
+         unsigned long long total = 0;
+         for(std::size_t i = 0; i < n; ++i) {
+            int d = (int)a[i] - (int)b[i];
+            total += (unsigned long long)(d * d);
+         }
+         return (double)total;
+      }
+
+      inline double ncc_finish(double sa, double sb, double saa,
+                               double sbb, double sab, std::size_t n) {
+         double num   = (double)n * sab - sa * sb;
+         double denom = ((double)n * saa - sa * sa)
+                      * ((double)n * sbb - sb * sb);
+         if(denom <= 0.0) {
+            return 0.0;   // at least one flat image - correlation undefined
+         }
+         return num / std::sqrt(denom);
+      }
+
+      inline double ncc_scalar(const float *a, const float *b,
+                               std::size_t n) {
+         double sa = 0.0, sb = 0.0, saa = 0.0, sbb = 0.0, sab = 0.0;
+         for(std::size_t i = 0; i < n; ++i) {
+            double x = a[i], y = b[i];
+            sa += x; sb += y;
+            saa += x * x; sbb += y * y; sab += x * y;
+         }
+         return ncc_finish(sa, sb, saa, sbb, sab, n);
+      }
+
+#if defined(__SSE2__)
+      inline double sad8_sse2(const unsigned char *a,
+                              const unsigned char *b, std::size_t n) {
+         // _mm_sad_epu8 sums |a-b| of 16 bytes into two 16 bit values
+         // sitting in 64 bit lanes, so a 64 bit lane add never overflows
+         __m128i acc = _mm_setzero_si128();
+         std::size_t i = 0;
+         for(; i + 16 <= n; i += 16) {
+            __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+            __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+         }
+         unsigned long long lanes[2];
+         _mm_storeu_si128((__m128i *)lanes, acc);
+         unsigned long long total = lanes[0] + lanes[1];
+         for(; i < n; ++i) {
+            int d = (int)a[i] - (int)b[i];
+            total += (unsigned long long)((d < 0) ? -d : d);
+         }
+         return (double)total;
+      }
+
+      inline double ssd8_sse2(const unsigned char *a,
+                              const unsigned char *b, std::size_t n) {
+         __m128i const zero = _mm_setzero_si128();
+         unsigned long long total = 0;
+         std::size_t i = 0;
+         while(i + 16 <= n) {
+            // one 16 pixel step adds at most 2 * 130050 per 32 bit
+            // lane, so a BLOCK of 65536 pixels stays well below 2^31
+            std::size_t steps = (n - i) / 16;
+            if(steps > BLOCK / 16) steps = BLOCK / 16;
+
+            __m128i acc = zero;
+            for(std::size_t s = 0; s < steps; ++s, i += 16) {
+               __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+               __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+               __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero),
+                                          _mm_unpacklo_epi8(vb, zero));
+               __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero),
+                                          _mm_unpackhi_epi8(vb, zero));
+               acc = _mm_add_epi32(acc, _mm_madd_epi16(lo, lo));
+               acc = _mm_add_epi32(acc, _mm_madd_epi16(hi, hi));
+            }
+            unsigned int lanes[4];
+            _mm_storeu_si128((__m128i *)lanes, acc);
+            total += (unsigned long long)lanes[0] + lanes[1]
+                   + lanes[2] + lanes[3];
+         }
+         for(; i < n; ++i) {
+            int d = (int)a[i] - (int)b[i];
+            total += (unsigned long long)(d * d);
+         }
+         return (double)total;
+      }
+
+      inline double ncc_sse2(const float *a, const float *b,
+                             std::size_t n) {
+         double sa = 0.0, sb = 0.0, saa = 0.0, sbb = 0.0, sab = 0.0;
+         std::size_t i = 0;
+         while(i + 4 <= n) {
+            // accumulate one block in float lanes, flush to doubles -
+            // float sums over whole images would lose precision
+            std::size_t steps = (n - i) / 4;
+            if(steps > BLOCK / 4) steps = BLOCK / 4;
+
+            __m128 vsa  = _mm_setzero_ps();
+            __m128 vsb  = _mm_setzero_ps();
+            __m128 vsaa = _mm_setzero_ps();
+            __m128 vsbb = _mm_setzero_ps();
+            __m128 vsab = _mm_setzero_ps();
+            for(std::size_t s = 0; s < steps; ++s, i += 4) {
+               __m128 va = _mm_loadu_ps(a + i);
+               __m128 vb = _mm_loadu_ps(b + i);
+               vsa  = _mm_add_ps(vsa,  va);
+               vsb  = _mm_add_ps(vsb,  vb);
+               vsaa = _mm_add_ps(vsaa, _mm_mul_ps(va, va));
+               vsbb = _mm_add_ps(vsbb, _mm_mul_ps(vb, vb));
+               vsab = _mm_add_ps(vsab, _mm_mul_ps(va, vb));
+            }
+            float lanes[4];
+            _mm_storeu_ps(lanes, vsa);
+            sa  += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            _mm_storeu_ps(lanes, vsb);
+            sb  += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            _mm_storeu_ps(lanes, vsaa);
+            saa += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            _mm_storeu_ps(lanes, vsbb);
+            sbb += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            _mm_storeu_ps(lanes, vsab);
+            sab += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+         }
+         for(; i < n; ++i) {
+            double x = a[i], y = b[i];
+            sa += x; sb += y;
+            saa += x * x; sbb += y * y; sab += x * y;
+         }
+         return ncc_finish(sa, sb, saa, sbb, sab, n);
+      }
+#endif // __SSE2__
+
+   } // namespace detail
+
+   // dispatching entry points - the cpu check runs once per process
+
+   inline double sad8(const unsigned char *a, const unsigned char *b,
+                      std::size_t n) {
+#if defined(__SSE2__)
+      static bool const simd = cpu_has_sse2();
+      if(simd) return detail::sad8_sse2(a, b, n);
+#endif
+      return detail::sad8_scalar(a, b, n);
+   }
+
+   inline double ssd8(const unsigned char *a, const unsigned char *b,
+                      std::size_t n) {
+#if defined(__SSE2__)
+      static bool const simd = cpu_has_sse2();
+      if(simd) return detail::ssd8_sse2(a, b, n);
+#endif
+      return detail::ssd8_scalar(a, b, n);
+   }
+
+   inline double ncc(const float *a, const float *b, std::size_t n) {
+#if defined(__SSE2__)
+      static bool const simd = cpu_has_sse2();
+      if(simd) return detail::ncc_sse2(a, b, n);
+#endif
+      return detail::ncc_scalar(a, b, n);
+   }
+
+} // namespace metrics
+} // namespace AllPairs
+
+#endif // AP_IMAGEMETRICS_HPP
@@ -4,124 +4,144 @@
  //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
  
 #include "AllPairsBase.hpp"
+#include "ImageMetrics.hpp"
 //#include "../utils/type.hpp"
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
+#include <unistd.h>
 #include <wand/MagickWand.h>
 
 
  using namespace std;
  using namespace AllPairs;
- 
+
  class AllPairsImpl : public AllPairsBase<AllPairsImpl> {
    public:
     AllPairsImpl(int argCount, char **argList)
-      : AllPairsBase<AllPairsImpl>(argCount, argList) {
+      : AllPairsBase<AllPairsImpl>(argCount, argList),
+        metric_(metrics::metric_from_name(::getenv("ALLPAIRS_IMAGE_METRIC"))) {
    }
    double compare(saga::url testUrl, saga::url baseUrl) {
-	   
-	   
-	   // Need to create tmp names, since I need ImageMagick to understand the names
-	   // therefore I need to copy the images to those files
-	   // If I can get imagemagick to read directly from the url, I woudn't waste
-	   // the time in copying files...  
-	   
-	   char *testName = mkdtemp("testImg.");
-	   char *baseName = mkdtemp("baseImg.");
-	   
-	   std::cerr << "About to open files (" << testName << ", " << baseName << ")" << std::endl;
-	   
-	   ofstream testFile(testName, ios::out);
-	   ofstream baseFile(baseName, ios::out);
-	   
-	   std::cerr << "Before copying the files... " << std::endl; 
-	   
-	   saga::size_t const KB64 = 1024*64; //64KB
-	   saga::size_t bytesRead;
-	   std::cerr << "about to open files (" << testUrl.get_string() << ", " << baseUrl.get_string() << ")" << std::endl;
-	   saga::filesystem::file test(testUrl, saga::filesystem::Read);
-	   std::cerr << "1opened!" << std::endl;
-	   saga::filesystem::file base    (baseUrl    , saga::filesystem::Read);
-	   std::cerr << "2opened!" << std::endl;
-	   
-	   char data[KB64+1];
-	   double minimum = -1.0;
-	   while((bytesRead = test.read(saga::buffer(data,KB64)))!=0) {
-		   testFile.write(data, bytesRead);
+
+	   // The master streams many candidates against the same base image,
+	   // so the base stays resident: staged and decoded once, re-fetched
+	   // only when the base url changes. Only the candidate image is
+	   // staged and decoded per pair.
+	   if(residentUrl_ != baseUrl.get_string()) {
+		   if(!fetchImage_(baseUrl, base_)) {
+			   return -1.0;
+		   }
+		   residentUrl_ = baseUrl.get_string();
+	   }
+
+	   metrics::Image test;
+	   if(!fetchImage_(testUrl, test)) {
+		   return -1.0;
 	   }
-	   while((bytesRead = base.read(saga::buffer(data,KB64)))!=0) {
-		   baseFile.write(data, bytesRead);
+
+	   if(test.rows != base_.rows || test.cols != base_.cols) {
+		   std::cerr << "Image dimensions differ (" << base_.cols << "x"
+		             << base_.rows << " vs. " << test.cols << "x"
+		             << test.rows << ")" << std::endl;
+		   return -1.0;
 	   }
-	   
-	   std::cerr << "Before closing files" << std::endl;
-	   
-	   // Need to close them before I can actually do something
-	   
-	   testFile.close();
-	   baseFile.close();
-	   
-	   std::cerr << "Just before Image magick" << std::endl;
-	   
-#define ThrowWandException(wand) \
-{ \
-char \
-*description; \
-\
-ExceptionType \
-severity; \
-\
-description=MagickGetException(wand,&severity); \
-(void) fprintf(stderr,"%s %s %lu %s\n",GetMagickModule(),description); \
-description=(char *) MagickRelinquishMemory(description); \
-exit(-1); \
-}
-	   
-	   MagickWand *magick_wand_1;
-	   MagickWand *magick_wand_2;
-	   MagickWand *compare_wand;
-	   double difference;
-	   MagickBooleanType status_1, status_2;
-	   
-	   MagickWandGenesis();
-	   magick_wand_1=NewMagickWand();
-	   status_1=MagickReadImage(magick_wand_1,baseName);
-	   if (status_1 == MagickFalse)
-		   ThrowWandException(magick_wand_1);
-	   
+
+	   std::size_t numPixels = test.gray8.size();
+	   if(0 == numPixels) {
+		   return -1.0;
+	   }
+
+	   // the kernels pick their SSE2 or scalar path at runtime, see
+	   // ImageMetrics.hpp
+	   switch(metric_) {
+		   case metrics::NCC:
+			   return metrics::ncc(&base_.grayf[0], &test.grayf[0], numPixels);
+		   case metrics::SSD:
+			   return metrics::ssd8(&base_.gray8[0], &test.gray8[0], numPixels)
+			          / (double)numPixels;
+		   case metrics::SAD:
+		   default:
+			   return metrics::sad8(&base_.gray8[0], &test.gray8[0], numPixels)
+			          / (double)numPixels;
+	   }
+   }
+  private:
+   // stages a remote image to a local temp file, decodes it into the
+   // planar grayscale buffers the metric kernels run on, and removes
+   // the temp file again
+   bool fetchImage_(saga::url url, metrics::Image &img) {
+
+	   char tmpName[] = "/tmp/apImageXXXXXX";
+	   int fd = ::mkstemp(tmpName);
+	   if(-1 == fd) {
+		   std::cerr << "Could not create temp file for "
+		             << url.get_string() << std::endl;
+		   return false;
+	   }
+	   ::close(fd);
+
+	   try {
+		   saga::size_t const KB64 = 1024*64; //64KB
+		   saga::size_t bytesRead;
+		   char data[KB64];
+
+		   saga::filesystem::file remote(url, saga::filesystem::Read);
+		   ofstream local(tmpName, ios::out | ios::binary);
+		   while((bytesRead = remote.read(saga::buffer(data,KB64)))!=0) {
+			   local.write(data, bytesRead);
+		   }
+		   local.close();
+	   }
+	   catch(saga::exception const &e) {
+		   std::cerr << "Could not stage " << url.get_string() << ": "
+		             << e.what() << std::endl;
+		   ::remove(tmpName);
+		   return false;
+	   }
+
+	   bool ok = false;
 	   MagickWandGenesis();
-	   magick_wand_2=NewMagickWand();
-	   status_2=MagickReadImage(magick_wand_2,testName);
-	   if (status_2 == MagickFalse)
-		   ThrowWandException(magick_wand_2);
-	   
-	   compare_wand = NewMagickWand();
-	   compare_wand=MagickCompareImages(magick_wand_1,magick_wand_2, AbsoluteErrorMetric, &difference);
-	   std::cerr << "Difference is: " << difference << std::endl;
-	   
-	   unsigned long rows, cols;
-	   cols = MagickGetImageWidth(compare_wand);
-	   rows = MagickGetImageHeight(compare_wand);
-	   std::cerr << "Size baseimage (rows,cols): " << rows << "x" << cols << std::endl;
-	   
-	   double numPixels;
-	   
-	   numPixels=1.0*rows*cols;
-	   std::cerr << "Total num pixels: " << numPixels << std::endl;
-	   
-	   double ImageDifferencePcnt;
-	   
-	   ImageDifferencePcnt = difference*100.0/numPixels;	   
-	   std::cerr << "Image differ in (%): " << ImageDifferencePcnt << std::endl;
-	   
-	   DestroyMagickWand(compare_wand);
-	   
-	   DestroyMagickWand(magick_wand_1);
-	   DestroyMagickWand(magick_wand_2);
+	   MagickWand *wand = NewMagickWand();
+
+	   if(MagickReadImage(wand, tmpName) != MagickFalse) {
+		   img.cols = MagickGetImageWidth(wand);
+		   img.rows = MagickGetImageHeight(wand);
+		   std::size_t numPixels = (std::size_t)img.rows * img.cols;
+
+		   // "I" extracts the grayscale intensity plane; the 8 bit
+		   // buffer feeds SAD/SSD, the float buffer feeds NCC
+		   img.gray8.resize(numPixels);
+		   img.grayf.resize(numPixels);
+		   if(numPixels > 0
+		      && MagickGetImagePixels(wand, 0, 0, img.cols, img.rows,
+		                              "I", CharPixel,
+		                              &img.gray8[0]) != MagickFalse
+		      && MagickGetImagePixels(wand, 0, 0, img.cols, img.rows,
+		                              "I", FloatPixel,
+		                              &img.grayf[0]) != MagickFalse) {
+			   ok = true;
+		   }
+	   }
+
+	   if(!ok) {
+		   ExceptionType severity;
+		   char *description = MagickGetException(wand, &severity);
+		   std::cerr << "Could not decode " << url.get_string() << ": "
+		             << description << std::endl;
+		   description = (char *)MagickRelinquishMemory(description);
+	   }
+
+	   DestroyMagickWand(wand);
 	   MagickWandTerminus();
-	   
-	   return minimum;
+	   ::remove(tmpName);
+
+	   return ok;
    }
-  private:
-   std::map<std::string,double> dna_distances;
+
+   metrics::metric_t metric_;
+   std::string       residentUrl_;
+   metrics::Image    base_;
 };
 
 /*********************************************************
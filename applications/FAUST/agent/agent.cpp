@@ -18,6 +18,8 @@
 
 #include <agent/monitor/monitor_group.hpp>
 
+#include "../../common/advert_bulk.hpp"
+
 
 
 using namespace saga;
@@ -51,7 +53,7 @@ namespace {
 //////////////////////////////////////////////////////////////////////////
 //
 app::app(std::string endpoint, std::string uuid)
-: endpoint_(endpoint), uuid_(uuid) 
+: endpoint_(endpoint), uuid_(uuid), notify_ok_(false)
 {
   // Initialize logwrite instance 
   std::string identifier("faust_agent ("+uuid_+")"); std::string msg("");
@@ -62,12 +64,23 @@ app::app(std::string endpoint, std::string uuid)
   try {
     int mode = advert::ReadWrite;
     saga::advert::directory base(endpoint_, mode);
-        
-    cmd_adv_  = base.open("CMD", mode);
-    args_adv_ = base.open("ARGS", mode);
-    desc_adv_ = base.open("RD", mode);
-    mon_adv_  = base.open("RM", mode);
-    
+
+    // open all protocol entries in one bulk instead of four serial
+    // round trips
+    std::vector<std::string> names;
+    names.push_back("CMD");
+    names.push_back("ARGS");
+    names.push_back("RD");
+    names.push_back("RM");
+
+    std::vector<saga::advert::entry> entries =
+      advert_bulk::open_entries(base, names, mode);
+
+    cmd_adv_  = entries[0];
+    args_adv_ = entries[1];
+    desc_adv_ = entries[2];
+    mon_adv_  = entries[3];
+
     //////////////////
     //
     description_.get_impl()->set_advert_entry(desc_adv_);
@@ -89,7 +102,29 @@ app::app(std::string endpoint, std::string uuid)
     log_sptr_->write(msg, LOGLEVEL_ERROR);
     throw faust::exception (msg, faust::NoSuccess);
   }
-  
+
+  // Set up the command wakeup channel: a stream server whose contact
+  // URL is published next to the CMD advert. The resource side pings
+  // it after posting a command, which lets run() block on the stream
+  // instead of polling the advert database every second. Failure is
+  // non-fatal - we just keep polling.
+  msg = "Setting up command wakeup channel";
+  try {
+    notify_srv_ = saga::stream::server();
+
+    int mode = advert::ReadWrite | advert::Create;
+    saga::advert::directory base(endpoint_, advert::ReadWrite);
+    saga::advert::entry notify_adv = base.open("NOTIFY", mode);
+    notify_adv.store_string(notify_srv_.get_url().get_url());
+
+    notify_ok_ = true;
+    msg += ". SUCCESS (" + notify_srv_.get_url().get_url() + ")";
+    log_sptr_->write(msg, LOGLEVEL_INFO);
+  }
+  catch(saga::exception const & e) {
+    msg += ". FAILED " + std::string(e.what()) + ". Falling back to polling.";
+    log_sptr_->write(msg, LOGLEVEL_WARNING);
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -117,66 +152,111 @@ app::~app()
 
 //////////////////////////////////////////////////////////////////////////
 //
-std::string app::recv_command(std::string & cmd, std::string & args)
+bool app::recv_commands(std::vector<faust::protocol::command> & commands)
 {
-  std::string cmd_adv_str("");
-  std::string args_adv_str("");
+  commands.clear();
   std::string msg("Checking if a new command is waiting");
   try {
-    cmd_adv_str = cmd_adv_.retrieve_string();
-    args_adv_str = args_adv_.retrieve_string();
-    
-    if(cmd_adv_str.length() >= 1) {
-      std::vector<std::string> tokens;
-      ::tokenize(cmd_adv_str, tokens, ":");
-      
-      if(tokens.at(0) == "ACK") { 
+    // one retrieve per poll: a V2 frame carries uuid, commands and
+    // arguments in the CMD entry alone - ARGS is only touched on the
+    // legacy text path below.
+    std::string cmd_adv_str = cmd_adv_.retrieve_string();
+
+    if(cmd_adv_str.length() < 1) {
+      msg += ". NO";
+      log_sptr_->write(msg, LOGLEVEL_INFO);
+      return false;
+    }
+
+    faust::protocol::frame f;
+    if(faust::protocol::decode(cmd_adv_str, f))
+    {
+      if(f.type != faust::protocol::command_frame) {
+        // the reply frame we wrote ourselves is still in the entry
         msg += ". NO";
         log_sptr_->write(msg, LOGLEVEL_INFO);
+        return false;
       }
-      else {
-        msg += ". YES: CMD='"+cmd_adv_str+"' ARGS='"+args_adv_str+"'";
+
+      if(f.uuid != uuid_)
+      {
+        // IF UUID doesn't match, I'm definitely a ZOMBIE agent and
+        // I should really kill myself!
+        msg = "UUID of received command frame is INVALID. TERMINATING!";
+        log_sptr_->write(msg, LOGLEVEL_ERROR);
+        throw faust::exception (msg, faust::NoSuccess);
+      }
+
+      msg += ". YES:";
+      for(std::size_t i = 0; i < f.commands.size(); ++i) {
+        msg += " CMD='"+f.commands[i].name+"'";
+      }
+      log_sptr_->write(msg, LOGLEVEL_INFO);
+
+      msg = "Sending acknowledgement frame";
+      try {
+        cmd_adv_.store_string(
+          faust::protocol::encode(faust::protocol::make_reply(f)));
+
+        msg += ". SUCCESS ";
         log_sptr_->write(msg, LOGLEVEL_INFO);
-        
-        if(tokens.at(0) != uuid_) 
-        {
-          // IF UUID doesn't match, I'm definitely a ZOMBIE agent and 
-          // I should really kill myself!
-          msg = "UUID of received command "+cmd_adv_str+" is INVALID. TERMINATING!";
-          log_sptr_->write(msg, LOGLEVEL_ERROR);
-          throw faust::exception (msg, faust::NoSuccess);
-        }
-        else {
-          msg = "Sending acknowledgement for command '"+cmd_adv_str+"'";
-          try {
-            cmd_adv_.store_string("ACK:"+cmd_adv_str);
-            
-            msg += ". SUCCESS ";
-            log_sptr_->write(msg, LOGLEVEL_INFO);
-          }
-          catch(saga::exception const & e) {
-            msg += " FAILED " + std::string(e.what());
-            log_sptr_->write(msg, LOGLEVEL_ERROR);
-            throw faust::exception (msg, faust::NoSuccess);
-          }  
-        }
       }
+      catch(saga::exception const & e) {
+        msg += " FAILED " + std::string(e.what());
+        log_sptr_->write(msg, LOGLEVEL_ERROR);
+        throw faust::exception (msg, faust::NoSuccess);
+      }
+
+      commands = f.commands;
+      return true;
     }
-    else {
+
+    // legacy V1 text path: "uuid:CMD" in the CMD entry, arguments in
+    // the separate ARGS entry
+    std::vector<std::string> tokens;
+    ::tokenize(cmd_adv_str, tokens, ":");
+
+    if(tokens.at(0) == "ACK" || tokens.size() < 2) {
       msg += ". NO";
       log_sptr_->write(msg, LOGLEVEL_INFO);
+      return false;
     }
+
+    std::string args_adv_str = args_adv_.retrieve_string();
+
+    msg += ". YES: CMD='"+cmd_adv_str+"' ARGS='"+args_adv_str+"'";
+    log_sptr_->write(msg, LOGLEVEL_INFO);
+
+    if(tokens.at(0) != uuid_)
+    {
+      // IF UUID doesn't match, I'm definitely a ZOMBIE agent and
+      // I should really kill myself!
+      msg = "UUID of received command "+cmd_adv_str+" is INVALID. TERMINATING!";
+      log_sptr_->write(msg, LOGLEVEL_ERROR);
+      throw faust::exception (msg, faust::NoSuccess);
+    }
+
+    msg = "Sending acknowledgement for command '"+cmd_adv_str+"'";
+    try {
+      cmd_adv_.store_string("ACK:"+cmd_adv_str);
+
+      msg += ". SUCCESS ";
+      log_sptr_->write(msg, LOGLEVEL_INFO);
+    }
+    catch(saga::exception const & e) {
+      msg += " FAILED " + std::string(e.what());
+      log_sptr_->write(msg, LOGLEVEL_ERROR);
+      throw faust::exception (msg, faust::NoSuccess);
+    }
+
+    commands.push_back(faust::protocol::command(tokens.at(1), args_adv_str));
+    return true;
   }
   catch(saga::exception const & e) {
     msg += ". FAILED " + std::string(e.what());
     log_sptr_->write(msg, LOGLEVEL_ERROR);
     throw faust::exception (msg, faust::NoSuccess);
-  }  
-  
-  cmd = cmd_adv_str;
-  args = args_adv_str;
-  
-  return cmd_adv_str;
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -187,13 +267,29 @@ void app::run(void)
   // start monitor thread
   monitor_sptr_->run();
   
-  std::string a("");
-  std::string b("");
-  while(1) 
+  std::vector<faust::protocol::command> commands;
+  while(1)
   {
-    std::string cmd = recv_command(a, b);
-    if(cmd == uuid_+":TERMINATE") return;
-    sleep(1);
+    recv_commands(commands);
+
+    for(std::size_t i = 0; i < commands.size(); ++i) {
+      if(commands[i].name == PROTO_V1_TERMINATE) return;
+    }
+
+    if(notify_ok_) {
+      // block on the wakeup channel; the timeout is only the fallback
+      // poll interval for resource instances that don't ping us.
+      try {
+        saga::stream::stream s = notify_srv_.serve(10.0);
+        s.close(); // the connection itself is the wakeup - no payload
+      }
+      catch(saga::exception const & e) {
+        // timeout - fall through to the regular poll
+      }
+    }
+    else {
+      sleep(1);
+    }
   }
 }
 
@@ -13,10 +13,13 @@
 #ifndef FAUST_AGENT_HPP
 #define FAUST_AGENT_HPP
 
+#include <vector>
+
 #include <saga/saga.hpp>
 #include <faust/impl/logwriter.hpp>
 #include <agent/monitor/monitor.hpp>
 
+#include <faust/faust/protocol.hpp>
 #include <faust/faust/resource_description.hpp>
 #include <faust/faust/resource_monitor.hpp>
 
@@ -35,14 +38,24 @@ namespace faust
         saga::advert::entry args_adv_;
         saga::advert::entry desc_adv_;
         saga::advert::entry mon_adv_;
-        
+
+        // wakeup channel: the resource side connects to this stream
+        // server after posting a command, so we don't have to poll the
+        // CMD advert at a tight interval. If the server can't be set
+        // up, run() falls back to the plain 1-second poll.
+        saga::stream::server notify_srv_;
+        bool                 notify_ok_;
+
         boost::shared_ptr <faust::detail::logwriter> log_sptr_;
         boost::shared_ptr <faust::agent::monitor::monitor> monitor_sptr_;
         
         faust::resource_description description_;
         faust::resource_monitor     monitor_;
         
-        std::string recv_command(std::string & cmd, std::string & args);
+        // retrieves the next command frame (or legacy text command) from
+        // the CMD advert, acknowledges it, and appends the decoded
+        // commands to 'commands'. Returns true if anything new arrived.
+        bool recv_commands(std::vector<faust::protocol::command> & commands);
         
       public:
         app(std::string endpoint, std::string uuid);
@@ -28,6 +28,11 @@ void monitor::init()
   namespace FAR = faust::attributes::resource_description;
   namespace FAM = faust::attributes::resource_monitor;
 
+  // the collector registry: every metric group is declared here once.
+  // All groups sample into the shared attribute cache on the same timer
+  // tick and the cache is flushed in a single write (see
+  // thread_entry_point_), so registering another group does not add
+  // advert writes to the tick.
   monitor_group mg1 ("dirs", description_, monitor_, log_sptr_);
   mg1.set_update_interval_mapping (FAR::dir_update_interval,     FAM::dir_last_update);
   mg1.add_value_value_mapping     (FAR::dir_id,                  FAM::dir_id);
@@ -36,8 +41,8 @@ void monitor::init()
   mg1.add_cmd_value_mapping       (FAR::dir_dev_space_used_cmd,  FAM::dir_dev_space_used);
   mg1.add_cmd_value_mapping       (FAR::dir_quota_total_cmd,     FAM::dir_quota_total);
   mg1.add_cmd_value_mapping       (FAR::dir_quota_used_cmd,      FAM::dir_quota_used);
-  mgv_.push_back(mg1);
-  
+  add_group(mg1);
+
   monitor_group mg2 ("queues", description_, monitor_, log_sptr_);
   mg2.set_update_interval_mapping (FAR::queue_update_interval,   FAM::queue_last_update);
   mg2.add_value_value_mapping     (FAR::queue_id,                FAM::queue_id);
@@ -45,8 +50,28 @@ void monitor::init()
   mg2.add_cmd_value_mapping       (FAR::queue_nodes_busy_cmd,    FAM::queue_nodes_busy);
   mg2.add_cmd_value_mapping       (FAR::queue_nodes_down_cmd,    FAM::queue_nodes_down);
   mg2.add_cmd_value_mapping       (FAR::queue_nodes_total_cmd,   FAM::queue_nodes_total);
-  mg2.add_cmd_value_mapping       (FAR::queue_nodes_queued_cmd,  FAM::queue_nodes_queued);   
-  mgv_.push_back(mg2);
+  mg2.add_cmd_value_mapping       (FAR::queue_nodes_queued_cmd,  FAM::queue_nodes_queued);
+  add_group(mg2);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void monitor::add_group(monitor_group mg)
+{
+  mgv_.push_back(mg);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void monitor::set_publish_policy(double epsilon, unsigned int heartbeat_interval)
+{
+  std::vector<monitor_group>::iterator it;
+  for(it = mgv_.begin(); it != mgv_.end(); ++it)
+  {
+    (*it).set_publish_policy(epsilon, heartbeat_interval);
+  }
 }
 
 
@@ -54,17 +79,26 @@ void monitor::init()
 //
 void monitor::thread_entry_point_(monitor * THIS)
 {
-  while(1) // wait for quit() command! 
+  while(1) // wait for quit() command!
   {
+    // one tick samples ALL groups into the attribute cache first; the
+    // cache is then flushed in a single write. This keeps the advert
+    // cost of a tick constant, no matter how many groups are registered.
+    // A group only votes for a flush when its values actually moved (or
+    // its heartbeat floor expired) - a tick with nothing but repeat
+    // values costs no advert write at all.
+    bool should_write = false;
+
     std::vector<monitor_group>::iterator it;
     for(it = THIS->mgv_.begin(); it != THIS->mgv_.end(); ++it)
     {
-      bool should_write = (*it).execute();    
-      
-      if(should_write)
-      {
-        THIS->monitor_.get_impl()->write_attributes();
-      }
+      if((*it).execute())
+        should_write = true;
+    }
+
+    if(should_write)
+    {
+      THIS->monitor_.get_impl()->write_attributes();
     }
 
     boost::this_thread::sleep(boost::posix_time::milliseconds(2000));
@@ -55,7 +55,19 @@ namespace faust { namespace agent { namespace monitor {
                boost::shared_ptr <faust::detail::logwriter> log_sptr);
       
       unsigned int get_update_interval();
-      
+
+      // registers another collector group. All registered groups are
+      // sampled on the same timer tick and their results are flushed
+      // to the advert service in one write per tick.
+      void add_group(monitor_group mg);
+
+      // publication policy for all registered groups: values are only
+      // flushed when they moved beyond epsilon (relative), with a
+      // heartbeat floor of heartbeat_interval seconds for unchanged
+      // values. Stable groups also back off their sampling rate until
+      // the next delta (see monitor_group::execute)
+      void set_publish_policy(double epsilon, unsigned int heartbeat_interval);
+
       void run();
       
       ~monitor();
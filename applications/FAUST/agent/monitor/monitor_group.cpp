@@ -29,7 +29,12 @@ monitor_group::monitor_group(std::string name,
   has_update_interval_mapping_ = false;
   default_update_interval_ = 60;
   default_last_update_ = 0;
-  
+
+  publish_epsilon_    = 0.0;
+  heartbeat_interval_ = 300;
+  last_publish_       = 0;
+  sample_backoff_     = 1;
+  ticks_waited_       = 0;
 }
 
 
@@ -44,14 +49,152 @@ monitor_group::~monitor_group()
 //
 bool monitor_group::execute()
 {
+  // adaptive sampling: a group that has been stable sits out ticks
+  if(++ticks_waited_ < sample_backoff_)
+  {
+    return false;
+  }
+  ticks_waited_ = 0;
+
   if(!has_update_interval_mapping_ & (default_last_update_+default_update_interval_ >= time(NULL)))
   {
     // DO NOTHING
     return false;
   }
-  else
+
+  if(!process_all_())
+  {
+    return false;
+  }
+
+  // the sample went into the attribute cache - only ask for a flush
+  // when something actually moved (beyond epsilon), or when the
+  // heartbeat floor expired. A delta tightens the sampling rate back
+  // to every tick; a stable sample backs it off
+  bool delta = delta_since_published_();
+
+  if(delta)
+  {
+    sample_backoff_ = 1;
+  }
+  else if(sample_backoff_ < max_sample_backoff_)
+  {
+    sample_backoff_ *= 2;
+  }
+
+  if(delta || last_publish_ + heartbeat_interval_ <= time(NULL))
+  {
+    snapshot_published_();
+    last_publish_ = time(NULL);
+    return true;
+  }
+
+  return false;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void monitor_group::set_publish_policy(double epsilon, unsigned int heartbeat_interval)
+{
+  publish_epsilon_    = (epsilon < 0.0) ? 0.0 : epsilon;
+  heartbeat_interval_ = heartbeat_interval;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void monitor_group::collect_current_(std::map<std::string, std::string> & out)
+{
+  std::vector<mapping_t> const * maps[2] =
+    { &cmd_value_mappings_, &value_value_mappings_ };
+
+  for(int m = 0; m < 2; ++m)
+  {
+    std::vector<mapping_t>::const_iterator it;
+    for(it = maps[m]->begin(); it != maps[m]->end(); ++it)
+    {
+      if(is_vector_group_)
+      {
+        std::vector<std::string> vals = monitor_.get_vector_attribute((*it).second);
+        for(unsigned int i = 0; i < vals.size(); ++i)
+        {
+          out[(*it).second + ":" + boost::lexical_cast<std::string>(i)] = vals[i];
+        }
+      }
+      else
+      {
+        out[(*it).second] = monitor_.get_attribute((*it).second);
+      }
+    }
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+bool monitor_group::value_moved_(const std::string & from, const std::string & to)
+{
+  if(from == to) return false;
+
+  // numeric values only move once they leave the epsilon band around
+  // the published value; anything non-numeric moves on any change
+  try
+  {
+    double o = boost::lexical_cast<double>(from);
+    double n = boost::lexical_cast<double>(to);
+    double scale = (std::fabs(o) > 1.0) ? std::fabs(o) : 1.0;
+    return std::fabs(n - o) > publish_epsilon_ * scale;
+  }
+  catch(boost::bad_lexical_cast const &)
+  {
+    return true;
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+bool monitor_group::delta_since_published_()
+{
+  try
+  {
+    std::map<std::string, std::string> current;
+    collect_current_(current);
+
+    if(current.size() != published_.size()) return true;
+
+    std::map<std::string, std::string>::const_iterator it;
+    for(it = current.begin(); it != current.end(); ++it)
+    {
+      std::map<std::string, std::string>::const_iterator old = published_.find(it->first);
+      if(old == published_.end()) return true;
+      if(value_moved_(old->second, it->second)) return true;
+    }
+  }
+  catch(saga::exception const & e)
+  {
+    // when in doubt, publish
+    return true;
+  }
+
+  return false;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void monitor_group::snapshot_published_()
+{
+  try
+  {
+    published_.clear();
+    collect_current_(published_);
+  }
+  catch(saga::exception const & e)
   {
-    return process_all_();
+    // a failed snapshot just means the next sample publishes again
+    published_.clear();
   }
 }
 
@@ -251,7 +394,8 @@ bool monitor_group::process_all_()
             last_updates.at(i) = boost::lexical_cast<std::string>(time(NULL));
           }
           
-          LOG_WRITE_SUCCESS_2(log_sptr_, msg);
+          // sampling path: compiled out below FAUST_LOG_COMPILE_LEVEL
+          LOG_WRITE_DEBUG_2(log_sptr_, msg);
           global_update = true;
         }
         else // no update needed. copy old values
@@ -376,7 +520,8 @@ bool monitor_group::process_all_()
           monitor_.set_attribute(update_interval_mapping_.second, update_time);
         }
         
-        LOG_WRITE_SUCCESS_2(log_sptr_, msg);
+        // sampling path: compiled out below FAUST_LOG_COMPILE_LEVEL
+        LOG_WRITE_DEBUG_2(log_sptr_, msg);
         global_update = true;
       }
     }
@@ -13,6 +13,9 @@
 #ifndef FAUST_AGENT_MONITOR_MONITOR_GROUP_HPP
 #define FAUST_AGENT_MONITOR_MONITOR_GROUP_HPP
 
+#include <map>
+#include <cmath>
+
 #include <saga/saga.hpp>
 
 #include <boost/process.hpp>
@@ -70,25 +73,54 @@ namespace faust { namespace agent { namespace monitor {
     
     faust::resource_description description_;
     faust::resource_monitor monitor_;
-    
+
+    // delta-triggered publication: a sample only asks for a flush when
+    // a value moved beyond publish_epsilon_ (relative to the last
+    // published snapshot), or when the heartbeat floor expired
+    double       publish_epsilon_;
+    unsigned int heartbeat_interval_;
+    time_t       last_publish_;
+
+    // adaptive sampling: a group whose samples keep matching the
+    // published snapshot sits out ticks (the backoff doubles up to the
+    // cap); any publishable delta resets it to every tick
+    unsigned int sample_backoff_;
+    unsigned int ticks_waited_;
+    static const unsigned int max_sample_backoff_ = 16;
+
+    // the values as they were last flushed to the advert service,
+    // keyed by monitor attribute (vector elements get ':<idx>' keys)
+    std::map<std::string, std::string> published_;
+
     bool validate_(std::vector<mapping_t> &vec, SAGA_OSSTREAM & msg);
     bool process_all_();
-    
+
+    void collect_current_(std::map<std::string, std::string> & out);
+    bool value_moved_(const std::string & from, const std::string & to);
+    bool delta_since_published_();
+    void snapshot_published_();
+
   public:
-    
-    monitor_group(std::string name, 
+
+    monitor_group(std::string name,
                   faust::resource_description desc_,
                   faust::resource_monitor mon_,
                   boost::shared_ptr <faust::detail::logwriter> log_sptr);
-    
+
     ~monitor_group();
-    
+
     bool execute();
 
     void set_update_interval_mapping(char const* const rd_attrib, char const* const rm_attrib);
     void add_cmd_value_mapping      (char const* const rd_attrib, char const* const rm_attrib);
     void add_value_value_mapping    (char const* const rd_attrib, char const* const rm_attrib);
-    
+
+    // epsilon is the relative change a numeric value needs before it is
+    // published (0.0 publishes any change); heartbeat_interval is the
+    // floor in seconds - unchanged values are re-published at least
+    // that often (0 publishes every sample)
+    void set_publish_policy(double epsilon, unsigned int heartbeat_interval);
+
   };
   //
   //////////////////////////////////////////////////////////////////////////////
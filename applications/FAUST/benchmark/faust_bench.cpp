@@ -0,0 +1,296 @@
+/*  ______ ___  _   _ _____ _____
+ *  |  ___/ _ \| | | /  ___|_   _|
+ *  | |_ / /_\ \ | | \ `--.  | |
+ *  |  _||  _  | | | |`--. \ | |
+ *  | |  | | | | |_| /\__/ / | |
+ *  \_|  \_| |_/\___/\____/  \_/
+ *
+ *  Framework for Adaptive Ubiquitous Scalable Tasks
+ *  Website: https://macpro01.cct.lsu.edu/trac/faust
+ *
+ *  Copyright 2008-2009 Center for Computation & Technology.
+ *
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
+ *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+//  faust-bench - performance benchmarks for the FAUST control plane.
+//
+//  The control plane lives in adverts, so its costs are round trips, not
+//  cycles; these benchmarks put numbers on the round trips an application
+//  actually feels so they can be compared release over release:
+//
+//    submit   per-job submission latency, split into the create_job call
+//             itself and the time until a running agent picks the job up
+//    states   state query throughput, per-job queries against the bulk
+//             get_job_states() refresh
+//    monitor  latency of a resource_monitor read, i.e. one full round
+//             trip through the agent's publication channel
+//    group    a synthetic ensemble submitted through create_jobs() with a
+//             timing breakdown per phase (build, submit, pickup, drain)
+//
+//  All benchmarks need a running agent on the target resource; what they
+//  measure includes the real advert backend, which is the point.
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+
+#include <faust/faust.hpp>
+
+namespace po = boost::program_options;
+
+///////////////////////////////////////////////////////////////////////////////
+//  wall-clock milliseconds since an arbitrary epoch
+static double now_ms()
+{
+  static boost::posix_time::ptime epoch =
+    boost::posix_time::microsec_clock::universal_time();
+  boost::posix_time::time_duration d =
+    boost::posix_time::microsec_clock::universal_time() - epoch;
+  return double(d.total_microseconds()) / 1000.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//  min/median/mean/p95/max over a sample set, printed on one line
+static void report(std::string const & name, std::vector<double> samples)
+{
+  if(samples.empty())
+  {
+    std::cout << name << ": no samples" << std::endl;
+    return;
+  }
+  std::sort(samples.begin(), samples.end());
+  double sum = 0.0;
+  for(std::size_t i = 0; i < samples.size(); ++i) sum += samples[i];
+
+  std::cout << name << " (" << samples.size() << " samples, ms): "
+            << "min "    << samples.front()
+            << " median " << samples[samples.size() / 2]
+            << " mean "   << sum / samples.size()
+            << " p95 "    << samples[(samples.size() * 95) / 100]
+            << " max "    << samples.back()
+            << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+static faust::job_description make_description(int serial)
+{
+  faust::job_description jd;
+  jd.set_attribute("Executable", "/bin/true");
+  jd.set_attribute("Arguments", boost::lexical_cast<std::string>(serial));
+  return jd;
+}
+
+static bool is_final(faust::state s)
+{
+  return s == faust::Done || s == faust::Canceled || s == faust::Failed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//  submission latency: create_job() itself, and create_job() through agent
+//  pickup (the job leaving New). The two differ by exactly the control
+//  plane's dispatch path, which is what this benchmark exists to watch.
+static void bench_submit(faust::service & svc, int num_jobs)
+{
+  std::vector<double> create_ms, pickup_ms;
+
+  for(int i = 0; i < num_jobs; ++i)
+  {
+    faust::job_description jd = make_description(i);
+
+    double t0 = now_ms();
+    faust::job j = svc.create_job(jd);
+    j.run();
+    double t1 = now_ms();
+    create_ms.push_back(t1 - t0);
+
+    while(j.get_state() == faust::New)
+    {
+      ::usleep(1000);
+    }
+    pickup_ms.push_back(now_ms() - t1);
+  }
+
+  report("submit/create_job", create_ms);
+  report("submit/agent_pickup", pickup_ms);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//  state query throughput: single-job queries (served from the bounded-
+//  staleness cache) against one bulk get_job_states() refresh
+static void bench_states(faust::service & svc, int num_queries)
+{
+  std::vector<std::string> ids = svc.list_jobs();
+  if(ids.empty())
+  {
+    std::cout << "states: no jobs to query (run submit first)" << std::endl;
+    return;
+  }
+
+  double t0 = now_ms();
+  for(int i = 0; i < num_queries; ++i)
+  {
+    svc.get_job_state(ids[i % ids.size()]);
+  }
+  double single = now_ms() - t0;
+
+  t0 = now_ms();
+  std::map<std::string, faust::state> all = svc.get_job_states();
+  double bulk = now_ms() - t0;
+
+  std::cout << "states/single: " << num_queries << " queries in " << single
+            << " ms (" << (num_queries * 1000.0) / single << " queries/s)"
+            << std::endl;
+  std::cout << "states/bulk: " << all.size() << " states in " << bulk
+            << " ms" << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//  monitor read latency: one sample is a get_monitor() plus a read of every
+//  attribute it carries - a full round trip through the agent's publication
+//  channel. Publication-side changes (delta filtering, sampling backoff)
+//  show up here as staler or cheaper reads.
+static void bench_monitor(faust::resource & res, int num_reads)
+{
+  std::vector<double> read_ms;
+  std::size_t num_attributes = 0;
+
+  for(int i = 0; i < num_reads; ++i)
+  {
+    double t0 = now_ms();
+    faust::resource_monitor rm = res.get_monitor();
+    std::vector<std::string> attributes = rm.list_attributes();
+    for(std::size_t a = 0; a < attributes.size(); ++a)
+    {
+      if(rm.attribute_is_vector(attributes[a]))
+        rm.get_vector_attribute(attributes[a]);
+      else
+        rm.get_attribute(attributes[a]);
+    }
+    read_ms.push_back(now_ms() - t0);
+    num_attributes = attributes.size();
+  }
+
+  std::cout << "monitor: " << num_attributes << " attributes per read"
+            << std::endl;
+  report("monitor/full_read", read_ms);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//  synthetic ensemble: group_size jobs through the bulk create_jobs() path,
+//  with the wall clock split into the phases an ensemble run goes through
+static void bench_group(faust::service & svc, int group_size)
+{
+  double t0 = now_ms();
+  std::vector<faust::job_description> descs;
+  for(int i = 0; i < group_size; ++i)
+  {
+    descs.push_back(make_description(i));
+  }
+  double build = now_ms() - t0;
+
+  t0 = now_ms();
+  std::vector<faust::job> jobs = svc.create_jobs(descs);
+  for(std::size_t i = 0; i < jobs.size(); ++i)
+  {
+    jobs[i].run();
+  }
+  double submit = now_ms() - t0;
+
+  //pickup: poll the bulk query until no job is New anymore
+  t0 = now_ms();
+  std::vector<std::string> ids;
+  for(std::size_t i = 0; i < jobs.size(); ++i)
+  {
+    ids.push_back(jobs[i].get_job_id());
+  }
+  bool any_new = true;
+  while(any_new)
+  {
+    any_new = false;
+    std::map<std::string, faust::state> states = svc.get_job_states();
+    for(std::size_t i = 0; i < ids.size(); ++i)
+    {
+      if(states[ids[i]] == faust::New)
+      {
+        any_new = true;
+        break;
+      }
+    }
+    if(any_new) ::usleep(10000);
+  }
+  double pickup = now_ms() - t0;
+
+  t0 = now_ms();
+  svc.wait_all(ids);
+  double drain = now_ms() - t0;
+
+  std::cout << "group (" << group_size << " jobs, ms): "
+            << "build "   << build
+            << " submit " << submit
+            << " pickup " << pickup
+            << " drain "  << drain
+            << " total "  << (build + submit + pickup + drain)
+            << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+  std::string resource_file, bench("all");
+  int num_jobs, num_queries, group_size;
+
+  po::options_description opts("faust-bench options");
+  opts.add_options()
+    ("help,h", "print this message")
+    ("resource,r", po::value<std::string>(&resource_file),
+     "resource description file (as for faust_ex01)")
+    ("bench,b", po::value<std::string>(&bench),
+     "benchmark to run: submit, states, monitor, group or all")
+    ("jobs,j", po::value<int>(&num_jobs)->default_value(100),
+     "jobs for the submit benchmark")
+    ("queries,q", po::value<int>(&num_queries)->default_value(1000),
+     "queries for the states benchmark, reads for the monitor benchmark")
+    ("group-size,g", po::value<int>(&group_size)->default_value(1000),
+     "jobs in the synthetic group run");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, opts), vm);
+  po::notify(vm);
+
+  if(vm.count("help") || !vm.count("resource"))
+  {
+    std::cout << opts << std::endl;
+    return 0;
+  }
+
+  try
+  {
+    faust::resource_description rd;
+    rd.read_from_file(resource_file);
+    faust::resource res(rd, false);
+
+    std::vector<faust::resource> resources;
+    resources.push_back(res);
+    faust::service svc(resources, num_jobs + group_size);
+
+    if(bench == "all" || bench == "submit")  bench_submit(svc, num_jobs);
+    if(bench == "all" || bench == "states")  bench_states(svc, num_queries);
+    if(bench == "all" || bench == "monitor") bench_monitor(res, num_queries);
+    if(bench == "all" || bench == "group")   bench_group(svc, group_size);
+  }
+  catch(faust::exception const & e)
+  {
+    std::cerr << "faust-bench: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
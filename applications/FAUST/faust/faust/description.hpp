@@ -19,6 +19,7 @@
 
 #include <faust/faust/object.hpp>
 #include <faust/faust/defines.hpp>
+#include <faust/faust/typed_attributes.hpp>
 
 namespace faust
 {    
@@ -79,6 +80,26 @@ namespace faust
      */
     ~job_description();
   };
+
+  namespace typed
+  {
+    /*! \brief Compile-time %attribute tags for faust::job_description.
+     *         Each tag binds one of the string keys above to a fixed slot of
+     *         a faust::typed::view (see typed_attributes.hpp).
+     */
+    namespace job_description
+    {
+      FAUST_TYPED_ATTRIBUTE(desc01, faust::attributes::job_description::desc01, std::string,              0)
+      FAUST_TYPED_ATTRIBUTE(desc02, faust::attributes::job_description::desc02, std::vector<std::string>, 1)
+
+      static const int num_slots = 2;
+
+      /*! \brief Typed %view over a faust::job_description.
+       *
+       */
+      typedef faust::typed::view<faust::job_description, num_slots> view;
+    }
+  }
 }
 
 #endif /* FAUST_DESCRIPTION_HPP */
@@ -22,9 +22,10 @@
 
 namespace faust
 {
-  // fwd. decl. implementation class // 
+  // fwd. decl. implementation class //
   ///@cond - exclude from Doxygen
-  namespace impl { class job; class service_impl; } 
+  namespace impl { class job; class service_impl; }
+  namespace detail { struct DAG_vertex_properties; }
   ///@endcond - exclude from Doxygen
 
 
@@ -36,9 +37,13 @@ namespace faust
     class  job : public faust::object
     {
     
-      // service impl. class needs to be friend to call private c'tor 
+      // service impl. class needs to be friend to call private c'tor
       friend class faust::impl::service_impl;
-      
+
+      // the job DAG stores jobs as vertex properties, which requires
+      // default construction
+      friend struct faust::detail::DAG_vertex_properties;
+
     private:
       
       job();
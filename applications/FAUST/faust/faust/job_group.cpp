@@ -33,9 +33,17 @@ job_group::job_group()
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-void job_group::run() 
-{ 
-  get_impl()->run(); 
+void job_group::add_dependency(std::string job_id, std::string dep_job_id,
+                               faust::dependency dep)
+{
+  get_impl()->add_dependency(job_id, dep_job_id, dep);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void job_group::run()
+{
+  get_impl()->run();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
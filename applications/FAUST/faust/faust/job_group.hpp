@@ -20,6 +20,7 @@
 #include <faust/faust/exports.hpp>
 #include <faust/faust/state.hpp>
 #include <faust/faust/description.hpp>
+#include <faust/faust/dependency.hpp>
 
 namespace faust
 {
@@ -49,7 +50,23 @@ namespace faust
       
     public:
       
-      /*! \brief Runs all jobs in this group. 
+      /*! \brief Declares that the %job identified by 'job_id' depends
+       *         on the %job identified by 'dep_job_id'. Both jobs have
+       *         to be members of this %group.
+       *
+       *         A Data %dependency delays the dependent %job until its
+       *         prerequisite has finished; a Communication %dependency
+       *         schedules both jobs at the same time (see
+       *         faust::dependency).
+       *
+       */
+      void add_dependency(std::string job_id, std::string dep_job_id,
+                          faust::dependency dep);
+
+      /*! \brief Runs all jobs in this group, honoring the declared
+       *         dependencies: jobs are partitioned into topological
+       *         waves, each wave runs with maximum concurrency, and a
+       *         wave is only started once the previous one finished.
        *
        */
       void run();
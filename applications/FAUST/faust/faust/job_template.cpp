@@ -0,0 +1,130 @@
+/*
+ *  job_template.cpp
+ *  FAUST - Framework for Adaptive Ubiquitous Scalable Tasks
+ *  Website: https://macpro01.cct.lsu.edu/trac/faust
+ *
+ *  Created by Ole Weidner <oweidner@cct.lsu.edu> on 11/22/08.
+ *  Copyright 2008-2009 Center for Computation & Technology.
+ *
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
+ *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#include <faust/faust/job_template.hpp>
+
+using namespace faust;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+job_template::job_template(faust::job_description job_desc,
+                           std::string arg_key)
+: arg_key_(arg_key)
+{
+  compile_(job_desc);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void job_template::compile_(faust::job_description & job_desc)
+{
+  using namespace faust::protocol::detail;
+
+  // capture the invariant attributes. This is the one and only walk
+  // over the description's attribute layer - instances never touch it.
+  std::vector<std::string> keys = job_desc.list_attributes();
+
+  std::vector<std::string>::const_iterator i;
+  for(i = keys.begin(); i != keys.end(); ++i)
+  {
+    if(*i == arg_key_)
+      continue;
+
+    if(job_desc.attribute_is_vector(*i))
+      vectors_[*i] = job_desc.get_vector_attribute(*i);
+    else
+      scalars_[*i] = job_desc.get_attribute(*i);
+  }
+
+  // serialize the capture into the prebound blob, using the same
+  // varint string framing as the V2 command frames it travels in
+  append_varint(prebound_, scalars_.size());
+
+  std::map<std::string, std::string>::const_iterator s;
+  for(s = scalars_.begin(); s != scalars_.end(); ++s)
+  {
+    append_string(prebound_, s->first);
+    append_string(prebound_, s->second);
+  }
+
+  append_varint(prebound_, vectors_.size());
+
+  std::map<std::string, std::vector<std::string> >::const_iterator v;
+  for(v = vectors_.begin(); v != vectors_.end(); ++v)
+  {
+    append_string(prebound_, v->first);
+    append_varint(prebound_, v->second.size());
+
+    for(std::size_t n = 0; n < v->second.size(); ++n)
+      append_string(prebound_, v->second[n]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::string const & job_template::prebound(void) const
+{
+  return prebound_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::string job_template::instance(std::vector<std::string> const & args) const
+{
+  using namespace faust::protocol::detail;
+
+  std::string out;
+  append_string(out, arg_key_);
+  append_varint(out, args.size());
+
+  for(std::size_t n = 0; n < args.size(); ++n)
+    append_string(out, args[n]);
+
+  return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+faust::job_description
+job_template::materialize(std::vector<std::string> const & args) const
+{
+  faust::job_description job_desc;
+
+  std::map<std::string, std::string>::const_iterator s;
+  for(s = scalars_.begin(); s != scalars_.end(); ++s)
+    job_desc.set_attribute(s->first, s->second);
+
+  std::map<std::string, std::vector<std::string> >::const_iterator v;
+  for(v = vectors_.begin(); v != vectors_.end(); ++v)
+    job_desc.set_vector_attribute(v->first, v->second);
+
+  job_desc.set_vector_attribute(arg_key_, args);
+
+  return job_desc;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+faust::protocol::frame
+job_template::batch_frame(std::string uuid,
+                          std::vector<std::vector<std::string> > const & args_list) const
+{
+  faust::protocol::frame f(faust::protocol::command_frame, uuid);
+
+  f.add(PROTO_JOB_TEMPLATE, prebound_);
+
+  std::vector<std::vector<std::string> >::const_iterator i;
+  for(i = args_list.begin(); i != args_list.end(); ++i)
+    f.add(PROTO_JOB_INSTANCE, instance(*i));
+
+  return f;
+}
@@ -0,0 +1,105 @@
+/*
+ *  job_template.hpp
+ *  FAUST - Framework for Adaptive Ubiquitous Scalable Tasks
+ *  Website: https://macpro01.cct.lsu.edu/trac/faust
+ *
+ *  Created by Ole Weidner <oweidner@cct.lsu.edu> on 11/22/08.
+ *  Copyright 2008-2009 Center for Computation & Technology.
+ *
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
+ *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#ifndef FAUST_JOB_TEMPLATE_HPP
+#define FAUST_JOB_TEMPLATE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <faust/faust/exports.hpp>
+#include <faust/faust/description.hpp>
+#include <faust/faust/protocol.hpp>
+
+namespace faust
+{
+  /*! \brief A %job_template is a %job_description precompiled into its
+   *         serialized advert form. Parameter sweeps submit thousands
+   *         of jobs identical except for their arguments, and routing
+   *         each of them through a full %job_description walks,
+   *         validates and re-serializes every %attribute per %job. A
+   *         template captures and serializes the invariant attributes
+   *         exactly once; at submit time only the per-instance
+   *         arguments are spliced in, so the per-job submit cost - CPU
+   *         as well as advert payload - shrinks to the argument delta.
+   *
+   *         <b>Example:</b><br>
+   *         <code>
+   *         faust::job_description jd;<br>
+   *         jd.set_attribute(faust::attributes::job_description::desc01, "/bin/sweep");<br>
+   *         <br>
+   *         faust::job_template t(jd);<br>
+   *         std::vector&lt;std::vector&lt;std::string&gt; &gt; args(1000);<br>
+   *         // ... fill in the per-instance arguments ...<br>
+   *         std::vector&lt;faust::job&gt; jobs = s.create_jobs(t, args);<br>
+   *         </code>
+   *
+   */
+  class job_template
+  {
+
+  private:
+
+    std::string                                      arg_key_;
+    std::map<std::string, std::string>               scalars_;
+    std::map<std::string, std::vector<std::string> > vectors_;
+    std::string                                      prebound_;
+
+    void compile_(faust::job_description & job_desc);
+
+  public:
+
+    /*! \brief Compiles 'job_desc' into a template. Every %attribute
+     *         except 'arg_key' is captured and serialized here, once;
+     *         'arg_key' names the %attribute that varies per instance
+     *         and defaults to the argument vector.
+     *
+     */
+    explicit job_template(faust::job_description job_desc,
+                          std::string arg_key =
+                            faust::attributes::job_description::desc02);
+
+    /*! \brief Returns the prebound blob: the invariant attributes in
+     *         their serialized advert form. Stored (and transferred)
+     *         once per batch, regardless of the instance count.
+     *
+     */
+    std::string const & prebound(void) const;
+
+    /*! \brief Serializes one instance's argument splice. This is the
+     *         complete per-job payload.
+     *
+     */
+    std::string instance(std::vector<std::string> const & args) const;
+
+    /*! \brief Rebuilds a full %job_description with 'args' spliced in.
+     *         The invariant attributes come from the compiled capture -
+     *         the source %description is not consulted again.
+     *
+     */
+    faust::job_description materialize(std::vector<std::string> const & args) const;
+
+    /*! \brief Builds the V2 command frame submitting a whole batch:
+     *         one JOB_TEMPLATE command carrying the prebound blob,
+     *         followed by one JOB_INSTANCE command per entry of
+     *         'args_list' carrying only its argument delta (see
+     *         faust/faust/protocol.hpp).
+     *
+     */
+    faust::protocol::frame
+    batch_frame(std::string uuid,
+                std::vector<std::vector<std::string> > const & args_list) const;
+  };
+}
+
+#endif /* FAUST_JOB_TEMPLATE_HPP */
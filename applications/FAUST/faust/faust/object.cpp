@@ -52,3 +52,26 @@ faust::object::type faust::object::get_type() const
   return type_;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+boost::shared_ptr<faust::impl::state_snapshot const>
+faust::object::get_state_snapshot() const
+{
+  if (!impl_) {
+    // default-constructed facade: an empty, version-0 block
+    return boost::shared_ptr<faust::impl::state_snapshot const>
+      (new faust::impl::state_snapshot());
+  }
+  return impl_->get_state_snapshot();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+unsigned long faust::object::get_state_version() const
+{
+  if (!impl_) {
+    return 0;
+  }
+  return impl_->get_state_version();
+}
+
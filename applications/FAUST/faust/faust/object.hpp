@@ -15,14 +15,15 @@
 
 // include boost helper
 #include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 
 
 namespace faust {
-  
-  // fwd. decl. implementation class // 
+
+  // fwd. decl. implementation class //
   ///@cond - exclude from Doxygen
-  namespace impl { class object ; }
+  namespace impl { class object ; struct state_snapshot; }
   ///@endcond - exclude from Doxygen
   
   /////////////////////////////////////////////////////////////////////////////
@@ -67,6 +68,26 @@ namespace faust {
     explicit object() {};
     explicit object(faust::impl::object *obj, faust::object::type tp);
     explicit object (boost::shared_ptr<faust::impl::object> init, faust::object::type tp);
+
+    /*! \brief Returns the most recently published state snapshot of
+     *         this %object.
+     *
+     *   Agents publish their attribute state as immutable, versioned
+     *   blocks; reading one is a pointer copy, so state queries never
+     *   block an agent update no matter how many readers poll. The
+     *   returned block stays valid (and unchanged) for as long as the
+     *   caller holds it.
+     */
+    boost::shared_ptr<faust::impl::state_snapshot const> get_state_snapshot() const;
+
+    /*! \brief Returns the version of the most recently published state
+     *         snapshot.
+     *
+     *   The version increases with every publication; a dashboard that
+     *   still holds a snapshot with the current version can skip
+     *   re-reading (and re-rendering) the state entirely.
+     */
+    unsigned long get_state_version() const;
     
   private:
     
@@ -0,0 +1,30 @@
+/*
+ *  placement.hpp
+ *  FAUST - Framework for Adaptive Ubiquitous Scalable Tasks
+ *  Website: https://macpro01.cct.lsu.edu/trac/faust
+ *
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
+ *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#ifndef FAUST_PLACEMENT_HPP
+#define FAUST_PLACEMENT_HPP
+
+namespace faust
+{
+    /*! \brief Ranking criteria for %resource placement queries
+     *         (see faust::service::select_resources). Each criterion maps
+     *         to a pre-sorted ranking maintained from the monitor-reported
+     *         queue and load figures.
+     */
+    enum placement_criterion
+    { /*! Most currently free nodes first. */
+      PlacementFreeNodes  = 1,
+      /*! Shortest batch queue (fewest queued jobs) first. */
+      PlacementQueueDepth = 2,
+      /*! Lowest monitor-reported load (busy/total nodes) first. */
+      PlacementLoad       = 4
+    };
+}
+
+#endif /*FAUST_PLACEMENT_HPP*/
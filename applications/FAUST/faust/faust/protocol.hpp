@@ -4,9 +4,9 @@
  *  Website: https://macpro01.cct.lsu.edu/trac/faust
  *
  *  Created by Ole Weidner <oweidner@cct.lsu.edu> on 03/13/2009.
- *  Copyright 2008-2009 Center for Computation & Technology. 
+ *  Copyright 2008-2009 Center for Computation & Technology.
  *
- *  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
  *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
  */
 
@@ -14,7 +14,197 @@
 #ifndef FAUST_PROTOCOL_HPP
 #define FAUST_PROTOCOL_HPP
 
+#include <string>
+#include <vector>
+
+// V1 command names. They survive as the command names carried inside
+// V2 frames, and as the wire format itself for agents/resources that
+// still speak the plain "uuid:CMD" advert strings.
 #define PROTO_V1_TERMINATE     "TERMINATE"
 #define PROTO_V1_PING          "PING"
 
-#endif /*FAUST_PROTOCOL_HPP*/
\ No newline at end of file
+// command names for template-based bulk job submission (see
+// faust/faust/job_template.hpp): one JOB_TEMPLATE command carries the
+// prebound description blob of a batch, each JOB_INSTANCE command only
+// its per-job argument delta. V2-only - there is no V1 text form.
+#define PROTO_JOB_TEMPLATE     "JOB_TEMPLATE"
+#define PROTO_JOB_INSTANCE     "JOB_INSTANCE"
+
+namespace faust { namespace protocol {
+
+  /* Version 2 of the agent command protocol: a compact binary frame
+   * that travels as a single advert blob. The V1 scheme spread one
+   * command over two advert entries ('CMD' and 'ARGS') and made the
+   * agent tokenize strings on every poll; a V2 frame carries the
+   * sender UUID, any number of commands and their arguments in one
+   * entry, so the agent's high-frequency receive loop costs one
+   * retrieve and no string parsing, and several commands can be
+   * batched into one round trip.
+   *
+   * Frame layout (all lengths LEB128 varints):
+   *
+   *   byte 0   magic 0xFA
+   *   byte 1   magic 0x57
+   *   byte 2   version           (2)
+   *   byte 3   frame type        (command_frame | reply_frame)
+   *   varint   uuid length, followed by the uuid bytes
+   *   varint   entry count
+   *   entries: byte    status    (status_ok unless a reply reports an error)
+   *            varint  name length, followed by the name bytes
+   *            varint  args length, followed by the args bytes
+   *
+   * decode() refuses anything that is not a well-formed V2 frame, so
+   * callers can fall back to the V1 text path for old peers.
+   */
+
+  unsigned char const magic_0       = 0xFA;
+  unsigned char const magic_1       = 0x57;
+  unsigned char const version       = 0x02;
+
+  unsigned char const command_frame = 0x01;
+  unsigned char const reply_frame   = 0x02;
+
+  unsigned char const status_ok     = 0x00;
+  unsigned char const status_error  = 0x01;
+
+  //////////////////////////////////////////////////////////////////////////
+  // one command (or one per-command reply) inside a frame
+  struct command
+  {
+    std::string   name;
+    std::string   args;
+    unsigned char status;
+
+    command() : status(status_ok) {}
+    command(std::string const & n, std::string const & a,
+            unsigned char s = status_ok)
+      : name(n), args(a), status(s) {}
+  };
+
+  //////////////////////////////////////////////////////////////////////////
+  // a batched multi-command frame
+  struct frame
+  {
+    unsigned char        type;
+    std::string          uuid;
+    std::vector<command> commands;
+
+    frame() : type(command_frame) {}
+    frame(unsigned char t, std::string const & u) : type(t), uuid(u) {}
+
+    void add(std::string const & name, std::string const & args = "",
+             unsigned char status = status_ok)
+    {
+      commands.push_back(command(name, args, status));
+    }
+  };
+
+  namespace detail {
+
+    inline void append_varint(std::string & out, std::size_t v)
+    {
+      while(v >= 0x80) {
+        out += static_cast<char>((v & 0x7F) | 0x80);
+        v >>= 7;
+      }
+      out += static_cast<char>(v);
+    }
+
+    inline bool parse_varint(std::string const & in, std::size_t & pos,
+                             std::size_t & v)
+    {
+      v = 0; unsigned int shift = 0;
+      while(pos < in.size() && shift <= 28) {
+        unsigned char b = static_cast<unsigned char>(in[pos++]);
+        v |= static_cast<std::size_t>(b & 0x7F) << shift;
+        if(0 == (b & 0x80)) return true;
+        shift += 7;
+      }
+      return false; // truncated or oversized
+    }
+
+    inline void append_string(std::string & out, std::string const & s)
+    {
+      append_varint(out, s.size());
+      out.append(s);
+    }
+
+    inline bool parse_string(std::string const & in, std::size_t & pos,
+                             std::string & s)
+    {
+      std::size_t len = 0;
+      if(!parse_varint(in, pos, len)) return false;
+      if(pos + len > in.size())       return false;
+      s.assign(in, pos, len);
+      pos += len;
+      return true;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // serializes a frame into a blob suitable for one advert entry
+  inline std::string encode(frame const & f)
+  {
+    std::string out;
+    out += static_cast<char>(magic_0);
+    out += static_cast<char>(magic_1);
+    out += static_cast<char>(version);
+    out += static_cast<char>(f.type);
+
+    detail::append_string(out, f.uuid);
+    detail::append_varint(out, f.commands.size());
+
+    for(std::size_t i = 0; i < f.commands.size(); ++i) {
+      out += static_cast<char>(f.commands[i].status);
+      detail::append_string(out, f.commands[i].name);
+      detail::append_string(out, f.commands[i].args);
+    }
+    return out;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // parses a blob into a frame. Returns false for anything that is not
+  // a well-formed V2 frame - including V1 text commands - so the caller
+  // can fall back to the legacy path.
+  inline bool decode(std::string const & blob, frame & f)
+  {
+    if(blob.size() < 4)                                          return false;
+    if(static_cast<unsigned char>(blob[0]) != magic_0)           return false;
+    if(static_cast<unsigned char>(blob[1]) != magic_1)           return false;
+    if(static_cast<unsigned char>(blob[2]) != version)           return false;
+
+    f.type = static_cast<unsigned char>(blob[3]);
+    if(f.type != command_frame && f.type != reply_frame)         return false;
+
+    std::size_t pos = 4;
+    if(!detail::parse_string(blob, pos, f.uuid))                 return false;
+
+    std::size_t count = 0;
+    if(!detail::parse_varint(blob, pos, count))                  return false;
+
+    f.commands.clear();
+    for(std::size_t i = 0; i < count; ++i) {
+      if(pos >= blob.size())                                     return false;
+      command c;
+      c.status = static_cast<unsigned char>(blob[pos++]);
+      if(!detail::parse_string(blob, pos, c.name))               return false;
+      if(!detail::parse_string(blob, pos, c.args))               return false;
+      f.commands.push_back(c);
+    }
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // builds the reply frame acknowledging every command of 'received'
+  inline frame make_reply(frame const & received)
+  {
+    frame reply(reply_frame, received.uuid);
+    for(std::size_t i = 0; i < received.commands.size(); ++i) {
+      reply.add(received.commands[i].name, "", status_ok);
+    }
+    return reply;
+  }
+
+}} // namespace faust::protocol
+
+#endif /*FAUST_PROTOCOL_HPP*/
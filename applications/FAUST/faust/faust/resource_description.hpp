@@ -19,10 +19,11 @@
 
 #include <faust/faust/object.hpp>
 #include <faust/faust/defines.hpp>
+#include <faust/faust/typed_attributes.hpp>
 
 namespace faust
-{    
-  // fwd. decl. implementation class // 
+{
+  // fwd. decl. implementation class //
   ///@cond - exclude from Doxygen
   namespace agent {class app; }
   namespace impl { class resource_description; class resource; }
@@ -217,11 +218,52 @@ namespace faust
     /*! \brief Returns a list of all defined attribute key.
      *
      */
-    std::vector<std::string> list_attributes() const 
+    std::vector<std::string> list_attributes() const
     {
-      return saga::detail::attribute<faust::resource_description> ::list_attributes(); 
+      return saga::detail::attribute<faust::resource_description> ::list_attributes();
     }
   };
+
+  namespace typed
+  {
+    /*! \brief Compile-time %attribute tags for faust::resource_description.
+     *         Each tag binds one of the string keys above to a fixed slot of
+     *         a faust::typed::view (see typed_attributes.hpp).
+     */
+    namespace resource_description
+    {
+      typedef std::vector<std::string> strvec_type;
+
+      FAUST_TYPED_ATTRIBUTE(identifier,              faust::attributes::resource_description::identifier,              std::string,  0)
+      FAUST_TYPED_ATTRIBUTE(faust_agent_submit_url,  faust::attributes::resource_description::faust_agent_submit_url,  std::string,  1)
+      FAUST_TYPED_ATTRIBUTE(faust_agent_binary_path, faust::attributes::resource_description::faust_agent_binary_path, std::string,  2)
+      FAUST_TYPED_ATTRIBUTE(saga_root_path,          faust::attributes::resource_description::saga_root_path,          std::string,  3)
+      FAUST_TYPED_ATTRIBUTE(environment,             faust::attributes::resource_description::environment,             strvec_type,  4)
+
+      FAUST_TYPED_ATTRIBUTE(dir_id,                  faust::attributes::resource_description::dir_id,                  strvec_type,  5)
+      FAUST_TYPED_ATTRIBUTE(dir_update_interval,     faust::attributes::resource_description::dir_update_interval,     strvec_type,  6)
+      FAUST_TYPED_ATTRIBUTE(dir_path,                faust::attributes::resource_description::dir_path,                strvec_type,  7)
+      FAUST_TYPED_ATTRIBUTE(dir_dev_space_total_cmd, faust::attributes::resource_description::dir_dev_space_total_cmd, strvec_type,  8)
+      FAUST_TYPED_ATTRIBUTE(dir_dev_space_used_cmd,  faust::attributes::resource_description::dir_dev_space_used_cmd,  strvec_type,  9)
+      FAUST_TYPED_ATTRIBUTE(dir_quota_total_cmd,     faust::attributes::resource_description::dir_quota_total_cmd,     strvec_type, 10)
+      FAUST_TYPED_ATTRIBUTE(dir_quota_used_cmd,      faust::attributes::resource_description::dir_quota_used_cmd,      strvec_type, 11)
+
+      FAUST_TYPED_ATTRIBUTE(queue_id,                faust::attributes::resource_description::queue_id,                strvec_type, 12)
+      FAUST_TYPED_ATTRIBUTE(queue_name,              faust::attributes::resource_description::queue_name,              strvec_type, 13)
+      FAUST_TYPED_ATTRIBUTE(queue_update_interval,   faust::attributes::resource_description::queue_update_interval,   strvec_type, 14)
+      FAUST_TYPED_ATTRIBUTE(queue_nodes_total_cmd,   faust::attributes::resource_description::queue_nodes_total_cmd,   strvec_type, 15)
+      FAUST_TYPED_ATTRIBUTE(queue_nodes_busy_cmd,    faust::attributes::resource_description::queue_nodes_busy_cmd,    strvec_type, 16)
+      FAUST_TYPED_ATTRIBUTE(queue_nodes_down_cmd,    faust::attributes::resource_description::queue_nodes_down_cmd,    strvec_type, 17)
+      FAUST_TYPED_ATTRIBUTE(queue_nodes_queued_cmd,  faust::attributes::resource_description::queue_nodes_queued_cmd,  strvec_type, 18)
+
+      static const int num_slots = 19;
+
+      /*! \brief Typed %view over a faust::resource_description.
+       *
+       */
+      typedef faust::typed::view<faust::resource_description, num_slots> view;
+    }
+  }
 }
 
 #endif /* FAUST_RESOURCE_DESCRIPTION_HPP */
@@ -111,12 +111,20 @@ resource_monitor::~resource_monitor()
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-std::vector<std::string> resource_monitor::list_attributes() const 
+std::vector<std::string> resource_monitor::list_attributes() const
 {
   get_impl()->read_attributes();
   return saga::detail::attribute<faust::resource_monitor> ::list_attributes();
 }
 
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::vector<std::string> resource_monitor::get_history(std::string key) const
+{
+  return get_impl()->get_history(key);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //  implement the attribute functions (we need to explicitly specialize 
 //  the template because the functions are not implemented inline)
@@ -149,8 +149,21 @@ namespace faust
     /*! \brief Returns a list of all defined attribute key.
      *
      */
-    std::vector<std::string> list_attributes() const;     
-    
+    std::vector<std::string> list_attributes() const;
+
+    /*! \brief Returns the recorded sample history of the metric
+     *         identified by 'key', oldest sample first.
+     *
+     *   The monitoring agent keeps a fixed-size ring buffer of past
+     *   samples per metric and publishes it in batches, so one call
+     *   retrieves hours of history instead of polling %get_attribute.
+     *   Each entry has the form <code>time:value</code>, where time is
+     *   seconds since the epoch and value holds the comma-joined values
+     *   of all monitored instances (dirs, queues, ...).
+     *
+     */
+    std::vector<std::string> get_history(std::string key) const;
+
   };
 }
 
@@ -59,6 +59,21 @@ job service::create_job(job_description job_desc, job job_obj, dependency dep)
   return get_impl()->create_job(job_desc, job_obj, dep);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+std::vector<job> service::create_jobs(std::vector<job_description> job_descs)
+{
+  return get_impl()->create_jobs(job_descs);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::vector<job> service::create_jobs(job_template job_tmpl,
+                                      std::vector<std::vector<std::string> > args_list)
+{
+  return get_impl()->create_jobs(job_tmpl, args_list);
+}
+
 /*////////////////////////////////////////////////////////////////////////////////
 //
 job service::create_job(description job_desc, job_group job_group_obj, dependency dep)
@@ -111,6 +126,34 @@ std::vector<std::string> service::list_resource_descriptions()
   return get_impl()->list_resource_descriptions();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+faust::state service::get_job_state(std::string job_id)
+{
+  return get_impl()->get_job_state(job_id);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::map<std::string, faust::state> service::get_job_states(void)
+{
+  return get_impl()->get_job_states();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::string service::wait_any(std::vector<std::string> job_ids, double timeout)
+{
+  return get_impl()->wait_any(job_ids, timeout);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+bool service::wait_all(std::vector<std::string> job_ids, double timeout)
+{
+  return get_impl()->wait_all(job_ids, timeout);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 faust::job service::get_job(std::string job_id)
@@ -125,6 +168,22 @@ faust::resource_description service::get_resource_description(std::string contac
   return get_impl()->get_resource_description(contact);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+void service::update_placement_index(std::string contact,
+                                     faust::resource_monitor monitor)
+{
+  get_impl()->update_placement_index(contact, monitor);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::vector<std::string>
+service::select_resources(faust::placement_criterion criterion, unsigned int k)
+{
+  return get_impl()->select_resources(criterion, k);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 /*faust::job_group service::get_job_group(std::string job_id)
@@ -13,13 +13,16 @@
 #ifndef FAUST_SERVICE_HPP
 #define FAUST_SERVICE_HPP
 
+#include <map>
 #include <boost/shared_ptr.hpp>
 
 #include <faust/faust/object.hpp>
 #include <faust/faust/exports.hpp>
 #include <faust/faust/state.hpp>
+#include <faust/faust/placement.hpp>
 #include <faust/faust/job.hpp>
 #include <faust/faust/job_group.hpp>
+#include <faust/faust/job_template.hpp>
 #include <faust/faust/resource.hpp>
 #include <faust/faust/dependency.hpp>
 
@@ -109,7 +112,61 @@ namespace faust
        * 
        */
       job create_job(job_description job_desc, job job_obj, dependency dep);
-      
+
+      /*! \brief  Creates a new %job instance for each of the provided
+       *          %job descriptions, without dependencies to other jobs.
+       *
+       *          All jobs are created and registered with this %service
+       *          instance in one pass, so submitting large ensembles
+       *          costs a single call instead of one %create_job round
+       *          trip per %job.
+       *
+       *          <b>Example:</b><br>
+       *          <code>
+       *          std::vector&lt;faust::job_description&gt; descs;<br>
+       *          descs.push_back(jd1);<br>
+       *          descs.push_back(jd2);<br>
+       *          descs.push_back(jd3);<br>
+       *          <br>
+       *          faust::service s(resource_descriptions);<br>
+       *          std::vector&lt;faust::job&gt; jobs = s.create_jobs(descs);<br>
+       *          </code>
+       *
+       *  \param  job_descs A list of %job %description objects describing
+       *          the %job properties.
+       *
+       *  \return The new %job objects, in the order of their descriptions.
+       *
+       */
+      std::vector<job> create_jobs(std::vector<job_description> job_descs);
+
+      /*! \brief  Creates a new %job instance for every argument vector
+       *          in args_list, all sharing the precompiled template.
+       *
+       *          This is the submission path for parameter sweeps: the
+       *          invariant %job properties were validated and
+       *          serialized once when the %job_template was compiled,
+       *          so each instance only costs its argument splice (see
+       *          faust/faust/job_template.hpp).
+       *
+       *          <b>Example:</b><br>
+       *          <code>
+       *          faust::job_template t(jd);<br>
+       *          std::vector&lt;std::vector&lt;std::string&gt; &gt; args(1000);<br>
+       *          // ... fill in the per-instance arguments ...<br>
+       *          std::vector&lt;faust::job&gt; jobs = s.create_jobs(t, args);<br>
+       *          </code>
+       *
+       *  \param  job_tmpl The precompiled %job_template.
+       *  \param  args_list One argument vector per %job instance.
+       *
+       *  \return The new %job objects, in the order of their argument
+       *          vectors.
+       *
+       */
+      std::vector<job> create_jobs(job_template job_tmpl,
+                                   std::vector<std::vector<std::string> > args_list);
+
 //      /* \brief  Creates a new %job instance which depends on the execution
 //       *          state of the provided %job_group object.
 //       *
@@ -216,8 +273,68 @@ namespace faust
        */
       std::vector<std::string> list_resource_descriptions(void); 
       
+      /*! \brief  Returns the current %state of the %job identified by
+       *          job_id.
+       *
+       *          States are served from a cache with bounded staleness
+       *          (a few seconds) - querying them for many jobs in a
+       *          row does not multiply the load on the backend.
+       *
+       *  \return The current %job %state.
+       *
+       */
+      faust::state get_job_state(std::string job_id);
+
+      /*! \brief  Returns the current states of all jobs that are
+       *          associated with this %service instance, keyed by
+       *          their %job IDs.
+       *
+       *          This is the query a monitoring front-end should use
+       *          for its refresh cycle: the whole map is produced from
+       *          one cache refresh, independent of the number of jobs.
+       *
+       *  \return Map from %job ID to %job %state.
+       *
+       */
+      std::map<std::string, faust::state> get_job_states(void);
+
+      /*! \brief  Blocks until any %job of the given set reaches a final
+       *          %state (Done, Canceled or Failed).
+       *
+       *          All waiting clients of a %service share one completion
+       *          event multiplexer: state changes are detected by a
+       *          single sweep and signalled to every waiter, so waiting
+       *          on large %job sets does not burn CPU in per-client
+       *          poll loops.
+       *
+       *  \param  job_ids The %job IDs to wait on.
+       *  \param  timeout Seconds to wait; a negative value waits
+       *                  forever.
+       *  \return The ID of a finished %job, or the empty string if the
+       *          timeout elapsed first.
+       *
+       */
+      std::string wait_any(std::vector<std::string> job_ids,
+                           double timeout = -1.0);
+
+      /*! \brief  Blocks until every %job of the given set reaches a
+       *          final %state (Done, Canceled or Failed).
+       *
+       *          Shares the completion event multiplexer with
+       *          %wait_any.
+       *
+       *  \param  job_ids The %job IDs to wait on.
+       *  \param  timeout Seconds to wait; a negative value waits
+       *                  forever.
+       *  \return True once all jobs are final, false if the timeout
+       *          elapsed first.
+       *
+       */
+      bool wait_all(std::vector<std::string> job_ids,
+                    double timeout = -1.0);
+
       /*! \brief  Returns a %job object for a given %job ID.
-       *         
+       *
        *  \return The %job object.
        *
        */
@@ -231,12 +348,44 @@ namespace faust
 //    faust::job_group get_job_group(std::string job_id);
       
       /*! \brief  Returns a %resource_description %description for a given contact string.
-       *         
+       *
        *  \return The job object.
        *
        */
       faust::resource_description get_resource_description(std::string contact);
-      
+
+      /*! \brief  Feeds the placement index with the current monitor
+       *          figures of the given %resource.
+       *
+       *          The queue and load attributes are parsed once here;
+       *          subsequent placement queries are served from pre-sorted
+       *          rankings and never re-read attributes.
+       *
+       *  \param  contact The %resource contact string.
+       *  \param  monitor The %resource_monitor carrying the figures.
+       *
+       */
+      void update_placement_index(std::string contact,
+                                  faust::resource_monitor monitor);
+
+      /*! \brief  Returns the top-k %resource contact strings for the
+       *          given placement criterion, best candidate first.
+       *
+       *          <b>Example:</b><br>
+       *          <code>
+       *          std::vector&lt;std::string&gt; c =
+       *            s.select_resources(faust::PlacementFreeNodes, 3);<br>
+       *          </code>
+       *
+       *  \param  criterion The ranking criterion (see
+       *          faust::placement_criterion).
+       *  \param  k Maximum number of candidates to return.
+       *  \return Up to k contact strings, best first.
+       *
+       */
+      std::vector<std::string> select_resources(
+        faust::placement_criterion criterion, unsigned int k);
+
     };
 }
 
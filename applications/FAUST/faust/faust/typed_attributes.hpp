@@ -0,0 +1,197 @@
+/*
+ *  typed_attributes.hpp
+ *  FAUST - Framework for Adaptive Ubiquitous Scalable Tasks
+ *  Website: https://macpro01.cct.lsu.edu/trac/faust
+ *
+ *  Created by Ole Weidner <oweidner@cct.lsu.edu> on 08/31/09.
+ *  Copyright 2008-2009 Center for Computation & Technology.
+ *
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
+ *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#ifndef FAUST_TYPED_ATTRIBUTES_HPP
+#define FAUST_TYPED_ATTRIBUTES_HPP
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+namespace faust
+{
+  /*! \brief Compile-time typed access to the string-keyed %attribute
+   *         interface of the description classes.
+   *
+   *         Every %attribute access through saga::detail::attribute goes
+   *         through a string-keyed map lookup plus (for numeric values) a
+   *         lexical cast at the caller. Code that reads many attributes per
+   *         decision - the scheduler reads dozens per placement - pays that
+   *         price on every read. The typed layer maps each %attribute to a
+   *         fixed slot at compile time: the first read of a slot fetches and
+   *         parses the string value once, subsequent reads are plain array
+   *         indexing. Writes go through to the string API, which stays
+   *         authoritative, so typed and string-keyed access can be mixed
+   *         freely on the same object.
+   */
+  namespace typed
+  {
+    /*! \brief One fixed cache slot: the raw string value, its vector and
+     *         numeric forms, and a validity flag. Only the forms matching
+     *         the owning tag's value_type are meaningful.
+     */
+    struct slot
+    {
+      bool                     valid;
+      std::string              scalar;
+      std::vector<std::string> vector;
+      double                   number;
+
+      slot() : valid(false), number(0.0) {}
+    };
+
+    /// @cond - hide from Doxygen
+    /** Selects at compile time how a slot converts to/from the tag's
+      * value_type. Not within API scope. */
+    template <typename T> struct convert;
+
+    template <> struct convert<std::string>
+    {
+      static const bool is_vector = false;
+      static std::string const & get(slot const & s) { return s.scalar; }
+      static void put(slot & s, std::string const & v)
+      {
+        s.scalar = v;
+        s.number = ::atof(v.c_str());
+      }
+    };
+
+    template <> struct convert<int>
+    {
+      static const bool is_vector = false;
+      static int get(slot const & s) { return static_cast<int>(s.number); }
+      static void put(slot & s, int v)
+      {
+        s.scalar = boost::lexical_cast<std::string>(v);
+        s.number = v;
+      }
+    };
+
+    template <> struct convert<double>
+    {
+      static const bool is_vector = false;
+      static double get(slot const & s) { return s.number; }
+      static void put(slot & s, double v)
+      {
+        s.scalar = boost::lexical_cast<std::string>(v);
+        s.number = v;
+      }
+    };
+
+    template <> struct convert<std::vector<std::string> >
+    {
+      static const bool is_vector = true;
+      static std::vector<std::string> const & get(slot const & s)
+      {
+        return s.vector;
+      }
+      static void put(slot & s, std::vector<std::string> const & v)
+      {
+        s.vector = v;
+      }
+    };
+    /// @endcond
+
+    /*! \brief A typed %view over a description %object. NumSlots is the
+     *         number of attribute tags declared for the description type;
+     *         each tag indexes one slot of a fixed array.
+     *
+     *         The %view caches parsed values, so it must not outlive the
+     *         description it wraps, and invalidate() has to be called if
+     *         the description was modified through the string API behind
+     *         the view's back.
+     */
+    template <typename Description, int NumSlots>
+    class view
+    {
+
+    private:
+
+      Description & description_;
+      slot          slots_[NumSlots];
+
+      template <typename Tag>
+      void refresh(slot & s)
+      {
+        if (convert<typename Tag::value_type>::is_vector) {
+          s.vector = description_.get_vector_attribute(Tag::key());
+        }
+        else {
+          s.scalar = description_.get_attribute(Tag::key());
+          s.number = ::atof(s.scalar.c_str());
+        }
+        s.valid = true;
+      }
+
+    public:
+
+      /*! \brief Creates a typed %view over 'description'.
+       *
+       */
+      explicit view(Description & description) : description_(description) {}
+
+      /*! \brief Returns the value of the %attribute identified by 'Tag',
+       *         converted to the tag's value_type. The underlying string
+       *         %attribute is fetched and parsed on the first call only.
+       */
+      template <typename Tag>
+      typename Tag::value_type get()
+      {
+        slot & s = slots_[Tag::index];
+        if (!s.valid) refresh<Tag>(s);
+        return convert<typename Tag::value_type>::get(s);
+      }
+
+      /*! \brief Sets the value of the %attribute identified by 'Tag' and
+       *         writes it through to the string API.
+       */
+      template <typename Tag>
+      void set(typename Tag::value_type const & value)
+      {
+        slot & s = slots_[Tag::index];
+        convert<typename Tag::value_type>::put(s, value);
+        s.valid = true;
+
+        if (convert<typename Tag::value_type>::is_vector) {
+          description_.set_vector_attribute(Tag::key(), s.vector);
+        }
+        else {
+          description_.set_attribute(Tag::key(), s.scalar);
+        }
+      }
+
+      /*! \brief Drops all cached values. The next get() per slot re-reads
+       *         the string %attribute.
+       */
+      void invalidate()
+      {
+        for (int i = 0; i < NumSlots; ++i) slots_[i].valid = false;
+      }
+    };
+  }
+}
+
+/*! \brief Declares a compile-time %attribute tag: 'name' becomes a struct
+ *         binding the string key 'key_expr' to slot 'idx' with value type
+ *         'type'. Tags for one description type share a contiguous index
+ *         range starting at 0.
+ */
+#define FAUST_TYPED_ATTRIBUTE(name, key_expr, type, idx)                      \
+  struct name {                                                               \
+    typedef type value_type;                                                  \
+    static const int index = idx;                                             \
+    static char const * key() { return key_expr; }                            \
+  };
+
+#endif /* FAUST_TYPED_ATTRIBUTES_HPP */
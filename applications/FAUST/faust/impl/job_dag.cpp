@@ -4,11 +4,163 @@
  *  Website: https://macpro01.cct.lsu.edu/trac/faust
  *
  *  Created by Ole Weidner <oweidner@cct.lsu.edu> on 12/10/08.
- *  Copyright 2008-2009 Center for Computation & Technology. 
+ *  Copyright 2008-2009 Center for Computation & Technology.
  *
- *  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
  *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
  */
 
 #include <faust/impl/job_dag.hpp>
+#include <faust/faust/exception.hpp>
+
+using namespace faust::detail;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+job_dag::job_dag()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+job_dag::~job_dag()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+DAGVertex job_dag::find_vertex_(std::string job_id, bool & found)
+{
+  boost::graph_traits<DAG>::vertex_iterator vi, vi_end;
+  for(boost::tie(vi, vi_end) = boost::vertices(dag_); vi != vi_end; ++vi)
+  {
+    if(dag_[*vi].name == job_id) {
+      found = true;
+      return *vi;
+    }
+  }
+
+  found = false;
+  return DAGVertex();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void job_dag::add_job(faust::job job)
+{
+  DAGVertex v = boost::add_vertex(dag_);
+  dag_[v].name = job.get_job_id();
+  dag_[v].job  = job;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void job_dag::add_dependency(std::string job_id, std::string dep_job_id,
+                             faust::dependency dep)
+{
+  bool found_job = false;
+  bool found_dep = false;
+
+  DAGVertex v = find_vertex_(job_id,     found_job);
+  DAGVertex u = find_vertex_(dep_job_id, found_dep);
+
+  if(!found_job)
+    throw faust::exception ("JobID '"+job_id+"' is not part of this job group.",
+                            faust::BadParameter);
+  if(!found_dep)
+    throw faust::exception ("JobID '"+dep_job_id+"' is not part of this job group.",
+                            faust::BadParameter);
+
+  // the edge runs from the prerequisite to the dependent job
+  DAGEdge e; bool inserted;
+  boost::tie(e, inserted) = boost::add_edge(u, v, dag_);
+  dag_[e].name     = dep_job_id + " -> " + job_id;
+  dag_[e].dep_type = dep;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::vector<faust::job> job_dag::get_jobs()
+{
+  std::vector<faust::job> jobs;
+
+  boost::graph_traits<DAG>::vertex_iterator vi, vi_end;
+  for(boost::tie(vi, vi_end) = boost::vertices(dag_); vi != vi_end; ++vi)
+    jobs.push_back(dag_[*vi].job);
+
+  return jobs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::vector<std::string> job_dag::list_jobs()
+{
+  std::vector<std::string> ids;
+
+  boost::graph_traits<DAG>::vertex_iterator vi, vi_end;
+  for(boost::tie(vi, vi_end) = boost::vertices(dag_); vi != vi_end; ++vi)
+    ids.push_back(dag_[*vi].name);
+
+  return ids;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::vector<std::vector<faust::job> > job_dag::get_waves()
+{
+  unsigned int n = boost::num_vertices(dag_);
+
+  std::vector<unsigned int> depth(n, 0);
+
+  // relax Data edges (dependent sits below its prerequisite) and align
+  // Communication edges (both endpoints share a wave) until nothing
+  // moves. A depth can never legitimately exceed the vertex count, so
+  // that many passes suffice - if depths still change, the Data
+  // dependencies must be cyclic.
+  bool changed = true;
+  unsigned int pass = 0;
+
+  while(changed)
+  {
+    if(++pass > n + 1)
+      throw faust::exception ("The job dependencies contain a cycle.",
+                              faust::BadParameter);
+    changed = false;
+
+    boost::graph_traits<DAG>::edge_iterator ei, ei_end;
+    for(boost::tie(ei, ei_end) = boost::edges(dag_); ei != ei_end; ++ei)
+    {
+      DAGVertex u = boost::source(*ei, dag_);
+      DAGVertex v = boost::target(*ei, dag_);
+
+      if(dag_[*ei].dep_type == faust::Communication)
+      {
+        unsigned int d = std::max(depth[u], depth[v]);
+        if(depth[u] != d || depth[v] != d) {
+          depth[u] = d; depth[v] = d;
+          changed = true;
+        }
+      }
+      else // faust::Data
+      {
+        if(depth[v] < depth[u] + 1) {
+          depth[v] = depth[u] + 1;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  unsigned int max_depth = 0;
+  for(unsigned int i = 0; i < n; ++i)
+    max_depth = std::max(max_depth, depth[i]);
+
+  std::vector<std::vector<faust::job> > waves(n ? max_depth + 1 : 0);
+
+  boost::graph_traits<DAG>::vertex_iterator vi, vi_end;
+  for(boost::tie(vi, vi_end) = boost::vertices(dag_); vi != vi_end; ++vi)
+    waves[depth[*vi]].push_back(dag_[*vi].job);
+
+  return waves;
+}
 
@@ -4,9 +4,9 @@
  *  Website: https://macpro01.cct.lsu.edu/trac/faust
  *
  *  Created by Ole Weidner <oweidner@cct.lsu.edu> on 12/10/08.
- *  Copyright 2008-2009 Center for Computation & Technology. 
+ *  Copyright 2008-2009 Center for Computation & Technology.
  *
- *  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
  *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
  */
 
@@ -24,35 +24,59 @@
 
 
 namespace faust { namespace detail {
-  
+
   struct DAG_vertex_properties {
     std::string name;
     faust::job job;
   };
-  
+
   struct DAG_edge_properties {
     std::string name;
     faust::dependency dep_type;
   };
-  
-  typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS, 
+
+  // dependencies are directed: an edge runs from the prerequisite job
+  // to the job that depends on it
+  typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::bidirectionalS,
     DAG_vertex_properties, DAG_edge_properties> DAG;
-  
+
   typedef boost::graph_traits<DAG>::vertex_descriptor DAGVertex;
   typedef boost::graph_traits<DAG>::edge_descriptor DAGEdge;
 
-  class job_dag{ 
-    
+  class job_dag{
+
   private:
     DAG dag_;
-    
+
+    DAGVertex find_vertex_(std::string job_id, bool & found);
+
   public:
     job_dag();
     ~job_dag();
-    
-    
+
+    /* add a job as a new vertex */
+    void add_job(faust::job job);
+
+    /* declare that 'job_id' depends on 'dep_job_id'. Throws
+     * faust::BadParameter if either job is not part of this DAG. */
+    void add_dependency(std::string job_id, std::string dep_job_id,
+                        faust::dependency dep);
+
+    /* all jobs, in insertion order */
+    std::vector<faust::job> get_jobs();
+
+    /* the IDs of all jobs, in insertion order */
+    std::vector<std::string> list_jobs();
+
+    /* partition the jobs into 'waves': every job sits in a later wave
+     * than all jobs it has a Data dependency on, and in the same wave
+     * as jobs it has a Communication dependency with. Jobs within one
+     * wave can run concurrently. Throws faust::BadParameter if the
+     * Data dependencies contain a cycle. */
+    std::vector<std::vector<faust::job> > get_waves();
+
   };
-  
+
 } }
 
 #endif /* FAUST_IMPL_JOB_DAG_HPP */
@@ -1,12 +1,12 @@
 /*
- *  job_group_impl.cpp 
+ *  job_group_impl.cpp
  *  FAUST - Framework for Adaptive Ubiquitous Scalable Tasks
  *  Website: https://macpro01.cct.lsu.edu/trac/faust
  *
  *  Created by Ole Weidner <oweidner@cct.lsu.edu> on 11/30/08.
- *  Copyright 2008-2009 Center for Computation & Technology. 
+ *  Copyright 2008-2009 Center for Computation & Technology.
  *
- *  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
  *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
  */
 
@@ -17,46 +17,133 @@ using namespace faust::impl;
 ////////////////////////////////////////////////////////////////////////////////
 // CONSTRUCTOR
 //
-job_group::job_group() 
+job_group::job_group()
 : object(faust::object::JobGroup)
 {
   std::string jobid("faust://");
   jobid.append(saga::uuid().string());
-  jobid_ = jobid;          
+  jobid_ = jobid;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void job_group::add_job(faust::job job)
+{
+  dag_.add_job(job);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void job_group::add_dependency(std::string job_id, std::string dep_job_id,
+                               faust::dependency dep)
+{
+  dag_.add_dependency(job_id, dep_job_id, dep);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void job_group::wait_for_wave_(std::vector<faust::job> & wave)
+{
+  // one state query per job and sweep - states are batched per wave,
+  // not chased job by job
+  while(1)
+  {
+    bool busy = false;
+
+    std::vector<faust::job>::iterator it;
+    for(it = wave.begin(); it != wave.end(); ++it)
+    {
+      faust::state s = (*it).get_state();
+
+      if(s == faust::Pending || s == faust::Running)
+        busy = true;
+    }
+
+    if(!busy) return;
+
+    sleep(1);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
 void job_group::run()
 {
+  // topologically schedule the group: jobs partition into waves (see
+  // job_dag::get_waves), all jobs of a wave run concurrently, and a
+  // wave starts only once the previous one has drained
+  std::vector<std::vector<faust::job> > waves = dag_.get_waves();
+
+  std::vector<std::vector<faust::job> >::iterator wit;
+  for(wit = waves.begin(); wit != waves.end(); ++wit)
+  {
+    std::vector<faust::job>::iterator it;
+    for(it = (*wit).begin(); it != (*wit).end(); ++it)
+    {
+      (*it).run();
+    }
+
+    // the last wave is left to wait()/the caller
+    if(wit + 1 != waves.end())
+      wait_for_wave_(*wit);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
 bool job_group::wait(double timeout)
 {
-  return false;
+  std::vector<faust::job> jobs = dag_.get_jobs();
+  wait_for_wave_(jobs);
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
 bool job_group::cancel(double timeout)
 {
-  return false;
+  bool ret = true;
+
+  std::vector<faust::job> jobs = dag_.get_jobs();
+  std::vector<faust::job>::iterator it;
+  for(it = jobs.begin(); it != jobs.end(); ++it)
+  {
+    if(!(*it).cancel(timeout)) ret = false;
+  }
+
+  return ret;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
 bool job_group::suspend()
 {
-  return false;
+  bool ret = true;
+
+  std::vector<faust::job> jobs = dag_.get_jobs();
+  std::vector<faust::job>::iterator it;
+  for(it = jobs.begin(); it != jobs.end(); ++it)
+  {
+    if(!(*it).suspend()) ret = false;
+  }
+
+  return ret;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
 bool job_group::resume()
 {
-  return false;
+  bool ret = true;
+
+  std::vector<faust::job> jobs = dag_.get_jobs();
+  std::vector<faust::job>::iterator it;
+  for(it = jobs.begin(); it != jobs.end(); ++it)
+  {
+    if(!(*it).resume()) ret = false;
+  }
+
+  return ret;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -68,6 +155,5 @@ std::string job_group::get_job_id()
 
 std::vector<std::string> job_group::list_jobs()
 {
-  std::vector<std::string> ids;
-  return ids;
+  return dag_.list_jobs();
 }
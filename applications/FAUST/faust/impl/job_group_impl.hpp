@@ -17,8 +17,10 @@
 #include <faust/faust/job.hpp>
 #include <faust/faust/state.hpp>
 #include <faust/faust/description.hpp>
+#include <faust/faust/dependency.hpp>
 
 #include <faust/impl/object_impl.hpp>
+#include <faust/impl/job_dag.hpp>
 
 namespace faust
 {
@@ -28,14 +30,24 @@ namespace faust
     //
     class  job_group : public faust::impl::object
     {
-        
+
       private:
-        
+
         std::string jobid_;
-        
+
+        // the group's jobs and their dependencies
+        faust::detail::job_dag dag_;
+
+        // poll one wave of concurrently running jobs until none of
+        // them is Pending or Running anymore
+        void wait_for_wave_(std::vector<faust::job> & wave);
+
       public:
-        
+
         job_group();
+        void add_job(faust::job job);
+        void add_dependency(std::string job_id, std::string dep_job_id,
+                            faust::dependency dep);
         void run();
         bool wait(double timeout = -1.0);
         bool cancel(double timeout = -1.0);
@@ -21,7 +21,8 @@ job::job()
 {
   std::string jobid("faust://");
   jobid.append(saga::uuid().string());
-  jobid_ = jobid;          
+  jobid_ = jobid;
+  state_ = faust::New;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -4,9 +4,9 @@
  *  Website: https://macpro01.cct.lsu.edu/trac/faust
  *
  *  Created by Ole Weidner <oweidner@cct.lsu.edu> on 11/23/08.
- *  Copyright 2008-2009 Center for Computation & Technology. 
+ *  Copyright 2008-2009 Center for Computation & Technology.
  *
- *  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
  *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
  */
 
@@ -14,6 +14,8 @@
 #include <time.h>
 #include <iostream>
 
+#include <boost/bind.hpp>
+
 #include <faust/impl/logwriter.hpp>
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -21,7 +23,7 @@
 faust::detail::logwriter::logwriter(void)
 : appName_(""), out_(std::cout)
 {
-  
+  start_();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -29,7 +31,7 @@ faust::detail::logwriter::logwriter(void)
 faust::detail::logwriter::logwriter(std::string appName)
 : appName_(appName), out_(std::cout)
 {
-  
+  start_();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -37,7 +39,7 @@ faust::detail::logwriter::logwriter(std::string appName)
 faust::detail::logwriter::logwriter(std::string appName, std::ostream& logStream = std::cout)
 : appName_(appName), out_(logStream)
 {
-  
+  start_();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -45,44 +47,118 @@ faust::detail::logwriter::logwriter(std::string appName, std::ostream& logStream
 
 faust::detail::logwriter::~logwriter()
 {
-  
+  // copies share the emitter thread - only the last owner stops it,
+  // draining whatever is still queued
+  if(thread_ && thread_.unique())
+  {
+    {
+      boost::mutex::scoped_lock lock(queue_->mtx);
+      queue_->shutdown = true;
+      queue_->cond.notify_one();
+    }
+    thread_->join();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+void faust::detail::logwriter::start_()
+{
+  queue_ = boost::shared_ptr<queue_t>(new queue_t());
+  thread_ = boost::shared_ptr<boost::thread>(
+    new boost::thread(boost::bind(&logwriter::emit_loop_, queue_.get(),
+                                  &out_)));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //
 
 void faust::detail::logwriter::write(std::string message, unsigned int logLevel)
+{
+  // capture the timestamp now, defer all formatting to the emitter
+  // thread - the caller only pays for the enqueue
+  record rec;
+  time(&rec.stamp);
+  rec.level   = logLevel;
+  rec.app     = appName_;
+  rec.message = message;
+
+  boost::mutex::scoped_lock lock(queue_->mtx);
+  queue_->records.push_back(rec);
+  queue_->cond.notify_one();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void faust::detail::logwriter::emit_loop_(queue_t * queue, std::ostream * out)
+{
+  std::deque<record> batch;
+
+  for(;;)
+  {
+    {
+      boost::mutex::scoped_lock lock(queue->mtx);
+
+      while(queue->records.empty() && !queue->shutdown)
+      {
+        queue->cond.wait(lock);
+      }
+
+      batch.swap(queue->records);
+
+      if(batch.empty() && queue->shutdown)
+        return;
+    }
+
+    // format and emit the whole batch outside the lock, with a single
+    // flush at the end
+    std::deque<record>::const_iterator i;
+    for(i = batch.begin(); i != batch.end(); ++i)
+    {
+      emit_(*out, *i);
+    }
+
+    out->flush();
+    batch.clear();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void faust::detail::logwriter::emit_(std::ostream & out, record const & rec)
 {
   // generate timestamp string
-  time_t rawTime; struct tm * timeInfo;
-  time(&rawTime); timeInfo = localtime(&rawTime);
-  out_ << timeInfo->tm_mon << "/" << timeInfo->tm_mday << "/" 
-       << timeInfo->tm_year << " ";
-  out_ << timeInfo->tm_hour << ":" << timeInfo->tm_min << ":" 
-       << timeInfo->tm_sec << "\t ";
-  
+  struct tm * timeInfo;
+  timeInfo = localtime(&rec.stamp);
+  out << timeInfo->tm_mon << "/" << timeInfo->tm_mday << "/"
+      << timeInfo->tm_year << " ";
+  out << timeInfo->tm_hour << ":" << timeInfo->tm_min << ":"
+      << timeInfo->tm_sec << "\t ";
+
   // append application name
-  out_ << appName_ << "\t ";
-  
+  out << rec.app << "\t ";
+
   // append debug level
-  switch(logLevel) {
-      
+  switch(rec.level) {
+
     case(LOGLEVEL_DEBUG):
-      out_ << "[DEBUG]\t"; break;
-      
+      out << "[DEBUG]\t"; break;
+
     case(LOGLEVEL_INFO):
-      out_ << "[INFO]\t"; break;
-      
+      out << "[INFO]\t"; break;
+
     case(LOGLEVEL_WARNING):
-      out_ << "[WARNING]\t"; break;
+      out << "[WARNING]\t"; break;
 
     case(LOGLEVEL_ERROR):
-      out_ << "[ERROR]\t"; break;
-      
+      out << "[ERROR]\t"; break;
+
     case(LOGLEVEL_FATAL):
-      out_ << "[FATAL]\t"; break;
+      out << "[FATAL]\t"; break;
   }
-  
+
   //append message
-  out_ << message << std::endl;
+  out << rec.message << "\n";
 }
@@ -4,9 +4,9 @@
  *  Website: https://macpro01.cct.lsu.edu/trac/faust
  *
  *  Created by Ole Weidner <oweidner@cct.lsu.edu> on 11/23/08.
- *  Copyright 2008-2009 Center for Computation & Technology. 
+ *  Copyright 2008-2009 Center for Computation & Technology.
  *
- *  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
  *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
  */
 
@@ -21,44 +21,99 @@
 #define LOG_WRITE_SUCCESS(S)      { S << " SUCCESS"; log_sptr_->write(SAGA_OSSTREAM_GETSTRING(S), LOGLEVEL_INFO); S.str(""); }
 #define LOG_WRITE_FAILED_AND_THROW(S, M, E) { S << " FAILED: " << M; log_sptr_->write(SAGA_OSSTREAM_GETSTRING(S), LOGLEVEL_ERROR); SAGA_OSSTREAM tmp; tmp << __FILE__ << ":" << __LINE__ << " " << S; throw faust::exception (SAGA_OSSTREAM_GETSTRING(tmp), E); S.str("");}
 
-#define LOGLEVEL_FATAL     0x2   
-#define LOGLEVEL_ERROR     0x4  
-#define LOGLEVEL_WARNING   0x8   
-#define LOGLEVEL_INFO      0x16   
-#define LOGLEVEL_DEBUG     0x32  
+#define LOGLEVEL_FATAL     0x2
+#define LOGLEVEL_ERROR     0x4
+#define LOGLEVEL_WARNING   0x8
+#define LOGLEVEL_INFO      0x16
+#define LOGLEVEL_DEBUG     0x32
 
+// Compile-time log verbosity: call sites gated with the macros below are
+// removed entirely (zero instructions, message expression not evaluated)
+// for levels above this. Build with -DFAUST_LOG_COMPILE_LEVEL=LOGLEVEL_DEBUG
+// to compile debug logging back in.
+#ifndef FAUST_LOG_COMPILE_LEVEL
+#define FAUST_LOG_COMPILE_LEVEL LOGLEVEL_INFO
+#endif
+
+// gated write: the condition folds at compile time, so a disabled level
+// leaves nothing behind - hot loops (e.g. the agent's sampling path) can
+// keep their log statements without paying for them
+#define FAUST_LOG(L, LEVEL, MSG) { if((LEVEL) <= FAUST_LOG_COMPILE_LEVEL) { (L)->write((MSG), (LEVEL)); } }
+
+// gated flavor of LOG_WRITE_SUCCESS_2 for per-iteration success messages
+#define LOG_WRITE_DEBUG_2(L, S)  { if(LOGLEVEL_DEBUG <= FAUST_LOG_COMPILE_LEVEL) { S << " SUCCESS"; L->write(SAGA_OSSTREAM_GETSTRING(S), LOGLEVEL_DEBUG); } S.str(""); }
+
+#include <ctime>
+#include <deque>
 #include <string>
+#include <iosfwd>
 
-namespace faust 
-{ 
-  namespace detail 
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+
+namespace faust
+{
+  namespace detail
   {
     //////////////////////////////////////////////////////////////////////////
     //
     class logwriter {
-      
+
     private:
-      
+
       std::string appName_;
       std::ostream & out_;
-      
+
+      // one queued record: the timestamp is captured when write() is
+      // called, all formatting happens later on the emitter thread
+      struct record {
+        time_t       stamp;
+        unsigned int level;
+        std::string  app;
+        std::string  message;
+      };
+
+      // queue shared between callers and the emitter thread. Copies of
+      // a logwriter share one queue and thread; the last owner shuts
+      // the thread down.
+      struct queue_t {
+        boost::mutex       mtx;
+        boost::condition   cond;
+        std::deque<record> records;
+        bool               shutdown;
+
+        queue_t() : shutdown(false) {}
+      };
+
+      boost::shared_ptr<queue_t>       queue_;
+      boost::shared_ptr<boost::thread> thread_;
+
+      void start_();
+
+      static void emit_loop_(queue_t * queue, std::ostream * out);
+      static void emit_(std::ostream & out, record const & rec);
+
     public:
-      
+
       logwriter();
       logwriter(std::string appName);
       logwriter(std::string appName, std::ostream& logStream);
-      
+
       void setIdentifier(std::string identifier) {appName_ = identifier;};
-      
+
       ~logwriter();
-      
+
+      // enqueues the message; formatting and the stream write happen on
+      // the background emitter thread, in batches with one flush each
       void write(std::string, unsigned int logLevel);
-      
+
     };
     //
-    //////////////////////////////////////////////////////////////////////////    
-  } 
-} 
+    //////////////////////////////////////////////////////////////////////////
+  }
+}
 
 #endif /* FAUST_LOGWRITER_HPP */
 
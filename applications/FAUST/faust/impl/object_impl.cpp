@@ -47,12 +47,45 @@ void object::initialize_faust()
 ////////////////////////////////////////////////////////////////////////////
 //
 object::object (faust::object::type type)
-: type_(type)
+: type_(type), snapshot_(new state_snapshot()), snapshot_version_(0)
 {
   uuid_ = saga::uuid().string();
   initialize_faust();
 }
 
+////////////////////////////////////////////////////////////////////////////
+//
+void object::publish_state (std::map<std::string, std::string> const & scalars,
+                            std::map<std::string, std::vector<std::string> > const & vectors)
+{
+  // the block is assembled outside the lock: a slow attribute sweep on
+  // the writer side never stalls a reader for more than a pointer copy
+  boost::shared_ptr<state_snapshot> snap(new state_snapshot());
+  snap->timestamp = ::time(NULL);
+  snap->scalars   = scalars;
+  snap->vectors   = vectors;
+
+  boost::mutex::scoped_lock lock(snapshot_mtx_);
+  snap->version = ++snapshot_version_;
+  snapshot_     = snap;
+}
+
+////////////////////////////////////////////////////////////////////////////
+//
+state_snapshot_ptr object::get_state_snapshot (void) const
+{
+  boost::mutex::scoped_lock lock(snapshot_mtx_);
+  return snapshot_;
+}
+
+////////////////////////////////////////////////////////////////////////////
+//
+unsigned long object::get_state_version (void) const
+{
+  boost::mutex::scoped_lock lock(snapshot_mtx_);
+  return snapshot_version_;
+}
+
 ////////////////////////////////////////////////////////////////////////////
 //
 faust::object::type object::get_type() const
@@ -13,50 +13,99 @@
 #ifndef FAUST_IMPL_OBJECT_HPP
 #define FAUST_IMPL_OBJECT_HPP
 
+#include <map>
+#include <vector>
+#include <string>
+#include <ctime>
+
 #include <saga/saga.hpp>
 
 #include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <faust/faust/object.hpp>
 #include <faust/impl/logwriter.hpp>
 
-namespace faust 
+namespace faust
 {
-  namespace impl 
+  namespace impl
   {
     //////////////////////////////////////////////////////////////////////////
     //
-    class object : private boost::noncopyable, 
+    // One published state block. A writer assembles a fresh instance off
+    // to the side and publishes it with a single pointer swap; readers
+    // hold it through a shared_ptr to const, so a block can never change
+    // or disappear underneath a reader - there is nothing to lock while
+    // a dashboard walks it. The version counts publications; a reader
+    // that still holds a block with the current version knows its copy
+    // is up to date without fetching anything.
+    //
+    struct state_snapshot
+    {
+      unsigned long                                    version;
+      time_t                                           timestamp;
+      std::map<std::string, std::string>               scalars;
+      std::map<std::string, std::vector<std::string> > vectors;
+
+      state_snapshot() : version(0), timestamp(0) {}
+    };
+
+    typedef boost::shared_ptr<state_snapshot const> state_snapshot_ptr;
+
+    //////////////////////////////////////////////////////////////////////////
+    //
+    class object : private boost::noncopyable,
     public boost::enable_shared_from_this <object>
-    {    
-      
+    {
+
     private:
-      
+
       faust::object::type type_;
       std::string uuid_;
-      
+
+      // the current published state block. snapshot_mtx_ only ever
+      // covers the pointer swap and the pointer copy - never the
+      // assembly of a block on the writer side, never a walk over one
+      // on the reader side - so state queries cannot block an update
+      // (or each other) for more than a pointer copy.
+      state_snapshot_ptr   snapshot_;
+      unsigned long        snapshot_version_;
+      mutable boost::mutex snapshot_mtx_;
+
       static bool faust_initialized_;
       static void initialize_faust();
-      
+
       static boost::shared_ptr <faust::detail::logwriter> log_sptr_;
-      
+
     protected:
-      
+
       static std::string faust_root_namesapce_;
-      
+
     public:
-      
+
       object (faust::object::type type);
       virtual ~object (void) { /*delete log_;*/ }
-      
+
       faust::object::type get_type() const;
       std::string get_uuid() {return uuid_;}
-      
+
       virtual saga::impl::attribute* get_attributes();
       virtual saga::impl::attribute const* get_attributes() const;
-      
+
+      // writer side: publish a new immutable state block, stamped with
+      // the next version. Subclasses call this after an update pass
+      // over their attribute state (see e.g. resource_monitor).
+      void publish_state (std::map<std::string, std::string> const & scalars,
+                          std::map<std::string, std::vector<std::string> > const & vectors);
+
+      // reader side: the most recently published block (never NULL),
+      // and its version for cheap change polling
+      state_snapshot_ptr get_state_snapshot (void) const;
+      unsigned long      get_state_version  (void) const;
+
       boost::shared_ptr <faust::detail::logwriter> get_log() { return log_sptr_; }
-      
+
     };
     //
     //////////////////////////////////////////////////////////////////////////
@@ -354,53 +354,107 @@ resource::~resource()
 //
 void resource::send_command(std::string cmd, unsigned int timeout)
 {
-  /* send a command and waits for an acknowledgement */
-  
+  /* send a command frame and wait for the agent's reply frame */
+
   SAGA_OSSTREAM msg;
 	msg << "Sending command '" << cmd << "' to faust_agent ";
-  
-  try 
+
+  faust::protocol::frame request(faust::protocol::command_frame, agent_uuid_);
+  request.add(cmd);
+
+  try
   {
-    cmd_adv_.store_string(agent_uuid_+":"+cmd);
+    // V2: the whole frame - uuid, command and arguments - travels in
+    // the CMD entry alone. The agent picks it up with one retrieve
+    // instead of the CMD+ARGS pair of round trips the text protocol
+    // needed.
+    cmd_adv_.store_string(faust::protocol::encode(request));
     LOG_WRITE_SUCCESS_2(get_log(),msg);
   }
-  catch(saga::exception const & e) 
+  catch(saga::exception const & e)
   {
     LOG_WRITE_FAILED_AND_THROW_2(get_log(),msg, e.what(), faust::NoSuccess);
   }
-  
+
+  // wake up the agent, so it picks the command up right away instead
+  // of on its next poll
+  notify_agent();
+
   msg <<  "Waiting for acknowledgement ";
-  
-  try 
+
+  try
   {
-    int to = 0; std::string result;
-    while(to < timeout) 
+    unsigned int to = 0; bool acked = false;
+    while(to < timeout)
     {
       ++to;
       sleep(1);
-      result = cmd_adv_.retrieve_string();
-      if(result == std::string("ACK:"+agent_uuid_+":"+cmd))
+      std::string result = cmd_adv_.retrieve_string();
+
+      faust::protocol::frame reply;
+      if(faust::protocol::decode(result, reply))
+      {
+        if(reply.type == faust::protocol::reply_frame
+           && reply.uuid == agent_uuid_
+           && !reply.commands.empty()
+           && reply.commands[0].name == cmd
+           && reply.commands[0].status == faust::protocol::status_ok)
+        {
+          acked = true;
+          break;
+        }
+      }
+      else if(result == std::string("ACK:"+agent_uuid_+":"+cmd))
+      {
+        // a V1 agent answered with the plain text acknowledgement
+        acked = true;
         break;
+      }
     }
-    
-    if(result == std::string("ACK:"+agent_uuid_+":"+cmd)) {
-      cmd_adv_.store_string("");  // Reset CMD
-      args_adv_.store_string(""); // Reset ARGS
+
+    cmd_adv_.store_string("");  // Reset CMD
+    args_adv_.store_string(""); // Reset ARGS
+
+    if(acked) {
       LOG_WRITE_SUCCESS_2(get_log(),msg);
     }
-    else 
+    else
     {
-      cmd_adv_.store_string("");  // Reset CMD
-      args_adv_.store_string(""); // Reset ARGS
       std::stringstream out; out << timeout;
-      
+
       LOG_WRITE_FAILED_AND_THROW_2(get_log(),msg, "(Timeout - "+out.str()+" sec)", faust::NoSuccess);
     }
   }
-  catch(saga::exception const & e) 
+  catch(saga::exception const & e)
   {
     LOG_WRITE_FAILED_AND_THROW_2(get_log(),msg, e.what(), faust::NoSuccess);
-  }  
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void resource::notify_agent()
+{
+  /* ping the agent's wakeup channel. The agent publishes the contact
+   * URL of a stream server in the 'NOTIFY' entry next to 'CMD'; a
+   * plain connect is enough to get it out of its blocking wait. All
+   * failures are ignored - agents without the channel (or with a dead
+   * one) simply pick the command up on their next poll. */
+  try
+  {
+    saga::advert::entry notify_adv(endpoint_str_+"NOTIFY", saga::advert::Read);
+
+    saga::stream::stream s(notify_adv.retrieve_string());
+    s.connect();
+    s.close();
+  }
+  catch(saga::exception const & e)
+  {
+    SAGA_OSSTREAM msg;
+    msg << "Could not ping agent wakeup channel (agent will poll) ";
+    get_log()->write(SAGA_OSSTREAM_GETSTRING(msg), LOGLEVEL_DEBUG);
+  }
 }
 
 
@@ -58,6 +58,7 @@ namespace faust
 			// outsourced functions that are used in multiple places
       void launch_agent(unsigned int timeout=30);
       void send_command(std::string cmd, unsigned int timeout=30);
+      void notify_agent(void);
 			
 			// the main eventloop thread & entry-point fucntion
 			boost::thread service_thread_;
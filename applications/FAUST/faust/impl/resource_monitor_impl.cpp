@@ -10,6 +10,8 @@
  *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
  */
 
+#include <ctime>
+
 #include <faust/faust/exception.hpp>
 #include <faust/impl/resource_monitor_impl.hpp>
 //#include <faust/impl/detail/serialize.hpp>
@@ -33,14 +35,37 @@ void resource_monitor::write_to_db_(std::string key)
       {
         if((*it) == "utime" || (*it) == "ctime" || (*it) == "persistent")
           continue;
-        
+
+        // only push attributes that changed since the last flush -
+        // a full pass over unchanged metrics costs no advert writes
+        std::string ser = serialize_attribute_(*it);
+
+        std::map<std::string, std::string>::iterator lw = last_written_.find(*it);
+        if(lw != last_written_.end() && lw->second == ser)
+          continue;
+
         if(attributes_.attribute_is_vector(*it)) {
           monitor_adv_.set_vector_attribute((*it), attributes_.get_vector_attribute((*it)));
         }
         else {
           monitor_adv_.set_attribute((*it), attributes_.get_attribute((*it)));
         }
+
+        last_written_[*it] = ser;
       }
+
+      // a full write is one sample tick - record it in the history
+      // rings, and publish them if a full batch has accumulated
+      record_history_();
+
+      if(history_pending_ >= history_batch_) {
+        publish_history_();
+        history_pending_ = 0;
+      }
+
+      // a full pass is also a consistent cut through the attribute
+      // state - publish it for lock-free readers
+      publish_state_from_cache_();
     }
     else
     {
@@ -78,7 +103,12 @@ void resource_monitor::read_from_db_(std::string key)
       {
         if((*it) == "utime" || (*it) == "ctime" || (*it) == "persistent")
           continue;
-        
+
+        // history attributes are not part of the attribute cache - they
+        // are fetched on demand via get_history()
+        if((*it).length() > 5 && (*it).substr((*it).length()-5) == "_hist")
+          continue;
+
         if(monitor_adv_.attribute_is_vector(*it)) {
           attributes_.set_vector_attribute((*it), monitor_adv_.get_vector_attribute((*it)));
         }
@@ -86,6 +116,10 @@ void resource_monitor::read_from_db_(std::string key)
           attributes_.set_attribute((*it), monitor_adv_.get_attribute((*it)));
         }
       }
+
+      // a full refresh is a consistent cut through the attribute
+      // state - publish it for lock-free readers
+      publish_state_from_cache_();
     }
     else
     {
@@ -108,20 +142,191 @@ void resource_monitor::read_from_db_(std::string key)
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// 
-resource_monitor::resource_monitor() : object(faust::object::ResourceMonitor)
+//
+resource_monitor::resource_monitor()
+: object(faust::object::ResourceMonitor), history_pending_(0)
 {
-  
+
 }
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// 
+//
 resource_monitor::resource_monitor(saga::advert::entry & monitor_adv)
 
-: object(faust::object::ResourceMonitor),  monitor_adv_(monitor_adv)
+: object(faust::object::ResourceMonitor),  monitor_adv_(monitor_adv),
+  history_pending_(0)
 {
-  
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+bool resource_monitor::is_history_key_(std::string key)
+{
+  // identifiers and bookkeeping attributes are not measurements - only
+  // the actual metric values go into the history rings
+  static const char * skip[] = { "_id", "_name", "_path", "_last_update" };
+
+  for(unsigned int i = 0; i < sizeof(skip)/sizeof(skip[0]); ++i)
+  {
+    std::string s(skip[i]);
+    if(key.length() >= s.length() &&
+       key.substr(key.length()-s.length()) == s)
+      return false;
+  }
+
+  return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::string resource_monitor::serialize_attribute_(std::string key)
+{
+  // vector attributes are serialized comma-joined - one string holds
+  // the values of all monitored instances (dirs, queues, ...)
+  std::string value("");
+
+  if(attributes_.attribute_is_vector(key))
+  {
+    std::vector<std::string> vals = attributes_.get_vector_attribute(key);
+    for(unsigned int i = 0; i < vals.size(); ++i)
+    {
+      if(i > 0) value += ",";
+      value += vals[i];
+    }
+  }
+  else
+  {
+    value = attributes_.get_attribute(key);
+  }
+
+  return value;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void resource_monitor::publish_state_from_cache_(void)
+{
+  std::map<std::string, std::string>               scalars;
+  std::map<std::string, std::vector<std::string> > vectors;
+
+  std::vector<std::string> attribs = attributes_.list_attributes();
+  std::vector<std::string>::const_iterator it;
+  for(it = attribs.begin(); it != attribs.end(); ++it)
+  {
+    if((*it) == "utime" || (*it) == "ctime" || (*it) == "persistent")
+      continue;
+
+    if(attributes_.attribute_is_vector(*it))
+      vectors[*it] = attributes_.get_vector_attribute(*it);
+    else
+      scalars[*it] = attributes_.get_attribute(*it);
+  }
+
+  publish_state(scalars, vectors);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void resource_monitor::record_history_(void)
+{
+  time_t now = ::time(NULL);
+
+  std::vector<std::string> attribs = attributes_.list_attributes();
+  std::vector<std::string>::const_iterator it;
+  for(it = attribs.begin(); it != attribs.end(); ++it)
+  {
+    if((*it) == "utime" || (*it) == "ctime" || (*it) == "persistent")
+      continue;
+
+    if(!is_history_key_(*it))
+      continue;
+
+    history_ring_t & ring = history_[*it];
+    ring.push_back(std::make_pair(now, serialize_attribute_(*it)));
+
+    while(ring.size() > history_size_)
+      ring.pop_front();
+  }
+
+  ++history_pending_;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void resource_monitor::publish_history_(void)
+{
+  SAGA_OSSTREAM strm;
+  strm << "Publishing resource_monitor history to database. ";
+
+  try
+  {
+    std::map<std::string, history_ring_t>::const_iterator it;
+    for(it = history_.begin(); it != history_.end(); ++it)
+    {
+      // serialize the whole ring as one compact string attribute:
+      // '<time>:<value>|<time>:<value>|...' - consumers get the full
+      // series in a single attribute fetch
+      SAGA_OSSTREAM ser;
+
+      history_ring_t::const_iterator si;
+      for(si = it->second.begin(); si != it->second.end(); ++si)
+      {
+        if(si != it->second.begin()) ser << "|";
+        ser << si->first << ":" << si->second;
+      }
+
+      monitor_adv_.set_attribute(it->first + "_hist",
+                                 SAGA_OSSTREAM_GETSTRING(ser));
+    }
+    LOG_WRITE_SUCCESS_2(get_log(),strm);
+  }
+  catch(saga::exception const & e)
+  {
+    LOG_WRITE_FAILED_AND_THROW_2(get_log(), strm, e.what(), faust::NoSuccess);
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::vector<std::string> resource_monitor::get_history(std::string key)
+{
+  SAGA_OSSTREAM strm;
+  strm << "Reading resource_monitor history for '" << key << "'. ";
+
+  std::vector<std::string> samples;
+
+  try
+  {
+    if(monitor_adv_.attribute_exists(key + "_hist"))
+    {
+      std::string ser = monitor_adv_.get_attribute(key + "_hist");
+
+      std::string::size_type last = 0;
+      std::string::size_type pos  = ser.find("|");
+
+      while(last < ser.length())
+      {
+        samples.push_back(ser.substr(last, pos - last));
+        if(pos == std::string::npos) break;
+        last = pos + 1;
+        pos  = ser.find("|", last);
+      }
+    }
+    LOG_WRITE_SUCCESS_2(get_log(),strm);
+  }
+  catch(saga::exception const & e)
+  {
+    LOG_WRITE_FAILED_AND_THROW_2(get_log(), strm, e.what(), faust::NoSuccess);
+  }
+
+  return samples;
 }
 
 
@@ -13,6 +13,10 @@
 #ifndef FAUST_IMPL_RESOURCE_MONITOR_IMPL_HPP
 #define FAUST_IMPL_RESOURCE_MONITOR_IMPL_HPP
 
+#include <map>
+#include <deque>
+#include <utility>
+
 #include <faust/faust/exports.hpp>
 #include <faust/faust/description.hpp>
 #include <faust/impl/object_impl.hpp>
@@ -21,21 +25,53 @@
 
 namespace faust
 {
-  namespace impl 
+  namespace impl
   {
     //////////////////////////////////////////////////////////////////////////
     //
-    class resource_monitor : public faust::impl::object, 
+    class resource_monitor : public faust::impl::object,
     public saga::impl::attribute
     {
 
     private:
-      
+
       saga::advert::entry monitor_adv_;
-      
+
       void read_from_db_ (std::string key="");
       void write_to_db_  (std::string key="");
-      
+
+      // per-metric sample history. Each write_to_db_ pass appends the
+      // current values to a fixed-size ring buffer, and every
+      // history_batch_ samples the rings are serialized into compact
+      // '<key>_hist' advert attributes - so consumers can fetch hours
+      // of history in a single read, while the steady-state advert
+      // write rate stays independent of the history length.
+      static const unsigned int history_size_  = 720;
+      static const unsigned int history_batch_ = 12;
+
+      typedef std::deque<std::pair<time_t, std::string> > history_ring_t;
+
+      std::map<std::string, history_ring_t> history_;
+      unsigned int                          history_pending_;
+
+      bool is_history_key_  (std::string key);
+      void record_history_  (void);
+      void publish_history_ (void);
+
+      // last value written to the advert service, per attribute. A full
+      // write_to_db_ pass only pushes attributes whose value actually
+      // changed since the last flush - identifiers and slow-moving
+      // metrics then cost nothing per tick.
+      std::map<std::string, std::string> last_written_;
+
+      std::string serialize_attribute_ (std::string key);
+
+      // publishes the attribute cache as a versioned snapshot (see
+      // state_snapshot in object_impl.hpp) after every full update
+      // pass, so dashboards read consistent state without touching
+      // the mutex-guarded attribute interface the agent writes to
+      void publish_state_from_cache_ (void);
+
     public:
       
       resource_monitor();
@@ -53,6 +89,8 @@ namespace faust
       
       void read_attributes  (std::string key="");
       void write_attributes (std::string key="");
+
+      std::vector<std::string> get_history (std::string key);
     };
     //
     //////////////////////////////////////////////////////////////////////////
@@ -19,10 +19,16 @@
 #include <faust/faust/exception.hpp>
 
 #include <faust/impl/service_impl.hpp>
+#include <faust/impl/job_group_impl.hpp>
 
 #include <saga/saga.hpp>
 
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/utility/addressof.hpp>
+#include <boost/thread/xtime.hpp>
 
 using namespace faust::impl;
 
@@ -30,7 +36,9 @@ using namespace faust::impl;
 // CONSTRUCTOR
 //
 service_impl::service_impl (std::vector<faust::resource> resource_descriptions, int num_jobs)
-: object(faust::object::Service)
+: object(faust::object::Service), state_cache_time_(0),
+  wait_waiters_(0), wait_sweeper_stop_(false), wait_sweeper_(NULL),
+  placement_dirty_(false)
 {
   using namespace saga::job;
   
@@ -119,6 +127,16 @@ service_impl::service_impl (std::vector<faust::resource> resource_descriptions,
 // DESTRUCTOR
 service_impl::~service_impl ()
 {
+  if(wait_sweeper_ != NULL)
+  {
+    {
+      boost::mutex::scoped_lock lock(state_mtx_);
+      wait_sweeper_stop_ = true;
+      wait_cond_.notify_all();
+    }
+    wait_sweeper_->join();
+    delete wait_sweeper_;
+  }
   //delete log_;
 }
 
@@ -151,7 +169,163 @@ faust::resource_description service_impl::get_resource_description(std::string c
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// 
+//
+double service_impl::monitor_number_(faust::resource_monitor & monitor,
+                                     char const * key)
+{
+  // monitor attributes are strings; a figure the agent has not
+  // published (yet), or one that doesn't parse, counts as unknown (-1)
+  // and ranks last
+  try
+  {
+    if(!monitor.attribute_exists(key))
+      return -1.0;
+
+    if(monitor.attribute_is_vector(key))
+    {
+      std::vector<std::string> v = monitor.get_vector_attribute(key);
+      if(v.empty()) return -1.0;
+      return boost::lexical_cast<double>(v[0]);
+    }
+
+    return boost::lexical_cast<double>(monitor.get_attribute(key));
+  }
+  catch(...)
+  {
+    return -1.0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void service_impl::update_placement_index(std::string contact,
+                                          faust::resource_monitor monitor)
+{
+  using namespace faust::attributes::resource_monitor;
+
+  // parse the monitor figures once, here - placement queries never
+  // touch the attribute layer again
+  double total  = monitor_number_(monitor, queue_nodes_total);
+  double busy   = monitor_number_(monitor, queue_nodes_busy);
+  double queued = monitor_number_(monitor, queue_nodes_queued);
+
+  placement_metrics m;
+  m.free_nodes  = (total >= 0.0 && busy >= 0.0) ? (total - busy) : -1.0;
+  m.queue_depth = queued;
+  m.load        = (total > 0.0 && busy >= 0.0) ? (busy / total) : -1.0;
+
+  boost::mutex::scoped_lock lock(placement_mtx_);
+  placement_metrics_[contact] = m;
+  placement_dirty_ = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void service_impl::remove_from_placement_index(std::string contact)
+{
+  boost::mutex::scoped_lock lock(placement_mtx_);
+  placement_metrics_.erase(contact);
+  placement_dirty_ = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void service_impl::rebuild_placement_ranks_(void)
+{
+  // caller holds placement_mtx_. One sort per criterion covers any
+  // number of monitor events since the last query; resources with an
+  // unknown figure sort last within their ranking.
+  typedef std::pair<double, std::string> scored_t;
+
+  std::vector<scored_t> by_free, by_depth, by_load;
+
+  placement_map_t::const_iterator i;
+  for(i = placement_metrics_.begin(); i != placement_metrics_.end(); ++i)
+  {
+    placement_metrics const & m = i->second;
+
+    // scores are "smaller is better"; free nodes are negated for that
+    by_free.push_back (scored_t((m.free_nodes  < 0.0) ? 1e30 : -m.free_nodes,  i->first));
+    by_depth.push_back(scored_t((m.queue_depth < 0.0) ? 1e30 :  m.queue_depth, i->first));
+    by_load.push_back (scored_t((m.load        < 0.0) ? 1e30 :  m.load,        i->first));
+  }
+
+  std::sort(by_free.begin(),  by_free.end());
+  std::sort(by_depth.begin(), by_depth.end());
+  std::sort(by_load.begin(),  by_load.end());
+
+  rank_free_nodes_.clear();
+  rank_queue_depth_.clear();
+  rank_load_.clear();
+
+  for(unsigned int n = 0; n < by_free.size(); ++n)
+  {
+    rank_free_nodes_.push_back (by_free[n].second);
+    rank_queue_depth_.push_back(by_depth[n].second);
+    rank_load_.push_back       (by_load[n].second);
+  }
+
+  placement_dirty_ = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::vector<std::string>
+service_impl::select_resources(faust::placement_criterion criterion,
+                               unsigned int k)
+{
+  boost::mutex::scoped_lock lock(placement_mtx_);
+
+  if(placement_dirty_)
+    rebuild_placement_ranks_();
+
+  std::vector<std::string> const * rank = NULL;
+
+  switch(criterion)
+  {
+    case faust::PlacementFreeNodes:  rank = &rank_free_nodes_;  break;
+    case faust::PlacementQueueDepth: rank = &rank_queue_depth_; break;
+    case faust::PlacementLoad:       rank = &rank_load_;        break;
+    default:
+      throw faust::exception ("Unknown placement criterion." ,
+                              faust::BadParameter);
+  }
+
+  std::vector<std::string> ret;
+
+  for(unsigned int n = 0; n < rank->size() && n < k; ++n)
+  {
+    ret.push_back((*rank)[n]);
+  }
+
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+session_pool & service_impl::get_session_pool(void)
+{
+  return session_pool_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+saga::advert::directory service_impl::get_resource_directory(std::string contact)
+{
+  if(resource_descriptions_.find(contact) == resource_descriptions_.end())
+  {
+    throw faust::exception ("Contact string '"+contact+"' doesn't exisit." ,
+                            faust::BadParameter);
+  }
+
+  // served from the pool: only the first call per endpoint opens a
+  // connection, later sweeps over the resource list get warm handles
+  return session_pool_.get_directory(faust_root_namesapce_ +
+                                     "RESOURCES/" + contact + "/");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
 std::vector<std::string> service_impl::list_resource_descriptions(void)
 {
   std::vector<std::string> res;
@@ -167,10 +341,21 @@ std::vector<std::string> service_impl::list_resource_descriptions(void)
 
 ////////////////////////////////////////////////////////////////////////////////
 // 
-faust::job_group 
+faust::job_group
 service_impl::create_job_group(std::vector<faust::job_description> job_descs)
 {
   faust::job_group ret;
+
+  // populate the group: one job per description. Dependencies between
+  // them are declared afterwards via job_group::add_dependency.
+  std::vector<faust::job_description>::iterator i;
+  for(i = job_descs.begin(); i != job_descs.end(); ++i)
+  {
+    faust::job j;
+    insert_job_into_job_list(j.get_job_id(), j);
+    ret.get_impl()->add_job(j);
+  }
+
   insert_job_into_job_list(ret.get_job_id(), ret);
   return ret;
 }
@@ -183,6 +368,15 @@ service_impl::create_job_group(std::vector<faust::job_description> job_descs,
                                dependency dep)
 {
   faust::job_group ret;
+
+  std::vector<faust::job_description>::iterator i;
+  for(i = job_descs.begin(); i != job_descs.end(); ++i)
+  {
+    faust::job j;
+    insert_job_into_job_list(j.get_job_id(), j);
+    ret.get_impl()->add_job(j);
+  }
+
   insert_job_into_job_list(ret.get_job_id(), ret);
   return ret;
 }
@@ -195,6 +389,15 @@ service_impl::create_job_group(std::vector<faust::job_description> job_descs,
                                dependency dep)
 {
   faust::job_group ret;
+
+  std::vector<faust::job_description>::iterator i;
+  for(i = job_descs.begin(); i != job_descs.end(); ++i)
+  {
+    faust::job j;
+    insert_job_into_job_list(j.get_job_id(), j);
+    ret.get_impl()->add_job(j);
+  }
+
   insert_job_into_job_list(ret.get_job_id(), ret);
   return ret;
 }
@@ -207,6 +410,15 @@ service_impl::create_job_group(std::vector<faust::job_description> job_descs,
                                dependency dep)
 {
   faust::job_group ret;
+
+  std::vector<faust::job_description>::iterator i;
+  for(i = job_descs.begin(); i != job_descs.end(); ++i)
+  {
+    faust::job j;
+    insert_job_into_job_list(j.get_job_id(), j);
+    ret.get_impl()->add_job(j);
+  }
+
   insert_job_into_job_list(ret.get_job_id(), ret);
   return ret;
 }
@@ -223,10 +435,58 @@ service_impl::create_job(faust::job_description job_descs)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// 
+//
+std::vector<faust::job>
+service_impl::create_jobs(std::vector<faust::job_description> job_descs)
+{
+  // create and register all jobs in one pass - large ensembles this way
+  // cost a single bulk call instead of one create_job round trip each.
+  // Once the agent command channel learns about job dispatch, this is
+  // also the place to hand the whole batch over in one transaction.
+  std::vector<faust::job> ret;
+
+  std::vector<faust::job_description>::iterator i;
+  for(i = job_descs.begin(); i != job_descs.end(); ++i)
+  {
+    faust::job j;
+    insert_job_into_job_list(j.get_job_id(), j);
+    ret.push_back(j);
+  }
+
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::vector<faust::job>
+service_impl::create_jobs(faust::job_template job_tmpl,
+                          std::vector<std::vector<std::string> > args_list)
+{
+  // template-based bulk submission: the invariant attributes were
+  // validated and serialized when the template was compiled, so this
+  // loop only pays for registration and the argument splices. The
+  // batch travels as one V2 frame - the template blob once, one
+  // argument delta per instance (see job_template::batch_frame);
+  // once the agent command channel learns about job dispatch, that
+  // frame is what goes over it.
+  std::vector<faust::job> ret;
+
+  std::vector<std::vector<std::string> >::iterator i;
+  for(i = args_list.begin(); i != args_list.end(); ++i)
+  {
+    faust::job j;
+    insert_job_into_job_list(j.get_job_id(), j);
+    ret.push_back(j);
+  }
+
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
 faust::job
 service_impl::create_job(faust::job_description job_descs,
-                         std::string dep_job_id, 
+                         std::string dep_job_id,
                          faust::dependency dep)
 {
   faust::job ret;  
@@ -259,8 +519,242 @@ service_impl::create_job(faust::job_description job_descs,
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// 
-void service_impl::insert_job_into_job_list(std::string jobid, faust::object obj) 
+//
+bool service_impl::refresh_state_cache_(bool force)
+{
+  // refresh at most every state_max_age_ seconds (unless forced by the
+  // wait sweeper). Within that window all state queries are served from
+  // the cache - a front-end polling the states of thousands of jobs
+  // each refresh doesn't multiply the load on the backend anymore.
+  time_t now = time(NULL);
+
+  boost::mutex::scoped_lock lock(state_mtx_);
+
+  if(!force && state_cache_time_ != 0 && (now - state_cache_time_) < state_max_age_)
+    return false;
+
+  // one sweep over all registered jobs. Once the agent publishes job
+  // states together with a per-resource sequence number, this is the
+  // place to compare it against the last seen one and to bulk-fetch
+  // only the entries that actually changed.
+  bool changed = false;
+
+  joblist_map_t::iterator i;
+  for(i = joblist_.begin(); i != joblist_.end(); ++i)
+  {
+    if(i->second.get_type() != faust::object::Job)
+      continue;
+
+    faust::job * j = static_cast<faust::job *> (boost::addressof(i->second));
+    faust::state s = j->get_state();
+
+    state_map_t::iterator old = state_cache_.find(i->first);
+    if(old == state_cache_.end() || old->second != s)
+      changed = true;
+
+    state_cache_[i->first] = s;
+  }
+
+  state_cache_time_ = now;
+
+  // every state change is one completion event for the waiters
+  if(changed)
+    wait_cond_.notify_all();
+
+  return changed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+faust::state service_impl::get_job_state(std::string job_id)
+{
+  refresh_state_cache_();
+
+  boost::mutex::scoped_lock lock(state_mtx_);
+
+  if(state_cache_.find(job_id) == state_cache_.end())
+    throw faust::exception ("JobID doesn't exisit." , faust::BadParameter);
+
+  return state_cache_[job_id];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+state_map_t service_impl::get_job_states(void)
+{
+  refresh_state_cache_();
+
+  boost::mutex::scoped_lock lock(state_mtx_);
+  return state_cache_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+bool service_impl::is_final_(faust::state s)
+{
+  return (s == faust::Done || s == faust::Canceled || s == faust::Failed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void service_impl::check_waitable_(std::vector<std::string> const & job_ids)
+{
+  std::vector<std::string>::const_iterator i;
+  for(i = job_ids.begin(); i != job_ids.end(); ++i)
+  {
+    if(joblist_.find(*i) == joblist_.end())
+      throw faust::exception ("JobID doesn't exisit." , faust::BadParameter);
+
+    if(joblist_[*i].get_type() != faust::object::Job)
+      throw faust::exception ("Can only wait on job IDs." , faust::BadParameter);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void service_impl::start_wait_(void)
+{
+  boost::mutex::scoped_lock lock(state_mtx_);
+  ++wait_waiters_;
+
+  // the sweeper comes into being with the first waiter and then stays
+  // around; while nobody waits it only wakes up to find nothing to do
+  if(wait_sweeper_ == NULL)
+  {
+    wait_sweeper_ = new boost::thread(
+      boost::bind(&service_impl::wait_sweep_loop_, this));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void service_impl::stop_wait_(void)
+{
+  boost::mutex::scoped_lock lock(state_mtx_);
+  --wait_waiters_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void service_impl::wait_sweep_loop_(void)
+{
+  while(1)
+  {
+    boost::xtime xt;
+    boost::xtime_get(&xt, boost::TIME_UTC);
+    xt.sec += 1;
+    boost::thread::sleep(xt);
+
+    {
+      boost::mutex::scoped_lock lock(state_mtx_);
+      if(wait_sweeper_stop_) return;
+      if(wait_waiters_ == 0) continue;
+    }
+
+    // forced refresh: waiters trade a 1s sweep cadence for completion
+    // latency; everybody else keeps the bounded-staleness cache
+    refresh_state_cache_(true);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+std::string service_impl::wait_any(std::vector<std::string> job_ids,
+                                   double timeout)
+{
+  check_waitable_(job_ids);
+  refresh_state_cache_();
+
+  time_t deadline = (timeout < 0.0) ? 0 : time(NULL) + (time_t)(timeout + 0.5);
+
+  start_wait_();
+  std::string ret;
+
+  {
+    boost::mutex::scoped_lock lock(state_mtx_);
+
+    while(ret.empty())
+    {
+      std::vector<std::string>::const_iterator i;
+      for(i = job_ids.begin(); i != job_ids.end(); ++i)
+      {
+        state_map_t::iterator s = state_cache_.find(*i);
+        if(s != state_cache_.end() && is_final_(s->second))
+        {
+          ret = *i;
+          break;
+        }
+      }
+
+      if(!ret.empty()) break;
+      if(deadline != 0 && time(NULL) >= deadline) break;
+
+      // woken by the sweeper on any state change; the one second slice
+      // only bounds the timeout check
+      boost::xtime xt;
+      boost::xtime_get(&xt, boost::TIME_UTC);
+      xt.sec += 1;
+      wait_cond_.timed_wait(lock, xt);
+    }
+  }
+
+  stop_wait_();
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+bool service_impl::wait_all(std::vector<std::string> job_ids,
+                            double timeout)
+{
+  check_waitable_(job_ids);
+  refresh_state_cache_();
+
+  time_t deadline = (timeout < 0.0) ? 0 : time(NULL) + (time_t)(timeout + 0.5);
+
+  start_wait_();
+  bool all_final = false;
+  bool timed_out = false;
+
+  {
+    boost::mutex::scoped_lock lock(state_mtx_);
+
+    while(!all_final && !timed_out)
+    {
+      all_final = true;
+
+      std::vector<std::string>::const_iterator i;
+      for(i = job_ids.begin(); i != job_ids.end(); ++i)
+      {
+        state_map_t::iterator s = state_cache_.find(*i);
+        if(s == state_cache_.end() || !is_final_(s->second))
+        {
+          all_final = false;
+          break;
+        }
+      }
+
+      if(all_final) break;
+      if(deadline != 0 && time(NULL) >= deadline)
+      {
+        timed_out = true;
+        break;
+      }
+
+      boost::xtime xt;
+      boost::xtime_get(&xt, boost::TIME_UTC);
+      xt.sec += 1;
+      wait_cond_.timed_wait(lock, xt);
+    }
+  }
+
+  stop_wait_();
+  return all_final;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void service_impl::insert_job_into_job_list(std::string jobid, faust::object obj)
 {
   joblist_.insert(joblist_pair_t(jobid, obj));
   std::string msg("Registering new " + faust::get_object_type_name(obj) + " instance: " + jobid);
@@ -14,19 +14,26 @@
 #define FAUST_IMPL_SERVICE_IMPL_HPP
 
 #include <map>
+#include <ctime>
 #include <saga/saga.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
 
-#include <faust/faust/object.hpp> 
-#include <faust/faust/exports.hpp> 
+#include <faust/faust/object.hpp>
+#include <faust/faust/exports.hpp>
 #include <faust/faust/state.hpp>
+#include <faust/faust/placement.hpp>
 #include <faust/faust/dependency.hpp>
 #include <faust/faust/job.hpp>
+#include <faust/faust/job_template.hpp>
 #include <faust/faust/resource.hpp>
 
 
 #include <faust/impl/logwriter.hpp>
 #include <faust/impl/object_impl.hpp>
+#include <faust/impl/session_pool.hpp>
 
 namespace faust
 {
@@ -39,6 +46,9 @@ namespace faust
     
     typedef std::map<std::string,  faust::resource_description> resource_descriptions_map;
     typedef std::pair<std::string, faust::resource_description> resource_descriptions_pair;
+
+    typedef std::map<std::string,  faust::state> state_map_t;
+    typedef std::pair<std::string, faust::state> state_pair_t;
     
     //////////////////////////////////////////////////////////////////////////
     //
@@ -50,9 +60,75 @@ namespace faust
       
       resource_descriptions_map              resource_descriptions_;
       joblist_map_t                joblist_;
-      
+
+      // cached job states with bounded staleness: status queries are
+      // served from here and the cache is refreshed at most every
+      // state_max_age_ seconds, in one sweep over all jobs - the
+      // common "show me everything" query of a monitoring front-end
+      // stays one refresh, independent of the number of jobs.
+      static const unsigned int state_max_age_ = 5; // seconds
+
+      state_map_t  state_cache_;
+      time_t       state_cache_time_;
+
+      // completion event multiplexer: clients block on wait_cond_
+      // instead of running their own poll loops. One shared sweeper
+      // thread (started on the first wait, idle while nobody waits)
+      // refreshes the state cache and signals the condition whenever
+      // any job changed state, so N waiting clients cost one sweep -
+      // and once the agents push state change notifications, the
+      // sweeper is the single place to hook them into.
+      boost::mutex      state_mtx_;     // guards the cache and the waiters
+      boost::condition  wait_cond_;
+      unsigned int      wait_waiters_;
+      bool              wait_sweeper_stop_;
+      boost::thread *   wait_sweeper_;
+
+      // shared saga::session and warm advert directory handles, one per
+      // resource endpoint - see session_pool.hpp. Iterating over all
+      // managed resources reconnects nowhere after the first sweep.
+      session_pool session_pool_;
+
+      // placement index: the numeric queue/load figures of each managed
+      // resource, parsed once per monitor update, plus one ranking per
+      // placement criterion. Selecting a resource for a job is a lookup
+      // in a pre-sorted ranking instead of a sweep over all resources
+      // re-parsing attributes through the impl layer.
+      struct placement_metrics
+      {
+        double free_nodes;  // queue_nodes_total - queue_nodes_busy
+        double queue_depth; // queue_nodes_queued
+        double load;        // queue_nodes_busy / queue_nodes_total
+      };
+
+      typedef std::map<std::string, placement_metrics> placement_map_t;
+
+      placement_map_t placement_metrics_;
+
+      // rankings are contact strings sorted best-first per criterion;
+      // they are rebuilt lazily on the first query after an update
+      // (placement_dirty_), so a burst of monitor events costs one sort
+      std::vector<std::string> rank_free_nodes_;
+      std::vector<std::string> rank_queue_depth_;
+      std::vector<std::string> rank_load_;
+      bool                     placement_dirty_;
+      boost::mutex             placement_mtx_;
+
+      void rebuild_placement_ranks_(void);
+      static double monitor_number_(faust::resource_monitor & monitor,
+                                    char const * key);
+
+      // returns whether any job changed state; signals wait_cond_ if so
+      bool refresh_state_cache_(bool force = false);
+
+      static bool is_final_(faust::state s);
+      void check_waitable_(std::vector<std::string> const & job_ids);
+      void start_wait_(void);
+      void stop_wait_(void);
+      void wait_sweep_loop_(void);
+
       void insert_job_into_job_list(std::string jobid, faust::object obj);
-      
+
     public:
       
       explicit service_impl (std::vector<faust::resource> resource_descriptions, 
@@ -66,11 +142,16 @@ namespace faust
       faust::job create_job(faust::job_description job_desc, 
                             faust::job job_obj, 
                             faust::dependency dep);
-      faust::job create_job(faust::job_description job_desc, 
-                            faust::job_group job_group_obj, 
+      faust::job create_job(faust::job_description job_desc,
+                            faust::job_group job_group_obj,
                             faust::dependency dep);
-      
-      
+
+      std::vector<faust::job> create_jobs(std::vector<faust::job_description> job_descs);
+
+      std::vector<faust::job> create_jobs(faust::job_template job_tmpl,
+                                          std::vector<std::vector<std::string> > args_list);
+
+
       faust::job_group create_job_group(std::vector<faust::job_description> job_descs);
       faust::job_group create_job_group(std::vector<faust::job_description> job_descs, 
                                         std::string dep_job_id, 
@@ -85,10 +166,46 @@ namespace faust
       std::vector<std::string> list_jobs(void); 
       std::vector<std::string> list_resource_descriptions(void); 
       
+      faust::state get_job_state(std::string job_id);
+      state_map_t get_job_states(void);
+
+      // block until one (wait_any) or every (wait_all) job of the set
+      // reaches a final state. Timeout in seconds, negative waits
+      // forever. wait_any returns the ID of a finished job or the
+      // empty string on timeout; wait_all returns false on timeout.
+      std::string wait_any(std::vector<std::string> job_ids,
+                           double timeout = -1.0);
+      bool wait_all(std::vector<std::string> job_ids,
+                    double timeout = -1.0);
+
       faust::job get_job(std::string job_id);
       faust::job_group get_job_group(std::string job_id);
       faust::resource_description get_resource_description(std::string contact);
-      
+
+      // feed the placement index from a monitor event: parses the
+      // queue/load figures of the given resource once and marks the
+      // rankings for rebuild
+      void update_placement_index(std::string contact,
+                                  faust::resource_monitor monitor);
+
+      // drop a resource from the placement index, e.g. when its agent
+      // went away
+      void remove_from_placement_index(std::string contact);
+
+      // top-k resource contacts for the given criterion, best first.
+      // Served from the pre-sorted rankings - O(k) per query once the
+      // rankings are built.
+      std::vector<std::string> select_resources(
+        faust::placement_criterion criterion, unsigned int k);
+
+      // the session pool shared by all per-resource operations of this
+      // service instance
+      session_pool & get_session_pool(void);
+
+      // warm advert directory handle for the given resource's endpoint;
+      // connection setup happens on the first touch only
+      saga::advert::directory get_resource_directory(std::string contact);
+
     };
   }
 }
@@ -0,0 +1,84 @@
+/*
+ *  session_pool.cpp
+ *  FAUST - Framework for Adaptive Ubiquitous Scalable Tasks
+ *  Website: https://macpro01.cct.lsu.edu/trac/faust
+ *
+ *  Created by Ole Weidner <oweidner@cct.lsu.edu> on 09/01/09.
+ *  Copyright 2008-2009 Center for Computation & Technology.
+ *
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
+ *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#include <faust/impl/session_pool.hpp>
+
+using namespace faust::impl;
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTOR
+//
+session_pool::session_pool()
+: session_(saga::get_default_session())
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DESTRUCTOR
+//
+session_pool::~session_pool()
+{
+  clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+saga::session & session_pool::get_session(void)
+{
+  return session_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+saga::advert::directory session_pool::get_directory(std::string url, int mode)
+{
+  boost::mutex::scoped_lock lock(mtx_);
+
+  std::map<std::string, saga::advert::directory>::iterator i =
+    directories_.find(url);
+
+  if(i != directories_.end())
+  {
+    return i->second;
+  }
+
+  // first touch of this endpoint: open through the shared session and
+  // keep the handle warm for subsequent calls
+  saga::advert::directory dir(session_, saga::url(url), mode);
+  directories_.insert(std::make_pair(url, dir));
+
+  return dir;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+bool session_pool::is_cached(std::string url)
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  return directories_.find(url) != directories_.end();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void session_pool::evict(std::string url)
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  directories_.erase(url);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+void session_pool::clear(void)
+{
+  boost::mutex::scoped_lock lock(mtx_);
+  directories_.clear();
+}
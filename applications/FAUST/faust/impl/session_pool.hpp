@@ -0,0 +1,75 @@
+/*
+ *  session_pool.hpp
+ *  FAUST - Framework for Adaptive Ubiquitous Scalable Tasks
+ *  Website: https://macpro01.cct.lsu.edu/trac/faust
+ *
+ *  Created by Ole Weidner <oweidner@cct.lsu.edu> on 09/01/09.
+ *  Copyright 2008-2009 Center for Computation & Technology.
+ *
+ *  Distributed under the Boost Software License, Version 1.0. (See accompanying
+ *  LICENSE file or copy at http://www.boost.org/LICENSE_1_0.txt)
+ */
+
+#ifndef FAUST_IMPL_SESSION_POOL_HPP
+#define FAUST_IMPL_SESSION_POOL_HPP
+
+#include <map>
+#include <string>
+
+#include <saga/saga.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace faust
+{
+  namespace impl
+  {
+    //////////////////////////////////////////////////////////////////////////
+    //
+    // Shared saga::session plus a cache of open advert directory handles,
+    // keyed by endpoint URL. Opening an advert directory sets up a fresh
+    // backend connection every time; a controller iterating over dozens of
+    // resources (e.g. for job_group scheduling) pays that setup cost per
+    // resource per sweep. The pool opens each endpoint once and hands out
+    // the warm handle afterwards, so only the first touch of a resource
+    // is expensive.
+    //
+    // Handles live until evict() / clear() - call evict() after a handle
+    // failed with a saga::exception so the next get_directory() reconnects.
+    //
+    class  session_pool
+    {
+
+    private:
+      saga::session session_;
+
+      std::map<std::string, saga::advert::directory> directories_;
+
+      boost::mutex mtx_;
+
+    public:
+
+      session_pool();
+      ~session_pool();
+
+      // the session shared by all pooled handles
+      saga::session & get_session(void);
+
+      // returns the cached advert directory handle for 'url', opening
+      // (and caching) it on first use
+      saga::advert::directory get_directory(std::string url,
+                                            int mode = saga::advert::ReadWrite);
+
+      bool is_cached(std::string url);
+
+      // drop a single handle, e.g. after a connection error
+      void evict(std::string url);
+
+      // drop all handles; the shared session stays valid
+      void clear(void);
+    };
+    //
+    //////////////////////////////////////////////////////////////////////////
+  }
+}
+
+#endif /* FAUST_IMPL_SESSION_POOL_HPP */
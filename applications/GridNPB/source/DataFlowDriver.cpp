@@ -0,0 +1,449 @@
+/*
+ *  DataFlowDriver.cpp
+ *  GridNPB-SAGA
+ *
+ *  Copyright 2008 Center for Computation & Technology. All rights reserved.
+ *
+ */
+
+#include <iomanip>
+
+#include <sys/time.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include "DataFlowDriver.hpp"
+
+GridNPB::DataFlowDriver::DataFlowDriver(std::vector<ResourceDescription> resources)
+  : resources_(resources)
+{
+    logwriter = new LogWriter(std::string(APP_NAME), std::cout);
+}
+
+GridNPB::DataFlowDriver::~DataFlowDriver()
+{
+    delete logwriter;
+}
+
+////////////////////////////////////////////////////////////////////////////
+//
+int GridNPB::DataFlowDriver::addTask(TaskDescription task)
+{
+    Task t;
+    t.desc = task;
+    t.state = Waiting;
+    t.resource = 0;
+    t.shmPlane = false;
+    t.stageInStarted = false;
+    t.stageStart = t.stageEnd = t.runStart = t.runEnd = 0.0;
+    tasks_.push_back(t);
+    return (int)tasks_.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////
+//
+double GridNPB::DataFlowDriver::now_()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return (double)tv.tv_sec + (double)tv.tv_usec * 1e-6;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// co-scheduled placement: every chain is pinned to one resource (chains
+// round-robin over the available resources), so dependent tasks share a
+// filesystem and intra-chain data never crosses the WAN
+void GridNPB::DataFlowDriver::assignResources_()
+{
+    std::vector<int> chainSize;
+    for(unsigned int i = 0; i < tasks_.size(); ++i)
+    {
+        tasks_[i].resource = tasks_[i].desc.chain % (int)resources_.size();
+
+        if(tasks_[i].desc.chain >= (int)chainSize.size())
+            chainSize.resize(tasks_[i].desc.chain + 1, 0);
+        ++chainSize[tasks_[i].desc.chain];
+    }
+
+    // multi-task chains exchange arrays on their resource; put their
+    // data dir on the shared-memory filesystem where one is configured
+    for(unsigned int i = 0; i < tasks_.size(); ++i)
+    {
+        tasks_[i].shmPlane =
+            !resources_[tasks_[i].resource].shmDir.empty()
+            && chainSize[tasks_[i].desc.chain] > 1;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+// the directory a task reads and writes its data files in: the
+// resource's tmpfs path for tasks on the in-memory data plane, its
+// regular workdir otherwise
+std::string GridNPB::DataFlowDriver::dataDir_(Task const & t)
+{
+    ResourceDescription const & res = resources_[t.resource];
+    return t.shmPlane ? res.shmDir : res.workdir;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// index of the dependency that produces the given basename, -1 if the
+// file does not come from inside the graph
+int GridNPB::DataFlowDriver::producerOf_(Task const & t,
+                                         std::string const & basename)
+{
+    for(unsigned int i = 0; i < t.desc.dependsOn.size(); ++i)
+    {
+        Task const & dep = tasks_[t.desc.dependsOn[i]];
+        for(unsigned int f = 0; f < dep.desc.outputFiles.size(); ++f)
+        {
+            if(dep.desc.outputFiles[f] == basename)
+                return t.desc.dependsOn[i];
+        }
+    }
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// start the asynchronous stage-in of a task's declared input files. This
+// runs while the task's predecessors compute, which is where the overlap
+// comes from; outputs of co-scheduled predecessors are already local
+void GridNPB::DataFlowDriver::beginStageIn_(Task & t)
+{
+    t.stageInStarted = true;
+    t.stageStart = now_();
+
+    ResourceDescription const & res = resources_[t.resource];
+
+    std::vector<std::string>::const_iterator it = t.desc.inputFiles.begin();
+    while(it != t.desc.inputFiles.end())
+    {
+        try {
+            saga::url src(*it);
+
+            std::string path = src.get_path();
+            std::string::size_type pos = path.rfind('/');
+            std::string basename =
+                (pos == std::string::npos) ? path : path.substr(pos + 1);
+
+            // co-location aware routing: an input produced by a
+            // dependency on the same resource sits in the shared data
+            // dir already (in memory when the chain is on the tmpfs
+            // plane) - the consumer opens it in place, no copy at all.
+            // One produced elsewhere falls back to file staging from
+            // the producer's data directory.
+            int producer = producerOf_(t, basename);
+            if(producer >= 0)
+            {
+                if(tasks_[producer].resource == t.resource)
+                {
+                    logwriter->write("Input " + basename + " of task "
+                                     + t.desc.name + " is exchanged in place",
+                                     LOGLEVEL_INFO);
+                    ++it;
+                    continue;
+                }
+                src = saga::url();
+                src.set_scheme("any");
+                src.set_host(resources_[tasks_[producer].resource]
+                             .rmURL.get_host());
+                src.set_path(dataDir_(tasks_[producer]) + "/" + basename);
+            }
+
+            saga::url dst;
+            dst.set_scheme("any");
+            dst.set_host(res.rmURL.get_host());
+            dst.set_path(dataDir_(t) + "/" + basename);
+
+            saga::filesystem::file f(src);
+            t.stageIn.add_task(f.copy<saga::task_base::Async>(
+                dst, saga::filesystem::Overwrite));
+        }
+        catch(saga::exception const & e) {
+            logwriter->write("Stage-in of " + (*it) + " failed: " + e.what(),
+                             LOGLEVEL_ERROR);
+            t.state = Failed;
+            return;
+        }
+        ++it;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+//
+bool GridNPB::DataFlowDriver::stageInDone_(Task & t)
+{
+    std::vector<saga::task> list = t.stageIn.list_tasks();
+    for(unsigned int i = 0; i < list.size(); ++i)
+    {
+        saga::task_base::state s = list[i].get_state();
+        if(s == saga::task_base::Failed || s == saga::task_base::Canceled)
+        {
+            logwriter->write("Stage-in failed for task " + t.desc.name,
+                             LOGLEVEL_ERROR);
+            t.state = Failed;
+            return false;
+        }
+        if(s != saga::task_base::Done)
+            return false;
+    }
+
+    if(0.0 == t.stageEnd)
+        t.stageEnd = now_();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+//
+bool GridNPB::DataFlowDriver::depsDone_(Task & t, bool & failed)
+{
+    failed = false;
+    for(unsigned int i = 0; i < t.desc.dependsOn.size(); ++i)
+    {
+        Task const & dep = tasks_[t.desc.dependsOn[i]];
+        if(dep.state == Failed) {
+            failed = true;
+            return false;
+        }
+        if(dep.state != Done)
+            return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+//
+void GridNPB::DataFlowDriver::launch_(Task & t)
+{
+    ResourceDescription const & res = resources_[t.resource];
+
+    try {
+        namespace attr = saga::job::attributes;
+
+        saga::job::description jd;
+
+        std::vector<std::string> project;
+        project.push_back(res.allocation);
+        jd.set_vector_attribute(attr::description_job_project, project);
+
+        jd.set_vector_attribute(attr::description_arguments, t.desc.arguments);
+
+        jd.set_attribute(attr::description_executable, t.desc.executable);
+        jd.set_attribute(attr::description_queue, res.queue);
+        jd.set_attribute(attr::description_working_directory, dataDir_(t));
+        jd.set_attribute(attr::description_output, t.desc.name + ".out");
+        jd.set_attribute(attr::description_error,  t.desc.name + ".err");
+
+        saga::job::service js(res.rmURL.get_url());
+        t.job = js.create_job(jd);
+
+        t.runStart = now_();
+        t.job.run();
+        t.state = Running;
+
+        logwriter->write("Launched task " + t.desc.name + " on "
+                         + res.rmURL.get_host(), LOGLEVEL_INFO);
+    }
+    catch(saga::exception const & e) {
+        logwriter->write("Launching task " + t.desc.name + " failed: "
+                         + e.what(), LOGLEVEL_ERROR);
+        t.state = Failed;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+//
+void GridNPB::DataFlowDriver::run()
+{
+    if(tasks_.empty() || resources_.empty())
+        return;
+
+    assignResources_();
+
+    double start = now_();
+
+    // start all stage-ins right away - static inputs move while
+    // predecessors compute
+    for(unsigned int i = 0; i < tasks_.size(); ++i)
+        beginStageIn_(tasks_[i]);
+
+    while(true)
+    {
+        bool allSettled = true;
+
+        for(unsigned int i = 0; i < tasks_.size(); ++i)
+        {
+            Task & t = tasks_[i];
+
+            switch(t.state)
+            {
+                case Waiting:
+                {
+                    if(stageInDone_(t))
+                        t.state = Ready;
+                    allSettled = false;
+                    break;
+                }
+                case Ready:
+                {
+                    bool depFailed;
+                    if(depsDone_(t, depFailed))
+                        launch_(t);
+                    else if(depFailed) {
+                        logwriter->write("Task " + t.desc.name
+                                         + " failed: dependency failed",
+                                         LOGLEVEL_ERROR);
+                        t.state = Failed;
+                    }
+                    allSettled = false;
+                    break;
+                }
+                case Running:
+                {
+                    saga::job::state s = t.job.get_state();
+                    if(s == saga::job::Done) {
+                        t.runEnd = now_();
+                        t.state = Done;
+                    }
+                    else if(s == saga::job::Failed
+                            || s == saga::job::Canceled) {
+                        t.runEnd = now_();
+                        t.state = Failed;
+                        logwriter->write("Task " + t.desc.name + " failed",
+                                         LOGLEVEL_ERROR);
+                    }
+                    else
+                        allSettled = false;
+                    break;
+                }
+                default:
+                    break;    // Done or Failed
+            }
+        }
+
+        if(allSettled)
+            break;
+
+        sleep(GRIDNPB_POLL_INTERVAL);
+    }
+
+    report_(now_() - start);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// the per-run report; one fixed-format line per task, so runs on
+// different platforms can be diffed column by column
+void GridNPB::DataFlowDriver::report_(double makespan)
+{
+    std::cout << std::endl
+              << "task             chain rsrc state  stage[s]    run[s]"
+              << std::endl;
+
+    for(unsigned int i = 0; i < tasks_.size(); ++i)
+    {
+        Task const & t = tasks_[i];
+        std::cout << std::left  << std::setw(17) << t.desc.name
+                  << std::right << std::setw(5)  << t.desc.chain
+                  << std::setw(5)  << t.resource
+                  << std::setw(7)  << (t.state == Done ? "done" : "failed")
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(10) << (t.stageEnd - t.stageStart)
+                  << std::setw(10) << (t.runEnd - t.runStart)
+                  << std::endl;
+    }
+
+    std::cout << "makespan[s]: " << std::fixed << std::setprecision(2)
+              << makespan << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////
+//
+std::vector<GridNPB::TaskDescription>
+GridNPB::DataFlowDriver::makeGraph(std::string type, std::string npbClass,
+                                   int width, std::string npbHome)
+{
+    std::vector<TaskDescription> graph;
+
+    if(type == "ED")
+    {
+        // width independent SP instances, one chain each so they spread
+        // over all resources
+        for(int i = 0; i < width; ++i)
+        {
+            TaskDescription t;
+            t.name = "ed_sp_" + boost::lexical_cast<std::string>(i);
+            t.executable = npbHome + "/sp." + npbClass + ".x";
+            t.chain = i;
+            graph.push_back(t);
+        }
+    }
+    else if(type == "HC")
+    {
+        // one helical chain: bt -> sp -> lu -> bt -> ..., each task
+        // feeding the next, all co-scheduled on one resource
+        char const * kernels[] = { "bt", "sp", "lu" };
+        for(int i = 0; i < width; ++i)
+        {
+            TaskDescription t;
+            t.name = std::string("hc_") + kernels[i % 3] + "_"
+                     + boost::lexical_cast<std::string>(i);
+            t.executable = npbHome + "/" + kernels[i % 3] + "."
+                           + npbClass + ".x";
+            t.chain = 0;
+            // each task hands its solution array to the next one; with
+            // the chain packed onto one resource these files live on
+            // the in-memory data plane and are opened in place
+            t.outputFiles.push_back(t.name + ".arr");
+            if(i > 0)
+            {
+                t.dependsOn.push_back(i - 1);
+                t.inputFiles.push_back(graph[i - 1].name + ".arr");
+            }
+            graph.push_back(t);
+        }
+    }
+    else if(type == "VP" || type == "MB")
+    {
+        // visualization pipeline: bt (flow) -> mg (smoothing) -> ft
+        // (spectral), over width datasets. Task (stage, dataset) depends
+        // on its producer (stage-1, dataset) and its own stage's previous
+        // dataset (stage, dataset-1). Each stage is one chain, so a stage
+        // stays on one resource while successive datasets stream through.
+        // MB uses lu everywhere, which yields the intended imbalance.
+        char const * stages[3];
+        if(type == "VP") {
+            stages[0] = "bt"; stages[1] = "mg"; stages[2] = "ft";
+        }
+        else {
+            stages[0] = "lu"; stages[1] = "lu"; stages[2] = "lu";
+        }
+
+        for(int d = 0; d < width; ++d)
+        {
+            for(int s = 0; s < 3; ++s)
+            {
+                TaskDescription t;
+                t.name = std::string(stages[s]) + "_"
+                         + boost::lexical_cast<std::string>(s) + "_"
+                         + boost::lexical_cast<std::string>(d);
+                t.executable = npbHome + "/" + stages[s] + "."
+                               + npbClass + ".x";
+                t.chain = s;
+                // a stage passes each dataset on to the next stage;
+                // between chains this goes over file staging, unless the
+                // scheduler happens to pack both stages onto one resource
+                t.outputFiles.push_back(t.name + ".arr");
+                if(s > 0)
+                {
+                    t.dependsOn.push_back(d * 3 + (s - 1));
+                    t.inputFiles.push_back(graph[d * 3 + (s - 1)].name
+                                           + ".arr");
+                }
+                if(d > 0)
+                    t.dependsOn.push_back((d - 1) * 3 + s);
+                graph.push_back(t);
+            }
+        }
+    }
+
+    return graph;
+}
@@ -0,0 +1,128 @@
+/*
+ *  DataFlowDriver.hpp
+ *  GridNPB-SAGA
+ *
+ *  Copyright 2008 Center for Computation & Technology. All rights reserved.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include <saga/saga.hpp>
+
+#include "defines.hpp"
+#include "LogWriter.hpp"
+
+#ifndef GRIDNPB_DATAFLOWDRIVER_H
+#define GRIDNPB_DATAFLOWDRIVER_H
+
+namespace GridNPB
+{
+    ////////////////////////////////////////////////////////////////////////////
+    // one node of an NPB dataflow graph
+    struct TaskDescription {
+        std::string name;
+        std::string executable;
+        std::vector<std::string> arguments;
+        std::vector<std::string> inputFiles;   // staged to the data dir before launch
+        std::vector<std::string> outputFiles;  // basenames produced in the data dir,
+                                               // consumed by dependent tasks
+        std::vector<int> dependsOn;            // indices into the graph
+        int chain;                             // tasks sharing a chain id are
+                                               // placed on the same resource
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // one execution resource the graph can be mapped onto
+    struct ResourceDescription {
+        saga::url rmURL;
+        std::string workdir;
+        std::string queue;
+        std::string allocation;
+        std::string shmDir;     // shared-memory (tmpfs) path used as the data
+                                // dir for co-located chains; empty disables
+                                // the in-memory data plane on this resource
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Runs NPB dataflow graphs (ED/HC/VP/MB) through saga::job.
+    //
+    // Placement is co-scheduled: all tasks of a chain go to one resource,
+    // so intra-chain data flows over the resource's own filesystem instead
+    // of the WAN. Stage-in of a task's declared input files starts as soon
+    // as the graph is submitted and runs while its predecessors compute,
+    // so a task whose dependencies finish normally finds its inputs
+    // already in place. The final report prints per-task stage and run
+    // times plus the makespan in a fixed format, so runs on different
+    // platforms can be compared line by line.
+    //
+    // The data plane is co-location aware: tasks of a multi-task chain
+    // run with a shared-memory (tmpfs) directory as their data dir, so
+    // the arrays a task writes for its successor never touch disk and
+    // need no copy at all - the consumer simply opens them in place. An
+    // input produced on another resource falls back to the existing file
+    // staging, fetched from the producer's data directory. For the HC
+    // graph this removes nearly all I/O when the scheduler packs the
+    // chain onto one resource.
+    class DataFlowDriver {
+
+    private:
+        enum TaskState {
+            Waiting  = 1,
+            Ready    = 2,
+            Running  = 3,
+            Done     = 4,
+            Failed   = 5
+        };
+
+        struct Task {
+            TaskDescription desc;
+            TaskState state;
+            int resource;
+            bool shmPlane;      // data dir is the resource's tmpfs path
+            saga::job::job job;
+            saga::task_container stageIn;
+            bool stageInStarted;
+            double stageStart;
+            double stageEnd;
+            double runStart;
+            double runEnd;
+        };
+
+        std::vector<Task> tasks_;
+        std::vector<ResourceDescription> resources_;
+        LogWriter * logwriter;
+
+        void assignResources_();
+        std::string dataDir_(Task const & t);
+        int producerOf_(Task const & t, std::string const & basename);
+        void beginStageIn_(Task & t);
+        bool stageInDone_(Task & t);
+        bool depsDone_(Task & t, bool & failed);
+        void launch_(Task & t);
+        void report_(double makespan);
+
+        static double now_();
+
+    public:
+        DataFlowDriver(std::vector<ResourceDescription> resources);
+        ~DataFlowDriver();
+
+        // add one task, returns its index (used in dependsOn)
+        int addTask(TaskDescription task);
+
+        // run the graph to completion. Blocks.
+        void run();
+
+        // canned GridNPB graphs: "ED" (width independent instances),
+        // "HC" (one chain of width tasks), "VP"/"MB" (three pipeline
+        // stages over width datasets). npbHome locates the NPB binaries.
+        static std::vector<TaskDescription> makeGraph(std::string type,
+                                                      std::string npbClass,
+                                                      int width,
+                                                      std::string npbHome);
+    };
+}
+
+#endif // GRIDNPB_DATAFLOWDRIVER_H
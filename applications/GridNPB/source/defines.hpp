@@ -0,0 +1,21 @@
+/*
+ *  defines.hpp
+ *  GridNPB-SAGA
+ *
+ *  Copyright 2008 Center for Computation & Technology. All rights reserved.
+ *
+ */
+
+#ifndef GRIDNPB_DEFINES_HPP
+#define GRIDNPB_DEFINES_HPP
+
+#define APP_NAME                "GridNPB-SAGA"
+
+// seconds between job state sweeps in the dataflow driver
+#define GRIDNPB_POLL_INTERVAL   2
+
+// default shared-memory (tmpfs) path for the co-located data plane;
+// overridable per run via GRIDNPB_SHM_DIR
+#define GRIDNPB_SHM_DIR         "/dev/shm/gridnpb"
+
+#endif // GRIDNPB_DEFINES_HPP
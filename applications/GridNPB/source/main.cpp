@@ -16,19 +16,67 @@
 #include <boost/program_options.hpp>
 
 #include "TaskController.hpp"
+#include "DataFlowDriver.hpp"
 
-int main (int argc, char * const argv[]) 
+int main (int argc, char * const argv[])
 {
+    // dataflow mode: main <ED|HC|VP|MB> [class] [width] [rm_url ...]
+    // runs the given NPB dataflow graph through the driver, with chains
+    // co-scheduled over the listed resource managers
+    if (argc > 1)
+    {
+        std::string graph(argv[1]);
+        std::string npbClass = (argc > 2) ? argv[2] : "A";
+        int width = (argc > 3) ? boost::lexical_cast<int>(argv[3]) : 4;
+
+        char const * shmDir = ::getenv("GRIDNPB_SHM_DIR");
+
+        std::vector<GridNPB::ResourceDescription> resources;
+        for (int i = 4; i < argc; ++i)
+        {
+            GridNPB::ResourceDescription rd;
+            rd.rmURL = saga::url(argv[i]);
+            rd.workdir = "/work/oweidner/";
+            rd.queue = "checkpt";
+            rd.allocation = "loni_jha_big";
+            rd.shmDir = shmDir ? shmDir : GRIDNPB_SHM_DIR;
+            resources.push_back(rd);
+        }
+        if (resources.empty())
+        {
+            GridNPB::ResourceDescription rd;
+            rd.rmURL = saga::url("any://oliver1.loni.org/jobmanager-pbs");
+            rd.workdir = "/work/oweidner/";
+            rd.queue = "checkpt";
+            rd.allocation = "loni_jha_big";
+            rd.shmDir = shmDir ? shmDir : GRIDNPB_SHM_DIR;
+            resources.push_back(rd);
+        }
+
+        char const * npbHome = ::getenv("GRIDNPB_NPB_HOME");
+
+        std::vector<GridNPB::TaskDescription> tasks =
+            GridNPB::DataFlowDriver::makeGraph(graph, npbClass, width,
+                                               npbHome ? npbHome : ".");
+
+        GridNPB::DataFlowDriver driver(resources);
+        for (unsigned int i = 0; i < tasks.size(); ++i)
+            driver.addTask(tasks[i]);
+
+        driver.run();
+        return EXIT_SUCCESS;
+    }
+
     saga::url rm_url_1("any://oliver1.loni.org/jobmanager-pbs");
 
-    
-    GridNPB::TaskController t1(rm_url_1, 
-                               "/work/oweidner/", 
-                               "checkpt", 
+
+    GridNPB::TaskController t1(rm_url_1,
+                               "/work/oweidner/",
+                               "checkpt",
                                "loni_jha_big",
                                16);
 
-    
-    
+
+
     return EXIT_SUCCESS;
 }
@@ -5,3 +5,105 @@
 
 #include "Partitioner.hpp"
 
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "input_output.hpp"
+
+namespace {
+
+// Cap on the number of chunks sampled; one sampler thread runs per
+// sampled chunk.
+const int kMaxSampledChunks = 8;
+
+// Sampler thread body: read one chunk, keeping the payload of every
+// keep_every-th key.
+void SampleChunk(mapreduce::RawInputFormat* input_format,
+  mapreduce::JobDescription* job, mapreduce::InputChunk* chunk,
+  long keep_every, std::vector<std::string>* samples) {
+  try {
+    boost::scoped_ptr<mapreduce::RawRecordReader> reader(
+      input_format->GetRecordReader(chunk, job));
+    const uint8* buffer;
+    int size;
+    long records = 0;
+    while (reader->NextRecord()) {
+      if (records++ % keep_every == 0) {
+        reader->get_key_buffer(&buffer, &size);
+        samples->push_back(RangePartitioner::KeyPayload(
+          std::string(reinterpret_cast<const char*>(buffer), size)));
+      }
+    }
+    reader->Close();
+  } catch (saga::exception const&) {
+    // A failed sampler only degrades the balance of the split points;
+    // whatever was sampled so far is still used.
+  }
+}
+
+}   // namespace
+
+void RangePartitioner::SampleSplitPoints(mapreduce::JobDescription* job,
+  mapreduce::RawInputFormat* input_format,
+  const std::vector<mapreduce::InputChunk*>& chunks) {
+  int num_split_points = job->get_num_reduce_tasks() - 1;
+  if (num_split_points < 1 || chunks.empty()) {
+    return;
+  }
+  float sample_rate = job->get_attribute(JOB_ATTRIBUTE_RANGE_SAMPLE_RATE,
+    0.001f);
+  long keep_every = static_cast<long>(1.0f / sample_rate);
+  if (keep_every < 1) {
+    keep_every = 1;
+  }
+  // Sample at most kMaxSampledChunks chunks, spread evenly over the
+  // input, with one sampler thread per chunk.
+  int num_samplers = static_cast<int>(chunks.size());
+  if (num_samplers > kMaxSampledChunks) {
+    num_samplers = kMaxSampledChunks;
+  }
+  std::vector<std::vector<std::string> > samples(num_samplers);
+  boost::thread_group samplers;
+  for (int i = 0; i < num_samplers; ++i) {
+    mapreduce::InputChunk* chunk = chunks[i * chunks.size() / num_samplers];
+    samplers.create_thread(boost::bind(&SampleChunk, input_format, job,
+      chunk, keep_every, &samples[i]));
+  }
+  samplers.join_all();
+  // Merge and sort the sampled key payloads.
+  std::vector<std::string> sampled_keys;
+  for (int i = 0; i < num_samplers; ++i) {
+    sampled_keys.insert(sampled_keys.end(), samples[i].begin(),
+      samples[i].end());
+  }
+  if (sampled_keys.empty()) {
+    return;
+  }
+  std::sort(sampled_keys.begin(), sampled_keys.end());
+  // Pick evenly spaced quantiles as split points, skipping duplicates.
+  std::vector<std::string> split_points;
+  int num_partitions = num_split_points + 1;
+  for (int i = 1; i < num_partitions; ++i) {
+    const std::string& candidate =
+      sampled_keys[i * sampled_keys.size() / num_partitions];
+    if (split_points.empty() || split_points.back() != candidate) {
+      split_points.push_back(candidate);
+    }
+  }
+  // Serialize the table into a job attribute; the JobDescription sent to
+  // every worker broadcasts it.
+  std::string table;
+  {
+    StringOutputStream output(&table);
+    CodedOutputStream coded_out(&output);
+    coded_out.WriteVarint32(split_points.size());
+    for (std::vector<std::string>::size_type i = 0; i < split_points.size();
+         ++i) {
+      coded_out.WriteVarint32(split_points[i].size());
+      coded_out.WriteRaw(split_points[i].data(), split_points[i].size());
+    }
+  }
+  job->set_attribute(JOB_ATTRIBUTE_RANGE_SPLIT_POINTS, table);
+}
+
@@ -6,17 +6,31 @@
 #ifndef MAPREDUCE_PARTITIONER_HPP_
 #define MAPREDUCE_PARTITIONER_HPP_
 
+#include <algorithm>
 #include <string>
+#include <vector>
 #include <boost/functional/hash.hpp>
 
 #include "factory_impl.hpp"
+#include "job.hpp"
 
 namespace mapreduce {
 
+// Forward declarations.
+class InputChunk;
+class RawInputFormat;
+
+// Attribute holding the serialized split-point table of RangePartitioner.
+#define JOB_ATTRIBUTE_RANGE_SPLIT_POINTS "mapred.partitioner.range.split_points"
+// Fraction of input records sampled when building the split-point table.
+#define JOB_ATTRIBUTE_RANGE_SAMPLE_RATE "mapred.partitioner.range.sample_rate"
+
 // Interface for partitioning intermediate keys.
 class Partitioner {
  public:
   virtual ~Partitioner() {}
+  // Configure the partitioner from the job's attributes before first use.
+  virtual void Configure(const JobDescription* job) {}
   virtual int GetPartition(const std::string& key, int num_partitions) = 0;
 };
 
@@ -42,4 +56,80 @@ class DefaultPartitioner : public mapreduce::Partitioner {
 };
 REGISTER_PARTITIONER(DefaultPartitioner, 0);
 
+// Range partitioner producing totally ordered output: partition i
+// receives exactly the keys falling between split points i-1 and i, so
+// the concatenation of the sorted reduce outputs is globally sorted with
+// no post-merge. The split-point table is built on the master by
+// SampleSplitPoints from a sample of the chunked input and travels to
+// the workers inside the serialized JobDescription. Keys are compared by
+// the byte order of their serialized payload (the bytes following the
+// varint length prefix), which matches the typed order of string keys;
+// the sampler assumes the mapper emits its input keys unchanged, as an
+// identity mapper does. Falls back to hash partitioning when no table
+// was configured for the job.
+class RangePartitioner : public mapreduce::Partitioner {
+ public:
+  void Configure(const mapreduce::JobDescription* job) {
+    split_points_.clear();
+    const std::string& table = job->get_attribute(
+      JOB_ATTRIBUTE_RANGE_SPLIT_POINTS);
+    if (table.empty()) {
+      return;
+    }
+    ArrayInputStream input(table.data(), table.size());
+    CodedInputStream coded_in(&input);
+    uint32 count = 0;
+    coded_in.ReadVarint32(&count);
+    for (uint32 i = 0; i < count; ++i) {
+      uint32 size;
+      if (!coded_in.ReadVarint32(&size)) {
+        break;
+      }
+      std::string split_point;
+      coded_in.ReadString(&split_point, size);
+      split_points_.push_back(split_point);
+    }
+  }
+  int GetPartition(const std::string& key, int num_partitions) {
+    if (split_points_.empty()) {
+      return boost::hash_value(key) % num_partitions;
+    }
+    int partition = std::lower_bound(split_points_.begin(),
+      split_points_.end(), KeyPayload(key)) - split_points_.begin();
+    // Guard against a table built for a different partition count.
+    if (partition >= num_partitions) {
+      partition = num_partitions - 1;
+    }
+    return partition;
+  }
+  // Sample the chunked input of the job with parallel samplers and store
+  // a balanced split-point table in the job's attributes. Called on the
+  // master after chunking, before the job is broadcast to workers.
+  static void SampleSplitPoints(mapreduce::JobDescription* job,
+    mapreduce::RawInputFormat* input_format,
+    const std::vector<mapreduce::InputChunk*>& chunks);
+  // Get the comparable payload of a serialized key: the bytes following
+  // a well-formed varint length prefix, or the whole buffer otherwise.
+  static std::string KeyPayload(const std::string& serialized_key) {
+    std::string::size_type pos = 0;
+    uint32 size = 0;
+    int shift = 0;
+    while (pos < serialized_key.size() && shift <= 28) {
+      uint8 byte = static_cast<uint8>(serialized_key[pos++]);
+      size |= static_cast<uint32>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        if (size == serialized_key.size() - pos) {
+          return serialized_key.substr(pos);
+        }
+        break;
+      }
+      shift += 7;
+    }
+    return serialized_key;
+  }
+ private:
+  std::vector<std::string> split_points_;  // Sorted by payload bytes.
+};
+REGISTER_PARTITIONER(RangePartitioner, 1);
+
 #endif  // MAPREDUCE_PARTITIONER_HPP_
@@ -34,7 +34,7 @@ class RawBytesComparator : public RawComparator<T> {
 // Default comparator class which deserializes the keys from the given buffers
 // and compares them using comparison operators.
 template <class T>
-class DefaultComparator {
+class DefaultComparator : public RawComparator<T> {
  public:
   int Compare(const uint8* data1, int size1, const uint8* data2, int size2) {
     ArrayInputStream ais1(data1, size1);
@@ -52,6 +52,27 @@ class DefaultComparator {
   }
 };
 
+// Comparator for varint-encoded fixed-width integer keys: decodes the
+// varints in place and compares natively, so numeric keys sort numerically
+// without constructing a CodedInputStream pair per comparison. Selected at
+// compile time by KeyComparator<int> (see factory_impl.hpp).
+template <class T>
+class VarintIntegerComparator : public RawComparator<T> {
+ public:
+  int Compare(const uint8* data1, int size1, const uint8* data2, int size2);
+};
+
+// Comparator for length-prefixed byte keys (std::string, RawBuffer): skips
+// the varint length prefix and memcmps the contents, with the shorter key
+// winning a common prefix - the order operator< gives on the deserialized
+// keys. RawBytesComparator would compare the length prefix first and order
+// short keys before long ones regardless of content.
+template <class T>
+class LengthPrefixedBytesComparator : public RawComparator<T> {
+ public:
+  int Compare(const uint8* data1, int size1, const uint8* data2, int size2);
+};
+
 // Simple iterator interface for enumerating values for a given key.
 template <typename T>
 class Iterator {
@@ -116,7 +137,7 @@ class ReducerContext : public Iterator<ValueIn> {
 // Reducer class definition.
 //
 template <typename KeyIn, typename ValueIn, typename KeyOut, typename ValueOut,
-  class Comparator = DefaultComparator<KeyOut> >
+  class Comparator = typename KeyComparator<KeyIn>::type >
 class Reducer {
  public:
   virtual ~Reducer() {}
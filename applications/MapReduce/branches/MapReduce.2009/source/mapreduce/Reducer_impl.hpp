@@ -17,6 +17,61 @@ int RawBytesComparator<T>::Compare(const uint8* data1, int size1,
     reinterpret_cast<const void*>(data2), size);
 }
 
+// Decode one varint straight from a buffer, returning the number of bytes
+// consumed. Comparators run once per merge step, so they cannot afford a
+// CodedInputStream per call. Only the low 32 bits are kept - enough for
+// the lengths and the sign-extended integers our serialization writes.
+inline int DecodeVarint32Raw(const uint8* data, int size, uint32* value) {
+  uint32 result = 0;
+  int shift = 0;
+  int consumed = 0;
+  while (consumed < size) {
+    uint8 byte = data[consumed++];
+    if (shift < 32) {
+      result |= static_cast<uint32>(byte & 0x7f) << shift;
+    }
+    if (!(byte & 0x80)) {
+      break;
+    }
+    shift += 7;
+  }
+  *value = result;
+  return consumed;
+}
+
+template <class T>
+int VarintIntegerComparator<T>::Compare(const uint8* data1, int size1,
+  const uint8* data2, int size2) {
+  uint32 raw1, raw2;
+  DecodeVarint32Raw(data1, size1, &raw1);
+  DecodeVarint32Raw(data2, size2, &raw2);
+  // Same reinterpretation SerializationHandler<int>::Deserialize applies.
+  T key1 = static_cast<T>(raw1);
+  T key2 = static_cast<T>(raw2);
+  if (key1 < key2) {
+    return -1;
+  } else if (key1 > key2) {
+    return 1;
+  } else {
+    return 0;
+  }
+}
+
+template <class T>
+int LengthPrefixedBytesComparator<T>::Compare(const uint8* data1, int size1,
+  const uint8* data2, int size2) {
+  uint32 length1, length2;
+  int head1 = DecodeVarint32Raw(data1, size1, &length1);
+  int head2 = DecodeVarint32Raw(data2, size2, &length2);
+  int size = std::min(length1, length2);
+  int order = memcmp(reinterpret_cast<const void*>(data1 + head1),
+    reinterpret_cast<const void*>(data2 + head2), size);
+  if (order != 0) {
+    return order;
+  }
+  return length1 < length2 ? -1 : (length1 > length2 ? 1 : 0);
+}
+
 template <typename KeyIn, typename ValueIn, typename KeyOut, typename ValueOut>
 void ReducerContext<KeyIn, ValueIn, KeyOut, ValueOut>::Initialize(
   RawRecordReader* input, RawComparator<KeyIn>* comparator,
@@ -8,9 +8,11 @@
 
 // Common code needed for the different class factories.
 
+#include <string>
+
 #include "factory.hpp"
 
-using ::factory_ns::factory; 
+using ::factory_ns::factory;
 using ::factory_ns::signatures;
 
 #define DEFINE_CLASS_CREATOR_INTERFACE(name, classname) \
@@ -20,4 +22,44 @@ class name {  \
   virtual classname* Create() = 0; \
 };
 
+namespace mapreduce {
+
+// Comparator classes (defined in Reducer.hpp) and the RawBuffer view
+// (defined in serialization.hpp).
+template <class T> class DefaultComparator;
+template <class T> class VarintIntegerComparator;
+template <class T> class LengthPrefixedBytesComparator;
+struct RawBuffer;
+
+// Compile-time selection of the key comparator from the job's key type.
+// Every specialization orders keys exactly like operator< on the
+// deserialized objects, so sorted runs stay mergeable no matter which
+// comparator produced them:
+//  - fixed-width integer keys decode their varints in place and compare
+//    natively,
+//  - length-prefixed byte keys memcmp their contents directly,
+//  - everything else falls back to deserializing both keys
+//    (DefaultComparator).
+template <typename KeyT>
+struct KeyComparator {
+  typedef DefaultComparator<KeyT> type;
+};
+
+template <>
+struct KeyComparator<int> {
+  typedef VarintIntegerComparator<int> type;
+};
+
+template <>
+struct KeyComparator<std::string> {
+  typedef LengthPrefixedBytesComparator<std::string> type;
+};
+
+template <>
+struct KeyComparator<RawBuffer> {
+  typedef LengthPrefixedBytesComparator<RawBuffer> type;
+};
+
+}   // namespace mapreduce
+
 #endif    // MAPREDUCE_FACTORY_IMPL_HPP_
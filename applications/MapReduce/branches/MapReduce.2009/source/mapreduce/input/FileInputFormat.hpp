@@ -7,6 +7,7 @@
 #define MAPREDUCE_INPUT_FILEINPUTFORMAT_HPP_
 
 #include <boost/algorithm/string.hpp>
+#include <boost/scoped_ptr.hpp>
 #include "../input_output.hpp"
 
 #define JOB_ATTRIBUTE_FILE_INPUTPATH  "mapreduce.file.input_path"
@@ -37,6 +38,84 @@ class FileInputChunk : public InputChunk {
   std::vector<saga::url> hosts_;
 };
 
+// InputChunk combining several whole (small) files into one split, so a
+// map task costs roughly the same no matter how the input bytes are
+// distributed over files. Built by FileInputFormat's split planner; on
+// the wire it is framed by a zero url length, which a single-file chunk
+// can never start with.
+class MultiFileInputChunk : public InputChunk {
+ public:
+  MultiFileInputChunk() {}
+  void Add(const FileInputChunk& file) {
+    files_.push_back(file);
+  }
+  std::vector<FileInputChunk>& files() { return files_; }
+  // InputChunk implementation.
+  int GetLength() const {
+    int total = 0;
+    for (size_t i = 0; i < files_.size(); ++i) {
+      total += files_[i].GetLength();
+    }
+    return total;
+  }
+  const std::vector<saga::url>& GetLocations() {
+    // Meaningful only when all members share a location; like the
+    // single-file chunk, not populated yet.
+    return locations_;
+  }
+ private:
+  std::vector<FileInputChunk> files_;
+  std::vector<saga::url> locations_;
+};
+
+// RawRecordReader chaining the records of a MultiFileInputChunk's files.
+// The per-file readers come from the owning input format, so any format
+// that understands single-file chunks handles combined splits for free.
+class MultiFileRecordReader : public RawRecordReader {
+ public:
+  MultiFileRecordReader(RawInputFormat* format, MultiFileInputChunk* chunk,
+    JobDescription* job)
+    : format_(format), chunk_(chunk), job_(job), next_file_(0) {}
+  // RawRecordReader implementation.
+  void Initialize(InputChunk* input_chunk) {
+    // The files were given at construction time.
+  }
+  bool NextRecord() {
+    while (true) {
+      if (NULL == current_.get()) {
+        if (next_file_ >= chunk_->files().size()) {
+          return false;
+        }
+        current_.reset(format_->GetRecordReader(
+          &chunk_->files()[next_file_], job_));
+        ++next_file_;
+      }
+      if (current_->NextRecord()) {
+        return true;
+      }
+      current_->Close();
+      current_.reset();
+    }
+  }
+  ZeroCopyInputStream* current_key() { return current_->current_key(); }
+  void get_key_buffer(const uint8** buffer, int* size) {
+    current_->get_key_buffer(buffer, size);
+  }
+  ZeroCopyInputStream* current_value() { return current_->current_value(); }
+  void Close() {
+    if (NULL != current_.get()) {
+      current_->Close();
+      current_.reset();
+    }
+  }
+ private:
+  RawInputFormat* format_;
+  MultiFileInputChunk* chunk_;
+  JobDescription* job_;
+  size_t next_file_;
+  boost::scoped_ptr<RawRecordReader> current_;
+};
+
 // Serialization support for FileInputChunk.
 template<>
 class SerializationHandler<FileInputChunk> {
@@ -80,15 +159,59 @@ class FileInputFormat : public RawInputFormat {
   // RawInputFormat implementation.
   //
   void SerializeInputChunk(InputChunk* chunk, ZeroCopyOutputStream* buffer) {
+    MultiFileInputChunk* multi_chunk = dynamic_cast<MultiFileInputChunk*>(chunk);
+    if (multi_chunk) {
+      // Framing: a zero url length (impossible for a single-file chunk)
+      // followed by the member count and the members.
+      CodedOutputStream coded_output(buffer);
+      coded_output.WriteVarint32(0);
+      std::vector<FileInputChunk>& files = multi_chunk->files();
+      coded_output.WriteVarint32(files.size());
+      for (size_t i = 0; i < files.size(); ++i) {
+        const std::string& url = files[i].path().get_url();
+        coded_output.WriteVarint32(url.length());
+        coded_output.WriteRaw(url.data(), url.length());
+        coded_output.WriteVarint32(files[i].start_offset());
+        coded_output.WriteVarint32(files[i].GetLength());
+      }
+      return;
+    }
     FileInputChunk* input_chunk = dynamic_cast<FileInputChunk*>(chunk);
     assert(input_chunk);
     SerializationHandler<FileInputChunk>::Serialize(input_chunk, buffer);
   }
   InputChunk* CreateInputChunk(ZeroCopyInputStream* input) {
+    CodedInputStream coded_input(input);
+    uint32 url_length;
+    coded_input.ReadVarint32(&url_length);
+    std::vector<saga::url> no_locations;
+    if (0 == url_length) {
+      // Combined split (see SerializeInputChunk).
+      MultiFileInputChunk* multi_chunk = new MultiFileInputChunk();
+      uint32 file_count;
+      coded_input.ReadVarint32(&file_count);
+      for (uint32 i = 0; i < file_count; ++i) {
+        coded_input.ReadVarint32(&url_length);
+        std::string url;
+        coded_input.ReadString(&url, url_length);
+        uint32 start_offset;
+        uint32 length;
+        coded_input.ReadVarint32(&start_offset);
+        coded_input.ReadVarint32(&length);
+        multi_chunk->Add(FileInputChunk(saga::url(url), start_offset,
+          length, no_locations));
+      }
+      return multi_chunk;
+    }
     // Deserialize FileInputChunk from buffer.
-    FileInputChunk* input_chunk = new FileInputChunk();
-    SerializationHandler<FileInputChunk>::Deserialize(input, input_chunk);
-    return input_chunk;
+    std::string url;
+    coded_input.ReadString(&url, url_length);
+    uint32 start_offset;
+    uint32 length;
+    coded_input.ReadVarint32(&start_offset);
+    coded_input.ReadVarint32(&length);
+    return new FileInputChunk(saga::url(url), start_offset, length,
+      no_locations);
   }
   // Chunk the input data specified in the job's descriptor.
   std::vector<InputChunk*> GetChunks(const JobDescription& job) {
@@ -122,7 +245,16 @@ class FileInputFormat : public RawInputFormat {
         file_list.push_back(url);
       }
     }
-    // Generate chunks for each file.
+    // Plan splits towards a common bytes-per-split target, so map task
+    // durations stay comparable on heavy-tailed file size distributions:
+    // a file of at least the target size is divided into near-equal
+    // parts (for SequenceFiles the record reader aligns each part to the
+    // next sync marker through the block index), smaller files are
+    // packed whole into combined splits.
+    int target_split_size = job.get_attribute("file.input.max_chunk_size",
+        64*1024*1024);
+    MultiFileInputChunk* bin = NULL;
+    saga::off_t bin_bytes = 0;
     std::vector<saga::url>::const_iterator file_it = file_list.begin();
     while (file_it != file_list.end()) {
       // Get replicas for this file.
@@ -130,12 +262,41 @@ class FileInputFormat : public RawInputFormat {
       //saga::replica::logical_file logical_file(url);
       //const std::vector<saga::url>& locations = logical_file.list_locations();
       std::vector<saga::url> locations;
-      // Create chunks for this file.
-      ChunkFile(job, *file_it, locations, result);
+      saga::filesystem::file file(*file_it);
+      saga::off_t size = file.get_size();
+      if (size >= target_split_size) {
+        // Create chunks for this file.
+        ChunkFile(*file_it, size, target_split_size, locations, result);
+      } else if (size > 0) {
+        if (NULL != bin && bin_bytes + size > target_split_size) {
+          result.push_back(SealBin(bin));
+          bin = NULL;
+        }
+        if (NULL == bin) {
+          bin = new MultiFileInputChunk();
+          bin_bytes = 0;
+        }
+        bin->Add(FileInputChunk(*file_it, 0, static_cast<int>(size),
+          locations));
+        bin_bytes += size;
+      }
       ++file_it;
     }
+    if (NULL != bin) {
+      result.push_back(SealBin(bin));
+    }
     return result;
   }
+ protected:
+  // Returns a chained reader for combined splits and NULL for single-file
+  // chunks; every GetRecordReader implementation consults this first.
+  RawRecordReader* MultiFileReaderFor(InputChunk* chunk, JobDescription* job) {
+    MultiFileInputChunk* multi_chunk = dynamic_cast<MultiFileInputChunk*>(chunk);
+    if (NULL == multi_chunk) {
+      return NULL;
+    }
+    return new MultiFileRecordReader(this, multi_chunk, job);
+  }
  private:
   // Retrieve the input paths from the job's description. 
   void ListInputPaths(const JobDescription& job,
@@ -144,24 +305,34 @@ class FileInputFormat : public RawInputFormat {
     // Tokenize path list.
     ::boost::split(result, paths, ::boost::is_any_of(";"));
   }
-  // Split the given file into chunks.
-  void ChunkFile(const JobDescription& job, const saga::url& url,
-    const std::vector<saga::url>& locations, std::vector<InputChunk*>& result) {
-    // Take maximum chunk size into consideration.
-    int max_chunk_size = job.get_attribute("file.input.max_chunk_size",
-        64*1024*1024);
-    saga::filesystem::file file(url);
+  // Split the given file into near-equal parts of at most target_split_size
+  // bytes. Rounding the part size up distributes the remainder over all
+  // parts instead of leaving one undersized tail task.
+  void ChunkFile(const saga::url& url, saga::off_t size,
+    int target_split_size, const std::vector<saga::url>& locations,
+    std::vector<InputChunk*>& result) {
+    saga::off_t parts = (size + target_split_size - 1) / target_split_size;
+    saga::off_t part_size = (size + parts - 1) / parts;
     saga::off_t offset = 0;
-    saga::off_t remaining_size = file.get_size();
+    saga::off_t remaining_size = size;
     while (remaining_size > 0) {
-      int chunk_size = (remaining_size < max_chunk_size) ?
-          static_cast<int>(remaining_size) : max_chunk_size;
+      int chunk_size = (remaining_size < part_size) ?
+          static_cast<int>(remaining_size) : static_cast<int>(part_size);
       result.push_back(new FileInputChunk(url, static_cast<int>(offset),
           chunk_size, locations));
       offset += chunk_size;
       remaining_size -= chunk_size;
     }
   }
+  // A bin of one small file needs no combined split machinery.
+  InputChunk* SealBin(MultiFileInputChunk* bin) {
+    if (1 == bin->files().size()) {
+      InputChunk* single = new FileInputChunk(bin->files()[0]);
+      delete bin;
+      return single;
+    }
+    return bin;
+  }
 };
 
 }   // namespace mapreduce
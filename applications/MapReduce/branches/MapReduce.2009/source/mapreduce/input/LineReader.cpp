@@ -1,7 +1,48 @@
 #include "LineReader.hpp"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace mapreduce {
 
+#ifdef __SSE2__
+// Find the first '\r' or '\n' in [pointer, end); returns end when there is
+// none. Classifies 16 bytes per step: unaligned load, byte-compare against
+// both terminators, and the movemask picks out the first hit.
+inline static const char* FindNewline(const char* pointer, const char* end) {
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  while (end - pointer >= 16) {
+    __m128i block = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(pointer));
+    __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, cr),
+      _mm_cmpeq_epi8(block, lf));
+    int mask = _mm_movemask_epi8(hits);
+    if (mask != 0) {
+      return pointer + __builtin_ctz(mask);
+    }
+    pointer += 16;
+  }
+  for (; pointer < end; ++pointer) {
+    if (*pointer == '\r' || *pointer == '\n') {
+      return pointer;
+    }
+  }
+  return end;
+}
+#else
+// Portable fallback of the 16-byte classification above.
+inline static const char* FindNewline(const char* pointer, const char* end) {
+  for (; pointer < end; ++pointer) {
+    if (*pointer == '\r' || *pointer == '\n') {
+      return pointer;
+    }
+  }
+  return end;
+}
+#endif
+
 int LineReader::ReadLine(std::string* line, int max_line_length) {
   line->clear();
   int newline_length = 0;
@@ -18,18 +59,27 @@ int LineReader::ReadLine(std::string* line, int max_line_length) {
       }
       buffer_position_ = start_position = 0;
     }
-    bool previous_cr = false;   // Whether we read a CR in the previous pass.
-    for (; buffer_position_ < buffer_length_; ++buffer_position_) {
-      if (buffer_pointer_[buffer_position_] == '\r') {
-        previous_cr = true;
-        ++newline_length;
-        continue;
-      } else if (buffer_pointer_[buffer_position_] == '\n') {
+    // Scan for the end of the line. Outside of a newline run the scan goes
+    // through FindNewline; the run itself is consumed bytewise, since it is
+    // almost always one or two characters. newline_length carries a run
+    // across buffer seams, so a "\r\n" split over two reads still counts as
+    // one terminator.
+    while (buffer_position_ < buffer_length_) {
+      if (newline_length == 0) {
+        const char* hit = FindNewline(buffer_pointer_ + buffer_position_,
+          buffer_pointer_ + buffer_length_);
+        buffer_position_ = hit - buffer_pointer_;
+        if (buffer_position_ >= buffer_length_) {
+          break;
+        }
+      }
+      char current = buffer_pointer_[buffer_position_];
+      if (current == '\r' || current == '\n') {
         ++newline_length;
+        ++buffer_position_;
         continue;
-      } else if (newline_length > 0){
-        break;
       }
+      break;    // First character after the newline run.
     }
     consumed_bytes += buffer_position_ - start_position;
     // Decide how much to append to the line buffer.
@@ -41,8 +91,14 @@ int LineReader::ReadLine(std::string* line, int max_line_length) {
     }
     if (newline_length > 0) {
       if (size > max_line_length) {
+        // Drop the over-long line and carry on with the next one. The
+        // scan state must be reset here: leaving newline_length and
+        // start_position behind (as the previous revision did) made this
+        // branch loop forever re-appending the same bytes.
         size = 0;
         line->clear();
+        newline_length = 0;
+        start_position = buffer_position_;
         continue;
       } else {
         break;
@@ -9,6 +9,11 @@
 using google::protobuf::io::CopyingInputStreamAdaptor;
 using google::protobuf::io::CopyingInputStream;
 
+// Read-ahead buffer for streams feeding a LineReader. The protobuf adaptor
+// default (8 KB) makes the SAGA file layer issue small requests; line
+// scanning over remote files wants large sequential reads.
+#define LINEREADER_READAHEAD (256 * 1024)
+
 namespace mapreduce {
 
 class LineReader {
@@ -31,6 +31,27 @@ class SequenceFileRecordReader : public RawRecordReader {
         "SequenceFileRecordReader");
     }
     long offset = chunk->start_offset();
+    // Block-compressed (version 2) files carry a footer index of block
+    // offsets: a split starting mid-file seeks straight to its first block
+    // instead of scanning forward. A split owns the blocks whose sync
+    // marker falls inside [start_offset, start_offset + length).
+    std::vector<int64> blocks;
+    if (SequenceFileReader::ReadBlockIndex(chunk->path(), &blocks)) {
+      Setup(chunk->path(), 0);
+      long end = offset + chunk->GetLength();
+      size_t first = 0;
+      while (first < blocks.size() && blocks[first] < offset) {
+        ++first;
+      }
+      if (first == blocks.size() || blocks[first] >= end) {
+        // No block starts inside this chunk: deliver no records.
+        reader_->set_end_offset(0);
+        return;
+      }
+      reader_->SeekToBlock(blocks[first]);
+      reader_->set_end_offset(end);
+      return;
+    }
     Setup(chunk->path(), offset);
   }
   // Retrieve next record.
@@ -83,6 +104,10 @@ class SequenceFileRecordReader : public RawRecordReader {
 class SequenceFileInputFormat : public FileInputFormat {
  public:
   RawRecordReader* GetRecordReader(InputChunk* chunk, JobDescription* job) {
+    RawRecordReader* multi_reader = MultiFileReaderFor(chunk, job);
+    if (NULL != multi_reader) {
+      return multi_reader;
+    }
     SequenceFileRecordReader* reader = new SequenceFileRecordReader();
     reader->Initialize(chunk);
     return reader;
@@ -30,7 +30,7 @@ void TextRecordReader::Initialize(InputChunk* chunk) {
   }
   file_input->Skip(file_offset_);
   CopyingInputStreamAdaptor* adaptor = new CopyingInputStreamAdaptor(
-    file_input);
+    file_input, LINEREADER_READAHEAD);
   // The adaptor should free the CopyingStream.
   adaptor->SetOwnsCopyingStream(true);
   input_stream_.reset(adaptor);
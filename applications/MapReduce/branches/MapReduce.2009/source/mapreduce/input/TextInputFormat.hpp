@@ -47,6 +47,10 @@ class TextInputFormat : public FileInputFormat {
  public:
   // Create a record reader to be used by the Mapper/Combiner/Reducer function.
   RawRecordReader* GetRecordReader(InputChunk* chunk, JobDescription* job) {
+    RawRecordReader* multi_reader = MultiFileReaderFor(chunk, job);
+    if (NULL != multi_reader) {
+      return multi_reader;
+    }
     TextRecordReader* reader = new TextRecordReader();
     reader->Initialize(chunk);
     return reader;
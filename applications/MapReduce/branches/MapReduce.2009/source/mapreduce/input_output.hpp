@@ -94,6 +94,13 @@ class RawRecordWriter {
   virtual ~RawRecordWriter() {};
   // Output the given key/value pair.
   virtual void Write(const std::string& key, const std::string& value) = 0;
+  // Output a key/value pair given as raw byte views. The default
+  // implementation copies the views into strings; writers that can consume
+  // plain pointers (such as SequenceFileRecordWriter) override this to
+  // skip that copy.
+  virtual void Write(const RawBuffer& key, const RawBuffer& value) {
+    Write(std::string(key.data, key.size), std::string(value.data, value.size));
+  }
   // Close the record writer.
   virtual void Close() = 0;
 };
@@ -115,8 +122,8 @@ class RecordWriter {
     StringOutputStream value_out(&value_buffer_);
     SerializationHandler<KeyT>::Serialize(&key, &key_out);
     SerializationHandler<ValueT>::Serialize(&value, &value_out);
-    // Write them using the RawRecordWriter.
-    raw_writer_->Write(key_buffer_, value_buffer_);
+    // Write them using the RawRecordWriter as views over the buffers.
+    raw_writer_->Write(RawBuffer(key_buffer_), RawBuffer(value_buffer_));
   }
   // Close the record writer.
   virtual void Close() {
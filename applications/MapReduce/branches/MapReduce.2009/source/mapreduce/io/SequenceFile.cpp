@@ -1,15 +1,26 @@
 //  Copyright (c) 2009 Miklos Erdelyi
 //
-//  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
 #include "SequenceFile.hpp"
 #include <climits>
-#include "../io/saga_file_adaptors.hpp" 
+#include <cstring>
+#include <zlib.h>
+#include "../io/saga_file_adaptors.hpp"
+
+using google::protobuf::uint64;
 
 namespace mapreduce { namespace io {
 
 char SequenceFile::header[] = {'S', 'Q', 'F', SEQUENCEFILE_VERSION};
+// Arbitrary but fixed byte sequence; a reader verifies it after every seek
+// and between blocks. Chosen to be invalid UTF-8 so it cannot occur in
+// text records by accident.
+char SequenceFile::sync_marker[16] = {
+  '\xf1', 'S', 'Q', 'F', '\xb2', '\x07', '\x9c', '\xe4',
+  '\x55', '\xaa', '\x0f', '\xd8', '\x63', '\x21', '\x8e', '\xfe'};
+char SequenceFile::index_magic[8] = {'S', 'Q', 'F', 'I', 'D', 'X', '0', '2'};
 
 //
 // SequenceFileReader implementation.
@@ -34,6 +45,10 @@ void SequenceFileReader::Initialize(const saga::url& path, long offset) {
   if (header_contents[3] > SEQUENCEFILE_VERSION) {
     throw saga::exception(path.get_string() + " is unsupported");
   }
+  block_mode_ = (header_contents[3] >= 2);
+  pos_ = offset + sizeof(SequenceFile::header);
+  end_offset_ = -1;
+  records_remaining_ = 0;
   // Create input stream.
   input_adaptor_.reset(new CopyingInputStreamAdaptor(input_stream_));
   input_adaptor_->SetOwnsCopyingStream(true);
@@ -65,24 +80,173 @@ inline static bool TransferBetweenStreams(CodedInputStream* input,
   return true;
 }
 
+bool SequenceFileReader::SeekToBlock(int64 offset) {
+  if (!block_mode_ || offset < pos_) {
+    return false;
+  }
+  if (offset > pos_ && !input_->Skip((int)(offset - pos_))) {
+    return false;
+  }
+  pos_ = offset;
+  // Drop any partially consumed block.
+  records_remaining_ = 0;
+  block_input_.reset();
+  block_array_.reset();
+  return true;
+}
+
+bool SequenceFileReader::LoadNextBlock() {
+  // A block belongs to the chunk its sync marker falls into.
+  if (end_offset_ >= 0 && pos_ >= end_offset_) {
+    return false;
+  }
+  char sync[sizeof(SequenceFile::sync_marker)];
+  if (!input_->ReadRaw(sync, sizeof(sync))) {
+    return false;
+  }
+  if (0 != memcmp(sync, SequenceFile::sync_marker, sizeof(sync))) {
+    throw saga::exception("SequenceFile sync marker mismatch (corrupt file "
+      "or seek to a non-block offset)");
+  }
+  pos_ += sizeof(sync);
+  uint32 record_count;
+  if (!input_->ReadVarint32(&record_count)) {
+    return false;
+  }
+  pos_ += CodedOutputStream::VarintSize32(record_count);
+  if (0 == record_count) {
+    // The footer: no more record blocks.
+    return false;
+  }
+  uint32 uncompressed_length;
+  uint32 compressed_length;
+  if (!input_->ReadVarint32(&uncompressed_length) ||
+      !input_->ReadVarint32(&compressed_length)) {
+    return false;
+  }
+  pos_ += CodedOutputStream::VarintSize32(uncompressed_length);
+  pos_ += CodedOutputStream::VarintSize32(compressed_length);
+  compressed_buffer_.resize(compressed_length);
+  if (!input_->ReadRaw(string_as_array(&compressed_buffer_),
+      compressed_length)) {
+    return false;
+  }
+  pos_ += compressed_length;
+  // Inflate the block.
+  block_data_.resize(uncompressed_length);
+  uLongf destination_length = uncompressed_length;
+  int ret = uncompress(
+    reinterpret_cast<Bytef*>(string_as_array(&block_data_)),
+    &destination_length,
+    reinterpret_cast<const Bytef*>(compressed_buffer_.data()),
+    compressed_length);
+  if (Z_OK != ret || destination_length != uncompressed_length) {
+    throw saga::exception("SequenceFile block decompression failed");
+  }
+  block_array_.reset(new ArrayInputStream(string_as_array(&block_data_),
+    uncompressed_length));
+  block_input_.reset(new CodedInputStream(block_array_.get()));
+  records_remaining_ = record_count;
+  return true;
+}
+
 bool SequenceFileReader::ReadRaw(ZeroCopyOutputStream* key, ZeroCopyOutputStream* value) {
+  CodedInputStream* source = input_;
+  if (block_mode_) {
+    while (0 == records_remaining_) {
+      if (!LoadNextBlock()) {
+        return false;
+      }
+    }
+    source = block_input_.get();
+  }
   uint32 record_length;
   uint32 key_length;
-  if (!input_->ReadVarint32(&record_length)) {
+  if (!source->ReadVarint32(&record_length)) {
     return false;
   }
-  if (!input_->ReadVarint32(&key_length)) {
+  if (!source->ReadVarint32(&key_length)) {
     return false;
   }
-  if (!TransferBetweenStreams(input_, key, key_length)) {
+  if (!TransferBetweenStreams(source, key, key_length)) {
     return false;
   }
-  if (!TransferBetweenStreams(input_, value, record_length - key_length)) {
+  if (!TransferBetweenStreams(source, value, record_length - key_length)) {
     return false;
   }
+  if (block_mode_) {
+    --records_remaining_;
+  }
   return true;
 }
 
+bool SequenceFileReader::ReadBlockIndex(const saga::url& path,
+                                        std::vector<int64>* offsets) {
+  try {
+    saga::filesystem::file file(path, saga::filesystem::Read);
+    saga::off_t size = file.get_size();
+    const int trailer_size = 8 + sizeof(SequenceFile::index_magic);
+    if (size < (saga::off_t)(sizeof(SequenceFile::header) + trailer_size)) {
+      return false;
+    }
+    // The fixed-size trailer: footer offset (little endian) + index magic.
+    char trailer[8 + sizeof(SequenceFile::index_magic)];
+    file.seek(size - trailer_size, saga::filesystem::Start);
+    if (trailer_size != (int)file.read(saga::buffer(trailer, trailer_size),
+        trailer_size)) {
+      return false;
+    }
+    if (0 != memcmp(trailer + 8, SequenceFile::index_magic,
+        sizeof(SequenceFile::index_magic))) {
+      return false;
+    }
+    uint64 footer_offset = 0;
+    for (int i = 7; i >= 0; --i) {
+      footer_offset = (footer_offset << 8) | (unsigned char)trailer[i];
+    }
+    if (footer_offset >= (uint64)(size - trailer_size)) {
+      return false;
+    }
+    // Read and parse the footer block.
+    int footer_length = (int)(size - trailer_size - footer_offset);
+    std::string footer(footer_length, '\0');
+    file.seek(footer_offset, saga::filesystem::Start);
+    if (footer_length != (int)file.read(
+        saga::buffer(string_as_array(&footer), footer_length),
+        footer_length)) {
+      return false;
+    }
+    if (footer_length < (int)sizeof(SequenceFile::sync_marker) ||
+        0 != memcmp(footer.data(), SequenceFile::sync_marker,
+          sizeof(SequenceFile::sync_marker))) {
+      return false;
+    }
+    ArrayInputStream array(
+      footer.data() + sizeof(SequenceFile::sync_marker),
+      footer_length - sizeof(SequenceFile::sync_marker));
+    CodedInputStream input(&array);
+    uint32 record_count;
+    uint32 block_count;
+    if (!input.ReadVarint32(&record_count) || 0 != record_count) {
+      return false;
+    }
+    if (!input.ReadVarint32(&block_count)) {
+      return false;
+    }
+    offsets->clear();
+    for (uint32 i = 0; i < block_count; ++i) {
+      uint64 offset;
+      if (!input.ReadVarint64(&offset)) {
+        return false;
+      }
+      offsets->push_back((int64)offset);
+    }
+    return true;
+  } catch (saga::exception const&) {
+    return false;
+  }
+}
+
 void SequenceFileReader::Close() {
   delete input_;
 }
@@ -91,7 +255,16 @@ void SequenceFileReader::Close() {
 // SequenceFileWriter implementation.
 //
 
-void SequenceFileWriter::Initialize(saga::url& path, bool append) {
+void SequenceFileWriter::Initialize(saga::url& path, bool append,
+                                    bool block_compressed,
+                                    bool write_behind) {
+  block_compressed_ = block_compressed;
+  block_records_ = 0;
+  if (append && block_compressed) {
+    // Appending would have to strip and rewrite the footer index.
+    throw saga::exception("appending to a block-compressed SequenceFile is "
+      "not supported");
+  }
   // Determine mode to be used for opening file.
   int mode = saga::filesystem::Write;
   if (append) {
@@ -100,8 +273,16 @@ void SequenceFileWriter::Initialize(saga::url& path, bool append) {
     mode |= saga::filesystem::Create;
   }
   // Create CodedOutputStream for file.
-  SagaFileOutputStream* copying_stream_ = new SagaFileOutputStream(
-    saga::filesystem::file(path, mode));
+  CopyingOutputStream* copying_stream_;
+  if (write_behind) {
+    write_behind_stream_ = new SagaWriteBehindOutputStream(
+      saga::filesystem::file(path, mode));
+    copying_stream_ = write_behind_stream_;
+  } else {
+    write_behind_stream_ = NULL;
+    copying_stream_ = new SagaFileOutputStream(
+      saga::filesystem::file(path, mode));
+  }
   output_adaptor_.reset(new CopyingOutputStreamAdaptor(copying_stream_));
   // Let the adaptor free the CopyingStream.
   output_adaptor_->SetOwnsCopyingStream(true);
@@ -111,24 +292,100 @@ void SequenceFileWriter::Initialize(saga::url& path, bool append) {
   }
 }
 
+// Append a varint32 to a string buffer.
+inline static void AppendVarint32(std::string* buffer, uint32 value) {
+  uint8 scratch[5];
+  uint8* end = CodedOutputStream::WriteVarint32ToArray(value, scratch);
+  buffer->append(reinterpret_cast<char*>(scratch), end - scratch);
+}
+
 void SequenceFileWriter::AppendRaw(const void* raw_key, int key_length,
                                    const void* raw_value, int value_length) {
   int record_length = key_length + value_length;
-  output_->WriteVarint32(record_length);
-  output_->WriteVarint32(key_length);
-  output_->WriteRaw(raw_key, key_length);
-  output_->WriteRaw(raw_value, value_length);
+  if (!block_compressed_) {
+    output_->WriteVarint32(record_length);
+    output_->WriteVarint32(key_length);
+    output_->WriteRaw(raw_key, key_length);
+    output_->WriteRaw(raw_value, value_length);
+    return;
+  }
+  // Buffer the record; the block is deflated and written as one unit.
+  AppendVarint32(&block_buffer_, record_length);
+  AppendVarint32(&block_buffer_, key_length);
+  block_buffer_.append(reinterpret_cast<const char*>(raw_key), key_length);
+  block_buffer_.append(reinterpret_cast<const char*>(raw_value),
+    value_length);
+  ++block_records_;
+  if (block_buffer_.size() >= SEQUENCEFILE_BLOCKSIZE) {
+    FlushBlock();
+  }
+}
+
+void SequenceFileWriter::FlushBlock() {
+  if (0 == block_records_) {
+    return;
+  }
+  uLongf compressed_length = compressBound(block_buffer_.size());
+  std::string compressed(compressed_length, '\0');
+  int ret = compress2(
+    reinterpret_cast<Bytef*>(string_as_array(&compressed)),
+    &compressed_length,
+    reinterpret_cast<const Bytef*>(block_buffer_.data()),
+    block_buffer_.size(), Z_DEFAULT_COMPRESSION);
+  if (Z_OK != ret) {
+    throw saga::exception("SequenceFile block compression failed");
+  }
+  // Remember where the block starts for the footer index.
+  block_offsets_.push_back(output_->ByteCount());
+  output_->WriteRaw(SequenceFile::sync_marker,
+    sizeof(SequenceFile::sync_marker));
+  output_->WriteVarint32(block_records_);
+  output_->WriteVarint32(block_buffer_.size());
+  output_->WriteVarint32(compressed_length);
+  output_->WriteRaw(compressed.data(), compressed_length);
+  block_buffer_.clear();
+  block_records_ = 0;
+}
+
+void SequenceFileWriter::WriteFooter() {
+  int64 footer_offset = output_->ByteCount();
+  // A record count of zero after the sync marker marks the footer.
+  output_->WriteRaw(SequenceFile::sync_marker,
+    sizeof(SequenceFile::sync_marker));
+  output_->WriteVarint32(0);
+  output_->WriteVarint32(block_offsets_.size());
+  for (size_t i = 0; i < block_offsets_.size(); ++i) {
+    output_->WriteVarint64(block_offsets_[i]);
+  }
+  // Fixed-size trailer so the index can be found from the end of the file.
+  output_->WriteLittleEndian64(footer_offset);
+  output_->WriteRaw(SequenceFile::index_magic,
+    sizeof(SequenceFile::index_magic));
 }
 
 void SequenceFileWriter::WriteHeader() {
-  // Write magic bytes and version number.
-  output_->WriteRaw(reinterpret_cast<void*>(&SequenceFile::header),
-    sizeof(SequenceFile::header));
+  // Write magic bytes and version number. Files without block compression
+  // stay at version 1 so older readers keep working on them.
+  char header_contents[sizeof(SequenceFile::header)] = {
+    SequenceFile::header[0], SequenceFile::header[1],
+    SequenceFile::header[2],
+    (char)(block_compressed_ ? SEQUENCEFILE_VERSION : 1)};
+  output_->WriteRaw(reinterpret_cast<void*>(&header_contents),
+    sizeof(header_contents));
 }
 
 void SequenceFileWriter::Close() {
+  if (block_compressed_) {
+    FlushBlock();
+    WriteFooter();
+  }
   delete output_;
   output_adaptor_->Flush();
+  // An asynchronous write failure only surfaces here; nobody must take a
+  // clean Close() for data on the file when a background write bounced.
+  if (write_behind_stream_ != NULL && !write_behind_stream_->Drain()) {
+    throw saga::exception("SequenceFile write-behind writer failed");
+  }
   output_adaptor_.reset();
 }
 
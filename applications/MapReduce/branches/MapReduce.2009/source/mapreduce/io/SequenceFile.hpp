@@ -1,11 +1,13 @@
 //  Copyright (c) 2009 Miklos Erdelyi
 //
-//  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
 #ifndef MAPREDUCE_IO_SEQUENCEFILE_HPP_
 #define MAPREDUCE_IO_SEQUENCEFILE_HPP_
 
+#include <string>
+#include <vector>
 #include <saga/saga.hpp>
 #include "../serialization.hpp"
 #include "../io/saga_file_adaptors.hpp"
@@ -15,18 +17,33 @@ using google::protobuf::io::CopyingOutputStreamAdaptor;
 using google::protobuf::io::CopyingInputStreamAdaptor;
 using google::protobuf::io::CodedOutputStream;
 using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::ArrayInputStream;
+using google::protobuf::int64;
 
 namespace mapreduce { namespace io {
 
 class SequenceFileReader;
 class SequenceFileWriter;
 
-#define SEQUENCEFILE_VERSION  1
+// Version 1: plain stream of records ([record length][key length][key]
+// [value], lengths as varints) following the 4-byte header.
+// Version 2: block-compressed. Records are collected into blocks of
+// SEQUENCEFILE_BLOCKSIZE uncompressed bytes; each block is deflated (zlib)
+// and written as [sync marker][record count][uncompressed length]
+// [compressed length][compressed data]. A footer (sync marker followed by a
+// record count of 0) carries the file offset of every block, and the last 16
+// bytes of the file hold the footer offset plus an index magic so readers
+// can locate the index without scanning. Sync markers let a reader verify
+// that a seek really landed on a block boundary.
+#define SEQUENCEFILE_VERSION    2
+#define SEQUENCEFILE_BLOCKSIZE  (1024 * 1024)
 
 // Class holding common infrastructure for SequenceFileReader/SequenceFileWriter.
 class SequenceFile {
  public:
   static char header[];
+  static char sync_marker[16];
+  static char index_magic[8];
   friend class SequenceFileReader;
   friend class SequenceFileWriter;
 };
@@ -39,30 +56,72 @@ class SequenceFileReader {
   }
   bool ReadRaw(ZeroCopyOutputStream* key, ZeroCopyOutputStream* value);
   void Close();
+  // Whether the file is in block-compressed (version 2) format.
+  bool is_block_compressed() const { return block_mode_; }
+  // Jump to a block whose file offset was obtained from the block index.
+  // Forward seeks only; returns false when the offset lies behind the
+  // current position.
+  bool SeekToBlock(int64 offset);
+  // Stop delivering records once the next block starts at or beyond the
+  // given file offset (a block belongs to the chunk its sync marker
+  // falls into).
+  void set_end_offset(int64 offset) { end_offset_ = offset; }
+  // Read the block index from the footer of a version 2 file. Returns false
+  // when the file carries no index (version 1, or still being written).
+  static bool ReadBlockIndex(const saga::url& path,
+    std::vector<int64>* offsets);
  private:
   void Initialize(const saga::url& path, long offset);
+  // Decompress the next block into block_data_. False on footer or EOF.
+  bool LoadNextBlock();
 
   SagaFileInputStream* input_stream_;
   boost::scoped_ptr<CopyingInputStreamAdaptor> input_adaptor_;
   CodedInputStream* input_;
+  // Block-compressed (version 2) state.
+  bool block_mode_;
+  int64 pos_;                  // file offset of the next byte to consume
+  int64 end_offset_;
+  uint32 records_remaining_;   // records left in the current block
+  std::string compressed_buffer_;
+  std::string block_data_;
+  boost::scoped_ptr<ArrayInputStream> block_array_;
+  boost::scoped_ptr<CodedInputStream> block_input_;
 };
 
 // Writer for sequences of records.
 class SequenceFileWriter {
  public:
-  SequenceFileWriter(saga::url& path, bool append = false) {
-    Initialize(path, append);
+  // Writes go through a write-behind stream by default: sealed blocks are
+  // streamed to the file by a background thread (bounded memory, see
+  // SagaWriteBehindOutputStream), so AppendRaw never waits for a remote
+  // round-trip. Pass write_behind = false for strictly synchronous writes.
+  SequenceFileWriter(saga::url& path, bool append = false,
+    bool block_compressed = false, bool write_behind = true) {
+    Initialize(path, append, block_compressed, write_behind);
   }
   void AppendRaw(const void* raw_key, int key_length, const void* raw_value,
     int value_length);
   void Close();
  private:
-  void Initialize(saga::url& path, bool append);
+  void Initialize(saga::url& path, bool append, bool block_compressed,
+    bool write_behind);
   void WriteHeader();
+  // Compress and write the buffered records as one block.
+  void FlushBlock();
+  void WriteFooter();
 
   saga::filesystem::file* file_;
   boost::scoped_ptr<CopyingOutputStreamAdaptor> output_adaptor_;
+  // Owned by output_adaptor_; kept to drain it (and surface a deferred
+  // write error) in Close(). NULL in synchronous mode.
+  SagaWriteBehindOutputStream* write_behind_stream_;
   CodedOutputStream* output_;
+  // Block-compressed (version 2) state.
+  bool block_compressed_;
+  std::string block_buffer_;
+  uint32 block_records_;
+  std::vector<int64> block_offsets_;
 };
 
 }   // namespace io
@@ -6,7 +6,13 @@
 #ifndef MAPREDUCE_IO_SAGA_FILE_ADAPTORS_HPP_
 #define MAPREDUCE_IO_SAGA_FILE_ADAPTORS_HPP_
 
+#include <deque>
+#include <string>
 #include <saga/saga.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
 
 using google::protobuf::io::CopyingInputStream;
 using google::protobuf::io::CopyingOutputStream;
@@ -23,8 +29,12 @@ class SagaFileInputStream : public CopyingInputStream {
     return ret;
   }
   int Skip(int count) {
-    // Move the internal file pointer ahead by count bytes.
-    return file_.seek(count, saga::filesystem::Current);
+    // Move the internal file pointer ahead by count bytes. saga's seek
+    // returns the new absolute position, but the CopyingInputStream
+    // contract asks for the number of bytes skipped.
+    saga::off_t before = file_.seek(0, saga::filesystem::Current);
+    saga::off_t after = file_.seek(count, saga::filesystem::Current);
+    return (int)(after - before);
   }
  private:
   saga::filesystem::file file_;
@@ -43,6 +53,137 @@ class SagaFileOutputStream : public CopyingOutputStream {
   saga::filesystem::file file_;
 };
 
+// Write-behind variant of SagaFileOutputStream. Writes are appended to an
+// in-memory block; a sealed block goes onto a bounded queue and a
+// background thread streams the queue to the file. The caller's append
+// path therefore never waits for a remote round-trip unless the queue is
+// full - with the default sizes up to 16 blocks (4 MB) are in flight
+// while records keep arriving. Blocks are written strictly in order (a
+// single saga file handle gives no useful concurrency anyway); the
+// pipelining comes from overlapping buffering and compression with the
+// remote write.
+//
+// A failed background write is sticky: later Write() calls return false
+// and Drain() reports it. Call Drain() before close to push out the
+// remainder and learn whether everything reached the file.
+class SagaWriteBehindOutputStream : public CopyingOutputStream {
+ public:
+  static const size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+  static const size_t DEFAULT_MAX_QUEUED = 4 * 1024 * 1024;
+
+  SagaWriteBehindOutputStream(saga::filesystem::file file,
+      size_t block_size = DEFAULT_BLOCK_SIZE,
+      size_t max_queued = DEFAULT_MAX_QUEUED)
+      : file_(file), block_size_(block_size), max_queued_(max_queued),
+        queued_bytes_(0), closing_(false), failed_(false),
+        writer_(boost::bind(&SagaWriteBehindOutputStream::WriterLoop, this))
+  {}
+  ~SagaWriteBehindOutputStream() {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (!block_.empty() && !failed_) {
+        EnqueueBlockLocked(lock);
+      }
+      closing_ = true;
+      data_.notify_all();
+    }
+    writer_.join();
+  }
+  // CopyingOutputStream implementation.
+  bool Write(const void* buffer, int size) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (failed_) {
+      return false;
+    }
+    block_.append(static_cast<const char*>(buffer), size);
+    if (block_.size() >= block_size_) {
+      EnqueueBlockLocked(lock);
+    }
+    return !failed_;
+  }
+  // Seal the partial block, wait until the queue is written out and
+  // return whether every byte reached the file.
+  bool Drain() {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (!block_.empty() && !failed_) {
+      EnqueueBlockLocked(lock);
+    }
+    while (queued_bytes_ > 0 && !failed_) {
+      space_.wait(lock);
+    }
+    return !failed_;
+  }
+
+ private:
+  // Hand the current block to the writer thread, respecting the memory
+  // bound: when max_queued_ bytes are already in flight the caller
+  // blocks here until the writer catches up.
+  void EnqueueBlockLocked(boost::mutex::scoped_lock& lock) {
+    while (queued_bytes_ >= max_queued_ && !failed_) {
+      space_.wait(lock);
+    }
+    if (failed_) {
+      return;
+    }
+    queued_bytes_ += block_.size();
+    queue_.push_back(std::string());
+    queue_.back().swap(block_);
+    data_.notify_one();
+  }
+  void WriterLoop() {
+    while (true) {
+      std::string block;
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        while (queue_.empty() && !closing_) {
+          data_.wait(lock);
+        }
+        if (queue_.empty()) {
+          return;
+        }
+        block.swap(queue_.front());
+        queue_.pop_front();
+      }
+      bool ok = true;
+      try {
+        size_t written = 0;
+        while (written < block.size()) {
+          int ret = file_.write(saga::buffer(block.data() + written,
+            block.size() - written), block.size() - written);
+          if (ret <= 0) {
+            ok = false;
+            break;
+          }
+          written += ret;
+        }
+      } catch (saga::exception const&) {
+        ok = false;
+      }
+      boost::mutex::scoped_lock lock(mutex_);
+      if (!ok) {
+        failed_ = true;
+      }
+      // queued_bytes_ covers the in-flight block until it is on the
+      // file, so Drain() really means "everything written"
+      queued_bytes_ -= block.size();
+      space_.notify_all();
+    }
+  }
+
+  saga::filesystem::file file_;
+  size_t block_size_;
+  size_t max_queued_;
+  std::string block_;               // the block being filled
+  std::deque<std::string> queue_;   // sealed blocks, oldest first
+  size_t queued_bytes_;             // sealed but not yet written bytes
+  bool closing_;
+  bool failed_;
+  boost::mutex mutex_;
+  boost::condition data_;           // blocks queued / shutdown
+  boost::condition space_;          // bytes left the queue / failure
+  boost::thread writer_;            // must be last: starts immediately
+};
+
 }   // namespace io
 }   // namespace mapreduce
 
@@ -6,8 +6,11 @@
 #ifndef MAPREDUCE_JOB_HPP_
 #define MAPREDUCE_JOB_HPP_
 
+#include <deque>
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
 #include <boost/lexical_cast.hpp>
 
 #include "serialization.hpp"
@@ -22,6 +25,7 @@ namespace mapreduce {
 #define JOB_ATTRIBUTE_PARTITIONER_CLASS "mapred.partitioner.class"
 #define JOB_ATTRIBUTE_REDUCER_CLASS "mapred.reducer.class"
 #define JOB_ATTRIBUTE_NUM_REDUCE_TASKS "mapred.reducer.num_tasks"
+#define JOB_ATTRIBUTE_NUM_MAP_THREADS "mapred.mapper.num_threads"
 
 // Descriptor of a MapReduce job.
 // FIXME: this should be based on saga::attributes.
@@ -104,6 +108,13 @@ class JobDescription : public Serializable {
       "0");
     return boost::lexical_cast<int>(num_tasks);
   }
+  void set_num_map_threads(int num_threads) {
+    attributes_[JOB_ATTRIBUTE_NUM_MAP_THREADS] =
+      boost::lexical_cast<std::string>(num_threads);
+  }
+  const int get_num_map_threads() const {
+    return get_attribute(JOB_ATTRIBUTE_NUM_MAP_THREADS, 1);
+  }
   // Serializable interface implementation.
   virtual void Serialize(CodedOutputStream* output) const;
   virtual void Deserialize(CodedInputStream* input);
@@ -128,6 +139,66 @@ class TaskDescription : public JobDescription {
   int task_id_;
 };
 
+// A directed acyclic graph of jobs forming a multi-stage pipeline. Nodes
+// are JobDescriptions; an edge from an upstream to a downstream job
+// states that the downstream job's map input is the upstream job's
+// reduce output. The graph only stores the structure - scheduling is
+// done by master::DistributedJobRunner::RunGraph, which hands each
+// committed reduce partition of an upstream job to its dependents as a
+// ready-made input chunk. Job ids passed to the edge and accessor
+// methods must come from AddJob.
+class JobGraph {
+ public:
+  JobGraph() {}
+  // Add a job to the graph and return its id.
+  int AddJob(const JobDescription& job) {
+    jobs_.push_back(job);
+    dependents_.push_back(std::vector<int>());
+    dependencies_.push_back(std::vector<int>());
+    return static_cast<int>(jobs_.size()) - 1;
+  }
+  // Declare that the downstream job consumes the upstream job's output.
+  void AddDependency(int upstream, int downstream) {
+    dependents_[upstream].push_back(downstream);
+    dependencies_[downstream].push_back(upstream);
+  }
+  int NumJobs() const { return static_cast<int>(jobs_.size()); }
+  JobDescription* GetJob(int id) { return &jobs_[id]; }
+  const std::vector<int>& GetDependents(int id) const {
+    return dependents_[id];
+  }
+  const std::vector<int>& GetDependencies(int id) const {
+    return dependencies_[id];
+  }
+  // Get the jobs which have not completed yet but whose dependencies
+  // have all completed.
+  std::vector<int> GetRunnableJobs(const std::set<int>& completed) const {
+    std::vector<int> runnable;
+    for (int id = 0; id < NumJobs(); ++id) {
+      if (completed.find(id) != completed.end()) {
+        continue;
+      }
+      bool ready = true;
+      for (std::vector<int>::size_type i = 0;
+           i < dependencies_[id].size(); ++i) {
+        if (completed.find(dependencies_[id][i]) == completed.end()) {
+          ready = false;
+          break;
+        }
+      }
+      if (ready) {
+        runnable.push_back(id);
+      }
+    }
+    return runnable;
+  }
+ private:
+  // Jobs by id. A deque keeps GetJob pointers stable across AddJob.
+  std::deque<JobDescription> jobs_;
+  std::vector<std::vector<int> > dependents_;
+  std::vector<std::vector<int> > dependencies_;
+};
+
 } // namespace mapreduce
 
 #endif  // MAPREDUCE_JOB_HPP_
@@ -6,8 +6,10 @@
 
 #include "DistributedJobRunner.hpp"
 
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include "input/FileInputFormat.hpp"
 #include "master/HandleMaps.hpp"
 #include "master/HandleReduces.hpp"
 #include "protocol.hpp"
@@ -174,8 +176,6 @@ void DistributedJobRunner::populateBinariesList_(void) {
 }
 
 void DistributedJobRunner::populateChunks_() {
-  unsigned int successCounter = 0;
-  int mode = saga::advert::Create | saga::advert::ReadWrite;
   // Instantiate input format.
   const std::string& format_name = job_.get_input_format();
   input_format_ = InputFormatFactory::get_by_key(format_name);
@@ -183,18 +183,33 @@ void DistributedJobRunner::populateChunks_() {
     throw saga::exception("Invalid input format specified");
   }
   chunks_ = input_format_->GetChunks(job_);
-  std::vector<InputChunk*>::const_iterator chunk_it = chunks_.begin();
+  // A range-partitioned job needs its split-point table sampled before
+  // the JobDescription is broadcast to the workers.
+  if (job_.get_partitioner_class() == "RangePartitioner") {
+    RangePartitioner::SampleSplitPoints(&job_, input_format_, chunks_);
+  }
+  if (advertiseChunks_("chunk-", input_format_, chunks_) == 0) {
+    log->write("No chunks made for this session. Aborting", MR_LOGLEVEL_FATAL);
+    APPLICATION_ABORT;
+  }
+}
+
+unsigned int DistributedJobRunner::advertiseChunks_(const std::string& prefix,
+  RawInputFormat* input_format, const std::vector<InputChunk*>& chunks) {
+  unsigned int successCounter = 0;
+  int mode = saga::advert::Create | saga::advert::ReadWrite;
+  std::vector<InputChunk*>::const_iterator chunk_it = chunks.begin();
   std::string chunk_string;
   // Advertise chunks.
-  while (chunk_it != chunks_.end()) {
+  while (chunk_it != chunks.end()) {
     std::string message("Adding new chunk of length " +
       boost::lexical_cast<std::string>((*chunk_it)->GetLength()) + "...");
     try {
-      saga::advert::entry adv = chunksDir_.open(saga::url("chunk-" + boost::lexical_cast<std::string>(successCounter)), mode);
+      saga::advert::entry adv = chunksDir_.open(saga::url(prefix + boost::lexical_cast<std::string>(successCounter)), mode);
       // Serialize chunk.
       chunk_string.clear();
       StringOutputStream sos(&chunk_string);
-      input_format_->SerializeInputChunk(*chunk_it, &sos);
+      input_format->SerializeInputChunk(*chunk_it, &sos);
       adv.store_object<std::string>(chunk_string);
       message += "SUCCESS";
       log->write(message, MR_LOGLEVEL_INFO);
@@ -206,10 +221,7 @@ void DistributedJobRunner::populateChunks_() {
     }
     ++chunk_it;
   }
-  if (successCounter == 0) {
-    log->write("No chunks made for this session. Aborting", MR_LOGLEVEL_FATAL);
-    APPLICATION_ABORT;
-  }
+  return successCounter;
 }
 
 void DistributedJobRunner::spawnAgents_(void) {
@@ -276,22 +288,125 @@ void DistributedJobRunner::spawnAgents_(void) {
 
 
 void DistributedJobRunner::executeJob() {
+  runGraphJob_(&job_, chunks_, input_format_,
+    HandleReduces::PartitionCommittedCallback());
+}
+
+void DistributedJobRunner::runGraphJob_(JobDescription* job,
+  std::vector<InputChunk*>& chunks, RawInputFormat* input_format,
+  boost::function<void (int, const std::string&)> partition_committed) {
+  committed_chunks_.clear();
   std::string message("Launching maps...");
-  HandleMaps* map_handler = new HandleMaps(job_, chunks_, committed_chunks_,
-    input_format_, serverURL_, log);
+  HandleMaps* map_handler = new HandleMaps(*job, chunks, committed_chunks_,
+    input_format, serverURL_, log);
   log->write(message, MR_LOGLEVEL_INFO);
   map_handler->assignMaps();
   // Must be destroyed to release stream connection.
   delete map_handler;
 
   message = "Beginning reduces...";
-  HandleReduces* reduce_handler = new HandleReduces(job_, committed_chunks_, workersDir_, serverURL_,
+  HandleReduces* reduce_handler = new HandleReduces(*job, committed_chunks_, workersDir_, serverURL_,
     log);
+  reduce_handler->set_partition_committed_callback(partition_committed);
   log->write(message, MR_LOGLEVEL_INFO);
   reduce_handler->assignReduces();
   delete reduce_handler;
 }
 
+void DistributedJobRunner::RunGraph(JobGraph* graph, MapReduceResult* result) {
+  // generate a startup timestamp
+  time(&startupTime_);
+
+  std::string message(std::string(MR_MASTER_EXE_NAME));
+  message = message + " " + SAGA_MAPREDUCE_FRAMEWORK_VERSION +
+    " - creating new session for a graph of " +
+    boost::lexical_cast<std::string>(graph->NumJobs()) + " jobs.";
+  log->write(message, MR_LOGLEVEL_INFO);
+
+  // One session and one worker pool serve the whole pipeline.
+  registerWithDB_();
+  createNewSession_();
+  populateBinariesList_();
+  spawnAgents_();
+
+  std::set<int> completed;
+  while (static_cast<int>(completed.size()) < graph->NumJobs()) {
+    std::vector<int> runnable = graph->GetRunnableJobs(completed);
+    if (runnable.empty()) {
+      log->write("Job graph contains a dependency cycle. Aborting",
+        MR_LOGLEVEL_FATAL);
+      APPLICATION_ABORT;
+    }
+    for (std::vector<int>::size_type i = 0; i < runnable.size(); ++i) {
+      int job_id = runnable[i];
+      JobDescription* job = graph->GetJob(job_id);
+      log->write("Running graph job " +
+        boost::lexical_cast<std::string>(job_id), MR_LOGLEVEL_INFO);
+      RawInputFormat* input_format = InputFormatFactory::get_by_key(
+        job->get_input_format());
+      if (input_format == NULL) {
+        throw saga::exception("Invalid input format specified");
+      }
+      // Root jobs chunk their configured input paths; downstream jobs
+      // run directly on the SequenceFile partitions committed by their
+      // dependencies' reducers - no staging or re-chunking pass.
+      std::vector<InputChunk*> chunks;
+      if (graph->GetDependencies(job_id).empty()) {
+        chunks = input_format->GetChunks(*job);
+      } else {
+        chunks.swap(graph_inputs_[job_id]);
+      }
+      if (job->get_partitioner_class() == "RangePartitioner") {
+        RangePartitioner::SampleSplitPoints(job, input_format, chunks);
+      }
+      if (chunks.empty()) {
+        log->write("Graph job " + boost::lexical_cast<std::string>(job_id) +
+          " has no input chunks. Aborting", MR_LOGLEVEL_FATAL);
+        APPLICATION_ABORT;
+      }
+      advertiseChunks_("chunk-" + boost::lexical_cast<std::string>(job_id) +
+        "-", input_format, chunks);
+      runGraphJob_(job, chunks, input_format,
+        boost::bind(&DistributedJobRunner::onPartitionCommitted_, this,
+          graph, job_id, _1, _2));
+      completed.insert(job_id);
+    }
+  }
+
+  log->write("Sending quit to workers", MR_LOGLEVEL_INFO);
+  sendQuit_();
+  log->write("All done - exiting normally", MR_LOGLEVEL_INFO);
+}
+
+void DistributedJobRunner::onPartitionCommitted_(JobGraph* graph, int job_id,
+  int partition, const std::string& file) {
+  const std::vector<int>& dependents = graph->GetDependents(job_id);
+  if (dependents.empty()) {
+    return;
+  }
+  // The committed partition is a complete SequenceFile; queue it for
+  // every dependent as one ready-made input chunk.
+  saga::url url(FileOutputFormat::GetUrl(*graph->GetJob(job_id), file));
+  int length = 0;
+  try {
+    saga::filesystem::file partition_file(url);
+    length = partition_file.get_size();
+  } catch (saga::exception const& e) {
+    log->write("Couldn't stat committed partition " + url.get_string() +
+      "; reason: " + e.what(), MR_LOGLEVEL_ERROR);
+    return;
+  }
+  std::vector<saga::url> hosts;
+  for (std::vector<int>::size_type i = 0; i < dependents.size(); ++i) {
+    graph_inputs_[dependents[i]].push_back(new FileInputChunk(url, 0, length,
+      hosts));
+  }
+  log->write("Partition " + boost::lexical_cast<std::string>(partition) +
+    " of job " + boost::lexical_cast<std::string>(job_id) + " queued for " +
+    boost::lexical_cast<std::string>(dependents.size()) +
+    " dependent job(s)", MR_LOGLEVEL_INFO);
+}
+
 
 void DistributedJobRunner::sendQuit_(void) {
   // Cancel all worker jobs.
@@ -7,6 +7,9 @@
 #ifndef MAPREDUCE_MASTER_DISTRIBUTEDJOBRUNNER_HPP_
 #define MAPREDUCE_MASTER_DISTRIBUTEDJOBRUNNER_HPP_
 
+#include <map>
+#include <set>
+#include <boost/function.hpp>
 #include <saga/saga.hpp>
 #include "ConfigFileParser.hpp"
 #include "../mapreduce.hpp"
@@ -23,6 +26,12 @@ class DistributedJobRunner {
   DistributedJobRunner(const JobDescription& job) : job_(job) {}
   void Initialize(const std::string& config_file_path);
   void Run(MapReduceResult* result);
+  // Run a whole pipeline of jobs within one session. Jobs execute in
+  // dependency order over the same worker pool; as each reduce partition
+  // of an upstream job commits, its SequenceFile output is queued as a
+  // ready-made input chunk of every dependent job, so no staging pass
+  // runs between jobs.
+  void RunGraph(JobGraph* graph, MapReduceResult* result);
  private:
   time_t startupTime_;
   std::string uuid_;
@@ -32,6 +41,9 @@ class DistributedJobRunner {
   std::vector<InputChunk*>  chunks_;
   // Which worker completed which chunk.
   std::map<std::string, saga::url> committed_chunks_;
+  // Input chunks collected for downstream graph jobs from the committed
+  // reduce partitions of their dependencies.
+  std::map<int, std::vector<InputChunk*> > graph_inputs_;
   RawInputFormat* input_format_;
   saga::advert::directory     sessionBaseDir_;
   saga::advert::directory     workersDir_;
@@ -77,6 +89,23 @@ class DistributedJobRunner {
 
   void executeJob();
 
+ // advertiseChunks_ publishes serialized chunks under the given name
+ // prefix in the ADVERT_DIR_CHUNKS directory of the session. Returns the
+ // number of chunks advertised successfully.
+  unsigned int advertiseChunks_(const std::string& prefix,
+    RawInputFormat* input_format, const std::vector<InputChunk*>& chunks);
+
+ // Run the map and reduce phases of one job of a graph over the already
+ // spawned workers; partition_committed fires as reduce partitions land.
+  void runGraphJob_(JobDescription* job, std::vector<InputChunk*>& chunks,
+    RawInputFormat* input_format,
+    boost::function<void (int, const std::string&)> partition_committed);
+
+ // Queue an upstream job's committed reduce partition as an input chunk
+ // of every job that depends on it.
+  void onPartitionCommitted_(JobGraph* graph, int job_id, int partition,
+    const std::string& file);
+
  /*********************************************************
   * spawnAgents_ takes the host list and the binary list  *
   * from the config file and tries to match the proper    *
@@ -159,6 +159,12 @@ void HandleMaps::issue_command_() {
                     SerializationHandler<JobDescription>::Serialize(
                       const_cast<JobDescription*>(&job_), &sos);
                     SerializationHandler<std::string>::Serialize(&chunk_id, &sos);
+                    // Also name the likely next split, so the worker can
+                    // stage its bytes while this chunk computes (see the
+                    // worker's SplitPrefetcher). Advisory only: another
+                    // worker may well end up mapping it.
+                    std::string prefetch_hint(serializeNextCandidate_(chunk_id));
+                    SerializationHandler<std::string>::Serialize(&prefetch_hint, &sos);
                     input_format_->SerializeInputChunk(chunk, &sos);
                   }
                    worker.write(saga::buffer(command, command.size()));
@@ -222,6 +228,27 @@ void HandleMaps::issue_command_() {
     }
 }
 
+/*********************************************************
+ * serializeNextCandidate_ picks the chunk the next idle *
+ * worker would most likely be handed (the first         *
+ * unassigned one after the current assignment) and      *
+ * returns it in serialized form, ready to travel as a   *
+ * prefetch hint.  Empty when the queue is drained.      *
+ * ******************************************************/
+std::string HandleMaps::serializeNextCandidate_(const std::string& current_id) {
+  std::set<std::string>::iterator it = unassigned_.begin();
+  for(; it != unassigned_.end(); ++it) {
+    if(*it == current_id) {
+      continue;
+    }
+    std::string hint;
+    StringOutputStream sos(&hint);
+    input_format_->SerializeInputChunk(chunk_assignments_[*it], &sos);
+    return hint;
+  }
+  return std::string("");
+}
+
 /*********************************************************
  * getCandidate_ tries to find a chunk that is not       *
  * finished while trying to give priority to chunks that *
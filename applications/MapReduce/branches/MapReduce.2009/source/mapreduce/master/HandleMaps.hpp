@@ -30,6 +30,11 @@ class HandleMaps {
    private:
     void issue_command_();
     std::string getCandidate_(saga::stream::stream& worker);
+    // Serialized chunk of the next unassigned candidate (skipping
+    // current_id), or the empty string when nothing is left. Sent as a
+    // prefetch hint with every assignment (see the worker's
+    // SplitPrefetcher).
+    std::string serializeNextCandidate_(const std::string& current_id);
 
     saga::stream::server    *service_;
     const JobDescription&    job_;
@@ -194,6 +194,13 @@ void HandleReduces::issue_command_() {
             int finished_partition = boost::lexical_cast<int>(result);
             if (finished_.find(finished_partition) == finished_.end()) {
               finished_.insert(finished_partition);
+              if (partition_committed_) {
+                // The worker wrote this partition's output to its unique
+                // work file (see FileOutputFormat::GetUniqueWorkFile).
+                std::string output_file(FileOutputFormat::GetOutputPath(job_));
+                output_file += "part-" + result;
+                partition_committed_(finished_partition, output_file);
+              }
             }
             break;
          }
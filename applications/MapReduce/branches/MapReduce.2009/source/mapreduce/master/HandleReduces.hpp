@@ -11,6 +11,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <boost/function.hpp>
 #include <saga/saga.hpp>
 #include "utils/LogWriter.hpp"
 #include "job.hpp"
@@ -21,6 +22,11 @@ namespace mapreduce { namespace master {
 
 class HandleReduces {
  public:
+  // Called when a partition's reduce output has been committed, with the
+  // partition number and the output file path.
+  typedef boost::function<void (int, const std::string&)>
+    PartitionCommittedCallback;
+
   HandleReduces(const JobDescription& job,
                 std::map<std::string, saga::url>& committed_chunks,
                 saga::advert::directory workerDir,
@@ -28,6 +34,12 @@ class HandleReduces {
                 LogWriter *log);
  ~HandleReduces();
   bool assignReduces();
+  // Install a callback fired as each partition commits. Used by the job
+  // graph runner to feed downstream jobs without a staging pass.
+  void set_partition_committed_callback(
+    const PartitionCommittedCallback& callback) {
+    partition_committed_ = callback;
+  }
  private:
   void issue_command_();
   std::vector<std::string> groupFiles_(int counter);
@@ -40,6 +52,7 @@ class HandleReduces {
   saga::url                serverURL_;
   LogWriter               *log_;
   std::set<int> finished_;  // Finished partition's ID.
+  PartitionCommittedCallback partition_committed_;
   std::vector<saga::url>   workers_;
   saga::stream::server    *service_;
   int                      currentPartition_;
@@ -18,14 +18,22 @@ namespace mapreduce {
 // RawRecordWriter implementation for SequenceFiles.
 class SequenceFileRecordWriter : public RawRecordWriter {
  public:
-  SequenceFileRecordWriter(saga::url& path) {
-    writer_.reset(new SequenceFileWriter(path));
+  // Block compression is on by default: task outputs are re-read over the
+  // wire during the shuffle, where the smaller blocks pay off most. Pass
+  // block_compressed = false to write the plain version 1 format.
+  SequenceFileRecordWriter(saga::url& path, bool block_compressed = true) {
+    writer_.reset(new SequenceFileWriter(path, false, block_compressed));
   }
   ~SequenceFileRecordWriter() {}
   // RawRecordWriter implementation.
   void Write(const std::string& key, const std::string& value) {
     writer_->AppendRaw(key.data(), key.size(), value.data(), value.size());
   }
+  // View-based path: the writer takes plain pointers, so nothing needs to
+  // be copied into strings first.
+  void Write(const RawBuffer& key, const RawBuffer& value) {
+    writer_->AppendRaw(key.data, key.size, value.data, value.size);
+  }
   void Close() {
     writer_->Close();
   }
@@ -6,6 +6,8 @@
 #ifndef MAPREDUCE_SERIALIZATION_HPP_
 #define MAPREDUCE_SERIALIZATION_HPP_
 
+#include <algorithm>
+#include <cstring>
 #include <google/protobuf/message.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
@@ -132,6 +134,92 @@ class SerializationHandler<int> {
   }
 };
 
+// View of a run of serialized record bytes given as a pointer and a length.
+// Used on the raw record path to hand buffers around without copying them
+// into std::string first: the bytes normally stay with whoever produced
+// them (the reader's record buffer, a spill arena) and the view is valid
+// only as long as that owner is.
+struct RawBuffer {
+  RawBuffer() : data(NULL), size(0) {}
+  RawBuffer(const char* data_, int size_) : data(data_), size(size_) {}
+  explicit RawBuffer(const std::string& bytes)
+    : data(bytes.data()), size(bytes.size()) {}
+  RawBuffer(const RawBuffer& other) : data(NULL), size(0) { *this = other; }
+  RawBuffer& operator=(const RawBuffer& other) {
+    if (this != &other) {
+      size = other.size;
+      if (other.IsOwned()) {
+        storage = other.storage;
+        data = storage.data();
+      } else {
+        storage.clear();
+        data = other.data;
+      }
+    }
+    return *this;
+  }
+  // Whether the viewed bytes live in this object's own storage.
+  bool IsOwned() const {
+    return !storage.empty() && data == storage.data();
+  }
+  // Copy the viewed bytes out into a string.
+  void CopyTo(std::string* destination) const {
+    destination->assign(data, size);
+  }
+  const char* data;
+  int size;
+  // Owned fallback filled by SerializationHandler<RawBuffer>::Deserialize
+  // when a record cannot alias the stream's buffer. Not for direct use.
+  std::string storage;
+};
+
+// Byte-lexicographic ordering; consistent with RawBytesComparator.
+inline bool operator<(const RawBuffer& left, const RawBuffer& right) {
+  int size = std::min(left.size, right.size);
+  int order = memcmp(left.data, right.data, size);
+  return order < 0 || (order == 0 && left.size < right.size);
+}
+inline bool operator>(const RawBuffer& left, const RawBuffer& right) {
+  return right < left;
+}
+
+// Serialization support for RawBuffer views. Serialize writes the same
+// varint length prefix std::string uses, so the two types are wire
+// compatible. Deserialize points the view at the stream's backing buffer
+// when the record is contiguous - the common case, since record readers
+// serve ArrayInputStreams over complete records - and only copies when the
+// record spans stream blocks.
+template <>
+class SerializationHandler<RawBuffer> {
+ public:
+  inline static void Serialize(const RawBuffer* object,
+                               ZeroCopyOutputStream* output) {
+    CodedOutputStream coded_out(output);
+    coded_out.WriteVarint32(object->size);
+    coded_out.WriteRaw(object->data, object->size);
+  }
+  inline static void Deserialize(ZeroCopyInputStream* input,
+                                 RawBuffer* object) {
+    CodedInputStream coded_in(input);
+    uint32 size;
+    coded_in.ReadVarint32(&size);
+    const void* direct;
+    int available;
+    if (coded_in.GetDirectBufferPointer(&direct, &available) &&
+        available >= static_cast<int>(size)) {
+      object->storage.clear();
+      object->data = reinterpret_cast<const char*>(direct);
+      object->size = size;
+      coded_in.Skip(size);
+    } else {
+      // Record is split across stream blocks; copy it out.
+      coded_in.ReadString(&object->storage, size);
+      object->data = object->storage.data();
+      object->size = object->storage.size();
+    }
+  }
+};
+
 } // namespace mapreduce
 
 #endif  // MAPREDUCE_SERIALIZATION_HPP_
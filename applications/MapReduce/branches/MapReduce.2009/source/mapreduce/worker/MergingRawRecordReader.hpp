@@ -6,14 +6,139 @@
 #ifndef MAPREDUCE_WORKER_MERGINGRAWRECORDREADER_
 #define MAPREDUCE_WORKER_MERGINGRAWRECORDREADER_
 
+#include <deque>
 #include <string>
 #include <vector>
+#include <boost/bind.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
 #include "serialization.hpp"
 #include "input_output.hpp"
 
 namespace mapreduce { namespace worker {
 
+// Decorator reading ahead of its consumer on a private thread. A small
+// bounded queue of prefetched records (two by default, i.e. double
+// buffering) sits between the producer and the consumer: while the merge
+// drains one record, the next one is already being fetched, so a wide
+// merge does not stall on the read latency of any single input file.
+// Takes over the ownership of the wrapped RawRecordReader.
+class PrefetchingRawRecordReader : public RawRecordReader {
+ public:
+  PrefetchingRawRecordReader(RawRecordReader* reader, size_t depth = 2)
+    : reader_(reader), depth_(depth), done_(false), stop_(false) {
+    thread_ = boost::thread(boost::bind(
+      &PrefetchingRawRecordReader::PrefetchLoop, this));
+  }
+  ~PrefetchingRawRecordReader() {
+    StopPrefetching();
+    while (!queue_.empty()) {
+      delete queue_.front();
+      queue_.pop_front();
+    }
+  }
+  // RawRecordReader implementation.
+  void Initialize(InputChunk* input_chunk) {}
+  bool NextRecord() {
+    boost::mutex::scoped_lock lock(mutex_);
+    while (queue_.empty() && !done_) {
+      record_available_.wait(lock);
+    }
+    if (queue_.empty()) {
+      return false;
+    }
+    Record* record = queue_.front();
+    queue_.pop_front();
+    key_buffer_.swap(record->key);
+    value_buffer_.swap(record->value);
+    delete record;
+    slot_available_.notify_one();
+    return true;
+  }
+  ZeroCopyInputStream* current_key() {
+    key_input_.reset(new ArrayInputStream(string_as_array(&key_buffer_),
+      key_buffer_.size()));
+    return key_input_.get();
+  }
+  void get_key_buffer(const uint8** buffer, int* size) {
+    *buffer = reinterpret_cast<const uint8*>(string_as_array(&key_buffer_));
+    *size = key_buffer_.size();
+  }
+  ZeroCopyInputStream* current_value() {
+    value_input_.reset(new ArrayInputStream(string_as_array(&value_buffer_),
+      value_buffer_.size()));
+    return value_input_.get();
+  }
+  void Close() {
+    StopPrefetching();
+    reader_->Close();
+  }
+ private:
+  // A record copied out of the underlying reader by the prefetch thread.
+  struct Record {
+    std::string key;
+    std::string value;
+  };
+
+  // Thread body: keep the queue of upcoming records filled.
+  void PrefetchLoop() {
+    while (true) {
+      // The read happens outside the lock; only handing over the record
+      // contends with the consumer.
+      bool has_record = reader_->NextRecord();
+      Record* record = NULL;
+      if (has_record) {
+        record = new Record();
+        CopyStreamIntoString(reader_->current_key(), record->key);
+        CopyStreamIntoString(reader_->current_value(), record->value);
+      }
+      boost::mutex::scoped_lock lock(mutex_);
+      if (!has_record) {
+        done_ = true;
+        record_available_.notify_one();
+        return;
+      }
+      while (queue_.size() >= depth_ && !stop_) {
+        slot_available_.wait(lock);
+      }
+      if (stop_) {
+        delete record;
+        return;
+      }
+      queue_.push_back(record);
+      record_available_.notify_one();
+    }
+  }
+
+  // Shut the prefetch thread down and wait for it.
+  void StopPrefetching() {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      stop_ = true;
+    }
+    slot_available_.notify_one();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  boost::scoped_ptr<RawRecordReader> reader_;
+  size_t depth_;   // Maximum number of records read ahead.
+  bool done_;   // Whether the underlying reader has been exhausted.
+  bool stop_;   // Ask the prefetch thread to quit.
+  std::deque<Record*> queue_;   // Prefetched records, oldest first.
+  boost::mutex mutex_;
+  boost::condition record_available_;
+  boost::condition slot_available_;
+  boost::thread thread_;
+  // Current record and streams over it.
+  std::string key_buffer_;
+  std::string value_buffer_;
+  boost::scoped_ptr<ArrayInputStream> key_input_;
+  boost::scoped_ptr<ArrayInputStream> value_input_;
+};
+
 // Class for wrapping record readers. Takes over the ownership of the given
 // RawRecordReader object.
 class ReaderWrapper {
@@ -48,13 +173,14 @@ class ReaderWrapper {
 
 // Class for comparing the underlying keys in ReaderWrappers. Simply obtains
 // the buffers for the underlying keys and applies the comparator specified as
-// the template parameter for comparison.
+// the template parameter for comparison. Returns true when a sorts after b
+// (or is exhausted), i.e. when a loses the match.
 template <class Comparator>
 class ReaderWrapperComparator {
  public:
   ReaderWrapperComparator() {}
   bool operator()(ReaderWrapper* a, ReaderWrapper* b) {
-    // Exhausted readers are always go to back of the queue.
+    // Exhausted readers always lose.
     if (a->exhausted()) {
       return true;
     } else if (b->exhausted()) {
@@ -75,32 +201,39 @@ class ReaderWrapperComparator {
 // Class for reading from several record readers backed by data in ascending
 // key order. The records output by this reader will also have an ascending
 // order of keys.
+//
+// The merge is organized as a loser tree: internal node i of an implicit
+// binary tree holds the reader that lost the match at that node, and the
+// overall winner (the reader with the smallest current key) is kept aside.
+// Advancing the winner only replays the matches on the path from its leaf
+// to the root, so every merged record costs ceil(log2(N)) comparisons for
+// an N-way merge. Each input is additionally wrapped in a
+// PrefetchingRawRecordReader, overlapping the reads of all inputs.
 template <class Key, class Comparator>
 class MergingRawRecordReader : public RawRecordReader {
  public:
   MergingRawRecordReader(const std::vector<RawRecordReader*>& readers)
-    : top_(NULL) {
+    : top_(NULL), winner_(0) {
     Setup(readers);
   }
   void Initialize(InputChunk* input_chunk) {}
   // Retrieve next record.
   bool NextRecord() {
-    // Advance previous top reader and maintain heap property.
     if (NULL != top_) {
-      // Remove top reader from heap.
-      std::pop_heap(reader_heap_.begin(), reader_heap_.end(),
-        ReaderWrapperComparator<Comparator>());
-      reader_heap_.pop_back();
-      // Advance top reader.
-      top_->Next();
-      // Put it back into the heap.
-      reader_heap_.push_back(top_);
-      // Maintain heap property.
-      std::push_heap(reader_heap_.begin(), reader_heap_.end(),
-        ReaderWrapperComparator<Comparator>());
+      // Advance the previous winner and replay the matches along the path
+      // from its leaf to the root; the rest of the tree is untouched.
+      readers_[winner_]->Next();
+      int leaf_count = readers_.size();
+      int contender = winner_;
+      for (int node = (leaf_count + winner_) / 2; node >= 1; node /= 2) {
+        if (comparator_(readers_[contender], readers_[node_[node]])) {
+          std::swap(contender, node_[node]);
+        }
+      }
+      winner_ = contender;
     }
-    // Note reader on top of the heap.
-    top_ = reader_heap_.front();
+    // Note the reader holding the smallest key.
+    top_ = readers_[winner_];
     if (top_->exhausted()) {   // All readers are exhausted.
       return false;
     } else {
@@ -122,30 +255,56 @@ class MergingRawRecordReader : public RawRecordReader {
   // Close the record readers.
   void Close() {
     std::vector<ReaderWrapper*>::const_iterator reader_it =
-      reader_heap_.begin();
-    while (reader_it != reader_heap_.end()) {
+      readers_.begin();
+    while (reader_it != readers_.end()) {
       (*reader_it)->reader()->Close();
       delete *reader_it;
       ++reader_it;
     }
-    reader_heap_.clear();
+    readers_.clear();
   }
  private:
   void Setup(const std::vector<RawRecordReader*>& readers) {
-    // Create reader heap.
+    // Wrap the readers; the wrapper loads the first record of each input
+    // and the decorator keeps reading ahead of the merge.
     std::vector<RawRecordReader*>::const_iterator reader_it = readers.begin();
     while (reader_it != readers.end()) {
-      reader_heap_.push_back(new ReaderWrapper(*reader_it));
+      readers_.push_back(new ReaderWrapper(
+        new PrefetchingRawRecordReader(*reader_it)));
       ++reader_it;
     }
-    // Heapify.
-    std::make_heap(reader_heap_.begin(), reader_heap_.end(),
-      ReaderWrapperComparator<Comparator>());
+    BuildTree();
+  }
+
+  // Play the initial tournament: leaves are the readers, every internal
+  // node keeps the loser of its match and the winners move up the tree.
+  void BuildTree() {
+    int leaf_count = readers_.size();
+    node_.assign(leaf_count, -1);
+    std::vector<int> winner(2 * leaf_count, -1);
+    for (int i = 0; i < leaf_count; ++i) {
+      winner[leaf_count + i] = i;
+    }
+    for (int i = leaf_count - 1; i >= 1; --i) {
+      int left = winner[2 * i];
+      int right = winner[2 * i + 1];
+      if (comparator_(readers_[left], readers_[right])) {
+        winner[i] = right;
+        node_[i] = left;
+      } else {
+        winner[i] = left;
+        node_[i] = right;
+      }
+    }
+    winner_ = (leaf_count > 1) ? winner[1] : 0;
   }
 
   DECLARE_LOGGER(MergingRawRecordReader);
-  std::vector<ReaderWrapper*> reader_heap_;
+  std::vector<ReaderWrapper*> readers_;   // One wrapped reader per input.
+  std::vector<int> node_;   // Loser of the match at each internal node.
+  int winner_;   // Index of the reader having the top-most key.
   ReaderWrapper* top_;  // The reader having the top-most key.
+  ReaderWrapperComparator<Comparator> comparator_;
 };
 
 }   // namespace worker
@@ -0,0 +1,105 @@
+//  Copyright (c) 2009 Miklos Erdelyi
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "SplitPrefetcher.hpp"
+
+#include <boost/bind.hpp>
+#include "../input_output.hpp"
+#include "../input/FileInputFormat.hpp"
+#include "../io/saga_file_adaptors.hpp"
+
+using google::protobuf::io::ArrayInputStream;
+
+namespace mapreduce { namespace worker {
+
+// Size of the scratch buffer the prefetch reads into. The bytes are
+// discarded - the point is pulling them through the storage path.
+#define PREFETCH_BUFFER_SIZE (256 * 1024)
+
+// Read one file chunk's byte range and throw the bytes away.
+static void PrefetchFileChunk(FileInputChunk* chunk) {
+  SagaFileInputStream input(chunk->path(), saga::filesystem::Read);
+  if (chunk->start_offset() > 0) {
+    input.Skip(chunk->start_offset());
+  }
+  char buffer[PREFETCH_BUFFER_SIZE];
+  int remaining = chunk->GetLength();
+  while (remaining > 0) {
+    int wanted = remaining < PREFETCH_BUFFER_SIZE ?
+      remaining : PREFETCH_BUFFER_SIZE;
+    int got = input.Read(buffer, wanted);
+    if (got <= 0) {
+      break;
+    }
+    remaining -= got;
+  }
+}
+
+void SplitPrefetcher::Prefetch(const std::string& serialized_chunk,
+                               const std::string& input_format) {
+  if (serialized_chunk.empty()) {
+    return;
+  }
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (busy_) {
+      // Still staging the previous hint - this one is only advisory.
+      LOG_DEBUG << "Prefetch still running, dropping new hint";
+      return;
+    }
+    busy_ = true;
+  }
+  // The previous thread has finished (busy_ was false); reap it.
+  if (thread_ != NULL) {
+    thread_->join();
+  }
+  thread_.reset(new boost::thread(boost::bind(&SplitPrefetcher::Run_, this,
+    serialized_chunk, input_format)));
+}
+
+void SplitPrefetcher::Wait() {
+  if (thread_ != NULL) {
+    thread_->join();
+    thread_.reset();
+  }
+}
+
+void SplitPrefetcher::Run_(std::string serialized_chunk,
+                           std::string input_format) {
+  try {
+    // Deserialize the hinted chunk with the job's input format.
+    RawInputFormat* format = InputFormatFactory::get_by_key(input_format);
+    ArrayInputStream input(string_as_array(&serialized_chunk),
+      serialized_chunk.size());
+    boost::scoped_ptr<InputChunk> chunk(format->CreateInputChunk(&input));
+
+    LOG_DEBUG << "Prefetching likely next split (" << chunk->GetLength()
+      << " bytes)";
+    // Only file-based chunks name bytes we can stage ahead of time.
+    if (FileInputChunk* file_chunk =
+        dynamic_cast<FileInputChunk*>(chunk.get())) {
+      PrefetchFileChunk(file_chunk);
+    }
+    else if (MultiFileInputChunk* multi_chunk =
+        dynamic_cast<MultiFileInputChunk*>(chunk.get())) {
+      std::vector<FileInputChunk>& files = multi_chunk->files();
+      for (size_t i = 0; i < files.size(); ++i) {
+        PrefetchFileChunk(&files[i]);
+      }
+    }
+  }
+  catch(saga::exception const& e) {
+    // Best effort only - the actual task read reports real errors.
+    LOG_DEBUG << "Prefetch failed (" << e.get_message() << ")";
+  }
+  catch(...) {
+    LOG_DEBUG << "Prefetch failed";
+  }
+  boost::mutex::scoped_lock lock(mutex_);
+  busy_ = false;
+}
+
+}   // namespace worker
+}   // namespace mapreduce
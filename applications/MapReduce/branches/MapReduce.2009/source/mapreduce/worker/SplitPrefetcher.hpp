@@ -0,0 +1,52 @@
+//  Copyright (c) 2009 Miklos Erdelyi
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MAPREDUCE_WORKER_SPLITPREFETCHER_HPP_
+#define MAPREDUCE_WORKER_SPLITPREFETCHER_HPP_
+
+#include <string>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include "../../utils/logging.hpp"
+
+namespace mapreduce { namespace worker {
+
+// Stages the bytes of a likely-next input split while the current map
+// task computes. The master names task N+1's probable split alongside
+// task N's assignment; reading those bytes through the same SAGA file
+// path the record reader will use pulls them into the local (page)
+// cache, so task N+1 starts mapping instead of waiting on storage.
+// The hint is advisory: prefetching is best effort, at most one runs
+// at a time, and any failure is logged and swallowed - the real read
+// happens (again) when the task is actually assigned.
+class SplitPrefetcher {
+ public:
+  SplitPrefetcher() : busy_(false) {}
+  ~SplitPrefetcher() { Wait(); }
+
+  // Start prefetching the split described by the serialized InputChunk
+  // bytes, interpreted by the named input format. Returns immediately;
+  // a request arriving while a prefetch still runs is dropped.
+  void Prefetch(const std::string& serialized_chunk,
+                const std::string& input_format);
+
+  // Block until the running prefetch (if any) has finished.
+  void Wait();
+
+ private:
+  DECLARE_LOGGER(SplitPrefetcher);
+  // Thread body: deserializes the chunk and reads its byte range(s).
+  void Run_(std::string serialized_chunk, std::string input_format);
+
+  boost::scoped_ptr<boost::thread> thread_;
+  boost::mutex mutex_;   // guards busy_
+  bool busy_;
+};
+
+}   // namespace worker
+}   // namespace mapreduce
+
+#endif  // MAPREDUCE_WORKER_SPLITPREFETCHER_HPP_
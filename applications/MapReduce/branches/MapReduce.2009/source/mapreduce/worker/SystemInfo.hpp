@@ -1,11 +1,13 @@
 //  Copyright (c) 2008 Michael Miceli and Christopher Miceli
-// 
-//  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
 #ifndef MR_WORKER_SYSTEMINFO_HPP
 #define MR_WORKER_SYSTEMINFO_HPP
 
+#include <time.h>
+
 #include <string>
 #include <saga/saga.hpp>
 
@@ -17,39 +19,66 @@ namespace mapreduce { namespace worker {
       boost::uint64_t cpuFrequency;
       boost::uint64_t totalMemory;
    };
- 
+
+   // SystemInfo is a cached sampler: hardware facts and host identity are
+   // probed once at construction, volatile metrics are re-probed at most
+   // every refreshInterval seconds (on the monotonic clock, so wall-clock
+   // jumps neither starve nor flood the sampler).  Callers in the worker
+   // command loop thus read a cached value instead of spawning a probe
+   // process per iteration.
    class SystemInfo {
      private:
+      // fixed interval between probes of the volatile metrics (seconds)
+      static const long refreshInterval = 5;
+
       std::string pathToUname_;
       std::string pathToWhich_;
       std::string pathToUptime_;
-      
+
       std::string hostName_;
       std::string hostUname_;
       std::string hostLoadAverage_;
-      
+
       hwInfo hardwareInfo_;
-                  
+
+      // the volatile metrics are served seqlock-style: the sampler bumps
+      // the sequence to odd before publishing and back to even after, and
+      // readers retry while the sequence is odd or changed underneath
+      // them.  The published snapshot is a flat POD, so the retried copy
+      // is always safe.  Readers never block the sampler, and a reader
+      // racing a refresh only re-copies a few bytes.
+      struct sample_t {
+         char loadAverage[64];
+      };
+
+      volatile unsigned sampleSeq_;
+      sample_t          sample_;
+      long              lastRefresh_;  // monotonic seconds, -1 = never
+
+      static long monotonicSeconds_();
+
+      void refreshIfStale_();
+
       void detectHostName_();
       void detectHostUname_();
       void detectHostLoadAverage_();
-      
+
       void gatherHardwareInfo_();
-      
+
       std::string findExecutable_(std::string name);
-     
+
      public:
       SystemInfo();
       ~SystemInfo();
-     
+
       // Static system properties
       std::string hostName() { return hostName_; }
       std::string hostType() { return hostUname_; }
       hwInfo hardwareInfo()  { return hardwareInfo_; }
-      
-      // Dynamic system properties
+
+      // Dynamic system properties (cached, refreshed at bounded interval)
       std::string hostLoadAverage();
-   }; 
+   };
 
 } // namespace worker
 } // namespace mapreduce
@@ -17,15 +17,37 @@ using mapreduce::Partitioner;
 
 namespace mapreduce { namespace worker {
 
-// Class handling the actual execution of a map task.
+// Class handling the actual execution of a map task. When the job asks for
+// more than one map thread (see JOB_ATTRIBUTE_NUM_MAP_THREADS) and the
+// output is partitioned, the chunk is subdivided among a pool of threads,
+// each running its own Mapper instance with private partitioned spill
+// files; the spills are merged per partition at the end of the task.
 template <typename MapperT>
 class TypedMapRunner {
  public:
   void RunTask(JobDescription* job, ZeroCopyInputStream* input);
+ private:
+  // Subdivide the chunk and run the mapper over the slices in parallel.
+  void RunParallelTask(JobDescription* job, RawInputFormat* input_format,
+    FileInputChunk* chunk, int num_threads);
+  // Thread body: run one Mapper instance over its slice of the chunk,
+  // spilling into the partition files named by job's runner.chunk_id.
+  // Static so no (thread-unsafe) members are touched from worker threads.
+  static void RunMapThread(JobDescription* job, RawInputFormat* input_format,
+    InputChunk* chunk, bool* failed);
+  // Merge the sorted per-thread spills of every partition into the
+  // partition file downstream reducers expect.
+  void MergeSpills(JobDescription* job, const std::string& chunk_id,
+    int num_threads);
+
+  DECLARE_LOGGER(TypedMapRunner);
 };
 
-// Class for outputting partitioned intermediate data. Buffers the output
-// key/value pairs in a std::map using operator< as the comparator.
+// Class for outputting partitioned intermediate data. Records are
+// serialized exactly once, when they are emitted: the value bytes land in
+// a per-partition spill arena and the buffer keeps (offset, length) spans
+// into it, plus one copy of each distinct key's serialized form. Keys are
+// ordered in a std::map using operator< as the comparator.
 // Note: as such, an operator< needs to be specified for custom key types,
 // otherwise compilation of MapPartitionedOutput will fail.
 template <typename KeyT, typename ValueT>
@@ -37,7 +59,7 @@ class MapPartitionedOutput : public RecordWriter<KeyT, ValueT> {
   // RecordWriter implementation.
   void Write(const KeyT& key, const ValueT& value) {
     key_buffer_.clear();
-    // Serialize the key/value pair.
+    // Serialize the key.
     StringOutputStream key_out(&key_buffer_);
     SerializationHandler<KeyT>::Serialize(&key, &key_out);
     // Get partition for this key.
@@ -46,22 +68,41 @@ class MapPartitionedOutput : public RecordWriter<KeyT, ValueT> {
     if (partition < 0 || partition >= num_partitions_) {
       throw saga::bad_parameter("Wrong partition returned by partitioner");
     }
-    // Choose intermediate buffer and save value.
-    IntermediateBufferT* buffer = buffers_[partition];
-    (*buffer)[key].push_back(value);
+    // Serialize the value straight into the partition's arena and remember
+    // its span; this is the only copy the record makes before it reaches
+    // the writer.
+    std::string* arena = arenas_[partition];
+    int value_offset = arena->size();
+    StringOutputStream value_out(arena);
+    SerializationHandler<ValueT>::Serialize(&value, &value_out);
+    KeyEntry* entry = &(*buffers_[partition])[key];
+    if (entry->raw_key.empty()) {
+      // First record for this key; keep its serialized form for the flush.
+      entry->raw_key = key_buffer_;
+    }
+    entry->values.push_back(ValueSpanT(value_offset,
+      static_cast<int>(arena->size()) - value_offset));
   }
   void Close() {
     // Flush buffers and close all writers.
     for (int i = 0; i < num_partitions_; ++i) {
-      FlushIntermediateBuffer(buffers_[i], writers_[i]);
+      FlushIntermediateBuffer(buffers_[i], *arenas_[i], writers_[i]);
       writers_[i]->Close();
       delete writers_[i];
       delete tasks_[i];
       delete buffers_[i];
+      delete arenas_[i];
     }
   }
 
-  typedef std::map< KeyT, std::deque<ValueT> > IntermediateBufferT;
+  // Span of one serialized value inside the partition's arena.
+  typedef std::pair<int, int> ValueSpanT;
+  // Values collected for one distinct key.
+  struct KeyEntry {
+    std::string raw_key;    // Serialized key bytes, saved once per key.
+    std::deque<ValueSpanT> values;
+  };
+  typedef std::map<KeyT, KeyEntry> IntermediateBufferT;
 
  private:
   // Get partitioner class from configuration and instantiate it.
@@ -80,6 +121,7 @@ class MapPartitionedOutput : public RecordWriter<KeyT, ValueT> {
         throw saga::bad_parameter("Unknown partitioner class specified");
       }
     }
+    partitioner_->Configure(job_);
   }
 
   // Get partitioner, and create RecordWriters for each of the partitions. 
@@ -90,9 +132,11 @@ class MapPartitionedOutput : public RecordWriter<KeyT, ValueT> {
     // Create tasks and writers.
     writers_.reset(new RawRecordWriter *[num_partitions_]);
     buffers_.reset(new IntermediateBufferT *[num_partitions_]);
+    arenas_.reset(new std::string *[num_partitions_]);
     tasks_.reset(new TaskDescription *[num_partitions_]);
     for (int partition = 0; partition < num_partitions_; ++partition) {
       buffers_[partition] = new IntermediateBufferT();
+      arenas_[partition] = new std::string();
       TaskDescription* task = new TaskDescription(job_);
       task->set_id(partition);
       tasks_[partition] = task;
@@ -117,22 +161,18 @@ class MapPartitionedOutput : public RecordWriter<KeyT, ValueT> {
   }
 
   // Write out the sorted contents of the intermediate buffer using the
-  // specified writer.
+  // specified writer. Everything was serialized when it was emitted, so
+  // the records are handed over as views into the buffer and the arena.
   void FlushIntermediateBuffer(IntermediateBufferT* buffer,
-    RawRecordWriter* writer) {
+    const std::string& arena, RawRecordWriter* writer) {
     typename IntermediateBufferT::const_iterator it = buffer->begin();
     while (it != buffer->end()) {
-      typename std::deque<ValueT>::const_iterator value_it =
-        it->second.begin();
-      while (value_it != it->second.end()) {
-        key_buffer_.clear();
-        value_buffer_.clear();
-        // Serialize the key/value pair.
-        StringOutputStream key_out(&key_buffer_);
-        StringOutputStream value_out(&value_buffer_);
-        SerializationHandler<KeyT>::Serialize(&(it->first), &key_out);
-        SerializationHandler<ValueT>::Serialize(&(*value_it), &value_out);
-        writer->Write(key_buffer_, value_buffer_);
+      RawBuffer key_bytes(it->second.raw_key);
+      std::deque<ValueSpanT>::const_iterator value_it =
+        it->second.values.begin();
+      while (value_it != it->second.values.end()) {
+        writer->Write(key_bytes, RawBuffer(arena.data() + value_it->first,
+          value_it->second));
         ++value_it;
       }
       ++it;
@@ -140,9 +180,8 @@ class MapPartitionedOutput : public RecordWriter<KeyT, ValueT> {
   }
 
   DECLARE_LOGGER(TypedMapRunner);
-  // Buffers for current key/value.
+  // Buffer for the current serialized key.
   std::string key_buffer_;
-  std::string value_buffer_;
   // Currently processed job.
   JobDescription* job_;
   // Used partitioner.
@@ -150,6 +189,8 @@ class MapPartitionedOutput : public RecordWriter<KeyT, ValueT> {
   int num_partitions_;
   // Buffers for intermediate values for each partition.
   boost::scoped_array<IntermediateBufferT*> buffers_;
+  // Per-partition arenas holding the serialized value bytes.
+  boost::scoped_array<std::string*> arenas_;
   boost::scoped_array<TaskDescription*> tasks_;
   // Writers for each partition.
   boost::scoped_array<RawRecordWriter*> writers_;
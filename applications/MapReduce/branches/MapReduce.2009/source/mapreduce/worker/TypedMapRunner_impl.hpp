@@ -5,9 +5,15 @@
 
 #include <saga/saga.hpp>
 
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 #include "../input_output.hpp"
 #include "../io/SequenceFile.hpp"
 #include "../Partitioner.hpp"
+#include "../Reducer.hpp"
+#include "../input/SequenceFileInputFormat.hpp"
+#include "MergingRawRecordReader.hpp"
 
 using namespace mapreduce;
 using namespace mapreduce::io;
@@ -22,6 +28,18 @@ void TypedMapRunner<MapperT>::RunTask(JobDescription* job,
     job->get_input_format()));
   boost::scoped_ptr<InputChunk> chunk(input_format->CreateInputChunk(
     input));
+  // See if the chunk should be processed by a pool of map threads. Only
+  // partitioned output can run in parallel: the threads spill into private
+  // partition files which are merged afterwards, while direct output goes
+  // to a single writer.
+  int num_threads = job->get_num_map_threads();
+  if (num_threads > 1 && job->get_num_reduce_tasks() > 0) {
+    FileInputChunk* file_chunk = dynamic_cast<FileInputChunk*>(chunk.get());
+    if (file_chunk != NULL && file_chunk->GetLength() >= num_threads) {
+      RunParallelTask(job, input_format.get(), file_chunk, num_threads);
+      return;
+    }
+  }
   TypedInputFormat<typename MapperT::key_type, typename MapperT::value_type>
     typed_input(input_format.get());
   boost::scoped_ptr<RecordReader<typename MapperT::key_type, typename MapperT::value_type> >
@@ -54,5 +72,117 @@ void TypedMapRunner<MapperT>::RunTask(JobDescription* job,
   writer->Close();
 }
 
+template <typename MapperT>
+void TypedMapRunner<MapperT>::RunParallelTask(JobDescription* job,
+  RawInputFormat* input_format, FileInputChunk* chunk, int num_threads) {
+  std::string chunk_id(job->get_attribute("runner.chunk_id"));
+  LOG_DEBUG << "Running chunk " << chunk_id << " on " << num_threads
+            << " map threads";
+  int length = chunk->GetLength();
+  int share = length / num_threads;
+  std::vector<JobDescription*> thread_jobs;
+  std::vector<FileInputChunk*> slices;
+  boost::scoped_array<bool> failed(new bool[num_threads]);
+  boost::thread_group threads;
+  for (int t = 0; t < num_threads; ++t) {
+    // The last thread also picks up the division remainder.
+    int start = chunk->start_offset() + t * share;
+    int slice_length = (t == num_threads - 1) ? length - t * share : share;
+    slices.push_back(new FileInputChunk(chunk->path(), start, slice_length,
+      chunk->GetLocations()));
+    // Each thread spills under its own chunk id so the partition files of
+    // the slices cannot collide.
+    JobDescription* thread_job = new JobDescription(*job);
+    thread_job->set_attribute("runner.chunk_id", chunk_id + "-spill" +
+      boost::lexical_cast<std::string>(t));
+    thread_jobs.push_back(thread_job);
+    failed[t] = false;
+    threads.create_thread(boost::bind(&TypedMapRunner<MapperT>::RunMapThread,
+      thread_job, input_format, slices[t], &failed[t]));
+  }
+  threads.join_all();
+  bool any_failed = false;
+  for (int t = 0; t < num_threads; ++t) {
+    any_failed = any_failed || failed[t];
+    delete thread_jobs[t];
+    delete slices[t];
+  }
+  if (any_failed) {
+    throw saga::exception("Map thread failed while processing chunk " +
+      chunk_id);
+  }
+  MergeSpills(job, chunk_id, num_threads);
+}
+
+template <typename MapperT>
+void TypedMapRunner<MapperT>::RunMapThread(JobDescription* job,
+  RawInputFormat* input_format, InputChunk* chunk, bool* failed) {
+  try {
+    TypedInputFormat<typename MapperT::key_type, typename MapperT::value_type>
+      typed_input(input_format);
+    boost::scoped_ptr<RecordReader<typename MapperT::key_type,
+      typename MapperT::value_type> > reader(
+        typed_input.GetRecordReader(chunk));
+    boost::scoped_ptr<RecordWriter<typename MapperT::out_key_type,
+      typename MapperT::out_value_type> > writer(
+        new MapPartitionedOutput<typename MapperT::out_key_type,
+                                 typename MapperT::out_value_type>(job));
+    // Run a private mapper instance on this slice.
+    typename MapperT::Context context(reader.get(), writer.get());
+    MapperT mapper;
+    mapper.Run(&context);
+    reader->Close();
+    writer->Close();
+  } catch (saga::exception const&) {
+    // Exceptions cannot leave the thread; the spawning task checks the
+    // flag after joining and rethrows there.
+    *failed = true;
+  } catch (std::exception const&) {
+    *failed = true;
+  }
+}
+
+template <typename MapperT>
+void TypedMapRunner<MapperT>::MergeSpills(JobDescription* job,
+  const std::string& chunk_id, int num_threads) {
+  int num_partitions = job->get_num_reduce_tasks();
+  for (int partition = 0; partition < num_partitions; ++partition) {
+    // Open the per-thread spills of this partition.
+    std::vector<RawRecordReader*> readers;
+    for (int t = 0; t < num_threads; ++t) {
+      std::string spill_path(FileOutputFormat::GetOutputPath(*job));
+      spill_path.append(FileOutputFormat::GetOutputPartitionName(job, "map",
+        chunk_id + "-spill" + boost::lexical_cast<std::string>(t), partition));
+      readers.push_back(new SequenceFileRecordReader(
+        FileOutputFormat::GetUrl(*job, spill_path), 0));
+    }
+    // Each spill is sorted the way MapPartitionedOutput orders its buffer,
+    // so merging with the typed comparator reproduces the ordering of the
+    // single-threaded path (every KeyComparator specialization orders like
+    // operator< on the deserialized keys).
+    MergingRawRecordReader<typename MapperT::out_key_type,
+      typename KeyComparator<typename MapperT::out_key_type>::type >
+        merger(readers);
+    // Write the merged records to the partition file the reducers expect.
+    std::string output_path(FileOutputFormat::GetOutputPath(*job));
+    output_path.append(FileOutputFormat::GetOutputPartitionName(job, "map",
+      chunk_id, partition));
+    saga::url output_url(FileOutputFormat::GetUrl(*job, output_path));
+    SequenceFileRecordWriter writer(output_url);
+    const uint8* key_data;
+    int key_size;
+    std::string value;
+    while (merger.NextRecord()) {
+      merger.get_key_buffer(&key_data, &key_size);
+      value.clear();
+      CopyStreamIntoString(merger.current_value(), value);
+      writer.Write(RawBuffer(reinterpret_cast<const char*>(key_data),
+        key_size), RawBuffer(value));
+    }
+    merger.Close();
+    writer.Close();
+  }
+}
+
 }   // namespace worker
 }   // namespace mapreduce
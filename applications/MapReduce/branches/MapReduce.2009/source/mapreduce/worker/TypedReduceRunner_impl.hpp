@@ -56,8 +56,10 @@ void TypedReduceRunner<ReducerT>::RunTask(TaskDescription* task,
         FileOutputFormat::GetUrl(*task, *input_file), 0));
       ++input_file;
     }
-    // Merge input files while reading them.
-    reader.reset(new MergingRawRecordReader<typename ReducerT::out_key_type,
+    // Merge input files while reading them. The comparator defaults to
+    // the type-specialized one for the reducer's input key type (see
+    // KeyComparator in factory_impl.hpp), unless the reducer overrides it.
+    reader.reset(new MergingRawRecordReader<typename ReducerT::key_type,
       typename ReducerT::comparator_type>(readers));
   }
   // Prepare output.
@@ -69,9 +71,11 @@ void TypedReduceRunner<ReducerT>::RunTask(TaskDescription* task,
     typed_output(output_format);
   // Direct output.
   writer.reset(typed_output.GetRecordWriter(task));
-  // Create comparator.
+  // Create comparator - selected at compile time from the job's key type,
+  // so integer keys compare natively and byte keys memcmp their contents
+  // instead of going through the generic serialized-bytes path.
   RawComparator<typename ReducerT::key_type>* comparator =
-    new RawBytesComparator<typename ReducerT::key_type>();
+    new typename KeyComparator<typename ReducerT::key_type>::type();
   // Run the reducer on this partition.
   typename ReducerT::Context context(reader.get(), comparator, writer.get());
   ReducerT reducer;
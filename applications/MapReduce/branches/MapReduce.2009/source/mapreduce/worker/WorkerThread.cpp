@@ -16,6 +16,12 @@ void WorkerThread::mainLoop() {
     if(command == WORKER_COMMAND_MAP) {
        try {
           state_ = WORKER_STATE_MAPPING;
+          // Stage the hinted next split while this task computes, so
+          // the following task starts on warm data (best effort, see
+          // SplitPrefetcher.hpp).
+          if(!prefetch_hint_.empty()) {
+            prefetcher_.Prefetch(prefetch_hint_, job_->get_input_format());
+          }
           // Map the chunk given from the master.
           MapTaskRunner runner(job_, chunk_id_, raw_chunk_);
           runner.Execute();
@@ -131,6 +137,11 @@ std::string WorkerThread::getFrontendCommand_(void) {
                      // Deserialize chunk id.
                      SerializationHandler<std::string>::Deserialize(
                        message_stream.get(), &chunk_id_);
+                     // Deserialize the prefetch hint: the serialized
+                     // chunk the master expects to hand out next (may
+                     // be empty). Staged during compute, see mainLoop.
+                     SerializationHandler<std::string>::Deserialize(
+                       message_stream.get(), &prefetch_hint_);
                      LOG_DEBUG << "just set chunk to " << chunk_id_;
                      server_.write(saga::buffer(WORKER_RESPONSE_ACKNOWLEDGE, 11));
                      //server_.close();
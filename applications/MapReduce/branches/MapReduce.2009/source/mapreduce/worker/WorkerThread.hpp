@@ -21,6 +21,7 @@
 #include "../protocol.hpp"
 #include "MapTaskRunner.hpp"
 #include "ReduceTaskRunner.hpp"
+#include "SplitPrefetcher.hpp"
 #include "SystemInfo.hpp"
 
 namespace mapreduce { namespace worker {
@@ -79,6 +80,11 @@ class WorkerThread {
   boost::scoped_ptr<TaskDescription> task_;   // Current task being executed.
   std::string  chunk_id_;  // Chunk ID to map, set in getFrontendCommand
   std::string* raw_chunk_;  // Raw chunk to map, set in getFrontendCommand
+  // Serialized chunk the master expects to assign next, set in
+  // getFrontendCommand; empty when the queue is drained.
+  std::string  prefetch_hint_;
+  // Stages the hinted split's bytes during compute.
+  SplitPrefetcher prefetcher_;
   int          reduce_partition_;
   std::string  reduceValueMessages_[NUM_MAPS];
   saga::url    serverURL_;
@@ -149,6 +149,10 @@ int main(int argc, char** argv) {
     job.set_partitioner_class("TeraPart");
     job.set_output_format("TeraOutput");
     job.set_num_reduce_tasks(8);
+    // Serialized records are fixed-size (1-byte length + 10-byte key,
+    // 1-byte length + 90-byte value), so reduce tasks can sort their
+    // input through the external record sorter.
+    job.set_sort_record_size(102, 11);
     TeraKeyPartitionGenerator partitioner;
     partitioner.SampleInput(&job, 2000);
     partitioner.WritePartitions(8, FileOutputFormat::GetUrl(job, "_partitions.lst") );
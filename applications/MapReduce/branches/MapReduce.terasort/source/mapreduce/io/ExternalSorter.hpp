@@ -0,0 +1,265 @@
+//  Copyright (c) 2009 Miklos Erdelyi
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MAPREDUCE_IO_EXTERNALSORTER_HPP_
+#define MAPREDUCE_IO_EXTERNALSORTER_HPP_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <string>
+#include <vector>
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
+
+namespace mapreduce { namespace io {
+
+// External sorter for fixed-size records with short fixed-size keys
+// (TeraSort: 100-byte records, 10-byte keys).  Records are collected
+// into a large buffer; each full buffer is sorted in memory with a
+// one-byte radix pass followed by per-bucket comparison sorts running
+// on a thread pool, then spilled as one run into a local spill file.
+// An index block of (offset, record count) pairs describes the runs,
+// and reading merges all runs with a k-way heap, so datasets many
+// times larger than memory sort at full core utilization.
+class ExternalRecordSorter {
+ public:
+  // spill_path names a node-local scratch file.  buffer_records is
+  // the run size; num_threads the sort pool width.
+  ExternalRecordSorter(const std::string& spill_path,
+                       size_t record_length = 100,
+                       size_t key_length = 10,
+                       size_t buffer_records = 1 << 22,
+                       int num_threads = 4)
+      : spill_path_(spill_path), record_length_(record_length),
+        key_length_(key_length), capacity_(buffer_records),
+        num_threads_(num_threads), count_(0), finished_(false),
+        buffer_(new char[buffer_records * record_length]), last_run_(-1) {
+    spill_.open(spill_path.c_str(),
+                std::ios::binary | std::ios::out | std::ios::trunc);
+  }
+
+  ~ExternalRecordSorter() {
+    std::remove(spill_path_.c_str());
+  }
+
+  // Copies one record_length-byte record into the current run.
+  void Add(const char* record) {
+    std::memcpy(buffer_.get() + count_ * record_length_, record,
+                record_length_);
+    if (++count_ == capacity_) {
+      SortAndSpill();
+    }
+  }
+
+  // Sorts and spills the final partial run and writes the index
+  // block.  Must be called once before Next().
+  void Finish() {
+    if (count_ > 0) {
+      SortAndSpill();
+    }
+    // Index block: one (offset, count) pair per run, then the run
+    // count, so a crashed merge can be resumed from the file alone.
+    for (size_t i = 0; i < runs_.size(); ++i) {
+      WriteLong(runs_[i].offset);
+      WriteLong(runs_[i].records);
+    }
+    WriteLong(runs_.size());
+    spill_.close();
+    finished_ = true;
+  }
+
+  // Yields the next record in global key order; the pointer stays
+  // valid until the next call.  Returns false when drained.
+  //
+  // The previous winner's reader is advanced here, not at hand-out
+  // time: advancing can refill the reader's buffer in place, which
+  // would overwrite the bytes the caller is still holding.
+  bool Next(const char** record) {
+    if (!merge_started_()) {
+      StartMerge();
+    }
+    if (last_run_ >= 0) {
+      if (readers_[last_run_]->Advance()) {
+        heap_->push(last_run_);
+      }
+      last_run_ = -1;
+    }
+    if (!heap_ || heap_->empty()) {
+      return false;
+    }
+    int run = heap_->top();
+    heap_->pop();
+    *record = readers_[run]->Current();
+    last_run_ = run;
+    return true;
+  }
+
+  size_t num_runs() const { return runs_.size(); }
+
+ private:
+  struct RunInfo {
+    long offset;
+    long records;
+  };
+
+  // Buffered sequential reader over one run of the spill file.
+  class RunReader {
+   public:
+    RunReader(const std::string& path, const RunInfo& run,
+              size_t record_length)
+        : record_length_(record_length), remaining_(run.records),
+          buffered_(0), position_(0),
+          buffer_(new char[kBufferRecords * record_length]) {
+      in_.open(path.c_str(), std::ios::binary | std::ios::in);
+      in_.seekg(run.offset);
+    }
+    // Loads the first record; false if the run is empty.
+    bool Start() { return Advance(); }
+    const char* Current() const {
+      return buffer_.get() + (position_ - 1) * record_length_;
+    }
+    bool Advance() {
+      if (position_ == buffered_) {
+        if (remaining_ == 0) {
+          return false;
+        }
+        long to_read = remaining_ < (long)kBufferRecords
+                           ? remaining_ : (long)kBufferRecords;
+        in_.read(buffer_.get(), to_read * record_length_);
+        remaining_ -= to_read;
+        buffered_ = to_read;
+        position_ = 0;
+      }
+      ++position_;
+      return true;
+    }
+   private:
+    static const size_t kBufferRecords = 4096;
+    std::ifstream in_;
+    size_t record_length_;
+    long remaining_;
+    long buffered_;
+    long position_;
+    boost::scoped_array<char> buffer_;
+  };
+
+  struct RecordLess {
+    explicit RecordLess(size_t key_length) : key_length(key_length) {}
+    bool operator()(const char* a, const char* b) const {
+      return std::memcmp(a, b, key_length) < 0;
+    }
+    size_t key_length;
+  };
+
+  // Orders heap entries by their reader's current key (min-heap).
+  struct HeapGreater {
+    HeapGreater(const std::vector<boost::shared_ptr<RunReader> >* readers,
+                size_t key_length)
+        : readers(readers), key_length(key_length) {}
+    bool operator()(int a, int b) const {
+      return std::memcmp((*readers)[a]->Current(),
+                         (*readers)[b]->Current(), key_length) > 0;
+    }
+    const std::vector<boost::shared_ptr<RunReader> >* readers;
+    size_t key_length;
+  };
+
+  bool merge_started_() const { return !readers_.empty() || runs_.empty(); }
+
+  void SortAndSpill() {
+    // Radix pass: bucket record pointers by the first key byte.
+    std::vector<std::vector<const char*> > buckets(256);
+    for (size_t i = 0; i < count_; ++i) {
+      const char* record = buffer_.get() + i * record_length_;
+      buckets[(unsigned char)record[0]].push_back(record);
+    }
+    // Comparison-sort the buckets on a thread pool; buckets are
+    // independent so no locking beyond claiming the next one.
+    next_bucket_ = 0;
+    boost::thread_group pool;
+    for (int t = 0; t < num_threads_; ++t) {
+      pool.create_thread(boost::bind(&ExternalRecordSorter::SortBuckets,
+                                     this, &buckets));
+    }
+    pool.join_all();
+    // Spill the buckets in radix order as one run.
+    RunInfo run;
+    run.offset = (long)spill_.tellp();
+    run.records = (long)count_;
+    for (int b = 0; b < 256; ++b) {
+      for (size_t i = 0; i < buckets[b].size(); ++i) {
+        spill_.write(buckets[b][i], record_length_);
+      }
+    }
+    runs_.push_back(run);
+    count_ = 0;
+  }
+
+  void SortBuckets(std::vector<std::vector<const char*> >* buckets) {
+    RecordLess less(key_length_);
+    while (true) {
+      int b;
+      {
+        boost::mutex::scoped_lock lock(bucket_mutex_);
+        if (next_bucket_ >= 256) {
+          return;
+        }
+        b = next_bucket_++;
+      }
+      std::sort((*buckets)[b].begin(), (*buckets)[b].end(), less);
+    }
+  }
+
+  void StartMerge() {
+    for (size_t i = 0; i < runs_.size(); ++i) {
+      readers_.push_back(boost::shared_ptr<RunReader>(
+          new RunReader(spill_path_, runs_[i], record_length_)));
+    }
+    // The heap lives behind a pointer because HeapGreater has no
+    // default constructor: the comparator needs the reader vector,
+    // which only exists once the merge starts.
+    heap_.reset(new Heap(HeapGreater(&readers_, key_length_)));
+    for (size_t i = 0; i < readers_.size(); ++i) {
+      if (readers_[i]->Start()) {
+        heap_->push((int)i);
+      }
+    }
+  }
+
+  void WriteLong(long value) {
+    spill_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  typedef std::priority_queue<int, std::vector<int>, HeapGreater> Heap;
+
+  std::string spill_path_;
+  size_t record_length_;
+  size_t key_length_;
+  size_t capacity_;
+  int num_threads_;
+  size_t count_;
+  bool finished_;
+  boost::scoped_array<char> buffer_;
+  std::ofstream spill_;
+  std::vector<RunInfo> runs_;
+  std::vector<boost::shared_ptr<RunReader> > readers_;
+  boost::scoped_ptr<Heap> heap_;
+  // Run whose current record was handed out by the last Next() call;
+  // its reader is advanced on the following call (see Next()).
+  int last_run_;
+  int next_bucket_;
+  boost::mutex bucket_mutex_;
+};
+
+}}  // namespace mapreduce::io
+
+#endif  // MAPREDUCE_IO_EXTERNALSORTER_HPP_
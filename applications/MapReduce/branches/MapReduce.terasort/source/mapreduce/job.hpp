@@ -23,6 +23,8 @@ namespace mapreduce {
 #define JOB_ATTRIBUTE_PARTITIONER_CLASS "mapred.partitioner.class"
 #define JOB_ATTRIBUTE_REDUCER_CLASS "mapred.reducer.class"
 #define JOB_ATTRIBUTE_NUM_REDUCE_TASKS "mapred.reducer.num_tasks"
+#define JOB_ATTRIBUTE_SORT_RECORD_SIZE "mapred.sort.record_size"
+#define JOB_ATTRIBUTE_SORT_KEY_SIZE "mapred.sort.key_size"
 
 
 // Descriptor of a MapReduce job.
@@ -120,6 +122,28 @@ class JobDescription : public Serializable {
       "0");
     return boost::lexical_cast<int>(num_tasks);
   }
+
+  // Serialized sizes of one record and of its key, for jobs whose
+  // records are fixed-size (eg. TeraSort). When set, reduce tasks sort
+  // their input through the external record sorter instead of heap-
+  // merging one open reader per intermediate part. 0 (the default)
+  // means variable-size records.
+  void set_sort_record_size(int record_size, int key_size) {
+    attributes_[JOB_ATTRIBUTE_SORT_RECORD_SIZE] =
+      boost::lexical_cast<std::string>(record_size);
+    attributes_[JOB_ATTRIBUTE_SORT_KEY_SIZE] =
+      boost::lexical_cast<std::string>(key_size);
+  }
+
+  const int get_sort_record_size() const {
+    return boost::lexical_cast<int>(
+      get_attribute(JOB_ATTRIBUTE_SORT_RECORD_SIZE, "0"));
+  }
+
+  const int get_sort_key_size() const {
+    return boost::lexical_cast<int>(
+      get_attribute(JOB_ATTRIBUTE_SORT_KEY_SIZE, "0"));
+  }
   // Serializable interface implementation.
   virtual void Serialize(CodedOutputStream* output) const;
   virtual void Deserialize(CodedInputStream* input);
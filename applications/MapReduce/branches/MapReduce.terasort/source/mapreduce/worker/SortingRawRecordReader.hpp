@@ -0,0 +1,97 @@
+//  Copyright (c) 2009 Miklos Erdelyi
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MAPREDUCE_WORKER_SORTINGRAWRECORDREADER_
+#define MAPREDUCE_WORKER_SORTINGRAWRECORDREADER_
+
+#include <string>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include "serialization.hpp"
+#include "input_output.hpp"
+#include "io/ExternalSorter.hpp"
+
+namespace mapreduce { namespace worker {
+
+// Class for reading records of several record readers in ascending key
+// order by running them through the external record sorter. Unlike
+// MergingRawRecordReader it does not keep one open reader per input
+// part: each part is drained sequentially into local sorted spill runs
+// up front, so the record count and part fan-in are bounded by disk,
+// not by memory or file handles. Requires fixed serialized record and
+// key sizes (eg. TeraSort); keys are ordered by their serialized bytes,
+// matching RawBytesComparator. Takes over the ownership of the given
+// RawRecordReader objects.
+class SortingRawRecordReader : public RawRecordReader {
+ public:
+  SortingRawRecordReader(const std::vector<RawRecordReader*>& readers,
+                         const std::string& spill_path,
+                         size_t record_size, size_t key_size)
+      : record_size_(record_size), key_size_(key_size), current_(NULL),
+        sorter_(spill_path, record_size, key_size) {
+    std::string record;
+    std::vector<RawRecordReader*>::const_iterator reader_it = readers.begin();
+    while (reader_it != readers.end()) {
+      RawRecordReader* reader = *reader_it;
+      while (reader->NextRecord()) {
+        const uint8* key_buffer;
+        int key_buffer_size;
+        reader->get_key_buffer(&key_buffer, &key_buffer_size);
+        record.assign(reinterpret_cast<const char*>(key_buffer),
+                      key_buffer_size);
+        CopyStreamIntoString(reader->current_value(), record);
+        if (record.size() != record_size_ ||
+            (size_t)key_buffer_size != key_size_) {
+          throw saga::bad_parameter(
+            "Record does not match the job's fixed record/key size");
+        }
+        sorter_.Add(record.data());
+      }
+      reader->Close();
+      delete reader;
+      ++reader_it;
+    }
+    sorter_.Finish();
+  }
+  void Initialize(InputChunk* input_chunk) {}
+  // Retrieve next record in key order.
+  bool NextRecord() {
+    if (!sorter_.Next(&current_)) {
+      current_ = NULL;
+      return false;
+    }
+    key_stream_.reset(new ArrayInputStream(current_, key_size_));
+    value_stream_.reset(new ArrayInputStream(current_ + key_size_,
+                                             record_size_ - key_size_));
+    return true;
+  }
+  // Get inputstream for current key.
+  ZeroCopyInputStream* current_key() {
+    return key_stream_.get();
+  }
+  // Get inmutable buffer for current key.
+  void get_key_buffer(const uint8** buffer, int* size) {
+    *buffer = reinterpret_cast<const uint8*>(current_);
+    *size = key_size_;
+  }
+  // Get inputstream for current value.
+  ZeroCopyInputStream* current_value() {
+    return value_stream_.get();
+  }
+  // The input readers were already closed after draining.
+  void Close() {}
+ private:
+  size_t record_size_;
+  size_t key_size_;
+  const char* current_;    // Sorter-owned bytes of the current record.
+  io::ExternalRecordSorter sorter_;
+  boost::scoped_ptr<ArrayInputStream> key_stream_;
+  boost::scoped_ptr<ArrayInputStream> value_stream_;
+};
+
+}   // namespace worker
+}   // namespace mapreduce
+
+#endif  // MAPREDUCE_WORKER_SORTINGRAWRECORDREADER_
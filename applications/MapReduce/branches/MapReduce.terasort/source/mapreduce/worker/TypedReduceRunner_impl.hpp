@@ -3,11 +3,13 @@
 //  Distributed under the Boost Software License, Version 1.0. (See accompanying 
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 #include <fstream>
+#include <sstream>
 #include <saga/saga.hpp>
 #include "input/SequenceFileInputFormat.hpp"
 #include "Reducer.hpp"
 #include "input_output.hpp"
 #include "MergingRawRecordReader.hpp"
+#include "SortingRawRecordReader.hpp"
 
 using namespace mapreduce;
 using namespace mapreduce::io;
@@ -70,9 +72,21 @@ void TypedReduceRunner<ReducerT>::RunTask(TaskDescription* task,
       ++input_file;
     }
     // Merge input files while reading them.
-LOG_DEBUG << "Mergincreate";    
+    if (task->get_sort_record_size() > 0) {
+      // Fixed-size records (eg. TeraSort): drain the parts through the
+      // external record sorter instead of heap-merging one open reader
+      // per part, so the fan-in and data size are bounded by local
+      // disk, not by memory or file handles.
+      LOG_DEBUG << "Creating sorting reader";
+      std::stringstream spill_path;
+      spill_path << "/tmp/mapreduce-sort-" << task->get_id() << ".spill";
+      reader.reset(new SortingRawRecordReader(readers, spill_path.str(),
+        task->get_sort_record_size(), task->get_sort_key_size()));
+    } else {
+LOG_DEBUG << "Mergincreate";
 reader.reset(new MergingRawRecordReader<typename ReducerT::out_key_type,
       typename ReducerT::comparator_type>(readers));
+    }
   }
   // Prepare output.
   boost::scoped_ptr<RecordWriter<typename ReducerT::out_key_type,
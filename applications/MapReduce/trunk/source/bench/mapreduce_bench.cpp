@@ -0,0 +1,176 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <boost/lexical_cast.hpp>
+#include "../utils/high_resolution_timer.hpp"
+#include "../utils/ChunkTable.hpp"
+#include "../utils/RecordIO.hpp"
+#include "../utils/ChunkReader.hpp"
+#include "../worker/IntermediateStore.hpp"
+
+/*********************************************************
+ * mapreduce_bench drives the framework hot paths with   *
+ * synthetic workloads so regressions show up as numbers *
+ * between releases instead of in production.  No master *
+ * or worker processes are involved; the master-side     *
+ * assignment structures and the worker-side map pass    *
+ * are exercised in-process and results are printed as   *
+ * "name value" lines in the Metrics snapshot format.    *
+ *                                                       *
+ *   mapreduce_bench [chunks] [chunkKB] [keys] [emits]   *
+ *                                                       *
+ * defaults: 64 chunks of 1024 KB, 100000 distinct keys, *
+ * 5000000 emits.                                        *
+ * ******************************************************/
+namespace {
+   using namespace MapReduce;
+
+   /*********************************************************
+    * benchAssignment_ measures the master's chunk table:   *
+    * intern every chunk, drain the unassigned queue, then  *
+    * finish everything, the same sequence serve_worker_    *
+    * performs per conversation.                            *
+    * ******************************************************/
+   void benchAssignment_(int numChunks) {
+      ChunkTable table;
+      std::vector<std::string> names;
+      for(int i = 0; i < numChunks; i++) {
+         names.push_back("bench-chunk-" + boost::lexical_cast<std::string>(i));
+         table.intern(names.back());
+      }
+      high_resolution_timer timer;
+      while(table.hasUnassigned()) {
+         table.markAssigned(table.firstUnassigned());
+      }
+      for(int i = 0; i < numChunks; i++) {
+         table.markFinished(names[i]);
+      }
+      double elapsed = timer.elapsed();
+      std::cout << "bench.assignment.ops_per_sec "
+                << (2.0 * numChunks) / elapsed << std::endl;
+   }
+
+   /*********************************************************
+    * benchEmit_ measures the emitIntermediate hot path:    *
+    * key lookup plus value append into IntermediateStore   *
+    * with a fixed working set of distinct keys.            *
+    * ******************************************************/
+   void benchEmit_(long emits, int distinctKeys) {
+      std::vector<std::string> keys;
+      for(int i = 0; i < distinctKeys; i++) {
+         keys.push_back("key-" + boost::lexical_cast<std::string>(i));
+      }
+      IntermediateStore store;
+      bool isNew;
+      high_resolution_timer timer;
+      for(long i = 0; i < emits; i++) {
+         std::size_t id = store.findOrInsert(keys[i % distinctKeys], isNew);
+         store.appendValue(id, "1");
+      }
+      double elapsed = timer.elapsed();
+      std::cout << "bench.emit.per_sec "  << emits / elapsed << std::endl;
+      std::cout << "bench.emit.keys "     << store.keyCount() << std::endl;
+   }
+
+   /*********************************************************
+    * benchWriteBandwidth_ measures serialization plus the  *
+    * local write path used by writeIntermediate: binary    *
+    * records appended to a buffer, buffer flushed to disk. *
+    * ******************************************************/
+   void benchWriteBandwidth_(long totalBytes) {
+      std::string buffer;
+      std::vector<std::string> values;
+      values.push_back("1");
+      while((long)buffer.size() < totalBytes) {
+         appendRecord(buffer, "bandwidth-key", values);
+      }
+      std::string path("bench-bandwidth.tmp");
+      high_resolution_timer timer;
+      std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+      out.write(buffer.data(), buffer.size());
+      out.close();
+      double elapsed = timer.elapsed();
+      std::cout << "bench.write.mb_per_sec "
+                << (buffer.size() / (1024.0 * 1024.0)) / elapsed << std::endl;
+      std::remove(path.c_str());
+   }
+
+   /*********************************************************
+    * benchMapPass_ is the end-to-end map-side makespan: it *
+    * generates a chunk set of the requested count and size *
+    * on local disk, then runs a null map (tokenize, emit   *
+    * the token unchanged) over every chunk through         *
+    * ChunkReader and IntermediateStore, which is the whole *
+    * worker map loop minus network and adverts.            *
+    * ******************************************************/
+   void benchMapPass_(int numChunks, long chunkBytes) {
+      std::vector<std::string> paths;
+      for(int i = 0; i < numChunks; i++) {
+         std::string path("bench-input-"
+                          + boost::lexical_cast<std::string>(i) + ".tmp");
+         std::ofstream out(path.c_str(), std::ios::trunc);
+         long written = 0;
+         int word = 0;
+         while(written < chunkBytes) {
+            std::string token("word"
+                              + boost::lexical_cast<std::string>(word % 10000));
+            out << token << " ";
+            written += token.size() + 1;
+            word++;
+         }
+         paths.push_back(path);
+      }
+      high_resolution_timer timer;
+      for(int i = 0; i < numChunks; i++) {
+         ChunkReader in(paths[i]);
+         IntermediateStore store;
+         const char *token;
+         std::size_t size;
+         bool isNew;
+         while(in.nextToken(token, size)) {
+            std::string word(token, size);
+            std::size_t id = store.findOrInsert(word, isNew);
+            store.appendValue(id, word);
+         }
+      }
+      double elapsed = timer.elapsed();
+      double totalMB = (numChunks * (double)chunkBytes) / (1024.0 * 1024.0);
+      std::cout << "bench.map_pass.makespan_secs " << elapsed  << std::endl;
+      std::cout << "bench.map_pass.mb_per_sec "
+                << totalMB / elapsed << std::endl;
+      for(int i = 0; i < numChunks; i++) {
+         std::remove(paths[i].c_str());
+      }
+   }
+} // namespace
+
+int main(int argc, char **argv) {
+   int  numChunks    = argc > 1 ? std::atoi(argv[1]) : 64;
+   long chunkBytes   = (argc > 2 ? std::atol(argv[2]) : 1024) * 1024;
+   int  distinctKeys = argc > 3 ? std::atoi(argv[3]) : 100000;
+   long emits        = argc > 4 ? std::atol(argv[4]) : 5000000;
+
+   try {
+      benchAssignment_(numChunks * 100); //cheap, scale it up
+      benchEmit_(emits, distinctKeys);
+      benchWriteBandwidth_(64L * 1024 * 1024);
+      benchMapPass_(numChunks, chunkBytes);
+   }
+   catch(saga::exception const &e) {
+      std::cerr << "Saga: exception caught: " << e.what() << std::endl;
+      return 255;
+   }
+   catch(std::exception const &e) {
+      std::cerr << "std: exception caught: " << e.what() << std::endl;
+      return 255;
+   }
+   return 0;
+}
@@ -3,6 +3,7 @@
 //  Distributed under the Boost Software License, Version 1.0. (See accompanying 
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
+#include <cstdlib>
 #include <iostream>
 
 #include "../utils/defines.hpp"
@@ -46,6 +47,10 @@ std::string ConfigFileParser::getMasterAddress() {
    return masterAddress_;
 }
 
+TuningDescription ConfigFileParser::getTuning() {
+   return tuningDesc_;
+}
+
 void ConfigFileParser::parse_(void)
 {
   std::string tmp("");
@@ -141,18 +146,64 @@ void ConfigFileParser::parse_(void)
      throw xmlParser::exception(message);
   }
 
-  // parse the ApplicationFiles section
+  // parse the (optional) Tuning section.  Example:
+  //   <Tuning autotune="yes" numMaps="32" maxIntermediateSize="500000"
+  //           mapThreads="8" chunkBatchSize="16" dispatchThreads="32"
+  //           maxWorkers="64" scaleBacklog="100" chunkTaper="15"/>
+  // every attribute is optional; absent values keep their defaults or
+  // get autotuned
+  xNode = xMainNode.getChildNode("Tuning");
+  if( !xNode.isEmpty() ) {
+    if( NULL != xNode.getAttribute("autotune") )
+      tuningDesc_.autotune = (std::string("yes") == xNode.getAttribute("autotune"));
+    if( NULL != xNode.getAttribute("numMaps") )
+      tuningDesc_.numMaps = atoi(xNode.getAttribute("numMaps"));
+    if( NULL != xNode.getAttribute("maxIntermediateSize") )
+      tuningDesc_.maxIntermediateSize = atol(xNode.getAttribute("maxIntermediateSize"));
+    if( NULL != xNode.getAttribute("mapThreads") )
+      tuningDesc_.numMapThreads = atoi(xNode.getAttribute("mapThreads"));
+    if( NULL != xNode.getAttribute("chunkBatchSize") )
+      tuningDesc_.chunkBatchSize = atoi(xNode.getAttribute("chunkBatchSize"));
+    if( NULL != xNode.getAttribute("dispatchThreads") )
+      tuningDesc_.numDispatchThreads = atoi(xNode.getAttribute("dispatchThreads"));
+    if( NULL != xNode.getAttribute("maxWorkers") )
+      tuningDesc_.maxWorkers = atoi(xNode.getAttribute("maxWorkers"));
+    if( NULL != xNode.getAttribute("scaleBacklog") )
+      tuningDesc_.scaleBacklog = atoi(xNode.getAttribute("scaleBacklog"));
+    if( NULL != xNode.getAttribute("chunkTaper") )
+      tuningDesc_.chunkTaperPercent = atoi(xNode.getAttribute("chunkTaper"));
+  }
+
+  // parse the ApplicationFiles section.  A File node carries its
+  // primary URL as text, plus optionally one <Replica> child per
+  // additional URL the same data is reachable through:
+  //   <File>gsiftp://door/data<Replica>/mnt/shared/data</Replica></File>
+  // Workers open whichever replica is cheapest from their node (see
+  // selectReplica_ in the worker's MapReduceBase.hpp).
   xNode = xMainNode.getChildNode("ApplicationFiles");
   int k=xNode.nChildNode("File");
-  for(int i=0; i<k; ++i) 
+  for(int i=0; i<k; ++i)
   {
     FileDescription fd;
     bool complete = true;
     XMLNode tmpNode = xNode.getChildNode("File", i);
     if( NULL != tmpNode.getText() ) {
        fd.name = tmpNode.getText();
+       fd.replicas.push_back(fd.name);
     }
     else complete = false;
+    int r=tmpNode.nChildNode("Replica");
+    for(int j=0; j<r; ++j) {
+      XMLNode repNode = tmpNode.getChildNode("Replica", j);
+      if( NULL != repNode.getText() ) {
+        if(fd.name.empty()) {
+           // no primary text - promote the first replica
+           fd.name = repNode.getText();
+           complete = true;
+        }
+        fd.replicas.push_back(repNode.getText());
+      }
+    }
     if(!complete) {
        std::string message("XML Parser: Incomplete ApplicationFile section found");
        std::cerr << "[Error] " << message << std::endl;
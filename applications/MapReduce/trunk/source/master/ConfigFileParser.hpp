@@ -38,9 +38,39 @@ namespace MapReduce {
          std::string hostArch;
       };
       
-      // Describes a data file
+      // Describes a data file.  replicas holds every URL the data is
+      // reachable through, primary (name) first; a file listed with a
+      // single URL has replicas = { name }.
       struct FileDescription {
          std::string name;
+         std::vector<std::string> replicas;
+      };
+
+      // Runtime tuning requested in the config file.  0 means "not
+      // set" - such values keep their defaults, or get autotuned when
+      // autotune is enabled (see utils/Tuning.hpp)
+      struct TuningDescription {
+         bool autotune;
+         int  numMaps;
+         long maxIntermediateSize;
+         int  numMapThreads;
+         int  chunkBatchSize;
+         int  numDispatchThreads;
+         //elastic pool: cap on agents, startup spawns included
+         //(0: no cap), and the unassigned-chunk depth above which
+         //more agents are added (0: scale policy off).  See
+         //ElasticPool.hpp
+         int  maxWorkers;
+         int  scaleBacklog;
+         //final input share (percent) mapped with shrinking batches
+         //(-1: not set, 0: taper off).  See batchTarget_ in
+         //HandleMaps.cpp
+         int  chunkTaperPercent;
+
+         TuningDescription()
+           : autotune(false), numMaps(0), maxIntermediateSize(0),
+             numMapThreads(0), chunkBatchSize(0), numDispatchThreads(0),
+             maxWorkers(0), scaleBacklog(0), chunkTaperPercent(-1) {}
       };
    
       // Parses a Task Farming config file 
@@ -53,6 +83,7 @@ namespace MapReduce {
          std::vector<FileDescription>   fileDescList_;
          std::string                    outputPrefix_;
          std::string                    masterAddress_;
+         TuningDescription              tuningDesc_;
          MapReduce::LogWriter          *log_;
         
 
@@ -67,6 +98,7 @@ namespace MapReduce {
          std::vector<FileDescription>   getFileList(void);
          std::string                    getOutputPrefix(void);
          std::string                    getMasterAddress();
+         TuningDescription              getTuning(void);
         
       };
    } //namespace Master
@@ -0,0 +1,189 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include "ElasticPool.hpp"
+#include "../utils/defines.hpp"
+
+namespace MapReduce {
+ ElasticPool::ElasticPool(std::vector<Master::BinaryDescription> binaryList,
+                          std::vector<Master::HostDescription> hostList,
+                          std::string uuid,
+                          std::string database,
+                          saga::url logURL,
+                          std::string outputPrefix,
+                          int maxWorkers,
+                          int scaleBacklog,
+                          LogWriter *log,
+                          Metrics *metrics)
+    : binaryList_(binaryList), hostList_(hostList), uuid_(uuid),
+      database_(database), logURL_(logURL), outputPrefix_(outputPrefix),
+      maxWorkers_(maxWorkers),
+      scaleBacklog_(scaleBacklog), log_(log), metrics_(metrics),
+      done_(false), spawned_(0), nextHost_(0), highStreak_(0)
+ {
+ }
+
+ ElasticPool::~ElasticPool()
+ {
+    //stop() is idempotent; make sure the sweeper never outlives us
+    stop();
+ }
+
+ void ElasticPool::start()
+ {
+    done_ = false;
+    thread_.reset(new boost::thread(
+       boost::bind(&ElasticPool::sweepLoop_, this)));
+ }
+
+ void ElasticPool::stop()
+ {
+    if(!thread_) {
+       return;
+    }
+    done_ = true;
+    thread_->join();
+    thread_.reset();
+ }
+
+ void ElasticPool::watch(boost::function<long (void)> backlog)
+ {
+    boost::mutex::scoped_lock lock(mutex_);
+    backlog_ = backlog;
+    highStreak_ = 0;
+ }
+
+ void ElasticPool::unwatch()
+ {
+    boost::mutex::scoped_lock lock(mutex_);
+    backlog_.clear();
+    highStreak_ = 0;
+ }
+
+ void ElasticPool::countSpawned(int n)
+ {
+    boost::mutex::scoped_lock lock(mutex_);
+    spawned_ += n;
+ }
+
+/*********************************************************
+ * sweepLoop_ runs on the background thread for the      *
+ * whole job.  Each pass costs one backlog probe; the    *
+ * interval keeps the policy from reacting to noise.     *
+ * ******************************************************/
+ void ElasticPool::sweepLoop_()
+ {
+    while(!done_) {
+       for(int s = 0; s < WORKER_SWEEP_INTERVAL && !done_; s++) {
+          sleep(1);
+       }
+       if(done_) {
+          return;
+       }
+       sweep_();
+    }
+ }
+
+/*********************************************************
+ * sweep_ applies the scale policy.  Membership is made  *
+ * visible by the WorkerRegistry at first contact on the *
+ * command channel; here, while the backlog stays at or  *
+ * above the threshold for consecutive sweeps, one more  *
+ * agent is launched.                                    *
+ * ******************************************************/
+ void ElasticPool::sweep_()
+ {
+    boost::function<long (void)> backlog;
+    int spawned;
+    {
+       boost::mutex::scoped_lock lock(mutex_);
+       backlog = backlog_;
+       spawned = spawned_;
+    }
+    if(scaleBacklog_ <= 0 || !backlog) {
+       highStreak_ = 0;
+       return;
+    }
+    long depth = backlog();
+    if(depth < scaleBacklog_) {
+       highStreak_ = 0;
+       return;
+    }
+    highStreak_++;
+    if(highStreak_ < 2) {
+       return;
+    }
+    if(maxWorkers_ > 0 && spawned >= maxWorkers_) {
+       return;
+    }
+    log_->write("Backlog at " + boost::lexical_cast<std::string>(depth)
+       + " for " + boost::lexical_cast<std::string>(highStreak_)
+       + " sweeps - adding an agent", LOGLEVEL_INFO);
+    if(spawnOne_()) {
+       boost::mutex::scoped_lock lock(mutex_);
+       spawned_++;
+       highStreak_ = 0;
+    }
+ }
+
+/*********************************************************
+ * spawnOne_ launches a single additional agent, using   *
+ * the same binary matching and argument recipe as       *
+ * spawnAgents_.  Hosts are tried round robin from where *
+ * the last launch left off; a host without a matching   *
+ * binary or with a failing endpoint is skipped, and the *
+ * attempt gives up after one full cycle.                *
+ * ******************************************************/
+ bool ElasticPool::spawnOne_()
+ {
+    for(std::vector<Master::HostDescription>::size_type h = 0;
+        h < hostList_.size(); h++) {
+       Master::HostDescription const &host =
+          hostList_[nextHost_++ % hostList_.size()];
+       std::string message("Launching elastic agent on host "
+                           + host.rmURL + "... ");
+       std::vector<Master::BinaryDescription>::const_iterator
+          binaryListIT = binaryList_.begin();
+       try {
+          while(binaryListIT != binaryList_.end()) {
+             if(host.hostArch == binaryListIT->targetArch
+             && host.hostOS   == binaryListIT->targetOS) {
+                saga::job::description jd;
+                std::vector<std::string> args;
+                args.push_back("--session");
+                args.push_back(uuid_);
+                args.push_back("--database");
+                args.push_back(database_);
+                args.push_back("--log");
+                args.push_back(logURL_.get_string());
+                args.push_back("--output");
+                args.push_back(outputPrefix_);
+                jd.set_attribute(saga::job::attributes::description_executable, binaryListIT->URL);
+                jd.set_vector_attribute(saga::job::attributes::description_arguments, args);
+                saga::job::service js(host.rmURL);
+                saga::job::job agentJob = js.create_job(jd);
+                agentJob.run();
+                log_->write(agentJob.get_job_id(), LOGLEVEL_INFO);
+                jobs_.push_back(agentJob);
+                message += "SUCCESS";
+                log_->write(message, LOGLEVEL_INFO);
+                metrics_->count("elastic.agents.spawned");
+                return true;
+             }
+             binaryListIT++;
+          }
+       }
+       catch(saga::exception const &e) {
+          message += e.what();
+          log_->write(message, LOGLEVEL_ERROR);
+       }
+    }
+    log_->write("Scale policy found no usable host - backing off",
+                LOGLEVEL_WARNING);
+    return false;
+ }
+} // namespace MapReduce
@@ -0,0 +1,91 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_ELASTIC_POOL_HPP
+#define MR_ELASTIC_POOL_HPP
+
+#include <string>
+#include <vector>
+#include <saga/saga.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include "ConfigFileParser.hpp"
+#include "../utils/LogWriter.hpp"
+#include "../utils/Metrics.hpp"
+
+namespace MapReduce {
+   /*********************************************************
+    * ElasticPool is the scale policy of a running job.     *
+    * Workers that appear after spawnAgents_ are absorbed   *
+    * without its help: dispatch is connection driven and   *
+    * the WorkerRegistry puts them on the books at first    *
+    * contact.  What the pool adds is supply: while the     *
+    * attached backlog supplier reports an unassigned depth *
+    * at or above scaleBacklog for consecutive sweeps, one  *
+    * extra agent is launched per sweep, round robin over   *
+    * the config host list, until maxWorkers agents exist   *
+    * in total (startup spawns included; 0 means no cap).   *
+    * A scaleBacklog of 0 disables the policy.              *
+    * ******************************************************/
+   class ElasticPool {
+     public:
+      ElasticPool(std::vector<Master::BinaryDescription> binaryList,
+                  std::vector<Master::HostDescription> hostList,
+                  std::string uuid,
+                  std::string database,
+                  saga::url logURL,
+                  std::string outputPrefix,
+                  int maxWorkers,
+                  int scaleBacklog,
+                  LogWriter *log,
+                  Metrics *metrics);
+     ~ElasticPool();
+      //Spawns the background sweeper
+      void start();
+      //Joins the sweeper; call once the last phase is done
+      void stop();
+      //Attaches the running phase's backlog supplier; the scale
+      //policy only acts while one is attached
+      void watch(boost::function<long (void)> backlog);
+      //Detaches the supplier, before it dangles with its phase
+      void unwatch();
+      //Folds agents launched elsewhere (the startup spawn) into
+      //the maxWorkers accounting
+      void countSpawned(int n);
+     private:
+      void sweepLoop_();
+      void sweep_();
+      bool spawnOne_();
+
+      std::vector<Master::BinaryDescription> binaryList_;
+      std::vector<Master::HostDescription>   hostList_;
+      std::string              uuid_;
+      std::string              database_;
+      saga::url                logURL_;
+      std::string              outputPrefix_;
+      int                      maxWorkers_;
+      int                      scaleBacklog_;
+      LogWriter               *log_;
+      Metrics                 *metrics_;
+      bool                     done_;
+      //mutex_ guards backlog_ and spawned_ against watch/unwatch
+      //and countSpawned calls from the phase threads
+      boost::mutex             mutex_;
+      boost::shared_ptr<boost::thread> thread_;
+      boost::function<long (void)>     backlog_;
+      int                      spawned_;
+      //round-robin cursor over hostList_, so repeated launches
+      //spread over the endpoints instead of hammering the first
+      std::vector<Master::HostDescription>::size_type nextHost_;
+      //consecutive sweeps with backlog >= scaleBacklog_; one
+      //spike is noise, a streak means the pool is undersized
+      int                      highStreak_;
+      //keeps the agent job objects alive (see spawnAgents_)
+      std::vector<saga::job::job> jobs_;
+   };
+} //Namespace MapReduce
+
+#endif // MR_ELASTIC_POOL_HPP
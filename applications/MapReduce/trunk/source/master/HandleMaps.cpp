@@ -1,28 +1,49 @@
 //  Copyright (c) 2008 Michael Miceli and Christopher Miceli
-// 
-//  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
+#include <sstream>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
 #include "HandleMaps.hpp"
 #include "../utils/defines.hpp"
+#include "../utils/ReplicaSpec.hpp"
+#include "../utils/Tuning.hpp"
+#include "../../../../common/wire.hpp"
 
 /*********************************************************
  * The HandleMaps class handles all the details of       *
  * assigning map tasks to running workers.               *
  ********************************************************/
 namespace MapReduce {
- HandleMaps::HandleMaps(std::vector<saga::url> &chunks, 
+ HandleMaps::HandleMaps(std::vector<std::string> &chunks,
                         saga::url serverURL,
-                        LogWriter *log) 
-    : serverURL_(serverURL), log_(log)
+                        WorkerRegistry *registry,
+                        LogWriter *log,
+                        Metrics *metrics)
+    : registry_(registry), serverURL_(serverURL), log_(log),
+      metrics_(metrics), done_(false), taperLogged_(false)
  {
-    std::vector<saga::url>::iterator chunksIT = chunks.begin();
-    std::vector<saga::url>::iterator end      = chunks.end();
+    metrics_->count("map.chunks.total", chunks.size());
+    std::vector<std::string>::iterator chunksIT = chunks.begin();
+    std::vector<std::string>::iterator end      = chunks.end();
     while(chunksIT != end) {
-       unassigned_.push_back(chunksIT->get_string());
+       chunks_.intern(*chunksIT);
+       //index the chunk under every replica's host - any node with
+       //a copy counts as local for assignment purposes
+       std::vector<std::string> urls = replica::split(*chunksIT);
+       for(std::vector<std::string>::size_type u = 0; u < urls.size(); u++) {
+          try {
+             hostIndex_[saga::url(urls[u]).get_host()].push_back(*chunksIT);
+          }
+          catch(saga::exception const &) {
+             //an unparsable replica URL fails at open time on the
+             //worker, with a better message than we could give here
+          }
+       }
        ++chunksIT;
     }
-    totalChunks_ = unassigned_.size();
     try
     {
        service_ = new saga::stream::server(serverURL_);
@@ -38,218 +59,493 @@ namespace MapReduce {
     delete service_;
  }
 /*********************************************************
- * assignMaps is the only public function, it keeps iter-*
- * ating through chunks and assigning them to running    *
- * workers until all chunks have been finished mapping.  *
+ * assignMaps is the only public function.  It starts a  *
+ * listener thread that accepts worker connections and a *
+ * pool of dispatcher threads that each hold a worker    *
+ * conversation, so hundreds of workers can be assigned  *
+ * chunks concurrently instead of one at a time.         *
  * ******************************************************/
  bool HandleMaps::assignMaps() {
-    //Until the number of finished chunks
-    //equals the number of total chunks
-    while(totalChunks_ != finished_.size()) {
-       issue_command_();
+    done_ = false;
+    boost::thread listener(boost::bind(&HandleMaps::listen_, this));
+    boost::thread detector(boost::bind(&HandleMaps::failureDetector_, this));
+    boost::thread_group dispatchers;
+    for(int i = 0; i < tuning::numDispatchThreads(); i++) {
+       dispatchers.create_thread(boost::bind(&HandleMaps::dispatch_, this));
     }
+    dispatchers.join_all();
+    //Dispatchers only exit once every chunk is finished.  Closing
+    //the service unblocks the listener from serve().
+    service_->close();
+    listener.join();
+    detector.join();
     return true;
  }
 
 /*********************************************************
- * issue_command_ finds and idle worker or finished      *
- * worker and tries to assign them a chunk.  If thye are *
- * finished, record their results in the finished_ vector*
+ * unassignedDepth reports how many chunks still wait on *
+ * the unassigned queue.  The scale policy samples it    *
+ * while assignMaps() runs (see ElasticPool.hpp).        *
+ * ******************************************************/
+ long HandleMaps::unassignedDepth() {
+    boost::mutex::scoped_lock lock(chunkMutex_);
+    return static_cast<long>(chunks_.unassignedCount());
+ }
+
+/*********************************************************
+ * listen_ runs in its own thread.  It blocks in serve() *
+ * and appends every accepted worker connection to the   *
+ * waiting_ queue for the dispatcher pool.               *
  * ******************************************************/
- void HandleMaps::issue_command_() {
-    bool assigned = false; //Describes status of current chunk (file)
-    while(assigned == false) {
+ void HandleMaps::listen_() {
+    while(!done_) {
        try {
           saga::stream::stream worker = service_->serve();
-          std::string message("Established connection to ");
-          message += worker.get_url().get_string();
-          log_->write(message, LOGLEVEL_INFO);
+          metrics_->count("map.connections.accepted");
+          boost::mutex::scoped_lock lock(queueMutex_);
+          waiting_.push_back(worker);
+          queueNotEmpty_.notify_one();
+       }
+       catch(saga::exception const & e) {
+          //serve() throws when assignMaps closes the service to
+          //shut us down, anything else is worth logging.
+          if(!done_) {
+             log_->write(std::string(e.what()), LOGLEVEL_ERROR);
+          }
+       }
+    }
+ }
+
+/*********************************************************
+ * dispatch_ is the body of one pool thread.  It pops    *
+ * worker connections off the waiting_ queue and serves  *
+ * them until all chunks have finished mapping.          *
+ * ******************************************************/
+ void HandleMaps::dispatch_() {
+    while(!allFinished_()) {
+       saga::stream::stream worker;
+       {
+          boost::mutex::scoped_lock lock(queueMutex_);
+          unparkDue_();
+          while(waiting_.empty()) {
+             if(allFinished_()) {
+                queueNotEmpty_.notify_all();
+                return;
+             }
+             boost::xtime xt;
+             boost::xtime_get(&xt, boost::TIME_UTC);
+             xt.sec += 1;
+             queueNotEmpty_.timed_wait(lock, xt);
+             unparkDue_();
+          }
+          worker = waiting_.front();
+          waiting_.pop_front();
+       }
+       high_resolution_timer serveTimer;
+       ServeResult result = serve_worker_(worker);
+       metrics_->observe("map.serve_latency", serveTimer.elapsed());
+       //Connections are persistent: productive workers go straight
+       //back on the queue, idle ones are parked for a moment, dead
+       //ones are forgotten
+       boost::mutex::scoped_lock lock(queueMutex_);
+       if(result == SERVE_PRODUCTIVE) {
+          waiting_.push_back(worker);
+          queueNotEmpty_.notify_one();
+       }
+       else if(result == SERVE_PARKED) {
+          metrics_->count("map.connections.parked");
+          parked_.push_back(std::make_pair(std::time(0), worker));
+       }
+       else {
+          metrics_->count("map.connections.dropped");
+       }
+    }
+    done_ = true;
+    queueNotEmpty_.notify_all();
+ }
+
+/*********************************************************
+ * unparkDue_ moves parked connections whose re-poll     *
+ * pause has elapsed back onto the waiting queue.  The   *
+ * caller must hold queueMutex_.                         *
+ * ******************************************************/
+ void HandleMaps::unparkDue_() {
+    std::time_t now = std::time(0);
+    while(!parked_.empty() && now - parked_.front().first >= 1) {
+       waiting_.push_back(parked_.front().second);
+       parked_.pop_front();
+    }
+ }
 
-          //Ask worker for state
-          worker.write(saga::buffer(MASTER_QUESTION_STATE, 6));
-          char buff[255];
-          saga::ssize_t read_bytes = worker.read(saga::buffer(buff));
-          std::string state(buff, read_bytes);
+/*********************************************************
+ * allFinished_ tests whether every chunk has been       *
+ * mapped, under the chunk lock.                         *
+ * ******************************************************/
+ bool HandleMaps::allFinished_() {
+    boost::mutex::scoped_lock lock(chunkMutex_);
+    return chunks_.allFinished();
+ }
+
+/*********************************************************
+ * serve_worker_ holds one conversation with a connected *
+ * worker: idle workers are handed a chunk, finished     *
+ * workers have their results recorded.  The shared      *
+ * chunk state is only touched under chunkMutex_.        *
+ * ******************************************************/
+ HandleMaps::ServeResult HandleMaps::serve_worker_(saga::stream::stream worker) {
+    try {
+       std::string message("Established connection to ");
+       message += worker.get_url().get_string();
+       log_->write(message, LOGLEVEL_INFO);
+
+       //Ask worker for state
+       wire::receiver rx;
+       wire::send(worker, MSG_QUESTION_STATE);
+       wire::expect(worker, rx, MSG_STATE);
+       std::string state(rx.part());
+
+       message.clear();
+       message = "Worker: " + worker.get_url().get_string() + " has state " + state;
+       log_->write(message, LOGLEVEL_INFO);
+
+       if(state == WORKER_STATE_IDLE)
+       {
+          if(allFinished_())
+          {
+             //Prevent unneccessary work assignments
+             wire::send(worker, MSG_REQUEST_IDLE);
+             if(!rx.recv(worker) || rx.type() != MSG_ACKNOLEDGE)
+             {
+                log_->write(std::string("Misbehaving worker!"), LOGLEVEL_WARNING);
+             }
+             return SERVE_DROP;
+          }
+          //ask where their advert is - before drawing the batch, so
+          //the batch can be sized from this worker's observed rate
+          wire::send(worker, MSG_QUESTION_ADVERT);
+          wire::expect(worker, rx, MSG_ADVERT);
+          saga::url advert = saga::url(rx.part());
+          //First contact puts the worker on the session's books
+          //(see WorkerRegistry.hpp)
+          registry_->add(advert.get_string());
+          std::string owner(ownerKey_(advert.get_string()));
 
           message.clear();
-          message = "Worker: " + worker.get_url().get_string() + " has state " + state;
+          message += worker.get_url().get_string();
+          message += " <==> " + advert.get_string();
+          message += " ... ";
           log_->write(message, LOGLEVEL_INFO);
 
-          if(state == WORKER_STATE_IDLE)
+          //Grab a batch of chunks so the whole conversation is
+          //amortized over several assignments.  The batch is full
+          //sized for the bulk of the job and tapers near the end
+          //(see batchTarget_).  Falls back to a single re-issue
+          //candidate once the queue drains.
+          std::vector<std::string> batch;
+          std::string file;
+          std::string workerHost(worker.get_url().get_host());
           {
-             if(finished_.size() == totalChunks_)
-             {
-                //Prevent unneccessary work assignments
-                worker.write(saga::buffer(MASTER_REQUEST_IDLE, 5));
-                saga::ssize_t read_bytes = worker.read(saga::buffer(buff));
-                if(std::string(buff, read_bytes) != WORKER_RESPONSE_ACKNOLEDGE)
-                {
-                   log_->write(std::string("Misbehaving worker!"), LOGLEVEL_WARNING);
-                }
-                return;
+             boost::mutex::scoped_lock lock(chunkMutex_);
+             std::size_t target = batchTarget_(owner);
+             //Prefer chunks whose file lives on the worker's own
+             //host: local reads instead of full network copies
+             std::string local;
+             while(batch.size() < target &&
+                   popLocal_(workerHost, local)) {
+                chunks_.markAssigned(local);
+                batch.push_back(local);
+                metrics_->count("map.chunks.assigned_local");
              }
-             std::string file(getCandidate_());
-             //Worker is idle
-             message.clear();
-             message = "Attempting to issue worker ";
-             message += worker.get_url().get_string();
-             message += " to map " + file;
-             message += " ...";
-             log_->write(message, LOGLEVEL_INFO);
-
-             //ask where their advert is
-             worker.write(saga::buffer(MASTER_QUESTION_ADVERT, 7));
-             memset(buff, 0, 255);
-             read_bytes = worker.read(saga::buffer(buff));
-             saga::url advert = saga::url(std::string(buff, read_bytes));
-
-             message.clear();
-             message += worker.get_url().get_string();
-             message += " <==> " + std::string(buff);
-             message += " ... ";
-             log_->write(message, LOGLEVEL_INFO); 
-
-             //Tell worker about data
-             worker.write(saga::buffer(WORKER_COMMAND_MAP, 3));
-             memset(buff, 0, 255);
-             read_bytes = worker.read(saga::buffer(buff));
-             if(std::string(buff, read_bytes) == WORKER_RESPONSE_ACKNOLEDGE)
-             {
-                worker.write(saga::buffer(WORKER_CHUNK, 5));
-                memset(buff, 0, 255);
-                read_bytes = worker.read(saga::buffer(buff));
-                if(std::string(buff, read_bytes) == WORKER_RESPONSE_ACKNOLEDGE)
-                {
-                   worker.write(saga::buffer(file, file.size()));
-                   memset(buff, 0, 255);
-                   read_bytes = worker.read(saga::buffer(buff));
-                   if(std::string(buff, read_bytes) == WORKER_RESPONSE_ACKNOLEDGE)
-                   {
-                      //If not in assigned, add it
-                      std::vector<std::string>::iterator end = assigned_.end();
-                      bool found = false;
-                      for(std::vector<std::string>::iterator assigned_IT = assigned_.begin();
-                          assigned_IT != end;
-                          ++assigned_IT)
-                      {
-                         if(file == *assigned_IT)
-                         {
-                            found = true;
-                            break;
-                         }
-                      }
-                      if(found == false)
-                      {
-                         //Not previously assigned
-                         assigned_.push_back(file);
-                      }
-                      //Remove from unassigned if there
-                      end = unassigned_.end();
-                      for(std::vector<std::string>::iterator unassigned_IT = unassigned_.begin();
-                          unassigned_IT != end;
-                          ++unassigned_IT)
-                      {
-                         if(file == *unassigned_IT)
-                         {
-                            //already removed from unassigned
-                            unassigned_.erase(unassigned_IT);
-                            break;
-                         }
-                      }
-                   }
+             while(batch.size() < target && chunks_.hasUnassigned()) {
+                std::string candidate(chunks_.firstUnassigned());
+                chunks_.markAssigned(candidate);
+                batch.push_back(candidate);
+             }
+             if(batch.empty()) {
+                //Queue drained: speculatively duplicate the worst
+                //straggler if it is overdue against the completion
+                //time estimated from finished chunks
+                std::string straggler;
+                if(chunks_.speculativeCandidate(straggler)) {
+                   chunks_.touchAssignment(straggler);
+                   batch.push_back(straggler);
+                   metrics_->count("map.chunks.speculative");
                 }
              }
-             else
-             {
-                message = std::string("Worker did not accept chunk!");
-                log_->write(message, LOGLEVEL_WARNING);
-                break;
+             if(!batch.empty() && rateOf_[owner].firstAssign == 0) {
+                //first assignment starts this worker's rate clock
+                rateOf_[owner].firstAssign = std::time(0);
              }
+          }
+          if(batch.empty()) {
+             //Nothing worth duplicating right now, let the worker
+             //come back later
+             wire::send(worker, MSG_REQUEST_IDLE);
+             rx.recv(worker);
+             return SERVE_PARKED;
+          }
+          file = batch[0];
+          for(std::vector<std::string>::size_type b = 1; b < batch.size(); b++) {
+             file += " " + batch[b];
+          }
+          //Worker is idle
+          message.clear();
+          message = "Attempting to issue worker ";
+          message += worker.get_url().get_string();
+          message += " to map " + file;
+          message += " ...";
+          log_->write(message, LOGLEVEL_INFO);
 
-             message.clear();
-             message += "Success: ";
-             message += advert.get_string() + " is comparing chunk ";
-             message += file;
-             log_->write(message, LOGLEVEL_INFO);
-
-             assigned = true;
+          //The whole assignment - command plus every chunk of the
+          //batch as one part each - is a single framed write with a
+          //single ack back
+          wire::message assign(MSG_ASSIGN_MAP);
+          for(std::vector<std::string>::size_type b = 0; b < batch.size(); b++) {
+             assign.add(batch[b]);
           }
-          else if(state == WORKER_STATE_DONE_MAP)
+          assign.send(worker);
+          if(rx.recv(worker) && rx.type() == MSG_ACKNOLEDGE)
           {
-             worker.write(saga::buffer(MASTER_QUESTION_RESULT, 7));
-             memset(buff, 0, 255);
-             read_bytes = worker.read(saga::buffer(buff));
-             std::string result(buff, read_bytes);
-             worker.write(saga::buffer(MASTER_REQUEST_IDLE, 5));
-
-             message.clear();
-             message += "Worker ";
-             message += worker.get_url().get_string() + " finished chunk ";
-             message += result;
-             log_->write(message, LOGLEVEL_INFO);
-
-             //If in assigned, remove it
-             std::vector<std::string>::iterator end = assigned_.end();
-             for(std::vector<std::string>::iterator assigned_IT = assigned_.begin();
-                 assigned_IT != end;
-                 ++assigned_IT)
-             {
-                if(result == *assigned_IT)
-                {
-                   assigned_.erase(assigned_IT);
-                   break;
-                }
+             boost::mutex::scoped_lock lock(chunkMutex_);
+             //Moves the chunks out of the unassigned queue
+             //into the assigned set (no-op on re-issue) and
+             //remembers which worker holds them
+             for(std::vector<std::string>::size_type b = 0; b < batch.size(); b++) {
+                chunks_.markAssigned(batch[b]);
+                ownerOf_[batch[b]] = owner;
              }
+          }
+          else
+          {
+             message = std::string("Worker did not accept chunk!");
+             log_->write(message, LOGLEVEL_WARNING);
+             return SERVE_PARKED;
+          }
 
-             //Make sure not already inserted into finished list
-             end = finished_.end();
-             bool found = false;
-             for(std::vector<std::string>::iterator finished_IT= finished_.begin();
-                 finished_IT != end;
-                 ++finished_IT)
-             {
-                if(result == *finished_IT)
-                {
-                   found = true;
-                   break;
+          message.clear();
+          message += "Success: ";
+          message += advert.get_string() + " is comparing chunk ";
+          message += file;
+          log_->write(message, LOGLEVEL_INFO);
+          metrics_->count("map.chunks.assigned", batch.size());
+          return SERVE_PRODUCTIVE;
+       }
+       else if(state == WORKER_STATE_DONE_MAP)
+       {
+          //Workers answer with all finished chunk names of the
+          //batch as one part each in a single frame
+          wire::send(worker, MSG_QUESTION_RESULT);
+          wire::expect(worker, rx, MSG_RESULT);
+          wire::send(worker, MSG_REQUEST_IDLE);
+
+          message.clear();
+          message += "Worker ";
+          message += worker.get_url().get_string() + " finished ";
+          message += boost::lexical_cast<std::string>(rx.parts());
+          message += " chunk(s)";
+          log_->write(message, LOGLEVEL_INFO);
+
+          boost::mutex::scoped_lock lock(chunkMutex_);
+          //Drops each chunk from the assigned set and records the
+          //completion (duplicate completions are absorbed)
+          for(std::size_t p = 0; p < rx.parts(); p++) {
+             std::string one(rx.part(p));
+             if(!one.empty()) {
+                chunks_.markFinished(one);
+                metrics_->count("map.chunks.finished");
+                //feed the owner's observed map rate (see batchTarget_)
+                boost::unordered_map<std::string, std::string>::iterator
+                   ownerIT = ownerOf_.find(one);
+                if(ownerIT != ownerOf_.end()) {
+                   rateOf_[ownerIT->second].finished++;
                 }
              }
-             if(found == false) {
-                finished_.push_back(result);
-             }
           }
+          return SERVE_PRODUCTIVE;
        }
-       catch(saga::exception const & e) {
-          std::string message(e.what());
-          log_->write(message, LOGLEVEL_ERROR);
+    }
+    catch(wire::error const & e) {
+       //A framing error means the stream is out of sync - drop the
+       //connection, the worker will reconnect
+       log_->write(std::string(e.what()), LOGLEVEL_ERROR);
+       return SERVE_DROP;
+    }
+    catch(saga::exception const & e) {
+       std::string message(e.what());
+       log_->write(message, LOGLEVEL_ERROR);
+       return SERVE_DROP;
+    }
+    return SERVE_PARKED;
+ }
+
+/*********************************************************
+ * failureDetector_ runs in its own thread.  It sweeps   *
+ * the keepalive timestamps the workers publish through  *
+ * updateStatus_, declares a worker dead once its        *
+ * ATTR_LAST_SEEN is older than WORKER_TIMEOUT, and      *
+ * returns the chunks it held to the unassigned queue,   *
+ * so a crash costs seconds instead of waiting for a     *
+ * speculative re-issue to cover the loss.  The sweep    *
+ * walks the registry's membership - only a worker on    *
+ * the books can hold chunks - so no directory listing   *
+ * is involved, just one attribute read per member.      *
+ * ******************************************************/
+ void HandleMaps::failureDetector_() {
+    while(!done_) {
+       //sweep every few seconds, but notice shutdown quickly
+       for(int s = 0; s < WORKER_SWEEP_INTERVAL && !done_; s++) {
+          sleep(1);
+       }
+       if(done_) {
+          break;
+       }
+       std::time_t now = std::time(0);
+       std::vector<saga::url> workers = registry_->workers();
+       for(std::vector<saga::url>::size_type w = 0; w < workers.size(); w++) {
+          std::string key(ownerKey_(workers[w].get_string()));
+          if(deadWorkers_.find(key) != deadWorkers_.end()) {
+             continue;
+          }
+          try {
+             saga::advert::directory worker(workers[w],
+                                            saga::advert::ReadWrite);
+             std::time_t lastSeen = boost::lexical_cast<std::time_t>(
+                worker.get_attribute(ATTR_LAST_SEEN));
+             if(now - lastSeen <= WORKER_TIMEOUT) {
+                continue;
+             }
+          }
+          catch(saga::exception const &) {
+             //A transient advert error is no reason to condemn
+             //the worker; try again next sweep
+             continue;
+          }
+          catch(boost::bad_lexical_cast const &) {
+             continue;
+          }
+          deadWorkers_.insert(key);
+          log_->write("Worker " + key +
+                      " missed its keepalive, reclaiming its chunks",
+                      LOGLEVEL_WARNING);
+          metrics_->count("map.workers.declared_dead");
+          boost::mutex::scoped_lock lock(chunkMutex_);
+          boost::unordered_map<std::string, std::string>::iterator
+             ownerIT = ownerOf_.begin();
+          while(ownerIT != ownerOf_.end()) {
+             if(ownerIT->second == key &&
+                chunks_.releaseAssignment(ownerIT->first)) {
+                metrics_->count("map.chunks.recovered");
+                ownerIT = ownerOf_.erase(ownerIT);
+             }
+             else {
+                ++ownerIT;
+             }
+          }
        }
     }
  }
 
 /*********************************************************
- * getCandidate_ tries to find a chunk that is not       *
- * finished while trying to give priority to chunks that *
- * have been least recently assigned.                    *
+ * ownerKey_ reduces a worker advert URL to its last     *
+ * path component (the worker uuid), so the key matches  *
+ * no matter which base URL spelling reported it.        *
  * ******************************************************/
- std::string HandleMaps::getCandidate_() {
-    if(unassigned_.size() > 0)
-    {
-       return unassigned_[0];
+ std::string HandleMaps::ownerKey_(std::string const &advertURL) {
+    std::string key(advertURL);
+    while(!key.empty() && key[key.size() - 1] == '/') {
+       key.erase(key.size() - 1);
     }
-    else if(assigned_.size() > 0)
-    {
-       return assigned_[rand() % assigned_.size()];
+    std::string::size_type slash = key.rfind('/');
+    return slash == std::string::npos ? key : key.substr(slash + 1);
+ }
+
+/*********************************************************
+ * batchTarget_ sizes the batch handed to one worker.    *
+ * For the bulk of the job every batch is full sized     *
+ * (tuning::chunkBatchSize), keeping assignment          *
+ * conversations rare; once the unassigned queue falls   *
+ * inside the configured taper window the remaining      *
+ * chunks are spread over the workers in proportion to   *
+ * the map rates observed from their completions, so     *
+ * every worker's last batch lands at about the same     *
+ * time and the tail is bounded by a small batch instead *
+ * of a large one.  The caller must hold chunkMutex_.    *
+ * ******************************************************/
+ std::size_t HandleMaps::batchTarget_(std::string const &owner) {
+    std::size_t full = tuning::chunkBatchSize();
+    int taper = tuning::chunkTaperPercent();
+    std::size_t left = chunks_.unassignedCount();
+    if(taper <= 0 || left == 0 ||
+       left * 100 > chunks_.size() * (std::size_t)taper) {
+       return full;
     }
-    else if(finished_.size() > 0)
-    {
-       //No one should be asking!
-       return finished_[rand() % finished_.size()];
+    if(!taperLogged_) {
+       taperLogged_ = true;
+       log_->write("Entering batch taper window with " +
+                   boost::lexical_cast<std::string>(left) +
+                   " chunk(s) left", LOGLEVEL_INFO);
     }
-    else
-    {
-       std::cerr << "Stop asking for chunks!" << std::endl;
-       APPLICATION_ABORT;
+    std::size_t workers = registry_->size();
+    if(workers == 0) {
+       workers = 1;
     }
+    //this worker's share of what is left: proportional to its
+    //observed rate when it has finished anything yet, an even
+    //split otherwise
+    std::time_t now = std::time(0);
+    double myRate = 0, sumRates = 0;
+    boost::unordered_map<std::string, WorkerRate>::iterator it;
+    for(it = rateOf_.begin(); it != rateOf_.end(); ++it) {
+       if(it->second.firstAssign == 0 || it->second.finished == 0) {
+          continue;
+       }
+       std::time_t elapsed = now - it->second.firstAssign;
+       double rate = (double)it->second.finished
+                   / (double)(elapsed > 0 ? elapsed : 1);
+       sumRates += rate;
+       if(it->first == owner) {
+          myRate = rate;
+       }
+    }
+    std::size_t target;
+    if(myRate > 0 && sumRates > 0) {
+       target = (std::size_t)((double)left * myRate / sumRates);
+    }
+    else {
+       target = left / workers;
+    }
+    if(target < 1) {
+       target = 1;
+    }
+    if(target > full) {
+       target = full;
+    }
+    metrics_->count("map.batch.tapered");
+    return target;
+ }
+
+/*********************************************************
+ * popLocal_ pops the next chunk resident on the given   *
+ * host that is still unassigned.  Stale index entries   *
+ * (already assigned or finished) are discarded along    *
+ * the way.  The caller must hold chunkMutex_.           *
+ * ******************************************************/
+ bool HandleMaps::popLocal_(std::string const &host, std::string &chunk) {
+    boost::unordered_map<std::string, std::deque<std::string> >::iterator
+       it = hostIndex_.find(host);
+    if(it == hostIndex_.end()) {
+       return false;
+    }
+    std::deque<std::string> &local = it->second;
+    while(!local.empty()) {
+       std::string candidate(local.front());
+       local.pop_front();
+       if(chunks_.isUnassigned(candidate)) {
+          chunk = candidate;
+          return true;
+       }
+    }
+    return false;
  }
-} // namespace MapReduce
 
+} // namespace MapReduce
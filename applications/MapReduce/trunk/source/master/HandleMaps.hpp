@@ -1,6 +1,6 @@
 //  Copyright (c) 2008 Michael Miceli and Christopher Miceli
-// 
-//  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
 #ifndef MR_HANDLE_MAPS_HPP
@@ -8,30 +8,98 @@
 
 #include <string>
 #include <vector>
+#include <deque>
+#include <set>
+#include <utility>
+#include <ctime>
 #include <saga/saga.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
 #include "../utils/LogWriter.hpp"
+#include "../utils/ChunkTable.hpp"
+#include "../utils/Metrics.hpp"
+#include "WorkerRegistry.hpp"
 #include "version.hpp"
 
 namespace MapReduce {
    class HandleMaps {
      public:
-      HandleMaps(std::vector<saga::url> &chunks,
+      //chunks are replica specs (see utils/ReplicaSpec.hpp)
+      HandleMaps(std::vector<std::string> &chunks,
                  saga::url serverURL,
-                 LogWriter *log);
+                 WorkerRegistry *registry,
+                 LogWriter *log,
+                 Metrics *metrics);
      ~HandleMaps();
       bool assignMaps();
+      //Chunks still waiting to be handed out; safe to call from
+      //other threads while assignMaps() runs (the scale policy's
+      //backlog supplier, see ElasticPool.hpp)
+      long unassignedDepth();
 
      private:
-      void issue_command_();
-      std::string getCandidate_();
+      //Outcome of one conversation, drives connection re-queueing
+      enum ServeResult {
+         SERVE_DROP       = 0, //connection is dead, forget it
+         SERVE_PRODUCTIVE = 1, //work moved, talk again right away
+         SERVE_PARKED     = 2  //nothing to do, re-poll after a pause
+      };
+
+      void listen_();
+      void dispatch_();
+      void failureDetector_();
+      void unparkDue_();
+      static std::string ownerKey_(std::string const &advertURL);
+      std::size_t batchTarget_(std::string const &owner);
+      ServeResult serve_worker_(saga::stream::stream worker);
+      bool popLocal_(std::string const &host, std::string &chunk);
+      bool allFinished_();
 
       saga::stream::server    *service_;
-      std::vector<std::string> unassigned_;
-      std::vector<std::string> assigned_;
-      std::vector<std::string> finished_;
+      ChunkTable               chunks_;
+      //Unassigned chunks indexed by host; a chunk with several
+      //replicas appears under every host holding a copy, so a
+      //worker is preferably handed chunks local to its node.
+      //Entries may be stale; chunks_ remains the source of truth.
+      boost::unordered_map<std::string, std::deque<std::string> > hostIndex_;
+      //Which worker (advert key) currently holds each assigned
+      //chunk, so a dead worker's chunks can be reclaimed.  Guarded
+      //by chunkMutex_; a re-assignment simply overwrites the owner.
+      boost::unordered_map<std::string, std::string> ownerOf_;
+      //Observed map progress per worker (advert key), fed by the
+      //completions it reports: rate = finished / (now - firstAssign).
+      //batchTarget_ reads it to size tapered batches.  Guarded by
+      //chunkMutex_.
+      struct WorkerRate {
+         std::time_t firstAssign;
+         std::size_t finished;
+         WorkerRate() : firstAssign(0), finished(0) {}
+      };
+      boost::unordered_map<std::string, WorkerRate> rateOf_;
+      WorkerRegistry          *registry_;
+      //Workers already declared dead, touched only by the failure
+      //detector thread
+      std::set<std::string>    deadWorkers_;
       saga::url                serverURL_;
       LogWriter               *log_;
-      std::vector<std::string>::size_type totalChunks_;
+      Metrics                 *metrics_;
+
+      //The listener thread accepts worker connections and queues
+      //them on waiting_, the dispatcher pool drains the queue so
+      //many workers can hold a conversation at the same time.
+      //chunkMutex_ guards chunks_ and queueMutex_ guards waiting_.
+      std::deque<saga::stream::stream> waiting_;
+      //Persistent connections with nothing to do wait here until
+      //their re-poll time comes around
+      std::deque<std::pair<std::time_t, saga::stream::stream> > parked_;
+      boost::mutex             chunkMutex_;
+      boost::mutex             queueMutex_;
+      boost::condition         queueNotEmpty_;
+      bool                     done_;
+      //One-shot flag so entering the taper window is logged once
+      bool                     taperLogged_;
    };
 } //Namespace MapReduce
 
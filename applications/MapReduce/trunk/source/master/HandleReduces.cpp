@@ -1,6 +1,9 @@
 #include "HandleReduces.hpp"
+#include <sstream>
 #include <boost/lexical_cast.hpp>
+#include "ShuffleAhead.hpp"
 #include "../utils/defines.hpp"
+#include "../../../../common/wire.hpp"
 
 /*********************************************************
  * HandleReduces tries to group together the proper files*
@@ -11,12 +14,24 @@ namespace MapReduce
  // fileCount is the total number of files possibly outputted by
  // the map function (NUM_MAPS)
  HandleReduces::HandleReduces(int fileCount,
-                              saga::advert::directory workerDir, 
+                              WorkerRegistry *registry,
                               saga::url serverURL,
-                              LogWriter *log)
-    : fileCount_(fileCount), workerDir_(workerDir), 
-      serverURL_(serverURL), log_(log)
+                              LogWriter *log,
+                              Metrics *metrics,
+                              ShuffleAhead *shuffle)
+    : fileCount_(fileCount), registry_(registry),
+      serverURL_(serverURL), log_(log), metrics_(metrics)
  {
+    metrics_->count("reduce.partitions.total", fileCount);
+    if(shuffle != NULL) {
+       //The map-phase sweeper already grouped every committed
+       //output; groupFiles_ only runs for partitions it missed
+       groupCache_ = shuffle->groups();
+       std::string message("Shuffle-ahead pre-grouped ");
+       message += boost::lexical_cast<std::string>(groupCache_.size());
+       message += " partition(s)";
+       log_->write(message, LOGLEVEL_INFO);
+    }
     try
     {
        service_ = new saga::stream::server(serverURL_);
@@ -25,10 +40,11 @@ namespace MapReduce
        std::cerr << "saga::execption caught: " << e.what () << std::endl;
     }
     currentCount = 0;
-    workers_ = workerDir_.list("*");
-    while(workers_.size() == 0) {
+    //Membership comes from the registry, not from listing the
+    //workers directory; a worker on the books has already spoken
+    //on the command channel
+    while(registry_->size() == 0) {
        sleep(1);
-       workers_ = workerDir_.list("*");
     }
  }
 
@@ -41,9 +57,12 @@ namespace MapReduce
  * to assign reduce files to idle workers                *
  * ******************************************************/
  bool HandleReduces::assignReduces() {
-    while(finished_.size() != (unsigned)fileCount_) {
+    while(finished_.finishedCount() != (unsigned)fileCount_) {
        issue_command_();
     }
+    //Every partition reported in, so every fingerprint line is the
+    //final one for its file - publish the manifest
+    publishChecksums_();
     return true;
  }
 /*********************************************************
@@ -58,19 +77,25 @@ namespace MapReduce
       try {
          int mode = saga::advert::Create | saga::advert::ReadWrite;
          saga::stream::stream worker = service_->serve();
+         high_resolution_timer serveTimer;
          std::string message("Established connection to ");
          message += worker.get_url().get_string();
          log_->write(message, LOGLEVEL_INFO);
 
          //Ask worker for state
-         worker.write(saga::buffer(MASTER_QUESTION_STATE, 6));
-         char buff[255];
-         saga::ssize_t read_bytes = worker.read(saga::buffer(buff));
-         std::string state(buff, read_bytes);
+         wire::receiver rx;
+         wire::send(worker, MSG_QUESTION_STATE);
+         wire::expect(worker, rx, MSG_STATE);
+         std::string state(rx.part());
 
          if(state == WORKER_STATE_IDLE) {
-            // group all files that were mapped to this counter
-            std::vector<std::string> reduceInput(groupFiles_(currentCount));
+            // group all files that were mapped to this counter;
+            // the advert scan runs once per partition, re-issues
+            // hit the cache
+            if(groupCache_.find(currentCount) == groupCache_.end()) {
+               groupCache_[currentCount] = groupFiles_(currentCount);
+            }
+            std::vector<std::string> reduceInput(groupCache_[currentCount]);
 
             message.clear();
             std::string message("Issuing worker ");
@@ -80,41 +105,40 @@ namespace MapReduce
             log_->write(message, LOGLEVEL_INFO);
 
             //ask where their advert is
-            worker.write(saga::buffer(MASTER_QUESTION_ADVERT, 7));
-            memset(buff, 0, 255);
-            read_bytes = worker.read(saga::buffer(buff));
-            saga::url advert = saga::url(std::string(buff, read_bytes));
+            wire::send(worker, MSG_QUESTION_ADVERT);
+            wire::expect(worker, rx, MSG_ADVERT);
+            saga::url advert = saga::url(rx.part());
 
             message.clear();
             message += worker.get_url().get_string();
-            message += " <==> " + std::string(buff);
+            message += " <==> " + advert.get_string();
             message += " ... ";
             log_->write(message, LOGLEVEL_INFO);
 
-            worker.write(saga::buffer(WORKER_COMMAND_REDUCE, 6));
-            memset(buff, 0, 255);
-            read_bytes = worker.read(saga::buffer(buff));
-            if(std::string(buff, read_bytes) != WORKER_RESPONSE_ACKNOLEDGE) {
-                message = std::string("Worker did not accept chore!");
-                log_->write(message, LOGLEVEL_WARNING);
-                break;
-            }
+            //command and partition number travel in one frame
             std::string count(boost::lexical_cast<std::string>(currentCount));
-            worker.write(saga::buffer(count, count.size()));
-            memset(buff, 0, 255);
-            read_bytes = worker.read(saga::buffer(buff));
-            if(std::string(buff, read_bytes) != WORKER_RESPONSE_ACKNOLEDGE) {
-                message = std::string("Worker did not accept chunk!");
+            wire::send(worker, MSG_ASSIGN_REDUCE, count);
+            if(!rx.recv(worker) || rx.type() != MSG_ACKNOLEDGE) {
+                message = std::string("Worker did not accept chore!");
                 log_->write(message, LOGLEVEL_WARNING);
                 break;
             }
 
             saga::advert::directory workerAdvert(advert, mode);
             saga::advert::directory workerChunkDir(workerAdvert.open_dir(saga::url(ADVERT_DIR_REDUCE_INPUT), mode));
+            //One manifest entry holds every input URL of the
+            //partition, so the reducer discovers its inputs with a
+            //single advert read instead of a list plus one round
+            //trip per file
+            std::string manifest;
             for(unsigned int counter = 0; counter < reduceInput.size(); counter++) {
-              saga::advert::entry adv(workerChunkDir.open(saga::url("./input-"+boost::lexical_cast<std::string>(counter)), mode));
-               adv.store_string(reduceInput[counter]);
+               manifest += reduceInput[counter];
+               manifest += "\n";
             }
+            saga::advert::entry adv(workerChunkDir.open(saga::url(ADVERT_ENTRY_MANIFEST), mode));
+            adv.store_string(manifest);
+            metrics_->count("reduce.partitions.assigned");
+            metrics_->observe("reduce.assign_latency", serveTimer.elapsed());
             assigned = true;
             if(currentCount == fileCount_) {
                currentCount = 0; //Allows reduces to be re-issued
@@ -127,11 +151,22 @@ namespace MapReduce
             log_->write(message, LOGLEVEL_INFO);
          }
          else if(state == WORKER_STATE_DONE_REDUCE) {
-            worker.write(saga::buffer(MASTER_QUESTION_RESULT, 7));
-            memset(buff, 0, 255);
-            read_bytes = worker.read(saga::buffer(buff));
-            std::string result(buff, read_bytes);
-            worker.write(saga::buffer(MASTER_REQUEST_IDLE, 5));
+            wire::send(worker, MSG_QUESTION_RESULT);
+            wire::expect(worker, rx, MSG_RESULT);
+            std::string result(rx.part());
+            //The remaining parts fingerprint the worker's reduce
+            //output files, "<partition> <fnv64> <bytes> <url>" each.
+            //The url is the map key, so a re-reported file simply
+            //overwrites its line with the more complete checksum
+            for(std::size_t p = 1; p < rx.parts(); p++) {
+               std::string line(rx.part(p));
+               std::string::size_type urlAt = line.rfind(' ');
+               if(urlAt == std::string::npos) {
+                  continue;
+               }
+               checksums_[line.substr(urlAt + 1)] = line;
+            }
+            wire::send(worker, MSG_REQUEST_IDLE);
 
             message.clear();
             message += "Worker ";
@@ -139,31 +174,22 @@ namespace MapReduce
             message += result;
             log_->write(message, LOGLEVEL_INFO);
 
-            //If not finished, already, push back
-            std::vector<std::string>::iterator finished_IT = finished_.begin();
-            std::vector<std::string>::iterator end         = finished_.end();
-            bool found = false;
-            while(finished_IT != end) {
-               if(*finished_IT == result) {
-                  found = true;
-                  break;
-               }
-               ++finished_IT;
-            }
-            if(found == false) {
-               finished_.push_back(result);
-            }
+            //Hash-indexed insert, duplicate results are absorbed
+            finished_.markFinished(result);
+            metrics_->count("reduce.partitions.finished");
          }
          else if(state == WORKER_STATE_DONE_MAP) {
-            worker.write(saga::buffer(MASTER_REQUEST_IDLE, 5));
-            memset(buff, 0, 255);
-            read_bytes = worker.read(saga::buffer(buff));
-            std::string result(buff, read_bytes);
-            if(result != WORKER_RESPONSE_ACKNOLEDGE) {
+            wire::send(worker, MSG_REQUEST_IDLE);
+            if(!rx.recv(worker) || rx.type() != MSG_ACKNOLEDGE) {
                //error here
             }
          }
       }
+      catch(wire::error const & e) {
+         //out-of-sync stream: drop this connection and serve the
+         //next worker
+         log_->write(std::string(e.what()), LOGLEVEL_ERROR);
+      }
       catch(saga::exception const & e) {
          std::cerr << "error in reduce" << std::endl;
          throw;
@@ -179,19 +205,33 @@ namespace MapReduce
  std::vector<std::string> HandleReduces::groupFiles_(int counter)
  {
     std::vector<std::string> intermediateFiles;
-    std::vector<saga::url>::iterator workers_IT = workers_.begin();
+    std::vector<saga::url> workers = registry_->workers();
+    std::vector<saga::url>::iterator workers_IT = workers.begin();
     int mode = saga::advert::ReadWrite;
-    while(workers_IT != workers_.end()) {
+    while(workers_IT != workers.end()) {
        try {
-          saga::advert::directory worker(workerDir_.open_dir(*workers_IT));
+          saga::advert::directory worker(*workers_IT, mode);
           saga::advert::directory data(worker.open_dir(saga::url(ADVERT_DIR_INTERMEDIATE), mode));
-          if(data.exists(saga::url("./mapFile-" + boost::lexical_cast<std::string>(counter)))) {
-             saga::advert::entry adv(data.open(saga::url("./mapFile-" + boost::lexical_cast<std::string>(counter)), mode));
-             std::string path = adv.retrieve_string();
-             intermediateFiles.push_back(adv.retrieve_string());
-             std::string message("Added file " + path + " to input list");
-             log_->write(message, LOGLEVEL_INFO);
-             message.clear();
+          if(data.exists(saga::url(ADVERT_ENTRY_MAP_MANIFEST))) {
+             saga::advert::entry adv(data.open(saga::url(ADVERT_ENTRY_MAP_MANIFEST), mode));
+             //One packed manifest per worker covers all partitions,
+             //"<partition> <segment>" per line; keep the lines of
+             //the partition being grouped
+             std::istringstream manifest(adv.retrieve_string());
+             std::string line;
+             std::string prefix(boost::lexical_cast<std::string>(counter) + " ");
+             while(std::getline(manifest, line)) {
+                if(line.compare(0, prefix.size(), prefix) != 0) {
+                   continue;
+                }
+                std::string path(line.substr(prefix.size()));
+                if(path.empty()) {
+                   continue;
+                }
+                intermediateFiles.push_back(path);
+                std::string message("Added file " + path + " to input list");
+                log_->write(message, LOGLEVEL_INFO);
+             }
           }
           workers_IT++;
        }
@@ -201,4 +241,43 @@ namespace MapReduce
     }
     return intermediateFiles;
  }
+/*********************************************************
+ * publishChecksums_ writes the collected reduce output  *
+ * fingerprints to the session's REDUCE_MANIFEST entry,  *
+ * one "<partition> <fnv64> <bytes> <url>" line per      *
+ * output file.  A downstream consumer verifies a file   *
+ * against its manifest line lazily, when (and if) it    *
+ * actually reads the file - the master never re-reads   *
+ * reduce output for validation.                         *
+ * ******************************************************/
+ void HandleReduces::publishChecksums_()
+ {
+    if(checksums_.empty()) {
+       return;
+    }
+    std::string manifest;
+    std::map<std::string, std::string>::iterator line = checksums_.begin();
+    while(line != checksums_.end()) {
+       manifest += line->second;
+       manifest += "\n";
+       line++;
+    }
+    try {
+       int mode = saga::advert::Create | saga::advert::ReadWrite;
+       saga::advert::entry adv(registry_->session_dir().open(
+          saga::url(ADVERT_ENTRY_REDUCE_MANIFEST), mode));
+       adv.store_string(manifest);
+       std::string message("Published reduce manifest with ");
+       message += boost::lexical_cast<std::string>(checksums_.size());
+       message += " fingerprint(s)";
+       log_->write(message, LOGLEVEL_INFO);
+       metrics_->count("reduce.manifest.entries", checksums_.size());
+    }
+    catch(saga::exception const & e) {
+       //the outputs themselves are fine - only the verification
+       //shortcut is lost
+       log_->write(std::string("Could not publish reduce manifest: ")
+                   + e.get_message(), LOGLEVEL_WARNING);
+    }
+ }
 } // Namespace MapReduce
@@ -8,33 +8,48 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <saga/saga.hpp>
 //#include "../utils/defines.hpp"
 #include "../utils/LogWriter.hpp"
+#include "../utils/ChunkTable.hpp"
+#include "../utils/Metrics.hpp"
+#include "WorkerRegistry.hpp"
 #include "version.hpp"
 
 namespace MapReduce {
+   class ShuffleAhead;
    class HandleReduces {
      public:
+      //When a ShuffleAhead ran during the map phase its groups seed
+      //the cache, so no per-partition advert scan happens here
       HandleReduces(int fileCount,
-                    saga::advert::directory workerDir,
+                    WorkerRegistry *registry,
                     saga::url serverURL_,
-                    LogWriter *log);
+                    LogWriter *log,
+                    Metrics *metrics,
+                    ShuffleAhead *shuffle = NULL);
      ~HandleReduces();
       bool assignReduces();
      private:
       void issue_command_();
       std::vector<std::string> groupFiles_(int counter);
       void wait_for_results_();
-    
+      void publishChecksums_();
+
       int                      fileCount_;
-      saga::advert::directory  workerDir_;
+      WorkerRegistry          *registry_;
       saga::url                serverURL_;
       LogWriter               *log_;
-      std::vector<std::string> finished_;
-      std::vector<saga::url>   workers_;
+      Metrics                 *metrics_;
+      ChunkTable               finished_;
       saga::stream::server    *service_;
       int                      currentCount;
+      std::map<int, std::vector<std::string> > groupCache_;
+      //Latest fingerprint line per reduce output url, as reported by
+      //the workers; written to the session's REDUCE_MANIFEST entry
+      //once all partitions are finished
+      std::map<std::string, std::string> checksums_;
    };
 } //Namespace MapReduce
 
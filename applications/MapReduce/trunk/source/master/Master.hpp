@@ -9,11 +9,21 @@
 #include <saga/saga.hpp>
 #include "ConfigFileParser.hpp"
 #include "../utils/LogWriter.hpp"
+#include "../utils/Metrics.hpp"
 #include "../utils/defines.hpp"
+#include "../utils/ReplicaSpec.hpp"
+#include "../utils/Tuning.hpp"
 #include "version.hpp"
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
 #include "HandleMaps.hpp"
 #include "HandleReduces.hpp"
+#include "ShuffleAhead.hpp"
+#include "ElasticPool.hpp"
+#include "WorkerRegistry.hpp"
 #include "parseCommand.hpp"
+#include "../../../../common/profiler.hpp"
+#include "../../../../common/wire.hpp"
 
 #define JOBS_PER_SERVICE 1
 
@@ -56,6 +66,13 @@ namespace MapReduce {
             logURL_ = advertKey;
             //create new LogWriter instance that writes to advert
             log = new MapReduce::LogWriter(std::string(MR_MASTER_EXE_NAME), advertKey);
+            //metrics snapshots land next to the master in a local
+            //file named after the session, one "name value" pair
+            //per line for the dashboards to scrape
+            metrics_ = new MapReduce::Metrics(uuid_ + "-metrics.txt");
+            shuffleAhead_   = NULL;
+            elasticPool_    = NULL;
+            workerRegistry_ = NULL;
          }
          void run() {
             // generate a startup timestamp 
@@ -66,14 +83,24 @@ namespace MapReduce {
             message = message + " " + MR_MASTER_VERSION_FULL + " - creating new session.";
             log->write(message, LOGLEVEL_INFO);
             
+            // apply the config file's tuning section (and autotune
+            // what it asks for) before anything is sized or published
+            applyTuning_();
+
             // register with the db
             // Just connect to see if it exists
             registerWithDB_();
-            
+
             // create a new session
             // create all necessary directories
             createNewSession_();
-            
+
+            // Workers are put on the books at first contact on the
+            // command channel; every membership consumer reads this
+            // registry instead of listing the WORKERS directory
+            workerRegistry_ = new WorkerRegistry(sessionBaseDir_, log, metrics_);
+
+
             // add binaries to the Orchestrator DB
             // Take binaries from config file and
             // advertise them
@@ -85,22 +112,48 @@ namespace MapReduce {
             // Launch all worker command on all
             // host defined in config file
             spawnAgents_();
-            
-            // Find workers that have registered back
-            // with db, and try to give them some work
+
+            // When the config asks for it, add agents while the
+            // map backlog stays high (see ElasticPool.hpp)
+            elasticPool_ = new ElasticPool(cfgFileParser_.getExecutableList(),
+                                           cfgFileParser_.getTargetHostList(),
+                                           uuid_, database_, logURL_,
+                                           outputPrefix_,
+                                           tuning_.maxWorkers,
+                                           tuning_.scaleBacklog,
+                                           log, metrics_);
+            elasticPool_->countSpawned(jobs_.size());
+            elasticPool_->start();
+
+            // Workers announce themselves on the command channel
+            // and are handed chunks as they connect
+            publishStatus_("map");
             runMaps_();
-            
+
             // After all maps are done, go through workers
             // and try to reduce output from mappping by
             // assigning tasks to some workers
+            publishStatus_("reduce");
             runReduces_();
 
+            // The job is draining - stop adding agents.  Elastic
+            // workers joined the registry like everyone else, so
+            // sendQuit_ reaches them too
+            elasticPool_->stop();
+            delete elasticPool_;
+            elasticPool_ = NULL;
+
             //Send quit to all workers
             sendQuit_();
+            publishStatus_("done");
+
+            delete workerRegistry_;
+            workerRegistry_ = NULL;
 
             log->write("All done - exiting normally", LOGLEVEL_INFO);
          }
          ~Master(void) {
+            delete metrics_; //writes the final snapshot
             delete log;
          }
         private:
@@ -110,7 +163,9 @@ namespace MapReduce {
          std::string serverURL_;
          saga::url   logURL_;
 
-         std::vector<saga::url>      fileChunks_;
+         //Chunk replica specs ('|'-separated URL lists, see
+         //utils/ReplicaSpec.hpp); single-URL chunks are plain URLs
+         std::vector<std::string>    fileChunks_;
          saga::advert::directory     sessionBaseDir_;
          saga::advert::directory     workersDir_;
          saga::advert::directory     binariesDir_;
@@ -119,11 +174,64 @@ namespace MapReduce {
          std::vector<saga::job::job> jobs_;
          
          MapReduce::LogWriter * log;
+         MapReduce::Metrics * metrics_;
+         //Runs during the map phase, consumed by runReduces_
+         MapReduce::ShuffleAhead * shuffleAhead_;
+         //Runs from spawnAgents_ until the reduces are done
+         MapReduce::ElasticPool * elasticPool_;
+         //The wire-driven worker membership (see WorkerRegistry.hpp)
+         MapReduce::WorkerRegistry * workerRegistry_;
          ConfigFileParser cfgFileParser_;
-         
+         TuningDescription tuning_;
+
          Derived& derived() {
             return static_cast<Derived&>(*this);
          }
+         /*********************************************************
+          * applyTuning_ folds the config file's tuning section   *
+          * into the runtime values: explicit settings win, and   *
+          * with autotune enabled the partition count is sized    *
+          * from the job input volume.  The worker-side values    *
+          * are published to the session in createNewSession_.    *
+          * ******************************************************/
+         void applyTuning_(void) {
+            tuning_ = cfgFileParser_.getTuning();
+            if(tuning_.numDispatchThreads > 0)
+               tuning::numDispatchThreads() = tuning_.numDispatchThreads;
+            if(tuning_.chunkBatchSize > 0)
+               tuning::chunkBatchSize() = tuning_.chunkBatchSize;
+            if(tuning_.chunkTaperPercent >= 0)
+               tuning::chunkTaperPercent() = tuning_.chunkTaperPercent;
+            if(tuning_.numMapThreads > 0)
+               tuning::numMapThreads() = tuning_.numMapThreads;
+            if(tuning_.maxIntermediateSize > 0)
+               tuning::maxIntermediateSize() = tuning_.maxIntermediateSize;
+            if(tuning_.numMaps > 0) {
+               tuning::numMaps() = tuning_.numMaps;
+            }
+            else if(tuning_.autotune) {
+               //size the partition count from the total input volume
+               boost::uint64_t totalBytes = 0;
+               std::vector<FileDescription> fileList = cfgFileParser_.getFileList();
+               std::vector<FileDescription>::const_iterator fileListIT = fileList.begin();
+               while(fileListIT != fileList.end()) {
+                  try {
+                     saga::filesystem::file f(saga::url(fileListIT->name),
+                                              saga::filesystem::Read);
+                     totalBytes += f.get_size();
+                  }
+                  catch(saga::exception const &) {
+                     //unreadable input fails later with a better message
+                  }
+                  fileListIT++;
+               }
+               tuning::numMaps() = tuning::autotuneNumMaps(totalBytes);
+               log->write("Autotuned numMaps to "
+                  + boost::lexical_cast<std::string>(tuning::numMaps())
+                  + " (" + boost::lexical_cast<std::string>(totalBytes)
+                  + " input bytes)", LOGLEVEL_INFO);
+            }
+         }
          /*********************************************************
           * registerWithDB_ attempts to make a connection to the  *
           * database supplied in the config file, it does not     *
@@ -155,6 +263,7 @@ namespace MapReduce {
           * session (MapReduce instance).                         *
           * ******************************************************/
          void createNewSession_(void) {
+            profiler::scoped_timer timing("master.create_session");
             int mode = saga::advert::ReadWrite | saga::advert::Create;
             saga::task_container tc;
 
@@ -166,6 +275,19 @@ namespace MapReduce {
                tc.add_task(sessionBaseDir_.set_attribute<saga::task_base::Async>("name",    cfgFileParser_.getSessionDescription().name));
                tc.add_task(sessionBaseDir_.set_attribute<saga::task_base::Async>("user",    cfgFileParser_.getSessionDescription().user));
                tc.add_task(sessionBaseDir_.set_attribute<saga::task_base::Async>("version", cfgFileParser_.getSessionDescription().version));
+               //publish the agreed tuning for the workers: the
+               //partition count is binding, the rest is advisory
+               //(absent values mean "use your default or autotune")
+               tc.add_task(sessionBaseDir_.set_attribute<saga::task_base::Async>(ATTR_TUNE_NUM_MAPS,
+                  boost::lexical_cast<std::string>(tuning::numMaps())));
+               tc.add_task(sessionBaseDir_.set_attribute<saga::task_base::Async>(ATTR_TUNE_AUTOTUNE,
+                  tuning_.autotune ? "yes" : "no"));
+               if(tuning_.maxIntermediateSize > 0)
+                  tc.add_task(sessionBaseDir_.set_attribute<saga::task_base::Async>(ATTR_TUNE_MAX_INTERMEDIATE,
+                     boost::lexical_cast<std::string>(tuning_.maxIntermediateSize)));
+               if(tuning_.numMapThreads > 0)
+                  tc.add_task(sessionBaseDir_.set_attribute<saga::task_base::Async>(ATTR_TUNE_MAP_THREADS,
+                     boost::lexical_cast<std::string>(tuning_.numMapThreads)));
                saga::task t0 = sessionBaseDir_.open_dir<saga::task_base::Async>(saga::url(ADVERT_DIR_WORKERS),  mode); //workersDir_
                saga::task t1 = sessionBaseDir_.open_dir<saga::task_base::Async>(saga::url(ADVERT_DIR_BINARIES), mode); //binariesDir_
                saga::task t2 = sessionBaseDir_.open_dir<saga::task_base::Async>(saga::url(ADVERT_DIR_CHUNKS),   mode); //chunksDir_
@@ -233,6 +355,7 @@ namespace MapReduce {
           * of the database.                                      *
           ********************************************************/
          void populateFileList_(void) {
+            profiler::scoped_timer timing("master.populate_files");
             unsigned int successCounter = 0;
             int mode = saga::advert::Create | saga::advert::ReadWrite;
             std::vector<FileDescription> fileList                   = cfgFileParser_.getFileList();
@@ -246,18 +369,18 @@ namespace MapReduce {
                std::vector<saga::url> temp;
                d.chunker(temp, fileListIT->name);
                for(std::vector<saga::url>::const_iterator tempIT = temp.begin();tempIT!=temp.end();tempIT++) {
-                  fileChunks_.push_back(*tempIT);
+                  fileChunks_.push_back(replicaSpecFor_(*fileListIT, tempIT->get_string()));
                }
                std::cerr << "Number of chunks: " << temp.size() << std::endl;
                fileListIT++;
             }
-            std::vector<saga::url>::const_iterator fileChunks_IT = fileChunks_.begin();
+            std::vector<std::string>::const_iterator fileChunks_IT = fileChunks_.begin();
             // Advertise chunks
             while(fileChunks_IT != fileChunks_.end()) {
-               std::string message("Adding new chunk " + (fileChunks_IT->get_string()) + "...");
+               std::string message("Adding new chunk " + (*fileChunks_IT) + "...");
                try {
                   saga::advert::entry adv = chunksDir_.open(saga::url("chunk-" + boost::lexical_cast<std::string>(successCounter)), mode);
-                  adv.store_string(fileChunks_IT->get_string());
+                  adv.store_string(*fileChunks_IT);
                   message += "SUCCESS";
                   log->write(message, LOGLEVEL_INFO);
                   successCounter++;
@@ -273,6 +396,29 @@ namespace MapReduce {
                APPLICATION_ABORT;
             }
          }
+         /*********************************************************
+          * replicaSpecFor_ expands one chunker-produced chunk    *
+          * URL into a replica spec.  Chunkers derive their chunk *
+          * URLs from the file URL they were given, so a chunk of *
+          * a replicated file maps onto the other replicas by     *
+          * carrying the same suffix over; chunks that do not     *
+          * start with the file's primary URL (a custom chunker   *
+          * naming scheme) keep their single URL.                 *
+          * ******************************************************/
+         std::string replicaSpecFor_(FileDescription const &fd,
+                                     std::string const &chunk) {
+            if(fd.replicas.size() < 2 ||
+               chunk.compare(0, fd.name.size(), fd.name) != 0) {
+               return chunk;
+            }
+            std::string suffix(chunk.substr(fd.name.size()));
+            std::vector<std::string> urls;
+            for(std::vector<std::string>::size_type u = 0;
+                u < fd.replicas.size(); u++) {
+               urls.push_back(fd.replicas[u] + suffix);
+            }
+            return replica::join(urls);
+         }
          /*********************************************************
           * spawnAgents_ takes the host list and the binary list  *
           * from the config file and tries to match the proper    *
@@ -283,6 +429,7 @@ namespace MapReduce {
           * the master                                            *
           * ******************************************************/
          void spawnAgents_(void) {
+            profiler::scoped_timer timing("master.spawn_agents");
             std::vector<BinaryDescription> binaryList               = cfgFileParser_.getExecutableList();
             std::vector<HostDescription>  hostList                  = cfgFileParser_.getTargetHostList();
             std::vector<HostDescription>::const_iterator hostListIT = hostList.begin();
@@ -343,11 +490,24 @@ namespace MapReduce {
           * begin working                                         *
           * ******************************************************/
          void runMaps_(void) {
+            profiler::scoped_timer timing("master.run_maps");
             std::string message("Launching maps...");
-            HandleMaps mapHandler(fileChunks_, serverURL_, log);
-   
+            HandleMaps mapHandler(fileChunks_, serverURL_, workerRegistry_, log, metrics_);
+
             log->write(message, LOGLEVEL_INFO);
+            //While maps are still running, fold every committed map
+            //output into its reduce partition group in the
+            //background - the shuffle's grouping scan runs hidden
+            //behind the map tail instead of after it
+            shuffleAhead_ = new ShuffleAhead(tuning::numMaps(), workerRegistry_, log, metrics_);
+            shuffleAhead_->start();
+            //The scale policy watches the unassigned chunk depth
+            //while the chunks are being handed out
+            elasticPool_->watch(boost::bind(&HandleMaps::unassignedDepth, &mapHandler));
             mapHandler.assignMaps();
+            elasticPool_->unwatch();
+            //Final sweep: every map has committed by now
+            shuffleAhead_->stop();
          }
          /*********************************************************
           * runReduces_ uses the helper class HandleReduces to    *
@@ -356,18 +516,46 @@ namespace MapReduce {
           * master                                                *
           * ******************************************************/
          void runReduces_(void) {
+            profiler::scoped_timer timing("master.run_reduces");
             std::string message("Beginning Reduces...");
-            HandleReduces reduceHandler(NUM_MAPS, workersDir_, serverURL_, log);
-   
+            HandleReduces reduceHandler(tuning::numMaps(), workerRegistry_, serverURL_,
+                                        log, metrics_, shuffleAhead_);
+
             log->write(message, LOGLEVEL_INFO);
             reduceHandler.assignReduces();
+            delete shuffleAhead_;
+            shuffleAhead_ = NULL;
+         }
+         /*********************************************************
+          * publishStatus_ rewrites the session's STATUS entry:   *
+          * the current phase plus the membership and chunk       *
+          * counts, one "name value" pair per line.  One small    *
+          * write per phase transition keeps a summary available  *
+          * to observers without them walking the namespace.      *
+          * ******************************************************/
+         void publishStatus_(std::string const &phase) {
+            std::string summary("phase " + phase + "\n");
+            summary += "workers "
+               + boost::lexical_cast<std::string>(workerRegistry_->size()) + "\n";
+            summary += "chunks "
+               + boost::lexical_cast<std::string>(fileChunks_.size()) + "\n";
+            try {
+               int mode = saga::advert::Create | saga::advert::ReadWrite;
+               saga::advert::entry adv = sessionBaseDir_.open(
+                  saga::url(ADVERT_ENTRY_STATUS), mode);
+               adv.store_string(summary);
+            }
+            catch(saga::exception const &e) {
+               log->write(std::string(e.what()), LOGLEVEL_WARNING);
+            }
          }
          void sendQuit_(void) {
-            char buff[255];
             int successCounter = 0;
-            int workersSize = workersDir_.list("*").size();
-            std::vector<saga::url> list = workersDir_.list("*");
+            //Only workers on the books can be waiting for commands;
+            //no listing of the workers directory needed
+            int workersSize = (int) workerRegistry_->size();
             try {
+               wire::receiver rx;
                while(successCounter < workersSize)
                {
                   saga::stream::server *service = new saga::stream::server(serverURL_);
@@ -375,9 +563,8 @@ namespace MapReduce {
                   std::string message("Established connection to ");
                   message += worker.get_url().get_string();
                   log->write(message, LOGLEVEL_INFO);
-                  worker.write(saga::buffer(WORKER_COMMAND_QUIT, 4));
-                  saga::ssize_t read_bytes = worker.read(saga::buffer(buff));
-                  if(std::string(buff, read_bytes) != WORKER_RESPONSE_ACKNOLEDGE)
+                  wire::send(worker, MSG_QUIT);
+                  if(!rx.recv(worker) || rx.type() != MSG_ACKNOLEDGE)
                   {
                      log->write(std::string("Misbehaving worker!"), LOGLEVEL_WARNING);
                   }
@@ -389,6 +576,9 @@ namespace MapReduce {
                   delete service;
                }
             }
+            catch(wire::error const & e) {
+               std::cerr << e.what() << std::endl;
+            }
             catch(saga::exception const & e) {
                std::cerr << e.what() << std::endl;
             }
@@ -0,0 +1,129 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstdlib>
+#include <sstream>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include "ShuffleAhead.hpp"
+#include "../utils/defines.hpp"
+
+namespace MapReduce {
+ ShuffleAhead::ShuffleAhead(int fileCount,
+                            WorkerRegistry *registry,
+                            LogWriter *log,
+                            Metrics *metrics)
+    : fileCount_(fileCount), registry_(registry), log_(log),
+      metrics_(metrics), done_(false)
+ {
+ }
+
+ ShuffleAhead::~ShuffleAhead()
+ {
+    //stop() is idempotent; make sure the sweeper never outlives us
+    stop();
+ }
+
+ void ShuffleAhead::start()
+ {
+    done_ = false;
+    thread_.reset(new boost::thread(
+       boost::bind(&ShuffleAhead::sweepLoop_, this)));
+ }
+
+ void ShuffleAhead::stop()
+ {
+    if(!thread_) {
+       return;
+    }
+    done_ = true;
+    thread_->join();
+    thread_.reset();
+    //One last pass now that every map has committed, so the groups
+    //are complete before the reduce phase consumes them
+    sweep_();
+ }
+
+ std::map<int, std::vector<std::string> > ShuffleAhead::groups()
+ {
+    boost::mutex::scoped_lock lock(mutex_);
+    return groups_;
+ }
+
+ int ShuffleAhead::watermark(int partition)
+ {
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<int, std::vector<std::string> >::iterator it = groups_.find(partition);
+    return it == groups_.end() ? 0 : it->second.size();
+ }
+
+/*********************************************************
+ * sweepLoop_ runs on the background thread while the    *
+ * map phase is assigning chunks.  Each pass costs a     *
+ * walk over the worker adverts; the interval keeps that *
+ * from competing with the assignment conversations.     *
+ * ******************************************************/
+ void ShuffleAhead::sweepLoop_()
+ {
+    while(!done_) {
+       for(int s = 0; s < WORKER_SWEEP_INTERVAL && !done_; s++) {
+          sleep(1);
+       }
+       if(done_) {
+          return;
+       }
+       sweep_();
+    }
+ }
+
+/*********************************************************
+ * sweep_ folds every newly committed map segment into   *
+ * its partition group.  One packed manifest per worker  *
+ * covers all partitions - "<partition> <segment>" per   *
+ * line - so each pass costs one advert read per member  *
+ * of the registry, and only the segment urls not yet in *
+ * seen_ are new.                                        *
+ * ******************************************************/
+ void ShuffleAhead::sweep_()
+ {
+    int mode = saga::advert::ReadWrite;
+    std::vector<saga::url> workers = registry_->workers();
+    std::vector<saga::url>::iterator workersIT = workers.begin();
+    while(workersIT != workers.end()) {
+       try {
+          saga::advert::directory worker(*workersIT, mode);
+          saga::advert::directory data(worker.open_dir(saga::url(ADVERT_DIR_INTERMEDIATE), mode));
+          if(data.exists(saga::url(ADVERT_ENTRY_MAP_MANIFEST))) {
+             saga::advert::entry adv(data.open(saga::url(ADVERT_ENTRY_MAP_MANIFEST), mode));
+             std::istringstream manifest(adv.retrieve_string());
+             std::string line;
+             while(std::getline(manifest, line)) {
+                std::string::size_type space = line.find(' ');
+                if(space == std::string::npos) {
+                   continue;
+                }
+                int counter = std::atoi(line.substr(0, space).c_str());
+                std::string path(line.substr(space + 1));
+                if(path.empty() || counter < 0 || counter >= fileCount_) {
+                   continue;
+                }
+                boost::mutex::scoped_lock lock(mutex_);
+                if(seen_.find(path) != seen_.end()) {
+                   continue;
+                }
+                seen_.insert(path);
+                groups_[counter].push_back(path);
+                metrics_->count("shuffle.ahead.outputs_folded");
+             }
+          }
+       }
+       catch(saga::exception const &) {
+          //Worker not fully registered yet or a transient advert
+          //error; the next sweep will pick it up
+       }
+       workersIT++;
+    }
+ }
+} // namespace MapReduce
@@ -0,0 +1,69 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_SHUFFLE_AHEAD_HPP
+#define MR_SHUFFLE_AHEAD_HPP
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <saga/saga.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include "../utils/LogWriter.hpp"
+#include "../utils/Metrics.hpp"
+#include "WorkerRegistry.hpp"
+
+namespace MapReduce {
+   /*********************************************************
+    * ShuffleAhead overlaps the shuffle with the map tail.  *
+    * While assignMaps() is still handing out chunks, a     *
+    * background sweeper reads each registered worker's     *
+    * packed map manifest - one advert entry per worker     *
+    * covering all partitions - and folds every already-    *
+    * committed map output into per-partition input groups, *
+    * keeping a watermark of how many outputs each          *
+    * partition has absorbed.  By the time the reduce phase *
+    * starts, the groups are complete and HandleReduces     *
+    * skips its per-partition advert scan - the longest     *
+    * serial part of the shuffle runs hidden behind the map *
+    * phase instead of after it.                            *
+    * ******************************************************/
+   class ShuffleAhead {
+     public:
+      ShuffleAhead(int fileCount,
+                   WorkerRegistry *registry,
+                   LogWriter *log,
+                   Metrics *metrics);
+     ~ShuffleAhead();
+      //Spawns the background sweeper; call before assignMaps()
+      void start();
+      //Runs one final sweep and joins the sweeper; call once
+      //assignMaps() has returned, so every committed output is in
+      void stop();
+      //The per-partition input groups accumulated so far
+      std::map<int, std::vector<std::string> > groups();
+      //Completed map outputs folded into one partition so far
+      int watermark(int partition);
+     private:
+      void sweepLoop_();
+      void sweep_();
+
+      int                      fileCount_;
+      WorkerRegistry          *registry_;
+      LogWriter               *log_;
+      Metrics                 *metrics_;
+      bool                     done_;
+      boost::mutex             mutex_;
+      boost::shared_ptr<boost::thread> thread_;
+      //segment urls already folded, so re-sweeps only pay for
+      //segments that committed since the last pass
+      std::set<std::string>    seen_;
+      std::map<int, std::vector<std::string> > groups_;
+   };
+} //Namespace MapReduce
+
+#endif // MR_SHUFFLE_AHEAD_HPP
@@ -0,0 +1,77 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "WorkerRegistry.hpp"
+#include "../utils/defines.hpp"
+
+namespace MapReduce {
+ WorkerRegistry::WorkerRegistry(saga::advert::directory sessionDir,
+                                LogWriter *log,
+                                Metrics *metrics)
+    : sessionDir_(sessionDir), log_(log), metrics_(metrics)
+ {
+ }
+
+/*********************************************************
+ * add records a worker on its first contact.  The       *
+ * roster mirror is rewritten outside the lock: a torn   *
+ * write cannot happen (store_string replaces the whole  *
+ * value) and a lost race between two first contacts     *
+ * only delays a worker's appearance until the next one  *
+ * rewrites the entry.                                   *
+ * ******************************************************/
+ bool WorkerRegistry::add(std::string const &advertURL)
+ {
+    {
+       boost::mutex::scoped_lock lock(mutex_);
+       if(!known_.insert(advertURL).second) {
+          return false;
+       }
+       workers_.push_back(saga::url(advertURL));
+    }
+    log_->write("Worker joined: " + advertURL, LOGLEVEL_INFO);
+    metrics_->count("workers.joined");
+    publishRoster_();
+    return true;
+ }
+
+ std::vector<saga::url> WorkerRegistry::workers()
+ {
+    boost::mutex::scoped_lock lock(mutex_);
+    return workers_;
+ }
+
+ std::size_t WorkerRegistry::size()
+ {
+    boost::mutex::scoped_lock lock(mutex_);
+    return workers_.size();
+ }
+
+/*********************************************************
+ * publishRoster_ mirrors the membership into the        *
+ * session's ROSTER entry, one advert url per line.      *
+ * Best effort: the registry itself stays correct when   *
+ * the advert service hiccups.                           *
+ * ******************************************************/
+ void WorkerRegistry::publishRoster_()
+ {
+    std::string roster;
+    {
+       boost::mutex::scoped_lock lock(mutex_);
+       for(std::vector<saga::url>::size_type w = 0; w < workers_.size(); w++) {
+          roster += workers_[w].get_string();
+          roster += "\n";
+       }
+    }
+    try {
+       int mode = saga::advert::Create | saga::advert::ReadWrite;
+       saga::advert::entry adv = sessionDir_.open(saga::url(ADVERT_ENTRY_ROSTER), mode);
+       adv.store_string(roster);
+    }
+    catch(saga::exception const &e) {
+       log_->write(std::string(e.what()), LOGLEVEL_WARNING);
+    }
+ }
+} // namespace MapReduce
@@ -0,0 +1,63 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_WORKER_REGISTRY_HPP
+#define MR_WORKER_REGISTRY_HPP
+
+#include <set>
+#include <string>
+#include <vector>
+#include <saga/saga.hpp>
+#include <boost/thread/mutex.hpp>
+#include "../utils/LogWriter.hpp"
+#include "../utils/Metrics.hpp"
+
+namespace MapReduce {
+   /*********************************************************
+    * WorkerRegistry is the master's view of the worker     *
+    * membership.  Dispatch is connection driven, so the    *
+    * command channel is the authoritative discovery path:  *
+    * a worker is on the books from the moment it first     *
+    * reports its advert url in a conversation.  Every      *
+    * consumer that used to list the session's WORKERS      *
+    * directory - the shuffle sweeper, the failure          *
+    * detector, the reduce grouping, the quit broadcast -   *
+    * reads the registry instead, so no directory whose     *
+    * size grows with the worker count is ever listed       *
+    * while a job runs.  The membership is also mirrored    *
+    * into the session's ROSTER entry, one advert url per   *
+    * line and rewritten on each first contact, so an       *
+    * observer outside the master reads one entry instead   *
+    * of walking the namespace.                             *
+    * ******************************************************/
+   class WorkerRegistry {
+     public:
+      WorkerRegistry(saga::advert::directory sessionDir,
+                     LogWriter *log,
+                     Metrics *metrics);
+      //Records a worker's first contact; returns whether the
+      //advert url was new.  Safe to call from the dispatcher pool.
+      bool add(std::string const &advertURL);
+      //Snapshot of every worker advert url seen so far
+      std::vector<saga::url> workers();
+      std::size_t size();
+      //The session directory the registry publishes into, for other
+      //session-level entries (the reduce manifest)
+      saga::advert::directory &session_dir() { return sessionDir_; }
+     private:
+      void publishRoster_();
+
+      saga::advert::directory  sessionDir_;
+      LogWriter               *log_;
+      Metrics                 *metrics_;
+      //mutex_ guards known_ and workers_ against concurrent first
+      //contacts from the dispatcher pool
+      boost::mutex             mutex_;
+      std::set<std::string>    known_;
+      std::vector<saga::url>   workers_;
+   };
+} //Namespace MapReduce
+
+#endif // MR_WORKER_REGISTRY_HPP
@@ -6,7 +6,9 @@
 #include "Master.hpp"
 #include "../xmlParser/xmlParser.h"
 #include "../utils/block_profiler.hpp"
+#include "../utils/ChunkSplit.hpp"
 #include <boost/scoped_ptr.hpp>
+#include <cctype>
 
 using namespace MapReduce::Master;
 struct bp_tag_chunk {};
@@ -15,39 +17,57 @@ struct bp_tag_overall {};
 class MasterImpl : public Master<MasterImpl> {
   public:
    MasterImpl(int argC, char **argV) : Master<MasterImpl>(argC,argV) {}
+   /*********************************************************
+    * chunker computes byte-range splits over the input     *
+    * file instead of copying it into chunk files, so no    *
+    * pre-splitting I/O pass happens at all.  Each split is *
+    * a <url>#split=offset:length chunk name (ChunkSplit    *
+    * format); boundaries are advanced to the next          *
+    * whitespace so no token straddles two splits, which    *
+    * costs one small read per boundary instead of reading  *
+    * and rewriting the whole file.                         *
+    * ******************************************************/
    void chunker(std::vector<saga::url> &retval, std::string fileArg) {
       MapReduce::block_profiler<bp_tag_chunk> profiler = MapReduce::block_profiler<bp_tag_chunk>("Chunking time (included in pop_files)");
       int mode = saga::filesystem::Read;
-      int x=0;
-      saga::size_t const KB64 = 67108864;
-      saga::size_t bytesRead;
+      saga::size_t const SPLIT_SIZE = 67108864;
+      char window[4096];
       saga::url urlFile(fileArg);
-      boost::scoped_array<char> data(new char[KB64+1]);
       saga::filesystem::file f(urlFile, mode);
-      while((bytesRead = f.read(saga::buffer(data.get(),KB64))) != 0) {
-         saga::size_t pos;
-         int gmode = saga::filesystem::Write | saga::filesystem::Create;
-         saga::filesystem::file g(saga::url(fileArg + "chunk" + boost::lexical_cast<std::string>(x)), gmode);
-         if(bytesRead < KB64)
-         {
-            g.write(saga::buffer(data.get(), bytesRead));
-            retval.push_back(g.get_url());
+      long long size = f.get_size();
+      long long offset = 0;
+      while(offset < size) {
+         long long end = offset + static_cast<long long>(SPLIT_SIZE);
+         if(end >= size) {
+            end = size;
          }
-         else
-         {
-            for(int y=bytesRead; y >= 0;y--) {
-               if(data[y]==' ') {
-                  pos=y;
+         else {
+            //Align the boundary to the next whitespace so records
+            //never straddle two splits
+            f.seek(end, saga::filesystem::Start);
+            bool aligned = false;
+            while(!aligned && end < size) {
+               saga::ssize_t got = f.read(saga::buffer(window, sizeof(window)),
+                                          sizeof(window));
+               if(got <= 0) {
+                  end = size;
                   break;
                }
+               for(saga::ssize_t i = 0; i < got; i++) {
+                  if(std::isspace(static_cast<unsigned char>(window[i]))) {
+                     end += i + 1;
+                     aligned = true;
+                     break;
+                  }
+               }
+               if(!aligned) {
+                  end += got;
+               }
             }
-            int dist = -(bytesRead-pos);
-            g.write(saga::buffer(data.get(), pos));
-            f.seek(dist,saga::filesystem::Current);
-            retval.push_back(g.get_url());
-            x++;
-            for ( unsigned int i = 2; i <= KB64; ++i ) { data[i] = '\0'; }
          }
+         retval.push_back(saga::url(
+            MapReduce::makeChunkSplit(fileArg, offset, end - offset)));
+         offset = end;
       }
    }
 };
@@ -0,0 +1,162 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+//  mapreduce_traceview merges the binary trace files the workers write
+//  (see utils/Trace.hpp) into one job timeline:
+//
+//      mapreduce_traceview /tmp/mapreduce-trace-*.trc
+//
+//  prints every event ordered by wall clock, relative to the first
+//  event of the job, one worker per column label, and closes with the
+//  map/flush spans per worker - enough to see which worker the job
+//  waited on and where inside its task the time went.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "../utils/Trace.hpp"
+
+namespace {
+
+   struct MergedEvent {
+      MapReduce::TraceEvent ev;
+      std::size_t           worker; //index into the file list
+   };
+
+   bool byTime(MergedEvent const &a, MergedEvent const &b) {
+      return a.ev.usec < b.ev.usec;
+   }
+
+   //last path component without the mapreduce-trace-/.trc wrapping,
+   //so the timeline columns read as worker uuids
+   std::string workerLabel(std::string path) {
+      std::string::size_type pos = path.rfind("/");
+      if(pos != std::string::npos) {
+         path = path.substr(pos + 1);
+      }
+      std::string const prefix("mapreduce-trace-");
+      if(path.compare(0, prefix.size(), prefix) == 0) {
+         path = path.substr(prefix.size());
+      }
+      pos = path.rfind(".trc");
+      if(pos != std::string::npos) {
+         path = path.substr(0, pos);
+      }
+      return path;
+   }
+
+   char const *kindName(boost::uint16_t kind) {
+      switch(kind) {
+         case MapReduce::TRACE_MAP_START:    return "map-start";
+         case MapReduce::TRACE_MAP_END:      return "map-end";
+         case MapReduce::TRACE_REDUCE_START: return "reduce-start";
+         case MapReduce::TRACE_REDUCE_END:   return "reduce-end";
+         case MapReduce::TRACE_FLUSH_START:  return "flush-start";
+         case MapReduce::TRACE_FLUSH_END:    return "flush-end";
+         case MapReduce::TRACE_COMMIT:       return "commit";
+         case MapReduce::TRACE_PROTOCOL:     return "protocol";
+         case MapReduce::TRACE_DROPPED:      return "DROPPED";
+      }
+      return "?";
+   }
+
+   bool readTraceFile(std::string const &path,
+                      std::size_t worker,
+                      std::vector<MergedEvent> &out) {
+      std::ifstream file(path.c_str(), std::ios::binary);
+      if(!file) {
+         std::cerr << "cannot open " << path << std::endl;
+         return false;
+      }
+      MapReduce::TraceFileHeader header;
+      file.read(reinterpret_cast<char *>(&header), sizeof(header));
+      if(!file || std::string(header.magic, 4) != "MRTR"
+               || header.eventSize != sizeof(MapReduce::TraceEvent)) {
+         std::cerr << path << ": not a trace file (or written by a "
+                   << "different build)" << std::endl;
+         return false;
+      }
+      MergedEvent merged;
+      merged.worker = worker;
+      while(file.read(reinterpret_cast<char *>(&merged.ev),
+                      sizeof(merged.ev))) {
+         out.push_back(merged);
+      }
+      return true;
+   }
+}
+
+int main(int argc, char **argv) {
+   if(argc < 2) {
+      std::cerr << "usage: " << argv[0] << " <trace file> ..." << std::endl;
+      return 1;
+   }
+
+   std::vector<std::string>  labels;
+   std::vector<MergedEvent>  events;
+   for(int i = 1; i < argc; i++) {
+      if(!readTraceFile(argv[i], labels.size(), events)) {
+         return 1;
+      }
+      labels.push_back(workerLabel(argv[i]));
+   }
+   if(events.empty()) {
+      std::cerr << "no events" << std::endl;
+      return 1;
+   }
+   std::stable_sort(events.begin(), events.end(), byTime);
+
+   //the timeline, relative to the job's first event
+   boost::uint64_t origin = events[0].ev.usec;
+   std::map<std::size_t, boost::uint64_t> mapStart, flushStart;
+   std::map<std::size_t, double>          mapTotal, flushTotal;
+   for(std::size_t i = 0; i < events.size(); i++) {
+      MapReduce::TraceEvent const &ev = events[i].ev;
+      double ms = (ev.usec - origin) / 1000.0;
+      std::cout << ms << " " << labels[events[i].worker] << " "
+                << kindName(ev.kind);
+      if(ev.arg != 0) {
+         std::cout << " arg=" << ev.arg;
+      }
+      if(ev.value != 0) {
+         std::cout << " value=" << ev.value;
+      }
+      std::cout << std::endl;
+
+      switch(ev.kind) {
+         case MapReduce::TRACE_MAP_START:
+            mapStart[events[i].worker] = ev.usec;
+            break;
+         case MapReduce::TRACE_MAP_END:
+            if(mapStart.count(events[i].worker)) {
+               mapTotal[events[i].worker] +=
+                  (ev.usec - mapStart[events[i].worker]) / 1000.0;
+            }
+            break;
+         case MapReduce::TRACE_FLUSH_START:
+            flushStart[events[i].worker] = ev.usec;
+            break;
+         case MapReduce::TRACE_FLUSH_END:
+            if(flushStart.count(events[i].worker)) {
+               flushTotal[events[i].worker] +=
+                  (ev.usec - flushStart[events[i].worker]) / 1000.0;
+            }
+            break;
+      }
+   }
+
+   std::cout << std::endl << "# per-worker totals (ms)" << std::endl;
+   for(std::size_t w = 0; w < labels.size(); w++) {
+      std::cout << "# " << labels[w]
+                << " map=" << (mapTotal.count(w) ? mapTotal[w] : 0.0)
+                << " flush=" << (flushTotal.count(w) ? flushTotal[w] : 0.0)
+                << std::endl;
+   }
+   return 0;
+}
@@ -0,0 +1,310 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_BLOCK_COMPRESSOR_HPP
+#define MR_BLOCK_COMPRESSOR_HPP
+
+#include <cstdio>  // EOF
+#include <string>
+#include <vector>
+#include <cstring>
+#include <istream>
+#include <streambuf>
+#include "RecordIO.hpp"
+
+/*********************************************************
+ * A splittable block-compressed container for the       *
+ * intermediate files.  The codec is a byte-oriented     *
+ * LZ77 (hash-table greedy matcher, 64 KB window, cheap  *
+ * on CPU like LZ4), and every block compresses          *
+ * independently so a reader can start at any block.     *
+ *                                                       *
+ * Segment layout (one segment per flush, segments may   *
+ * be appended back to back in one file):                *
+ *                                                       *
+ *   "MRCB"                                              *
+ *   per block: varint rawLen, flag byte (1=compressed,  *
+ *              0=stored), varint payloadLen, payload    *
+ *   varint 0                              (terminator)  *
+ *   varint blockCount,                    (block index) *
+ *   per block: varint headerOffset, varint rawLen       *
+ *                                                       *
+ * Blocks that do not shrink are stored raw, so the      *
+ * worst case costs a few header bytes per block.  The   *
+ * index lets a future reader seek to block k without    *
+ * inflating its predecessors; the streaming reader      *
+ * below just parses and skips it.                       *
+ * ******************************************************/
+namespace MapReduce {
+   namespace blockcompress {
+      static const char        MAGIC[4]   = { 'M', 'R', 'C', 'B' };
+      static const std::size_t BLOCK_SIZE = 256 * 1024;
+      static const std::size_t WINDOW     = 65535;
+      static const std::size_t MIN_MATCH  = 4;
+      static const std::size_t HASH_BITS  = 14;
+      static const std::size_t NPOS       = static_cast<std::size_t>(-1);
+
+      inline std::size_t hash4_(const char *p) {
+         //FNV-1a over the four bytes, folded to HASH_BITS
+         std::size_t h = 2166136261u;
+         for(int i = 0; i < 4; i++) {
+            h ^= static_cast<unsigned char>(p[i]);
+            h *= 16777619u;
+         }
+         return (h ^ (h >> HASH_BITS)) & ((1u << HASH_BITS) - 1);
+      }
+
+      //readVarint_ decodes LEB128 from a byte range, NPOS on underrun
+      inline std::size_t readVarint_(const char *&p, const char *end) {
+         std::size_t value = 0;
+         int shift = 0;
+         while(p != end) {
+            unsigned char byte = static_cast<unsigned char>(*p++);
+            value |= static_cast<std::size_t>(byte & 0x7f) << shift;
+            if(!(byte & 0x80)) {
+               return value;
+            }
+            shift += 7;
+         }
+         return NPOS;
+      }
+
+      /*********************************************************
+       * compressBlock emits alternating literal runs and back *
+       * references: varint litLen, literals, then (unless the *
+       * block is done) varint matchLen and varint offset.     *
+       * ******************************************************/
+      inline void compressBlock(const char *src, std::size_t n,
+                                std::string &out) {
+         std::vector<std::size_t> table(1u << HASH_BITS, NPOS);
+         std::size_t pos = 0;
+         std::size_t litStart = 0;
+         while(pos + MIN_MATCH <= n) {
+            std::size_t h = hash4_(src + pos);
+            std::size_t candidate = table[h];
+            table[h] = pos;
+            if(candidate != NPOS && pos - candidate <= WINDOW &&
+               std::memcmp(src + candidate, src + pos, MIN_MATCH) == 0) {
+               std::size_t matchLen = MIN_MATCH;
+               while(pos + matchLen < n &&
+                     src[candidate + matchLen] == src[pos + matchLen]) {
+                  matchLen++;
+               }
+               appendVarint(out, pos - litStart);
+               out.append(src + litStart, pos - litStart);
+               appendVarint(out, matchLen);
+               appendVarint(out, pos - candidate);
+               pos += matchLen;
+               litStart = pos;
+            }
+            else {
+               pos++;
+            }
+         }
+         //trailing literals close the block; the decompressor stops
+         //once rawLen bytes have been produced
+         appendVarint(out, n - litStart);
+         out.append(src + litStart, n - litStart);
+      }
+
+      /*********************************************************
+       * decompressBlock inflates exactly rawLen bytes onto    *
+       * dst.  Returns false on a corrupt block.               *
+       * ******************************************************/
+      inline bool decompressBlock(const char *src, std::size_t compLen,
+                                  char *dst, std::size_t rawLen) {
+         const char *p   = src;
+         const char *end = src + compLen;
+         std::size_t produced = 0;
+         while(produced < rawLen) {
+            std::size_t litLen = readVarint_(p, end);
+            if(litLen == NPOS || litLen > rawLen - produced ||
+               static_cast<std::size_t>(end - p) < litLen) {
+               return false;
+            }
+            std::memcpy(dst + produced, p, litLen);
+            p        += litLen;
+            produced += litLen;
+            if(produced == rawLen) {
+               break;
+            }
+            std::size_t matchLen = readVarint_(p, end);
+            std::size_t offset   = readVarint_(p, end);
+            if(matchLen == NPOS || offset == NPOS || offset == 0 ||
+               offset > produced || matchLen > rawLen - produced) {
+               return false;
+            }
+            //byte-wise copy on purpose, overlapping matches are legal
+            for(std::size_t i = 0; i < matchLen; i++) {
+               dst[produced + i] = dst[produced - offset + i];
+            }
+            produced += matchLen;
+         }
+         return true;
+      }
+
+      /*********************************************************
+       * compressBuffer packs one raw buffer into a complete   *
+       * segment (magic, blocks, terminator, index) on out.    *
+       * ******************************************************/
+      inline void compressBuffer(std::string const &raw, std::string &out) {
+         out.append(MAGIC, 4);
+         std::vector<std::pair<std::size_t, std::size_t> > index;
+         std::size_t done = 0;
+         while(done < raw.size()) {
+            std::size_t rawLen = raw.size() - done;
+            if(rawLen > BLOCK_SIZE) {
+               rawLen = BLOCK_SIZE;
+            }
+            index.push_back(std::make_pair(out.size(), rawLen));
+            std::string comp;
+            compressBlock(raw.data() + done, rawLen, comp);
+            appendVarint(out, rawLen);
+            if(comp.size() < rawLen) {
+               out.push_back(1);
+               appendVarint(out, comp.size());
+               out.append(comp);
+            }
+            else {
+               out.push_back(0);
+               appendVarint(out, rawLen);
+               out.append(raw.data() + done, rawLen);
+            }
+            done += rawLen;
+         }
+         appendVarint(out, 0);
+         appendVarint(out, index.size());
+         for(std::vector<std::pair<std::size_t, std::size_t> >::size_type
+                b = 0; b < index.size(); b++) {
+            appendVarint(out, index[b].first);
+            appendVarint(out, index[b].second);
+         }
+      }
+   } // namespace blockcompress
+
+/*********************************************************
+ * BlockDecompressedStreambuf layers block decompression *
+ * under any std::istream interface.  The first read     *
+ * sniffs the magic: compressed files are inflated block *
+ * by block, anything else passes through untouched, so  *
+ * old uncompressed intermediate files keep working and  *
+ * the format stays optional.                            *
+ * ******************************************************/
+   class BlockDecompressedStreambuf : public std::streambuf {
+     public:
+      explicit BlockDecompressedStreambuf(std::istream &source)
+         : source_(source), mode_(UNKNOWN),
+           buffer_(blockcompress::BLOCK_SIZE)
+      {}
+
+     protected:
+      int_type underflow() {
+         if(gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+         }
+         std::size_t filled = fill_();
+         if(filled == 0) {
+            return traits_type::eof();
+         }
+         setg(&buffer_[0], &buffer_[0], &buffer_[0] + filled);
+         return traits_type::to_int_type(buffer_[0]);
+      }
+
+     private:
+      enum Mode { UNKNOWN, RAW, COMPRESSED };
+
+      //readVarint_ decodes straight off the source stream
+      std::size_t readVarint_() {
+         std::size_t value = 0;
+         int shift = 0;
+         while(true) {
+            int byte = source_.get();
+            if(byte == EOF) {
+               return blockcompress::NPOS;
+            }
+            value |= static_cast<std::size_t>(byte & 0x7f) << shift;
+            if(!(byte & 0x80)) {
+               return value;
+            }
+            shift += 7;
+         }
+      }
+
+      std::size_t fill_() {
+         if(mode_ == UNKNOWN) {
+            char head[4];
+            source_.read(head, 4);
+            std::streamsize got = source_.gcount();
+            if(got == 4 && std::memcmp(head, blockcompress::MAGIC, 4) == 0) {
+               mode_ = COMPRESSED;
+            }
+            else {
+               //not our container: serve the sniffed bytes, then
+               //fall through to plain pass-through reads
+               mode_ = RAW;
+               std::memcpy(&buffer_[0],  head, got);
+               return static_cast<std::size_t>(got);
+            }
+         }
+         if(mode_ == RAW) {
+            source_.read(&buffer_[0], buffer_.size());
+            return static_cast<std::size_t>(source_.gcount());
+         }
+         //COMPRESSED: deliver the next block, crossing segment
+         //boundaries (terminator, index, next magic) as needed
+         while(true) {
+            std::size_t rawLen = readVarint_();
+            if(rawLen == blockcompress::NPOS) {
+               return 0; //clean end of file
+            }
+            if(rawLen == 0) {
+               //terminator: parse and discard the index, then expect
+               //either EOF or the magic of the next appended segment
+               std::size_t count = readVarint_();
+               for(std::size_t b = 0; count != blockcompress::NPOS &&
+                                      b < 2 * count; b++) {
+                  readVarint_();
+               }
+               char head[4];
+               source_.read(head, 4);
+               if(source_.gcount() != 4 ||
+                  std::memcmp(head, blockcompress::MAGIC, 4) != 0) {
+                  return 0;
+               }
+               continue;
+            }
+            int flag = source_.get();
+            std::size_t payloadLen = readVarint_();
+            if(flag == EOF || payloadLen == blockcompress::NPOS) {
+               return 0;
+            }
+            if(rawLen > buffer_.size()) {
+               buffer_.resize(rawLen);
+            }
+            if(flag == 0) {
+               source_.read(&buffer_[0], payloadLen);
+               if(static_cast<std::size_t>(source_.gcount()) != payloadLen) {
+                  return 0;
+               }
+               return rawLen;
+            }
+            std::vector<char> comp(payloadLen);
+            source_.read(&comp[0], payloadLen);
+            if(static_cast<std::size_t>(source_.gcount()) != payloadLen ||
+               !blockcompress::decompressBlock(&comp[0], payloadLen,
+                                               &buffer_[0], rawLen)) {
+               return 0;
+            }
+            return rawLen;
+         }
+      }
+
+      std::istream     &source_;
+      Mode              mode_;
+      std::vector<char> buffer_;
+   };
+} // namespace MapReduce
+
+#endif // MR_BLOCK_COMPRESSOR_HPP
@@ -0,0 +1,52 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_CHECKSUM_HPP
+#define MR_CHECKSUM_HPP
+
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <boost/cstdint.hpp>
+
+/*********************************************************
+ * Streaming FNV-1a checksum over a byte stream.  Used   *
+ * to fingerprint reduce output files as they are        *
+ * written, so a consumer can verify a file against the  *
+ * job manifest without the master ever re-reading it.   *
+ * Not cryptographic - this guards against truncated or  *
+ * mixed-up files, not against an adversary.  The state  *
+ * is one 64-bit word, so feeding the bytes costs        *
+ * nothing next to writing them.                         *
+ * ******************************************************/
+namespace MapReduce {
+   class Checksum {
+     public:
+      Checksum() : state_(0xcbf29ce484222325ULL) {}
+
+      //Feed one buffer; call in write order
+      void update(char const *data, std::size_t size) {
+         for(std::size_t i = 0; i < size; i++) {
+            state_ ^= static_cast<unsigned char>(data[i]);
+            state_ *= 0x100000001b3ULL;
+         }
+      }
+      void update(std::string const &data) {
+         update(data.data(), data.size());
+      }
+
+      //Hex digest of everything fed so far; the stream may
+      //continue afterwards
+      std::string digest() const {
+         std::ostringstream out;
+         out << std::hex << std::setw(16) << std::setfill('0') << state_;
+         return out.str();
+      }
+     private:
+      boost::uint64_t state_;
+   };
+}
+
+#endif // MR_CHECKSUM_HPP
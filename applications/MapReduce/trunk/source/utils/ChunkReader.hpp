@@ -0,0 +1,158 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_CHUNK_READER_HPP
+#define MR_CHUNK_READER_HPP
+
+#include <saga/saga.hpp>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cctype>
+#include <boost/shared_ptr.hpp>
+#include "ChunkSplit.hpp"
+#include "LocalFile.hpp"
+#include "TokenScan.hpp"
+
+/*********************************************************
+ * ChunkReader reads a chunk with large block reads      *
+ * (default 8 MB) straight into one caller-owned buffer  *
+ * and hands out whitespace-delimited tokens in place as *
+ * pointer/length pairs, bypassing the per-byte iostream *
+ * layer and the string copies of operator>>.            *
+ *                                                       *
+ * A chunk that resolves to a local file (see            *
+ * LocalFile.hpp) is memory mapped instead: tokens then  *
+ * point directly into the mapping and the whole chunk   *
+ * is zero-copy page-cache reads - no buffer, no refill  *
+ * calls.                                                *
+ * ******************************************************/
+namespace MapReduce {
+   class ChunkReader {
+     public:
+      /*********************************************************
+       * The url may carry a #split=offset:length suffix (see  *
+       * ChunkSplit.hpp), in which case only that byte range   *
+       * of the file is read.  The master aligns ranges to     *
+       * whitespace, so no token straddles a split boundary.   *
+       * ******************************************************/
+      explicit ChunkReader(std::string const &url,
+                           std::size_t blockSize = 8 * 1024 * 1024)
+         : split_(parseChunkSplit(url)),
+           remaining_(split_.bounded ? split_.length : -1),
+           data_(0), size_(0), pos_(0), eof_(false)
+      {
+         //local fast lane: map the file once and scan tokens in place
+         std::string path(localfile::localPath(split_.file));
+         if(!path.empty()) {
+            map_.reset(new localfile::mmap_view(path));
+            if(map_->valid()) {
+               std::size_t off = split_.bounded
+                  ? static_cast<std::size_t>(split_.offset) : 0;
+               if(off > map_->size()) {
+                  off = map_->size();
+               }
+               std::size_t len = map_->size() - off;
+               if(split_.bounded &&
+                  static_cast<std::size_t>(split_.length) < len) {
+                  len = static_cast<std::size_t>(split_.length);
+               }
+               data_ = map_->data() + off;
+               size_ = len;
+               eof_  = true;   //the whole range is visible at once
+               return;
+            }
+            map_.reset();
+         }
+         buffer_.resize(blockSize);
+         data_ = &buffer_[0];
+         file_.reset(new saga::filesystem::file(saga::url(split_.file),
+                                                saga::filesystem::Read));
+         if(split_.bounded && split_.offset > 0) {
+            file_->seek(split_.offset, saga::filesystem::Start);
+         }
+      }
+
+      /*********************************************************
+       * nextToken points token/size at the next whitespace-   *
+       * delimited token inside the internal buffer (or the    *
+       * mapping).  The bytes stay valid until the next call.  *
+       * Returns false at end of chunk.                        *
+       * ******************************************************/
+      bool nextToken(const char *&token, std::size_t &size) {
+         while(true) {
+            //skip leading whitespace (16 bytes at a time)
+            if(pos_ < size_) {
+               pos_ += tokenscan::scanSpace(data_ + pos_, size_ - pos_);
+            }
+            if(pos_ == size_) {
+               if(eof_) {
+                  return false;
+               }
+               refill_();
+               continue;
+            }
+            std::size_t start = pos_;
+            pos_ += tokenscan::scanToken(data_ + pos_, size_ - pos_);
+            if(pos_ == size_ && !eof_) {
+               //The token may continue in the next block; rewind
+               //and refill unless it already fills the buffer
+               if(start > 0 || size_ < buffer_.size()) {
+                  pos_ = start;
+                  refill_();
+                  continue;
+               }
+            }
+            token = data_ + start;
+            size  = pos_ - start;
+            return true;
+         }
+      }
+
+     private:
+      //refill_ keeps the unconsumed tail (a partial token) at the
+      //front of the buffer and tops the rest up with one large read;
+      //never reached on the memory-mapped path
+      void refill_() {
+         if(pos_ > 0 && pos_ < size_) {
+            std::memmove(&buffer_[0], &buffer_[pos_], size_ - pos_);
+         }
+         size_ -= pos_;
+         pos_ = 0;
+         std::size_t want = buffer_.size() - size_;
+         //A bounded range never reads past its end
+         if(remaining_ >= 0 && static_cast<long long>(want) > remaining_) {
+            want = static_cast<std::size_t>(remaining_);
+         }
+         if(want == 0) {
+            eof_ = true;
+            return;
+         }
+         saga::ssize_t res = file_->read(
+            saga::buffer(&buffer_[size_], want), want);
+         if(res <= 0) {
+            eof_ = true;
+         }
+         else {
+            size_ += static_cast<std::size_t>(res);
+            if(remaining_ >= 0) {
+               remaining_ -= res;
+            }
+         }
+      }
+
+      ChunkSplit             split_;
+      boost::shared_ptr<saga::filesystem::file> file_;
+      boost::shared_ptr<localfile::mmap_view>   map_;
+      long long              remaining_; //bytes left in range, -1 unbounded
+      std::vector<char>      buffer_;
+      const char            *data_;  //scan window: &buffer_[0] or the mapping
+      std::size_t            size_;  //valid bytes behind data_
+      std::size_t            pos_;   //read cursor
+      bool                   eof_;
+   };
+} // namespace MapReduce
+
+#endif // MR_CHUNK_READER_HPP
@@ -0,0 +1,71 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_CHUNK_SPLIT_HPP
+#define MR_CHUNK_SPLIT_HPP
+
+#include <string>
+#include <boost/lexical_cast.hpp>
+
+/*********************************************************
+ * A chunk no longer has to be a physical file: the      *
+ * master can describe a byte range of a large input as  *
+ *                                                       *
+ *    <url>#split=<offset>:<length>                      *
+ *                                                       *
+ * and ship that string through the normal assignment    *
+ * frames.  These helpers build and parse the suffix;    *
+ * a chunk name without it means the whole file, so the  *
+ * old pre-split chunk files keep working.               *
+ * ******************************************************/
+namespace MapReduce {
+   struct ChunkSplit {
+      ChunkSplit() : offset(0), length(0), bounded(false) {}
+      std::string file;    //the underlying input URL
+      long long   offset;  //first byte of the range
+      long long   length;  //bytes in the range
+      bool        bounded; //false: no suffix, read the whole file
+   };
+
+   inline std::string makeChunkSplit(std::string const &file,
+                                     long long offset,
+                                     long long length) {
+      return file + "#split="
+           + boost::lexical_cast<std::string>(offset) + ":"
+           + boost::lexical_cast<std::string>(length);
+   }
+
+   //parseChunkSplit accepts both plain URLs and range chunks; a
+   //malformed suffix is treated as part of the file name rather
+   //than guessed at
+   inline ChunkSplit parseChunkSplit(std::string const &chunk) {
+      ChunkSplit split;
+      split.file = chunk;
+      std::string::size_type marker = chunk.rfind("#split=");
+      if(marker == std::string::npos) {
+         return split;
+      }
+      std::string::size_type colon = chunk.find(':', marker + 7);
+      if(colon == std::string::npos) {
+         return split;
+      }
+      try {
+         long long offset = boost::lexical_cast<long long>(
+            chunk.substr(marker + 7, colon - marker - 7));
+         long long length = boost::lexical_cast<long long>(
+            chunk.substr(colon + 1));
+         split.file    = chunk.substr(0, marker);
+         split.offset  = offset;
+         split.length  = length;
+         split.bounded = true;
+      }
+      catch(boost::bad_lexical_cast const &) {
+         //fall through with the untouched file name
+      }
+      return split;
+   }
+} // namespace MapReduce
+
+#endif // MR_CHUNK_SPLIT_HPP
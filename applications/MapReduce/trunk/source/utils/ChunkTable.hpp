@@ -0,0 +1,237 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_CHUNK_TABLE_HPP
+#define MR_CHUNK_TABLE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include <boost/unordered_map.hpp>
+
+/*********************************************************
+ * ChunkTable keeps the master's chunk bookkeeping in    *
+ * O(1) per operation.  Chunk names are interned once    *
+ * into a dense id space, a hash index maps names back   *
+ * to ids, the unassigned queue is an intrusive linked   *
+ * list threaded through the entries, and the assigned   *
+ * set is an indexable vector with swap-and-pop removal. *
+ * ******************************************************/
+namespace MapReduce {
+   class ChunkTable {
+     public:
+      typedef std::size_t id_type;
+      enum State {
+         STATE_UNASSIGNED = 0,
+         STATE_ASSIGNED   = 1,
+         STATE_FINISHED   = 2
+      };
+      static const id_type nil = static_cast<id_type>(-1);
+
+      ChunkTable() : freeHead_(nil), freeTail_(nil), finishedCount_(0),
+                     completedDurations_(0), totalDuration_(0) {}
+
+      //intern registers a chunk name (if new) and places it on the
+      //unassigned queue.  Returns the chunk's dense id.
+      id_type intern(std::string const &name) {
+         boost::unordered_map<std::string, id_type>::const_iterator
+            it = index_.find(name);
+         if(it != index_.end()) {
+            return it->second;
+         }
+         id_type id = entries_.size();
+         entries_.push_back(Entry(name));
+         index_.insert(std::make_pair(name, id));
+         pushFree_(id);
+         return id;
+      }
+
+      std::size_t size()          const { return entries_.size();  }
+      std::size_t finishedCount() const { return finishedCount_;   }
+      bool allFinished()          const { return finishedCount_ == entries_.size(); }
+      bool hasUnassigned()        const { return freeHead_ != nil; }
+      bool hasAssigned()          const { return !assignedIds_.empty(); }
+
+      //unassignedCount is the depth of the unassigned queue; every
+      //chunk is either unassigned, assigned or finished
+      std::size_t unassignedCount() const {
+         return entries_.size() - finishedCount_ - assignedIds_.size();
+      }
+
+      //isUnassigned reports whether a known chunk still waits on
+      //the unassigned queue
+      bool isUnassigned(std::string const &name) const {
+         boost::unordered_map<std::string, id_type>::const_iterator
+            it = index_.find(name);
+         return it != index_.end() &&
+                entries_[it->second].state == STATE_UNASSIGNED;
+      }
+
+      //firstUnassigned returns the head of the unassigned queue
+      //without removing it; only valid when hasUnassigned().
+      std::string const &firstUnassigned() const {
+         return entries_[freeHead_].name;
+      }
+
+      //randomAssigned picks an in-flight chunk for re-issue; only
+      //valid when hasAssigned().
+      std::string const &randomAssigned() const {
+         return entries_[assignedIds_[rand() % assignedIds_.size()]].name;
+      }
+
+      //markAssigned moves a chunk from the unassigned queue into
+      //the assigned set.  Re-assigning an already assigned or
+      //finished chunk is a no-op.
+      void markAssigned(std::string const &name) {
+         id_type id = intern(name);
+         Entry &e = entries_[id];
+         if(e.state != STATE_UNASSIGNED) {
+            return;
+         }
+         unlinkFree_(id);
+         e.state = STATE_ASSIGNED;
+         e.assignedPos = assignedIds_.size();
+         e.assignTime  = std::time(0);
+         assignedIds_.push_back(id);
+      }
+
+      //touchAssignment refreshes the assignment timestamp of an
+      //in-flight chunk after a speculative re-issue, so the same
+      //straggler is not duplicated again immediately
+      void touchAssignment(std::string const &name) {
+         boost::unordered_map<std::string, id_type>::const_iterator
+            it = index_.find(name);
+         if(it != index_.end() &&
+            entries_[it->second].state == STATE_ASSIGNED) {
+            entries_[it->second].assignTime = std::time(0);
+         }
+      }
+
+      //markFinished records a completion regardless of the chunk's
+      //previous state; duplicate completions are absorbed.
+      void markFinished(std::string const &name) {
+         id_type id = intern(name);
+         Entry &e = entries_[id];
+         if(e.state == STATE_FINISHED) {
+            return;
+         }
+         if(e.state == STATE_UNASSIGNED) {
+            unlinkFree_(id);
+         }
+         else {
+            dropAssigned_(id);
+            //Feed the completion-time model
+            completedDurations_++;
+            totalDuration_ += std::time(0) - e.assignTime;
+         }
+         e.state = STATE_FINISHED;
+         ++finishedCount_;
+      }
+
+      //releaseAssignment returns an in-flight chunk to the
+      //unassigned queue, used when the worker holding it is
+      //declared dead.  Unassigned or finished chunks are left
+      //untouched.
+      bool releaseAssignment(std::string const &name) {
+         boost::unordered_map<std::string, id_type>::const_iterator
+            it = index_.find(name);
+         if(it == index_.end() ||
+            entries_[it->second].state != STATE_ASSIGNED) {
+            return false;
+         }
+         dropAssigned_(it->second);
+         entries_[it->second].state = STATE_UNASSIGNED;
+         pushFree_(it->second);
+         return true;
+      }
+
+      //speculativeCandidate picks the in-flight chunk that has been
+      //outstanding the longest.  When enough chunks have finished
+      //to estimate a typical completion time, only stragglers that
+      //exceed twice that estimate qualify, so healthy chunks are
+      //not duplicated needlessly.  The first result to come back
+      //wins; later duplicates are absorbed by markFinished.
+      bool speculativeCandidate(std::string &name) const {
+         if(assignedIds_.empty()) {
+            return false;
+         }
+         std::time_t now = std::time(0);
+         std::time_t worst = -1;
+         id_type pick = nil;
+         for(std::size_t i = 0; i < assignedIds_.size(); i++) {
+            std::time_t outstanding = now - entries_[assignedIds_[i]].assignTime;
+            if(outstanding > worst) {
+               worst = outstanding;
+               pick = assignedIds_[i];
+            }
+         }
+         if(completedDurations_ > 0) {
+            std::time_t estimate = totalDuration_ / completedDurations_;
+            if(worst < 2 * estimate) {
+               return false;
+            }
+         }
+         name = entries_[pick].name;
+         return true;
+      }
+
+     private:
+      struct Entry {
+         explicit Entry(std::string const &n)
+            : name(n), state(STATE_UNASSIGNED),
+              nextFree(nil), prevFree(nil), assignedPos(nil),
+              assignTime(0) {}
+         std::string name;
+         State       state;
+         id_type     nextFree;    //intrusive unassigned queue links
+         id_type     prevFree;
+         id_type     assignedPos; //slot in assignedIds_ when assigned
+         std::time_t assignTime;  //when the chunk was last handed out
+      };
+
+      void pushFree_(id_type id) {
+         Entry &e = entries_[id];
+         e.prevFree = freeTail_;
+         e.nextFree = nil;
+         if(freeTail_ != nil) {
+            entries_[freeTail_].nextFree = id;
+         }
+         else {
+            freeHead_ = id;
+         }
+         freeTail_ = id;
+      }
+
+      void unlinkFree_(id_type id) {
+         Entry &e = entries_[id];
+         if(e.prevFree != nil) entries_[e.prevFree].nextFree = e.nextFree;
+         else                  freeHead_ = e.nextFree;
+         if(e.nextFree != nil) entries_[e.nextFree].prevFree = e.prevFree;
+         else                  freeTail_ = e.prevFree;
+         e.prevFree = e.nextFree = nil;
+      }
+
+      void dropAssigned_(id_type id) {
+         Entry &e = entries_[id];
+         id_type last = assignedIds_.back();
+         assignedIds_[e.assignedPos] = last;
+         entries_[last].assignedPos = e.assignedPos;
+         assignedIds_.pop_back();
+         e.assignedPos = nil;
+      }
+
+      std::vector<Entry>                         entries_;
+      boost::unordered_map<std::string, id_type> index_;
+      std::vector<id_type>                       assignedIds_;
+      id_type                                    freeHead_;
+      id_type                                    freeTail_;
+      std::size_t                                finishedCount_;
+      std::size_t                                completedDurations_;
+      std::time_t                                totalDuration_;
+   };
+} //Namespace MapReduce
+
+#endif // MR_CHUNK_TABLE_HPP
@@ -0,0 +1,107 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_LOCAL_FILE_HPP
+#define MR_LOCAL_FILE_HPP
+
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <saga/saga.hpp>
+
+/*********************************************************
+ * localfile detects chunk URLs that resolve to a file   *
+ * on this very host - the common case with locality-    *
+ * aware scheduling - and maps them into memory, so map  *
+ * input is read straight out of the page cache instead  *
+ * of through one saga call per buffer refill.           *
+ * ******************************************************/
+namespace MapReduce {
+   namespace localfile {
+      /*********************************************************
+       * localPath returns the plain filesystem path when the  *
+       * url points at a file on this host (file:// or local   *
+       * scheme, an empty host, localhost, or our own host     *
+       * name), and the empty string otherwise.                *
+       * ******************************************************/
+      inline std::string localPath(std::string const &url) {
+         try {
+            saga::url u(url);
+            std::string scheme(u.get_scheme());
+            if(!scheme.empty() && scheme != "file" && scheme != "local" &&
+               scheme != "any") {
+               return std::string("");
+            }
+            std::string host(u.get_host());
+            if(!host.empty() && host != "localhost") {
+               char name[256];
+               if(::gethostname(name, sizeof(name)) != 0 ||
+                  host != std::string(name)) {
+                  return std::string("");
+               }
+            }
+            return u.get_path();
+         }
+         catch(saga::exception const &) {
+            return std::string("");
+         }
+      }
+      /*********************************************************
+       * mmap_view maps a local file read-only and advises the *
+       * kernel of sequential access; data() stays valid until *
+       * destruction.  A view that failed to map (no such      *
+       * file, empty file, ...) reports !valid() and the       *
+       * caller falls back to the saga read path.              *
+       * ******************************************************/
+      class mmap_view {
+        public:
+         explicit mmap_view(std::string const &path)
+            : data_(0), size_(0)
+         {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0) {
+               return;
+            }
+            struct stat st;
+            if(::fstat(fd, &st) == 0 && st.st_size > 0) {
+               void *p = ::mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+               if(p != MAP_FAILED) {
+                  data_ = static_cast<const char *>(p);
+                  size_ = static_cast<std::size_t>(st.st_size);
+#ifdef MADV_SEQUENTIAL
+                  ::madvise(const_cast<char *>(data_), size_,
+                            MADV_SEQUENTIAL);
+#endif
+               }
+            }
+            //the mapping holds its own reference to the file
+            ::close(fd);
+         }
+         ~mmap_view() {
+            if(data_) {
+               ::munmap(const_cast<char *>(data_), size_);
+            }
+         }
+         bool valid(void) const {
+            return data_ != 0;
+         }
+         const char *data(void) const {
+            return data_;
+         }
+         std::size_t size(void) const {
+            return size_;
+         }
+        private:
+         mmap_view(mmap_view const &);
+         mmap_view &operator=(mmap_view const &);
+         const char *data_;
+         std::size_t size_;
+      };
+   } // namespace localfile
+} // namespace MapReduce
+
+#endif // MR_LOCAL_FILE_HPP
@@ -1,33 +1,61 @@
 //  Copyright (c) 2008 Michael Miceli and Christopher Miceli
-// 
-//  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
 #ifndef MR_LOG_WRITER_HPP
 #define MR_LOG_WRITER_HPP
 
 #include <string>
+#include <vector>
 #include <saga/saga.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
 
 namespace MapReduce
 {
+  /*********************************************************
+   * LogWriter formats each message on the calling thread, *
+   * queues it on a bounded ring and returns immediately;  *
+   * a background thread drains the ring to the advert     *
+   * entry and stderr.  When the ring is full the entry is *
+   * dropped and counted rather than stalling the caller,  *
+   * so logging never backs up the master's serve loops.   *
+   * ******************************************************/
   class LogWriter {
 
   private:
-    
+    static const std::size_t RING_SIZE = 1024;
+
     std::string appName_;
     saga::url   advURL_;
-    
+
+    std::vector<std::string> ring_;
+    std::size_t        head_;    //index of the oldest queued entry
+    std::size_t        queued_;  //entries currently in the ring
+    std::size_t        dropped_; //entries lost to a full ring
+    bool               running_;
+    saga::advert::entry logAdv_;
+    bool               advOpen_;
+    boost::mutex       mutex_;
+    boost::condition   notEmpty_;
+    boost::thread      writer_;  //must be declared last
+
+    std::string format_(std::string const &message, unsigned int logLevel);
+    void writerLoop_();
+    void emit_(std::string const &report);
+
   public:
-    
+
     LogWriter(std::string appName, saga::url advURL);
     LogWriter(saga::url advURL);
-    
+
     ~LogWriter();
-    
+
     void write(std::string, unsigned int logLevel);
-    
+
   };
 }
 
-#endif // MR_LOG_WRITER_HPP 
+#endif // MR_LOG_WRITER_HPP
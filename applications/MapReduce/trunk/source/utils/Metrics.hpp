@@ -0,0 +1,158 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_METRICS_HPP
+#define MR_METRICS_HPP
+
+#include <string>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <ctime>
+#include <cstdio>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/xtime.hpp>
+#include "high_resolution_timer.hpp"
+
+/*********************************************************
+ * Metrics collects named counters and latency           *
+ * histograms from the master hot paths and periodically *
+ * dumps them as machine-readable "name value" lines to  *
+ * a local snapshot file, so dashboards can track chunk  *
+ * throughput and assignment latency without grepping    *
+ * the LogWriter output.                                 *
+ * ******************************************************/
+namespace MapReduce {
+   class Metrics {
+     public:
+      /*********************************************************
+       * The snapshot file is rewritten in place every         *
+       * intervalSecs seconds by a background thread.          *
+       * ******************************************************/
+      Metrics(std::string const &snapshotPath, unsigned intervalSecs = 5)
+         : snapshotPath_(snapshotPath), intervalSecs_(intervalSecs),
+           running_(true),
+           exporter_(boost::bind(&Metrics::exportLoop_, this))
+      {}
+
+     ~Metrics() {
+         {
+            boost::mutex::scoped_lock lock(mutex_);
+            running_ = false;
+         }
+         exporter_.join();
+         writeSnapshot_(); //final state survives the run
+      }
+
+      /*********************************************************
+       * count bumps a named counter (negative deltas allowed  *
+       * for gauges like connected workers).                   *
+       * ******************************************************/
+      void count(std::string const &name, long delta = 1) {
+         boost::mutex::scoped_lock lock(mutex_);
+         counters_[name] += delta;
+      }
+
+      /*********************************************************
+       * observe records one latency sample into the histogram *
+       * of the given name.  Buckets are powers of two in      *
+       * milliseconds, which is plenty of resolution to spot   *
+       * regressions and keeps the histogram tiny.             *
+       * ******************************************************/
+      void observe(std::string const &name, double seconds) {
+         double ms = seconds * 1000.0;
+         int bucket = 0;
+         double bound = 1.0; //first bucket: <= 1ms
+         while(ms > bound && bucket < NUM_BUCKETS - 1) {
+            bound *= 2.0;
+            bucket++;
+         }
+         boost::mutex::scoped_lock lock(mutex_);
+         Histogram &h = histograms_[name];
+         h.buckets[bucket]++;
+         h.count++;
+         h.sum += seconds;
+      }
+
+     private:
+      static const int NUM_BUCKETS = 20; //1ms .. ~524s, then overflow
+
+      struct Histogram {
+         Histogram() : count(0), sum(0.0) {
+            for(int i = 0; i < NUM_BUCKETS; i++) {
+               buckets[i] = 0;
+            }
+         }
+         long   buckets[NUM_BUCKETS];
+         long   count;
+         double sum;
+      };
+
+      //One "name value" pair per line; histogram buckets appear as
+      //name.le_<upper bound in ms>, plus name.count and name.sum_secs
+      void writeSnapshot_() {
+         std::ostringstream out;
+         {
+            boost::mutex::scoped_lock lock(mutex_);
+            out << "timestamp " << std::time(NULL) << std::endl;
+            std::map<std::string, long>::const_iterator counterIT = counters_.begin();
+            while(counterIT != counters_.end()) {
+               out << counterIT->first << " " << counterIT->second << std::endl;
+               counterIT++;
+            }
+            std::map<std::string, Histogram>::const_iterator histIT = histograms_.begin();
+            while(histIT != histograms_.end()) {
+               Histogram const &h = histIT->second;
+               long bound = 1;
+               for(int i = 0; i < NUM_BUCKETS; i++) {
+                  if(h.buckets[i] != 0) {
+                     out << histIT->first << ".le_" << bound << "ms "
+                         << h.buckets[i] << std::endl;
+                  }
+                  bound *= 2;
+               }
+               out << histIT->first << ".count "    << h.count << std::endl;
+               out << histIT->first << ".sum_secs " << h.sum   << std::endl;
+               histIT++;
+            }
+         }
+         //Write to a temp file and rename so readers never see a
+         //half-written snapshot
+         std::string tmpPath(snapshotPath_ + ".tmp");
+         std::ofstream file(tmpPath.c_str(), std::ios::trunc);
+         file << out.str();
+         file.close();
+         std::rename(tmpPath.c_str(), snapshotPath_.c_str());
+      }
+
+      void exportLoop_() {
+         while(true) {
+            boost::xtime deadline;
+            boost::xtime_get(&deadline, boost::TIME_UTC);
+            deadline.sec += intervalSecs_;
+            boost::thread::sleep(deadline);
+            {
+               boost::mutex::scoped_lock lock(mutex_);
+               if(!running_) {
+                  return;
+               }
+            }
+            writeSnapshot_();
+         }
+      }
+
+      std::string                     snapshotPath_;
+      unsigned                        intervalSecs_;
+      bool                            running_;
+      std::map<std::string, long>     counters_;
+      std::map<std::string, Histogram> histograms_;
+      boost::mutex                    mutex_;
+      boost::thread                   exporter_;
+   };
+} //Namespace MapReduce
+
+#endif // MR_METRICS_HPP
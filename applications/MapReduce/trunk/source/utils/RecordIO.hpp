@@ -0,0 +1,105 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_RECORD_IO_HPP
+#define MR_RECORD_IO_HPP
+
+#include <cstdio>  // EOF
+#include <string>
+#include <vector>
+#include <istream>
+
+/*********************************************************
+ * Length-prefixed binary record format for intermediate *
+ * files, replacing the "key val, val;\n" text lines.    *
+ * One record is:                                        *
+ *    varint keyLength, key bytes,                       *
+ *    varint valueCount,                                 *
+ *    valueCount x (varint valueLength, value bytes)     *
+ * Varints are LEB128 (7 bits per byte, high bit set on  *
+ * continuation), so keys and values may contain any     *
+ * byte without escaping.                                *
+ * ******************************************************/
+namespace MapReduce {
+   inline void appendVarint(std::string &out, std::size_t value) {
+      while(value >= 0x80) {
+         out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+         value >>= 7;
+      }
+      out.push_back(static_cast<char>(value));
+   }
+
+   //appendRecord serializes one key with its values onto out
+   inline void appendRecord(std::string &out,
+                            std::string const &key,
+                            std::vector<std::string> const &values) {
+      appendVarint(out, key.size());
+      out.append(key);
+      appendVarint(out, values.size());
+      for(std::vector<std::string>::size_type v = 0; v < values.size(); v++) {
+         appendVarint(out, values[v].size());
+         out.append(values[v]);
+      }
+   }
+
+/*********************************************************
+ * RecordReader pulls records one at a time off any      *
+ * istream, buffering nothing beyond the current record. *
+ * ******************************************************/
+   class RecordReader {
+     public:
+      explicit RecordReader(std::istream &in) : in_(in) {}
+
+      //readRecord fills key and values with the next record;
+      //returns false on a clean end of stream
+      bool readRecord(std::string &key, std::vector<std::string> &values) {
+         std::size_t keySize;
+         if(!readVarint_(keySize)) {
+            return false;
+         }
+         readBytes_(key, keySize);
+         std::size_t count;
+         if(!readVarint_(count)) {
+            return false;
+         }
+         values.resize(count);
+         for(std::size_t v = 0; v < count; v++) {
+            std::size_t valueSize;
+            if(!readVarint_(valueSize)) {
+               return false;
+            }
+            readBytes_(values[v], valueSize);
+         }
+         return in_.good() || in_.eof();
+      }
+
+     private:
+      bool readVarint_(std::size_t &value) {
+         value = 0;
+         int shift = 0;
+         int c;
+         do {
+            c = in_.get();
+            if(c == EOF) {
+               return false;
+            }
+            value |= static_cast<std::size_t>(c & 0x7f) << shift;
+            shift += 7;
+         } while(c & 0x80);
+         return true;
+      }
+
+      void readBytes_(std::string &out, std::size_t size) {
+         out.resize(size);
+         if(size > 0) {
+            in_.read(&out[0], size);
+         }
+      }
+
+      std::istream &in_;
+   };
+} // namespace MapReduce
+
+#endif // MR_RECORD_IO_HPP
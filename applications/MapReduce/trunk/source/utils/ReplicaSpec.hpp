@@ -0,0 +1,63 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_REPLICA_SPEC_HPP
+#define MR_REPLICA_SPEC_HPP
+
+#include <string>
+#include <vector>
+
+/*********************************************************
+ * A chunk may be reachable through several replica URLs *
+ * (local path, GridFTP door, HDFS gateway).  Such a     *
+ * chunk travels as a single '|'-separated spec string   *
+ * through the chunk table, the adverts and the wire, so *
+ * everything keyed by chunk name keeps working; the     *
+ * worker picks the cheapest replica to open right       *
+ * before mapping (see selectReplica_ in the worker's    *
+ * MapReduceBase.hpp).  A spec without separator is a    *
+ * plain single-URL chunk.                               *
+ * ******************************************************/
+namespace MapReduce {
+   namespace replica {
+      const char SEPARATOR = '|';
+
+      // all URLs of a spec, in config file order (primary first)
+      inline std::vector<std::string> split(std::string const &spec) {
+         std::vector<std::string> urls;
+         std::string::size_type begin = 0;
+         while(begin <= spec.size()) {
+            std::string::size_type end = spec.find(SEPARATOR, begin);
+            if(end == std::string::npos) {
+               end = spec.size();
+            }
+            if(end > begin) {
+               urls.push_back(spec.substr(begin, end - begin));
+            }
+            begin = end + 1;
+         }
+         return urls;
+      }
+
+      inline std::string join(std::vector<std::string> const &urls) {
+         std::string spec;
+         for(std::vector<std::string>::size_type u = 0; u < urls.size(); u++) {
+            if(!spec.empty()) {
+               spec += SEPARATOR;
+            }
+            spec += urls[u];
+         }
+         return spec;
+      }
+
+      // the primary URL - what single-URL code paths historically used
+      inline std::string primary(std::string const &spec) {
+         std::string::size_type end = spec.find(SEPARATOR);
+         return end == std::string::npos ? spec : spec.substr(0, end);
+      }
+   } //namespace replica
+} //namespace MapReduce
+
+#endif // MR_REPLICA_SPEC_HPP
@@ -0,0 +1,258 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_SHUFFLE_HPP
+#define MR_SHUFFLE_HPP
+
+#include <cstdio>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <saga/saga.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include "defines.hpp"
+#include "../../../../common/wire.hpp"
+
+/*********************************************************
+ * Peer shuffle: reducers pull partition data directly   *
+ * from the mappers that produced it.                    *
+ *                                                       *
+ * Without this, map output travels worker -> shared     *
+ * filesystem -> reducer, moving every byte over the     *
+ * storage network twice when outputPrefix_ points at a  *
+ * central server.  A mapper that keeps a local spill    *
+ * copy of its committed segments runs a ShuffleServer   *
+ * over them and annotates its manifest lines with       *
+ *                                                       *
+ *    <file-url>|<server-url>|<segment-name>             *
+ *                                                       *
+ * The annotation rides through the master untouched;    *
+ * the reducer's merger tries the peer first and falls   *
+ * back to the filesystem copy whenever the mapper is    *
+ * gone, busy or never spilled - the file path stays the *
+ * source of truth for correctness.                      *
+ * ******************************************************/
+namespace MapReduce {
+
+   const std::size_t SHUFFLE_BLOCK_SIZE = 256 * 1024;
+
+   /*********************************************************
+    * ShuffleServer serves the local spill copies of this   *
+    * worker's committed segments over a saga stream.  One  *
+    * detached thread per reducer connection; a connection  *
+    * can fetch any number of segments.  Segment names are  *
+    * plain basenames - a request with path components is   *
+    * refused.                                              *
+    * ******************************************************/
+   class ShuffleServer {
+     public:
+      ShuffleServer(std::string const &spillDir, std::string const &host)
+         : spillDir_(spillDir), service_(0), done_(false) {
+         //a worker has no configured port; probe a handful derived
+         //from the pid until one binds
+         for(int attempt = 0; attempt < 16 && service_ == 0; attempt++) {
+            int port = 20000 + ((::getpid() + attempt * 131) % 20000);
+            std::string candidate("tcp://" + host + ":"
+                                  + boost::lexical_cast<std::string>(port));
+            try {
+               service_ = new saga::stream::server(saga::url(candidate));
+               url_ = candidate;
+            }
+            catch(saga::exception const & e) {
+               service_ = 0;
+            }
+         }
+         if(service_ == 0) {
+            throw saga::exception("ShuffleServer: no port available",
+                                  saga::NoSuccess);
+         }
+         listener_.reset(new boost::thread(
+            boost::bind(&ShuffleServer::listen_, this)));
+      }
+
+      ~ShuffleServer() {
+         stop();
+      }
+
+      std::string url(void) const {
+         return url_;
+      }
+
+      void stop(void) {
+         if(done_) {
+            return;
+         }
+         done_ = true;
+         try {
+            service_->close();
+         }
+         catch(saga::exception const & e) {
+            //closing an already-dead service is fine
+         }
+         if(listener_) {
+            listener_->join();
+            listener_.reset();
+         }
+         delete service_;
+         service_ = 0;
+      }
+
+     private:
+      void listen_(void) {
+         while(!done_) {
+            try {
+               saga::stream::stream peer = service_->serve();
+               //detached: the thread owns its copy of the stream and
+               //dies with the connection
+               boost::thread(boost::bind(&ShuffleServer::serve_, this, peer));
+            }
+            catch(saga::exception const & e) {
+               //serve() throws when stop() closes the service
+            }
+         }
+      }
+
+      void serve_(saga::stream::stream peer) {
+         try {
+            wire::receiver rx;
+            while(rx.recv(peer)) {
+               if(rx.type() != MSG_SHUFFLE_FETCH) {
+                  break;
+               }
+               std::string name(rx.part());
+               if(name.empty() || name[0] == '.'
+                  || name.find('/') != std::string::npos) {
+                  wire::send(peer, MSG_SHUFFLE_MISS);
+                  continue;
+               }
+               std::ifstream in((spillDir_ + "/" + name).c_str(),
+                                std::ios::binary);
+               if(!in.is_open()) {
+                  wire::send(peer, MSG_SHUFFLE_MISS);
+                  continue;
+               }
+               std::vector<char> block(SHUFFLE_BLOCK_SIZE);
+               while(in) {
+                  in.read(&block[0], block.size());
+                  std::streamsize got = in.gcount();
+                  if(got <= 0) {
+                     break;
+                  }
+                  wire::message data(MSG_SHUFFLE_DATA);
+                  data.add(&block[0], static_cast<std::size_t>(got));
+                  data.send(peer);
+               }
+               wire::send(peer, MSG_SHUFFLE_END);
+            }
+         }
+         catch(...) {
+            //the reducer went away or desynced; it falls back to the
+            //filesystem copy, nothing for us to clean up
+         }
+      }
+
+      std::string spillDir_;
+      std::string url_;
+      saga::stream::server *service_;
+      boost::shared_ptr<boost::thread> listener_;
+      volatile bool done_;
+   };
+
+   /*********************************************************
+    * PeerSegmentBuf streams one segment out of a mapper's  *
+    * ShuffleServer.  The constructor connects, requests    *
+    * the segment and pulls the first block, so a peer that *
+    * cannot serve fails fast - before the caller commits   *
+    * to this source - and the filesystem fallback can take *
+    * over.  underflow() then fetches one framed block at a *
+    * time, keeping memory at one block per input.          *
+    * ******************************************************/
+   class PeerSegmentBuf : public std::streambuf {
+     public:
+      PeerSegmentBuf(std::string const &serverURL, std::string const &name)
+         : done_(false) {
+         stream_.reset(new saga::stream::stream(saga::url(serverURL)));
+         stream_->connect();
+         wire::send(*stream_, MSG_SHUFFLE_FETCH, name);
+         fetch_();
+      }
+
+     protected:
+      int_type underflow(void) {
+         if(gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+         }
+         if(done_) {
+            return traits_type::eof();
+         }
+         fetch_();
+         if(block_.empty()) {
+            return traits_type::eof();
+         }
+         return traits_type::to_int_type(*gptr());
+      }
+
+     private:
+      void fetch_(void) {
+         block_.clear();
+         while(!done_ && block_.empty()) {
+            if(!rx_.recv(*stream_)) {
+               throw wire::error("peer closed mid-segment");
+            }
+            if(rx_.type() == MSG_SHUFFLE_DATA) {
+               block_ = rx_.part();
+            }
+            else if(rx_.type() == MSG_SHUFFLE_END) {
+               done_ = true;
+            }
+            else {
+               throw wire::error("peer cannot serve segment");
+            }
+         }
+         if(!block_.empty()) {
+            setg(&block_[0], &block_[0], &block_[0] + block_.size());
+         }
+      }
+
+      boost::shared_ptr<saga::stream::stream> stream_;
+      wire::receiver rx_;
+      std::string block_;
+      bool done_;
+   };
+
+   /*********************************************************
+    * splitManifestLine breaks one manifest line into its   *
+    * file url and the optional peer annotation.  A line    *
+    * without '|' is a plain pre-peer-shuffle url.          *
+    * ******************************************************/
+   inline void splitManifestLine(std::string const &line,
+                                 std::string &fileUrl,
+                                 std::string &peerUrl,
+                                 std::string &segmentName) {
+      fileUrl = line;
+      peerUrl.clear();
+      segmentName.clear();
+      std::string::size_type p1 = line.find('|');
+      if(p1 == std::string::npos) {
+         return;
+      }
+      std::string::size_type p2 = line.find('|', p1 + 1);
+      if(p2 == std::string::npos) {
+         //malformed annotation: keep the file url, skip the peer
+         fileUrl = line.substr(0, p1);
+         return;
+      }
+      fileUrl     = line.substr(0, p1);
+      peerUrl     = line.substr(p1 + 1, p2 - p1 - 1);
+      segmentName = line.substr(p2 + 1);
+   }
+} // namespace MapReduce
+
+#endif // MR_SHUFFLE_HPP
@@ -0,0 +1,183 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_STREAMING_MERGER_HPP
+#define MR_STREAMING_MERGER_HPP
+
+#include <saga/saga.hpp>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <boost/shared_ptr.hpp>
+#include "type.hpp"
+#include "RecordIO.hpp"
+#include "BlockCompressor.hpp"
+#include "Shuffle.hpp"
+
+/*********************************************************
+ * StreamingMerger performs an external-memory k-way     *
+ * merge over sorted binary record files.  One record    *
+ * per stream is buffered and a loser tree picks the     *
+ * next record in key order, so reducer memory stays     *
+ * bounded by k records regardless of partition size.    *
+ * ******************************************************/
+namespace MapReduce {
+   class StreamingMerger {
+     public:
+      //localHost, when given, names the host this merger runs on:
+      //files whose URL points at that host (or at no host at all)
+      //are read straight through the filesystem instead of the
+      //remote-file abstraction, which skips a copy for the
+      //host-local half of a co-scheduled shuffle.  An input with a
+      //peer annotation (see Shuffle.hpp) is pulled straight from the
+      //mapper that wrote it; the source order is local file, peer,
+      //then the remote-file fallback.
+      explicit StreamingMerger(std::vector<std::string> const &files,
+                               std::string const &localHost = std::string()) {
+         for(std::vector<std::string>::size_type i = 0; i < files.size(); i++) {
+            std::string fileUrl, peerUrl, segmentName;
+            splitManifestLine(files[i], fileUrl, peerUrl, segmentName);
+            std::istream *source = 0;
+            if(!localHost.empty()) {
+               saga::url u(fileUrl);
+               std::string host(u.get_host());
+               if(host.empty() || host == "localhost" || host == localHost) {
+                  localPtr f(new std::ifstream(u.get_path().c_str(),
+                                               std::ios::binary));
+                  if(f->is_open()) {
+                     locals_.push_back(f);
+                     source = f.get();
+                  }
+                  //an unopenable path falls back to the peer or stream
+               }
+            }
+            if(source == 0 && !peerUrl.empty()) {
+               //pull straight from the mapper; its spill copy holds
+               //the same bytes as the committed file
+               try {
+                  peerBufPtr pb(new PeerSegmentBuf(peerUrl, segmentName));
+                  inPtr pi(new std::istream(pb.get()));
+                  peerBufs_.push_back(pb);
+                  peerIns_.push_back(pi);
+                  source = pi.get();
+               }
+               catch(...) {
+                  //mapper gone or refusing - the filesystem copy
+                  //remains the source of truth
+               }
+            }
+            if(source == 0) {
+               streamPtr s(new boost::iostreams::stream<saga_file_device>(fileUrl));
+               streams_.push_back(s);
+               source = s.get();
+            }
+            //Decompression sits between the file and the record
+            //reader; uncompressed files pass through untouched
+            bufPtr b(new BlockDecompressedStreambuf(*source));
+            decompressors_.push_back(b);
+            inPtr in(new std::istream(b.get()));
+            inputs_.push_back(in);
+            readers_.push_back(readerPtr(new RecordReader(*in)));
+            keys_.push_back(std::string());
+            values_.push_back(std::vector<std::string>());
+            eof_.push_back(false);
+            advance_(i);
+         }
+         k_ = readers_.size();
+         tree_.assign(k_ ? k_ : 1, npos_);
+         if(k_ == 1) {
+            winner_ = 0;
+         }
+         else if(k_ > 1) {
+            winner_ = play_(1);
+         }
+      }
+
+      //next copies the record with the overall smallest key into
+      //key/values and refills that stream's buffer.  Returns false
+      //once all streams are exhausted.
+      bool next(std::string &key, std::vector<std::string> &values) {
+         if(k_ == 0 || eof_[winner_]) {
+            return false;
+         }
+         key = keys_[winner_];
+         values.swap(values_[winner_]);
+         advance_(winner_);
+         replay_(winner_);
+         return true;
+      }
+
+     private:
+      typedef boost::shared_ptr<boost::iostreams::stream<saga_file_device> > streamPtr;
+      typedef boost::shared_ptr<std::ifstream> localPtr;
+      typedef boost::shared_ptr<PeerSegmentBuf> peerBufPtr;
+      typedef boost::shared_ptr<BlockDecompressedStreambuf> bufPtr;
+      typedef boost::shared_ptr<std::istream> inPtr;
+      typedef boost::shared_ptr<RecordReader> readerPtr;
+      static const std::size_t npos_ = static_cast<std::size_t>(-1);
+
+      //less_ orders buffered records by key, treating exhausted
+      //streams and byes as plus infinity
+      bool less_(std::size_t a, std::size_t b) const {
+         if(b == npos_ || eof_[b]) return true;
+         if(a == npos_ || eof_[a]) return false;
+         return keys_[a] < keys_[b];
+      }
+
+      void advance_(std::size_t i) {
+         values_[i].clear();
+         if(!readers_[i]->readRecord(keys_[i], values_[i])) {
+            eof_[i] = true;
+         }
+      }
+
+      //play_ runs the initial tournament.  Internal nodes live at
+      //1..k-1, the leaf for stream i at node i+k.  Each internal
+      //node keeps its loser, the overall winner is returned.
+      std::size_t play_(std::size_t node) {
+         if(node >= k_) {
+            return node - k_;
+         }
+         std::size_t left  = play_(2 * node);
+         std::size_t right = play_(2 * node + 1);
+         if(less_(left, right)) {
+            tree_[node] = right;
+            return left;
+         }
+         tree_[node] = left;
+         return right;
+      }
+
+      //replay_ re-runs the matches on the path from stream i's
+      //leaf to the root after its buffer was refilled
+      void replay_(std::size_t i) {
+         std::size_t w = i;
+         for(std::size_t node = (i + k_) / 2; node >= 1; node /= 2) {
+            if(less_(tree_[node], w)) {
+               std::size_t loser = w;
+               w = tree_[node];
+               tree_[node] = loser;
+            }
+         }
+         winner_ = w;
+      }
+
+      std::vector<streamPtr>   streams_;
+      std::vector<localPtr>    locals_;
+      std::vector<peerBufPtr>  peerBufs_;
+      std::vector<inPtr>       peerIns_;
+      std::vector<bufPtr>      decompressors_;
+      std::vector<inPtr>       inputs_;
+      std::vector<readerPtr>   readers_;
+      std::vector<std::string> keys_;
+      std::vector<std::vector<std::string> > values_;
+      std::vector<bool>        eof_;
+      std::vector<std::size_t> tree_;
+      std::size_t              k_;
+      std::size_t              winner_;
+   };
+} // namespace MapReduce
+
+#endif // MR_STREAMING_MERGER_HPP
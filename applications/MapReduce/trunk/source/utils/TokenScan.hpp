@@ -0,0 +1,103 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_TOKEN_SCAN_HPP
+#define MR_TOKEN_SCAN_HPP
+
+#include <cstddef>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*********************************************************
+ * Whitespace classification over 16-byte blocks.  The   *
+ * tokenizing map kernels spend most of their time       *
+ * deciding "space or not" per byte; these scanners do   *
+ * it with SSE2 compares plus a movemask where the       *
+ * compiler provides it, and a branchy byte loop         *
+ * (no locale machinery) everywhere else.  Whitespace    *
+ * here is the ASCII set space, \\t, \\n, \\v, \\f, \\r. *
+ * ******************************************************/
+namespace MapReduce {
+   namespace tokenscan {
+      inline bool isTokenSpace(unsigned char c) {
+         return c == ' ' || (c >= '\t' && c <= '\r');
+      }
+
+#if defined(__SSE2__)
+      //spaceMask_ returns a 16-bit mask with a bit set for every
+      //whitespace byte in the block
+      inline int spaceMask_(__m128i block) {
+         __m128i mask = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+         //'\t'..'\r' is a contiguous run (9..13): both compares are
+         //valid in the signed domain for these small values
+         __m128i ge = _mm_cmpgt_epi8(block, _mm_set1_epi8('\t' - 1));
+         __m128i le = _mm_cmpgt_epi8(_mm_set1_epi8('\r' + 1), block);
+         mask = _mm_or_si128(mask, _mm_and_si128(ge, le));
+         return _mm_movemask_epi8(mask);
+      }
+
+      inline int firstBit_(int mask) {
+#if defined(__GNUC__)
+         return __builtin_ctz(mask);
+#else
+         int bit = 0;
+         while(!(mask & 1)) {
+            mask >>= 1;
+            bit++;
+         }
+         return bit;
+#endif
+      }
+#endif // __SSE2__
+
+      /*********************************************************
+       * scanSpace returns the length of the whitespace prefix *
+       * of p[0..n); scanToken the length of the non-          *
+       * whitespace prefix.  Together they tokenize a buffer   *
+       * without touching bytes twice.                         *
+       * ******************************************************/
+      inline std::size_t scanSpace(const char *p, std::size_t n) {
+         std::size_t i = 0;
+#if defined(__SSE2__)
+         while(i + 16 <= n) {
+            __m128i block = _mm_loadu_si128(
+               reinterpret_cast<const __m128i *>(p + i));
+            int mask = spaceMask_(block);
+            if(mask != 0xFFFF) {
+               return i + firstBit_(~mask & 0xFFFF);
+            }
+            i += 16;
+         }
+#endif
+         while(i < n && isTokenSpace(static_cast<unsigned char>(p[i]))) {
+            i++;
+         }
+         return i;
+      }
+
+      inline std::size_t scanToken(const char *p, std::size_t n) {
+         std::size_t i = 0;
+#if defined(__SSE2__)
+         while(i + 16 <= n) {
+            __m128i block = _mm_loadu_si128(
+               reinterpret_cast<const __m128i *>(p + i));
+            int mask = spaceMask_(block);
+            if(mask != 0) {
+               return i + firstBit_(mask);
+            }
+            i += 16;
+         }
+#endif
+         while(i < n && !isTokenSpace(static_cast<unsigned char>(p[i]))) {
+            i++;
+         }
+         return i;
+      }
+   } // namespace tokenscan
+} // namespace MapReduce
+
+#endif // MR_TOKEN_SCAN_HPP
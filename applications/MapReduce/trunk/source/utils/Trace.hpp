@@ -0,0 +1,155 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_TRACE_HPP
+#define MR_TRACE_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sys/time.h>
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+/*********************************************************
+ * Trace records compact binary events (task start/end,  *
+ * flush, protocol step) into a fixed-size in-memory     *
+ * ring and appends the sealed ring to a local file at   *
+ * task boundaries.  One event is a clock read plus a    *
+ * 16-byte store behind a mutex, so tracing stays on in  *
+ * production where SAGA_VERBOSE-level logging visibly   *
+ * slows the worker.  The ring overwrites its oldest     *
+ * events when a task produces more than fit; the drop   *
+ * count survives as an event of its own.                *
+ *                                                       *
+ * The file is raw host-order structs behind a small     *
+ * magic header - mapreduce_traceview (source/trace)     *
+ * merges the files of all workers into one job timeline.*
+ * ******************************************************/
+namespace MapReduce {
+
+   enum TraceEventKind {
+      TRACE_MAP_START    = 1,  //arg: chunks in the batch
+      TRACE_MAP_END      = 2,
+      TRACE_REDUCE_START = 3,  //arg: partition
+      TRACE_REDUCE_END   = 4,  //arg: partition
+      TRACE_FLUSH_START  = 5,  //value: bytes handed over
+      TRACE_FLUSH_END    = 6,
+      TRACE_COMMIT       = 7,  //arg: batch sequence number
+      TRACE_PROTOCOL     = 8,  //value: wire message type
+      TRACE_DROPPED      = 9   //value: events lost to ring overflow
+   };
+
+   struct TraceEvent {
+      boost::uint64_t usec;  //wall clock, microseconds since the epoch
+      boost::uint32_t value; //kind-specific payload (bytes, msg type, ...)
+      boost::uint16_t kind;  //TraceEventKind
+      boost::uint16_t arg;   //kind-specific small argument (partition, ...)
+   };
+
+   //File header: magic, format version, event size.  The events are
+   //host order; traces are merged on a login node of the same
+   //architecture, which is how the stderr files were collected too.
+   struct TraceFileHeader {
+      char            magic[4];   //"MRTR"
+      boost::uint16_t version;
+      boost::uint16_t eventSize;
+   };
+
+   class Trace {
+     public:
+      static const std::size_t DEFAULT_CAPACITY = 16384; //256 KB ring
+
+      Trace(std::string const &path, std::size_t capacity = DEFAULT_CAPACITY)
+         : path_(path), ring_(capacity), head_(0), size_(0), dropped_(0)
+      {}
+
+      /*********************************************************
+       * record stamps one event.  Cheap enough for every      *
+       * flush and protocol step; not meant for per-record     *
+       * rates.                                                *
+       * ******************************************************/
+      void record(TraceEventKind kind, unsigned arg = 0,
+                  unsigned long value = 0) {
+         TraceEvent ev;
+         ev.usec  = now_();
+         ev.value = (boost::uint32_t)value;
+         ev.kind  = (boost::uint16_t)kind;
+         ev.arg   = (boost::uint16_t)arg;
+         boost::mutex::scoped_lock lock(mutex_);
+         ring_[head_] = ev;
+         head_ = (head_ + 1) % ring_.size();
+         if(size_ < ring_.size()) {
+            size_++;
+         }
+         else {
+            dropped_++;
+         }
+      }
+
+      /*********************************************************
+       * flush appends the sealed ring to the trace file and   *
+       * empties it.  Called at task boundaries, where one     *
+       * buffered write costs nothing against the task time.   *
+       * ******************************************************/
+      void flush(void) {
+         std::vector<TraceEvent> sealed;
+         {
+            boost::mutex::scoped_lock lock(mutex_);
+            if(size_ == 0 && dropped_ == 0) {
+               return;
+            }
+            sealed.reserve(size_ + 1);
+            std::size_t first = (head_ + ring_.size() - size_) % ring_.size();
+            for(std::size_t i = 0; i < size_; i++) {
+               sealed.push_back(ring_[(first + i) % ring_.size()]);
+            }
+            if(dropped_ != 0) {
+               TraceEvent ev;
+               ev.usec  = now_();
+               ev.value = (boost::uint32_t)dropped_;
+               ev.kind  = TRACE_DROPPED;
+               ev.arg   = 0;
+               sealed.push_back(ev);
+            }
+            head_ = 0;
+            size_ = 0;
+            dropped_ = 0;
+         }
+         std::ofstream file(path_.c_str(),
+            std::ios::binary | std::ios::app | std::ios::ate);
+         if(!file) {
+            return; //tracing must never take the worker down
+         }
+         if(file.tellp() == std::ofstream::pos_type(0)) {
+            TraceFileHeader header;
+            header.magic[0] = 'M'; header.magic[1] = 'R';
+            header.magic[2] = 'T'; header.magic[3] = 'R';
+            header.version   = 1;
+            header.eventSize = (boost::uint16_t)sizeof(TraceEvent);
+            file.write(reinterpret_cast<char const *>(&header),
+                       sizeof(header));
+         }
+         file.write(reinterpret_cast<char const *>(&sealed[0]),
+                    sealed.size() * sizeof(TraceEvent));
+      }
+
+     private:
+      static boost::uint64_t now_(void) {
+         struct timeval tv;
+         gettimeofday(&tv, 0);
+         return (boost::uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+      }
+
+      std::string             path_;
+      std::vector<TraceEvent> ring_;
+      std::size_t             head_;    //next slot to write
+      std::size_t             size_;    //valid events in the ring
+      std::size_t             dropped_; //overwritten since last flush
+      boost::mutex            mutex_;
+   };
+} //Namespace MapReduce
+
+#endif // MR_TRACE_HPP
@@ -0,0 +1,111 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_TUNING_HPP
+#define MR_TUNING_HPP
+
+#include <cstddef>
+#include <boost/cstdint.hpp>
+#include "defines.hpp"
+
+/*********************************************************
+ * Runtime-tunable framework parameters.  These used to  *
+ * be compile-time constants in defines.hpp, which meant *
+ * one differently-built binary per cluster; now every   *
+ * value is seeded from the old default and can be       *
+ * overridden through the config file (see the <Tuning>  *
+ * section in ConfigFileParser) or autotuned.  The       *
+ * master publishes the agreed values as attributes on   *
+ * the session advert directory, and the workers adopt   *
+ * them before sizing any per-partition state - the      *
+ * partition count in particular must match on both      *
+ * sides.                                                *
+ * ******************************************************/
+namespace MapReduce {
+   namespace tuning {
+      // number of reduce partitions (and per-worker map output files)
+      inline int &numMaps(void) {
+         static int value = DEFAULT_NUM_MAPS;
+         return value;
+      }
+      // intermediate store key count that triggers a flush
+      inline std::size_t &maxIntermediateSize(void) {
+         static std::size_t value = DEFAULT_MAX_INTERMEDIATE_SIZE;
+         return value;
+      }
+      // concurrent map threads inside one worker
+      inline int &numMapThreads(void) {
+         static int value = DEFAULT_NUM_MAP_THREADS;
+         return value;
+      }
+      // chunks handed to a worker per conversation
+      inline std::size_t &chunkBatchSize(void) {
+         static std::size_t value = DEFAULT_CHUNK_BATCH_SIZE;
+         return value;
+      }
+      // final input share (percent) handed out in shrinking batches,
+      // bounding the straggler tail (see batchTarget_ in HandleMaps);
+      // 0 turns the taper off and every batch stays full sized
+      inline int &chunkTaperPercent(void) {
+         static int value = DEFAULT_CHUNK_TAPER_PERCENT;
+         return value;
+      }
+      // master-side worker conversation threads
+      inline int &numDispatchThreads(void) {
+         static int value = DEFAULT_NUM_DISPATCH_THREADS;
+         return value;
+      }
+
+      /*********************************************************
+       * Sizes the partition count from the job input volume:  *
+       * one reduce partition per ~64MB of input keeps the     *
+       * merge width and the per-partition file count sane on  *
+       * both small and large jobs.  Unknown volume (0) keeps  *
+       * the default.                                          *
+       * ******************************************************/
+      inline int autotuneNumMaps(boost::uint64_t totalInputBytes) {
+         static const boost::uint64_t bytesPerPartition = 64ULL << 20;
+         if(totalInputBytes == 0) {
+            return DEFAULT_NUM_MAPS;
+         }
+         boost::uint64_t n = totalInputBytes / bytesPerPartition + 1;
+         if(n < DEFAULT_NUM_MAPS) {
+            n = DEFAULT_NUM_MAPS;
+         }
+         if(n > 256) {
+            n = 256;
+         }
+         return (int)n;
+      }
+      /*********************************************************
+       * Sizes the flush threshold from the worker's RAM: the  *
+       * intermediate stores (one per map thread, double       *
+       * buffered against the flusher) should together use a   *
+       * fraction of the node, assuming a conservative few     *
+       * hundred bytes per key with values.  Unknown RAM (0)   *
+       * keeps the default.                                    *
+       * ******************************************************/
+      inline std::size_t autotuneMaxIntermediateSize(boost::uint64_t totalMemoryBytes) {
+         static const boost::uint64_t bytesPerKey = 512;
+         static const boost::uint64_t memoryFraction = 8;
+         if(totalMemoryBytes == 0) {
+            return DEFAULT_MAX_INTERMEDIATE_SIZE;
+         }
+         boost::uint64_t stores = 2 * (boost::uint64_t)numMapThreads();
+         boost::uint64_t keys = totalMemoryBytes
+                              / (memoryFraction * stores * bytesPerKey);
+         if(keys < DEFAULT_MAX_INTERMEDIATE_SIZE) {
+            keys = DEFAULT_MAX_INTERMEDIATE_SIZE;
+         }
+         if(keys > (64ULL << 20)) {
+            keys = 64ULL << 20;
+         }
+         return (std::size_t)keys;
+      }
+   } // namespace tuning
+} // namespace MapReduce
+
+#endif // MR_TUNING_HPP
+
@@ -24,22 +24,17 @@
 #define ATTR_EXE_ARCH              "EXE_ARCH"
 #define ATTR_EXE_LOCATION          "EXE_LOCATION"
                                 
-#define MASTER_QUESTION_STATE      "STATE?"
-#define MASTER_QUESTION_ADVERT     "ADVERT?"
-#define MASTER_QUESTION_LOCATION   "LOCATION?"
-#define MASTER_QUESTION_RESULT     "RESULT?"
-#define MASTER_REQUEST_IDLE        "IDLE!"
-
-#define WORKER_RESPONSE_ACKNOLEDGE "ACKNOLEDGE"
-#define WORKER_RESPONSE_REJECT     "REJECT"
-#define WORKER_CHUNK               "CHUNK"
-
 #define ADVERT_DIR_WORKERS         "WORKERS"
 #define ADVERT_DIR_BINARIES        "BINARIES"
 #define ADVERT_DIR_CHUNKS          "CHUNKS"
 #define ADVERT_DIR_INTERMEDIATE    "INTERMEDIATE"
 #define ADVERT_DIR_REDUCE_INPUT    "REDUCE_INPUT"
 #define ADVERT_ENTRY_SERVER        "SERVER" //Server entry storing stream info of master
+#define ADVERT_ENTRY_MANIFEST      "MANIFEST" //Per-partition list of reduce input URLs
+#define ADVERT_ENTRY_ROSTER        "ROSTER" //Session-level worker membership, one advert url per line
+#define ADVERT_ENTRY_STATUS        "STATUS" //Session-level phase summary, one "name value" pair per line
+#define ADVERT_ENTRY_MAP_MANIFEST  "MAP_MANIFEST" //Per-worker packed map manifest, "<partition> <segment>" per line
+#define ADVERT_ENTRY_REDUCE_MANIFEST "REDUCE_MANIFEST" //Session-level reduce output fingerprints, "<partition> <fnv64> <bytes> <url>" per line
 
 #define WORKER_COMMAND_PAUSE       "PAUSE"   // Pause the current job
 #define WORKER_COMMAND_RESUME      "RESUME"  // Resume the current job
@@ -48,6 +43,30 @@
 #define WORKER_COMMAND_MAP         "MAP"     // Run a map on file
 #define WORKER_COMMAND_REDUCE      "REDUCE"  // Run a reduce on files 
 
+// Message types for the framed worker protocol (see common/wire.hpp).
+// Each conversation step is one frame; payloads travel as message parts
+// instead of newline-joined blobs, and a whole assignment is one write.
+#define MSG_QUESTION_STATE   1   // master->worker, no payload
+#define MSG_QUESTION_ADVERT  2   // master->worker, no payload
+#define MSG_QUESTION_RESULT  3   // master->worker, no payload
+#define MSG_REQUEST_IDLE     4   // master->worker, no payload
+#define MSG_ACKNOLEDGE       5   // worker->master, no payload
+#define MSG_REJECT           6   // worker->master, no payload
+#define MSG_STATE            7   // worker->master, part 0 = WORKER_STATE_*
+#define MSG_ADVERT           8   // worker->master, part 0 = advert url
+#define MSG_RESULT           9   // worker->master, one part per finished chunk
+#define MSG_ASSIGN_MAP      10   // master->worker, one part per chunk
+                                 // replica spec (see ReplicaSpec.hpp)
+#define MSG_ASSIGN_REDUCE   11   // master->worker, part 0 = partition number
+#define MSG_QUIT            12   // master->worker, no payload
+
+// Peer shuffle (see utils/Shuffle.hpp): reducers pull committed
+// segments straight from the mapper that wrote them
+#define MSG_SHUFFLE_FETCH   13   // reducer->mapper, part 0 = segment name
+#define MSG_SHUFFLE_DATA    14   // mapper->reducer, part 0 = one block
+#define MSG_SHUFFLE_END     15   // mapper->reducer, no payload
+#define MSG_SHUFFLE_MISS    16   // mapper->reducer, segment not served here
+
 #define WORKER_STATE_IDLE          "IDLE"         // Ready to Map or Reduce
 #define WORKER_STATE_DONE_MAP      "DONE_MAP"     // Done with assigned task
 #define WORKER_STATE_DONE_REDUCE   "DONE_REDUCE"  // Done with assigned task
@@ -55,8 +74,25 @@
 #define WORKER_STATE_MAPPING       "MAPPING"      // Currently Mapping
 #define WORKER_STATE_REDUCING      "REDUCING"     // Currently Reducing
 
-#define NUM_MAPS 3
-#define MAX_INTERMEDIATE_SIZE 160253
+// Tuning defaults.  The live values are runtime-configurable (and
+// partly autotuned) through utils/Tuning.hpp and the config file's
+// <Tuning> section; these constants only seed them.
+#define DEFAULT_NUM_MAPS 3
+#define DEFAULT_NUM_DISPATCH_THREADS 16
+#define DEFAULT_CHUNK_BATCH_SIZE 8    // Chunks handed to a worker per conversation
+#define DEFAULT_CHUNK_TAPER_PERCENT 15 // Final input share (percent) mapped with shrinking batches
+#define DEFAULT_NUM_MAP_THREADS 4     // Concurrent map threads inside one worker
+#define DEFAULT_MAX_INTERMEDIATE_SIZE 160253
+#define INTERMEDIATE_COMPRESSION 1 // Block-compress map output (0 = raw records)
+
+// Session attributes carrying the agreed tuning values from the master
+// to the workers (set on the session base directory)
+#define ATTR_TUNE_NUM_MAPS          "TUNE_NUM_MAPS"
+#define ATTR_TUNE_MAP_THREADS       "TUNE_MAP_THREADS"
+#define ATTR_TUNE_MAX_INTERMEDIATE  "TUNE_MAX_INTERMEDIATE"
+#define ATTR_TUNE_AUTOTUNE          "TUNE_AUTOTUNE"
+#define WORKER_TIMEOUT 30         // Seconds without keepalive before a worker is dead
+#define WORKER_SWEEP_INTERVAL 5   // Seconds between failure detector sweeps
 
 #define LOGLEVEL_FATAL     0x2   
 #define LOGLEVEL_ERROR     0x4  
@@ -1,10 +1,13 @@
 //  Copyright (c) 2008 Michael Miceli and Christopher Miceli
-// 
-//  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
+#include <cstring>
 #include <saga/saga.hpp>
 #include <boost/iostreams/stream.hpp>
+#include <boost/shared_ptr.hpp>
+#include "LocalFile.hpp"
 
 #ifndef MR_TYPE_HPP
 #define MR_TYPE_HPP
@@ -12,29 +15,76 @@
 class saga_file_device
 {
   private:
-    std::string            src_;
-    saga::filesystem::file file_;
+    std::string                                        src_;
+    boost::shared_ptr <saga::filesystem::file>         file_;
+    boost::shared_ptr <MapReduce::localfile::mmap_view> map_;
+    boost::iostreams::stream_offset                    pos_;  //cursor into the mapping
+
+    void open_ (void)
+    {
+      //Local fast lane: a source that resolves to a file on this
+      //host is memory mapped with sequential advice, so reads
+      //below become plain page-cache copies instead of one saga
+      //call per refill
+      std::string path (MapReduce::localfile::localPath (src_));
+
+      if ( ! path.empty () )
+      {
+        map_.reset (new MapReduce::localfile::mmap_view (path));
+
+        if ( map_->valid () )
+        {
+          return;
+        }
+
+        map_.reset ();
+      }
+
+      file_.reset (new saga::filesystem::file (saga::url (src_),
+                                               saga::filesystem::Read));
+    }
 
   public:
     typedef char                                   char_type;
     typedef boost::iostreams::seekable_device_tag  category;
 
     saga_file_device (std::string src)   //Default constructor creates a file from a string
-      : src_  (src),
-        file_ (saga::url (src_), 
-               saga::filesystem::Read)
+      : src_ (src),
+        pos_ (0)
     {
+      open_ ();
     }
 
     saga_file_device (saga::filesystem::file f) //Defalt constructor that creates a file
-      : file_ (f)
+      : file_ (new saga::filesystem::file (f)),
+        pos_  (0)
     {
-      src_ = file_.get_url ().get_string ();
+      src_ = file_->get_url ().get_string ();
     }
 
     std::streamsize read (char_type * data, std::streamsize size) //required for boost::iostreams
     {
-      saga::ssize_t res = file_.read (saga::buffer (data, size), size);
+      if ( map_ )
+      {
+        boost::iostreams::stream_offset left = map_->size () - pos_;
+
+        if ( left <= 0 )
+        {
+          return -1;  //EOF
+        }
+
+        if ( size > left )
+        {
+          size = static_cast <std::streamsize> (left);
+        }
+
+        std::memcpy (data, map_->data () + pos_, size);
+        pos_ += size;
+
+        return size;
+      }
+
+      saga::ssize_t res = file_->read (saga::buffer (data, size), size);
 
       return static_cast <std::streamsize> (res);
     }
@@ -48,32 +98,71 @@ class saga_file_device
     }
 
     boost::iostreams::stream_offset seek   //required for boost::iostreams
-      (boost::iostreams::stream_offset off, 
+      (boost::iostreams::stream_offset off,
        std::ios_base::seekdir          whence)
       {
+        if ( map_ )
+        {
+          boost::iostreams::stream_offset next;
+
+          if ( whence == std::ios_base::beg )
+          {
+            next = off;
+          }
+          else if ( whence == std::ios_base::cur )
+          {
+            next = pos_ + off;
+          }
+          else// if ( whence == std::ios_base::end )
+          {
+            next = static_cast <boost::iostreams::stream_offset> (map_->size ()) + off;
+          }
+
+          if ( next < 0 )
+          {
+            next = 0;
+          }
+
+          if ( next > static_cast <boost::iostreams::stream_offset> (map_->size ()) )
+          {
+            next = map_->size ();
+          }
+
+          pos_ = next;
+
+          return pos_;
+        }
+
         saga::filesystem::seek_mode mode;
 
         if ( whence == std::ios_base::beg )
         {
           mode = saga::filesystem::Start;
-        } 
+        }
         else if ( whence == std::ios_base::cur )
         {
           mode = saga::filesystem::Current;
-        } 
+        }
         else// if ( whence == std::ios_base::end )    //Did this to stop compiler from complaining
         {
           mode = saga::filesystem::End;
         }
 
-        saga::off_t res = file_.seek (off, mode);
+        saga::off_t res = file_->seek (off, mode);
 
         return static_cast <boost::iostreams::stream_offset> (res);
       }
 
-    saga::filesystem::file get_saga_file (void) 
+    saga::filesystem::file get_saga_file (void)
     {
-      return file_; 
+      //opened on demand - the local fast lane never needs it
+      if ( ! file_ )
+      {
+        file_.reset (new saga::filesystem::file (saga::url (src_),
+                                                 saga::filesystem::Read));
+      }
+
+      return *file_;
     }
 };
 
@@ -0,0 +1,194 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_INTERMEDIATE_STORE_HPP
+#define MR_INTERMEDIATE_STORE_HPP
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+/*********************************************************
+ * IntermediateStore is an arena-backed key/value store  *
+ * for the map phase.  Key and value bytes are bump-     *
+ * allocated out of large blocks, keys are indexed with  *
+ * an open-addressing hash table, and the whole store is *
+ * torn down wholesale in clear(), so the hot emit path  *
+ * performs no per-record heap allocation.               *
+ * ******************************************************/
+namespace MapReduce {
+   class IntermediateStore {
+     public:
+      //One value of a key, allocated in the arena and chained
+      //in emit order.
+      struct ValueRef {
+         const char *data;
+         std::size_t size;
+         ValueRef   *next;
+      };
+
+      explicit IntermediateStore(std::size_t expectedKeys = 1024)
+         : mask_(roundUp_(expectedKeys * 2) - 1),
+           buckets_(mask_ + 1, npos_), blockUsed_(BLOCK_SIZE)
+      {}
+
+      ~IntermediateStore() {
+         freeBlocks_();
+      }
+
+      std::size_t keyCount() const { return entries_.size(); }
+      bool empty()           const { return entries_.empty(); }
+
+      //findOrInsert interns the key (copying it into the arena on
+      //first sight) and returns its dense id.
+      std::size_t findOrInsert(std::string const &key, bool &isNew) {
+         if(entries_.size() * 2 > mask_) {
+            grow_();
+         }
+         std::size_t h = hash_(key.data(), key.size());
+         std::size_t b = h & mask_;
+         while(buckets_[b] != npos_) {
+            Entry const &e = entries_[buckets_[b]];
+            if(e.keySize == key.size() &&
+               std::memcmp(e.key, key.data(), key.size()) == 0) {
+               isNew = false;
+               return buckets_[b];
+            }
+            b = (b + 1) & mask_;
+         }
+         Entry e;
+         e.key     = copyIn_(key.data(), key.size());
+         e.keySize = key.size();
+         e.head    = 0;
+         e.tail    = 0;
+         entries_.push_back(e);
+         buckets_[b] = entries_.size() - 1;
+         isNew = true;
+         return entries_.size() - 1;
+      }
+
+      //appendValue copies the value into the arena and chains it
+      //onto the key's value list.
+      void appendValue(std::size_t id, std::string const &value) {
+         ValueRef *node = reinterpret_cast<ValueRef *>(
+                             allocate_(sizeof(ValueRef)));
+         node->data = copyIn_(value.data(), value.size());
+         node->size = value.size();
+         node->next = 0;
+         Entry &e = entries_[id];
+         if(e.tail) { e.tail->next = node; }
+         else       { e.head       = node; }
+         e.tail = node;
+      }
+
+      std::string lastValue(std::size_t id) const {
+         ValueRef const *tail = entries_[id].tail;
+         return std::string(tail->data, tail->size);
+      }
+
+      //replaceLast overwrites the key's newest value (used by the
+      //combiner).  The superseded bytes stay in the arena until
+      //clear(); that waste is bounded by one value per combine.
+      void replaceLast(std::size_t id, std::string const &value) {
+         ValueRef *tail = entries_[id].tail;
+         tail->data = copyIn_(value.data(), value.size());
+         tail->size = value.size();
+      }
+
+      std::string key(std::size_t id) const {
+         return std::string(entries_[id].key, entries_[id].keySize);
+      }
+
+      ValueRef const *values(std::size_t id) const {
+         return entries_[id].head;
+      }
+
+      //clear drops all keys and values at once: every block but the
+      //first is released and the bump pointer rewinds.
+      void clear() {
+         entries_.clear();
+         std::fill(buckets_.begin(), buckets_.end(), npos_);
+         while(blocks_.size() > 1) {
+            std::free(blocks_.back());
+            blocks_.pop_back();
+         }
+         blockUsed_ = blocks_.empty() ? BLOCK_SIZE : 0;
+      }
+
+     private:
+      static const std::size_t BLOCK_SIZE = 1 << 20;
+      static const std::size_t npos_ = static_cast<std::size_t>(-1);
+
+      struct Entry {
+         const char *key;
+         std::size_t keySize;
+         ValueRef   *head;
+         ValueRef   *tail;
+      };
+
+      static std::size_t roundUp_(std::size_t n) {
+         std::size_t p = 64;
+         while(p < n) { p <<= 1; }
+         return p;
+      }
+
+      //FNV-1a, much better spread than a character sum
+      static std::size_t hash_(const char *data, std::size_t size) {
+         std::size_t h = 2166136261u;
+         for(std::size_t i = 0; i < size; i++) {
+            h ^= static_cast<unsigned char>(data[i]);
+            h *= 16777619u;
+         }
+         return h;
+      }
+
+      char *allocate_(std::size_t size) {
+         //Keep ValueRef nodes aligned
+         size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+         if(blockUsed_ + size > BLOCK_SIZE) {
+            blocks_.push_back(static_cast<char *>(
+               std::malloc(size > BLOCK_SIZE ? size : BLOCK_SIZE)));
+            blockUsed_ = 0;
+         }
+         char *out = blocks_.back() + blockUsed_;
+         blockUsed_ += size;
+         return out;
+      }
+
+      const char *copyIn_(const char *data, std::size_t size) {
+         char *out = allocate_(size ? size : 1);
+         std::memcpy(out, data, size);
+         return out;
+      }
+
+      void grow_() {
+         mask_ = (mask_ << 1) | 1;
+         buckets_.assign(mask_ + 1, npos_);
+         for(std::size_t i = 0; i < entries_.size(); i++) {
+            std::size_t b = hash_(entries_[i].key, entries_[i].keySize) & mask_;
+            while(buckets_[b] != npos_) {
+               b = (b + 1) & mask_;
+            }
+            buckets_[b] = i;
+         }
+      }
+
+      void freeBlocks_() {
+         for(std::size_t i = 0; i < blocks_.size(); i++) {
+            std::free(blocks_[i]);
+         }
+         blocks_.clear();
+      }
+
+      std::vector<Entry>       entries_;
+      std::size_t              mask_;
+      std::vector<std::size_t> buckets_;
+      std::vector<char *>      blocks_;
+      std::size_t              blockUsed_;
+   };
+} //namespace MapReduce
+
+#endif // MR_INTERMEDIATE_STORE_HPP
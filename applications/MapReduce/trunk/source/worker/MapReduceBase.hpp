@@ -8,15 +8,35 @@
 
 #include <vector>
 #include <string>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
 #include <time.h>
+#include <sys/stat.h>
 #include <saga/saga.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
 #include "unorderedMap.hpp"
+#include "IntermediateStore.hpp"
+#include "Partitioner.hpp"
+#include "../utils/RecordIO.hpp"
+#include "../utils/BlockCompressor.hpp"
 #include "../utils/LogWriter.hpp"
 #include "../utils/defines.hpp"
+#include "../utils/ReplicaSpec.hpp"
+#include "../utils/Tuning.hpp"
+#include "../utils/high_resolution_timer.hpp"
+#include "../utils/Checksum.hpp"
+#include "../utils/Trace.hpp"
+#include "../utils/Shuffle.hpp"
 #include "RunReduce.hpp"
 #include "SystemInfo.hpp"
 #include "parseCommand.hpp"
+#include "../../../../common/wire.hpp"
+#include "../../../../common/worker_runtime.hpp"
 
 namespace MapReduce {
    template<typename Derived>
@@ -42,15 +62,21 @@ namespace MapReduce {
          uuid_         = saga::uuid().string();
          logWriter_    = new LogWriter(MR_WORKER_EXE_NAME, logURL_);
          state_        = WORKER_STATE_IDLE;
-         int mode = saga::filesystem::Write | saga::filesystem::Create;
-         for(int x=0;x<NUM_MAPS;x++) {
-            saga::url mapFile(outputPrefix_ + "/mapFile_" + boost::lexical_cast<std::string>(x) + "_" + uuid_);
-            saga::filesystem::file f(mapFile, mode);
-            mapFiles_.push_back(f);
-            saga::url reduceFile(outputPrefix_ + "/mapFile-reduce_" + boost::lexical_cast<std::string>(x) + "_" + uuid_);
-            saga::filesystem::file g(reduceFile, mode);
-            reduceFiles_.push_back(g);
-         }
+         commitSeq_    = 0;
+         partitioner_.reset(new HashPartitioner());
+         //Always-on binary trace, merged across workers by
+         //mapreduce_traceview; one file per worker next to the
+         //stderr redirect
+         trace_.reset(new Trace("/tmp/mapreduce-trace-" + uuid_ + ".trc"));
+         //Committed segments keep a local spill copy here, served to
+         //reducers by the peer shuffle server; if the directory cannot
+         //be made the spill opens fail and the annotation is skipped
+         spillDir_ = "/tmp/mapreduce-shuffle-" + uuid_;
+         ::mkdir(spillDir_.c_str(), 0700);
+         shuffleDisabled_ = false;
+         //Per-partition state is sized in initPartitionState_, once
+         //registerWithDB has adopted the session's partition count;
+         //output files come into being on first write
       }
       ~MapReduceBase() {
       }
@@ -76,85 +102,78 @@ namespace MapReduce {
          return 0;
       }
       /*********************************************************
-       * The default hash function to split keys into different*
-       * files after mapping.  No real reason to use this one, *
-       * but it does the job.                                  *
+       * hash splits keys into different files after mapping by*
+       * delegating to the configured partitioner.  The default*
+       * is HashPartitioner; setPartitioner installs e.g. a    *
+       * RangePartitioner for totally ordered output.          *
        * ******************************************************/
       int hash(std::string const &input, unsigned int limit) {
-         int sum = 0, retval;
-         std::size_t length = input.length();
-         for(std::size_t count = 0; count < length; count++) {
-            sum = sum + input[count];
-         }
-         retval = (sum % limit);
-         return retval;
+         return partitioner_->partition(input, limit);
+      }
+      void setPartitioner(boost::shared_ptr<Partitioner> partitioner) {
+         partitioner_ = partitioner;
       }
 
       void writeIntermediate(void) {
-         unorderedMap::iterator mapIt = intermediate_.begin();
-         unorderedMap::iterator end = intermediate_.end();
-         std::string intermediateData[NUM_MAPS];
-         while(mapIt != end) {
-            std::string const &intermediateKey = mapIt->first;
-            int hash_value = hash(intermediateKey, NUM_MAPS);
-            intermediateData[hash_value].append(intermediateKey);
-            intermediateData[hash_value].append(" ");
-            intermediateData[hash_value].append((*(mapIt->second))[0]);
-            std::size_t size = mapIt->second->size();
-            for(unsigned int x = 1; x < size; x++) {
-               intermediateData[hash_value].append(", ");
-               intermediateData[hash_value].append((*(mapIt->second))[x]);
-            }
-            mapIt++;
-            intermediateData[hash_value].append(";\n");
-         }
-         for(int counter = 0; counter < NUM_MAPS; counter++)
-         {
-            mapFiles_[counter].write(saga::buffer(intermediateData[counter], intermediateData[counter].length()));
-         }
-         intermediate_.clear();
+         writeStore_(currentStore_());
+      }
+      /*********************************************************
+       * combine is the optional local-reduce (combiner) hook. *
+       * A derived class shadows this with its own version to  *
+       * collapse two values of an associative reduction into  *
+       * one at emit time.  The default performs no combining. *
+       * \param combined receives the collapsed value          *
+       * \return true if combining took place                  *
+       * ******************************************************/
+      bool combine(std::string const &key,
+                   std::string const &oldValue,
+                   std::string const &newValue,
+                   std::string &combined) {
+         return false;
       }
       /*********************************************************
        * emitIntermediate is called inside the map function and*
        * handles writing the key value pairs to proper files   *
-       * and advertising these files.                          *
+       * and advertising these files.  When the derived class  *
+       * supplies a combiner, values collapse in place instead *
+       * of accumulating one string per record.                *
        * ******************************************************/
       void emitIntermediate(std::string const &key, std::string const &value) {
-         unorderedMap::iterator mapIt = intermediate_.begin();
-         unorderedMap::iterator end   = intermediate_.end();
-
-         if(intermediate_.empty() == true) {
-            intermediate_.rehash(MAX_INTERMEDIATE_SIZE);
-         }
-         if(intermediate_.find(key) == intermediate_.end()) {
+         IntermediateStore &store = currentStore_();
+         bool isNew;
+         std::size_t id = store.findOrInsert(key, isNew);
+         if(isNew) {
             //Not in structure
-            strVectorPtr initialValue(new std::vector<std::string>);
-            initialValue->push_back(value);
-            intermediate_[key] = initialValue;
+            store.appendValue(id, value);
          }
          else {
-               //Contained in structure
-               intermediate_[key]->push_back(value);
+            //Contained in structure, try the combiner first
+            std::string combined;
+            if(derived().combine(key, store.lastValue(id), value, combined)) {
+               store.replaceLast(id, combined);
+            }
+            else {
+               store.appendValue(id, value);
+            }
          }
-         if(intermediate_.size() >= MAX_INTERMEDIATE_SIZE) {
-            writeIntermediate();
+         if(store.keyCount() >= tuning::maxIntermediateSize()) {
+            writeStore_(store);
          }
       }
       /*********************************************************
        * emit is called from inside the reduce function and    *
-       * handles taking the output from reduce and writing it  *
-       * to the proper file.                                   *
+       * buffers the output per partition.  Only the bucket    *
+       * the key hashes into is touched; a bucket that fills   *
+       * up is handed to the background writer, so reduction   *
+       * continues while its bytes go out.                     *
        * ******************************************************/
       void emit(std::string const &key, std::string const& value) {
-         int hash_value = hash(key, NUM_MAPS);
-         reduceValueMessages_[hash_value] += key;
-         reduceValueMessages_[hash_value] += " " + value + "\n";
-         for(int counter = 0; counter < NUM_MAPS; counter++) {
-            if(reduceValueMessages_[counter].length() > 20000)
-            {
-               reduceFiles_[hash_value].write(saga::buffer(reduceValueMessages_[counter], reduceValueMessages_[counter].length()));
-               reduceValueMessages_[counter].clear();
-            }
+         int hash_value = hash(key, tuning::numMaps());
+         std::string &buffer = reduceValueMessages_[hash_value];
+         buffer += key;
+         buffer += " " + value + "\n";
+         if(buffer.length() > 20000) {
+            flushReduceOutput_(hash_value);
          }
       }
      private:
@@ -163,13 +182,35 @@ namespace MapReduce {
       saga::url    logURL_;
       std::string  database_;
       std::string  state_;
-      std::string  chunk_;  //File to map, set in getFrontendCommand
+      std::string  chunk_;  //First file of the current batch, kept
+                            //for log messages
+      std::vector<std::string> chunkBatch_; //Replica specs to map, set
+                                            //in getFrontendCommand_;
+                                            //results are reported back
+                                            //under these names
+      std::vector<std::string> chunkOpenBatch_; //The replica chosen for
+                                                //each spec - what map
+                                                //actually opens
       int          lastReduce_;
       std::string  outputPrefix_;
-      std::string  reduceValueMessages_[NUM_MAPS];
+      std::vector<std::string> reduceValueMessages_; //One buffer per
+                                                     //partition
       saga::url    serverURL_;
-      unorderedMap intermediate_;
+      //Shared worker lifecycle pieces (see common/worker_runtime.hpp):
+      //registration transaction, adaptive keepalive, command stream
+      worker_runtime::registry         registry_;
+      worker_runtime::heartbeat        heartbeat_;
+      worker_runtime::stream_transport transport_;
+      IntermediateStore intermediate_;
+      boost::shared_ptr<Partitioner> partitioner_;
+      std::vector<std::string> flushData_;  //Buffers owned by the flusher
+      boost::shared_ptr<boost::thread> flushThread_;
+      boost::mutex flushMutex_;             //Serializes buffer handover
+      boost::thread_specific_ptr<IntermediateStore> threadStore_;
+      boost::mutex batchMutex_;             //Guards batchNext_
+      std::vector<std::string>::size_type batchNext_;
       MapReduce::LogWriter *logWriter_;
+      boost::shared_ptr<Trace> trace_;
    
       time_t startupTime_;
       SystemInfo systemInfo_;
@@ -178,8 +219,38 @@ namespace MapReduce {
       saga::advert::directory intermediateDir_;
       saga::advert::directory chunksDir_;
       saga::advert::directory reduceInputDir_;
-      std::vector<saga::filesystem::file> mapFiles_;
-      std::vector<saga::filesystem::file> reduceFiles_;
+      //Output files are created lazily, on the first write into
+      //their partition; an empty slot is a file that was never
+      //needed
+      std::vector<boost::shared_ptr<saga::filesystem::file> > mapFiles_;
+      std::vector<std::string> mapTmpNames_;   //In-progress segment urls
+      std::vector<std::string> mapFinalNames_; //Urls after the rename
+      std::vector<std::string> mapBaseNames_;  //Segment basenames, double
+                                               //as spill and peer names
+      std::vector<bool> spillOk_;  //Whether the local spill copy of a
+                                   //partition is complete this batch
+      std::string spillDir_;
+      boost::shared_ptr<ShuffleServer> shuffleServer_;
+      bool shuffleDisabled_;  //Server could not start; stop retrying
+      std::string manifest_;  //Packed map manifest: one
+                              //"<partition> <segment>" line per
+                              //committed segment, all partitions in
+                              //a single advert entry
+      int          commitSeq_;          //Numbers the batch segments
+      std::vector<boost::shared_ptr<saga::filesystem::file> > reduceFiles_;
+      std::vector<std::string> reduceFileNames_; //Urls, set on first write
+      //Running fingerprint of each reduce output file, fed on the
+      //writer thread in write order, so it always matches the bytes
+      //on disk.  Reported with the reduce result; the master records
+      //it in the job manifest and nobody re-reads the file to verify
+      std::vector<Checksum> reduceChecksums_;
+      std::vector<unsigned long> reduceBytes_;
+      //Reduce-side counterpart of the map flusher: full emit buffers
+      //are swapped over and written by a background thread while the
+      //reduction keeps running
+      std::vector<std::string> reduceFlushData_;
+      boost::shared_ptr<boost::thread> reduceFlushThread_;
+      boost::mutex reduceFlushMutex_;   //Serializes buffer handover
       Derived& derived() {
          return static_cast<Derived&>(*this);
       }
@@ -189,33 +260,122 @@ namespace MapReduce {
        * to allow the master to know keepalive information.    *
        * ******************************************************/
       void updateStatus_(void) {
-         //(1) update the last seen (keep alive) timestamp 
-         time_t timestamp; time(&timestamp);
-         try {
-           workerDir_.set_attribute(ATTR_LAST_SEEN, 
-             boost::lexical_cast<std::string>(timestamp)); 
-         }
-         catch(saga::exception const & e) {
-           std::cerr << "FAILED (" << e.get_message() << ")" << std::endl;
-           throw;
-         }
-         //(2) update the current load average
+         //keepalive through the shared adaptive heartbeat: each due
+         //beat is one bulk write of LAST_SEEN plus the current load
+         //average; the cadence snaps to its minimum while work is in
+         //flight and backs off while the worker idles
          try {
-           workerDir_.set_attribute(ATTR_HOST_LOAD_AVG, 
-                                           systemInfo_.hostLoadAverage());
+           std::vector<std::pair<std::string, std::string> > extra;
+           extra.push_back(std::make_pair(std::string(ATTR_HOST_LOAD_AVG),
+             systemInfo_.hostLoadAverage()));
+           heartbeat_.beat(state_ != WORKER_STATE_IDLE, extra);
          }
          catch(saga::exception const & e) {
            std::cerr << "FAILED (" << e.get_message() << ")" << std::endl;
            throw;
          }
-         //(3) update execution status
-         std::cerr << "SUCCESSFUL" << std::endl;
       }
       /*********************************************************
        * Removes all temporary advert entries                  *
        * ******************************************************/
       void cleanup_(void) {
 
+      }
+      /*********************************************************
+       * initPartitionState_ sizes everything that exists once *
+       * per partition - called from registerWithDB, after the *
+       * session's partition count has been adopted.           *
+       * ******************************************************/
+      void initPartitionState_(void) {
+         reduceValueMessages_.resize(tuning::numMaps());
+         reduceFlushData_.resize(tuning::numMaps());
+         manifest_.clear();
+         //No files yet: map segments and reduce files alike are
+         //materialized on first write, so an idle worker costs the
+         //filesystem nothing but its advert entries at startup
+         reduceFiles_.resize(tuning::numMaps());
+         reduceFileNames_.resize(tuning::numMaps());
+         reduceChecksums_.assign(tuning::numMaps(), Checksum());
+         reduceBytes_.assign(tuning::numMaps(), 0);
+      }
+      /*********************************************************
+       * reduceFile_ materializes one reduce output file on its*
+       * first write.  A worker touches only the partitions its*
+       * reduce actually emits into - usually one - so creating*
+       * all of them up front just fed the metadata storm at   *
+       * job launch.                                           *
+       * ******************************************************/
+      saga::filesystem::file &reduceFile_(int partition) {
+         if(!reduceFiles_[partition]) {
+            int mode = saga::filesystem::Write | saga::filesystem::Create;
+            saga::url reduceFile(outputPrefix_ + "/mapFile-reduce_" + boost::lexical_cast<std::string>(partition) + "_" + uuid_);
+            reduceFiles_[partition].reset(
+               new saga::filesystem::file(reduceFile, mode));
+            reduceFileNames_[partition] = reduceFile.get_string();
+         }
+         return *reduceFiles_[partition];
+      }
+      /*********************************************************
+       * flushReduceOutput_ hands one full emit buffer to the  *
+       * background writer.  Like writeStore_ on the map side, *
+       * the handover waits out the previous write, so at most *
+       * one buffer generation is in flight.                   *
+       * ******************************************************/
+      void flushReduceOutput_(int partition) {
+         boost::mutex::scoped_lock lock(reduceFlushMutex_);
+         waitForReduceFlush_();
+         reduceFlushData_[partition].swap(reduceValueMessages_[partition]);
+         reduceFlushThread_.reset(new boost::thread(
+            boost::bind(&MapReduceBase::reduceFlush_, this)));
+      }
+      /*********************************************************
+       * drainReduceOutput_ writes whatever is still buffered  *
+       * at the end of the reduction and joins the writer -    *
+       * the reduce is only reported done once its output is   *
+       * on disk.                                              *
+       * ******************************************************/
+      void drainReduceOutput_(void) {
+         {
+            boost::mutex::scoped_lock lock(reduceFlushMutex_);
+            waitForReduceFlush_();
+            for(int counter = 0; counter < tuning::numMaps(); counter++) {
+               if(!reduceValueMessages_[counter].empty()) {
+                  reduceFlushData_[counter].swap(reduceValueMessages_[counter]);
+               }
+            }
+            reduceFlushThread_.reset(new boost::thread(
+               boost::bind(&MapReduceBase::reduceFlush_, this)));
+         }
+         waitForReduceFlush_();
+      }
+      /*********************************************************
+       * reduceFlush_ runs on the background thread and writes *
+       * the handed-over buffers to their reduce output files, *
+       * materializing files on first write as usual.          *
+       * ******************************************************/
+      void reduceFlush_(void) {
+         for(int counter = 0; counter < tuning::numMaps(); counter++) {
+            if(reduceFlushData_[counter].empty()) {
+               continue;
+            }
+            reduceFile_(counter).write(saga::buffer(reduceFlushData_[counter], reduceFlushData_[counter].length()));
+            //Fold the bytes into the running fingerprint as they go
+            //out; this thread is the only writer, so write order and
+            //checksum order agree
+            reduceChecksums_[counter].update(reduceFlushData_[counter]);
+            reduceBytes_[counter] += reduceFlushData_[counter].length();
+            reduceFlushData_[counter].clear();
+         }
+      }
+      /*********************************************************
+       * waitForReduceFlush_ joins any in-flight reduce output *
+       * write.                                                *
+       * ******************************************************/
+      void waitForReduceFlush_(void) {
+         if(reduceFlushThread_) {
+            reduceFlushThread_->join();
+            reduceFlushThread_.reset();
+         }
       }
       /*********************************************************
        * registerWithDB connects to the advert database and    *
@@ -223,41 +383,68 @@ namespace MapReduce {
        * attributes describing this session.                   *
        * ******************************************************/
       void registerWithDB(void) {
-         int mode = saga::advert::ReadWrite;
-         //(1) connect to the orchestrator database
-         std::string advertKey(database_ + "//" + sessionUUID_ + "/");
          try {
-            saga::advert::directory master = saga::advert::directory(advertKey, mode);
-            //(2a) create a directory for this agent
-            advertKey += ADVERT_DIR_WORKERS;
-            advertKey += "/" + uuid_ + "/";
-            workerDir_       = saga::advert::directory(advertKey, mode | saga::advert::Create);
-            intermediateDir_ = workerDir_.open_dir(saga::url(ADVERT_DIR_INTERMEDIATE), mode | saga::advert::Create);
-            chunksDir_       = workerDir_.open_dir(saga::url(ADVERT_DIR_CHUNKS)      , mode | saga::advert::Create);
-            reduceInputDir_  = workerDir_.open_dir(saga::url(ADVERT_DIR_REDUCE_INPUT), mode | saga::advert::Create);
-            state_ = WORKER_STATE_IDLE;
-            //(3) add some initial system information
-            workerDir_.set_attribute(ATTR_CPU_COUNT, 
-              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().nCpu));
-            workerDir_.set_attribute(ATTR_CPU_TYPE, 
-              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuType));
-            workerDir_.set_attribute(ATTR_CPU_SUBTYPE, 
-              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuSubtype));
-            workerDir_.set_attribute(ATTR_CPU_FREQ, 
-              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuFrequency));
-            workerDir_.set_attribute(ATTR_MEM_TOTAL, 
-              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().totalMemory));
-            workerDir_.set_attribute(ATTR_HOST_NAME,     systemInfo_.hostName());
-            workerDir_.set_attribute(ATTR_HOST_TYPE,     systemInfo_.hostType());
-            workerDir_.set_attribute(ATTR_HOST_LOAD_AVG, systemInfo_.hostLoadAverage());
-
-            //(4) set the last seen (keep alive) timestamp
+            //(1) register with the orchestrator database.  The shared
+            //worker runtime performs the whole transaction: session
+            //directory (through the handle cache), worker directory,
+            //system-info attribute bulk, and the master endpoint lookup
             time_t timestamp; time(&timestamp);
-            workerDir_.set_attribute(ATTR_LAST_SEEN, 
-              boost::lexical_cast<std::string>(timestamp));
+            std::vector<std::pair<std::string, std::string> > attributes;
+            attributes.push_back(std::make_pair(std::string(ATTR_CPU_COUNT),
+              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().nCpu)));
+            attributes.push_back(std::make_pair(std::string(ATTR_CPU_TYPE),
+              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuType)));
+            attributes.push_back(std::make_pair(std::string(ATTR_CPU_SUBTYPE),
+              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuSubtype)));
+            attributes.push_back(std::make_pair(std::string(ATTR_CPU_FREQ),
+              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().cpuFrequency)));
+            attributes.push_back(std::make_pair(std::string(ATTR_MEM_TOTAL),
+              boost::lexical_cast<std::string>(systemInfo_.hardwareInfo().totalMemory)));
+            attributes.push_back(std::make_pair(std::string(ATTR_HOST_NAME),
+              systemInfo_.hostName()));
+            attributes.push_back(std::make_pair(std::string(ATTR_HOST_TYPE),
+              systemInfo_.hostType()));
+            attributes.push_back(std::make_pair(std::string(ATTR_HOST_LOAD_AVG),
+              systemInfo_.hostLoadAverage()));
+            attributes.push_back(std::make_pair(std::string(ATTR_LAST_SEEN),
+              boost::lexical_cast<std::string>(timestamp)));
+            registry_.connect(database_, sessionUUID_, uuid_, attributes);
 
-            saga::advert::entry server_name(master.open(ADVERT_ENTRY_SERVER, mode));
-            serverURL_ = saga::url(server_name.retrieve_string());
+            saga::advert::directory &master = registry_.session_dir();
+            //(2) adopt the session's tuning before sizing any
+            //per-partition state - the partition count in particular
+            //must match the master's.  The flush threshold is either
+            //set explicitly, autotuned from this node's RAM, or left
+            //at its default
+            if(master.attribute_exists(ATTR_TUNE_NUM_MAPS)) {
+               tuning::numMaps() = boost::lexical_cast<int>(
+                  master.get_attribute(ATTR_TUNE_NUM_MAPS));
+            }
+            if(master.attribute_exists(ATTR_TUNE_MAP_THREADS)) {
+               tuning::numMapThreads() = boost::lexical_cast<int>(
+                  master.get_attribute(ATTR_TUNE_MAP_THREADS));
+            }
+            if(master.attribute_exists(ATTR_TUNE_MAX_INTERMEDIATE)) {
+               tuning::maxIntermediateSize() = boost::lexical_cast<std::size_t>(
+                  master.get_attribute(ATTR_TUNE_MAX_INTERMEDIATE));
+            }
+            else if(master.attribute_exists(ATTR_TUNE_AUTOTUNE)
+                    && master.get_attribute(ATTR_TUNE_AUTOTUNE) == "yes") {
+               tuning::maxIntermediateSize() = tuning::autotuneMaxIntermediateSize(
+                  systemInfo_.hardwareInfo().totalMemory);
+            }
+            initPartitionState_();
+            //(2a) adopt the registered worker directory and create the
+            //framework-specific subdirectories under it
+            workerDir_       = registry_.worker_dir();
+            intermediateDir_ = registry_.open_subdir(ADVERT_DIR_INTERMEDIATE);
+            chunksDir_       = registry_.open_subdir(ADVERT_DIR_CHUNKS);
+            reduceInputDir_  = registry_.open_subdir(ADVERT_DIR_REDUCE_INPUT);
+            heartbeat_.bind(workerDir_);
+            state_ = WORKER_STATE_IDLE;
+            //(3) the command endpoint came with the registration
+            serverURL_ = registry_.server_url();
+            transport_.set_url(serverURL_);
             std::cerr << "SERVER_URL = " << serverURL_.get_string() << std::endl;
          }
          catch(saga::exception const & e) {
@@ -276,64 +463,96 @@ namespace MapReduce {
             std::string command(getFrontendCommand_());
             //(1) read command from orchestrator
             if(command == WORKER_COMMAND_MAP) {
+               trace_->record(TRACE_MAP_START, chunkBatch_.size());
                try {
-                  d.map(chunk_); // Map the file given from the master
-                  writeIntermediate();
-                  try {
-                     int mode = saga::advert::Create | saga::advert::ReadWrite;
-                     for(int count = 0; count < NUM_MAPS; count++) {
-                        saga::advert::entry adv = intermediateDir_.open(saga::url("mapFile-"+boost::lexical_cast<std::string>(count)), mode);
-                        saga::url fileurl(outputPrefix_ + "mapFile_" + boost::lexical_cast<std::string>(count) + "_" + uuid_);
-                        adv.store_string(fileurl.get_string());
+                  //Every batch writes into a fresh set of temp
+                  //segments; nothing is visible until the commit
+                  openMapSegment_();
+                  // Map the batch with a pool of threads, each
+                  // filling a private store merged at flush time,
+                  // so one worker process saturates its node
+                  std::size_t poolSize = chunkBatch_.size();
+                  if(poolSize > (std::size_t)tuning::numMapThreads()) {
+                     poolSize = tuning::numMapThreads();
+                  }
+                  batchNext_ = 0;
+                  if(poolSize <= 1) {
+                     for(std::vector<std::string>::size_type b = 0;
+                         b < chunkBatch_.size(); b++) {
+                        d.map(chunkOpenBatch_[b]);
                      }
-                     state_ = WORKER_STATE_DONE_MAP;
                   }
-                  catch(saga::exception const & e) {
-                     throw;
+                  else {
+                     boost::thread_group mappers;
+                     for(std::size_t t = 0; t < poolSize; t++) {
+                        mappers.create_thread(boost::bind(
+                           &MapReduceBase::mapWorker_, this));
+                     }
+                     mappers.join_all();
                   }
+                  writeIntermediate();
+                  //The last buffers must be on disk before the
+                  //master learns the chunk is done
+                  waitForFlush_();
+                  commitMapSegment_();
+                  state_ = WORKER_STATE_DONE_MAP;
                }
                catch(saga::exception const& e) {
                   std::cerr << "FAILED (" << e.get_message() << ")" << std::endl;
                   workerDir_.set_attribute("STATE", WORKER_STATE_FAIL);
                }
+               //The batch is a task boundary: seal the ring so the
+               //trace survives even if the worker dies later
+               trace_->record(TRACE_MAP_END);
+               trace_->flush();
                //std::vector<std::string> output(mapHandler.getOutput());
             }
             else if(command == WORKER_COMMAND_REDUCE) {
+               trace_->record(TRACE_REDUCE_START, lastReduce_);
                try {
                   // Use the RunReduce class to handle details of getting
                   // and retrieving necessary information from the master.
                   closeMapFiles();
-                  RunReduce reduceHandler(workerDir_, reduceInputDir_, outputPrefix_);
-                 
-                  // Get a map of keys and a vector of the values
-                  unorderedMap keyValues;
-                  reduceHandler.getLines(keyValues);
-                  unorderedMap::const_iterator  keyValuesIT = keyValues.begin();
-                  // Iterate over these keys and their values and
-                  // reduce them by passing them to the user defined
-                  // reduce function
-                  while(keyValuesIT != keyValues.end()) {
-                     d.reduce(keyValuesIT->first, *(keyValuesIT->second));
-                     ++keyValuesIT;
-                  }
-                  for(int counter = 0; counter < NUM_MAPS; counter++) {
-                     reduceFiles_[counter].write(saga::buffer(reduceValueMessages_[counter], reduceValueMessages_[counter].length()));
-                     reduceValueMessages_[counter].clear();
+                  //Hand the reducer our host name so partitions that
+                  //were written on this machine skip the remote-file
+                  //layer (co-scheduled shuffles are mostly local)
+                  RunReduce reduceHandler(workerDir_, reduceInputDir_, outputPrefix_,
+                                          systemInfo_.hostName());
+
+                  // Stream merged key groups out of the sorted runs
+                  // and reduce them one at a time, so memory stays
+                  // bounded no matter how skewed the partition is
+                  std::string key;
+                  std::vector<std::string> values;
+                  while(reduceHandler.nextKeyGroup(key, values)) {
+                     d.reduce(key, values);
                   }
+                  //Most bytes went out overlapped with the reduction
+                  //(see emit); this only writes the buffer tails and
+                  //waits for the last background write
+                  drainReduceOutput_();
                   state_ = WORKER_STATE_DONE_REDUCE;
                }
                catch(saga::exception const& e) {
                   std::cerr << "FAILED (" << e.get_message() << ")" << std::endl;
                   state_ = WORKER_STATE_FAIL;
                }
+               trace_->record(TRACE_REDUCE_END, lastReduce_);
+               trace_->flush();
             }
             else if(command == WORKER_COMMAND_DISCARD) {
                cleanup_();
             }
             else if(command == WORKER_COMMAND_QUIT)
             {
+               //Reduces are done once the master says quit, so no
+               //peer can still want our segments
+               if(shuffleServer_) {
+                  shuffleServer_->stop();
+               }
                closeReduceFiles();
                cleanup_();
+               trace_->flush();
                return;
             }
             updateStatus_();
@@ -347,135 +566,518 @@ namespace MapReduce {
        * master, such as input files, etc.                     *
        * ******************************************************/
       std::string getFrontendCommand_(void) {
-         static int depth = 0;
-         char buff[255];
          try {
-            saga::stream::stream server_(serverURL_);
-            server_.connect();
-            saga::ssize_t read_bytes = server_.read(saga::buffer(buff));
-            std::string question(buff, read_bytes);
-            std::cerr << "QUESTION = " << question << std::endl;
-            if(question == MASTER_QUESTION_STATE) {
-               server_.write(saga::buffer(state_, state_.size()));
+            //One long-lived stream per worker; the shared transport
+            //(re)connects with exponential backoff on first use
+            saga::stream::stream &server_ = transport_.shared();
+            wire::receiver rx;
+            if(!rx.recv(server_)) {
+               //Master closed the connection between conversations
+               transport_.reset();
+               return std::string("");
+            }
+            trace_->record(TRACE_PROTOCOL, 0, rx.type());
+            if(rx.type() == MSG_QUIT) {
+               std::cerr << "GOT COMMAND TO QUIT, YIP YIP!" << std::endl;
+               wire::send(server_, MSG_ACKNOLEDGE);
+               return WORKER_COMMAND_QUIT;
+            }
+            if(rx.type() == MSG_QUESTION_STATE) {
+               wire::send(server_, MSG_STATE, state_);
                if(state_ == WORKER_STATE_IDLE) {
-                  memset(buff, 0, 255);
-                  read_bytes = server_.read(saga::buffer(buff));
-                  question = std::string(buff, read_bytes);
-                  if(question == MASTER_REQUEST_IDLE) {
-                     server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
+                  if(!rx.recv(server_)) {
+                     transport_.reset();
+                     return std::string("");
+                  }
+                  if(rx.type() == MSG_REQUEST_IDLE) {
+                     wire::send(server_, MSG_ACKNOLEDGE);
                      state_ = WORKER_STATE_IDLE;
-                     //server_.close();
                      return std::string("");
                   }
-                  else if(question == MASTER_QUESTION_ADVERT) {
+                  else if(rx.type() == MSG_QUESTION_ADVERT) {
                      std::string advert(workerDir_.get_url().get_string());
-                     server_.write(saga::buffer(advert, advert.size()));
-                     memset(buff, 0, 255);
-                     read_bytes = server_.read(saga::buffer(buff));
-                     question = std::string(buff, read_bytes);
-                     if(question == WORKER_COMMAND_MAP) {
-                        server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-                        memset(buff, 0, 255);
-                        read_bytes = server_.read(saga::buffer(buff));
-                        question = std::string(buff, read_bytes);
-                        if(question == WORKER_CHUNK) {
-                           server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-                           memset(buff, 0, 255);
-                           read_bytes = server_.read(saga::buffer(buff));
-                           //This is the actual chunk to read!
-                           chunk_ = std::string(buff, read_bytes);
-                           std::cerr << "just set chunk to " << chunk_ << std::endl;
-                           server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-                           //server_.close();
-                           std::cerr << "Returning command map" << std::endl;
-                           return WORKER_COMMAND_MAP;
+                     wire::send(server_, MSG_ADVERT, advert);
+                     if(!rx.recv(server_)) {
+                        transport_.reset();
+                        return std::string("");
+                     }
+                     if(rx.type() == MSG_ASSIGN_MAP) {
+                        //The whole batch arrives as one frame, one
+                        //chunk replica spec per part, and is acked as
+                        //a whole.  The replica to open is chosen here,
+                        //once per assignment and still single-threaded
+                        chunkBatch_.clear();
+                        chunkOpenBatch_.clear();
+                        for(std::size_t p = 0; p < rx.parts(); p++) {
+                           chunkBatch_.push_back(rx.part(p));
+                           chunkOpenBatch_.push_back(
+                              selectReplica_(chunkBatch_.back()));
                         }
+                        chunk_ = chunkBatch_.empty() ? std::string("")
+                                                     : chunkBatch_[0];
+                        std::cerr << "just set chunk batch of "
+                                  << chunkBatch_.size() << std::endl;
+                        wire::send(server_, MSG_ACKNOLEDGE);
+                        std::cerr << "Returning command map" << std::endl;
+                        return WORKER_COMMAND_MAP;
                      }
-                     else if(question == WORKER_COMMAND_REDUCE) {
-                        server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-                        memset(buff, 0, 255);
-                        read_bytes = server_.read(saga::buffer(buff));
-                        lastReduce_ = boost::lexical_cast<int>(std::string(buff, read_bytes));
-                        server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-                        //server_.close();
+                     else if(rx.type() == MSG_ASSIGN_REDUCE) {
+                        lastReduce_ = boost::lexical_cast<int>(rx.part());
+                        wire::send(server_, MSG_ACKNOLEDGE);
                         std::cerr << "Returning command reduce" << std::endl;
                         return WORKER_COMMAND_REDUCE;
                      }
+                     else if(rx.type() == MSG_REQUEST_IDLE) {
+                        //The master asks for the advert before it
+                        //draws the batch; the queue may drain in
+                        //between, leaving nothing to assign
+                        wire::send(server_, MSG_ACKNOLEDGE);
+                        state_ = WORKER_STATE_IDLE;
+                        return std::string("");
+                     }
                   }
                }
                else if(state_ == WORKER_STATE_DONE_MAP) {
-                  memset(buff, 0, 255);
-                  read_bytes = server_.read(saga::buffer(buff));
-                  question = std::string(buff, read_bytes);
-                  if(question == MASTER_QUESTION_RESULT) {
-                     server_.write(saga::buffer(chunk_, chunk_.size()));
-                     memset(buff, 0, 255);
-                     read_bytes = server_.read(saga::buffer(buff));
-                     question = std::string(buff, read_bytes);
-                     if(question == MASTER_REQUEST_IDLE) {
+                  if(!rx.recv(server_)) {
+                     transport_.reset();
+                     return std::string("");
+                  }
+                  if(rx.type() == MSG_QUESTION_RESULT) {
+                     //report every chunk of the batch as one part
+                     //each in a single frame
+                     wire::message result(MSG_RESULT);
+                     for(std::vector<std::string>::size_type b = 0;
+                         b < chunkBatch_.size(); b++) {
+                        result.add(chunkBatch_[b]);
+                     }
+                     result.send(server_);
+                     if(rx.recv(server_) && rx.type() == MSG_REQUEST_IDLE) {
                         state_ = WORKER_STATE_IDLE;
-                        //server_.close();
                         return std::string("");
                      }
                   }
-                  else if(question == MASTER_REQUEST_IDLE) {
-                     server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
+                  else if(rx.type() == MSG_REQUEST_IDLE) {
+                     wire::send(server_, MSG_ACKNOLEDGE);
                      state_ = WORKER_STATE_IDLE;
                      return std::string("");
                   }
                }
                else if(state_ == WORKER_STATE_DONE_REDUCE) {
-                  memset(buff, 0, 255);
-                  read_bytes = server_.read(saga::buffer(buff));
-                  question = std::string(buff, read_bytes);
-                  if(question == MASTER_QUESTION_RESULT) {
-                     std::string last(boost::lexical_cast<std::string>(lastReduce_));
-                     server_.write(saga::buffer(last, last.size()));
-                     memset(buff, 0, 255);
-                     read_bytes = server_.read(saga::buffer(buff));
-                     question = std::string(buff, read_bytes);
-                     if(question == MASTER_REQUEST_IDLE) {
-                        //server_.close();
+                  if(!rx.recv(server_)) {
+                     transport_.reset();
+                     return std::string("");
+                  }
+                  if(rx.type() == MSG_QUESTION_RESULT) {
+                     //the partition number travels as the first part;
+                     //every further part fingerprints one reduce
+                     //output file this worker has written so far,
+                     //"<partition> <fnv64> <bytes> <url>".  The last
+                     //report per file carries its final checksum, and
+                     //the master keeps the latest line per url
+                     wire::message result(MSG_RESULT);
+                     result.add(boost::lexical_cast<std::string>(lastReduce_));
+                     for(int counter = 0; counter < tuning::numMaps(); counter++) {
+                        if(reduceBytes_[counter] == 0) {
+                           continue;
+                        }
+                        std::string line(boost::lexical_cast<std::string>(counter));
+                        line += " " + reduceChecksums_[counter].digest();
+                        line += " " + boost::lexical_cast<std::string>(reduceBytes_[counter]);
+                        line += " " + reduceFileNames_[counter];
+                        result.add(line);
+                     }
+                     result.send(server_);
+                     if(rx.recv(server_) && rx.type() == MSG_REQUEST_IDLE) {
                         state_ = WORKER_STATE_IDLE;
                         return std::string("");
                      }
                   }
                }
             }
-            if(question == WORKER_COMMAND_QUIT) {
-               std::cerr << "GOT COMMAND TO QUIT, YIP YIP!" << std::endl;
-               server_.write(saga::buffer(WORKER_RESPONSE_ACKNOLEDGE, 10));
-               return WORKER_COMMAND_QUIT;
-            }
+         }
+         catch(wire::error const & e) {
+            //Framing error: the stream is beyond repair, reconnect
+            transport_.reset();
+            sleep(1);
          }
          catch(saga::exception const & e) {
-            //Hope it was couldn't connect to stream server, then just wait and try again...
+            //Connection gone; drop the stream so the next poll
+            //reconnects with backoff
+            transport_.reset();
             sleep(1);
-            if(depth < 20) {
-               depth++;
-               return getFrontendCommand_();
-            }
-            else throw;
          }
          return std::string("");
-         // get command number & reset the attribute to "" 
+         // get command number & reset the attribute to ""
       }
-      void closeMapFiles(void) {
-         static bool closed = false;
-         if(closed == false)
+      /*********************************************************
+       * selectReplica_ picks the cheapest replica out of a    *
+       * chunk spec (see utils/ReplicaSpec.hpp): a copy on     *
+       * this very host beats one in our own domain beats      *
+       * anything further away.  Several equally-near          *
+       * candidates - or hosts whose distance cannot be judged *
+       * from the name - are settled by probing the open cost  *
+       * of each one.                                          *
+       * ******************************************************/
+      std::string selectReplica_(std::string const &spec) {
+         std::vector<std::string> urls = replica::split(spec);
+         if(urls.size() <= 1) {
+            return urls.empty() ? spec : urls[0];
+         }
+         std::string localHost(systemInfo_.hostName());
+         std::string localDomain;
+         std::string::size_type dot = localHost.find('.');
+         if(dot != std::string::npos) {
+            localDomain = localHost.substr(dot);
+         }
+         //rank every replica: 0 = this host, 1 = same domain (LAN),
+         //2 = anywhere else (WAN); the config file order breaks ties
+         //until the probe does
+         int bestRank = 3;
+         std::vector<std::string> best;
+         for(std::vector<std::string>::size_type u = 0; u < urls.size(); u++) {
+            std::string host;
+            try {
+               host = saga::url(urls[u]).get_host();
+            }
+            catch(saga::exception const &) {
+               continue;
+            }
+            int rank = 2;
+            if(host.empty() || host == "localhost" || host == localHost) {
+               rank = 0;
+            }
+            else if(!localDomain.empty() &&
+                    host.size() > localDomain.size() &&
+                    host.compare(host.size() - localDomain.size(),
+                                 localDomain.size(), localDomain) == 0) {
+               rank = 1;
+            }
+            if(rank < bestRank) {
+               bestRank = rank;
+               best.clear();
+            }
+            if(rank == bestRank) {
+               best.push_back(urls[u]);
+            }
+         }
+         if(best.empty()) {
+            return urls[0];
+         }
+         if(best.size() == 1 || bestRank == 0) {
+            return best[0];
+         }
+         //probe the remaining candidates: one open plus get_size per
+         //URL, fastest answer wins, failures disqualify.  This runs
+         //once per assigned chunk, so the round trips are amortized
+         //over the whole map of the chunk
+         std::string winner(best[0]);
+         double bestTime = -1.0;
+         for(std::vector<std::string>::size_type b = 0; b < best.size(); b++) {
+            try {
+               high_resolution_timer probe;
+               saga::filesystem::file candidate(saga::url(best[b]),
+                                                saga::filesystem::Read);
+               candidate.get_size();
+               double elapsed = probe.elapsed();
+               if(bestTime < 0.0 || elapsed < bestTime) {
+                  bestTime = elapsed;
+                  winner   = best[b];
+               }
+            }
+            catch(saga::exception const &) {
+               //unreachable from here - one of the others will do
+            }
+         }
+         return winner;
+      }
+      /*********************************************************
+       * currentStore_ returns the calling thread's private    *
+       * intermediate store while the map pool is running, and *
+       * the shared store otherwise.                           *
+       * ******************************************************/
+      IntermediateStore &currentStore_(void) {
+         IntermediateStore *store = threadStore_.get();
+         return store ? *store : intermediate_;
+      }
+      /*********************************************************
+       * writeStore_ turns one store into sorted runs of       *
+       * binary records and hands them to the double-buffered  *
+       * background flusher.  Safe to call from several map    *
+       * threads; the handover is serialized by flushMutex_.   *
+       * ******************************************************/
+      void writeStore_(IntermediateStore &store) {
+         //Each flush becomes one sorted run of binary records so
+         //the reduce phase can merge the files without loading
+         //them whole or reparsing text
+         int numMaps = tuning::numMaps();
+         std::vector<std::vector<std::pair<std::string, std::string> > >
+            intermediateRecords(numMaps);
+         std::size_t keyCount = store.keyCount();
+         for(std::size_t id = 0; id < keyCount; id++) {
+            std::string intermediateKey(store.key(id));
+            int hash_value = hash(intermediateKey, numMaps);
+            std::string record;
+            appendVarint(record, intermediateKey.size());
+            record.append(intermediateKey);
+            std::size_t valueCount = 0;
+            IntermediateStore::ValueRef const *value = store.values(id);
+            for(; value != 0; value = value->next) {
+               valueCount++;
+            }
+            appendVarint(record, valueCount);
+            for(value = store.values(id); value != 0; value = value->next) {
+               appendVarint(record, value->size);
+               record.append(value->data, value->size);
+            }
+            intermediateRecords[hash_value].push_back(
+               std::make_pair(intermediateKey, record));
+         }
+         std::vector<std::string> intermediateData(numMaps);
+         for(int counter = 0; counter < numMaps; counter++)
          {
-            std::vector<saga::filesystem::file>::iterator IT = mapFiles_.begin();
-            while(IT != mapFiles_.end()) {
-               IT->close();
-               IT++;
+            std::sort(intermediateRecords[counter].begin(),
+                      intermediateRecords[counter].end());
+            for(std::vector<std::pair<std::string, std::string> >::size_type r = 0;
+                r < intermediateRecords[counter].size(); r++) {
+               intermediateData[counter].append(intermediateRecords[counter][r].second);
+            }
+#if INTERMEDIATE_COMPRESSION
+            //Each flush becomes one self-contained compressed
+            //segment; the reduce side sniffs the magic, so raw and
+            //compressed files mix freely
+            if(!intermediateData[counter].empty()) {
+               std::string packed;
+               blockcompress::compressBuffer(intermediateData[counter], packed);
+               intermediateData[counter].swap(packed);
             }
+#endif
          }
-         closed = true;
+         {
+            //Double-buffered flush: wait out the previous background
+            //write, hand the fresh buffers over, and let the flusher
+            //stream them out while mapping continues
+            boost::mutex::scoped_lock lock(flushMutex_);
+            waitForFlush_();
+            flushData_.swap(intermediateData);
+            flushThread_.reset(new boost::thread(
+               boost::bind(&MapReduceBase::flush_, this)));
+         }
+         //Wholesale arena teardown, no per-key destruction
+         store.clear();
+      }
+      /*********************************************************
+       * mapWorker_ is the body of one map pool thread: it     *
+       * claims chunks off the shared batch, maps them into a  *
+       * thread-private store and flushes the remainder before *
+       * exiting.                                              *
+       * ******************************************************/
+      void mapWorker_(void) {
+         threadStore_.reset(new IntermediateStore());
+         while(true) {
+            std::string chunk;
+            {
+               boost::mutex::scoped_lock lock(batchMutex_);
+               if(batchNext_ >= chunkBatch_.size()) {
+                  break;
+               }
+               chunk = chunkOpenBatch_[batchNext_++];
+            }
+            derived().map(chunk);
+         }
+         writeStore_(*threadStore_.get());
+         threadStore_.reset();
+      }
+      /*********************************************************
+       * flush_ runs on the background thread and streams the  *
+       * handed-over buffers to the map files.  Segments this  *
+       * flush touches for the first time are created here, as *
+       * one batch of async opens with a single wait - the     *
+       * same bulk pattern the advert helpers use.             *
+       * ******************************************************/
+      void flush_(void) {
+         unsigned long flushBytes = 0;
+         for(int counter = 0; counter < tuning::numMaps(); counter++) {
+            flushBytes += flushData_[counter].length();
+         }
+         trace_->record(TRACE_FLUSH_START, 0, flushBytes);
+         int mode = saga::filesystem::Write | saga::filesystem::Create;
+         std::vector<int> missing;
+         for(int counter = 0; counter < tuning::numMaps(); counter++) {
+            if(!flushData_[counter].empty() && !mapFiles_[counter]) {
+               missing.push_back(counter);
+            }
+         }
+         if(!missing.empty()) {
+            saga::filesystem::directory out(saga::url(outputPrefix_),
+                                            saga::filesystem::ReadWrite);
+            std::vector<saga::task> tasks;
+            saga::task_container tc;
+            for(std::vector<int>::size_type m = 0; m < missing.size(); m++) {
+               saga::task t = out.open<saga::task_base::Async>(
+                  saga::url(mapTmpNames_[missing[m]]), mode);
+               tasks.push_back(t);
+               tc.add_task(t);
+            }
+            tc.wait();
+            for(std::vector<int>::size_type m = 0; m < missing.size(); m++) {
+               mapFiles_[missing[m]].reset(new saga::filesystem::file(
+                  tasks[m].get_result<saga::filesystem::file>()));
+            }
+         }
+         for(int counter = 0; counter < tuning::numMaps(); counter++) {
+            if(flushData_[counter].empty()) {
+               continue;
+            }
+            mapFiles_[counter]->write(saga::buffer(flushData_[counter], flushData_[counter].length()));
+            //The same bytes land in the local spill copy the shuffle
+            //server serves to reducers.  A failed spill only costs
+            //that partition its peer path - the committed file stays
+            //authoritative - but a partial copy must not survive
+            if(spillOk_[counter]) {
+               std::string spillName(spillDir_ + "/" + mapBaseNames_[counter]);
+               std::ofstream spill(spillName.c_str(),
+                                   std::ios::binary | std::ios::app);
+               spill.write(flushData_[counter].data(),
+                           flushData_[counter].length());
+               if(!spill) {
+                  spillOk_[counter] = false;
+                  spill.close();
+                  std::remove(spillName.c_str());
+               }
+            }
+         }
+         trace_->record(TRACE_FLUSH_END);
+      }
+      /*********************************************************
+       * waitForFlush_ joins any in-flight background write so *
+       * the buffers can be reused or the files closed.        *
+       * ******************************************************/
+      void waitForFlush_(void) {
+         if(flushThread_) {
+            flushThread_->join();
+            flushThread_.reset();
+         }
+      }
+      /*********************************************************
+       * openMapSegment_ names the temporary output files for   *
+       * the coming batch; nothing is created yet.  The files   *
+       * materialize in the first flush that has data for them  *
+       * (see flush_), so a batch hashing into few partitions   *
+       * creates few files.  The dot-prefixed .inprogress name  *
+       * never appears in any manifest, so a crash mid-batch    *
+       * leaves nothing a reader could trip on.                 *
+       * ******************************************************/
+      void openMapSegment_(void) {
+         mapFiles_.clear();
+         mapFiles_.resize(tuning::numMaps());
+         mapTmpNames_.clear();
+         mapFinalNames_.clear();
+         mapBaseNames_.clear();
+         spillOk_.assign(tuning::numMaps(), true);
+         for(int x = 0; x < tuning::numMaps(); x++) {
+            std::string base("mapFile_" + boost::lexical_cast<std::string>(x)
+                           + "_" + uuid_
+                           + "_" + boost::lexical_cast<std::string>(commitSeq_));
+            mapTmpNames_.push_back(outputPrefix_ + "/." + base + ".inprogress");
+            mapFinalNames_.push_back(outputPrefix_ + "/" + base);
+            mapBaseNames_.push_back(base);
+         }
+      }
+      /*********************************************************
+       * commitMapSegment_ publishes the batch atomically:      *
+       * close, rename each segment to its final url, then      *
+       * rewrite the packed manifest advert - one entry for    *
+       * all partitions, "<partition> <segment>" per line, so  *
+       * a batch costs one advert write and a reader gets the  *
+       * worker's whole map output in one read instead of      *
+       * probing an entry per partition.  The manifest write   *
+       * is the commit point - a crash before the rename loses *
+       * only invisible temp files, a crash before the         *
+       * manifest write leaves renamed files no reader knows   *
+       * about, and the re-executed batch writes a new         *
+       * sequence number either way.                           *
+       * ******************************************************/
+      void commitMapSegment_(void) {
+         int mode = saga::advert::Create | saga::advert::ReadWrite;
+         saga::filesystem::directory out(saga::url(outputPrefix_),
+                                         saga::filesystem::ReadWrite);
+         for(int x = 0; x < tuning::numMaps(); x++) {
+            if(!mapFiles_[x]) {
+               continue;
+            }
+            mapFiles_[x]->close();
+            out.move(saga::url(mapTmpNames_[x]), saga::url(mapFinalNames_[x]));
+         }
+         //Segments with a complete spill copy get the peer shuffle
+         //annotation, so reducers can pull them from here directly
+         ensureShuffleServer_();
+         bool committed = false;
+         for(int x = 0; x < tuning::numMaps(); x++) {
+            if(!mapFiles_[x]) {
+               continue;
+            }
+            manifest_ += boost::lexical_cast<std::string>(x);
+            manifest_ += " " + mapFinalNames_[x];
+            if(shuffleServer_ && spillOk_[x]) {
+               manifest_ += "|" + shuffleServer_->url()
+                          + "|" + mapBaseNames_[x];
+            }
+            manifest_ += "\n";
+            committed = true;
+         }
+         if(committed) {
+            saga::advert::entry adv = intermediateDir_.open(
+               saga::url(ADVERT_ENTRY_MAP_MANIFEST), mode);
+            adv.store_string(manifest_);
+         }
+         mapFiles_.clear();
+         trace_->record(TRACE_COMMIT, commitSeq_);
+         commitSeq_++;
+      }
+      /*********************************************************
+       * ensureShuffleServer_ starts the peer shuffle server   *
+       * on the first commit.  A worker that cannot bind a     *
+       * port simply never annotates its manifests - reducers  *
+       * read its segments through the filesystem as before.   *
+       * ******************************************************/
+      void ensureShuffleServer_(void) {
+         if(shuffleServer_ || shuffleDisabled_) {
+            return;
+         }
+         try {
+            shuffleServer_.reset(
+               new ShuffleServer(spillDir_, systemInfo_.hostName()));
+            std::cerr << "Peer shuffle server at "
+                      << shuffleServer_->url() << std::endl;
+         }
+         catch(saga::exception const & e) {
+            std::cerr << "Peer shuffle disabled ("
+                      << e.get_message() << ")" << std::endl;
+            shuffleDisabled_ = true;
+         }
+      }
+      void closeMapFiles(void) {
+         //Committed segments are already closed; this only sweeps
+         //up a segment left open by a failed batch
+         waitForFlush_();
+         std::vector<boost::shared_ptr<saga::filesystem::file> >::iterator
+            IT = mapFiles_.begin();
+         while(IT != mapFiles_.end()) {
+            if(*IT) {
+               (*IT)->close();
+            }
+            IT++;
+         }
+         mapFiles_.clear();
       }
       void closeReduceFiles(void) {
-         std::vector<saga::filesystem::file>::iterator IT = reduceFiles_.begin();
+         waitForReduceFlush_();
+         std::vector<boost::shared_ptr<saga::filesystem::file> >::iterator
+            IT = reduceFiles_.begin();
          while(IT != reduceFiles_.end()) {
-            IT->close();
+            if(*IT) {
+               (*IT)->close();
+            }
             IT++;
          }
       }
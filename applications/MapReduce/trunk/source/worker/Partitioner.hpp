@@ -0,0 +1,70 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MR_PARTITIONER_HPP
+#define MR_PARTITIONER_HPP
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/*********************************************************
+ * The Partitioner decides which reduce partition a key  *
+ * belongs to.  The old character-sum hash sent keys     *
+ * with common prefixes or anagrams to the same          *
+ * partition; these implementations spread keys evenly   *
+ * so no single reducer defines job completion time.     *
+ * ******************************************************/
+namespace MapReduce {
+   class Partitioner {
+     public:
+      virtual ~Partitioner() {}
+      virtual int partition(std::string const &key, unsigned int limit) = 0;
+   };
+
+/*********************************************************
+ * HashPartitioner is the default: FNV-1a over the key   *
+ * bytes, which distributes anagrams and shared prefixes *
+ * across all partitions.                                *
+ * ******************************************************/
+   class HashPartitioner : public Partitioner {
+     public:
+      int partition(std::string const &key, unsigned int limit) {
+         unsigned int h = 2166136261u;
+         for(std::string::size_type i = 0; i < key.size(); i++) {
+            h ^= static_cast<unsigned char>(key[i]);
+            h *= 16777619u;
+         }
+         return static_cast<int>(h % limit);
+      }
+   };
+
+/*********************************************************
+ * RangePartitioner is built from a sample of the key    *
+ * space and assigns contiguous key ranges to partitions *
+ * so the reduce output is totally ordered across files. *
+ * ******************************************************/
+   class RangePartitioner : public Partitioner {
+     public:
+      //samples need not be sorted or evenly spaced; limit-1
+      //boundary keys are picked at even quantiles
+      RangePartitioner(std::vector<std::string> samples, unsigned int limit) {
+         std::sort(samples.begin(), samples.end());
+         for(unsigned int b = 1; b < limit && !samples.empty(); b++) {
+            boundaries_.push_back(samples[(samples.size() * b) / limit]);
+         }
+      }
+      int partition(std::string const &key, unsigned int limit) {
+         std::vector<std::string>::const_iterator pos =
+            std::upper_bound(boundaries_.begin(), boundaries_.end(), key);
+         int p = static_cast<int>(pos - boundaries_.begin());
+         return p < static_cast<int>(limit) ? p : static_cast<int>(limit) - 1;
+      }
+     private:
+      std::vector<std::string> boundaries_;
+   };
+} //namespace MapReduce
+
+#endif // MR_PARTITIONER_HPP
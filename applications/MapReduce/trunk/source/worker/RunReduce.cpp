@@ -1,7 +1,6 @@
+#include <sstream>
 #include "RunReduce.hpp"
 #include "../utils/defines.hpp"
-#include "../utils/merger.hpp"
-#include "../utils/parseMapLine.hpp"
 
 namespace MapReduce {
    struct get_lines {};
@@ -11,12 +10,27 @@ namespace MapReduce {
  * by the master.                                        *
  * ******************************************************/
    RunReduce::RunReduce(saga::advert::directory workerDir, saga::advert::directory reduceInputDir,
-                        std::string outputPrefix) {
+                        std::string outputPrefix, std::string localHost)
+      : havePending_(false) {
       int mode = saga::advert::ReadWrite;
       workerDir_      = workerDir;
       reduceInputDir_ = reduceInputDir;
       outputPrefix_   = outputPrefix;
+      localHost_      = localHost;
       try {
+         //The master posts one manifest entry per partition, so a
+         //single read discovers every input file
+         saga::advert::entry adv(reduceInputDir_.open(saga::url(ADVERT_ENTRY_MANIFEST), mode));
+         std::istringstream manifest(adv.retrieve_string());
+         std::string url;
+         while(std::getline(manifest, url)) {
+            if(!url.empty()) {
+               files_.push_back(url);
+            }
+         }
+      }
+      catch(saga::exception const & e) {
+         //Masters predating the manifest post one entry per file
          std::vector<saga::url> entries = reduceInputDir_.list("*");
          std::vector<saga::url>::const_iterator entriesIT = entries.begin();
          while(entriesIT != entries.end()) {
@@ -25,9 +39,6 @@ namespace MapReduce {
             entriesIT++;
          }
       }
-      catch(saga::exception const & e) {
-         throw;
-      }
    }
 
 /*********************************************************
@@ -47,20 +58,15 @@ namespace MapReduce {
    }
 
 /*********************************************************
- * getLines returns a representation of each line from   *
+ * getLines returns a representation of each record from *
  * the input files as a map<string, vector<string> > to  *
- * be passed to the user defined reduce function.        *
+ * be passed to the user defined reduce function.  Most  *
+ * callers should prefer the streaming nextKeyGroup.     *
  * ******************************************************/
    void RunReduce::getLines(unorderedMap &keyValues) {
-     std::vector<std::string> lines;
-     std::vector<std::string>::const_iterator linesIT;
-     merger<std::string>(lines, files_);
-
-     for(linesIT = lines.begin();linesIT!=lines.end();linesIT++) {
-        std::string key(getKey(*linesIT));
-        std::vector<std::string> values;
-        parseMapLine(values, *linesIT);
-
+     std::string key;
+     std::vector<std::string> values;
+     while(nextKeyGroup(key, values)) {
         if(keyValues.find(key) == keyValues.end()) {
            //Not in structure
            strVectorPtr initialValue(new std::vector<std::string>(values));
@@ -68,14 +74,39 @@ namespace MapReduce {
         }
         else {
            //Contained in structure
-           std::vector<std::string>::const_iterator valuesIT = values.begin();
-           std::vector<std::string>::const_iterator end = values.end();
-           while(valuesIT != end) {
-              keyValues[key]->push_back(*valuesIT);
-              ++valuesIT;
-           }
+           keyValues[key]->insert(keyValues[key]->end(),
+                                  values.begin(), values.end());
         }
      }
   }
+
+/*********************************************************
+ * nextKeyGroup streams the merged input incrementally:  *
+ * the sorted record runs of all files_ are merged with  *
+ * a loser tree and consecutive records of the same key  *
+ * form one group for the user defined reduce function.  *
+ * Memory stays bounded by one record per input file     *
+ * plus the current group, however skewed the partition. *
+ * ******************************************************/
+   bool RunReduce::nextKeyGroup(std::string &key, std::vector<std::string> &values) {
+      if(merger_ == 0) {
+         //Files written on this host are read through the local
+         //filesystem; only remote partitions go through saga
+         merger_.reset(new StreamingMerger(files_, localHost_));
+         havePending_ = merger_->next(pendingKey_, pendingValues_);
+      }
+      if(!havePending_) {
+         return false;
+      }
+      key = pendingKey_;
+      values.swap(pendingValues_);
+      while((havePending_ = merger_->next(pendingKey_, pendingValues_))) {
+         if(pendingKey_ != key) {
+            break;
+         }
+         values.insert(values.end(), pendingValues_.begin(), pendingValues_.end());
+      }
+      return true;
+   }
 } // namespace MapReduce
 
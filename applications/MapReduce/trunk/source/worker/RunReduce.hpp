@@ -10,21 +10,30 @@
 #include <string>
 #include <vector>
 #include <saga/saga.hpp>
+#include <boost/shared_ptr.hpp>
+#include "../utils/StreamingMerger.hpp"
 #include "version.hpp"
 
 namespace MapReduce {
    class RunReduce {
      public:
       RunReduce(saga::advert::directory workerDir, saga::advert::directory reduceInputDir,
-                std::string outputPrefix);
+                std::string outputPrefix, std::string localHost = std::string());
       ~RunReduce();
       void getLines(unorderedMap &keyValues);
+      bool nextKeyGroup(std::string &key, std::vector<std::string> &values);
       int  getCurrent(void);
      private:
       std::vector<std::string> files_;
       saga::advert::directory workerDir_;
       saga::advert::directory reduceInputDir_;
       std::string outputPrefix_;
+      std::string localHost_; //this worker's host, enables the
+                              //local-file shuffle fast path
+      boost::shared_ptr<StreamingMerger> merger_;
+      std::string pendingKey_;
+      std::vector<std::string> pendingValues_;
+      bool havePending_;
    }; // class RunReduce
 } // namespace MapReduceBase
 
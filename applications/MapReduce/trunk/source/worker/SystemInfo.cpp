@@ -1,25 +1,31 @@
 //  Copyright (c) 2008 Michael Miceli and Christopher Miceli
-// 
-//  Distributed under the Boost Software License, Version 1.0. (See accompanying 
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
 //  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
 #include "SystemInfo.hpp"
 
 #include <cstdlib>
+#include <cstring>
+#include <unistd.h>
 #if defined(SAGA_APPLE)
    #include <sys/sysctl.h>
    #include <mach/machine.h>
+   #include <mach/mach_time.h>
 #endif
 
 using namespace saga;
 using namespace MapReduce;
 
 SystemInfo::SystemInfo()
-  : hostName_(""), hostUname_(""), hostLoadAverage_("") {
+  : hostName_(""), hostUname_(""), hostLoadAverage_(""),
+    sampleSeq_(0), lastRefresh_(-1) {
    //pathToWhich_  = "which";
    //pathToUname_  = findExecutable_("uname");
    //pathToUptime_ = findExecutable_("uptime");
 
+   sample_.loadAverage[0] = '\0';
+
    // These are static - won't change during instance lifetime
    gatherHardwareInfo_();
    detectHostName_();
@@ -30,9 +36,60 @@ SystemInfo::~SystemInfo() {
 
 }
 
-std::string SystemInfo::hostLoadAverage() { 
-   detectHostLoadAverage_(); 
-   return hostLoadAverage_;
+// monotonic timestamp for the refresh bookkeeping - the wall clock may
+// get stepped by ntp, which must neither starve nor flood the sampler
+long SystemInfo::monotonicSeconds_() {
+   #if defined(SAGA_APPLE)
+      static mach_timebase_info_data_t tb = { 0, 0 };
+      if(0 == tb.denom) {
+         mach_timebase_info(&tb);
+      }
+      return (long)(mach_absolute_time() * tb.numer / tb.denom
+                    / 1000000000ULL);
+   #else
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return (long)ts.tv_sec;
+   #endif
+}
+
+// re-probe the volatile metrics if the cached sample is older than the
+// refresh interval, and publish the new sample under the sequence lock
+void SystemInfo::refreshIfStale_() {
+   long now = monotonicSeconds_();
+
+   if(lastRefresh_ >= 0 && now - lastRefresh_ < refreshInterval) {
+      return;
+   }
+
+   detectHostLoadAverage_();
+
+   sampleSeq_++;   // odd: sample_ is inconsistent
+   strncpy(sample_.loadAverage, hostLoadAverage_.c_str(),
+           sizeof(sample_.loadAverage) - 1);
+   sample_.loadAverage[sizeof(sample_.loadAverage) - 1] = '\0';
+   sampleSeq_++;   // even: sample_ is published
+
+   lastRefresh_ = now;
+}
+
+std::string SystemInfo::hostLoadAverage() {
+   refreshIfStale_();
+
+   // seqlock read: retry while a refresh is in flight or completed
+   // underneath the copy
+   while(true) {
+      unsigned seq = sampleSeq_;
+      if(seq & 1) {
+         continue;
+      }
+
+      sample_t copy = sample_;
+
+      if(seq == sampleSeq_) {
+         return std::string(copy.loadAverage);
+      }
+   }
 }
 
 void SystemInfo::detectHostName_() {
@@ -61,6 +118,15 @@ void SystemInfo::gatherHardwareInfo_() {
       sysctlbyname("hw.cputype", &hardwareInfo_.cpuType, &len, NULL, 0);
       len = sizeof(hardwareInfo_.cpuSubtype);
       sysctlbyname("hw.cpusubtype", &hardwareInfo_.cpuSubtype, &len, NULL, 0);
+   #else
+      // sysconf covers what the memory/thread tuning needs; the
+      // type/frequency details stay unset off-darwin
+      hardwareInfo_.nCpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+      hardwareInfo_.totalMemory = (boost::uint64_t)sysconf(_SC_PHYS_PAGES)
+                                * (boost::uint64_t)sysconf(_SC_PAGE_SIZE);
+      hardwareInfo_.cpuFrequency = 0;
+      hardwareInfo_.cpuType     = 0;
+      hardwareInfo_.cpuSubtype  = 0;
    #endif
 }
 
@@ -68,12 +134,12 @@ void SystemInfo::detectHostUname_() {
    job::ostream in;
    job::istream out;
    job::istream err;
-     
+
    if(pathToUname_.length() > 0) {
       try {
          job::service js(saga::url("localhost"));
          job::job j1 = js.run_job (pathToUname_, "localhost", in, out, err);
-         
+
          job::state state = j1.get_state ();
          if(state != job::Running && state != job::Done) {
             //TODO - something went wrong
@@ -103,12 +169,16 @@ void SystemInfo::detectHostLoadAverage_() {
    job::ostream in;
    job::istream out;
    job::istream err;
-   
+
+   // this probe runs once per refresh interval, not once per call -
+   // start from a clean slate instead of appending to the last sample
+   hostLoadAverage_.clear();
+
    if(pathToUptime_.length() > 0) {
       try {
          job::service js(saga::url("localhost"));
          job::job j1 = js.run_job (pathToUptime_, "localhost", in, out, err);
-        
+
          job::state state = j1.get_state ();
          if(state != job::Running && state != job::Done) {
            //TODO - something went wrong
@@ -120,7 +190,7 @@ void SystemInfo::detectHostLoadAverage_() {
       while(true) {
          char buffer[255];
          out.read (buffer, sizeof (buffer));
-           
+
          if(out.gcount() > 0) {
             hostLoadAverage_ += std::string (buffer, out.gcount ());
          }
@@ -140,11 +210,11 @@ std::string SystemInfo::findExecutable_(std::string name) {
    job::ostream in;
    job::istream out;
    job::istream err;
-   
+
    try {
       job::service js(saga::url("localhost"));
       job::job j1 = js.run_job (findCommand, "localhost", in, out, err);
-      
+
       job::state state = j1.get_state ();
       if(state != job::Running && state != job::Done) {
         //TODO - something went wrong
@@ -5,6 +5,7 @@
 
 #include "MapReduceBase.hpp"
 #include "../utils/type.hpp"
+#include "../utils/ChunkReader.hpp"
 
 using namespace MapReduce;
 
@@ -16,13 +17,30 @@ class MapReduceImpl : public MapReduceBase<MapReduceImpl> {
     * it becomes time to do some mapping.                   *
     * ******************************************************/
    void map(saga::url chunkName) {
-      boost::iostreams::stream <saga_file_device> in (chunkName.get_string());
-      std::string elem;
-      while(in >> elem) {
-         emitIntermediate(elem,"1");
+      //Block reads plus in-place tokens, no iostream layer
+      ChunkReader in(chunkName.get_string());
+      const char *token;
+      std::size_t size;
+      while(in.nextToken(token, size)) {
+         emitIntermediate(std::string(token, size), "1");
       }
    }
       
+   /*********************************************************
+    * Counting is associative, so collapse counts at emit   *
+    * time instead of keeping one "1" string per word       *
+    * occurrence in memory.                                 *
+    * ******************************************************/
+   bool combine(std::string const &key,
+                std::string const &oldValue,
+                std::string const &newValue,
+                std::string &combined) {
+      combined = boost::lexical_cast<std::string>(
+                    boost::lexical_cast<int>(oldValue)
+                  + boost::lexical_cast<int>(newValue));
+      return true;
+   }
+
    /*********************************************************
     * The implemented reduce function that will get called  *
     * when it becomes time to do some reducing.             *
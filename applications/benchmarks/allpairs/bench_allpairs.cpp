@@ -0,0 +1,122 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/lexical_cast.hpp>
+#include "../bench_result.hpp"
+#include "../../common/profiler.hpp"
+#include "../../AllPairs/source/worker/ComparisonTile.hpp"
+
+/*********************************************************
+ * bench_allpairs runs a synthetic all-pairs compare the *
+ * way the worker does: assignments are grouped into a   *
+ * ComparisonTile, every distinct input is materialized  *
+ * once, and the compare kernel then works pair by pair  *
+ * across the tile.  The kernel is a Euclidean distance  *
+ * over synthetic feature vectors - cheap enough that    *
+ * the tile bookkeeping shows up in the numbers, real    *
+ * enough to vectorize like the image metrics do.        *
+ *                                                       *
+ *   bench_allpairs <result-file> [inputs] [dimension]   *
+ *                                                       *
+ * defaults: 256 inputs of dimension 4096, so 65536      *
+ * comparisons.                                          *
+ * ******************************************************/
+namespace {
+   using namespace AllPairs;
+
+   /*********************************************************
+    * makeVector_ fills one synthetic feature vector; the   *
+    * seed keeps inputs distinct and runs repeatable.       *
+    * ******************************************************/
+   std::vector<double> makeVector_(int seed, int dimension) {
+      std::vector<double> v(dimension);
+      unsigned int state = seed * 2654435761u + 1;
+      for(int i = 0; i < dimension; i++) {
+         state = state * 1103515245u + 12345u;
+         v[i] = (state >> 8) / (double)(1 << 24);
+      }
+      return v;
+   }
+
+   /*********************************************************
+    * compare_ is the stand-in metric: squared Euclidean    *
+    * distance between two feature vectors.  The plain loop *
+    * is written so the compiler can vectorize it.          *
+    * ******************************************************/
+   double compare_(std::vector<double> const &a,
+                   std::vector<double> const &b) {
+      double sum = 0.0;
+      for(std::size_t i = 0; i < a.size(); i++) {
+         double d = a[i] - b[i];
+         sum += d * d;
+      }
+      return sum;
+   }
+} // namespace
+
+int main(int argc, char **argv) {
+   if(argc < 2) {
+      std::cerr << "usage: bench_allpairs <result-file> [inputs] [dimension]"
+                << std::endl;
+      return 255;
+   }
+   int numInputs = argc > 2 ? std::atoi(argv[2]) : 256;
+   int dimension = argc > 3 ? std::atoi(argv[3]) : 4096;
+
+   try {
+      bench::result_file result("allpairs.compare", argv[1]);
+      result.put("allpairs.compare.inputs",    (long)numInputs);
+      result.put("allpairs.compare.dimension", (long)dimension);
+
+      //build the full n x n tile, the way HandleComparisons chunks
+      //assignments for one worker
+      ComparisonTile tile;
+      for(int from = 0; from < numInputs; from++) {
+         for(int to = 0; to < numInputs; to++) {
+            tile.addPair("input-" + boost::lexical_cast<std::string>(from),
+                         "input-" + boost::lexical_cast<std::string>(to));
+         }
+      }
+
+      profiler::high_resolution_timer timer;
+
+      //materialize every distinct input once (the point of the tile),
+      //indexed the way pairRow/pairCol address them
+      std::vector<std::vector<double> > rowData;
+      for(std::size_t r = 0; r < tile.rows().size(); r++) {
+         rowData.push_back(makeVector_((int)r, dimension));
+      }
+      std::vector<std::vector<double> > colData;
+      for(std::size_t c = 0; c < tile.cols().size(); c++) {
+         colData.push_back(makeVector_((int)c, dimension));
+      }
+      double staging = timer.elapsed();
+
+      timer.restart();
+      for(unsigned int pair = 0; pair < tile.pairCount(); pair++) {
+         tile.setValue(pair, compare_(rowData[tile.pairRow(pair)],
+                                      colData[tile.pairCol(pair)]));
+      }
+      double elapsed = timer.elapsed();
+
+      double flops = 3.0 * dimension * (double)tile.pairCount();
+      result.put("allpairs.compare.pairs",            (long)tile.pairCount());
+      result.put("allpairs.compare.staging_secs",     staging);
+      result.put("allpairs.compare.makespan_secs",    elapsed);
+      result.put("allpairs.compare.compares_per_sec", tile.pairCount()
+                                                      / elapsed);
+      result.put("allpairs.compare.gflops",           flops / elapsed / 1e9);
+   }
+   catch(std::exception const &e) {
+      std::cerr << "std: exception caught: " << e.what() << std::endl;
+      return 255;
+   }
+   return 0;
+}
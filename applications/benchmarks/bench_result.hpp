@@ -0,0 +1,90 @@
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef APPLICATIONS_BENCHMARKS_BENCH_RESULT_HPP
+#define APPLICATIONS_BENCHMARKS_BENCH_RESULT_HPP
+
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//  Result file writer shared by all benchmark drivers in this suite.
+//
+//  Every driver emits one flat file of
+//
+//      <key> <value>\n
+//
+//  lines - the same "name value" shape the MapReduce Metrics snapshots
+//  use, so the files sort, grep and diff cleanly.  Two checkouts are
+//  compared by running 'make bench' in both and diffing their results/
+//  directories.
+//
+//  The writer adds a small standard prolog to every file (benchmark
+//  name, host, epoch timestamp), so a stray result file can always be
+//  traced back to where and when it was produced.  Values are also
+//  echoed to stdout while the run progresses.
+//
+namespace bench
+{
+  class result_file
+  {
+  private:
+    std::ofstream out_;
+    std::string   name_;
+
+  public:
+    // opens 'path' (truncating) and writes the standard prolog.
+    // 'name' prefixes nothing - metric keys are given in full by the
+    // caller - it only lands in the prolog's bench.name line.
+    result_file (std::string const & name,
+                 std::string const & path)
+      : out_  (path.c_str (), std::ios::trunc),
+        name_ (name)
+    {
+      if ( ! out_ )
+      {
+        std::cerr << "bench: cannot write " << path << std::endl;
+      }
+
+      char host[256];
+      if ( 0 != ::gethostname (host, sizeof (host)) )
+      {
+        host[0] = '\0';
+      }
+      host[sizeof (host) - 1] = '\0';
+
+      put ("bench.name",  name_);
+      put ("bench.host",  std::string (host));
+      put ("bench.epoch", static_cast <long> (::time (NULL)));
+    }
+
+    ~result_file (void)
+    {
+      out_.close ();
+    }
+
+    void put (std::string const & key, std::string const & value)
+    {
+      out_      << key << " " << value << "\n";
+      std::cout << key << " " << value << std::endl;
+    }
+
+    void put (std::string const & key, double value)
+    {
+      out_      << key << " " << value << "\n";
+      std::cout << key << " " << value << std::endl;
+    }
+
+    void put (std::string const & key, long value)
+    {
+      out_      << key << " " << value << "\n";
+      std::cout << key << " " << value << std::endl;
+    }
+  };
+}
+
+#endif // APPLICATIONS_BENCHMARKS_BENCH_RESULT_HPP
@@ -0,0 +1,172 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "digedag.hpp"
+
+#include "../bench_result.hpp"
+#include "../../common/profiler.hpp"
+
+// bench_digedag measures DAG enactment makespan for the two shapes that
+// bound real workflows: a chain (maximum depth, no parallelism - pure
+// per-node overhead) and a fan (maximum width - how well the engine
+// overlaps independent nodes).  Every node runs /bin/true and every
+// edge copies one tiny payload file through the local file adaptor, so
+// the numbers are the engine's dispatch cost, not application compute.
+//
+//   bench_digedag <result-file> [nodes]
+//
+// default: 32 nodes per shape.
+
+namespace
+{
+  // payload file every edge copies; created before the run
+  std::string payload_ (void)
+  {
+    std::string path ("bench-digedag-payload.dat");
+
+    std::ofstream out (path.c_str (), std::ios::trunc);
+    out << "digedag benchmark payload\n";
+
+    return path;
+  }
+
+  // enact a chain: n1 -> n2 -> ... -> nN, one edge between each pair
+  double run_chain (int n, std::string const & payload)
+  {
+    digedag::dag * d = new digedag::dag;
+
+    std::vector <std::string> copies;
+
+    digedag::node * prev = NULL;
+
+    for ( int i = 0; i < n; i++ )
+    {
+      std::string name ("chain-" + boost::lexical_cast <std::string> (i));
+
+      digedag::node * node = new digedag::node ("/bin/true", name);
+
+      d->add_node (name, node);
+
+      if ( NULL != prev )
+      {
+        std::string copy ("bench-digedag-" + name + ".dat");
+        copies.push_back (copy);
+
+        digedag::edge * e = new digedag::edge (payload, copy);
+
+        d->add_edge (e, prev, node);
+      }
+
+      prev = node;
+    }
+
+    profiler::high_resolution_timer timer;
+
+    d->fire ();
+    d->wait ();
+
+    double elapsed = timer.elapsed ();
+
+    delete d;
+
+    for ( size_t i = 0; i < copies.size (); i++ )
+    {
+      ::remove (copies[i].c_str ());
+    }
+
+    return elapsed;
+  }
+
+  // enact a fan: one root, n - 1 independent leaves hanging off it
+  double run_fan (int n, std::string const & payload)
+  {
+    digedag::dag * d = new digedag::dag;
+
+    std::vector <std::string> copies;
+
+    digedag::node * root = new digedag::node ("/bin/true", "fan-root");
+
+    d->add_node ("fan-root", root);
+
+    for ( int i = 1; i < n; i++ )
+    {
+      std::string name ("fan-" + boost::lexical_cast <std::string> (i));
+
+      digedag::node * leaf = new digedag::node ("/bin/true", name);
+
+      d->add_node (name, leaf);
+
+      std::string copy ("bench-digedag-" + name + ".dat");
+      copies.push_back (copy);
+
+      digedag::edge * e = new digedag::edge (payload, copy);
+
+      d->add_edge (e, root, leaf);
+    }
+
+    profiler::high_resolution_timer timer;
+
+    d->fire ();
+    d->wait ();
+
+    double elapsed = timer.elapsed ();
+
+    delete d;
+
+    for ( size_t i = 0; i < copies.size (); i++ )
+    {
+      ::remove (copies[i].c_str ());
+    }
+
+    return elapsed;
+  }
+}
+
+int main (int argc, char ** argv)
+{
+  if ( argc < 2 )
+  {
+    std::cerr << "usage: bench_digedag <result-file> [nodes]" << std::endl;
+    return 255;
+  }
+
+  int n = argc > 2 ? ::atoi (argv[2]) : 32;
+
+  try
+  {
+    bench::result_file result ("digedag.enactment", argv[1]);
+
+    result.put ("digedag.enactment.nodes", (long) n);
+
+    std::string payload = payload_ ();
+
+    double chain = run_chain (n, payload);
+    double fan   = run_fan   (n, payload);
+
+    result.put ("digedag.chain.makespan_secs",  chain);
+    result.put ("digedag.chain.nodes_per_sec",  n / chain);
+    result.put ("digedag.fan.makespan_secs",    fan);
+    result.put ("digedag.fan.nodes_per_sec",    n / fan);
+
+    ::remove (payload.c_str ());
+  }
+  catch ( const saga::exception & e )
+  {
+    std::cerr << "Saga: exception caught: " << e.what () << std::endl;
+    return 255;
+  }
+  catch ( const std::exception & e )
+  {
+    std::cerr << "std: exception caught: " << e.what () << std::endl;
+    return 255;
+  }
+
+  return 0;
+}
@@ -0,0 +1,136 @@
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "../bench_result.hpp"
+#include "../../common/profiler.hpp"
+#include "../../mandelbrot/master/output_null.hpp"
+
+// bench_mandelbrot renders one full mandelbrot frame in-process and
+// pushes the boxes through the output_null device - the same null
+// device the master's --bench flag selects.  The iteration kernel is
+// the scalar escape-time loop from mandelbrot_client.cpp; no clients
+// are spawned, so the numbers are raw compute plus the device's
+// validation path, the floor any distributed run is compared against.
+//
+//   bench_mandelbrot <result-file> [size] [limit] [boxes]
+//
+// defaults: a 1024 x 1024 frame, iteration limit 256, 16 boxes.
+
+namespace
+{
+  // scalar escape time iteration, as in mandelbrot_client.cpp:
+  // non-escaping points count to limit + 1
+  inline int iterate_scalar (double c0, double c1, int limit, double esc2)
+  {
+    double z0 = c0;
+    double z1 = c1;
+
+    int iter;
+
+    for ( iter = 0; iter <= limit; iter++ )
+    {
+      double t = z0 * z0 - z1 * z1 + c0;
+
+      z1 = 2 * z0 * z1 + c1;
+      z0 = t;
+
+      if ( z0 * z0 + z1 * z1 > esc2 )
+      {
+        break;
+      }
+    }
+
+    return iter;
+  }
+}
+
+int main (int argc, char ** argv)
+{
+  if ( argc < 2 )
+  {
+    std::cerr << "usage: bench_mandelbrot <result-file> [size] [limit] [boxes]"
+              << std::endl;
+    return 255;
+  }
+
+  int size  = argc > 2 ? ::atoi (argv[2]) : 1024;
+  int limit = argc > 3 ? ::atoi (argv[3]) :  256;
+  int boxes = argc > 4 ? ::atoi (argv[4]) :   16;
+
+  try
+  {
+    bench::result_file result ("mandelbrot.render", argv[1]);
+
+    result.put ("mandelbrot.render.size",  (long) size);
+    result.put ("mandelbrot.render.limit", (long) limit);
+    result.put ("mandelbrot.render.boxes", (long) boxes);
+
+    // the classic view: C = [-2, 1] x [-1.5, 1.5]
+    double c0_0    = -2.0;
+    double c1_0    = -1.5;
+    double c0_step =  3.0 / size;
+    double c1_step =  3.0 / size;
+    double esc2    =  4.0;
+
+    // non-escaping pixels count to limit + 1 - that must be a legal
+    // color index on the device
+    output_null dev (size, size, limit + 1);
+
+    profiler::high_resolution_timer timer;
+
+    // chop the frame into horizontal stripes, like the master's job
+    // bucket does, and compute + deliver them one by one
+    int n_x = size / boxes;
+
+    for ( int box = 0; box < boxes; box++ )
+    {
+      int x0 = box * n_x;
+
+      // the last stripe picks up the remainder
+      if ( box == boxes - 1 )
+      {
+        n_x = size - x0;
+      }
+
+      std::vector <std::vector <int> > data (n_x);
+
+      for ( int x = 0; x < n_x; x++ )
+      {
+        data[x].resize (size);
+
+        double c0 = c0_0 + (x0 + x) * c0_step;
+
+        for ( int y = 0; y < size; y++ )
+        {
+          data[x][y] = iterate_scalar (c0, c1_0 + y * c1_step, limit, esc2);
+        }
+      }
+
+      dev.paint_box (x0, n_x, 0, size, data, "bench");
+    }
+
+    double elapsed = timer.elapsed ();
+    double pixels  = (double) size * (double) size;
+
+    result.put ("mandelbrot.render.makespan_secs",  elapsed);
+    result.put ("mandelbrot.render.pixels_per_sec", pixels / elapsed);
+  }
+  catch ( const char * msg )
+  {
+    // output_null flags malformed boxes this way
+    std::cerr << "device error: " << msg << std::endl;
+    return 255;
+  }
+  catch ( const std::exception & e )
+  {
+    std::cerr << "std: exception caught: " << e.what () << std::endl;
+    return 255;
+  }
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+//  Copyright (c) 2008 Michael Miceli and Christopher Miceli
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/lexical_cast.hpp>
+#include "../bench_result.hpp"
+#include "../../MapReduce/trunk/source/utils/high_resolution_timer.hpp"
+#include "../../MapReduce/trunk/source/utils/ChunkReader.hpp"
+#include "../../MapReduce/trunk/source/worker/IntermediateStore.hpp"
+
+/*********************************************************
+ * bench_mapreduce runs a complete wordcount - generate  *
+ * input, map every chunk with the combiner pattern the  *
+ * samples use, merge the per-chunk counts - through the *
+ * framework's own ChunkReader and IntermediateStore,    *
+ * which is the worker's hot loop minus network and      *
+ * adverts.  Where mapreduce_bench (under trunk/source/  *
+ * bench) isolates single hot paths, this driver reports *
+ * the end-to-end job makespan the suite tracks across   *
+ * checkouts.                                            *
+ *                                                       *
+ *   bench_mapreduce <result-file> [chunks] [chunkKB]    *
+ *                                                       *
+ * defaults: 32 chunks of 2048 KB.                       *
+ * ******************************************************/
+namespace {
+   using namespace MapReduce;
+
+   /*********************************************************
+    * generate_ writes numChunks files of synthetic text,   *
+    * each chunkBytes long, drawn from a 10000 word         *
+    * vocabulary, and returns their paths.                  *
+    * ******************************************************/
+   std::vector<std::string> generate_(int numChunks, long chunkBytes) {
+      std::vector<std::string> paths;
+      for(int i = 0; i < numChunks; i++) {
+         std::string path("bench-wordcount-"
+                          + boost::lexical_cast<std::string>(i) + ".tmp");
+         std::ofstream out(path.c_str(), std::ios::trunc);
+         long written = 0;
+         int word = 0;
+         while(written < chunkBytes) {
+            std::string token("word"
+                              + boost::lexical_cast<std::string>(word % 10000));
+            out << token << " ";
+            written += token.size() + 1;
+            word++;
+         }
+         paths.push_back(path);
+      }
+      return paths;
+   }
+
+   /*********************************************************
+    * mapChunk_ is the wordcount map with the in-store      *
+    * combiner: first occurrence appends "1", repeats bump  *
+    * the stored count in place via replaceLast.            *
+    * ******************************************************/
+   long mapChunk_(std::string const &path, IntermediateStore &store) {
+      ChunkReader in(path);
+      const char *token;
+      std::size_t size;
+      bool isNew;
+      long words = 0;
+      while(in.nextToken(token, size)) {
+         std::string word(token, size);
+         std::size_t id = store.findOrInsert(word, isNew);
+         if(isNew) {
+            store.appendValue(id, "1");
+         }
+         else {
+            long count = boost::lexical_cast<long>(store.lastValue(id));
+            store.replaceLast(id,
+                              boost::lexical_cast<std::string>(count + 1));
+         }
+         words++;
+      }
+      return words;
+   }
+
+   /*********************************************************
+    * mergeCounts_ is the reduce: fold one chunk's combined *
+    * counts into the global table.                         *
+    * ******************************************************/
+   void mergeCounts_(IntermediateStore const &store,
+                     std::map<std::string, long> &total) {
+      for(std::size_t id = 0; id < store.keyCount(); id++) {
+         total[store.key(id)] +=
+            boost::lexical_cast<long>(store.lastValue(id));
+      }
+   }
+} // namespace
+
+int main(int argc, char **argv) {
+   if(argc < 2) {
+      std::cerr << "usage: bench_mapreduce <result-file> [chunks] [chunkKB]"
+                << std::endl;
+      return 255;
+   }
+   int  numChunks  = argc > 2 ? std::atoi(argv[2]) : 32;
+   long chunkBytes = (argc > 3 ? std::atol(argv[3]) : 2048) * 1024;
+
+   try {
+      bench::result_file result("mapreduce.wordcount", argv[1]);
+      result.put("mapreduce.wordcount.chunks",      (long)numChunks);
+      result.put("mapreduce.wordcount.chunk_bytes", chunkBytes);
+
+      std::vector<std::string> paths = generate_(numChunks, chunkBytes);
+
+      high_resolution_timer timer;
+      long words = 0;
+      std::map<std::string, long> total;
+      for(int i = 0; i < numChunks; i++) {
+         IntermediateStore store;
+         words += mapChunk_(paths[i], store);
+         mergeCounts_(store, total);
+      }
+      double elapsed = timer.elapsed();
+
+      double totalMB = (numChunks * (double)chunkBytes) / (1024.0 * 1024.0);
+      result.put("mapreduce.wordcount.makespan_secs", elapsed);
+      result.put("mapreduce.wordcount.mb_per_sec",    totalMB / elapsed);
+      result.put("mapreduce.wordcount.words_per_sec", words / elapsed);
+      result.put("mapreduce.wordcount.distinct_keys", (long)total.size());
+
+      for(int i = 0; i < numChunks; i++) {
+         std::remove(paths[i].c_str());
+      }
+   }
+   catch(saga::exception const &e) {
+      std::cerr << "Saga: exception caught: " << e.what() << std::endl;
+      return 255;
+   }
+   catch(std::exception const &e) {
+      std::cerr << "std: exception caught: " << e.what() << std::endl;
+      return 255;
+   }
+   return 0;
+}
@@ -0,0 +1,130 @@
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <saga/saga.hpp>
+
+#include "../bench_result.hpp"
+#include "../../common/profiler.hpp"
+
+// bench_taskfarming farms short tasks through the local fork adaptor,
+// the way the taskfarming submitter drives its agents.  Every task is
+// /bin/true, so the numbers isolate what the farm pays per task: job
+// description setup, submission, and completion detection.  Two passes
+// are timed - strictly sequential (per-task latency) and a window of
+// in-flight tasks (sustainable throughput).
+//
+//   bench_taskfarming <result-file> [tasks] [window]
+//
+// defaults: 64 tasks, 8 in flight.
+
+namespace
+{
+  saga::job::description task_description (void)
+  {
+    saga::job::description jd;
+
+    jd.set_attribute (saga::job::attributes::description_executable,
+                      "/bin/true");
+    jd.set_attribute (saga::job::attributes::description_interactive,
+                      saga::attributes::common_false);
+
+    return jd;
+  }
+
+  // run 'tasks' jobs one after the other, waiting for each
+  double run_sequential (saga::job::service & js, int tasks)
+  {
+    profiler::high_resolution_timer timer;
+
+    for ( int i = 0; i < tasks; i++ )
+    {
+      saga::job::description jd = task_description ();
+
+      saga::job::job job = js.create_job (jd);
+
+      job.run  ();
+      job.wait ();
+    }
+
+    return timer.elapsed ();
+  }
+
+  // keep up to 'window' jobs in flight until 'tasks' jobs finished
+  double run_windowed (saga::job::service & js, int tasks, int window)
+  {
+    profiler::high_resolution_timer timer;
+
+    std::vector <saga::job::job> running;
+
+    int started = 0;
+
+    while ( started < tasks || ! running.empty () )
+    {
+      // fill the window
+      while ( started < tasks && (int) running.size () < window )
+      {
+        saga::job::description jd = task_description ();
+
+        saga::job::job job = js.create_job (jd);
+
+        job.run ();
+
+        running.push_back (job);
+        started++;
+      }
+
+      // reap the oldest job - short tasks finish in submission order
+      // often enough that this keeps the window full
+      running.front ().wait ();
+      running.erase (running.begin ());
+    }
+
+    return timer.elapsed ();
+  }
+}
+
+int main (int argc, char ** argv)
+{
+  if ( argc < 2 )
+  {
+    std::cerr << "usage: bench_taskfarming <result-file> [tasks] [window]"
+              << std::endl;
+    return 255;
+  }
+
+  int tasks  = argc > 2 ? ::atoi (argv[2]) : 64;
+  int window = argc > 3 ? ::atoi (argv[3]) :  8;
+
+  try
+  {
+    bench::result_file result ("taskfarming.farm", argv[1]);
+
+    result.put ("taskfarming.farm.tasks",  (long) tasks);
+    result.put ("taskfarming.farm.window", (long) window);
+
+    saga::job::service js ("fork://localhost/");
+
+    double sequential = run_sequential (js, tasks);
+    double windowed   = run_windowed   (js, tasks, window);
+
+    result.put ("taskfarming.farm.seq_makespan_secs",     sequential);
+    result.put ("taskfarming.farm.seq_task_latency_secs", sequential / tasks);
+    result.put ("taskfarming.farm.win_makespan_secs",     windowed);
+    result.put ("taskfarming.farm.win_tasks_per_sec",     tasks / windowed);
+  }
+  catch ( const saga::exception & e )
+  {
+    std::cerr << "Saga: exception caught: " << e.what () << std::endl;
+    return 255;
+  }
+  catch ( const std::exception & e )
+  {
+    std::cerr << "std: exception caught: " << e.what () << std::endl;
+    return 255;
+  }
+
+  return 0;
+}
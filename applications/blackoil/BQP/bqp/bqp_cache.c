@@ -0,0 +1,177 @@
+/* bqp_cache - native batch-queue wait-time prediction cache.
+ *
+ * Concurrency scheme: every entry keeps two statistics slots.  Readers
+ * use the slot named by the global 'active' index; the refresh thread
+ * only ever writes the inactive slot and flips the index (behind a
+ * memory barrier) once a full bulk round is done.  Since the active
+ * slot is never written, queries need no lock at all.  Registration
+ * appends behind the published entry count, so readers scanning
+ * [0, n_entries) never see a half-written name.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "bqp_cache.h"
+
+typedef struct cache_entry
+{
+  char machine[BQP_CACHE_NAME_LEN];
+  char queue[BQP_CACHE_NAME_LEN];
+  bqp_cache_stats stats[2];
+} cache_entry;
+
+static cache_entry entries[BQP_CACHE_MAX_ENTRIES];
+static volatile int n_entries = 0;
+static volatile int active = 0;
+
+static bqp_cache_fetch_fn fetch_fn = NULL;
+static int refresh_interval = 60;
+static int max_age = 300;
+
+static volatile int stop_requested = 0;
+static int thread_running = 0;
+static pthread_t refresh_thread;
+/* serializes registration only - queries never touch it */
+static pthread_mutex_t add_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* one bulk round: re-fetch every registered pair into the inactive
+ * slots, then flip.  A failed fetch carries the previous numbers
+ * forward (their timestamp ages, so the staleness bound still
+ * invalidates them eventually) */
+static void
+refresh_round(void)
+{
+  int next = 1 - active;
+  int n = n_entries;
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      if (fetch_fn == NULL ||
+          fetch_fn(entries[i].machine, entries[i].queue,
+                   &entries[i].stats[next]) != 0)
+        {
+          entries[i].stats[next] = entries[i].stats[active];
+        }
+      else
+        {
+          entries[i].stats[next].fetched = time(NULL);
+        }
+    }
+
+  __sync_synchronize();
+  active = next;
+}
+
+static void *
+refresh_main(void *arg)
+{
+  int slept;
+
+  while (!stop_requested)
+    {
+      refresh_round();
+      /* sleep in one second steps so shutdown stays prompt */
+      for (slept = 0; slept < refresh_interval && !stop_requested; slept++)
+        sleep(1);
+    }
+  return NULL;
+}
+
+int
+bqp_cache_init(bqp_cache_fetch_fn fetch, int refresh_secs, int max_age_secs)
+{
+  if (thread_running)
+    return 0;
+
+  fetch_fn = fetch;
+  if (refresh_secs > 0)
+    refresh_interval = refresh_secs;
+  if (max_age_secs > 0)
+    max_age = max_age_secs;
+
+  stop_requested = 0;
+  if (pthread_create(&refresh_thread, NULL, refresh_main, NULL) != 0)
+    {
+      fprintf(stderr, "bqp_cache: cannot start refresh thread\n");
+      return -1;
+    }
+  thread_running = 1;
+  return 0;
+}
+
+void
+bqp_cache_shutdown(void)
+{
+  if (!thread_running)
+    return;
+  stop_requested = 1;
+  pthread_join(refresh_thread, NULL);
+  thread_running = 0;
+  n_entries = 0;
+}
+
+int
+bqp_cache_add(const char *machine, const char *queue)
+{
+  int i;
+  int rc = 0;
+
+  pthread_mutex_lock(&add_mutex);
+  for (i = 0; i < n_entries; i++)
+    {
+      if (strncmp(entries[i].machine, machine, BQP_CACHE_NAME_LEN) == 0 &&
+          strncmp(entries[i].queue, queue, BQP_CACHE_NAME_LEN) == 0)
+        {
+          pthread_mutex_unlock(&add_mutex);
+          return 0;
+        }
+    }
+  if (n_entries >= BQP_CACHE_MAX_ENTRIES)
+    {
+      rc = -1;
+    }
+  else
+    {
+      i = n_entries;
+      strncpy(entries[i].machine, machine, BQP_CACHE_NAME_LEN - 1);
+      entries[i].machine[BQP_CACHE_NAME_LEN - 1] = '\0';
+      strncpy(entries[i].queue, queue, BQP_CACHE_NAME_LEN - 1);
+      entries[i].queue[BQP_CACHE_NAME_LEN - 1] = '\0';
+      memset(entries[i].stats, 0, sizeof(entries[i].stats));
+      /* publish the entry only after the names are complete */
+      __sync_synchronize();
+      n_entries = i + 1;
+    }
+  pthread_mutex_unlock(&add_mutex);
+  return rc;
+}
+
+int
+bqp_cache_lookup(const char *machine, const char *queue,
+                 bqp_cache_stats *out)
+{
+  int a = active;
+  int n = n_entries;
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      if (strncmp(entries[i].machine, machine, BQP_CACHE_NAME_LEN) == 0 &&
+          strncmp(entries[i].queue, queue, BQP_CACHE_NAME_LEN) == 0)
+        {
+          if (entries[i].stats[a].fetched == 0 ||
+              time(NULL) - entries[i].stats[a].fetched > max_age)
+            return -1;          /* known, but beyond the staleness bound */
+          *out = entries[i].stats[a];
+          return 0;
+        }
+    }
+
+  /* unknown pair: register it so the next bulk round covers it */
+  bqp_cache_add(machine, queue);
+  return -1;
+}
@@ -0,0 +1,67 @@
+/* bqp_cache - native batch-queue wait-time prediction cache.
+ *
+ * The BQP tools resolve queue-wait predictions with one remote (cnet)
+ * lookup per query, which costs hundreds of milliseconds.  A scheduler
+ * asking on every placement decision needs answers in microseconds, so
+ * this layer bulk-fetches the statistics for all registered
+ * machine/queue pairs from a background refresh thread and serves them
+ * out of an in-memory table that concurrent scheduler threads read
+ * without taking any lock.  Answers are staleness-bounded: a lookup
+ * only succeeds while the cached numbers are younger than the
+ * configured maximum age.
+ */
+
+#ifndef BQP_CACHE_H
+#define BQP_CACHE_H
+
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BQP_CACHE_MAX_ENTRIES 256
+#define BQP_CACHE_NAME_LEN    64
+
+/* the summary statistics of the wait-time distribution the scheduler
+ * asks for; all times in seconds */
+typedef struct bqp_cache_stats
+{
+  double median_wait;
+  double mean_wait;
+  double q95_wait;            /* 95th percentile */
+  time_t fetched;             /* when these numbers were fetched */
+} bqp_cache_stats;
+
+/* fetch hook: fill *out for machine/queue and return 0 on success.
+ * This wraps the remote lookup (cnet against the BQP service); it is
+ * called only from the refresh thread, never from a query */
+typedef int (*bqp_cache_fetch_fn)(const char *machine, const char *queue,
+                                  bqp_cache_stats *out);
+
+/* start the cache: fetch is the remote lookup, refresh_secs the bulk
+ * refresh period, max_age_secs the staleness bound for answers.
+ * Returns 0 on success */
+int bqp_cache_init(bqp_cache_fetch_fn fetch, int refresh_secs,
+                   int max_age_secs);
+
+/* stop the refresh thread and drop all cached state */
+void bqp_cache_shutdown(void);
+
+/* register a machine/queue pair for bulk refresh; returns 0 on
+ * success, -1 when the table is full.  Registering an already known
+ * pair is a no-op */
+int bqp_cache_add(const char *machine, const char *queue);
+
+/* lock-free lookup: returns 0 and fills *out if fresh statistics are
+ * cached for machine/queue, -1 if the pair is unknown or the cached
+ * numbers exceed the staleness bound.  The pair is registered as a
+ * side effect, so the next refresh round picks it up */
+int bqp_cache_lookup(const char *machine, const char *queue,
+                     bqp_cache_stats *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BQP_CACHE_H */
@@ -0,0 +1,211 @@
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef APPLICATIONS_COMMON_ADVERT_BULK_HPP
+#define APPLICATIONS_COMMON_ADVERT_BULK_HPP
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <saga/saga.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+//  Bulk helpers for the saga advert service.
+//
+//  Every application in this tree talks to the advert service, and every one
+//  of them hits the same ceiling: the per-call round trip.  These helpers
+//  bundle the recurring access patterns - setting many attributes, opening
+//  many entries, reading a whole subtree - into single-wait bulk operations,
+//  so the pattern is written (and tuned) once instead of once per
+//  application.
+//
+//  The header is self-contained and depends on saga only.  It is included
+//  via a path relative to the applications/ directory.
+//
+namespace advert_bulk
+{
+  /////////////////////////////////////////////////////////////////////////////
+  //  sets all given (key, value) attributes on one advert entry or
+  //  directory.  The writes are submitted as asynchronous tasks and awaited
+  //  together, so n attributes cost one round-trip latency instead of n.
+  //
+  template <typename AdvertObject>
+  inline void set_attributes(AdvertObject & obj,
+    std::vector<std::pair<std::string, std::string> > const & attributes)
+  {
+    saga::task_container tc;
+
+    std::vector<std::pair<std::string, std::string> >::const_iterator it;
+    for(it = attributes.begin(); it != attributes.end(); ++it)
+    {
+      tc.add_task(obj.template set_attribute<saga::task_base::Async>(
+        it->first, it->second));
+    }
+
+    tc.wait();
+  }
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  opens (or, with saga::advert::Create in the mode, creates) several
+  //  entries of one directory in a single wait.  The entries are returned
+  //  in the order of the given names.
+  //
+  inline std::vector<saga::advert::entry>
+  open_entries(saga::advert::directory & dir,
+               std::vector<std::string> const & names,
+               int mode)
+  {
+    std::vector<saga::task> tasks;
+    saga::task_container tc;
+
+    std::vector<std::string>::const_iterator it;
+    for(it = names.begin(); it != names.end(); ++it)
+    {
+      saga::task t = dir.open<saga::task_base::Async>(saga::url(*it), mode);
+      tasks.push_back(t);
+      tc.add_task(t);
+    }
+
+    tc.wait();
+
+    std::vector<saga::advert::entry> entries;
+
+    std::vector<saga::task>::iterator tit;
+    for(tit = tasks.begin(); tit != tasks.end(); ++tit)
+    {
+      entries.push_back(tit->get_result<saga::advert::entry>());
+    }
+
+    return entries;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  prefetch_cache walks an advert directory subtree once, pulls the scalar
+  //  attributes of every entry with bulk reads, and answers attribute
+  //  queries locally afterwards.  Use it where code would otherwise issue a
+  //  long sequence of open/get_attribute calls against entries it is going
+  //  to read anyway (startup bootstrap, work queue scans, ...).
+  //
+  //  The cache is a snapshot: it does not track later changes in the advert
+  //  database.  Call prefetch() again to refresh it.
+  //
+  class prefetch_cache
+  {
+  private:
+
+    typedef std::map<std::string, std::string> attribute_map_t;
+
+    // entry path (relative to the prefetched directory) -> attributes
+    std::map<std::string, attribute_map_t> entries_;
+
+    void prefetch_(saga::advert::directory dir, std::string const & prefix)
+    {
+      std::vector<saga::url> listing = dir.list("*");
+
+      std::vector<saga::url>::iterator it;
+      for(it = listing.begin(); it != listing.end(); ++it)
+      {
+        // reduce the url to the last path component
+        std::string name((*it).get_path());
+        std::string::size_type pos = name.rfind("/");
+        if(pos != std::string::npos) name = name.substr(pos + 1);
+
+        if(dir.is_dir(*it))
+        {
+          prefetch_(dir.open_dir(*it, saga::advert::Read), prefix + name + "/");
+          continue;
+        }
+
+        saga::advert::entry e = dir.open(*it, saga::advert::Read);
+        attribute_map_t & attribs = entries_[prefix + name];
+
+        // fetch all scalar attributes of this entry in a single wait
+        std::vector<std::string> keys = e.list_attributes();
+        std::vector<std::string> fetched;
+        std::vector<saga::task>  tasks;
+        saga::task_container     tc;
+
+        std::vector<std::string>::iterator kit;
+        for(kit = keys.begin(); kit != keys.end(); ++kit)
+        {
+          if(e.attribute_is_vector(*kit)) continue;
+
+          saga::task t = e.get_attribute<saga::task_base::Async>(*kit);
+          fetched.push_back(*kit);
+          tasks.push_back(t);
+          tc.add_task(t);
+        }
+
+        tc.wait();
+
+        for(std::vector<saga::task>::size_type i = 0; i < tasks.size(); ++i)
+        {
+          attribs[fetched[i]] = tasks[i].get_result<std::string>();
+        }
+      }
+    }
+
+  public:
+
+    prefetch_cache()
+    {
+    }
+
+    // reads the given directory and everything below it into the cache,
+    // replacing a previous snapshot
+    void prefetch(saga::advert::directory dir)
+    {
+      entries_.clear();
+      prefetch_(dir, "");
+    }
+
+    // lists the paths of all cached entries, relative to the prefetched
+    // directory
+    std::vector<std::string> list_entries(void) const
+    {
+      std::vector<std::string> paths;
+
+      std::map<std::string, attribute_map_t>::const_iterator it;
+      for(it = entries_.begin(); it != entries_.end(); ++it)
+      {
+        paths.push_back(it->first);
+      }
+
+      return paths;
+    }
+
+    bool has_entry(std::string const & path) const
+    {
+      return entries_.find(path) != entries_.end();
+    }
+
+    bool has_attribute(std::string const & path, std::string const & key) const
+    {
+      std::map<std::string, attribute_map_t>::const_iterator it =
+        entries_.find(path);
+
+      if(it == entries_.end()) return false;
+      return it->second.find(key) != it->second.end();
+    }
+
+    // returns the cached value, or an empty string for unknown
+    // entries/keys - check has_attribute() where that is ambiguous
+    std::string get_attribute(std::string const & path,
+                              std::string const & key) const
+    {
+      std::map<std::string, attribute_map_t>::const_iterator it =
+        entries_.find(path);
+
+      if(it == entries_.end()) return "";
+
+      attribute_map_t::const_iterator ait = it->second.find(key);
+      if(ait == it->second.end()) return "";
+
+      return ait->second;
+    }
+  };
+}
+
+#endif // APPLICATIONS_COMMON_ADVERT_BULK_HPP
@@ -0,0 +1,217 @@
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef APPLICATIONS_COMMON_BUFFER_POOL_HPP
+#define APPLICATIONS_COMMON_BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+//  Pooled message buffers for the stream I/O paths.
+//
+//  The master/worker conversations allocate small scratch and receive
+//  buffers on every protocol step; with hundreds of workers talking to a
+//  master that is measurable allocator pressure.  This header keeps those
+//  buffers in size-classed pools instead: a released buffer parks in a
+//  small per-thread cache (no lock on the fast path), overflows into a
+//  mutex-guarded shared pool, and comes back with its grown capacity
+//  intact - so a conversation-sized receive buffer is reused across
+//  conversations rather than re-grown for each one.
+//
+//  Buffers are handed out through RAII handles:
+//
+//      buffer_pool::handle<std::string> scratch(256);
+//      scratch->append(...);                // handle acts as Buffer*
+//
+//  The handle acquires a cleared buffer with at least the requested
+//  capacity and returns it to the pool on destruction.  Buffer is
+//  std::string or std::vector<char>; oversized requests (beyond the
+//  largest class) fall back to plain allocation and are simply deleted
+//  on release.
+//
+namespace buffer_pool
+{
+  //  size classes: 256 B << k, eight classes up to 32 KB.  Released
+  //  buffers are binned by the largest class their capacity covers, so
+  //  a buffer that grew serves larger requests from then on.
+  const std::size_t NUM_CLASSES     = 8;
+  const std::size_t MIN_CLASS_SIZE  = 256;
+  //  caps keep idle pools small; beyond them buffers are freed
+  const std::size_t MAX_PER_THREAD  = 8;
+  const std::size_t MAX_SHARED      = 64;
+
+  inline std::size_t classSize(std::size_t k)
+  {
+     return MIN_CLASS_SIZE << k;
+  }
+
+  //  smallest class that can hold size, or NUM_CLASSES when unpooled
+  inline std::size_t classForRequest(std::size_t size)
+  {
+     for(std::size_t k = 0; k < NUM_CLASSES; k++) {
+        if(size <= classSize(k)) {
+           return k;
+        }
+     }
+     return NUM_CLASSES;
+  }
+
+  //  largest class the capacity covers, for binning on release
+  inline std::size_t classForCapacity(std::size_t capacity)
+  {
+     std::size_t k = 0;
+     while(k + 1 < NUM_CLASSES && classSize(k + 1) <= capacity) {
+        ++k;
+     }
+     return k;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  the pool itself: one instance per buffer type, shared free lists
+  //  behind a mutex plus an unlocked cache per thread
+  template <typename Buffer>
+  class pool
+  {
+   public:
+     static pool &instance(void)
+     {
+        static pool p;
+        return p;
+     }
+
+     Buffer *acquire(std::size_t size)
+     {
+        std::size_t k = classForRequest(size);
+        if(k == NUM_CLASSES) {
+           Buffer *b = new Buffer;
+           b->reserve(size);
+           return b;
+        }
+
+        cache_t &c = cache_();
+        //  fast path: this thread released one earlier
+        if(!c.free_[k].empty()) {
+           Buffer *b = c.free_[k].back();
+           c.free_[k].pop_back();
+           b->clear();
+           return b;
+        }
+
+        {
+           boost::mutex::scoped_lock lock(mtx_);
+           if(!shared_[k].empty()) {
+              Buffer *b = shared_[k].back();
+              shared_[k].pop_back();
+              b->clear();
+              return b;
+           }
+        }
+
+        Buffer *b = new Buffer;
+        b->reserve(classSize(k));
+        return b;
+     }
+
+     void release(Buffer *b)
+     {
+        if(b == NULL) {
+           return;
+        }
+        if(b->capacity() < MIN_CLASS_SIZE || b->capacity() > classSize(NUM_CLASSES - 1)) {
+           delete b;
+           return;
+        }
+
+        std::size_t k = classForCapacity(b->capacity());
+
+        cache_t &c = cache_();
+        if(c.free_[k].size() < MAX_PER_THREAD) {
+           c.free_[k].push_back(b);
+           return;
+        }
+
+        boost::mutex::scoped_lock lock(mtx_);
+        if(shared_[k].size() < MAX_SHARED) {
+           shared_[k].push_back(b);
+           return;
+        }
+        delete b;
+     }
+
+   private:
+     struct cache_t
+     {
+        std::vector<Buffer*> free_[NUM_CLASSES];
+
+        //  a dying thread hands its cache to the shared pool
+        ~cache_t()
+        {
+           pool &p = pool::instance();
+           boost::mutex::scoped_lock lock(p.mtx_);
+           for(std::size_t k = 0; k < NUM_CLASSES; k++) {
+              while(!free_[k].empty()) {
+                 Buffer *b = free_[k].back();
+                 free_[k].pop_back();
+                 if(p.shared_[k].size() < MAX_SHARED) {
+                    p.shared_[k].push_back(b);
+                 }
+                 else {
+                    delete b;
+                 }
+              }
+           }
+        }
+     };
+
+     pool() {}
+
+     cache_t &cache_(void)
+     {
+        cache_t *c = tls_.get();
+        if(c == NULL) {
+           c = new cache_t;
+           tls_.reset(c);
+        }
+        return *c;
+     }
+
+     boost::mutex mtx_;
+     std::vector<Buffer*> shared_[NUM_CLASSES];
+     boost::thread_specific_ptr<cache_t> tls_;
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  RAII handle: acquires on construction, releases on destruction.
+  //  Noncopyable - a buffer has exactly one owner at a time.
+  template <typename Buffer>
+  class handle
+  {
+   public:
+     explicit handle(std::size_t size = MIN_CLASS_SIZE)
+       : buf_(pool<Buffer>::instance().acquire(size))
+     {
+     }
+
+     ~handle()
+     {
+        pool<Buffer>::instance().release(buf_);
+     }
+
+     Buffer &operator*(void)  const { return *buf_; }
+     Buffer *operator->(void) const { return  buf_; }
+     Buffer *get(void)        const { return  buf_; }
+
+   private:
+     handle(handle const &);
+     handle &operator=(handle const &);
+
+     Buffer *buf_;
+  };
+}
+
+#endif // APPLICATIONS_COMMON_BUFFER_POOL_HPP
@@ -0,0 +1,262 @@
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef APPLICATIONS_COMMON_HANDLE_CACHE_HPP
+#define APPLICATIONS_COMMON_HANDLE_CACHE_HPP
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <saga/saga.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+//  A process-wide cache of saga object handles.
+//
+//  Every application in this tree re-opens the same advert paths over and
+//  over: workers re-resolve the session directories the master just
+//  created, polling loops open the same work item entries once per round.
+//  Each open is a full namespace resolution round trip on the backend,
+//  even though the handle it yields is identical to the one the last open
+//  yielded.  This cache memoizes advert directory, advert entry and
+//  filesystem file handles keyed by (session, url, open mode), so the
+//  round trip is paid once per distinct object instead of once per open.
+//
+//  Only plain opens belong in the cache.  Opens whose side effect is the
+//  point - saga::advert::Exclusive claims in particular - must keep going
+//  to the server, and are rejected here.
+//
+//  Staleness is the caller's problem, as only the caller knows when a
+//  cached handle can have died (the master removed the entry, a recovery
+//  recreated it): call invalidate() with the url, and the next open
+//  resolves it afresh.  All methods are thread safe.
+//
+//  The header is self-contained and depends on saga and boost.thread
+//  only.  It is included via a path relative to the applications/
+//  directory.
+//
+namespace handle_cache
+{
+  class cache
+  {
+  private:
+
+    std::map<std::string, saga::advert::directory> dirs_;
+    std::map<std::string, saga::advert::entry>     entries_;
+    std::map<std::string, saga::filesystem::file>  files_;
+    boost::mutex                                   mtx_;
+
+    // cache key: session uuid, url and mode, newline separated (urls
+    // cannot contain raw newlines)
+    static std::string key_(saga::session s, std::string const & url, int mode)
+    {
+      return s.get_id().string() + "\n" + url + "\n"
+           + boost::lexical_cast<std::string>(mode);
+    }
+
+    // the url of entry 'name' under 'parent', as a key string
+    static std::string join_(saga::advert::directory & parent,
+                             std::string const & name)
+    {
+      std::string url = parent.get_url().get_string();
+
+      if(url.empty() || url[url.size() - 1] != '/') url += "/";
+
+      return url + name;
+    }
+
+    // erase every entry of 'm' whose key refers to 'url', over all
+    // sessions and modes.  The maps stay small (one entry per distinct
+    // object the process touches), so the scan is cheap.
+    template <typename Map>
+    static void erase_url_(Map & m, std::string const & url)
+    {
+      typename Map::iterator it = m.begin();
+
+      while(it != m.end())
+      {
+        std::string const & k = it->first;
+
+        std::string::size_type a = k.find('\n');
+        std::string::size_type b = k.rfind('\n');
+
+        if(a != std::string::npos && b > a + 1 &&
+           k.compare(a + 1, b - a - 1, url) == 0)
+        {
+          m.erase(it++);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+
+  public:
+
+    // the process-wide instance - one handle table shared by all
+    // components of the application
+    static cache & instance(void)
+    {
+      static cache c;
+      return c;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    //  memoized opens.  A hit returns the cached handle without
+    //  contacting the backend; a miss opens and remembers.
+    //
+    saga::advert::directory open_dir(saga::session s, saga::url url, int mode)
+    {
+      std::string k = key_(s, url.get_string(), mode);
+
+      {
+        boost::mutex::scoped_lock lock(mtx_);
+
+        std::map<std::string, saga::advert::directory>::iterator it =
+          dirs_.find(k);
+
+        if(it != dirs_.end()) return it->second;
+      }
+
+      // resolve outside the lock - an advert round trip is no time to
+      // stall every other component
+      saga::advert::directory dir(s, url, mode);
+
+      boost::mutex::scoped_lock lock(mtx_);
+      dirs_.insert(std::make_pair(k, dir));
+      return dir;
+    }
+
+    saga::advert::directory open_dir(saga::url url, int mode)
+    {
+      return open_dir(saga::get_default_session(), url, mode);
+    }
+
+    saga::advert::entry open_entry(saga::session s, saga::url url, int mode)
+    {
+      if(mode & saga::advert::Exclusive)
+      {
+        // an exclusive create is a claim - it must hit the server
+        return saga::advert::entry(s, url, mode);
+      }
+
+      std::string k = key_(s, url.get_string(), mode);
+
+      {
+        boost::mutex::scoped_lock lock(mtx_);
+
+        std::map<std::string, saga::advert::entry>::iterator it =
+          entries_.find(k);
+
+        if(it != entries_.end()) return it->second;
+      }
+
+      saga::advert::entry entry(s, url, mode);
+
+      boost::mutex::scoped_lock lock(mtx_);
+      entries_.insert(std::make_pair(k, entry));
+      return entry;
+    }
+
+    saga::advert::entry open_entry(saga::url url, int mode)
+    {
+      return open_entry(saga::get_default_session(), url, mode);
+    }
+
+    // memoized open of the named entry under an already open directory.
+    // Session and url are taken from the parent, the open itself goes
+    // through the parent handle.
+    saga::advert::entry open_entry(saga::advert::directory & parent,
+                                   std::string const & name, int mode)
+    {
+      if(mode & saga::advert::Exclusive)
+      {
+        return parent.open(saga::url(name), mode);
+      }
+
+      std::string k = key_(parent.get_session(), join_(parent, name), mode);
+
+      {
+        boost::mutex::scoped_lock lock(mtx_);
+
+        std::map<std::string, saga::advert::entry>::iterator it =
+          entries_.find(k);
+
+        if(it != entries_.end()) return it->second;
+      }
+
+      saga::advert::entry entry = parent.open(saga::url(name), mode);
+
+      boost::mutex::scoped_lock lock(mtx_);
+      entries_.insert(std::make_pair(k, entry));
+      return entry;
+    }
+
+    saga::filesystem::file open_file(saga::session s, saga::url url, int mode)
+    {
+      std::string k = key_(s, url.get_string(), mode);
+
+      {
+        boost::mutex::scoped_lock lock(mtx_);
+
+        std::map<std::string, saga::filesystem::file>::iterator it =
+          files_.find(k);
+
+        if(it != files_.end()) return it->second;
+      }
+
+      saga::filesystem::file file(s, url, mode);
+
+      boost::mutex::scoped_lock lock(mtx_);
+      files_.insert(std::make_pair(k, file));
+      return file;
+    }
+
+    saga::filesystem::file open_file(saga::url url, int mode)
+    {
+      return open_file(saga::get_default_session(), url, mode);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    //  invalidation hooks.  Drop every handle of the given url, over all
+    //  sessions and modes - the next open resolves it afresh.
+    //
+    void invalidate(std::string const & url)
+    {
+      boost::mutex::scoped_lock lock(mtx_);
+
+      erase_url_(dirs_,    url);
+      erase_url_(entries_, url);
+      erase_url_(files_,   url);
+    }
+
+    void invalidate(saga::url const & url)
+    {
+      invalidate(saga::url(url).get_string());
+    }
+
+    // invalidate the named entry under an already open directory - the
+    // counterpart of the parent-relative open_entry above
+    void invalidate(saga::advert::directory & parent,
+                    std::string const & name)
+    {
+      invalidate(join_(parent, name));
+    }
+
+    // drop everything, e.g. between two sessions of a long-lived process
+    void clear(void)
+    {
+      boost::mutex::scoped_lock lock(mtx_);
+
+      dirs_.clear();
+      entries_.clear();
+      files_.clear();
+    }
+  };
+}
+
+#endif // APPLICATIONS_COMMON_HANDLE_CACHE_HPP
@@ -0,0 +1,229 @@
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef APPLICATIONS_COMMON_PROFILER_HPP
+#define APPLICATIONS_COMMON_PROFILER_HPP
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/time.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//  Shared hot-path instrumentation.
+//
+//  Grown out of the timers under MapReduce/trunk/source/utils/, promoted
+//  here so every application in the tree can use the same machinery.  The
+//  design rules:
+//
+//   - a scoped_timer on the hot path only reads the clock and updates a
+//     plain per-thread table: no locks, no atomics, no allocation after
+//     the first sample of a name;
+//   - per-thread tables register themselves once (under a mutex, off the
+//     hot path) with a process-wide registry;
+//   - at process exit the registry aggregates all tables and prints one
+//     report per timer name to stderr: total, call count, mean, min, max.
+//
+//  Usage:
+//
+//      { profiler::scoped_timer t ("master.assign_maps"); ... }
+//
+namespace profiler
+{
+  /////////////////////////////////////////////////////////////////////////////
+  //  wall-clock timer with microsecond resolution
+  //
+  class high_resolution_timer
+  {
+  private:
+    struct timeval start_;
+
+  public:
+    high_resolution_timer()
+    {
+      restart();
+    }
+
+    void restart()
+    {
+      gettimeofday(&start_, 0);
+    }
+
+    // elapsed seconds since construction or the last restart()
+    double elapsed() const
+    {
+      struct timeval now;
+      gettimeofday(&now, 0);
+
+      return double(now.tv_sec - start_.tv_sec)
+           + double(now.tv_usec - start_.tv_usec) * 1e-6;
+    }
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  accumulated samples of one timer name
+  //
+  struct counter
+  {
+    double        sum;
+    double        min;
+    double        max;
+    unsigned long count;
+
+    counter() : sum(0.0), min(0.0), max(0.0), count(0)
+    {
+    }
+
+    void add(double v)
+    {
+      if(count == 0 || v < min) min = v;
+      if(count == 0 || v > max) max = v;
+      sum += v;
+      ++count;
+    }
+  };
+
+  typedef std::map<std::string, counter> table_t;
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  process-wide registry of per-thread tables.  Threads touch only
+  //  their own table; the registry mutex guards registration and the
+  //  final report, never a sample.
+  //
+  class registry
+  {
+  private:
+    pthread_mutex_t        mtx_;
+    pthread_key_t          key_;
+    std::vector<table_t *> tables_;
+
+    registry()
+    {
+      pthread_mutex_init(&mtx_, 0);
+      pthread_key_create(&key_, 0);
+    }
+
+    ~registry()
+    {
+      report();
+
+      std::vector<table_t *>::iterator it;
+      for(it = tables_.begin(); it != tables_.end(); ++it)
+      {
+        delete *it;
+      }
+
+      pthread_key_delete(key_);
+      pthread_mutex_destroy(&mtx_);
+    }
+
+  public:
+    // the first call should happen before worker threads spin up (any
+    // scoped_timer on the main thread does) - function-local statics
+    // are not initialized thread-safely in this code base's compilers
+    static registry & instance()
+    {
+      static registry r;
+      return r;
+    }
+
+    table_t & local_table()
+    {
+      table_t * t = static_cast<table_t *>(pthread_getspecific(key_));
+
+      if(0 == t)
+      {
+        t = new table_t;
+        pthread_setspecific(key_, t);
+
+        pthread_mutex_lock(&mtx_);
+        tables_.push_back(t);
+        pthread_mutex_unlock(&mtx_);
+      }
+
+      return *t;
+    }
+
+    // aggregates all per-thread tables and prints one line per timer
+    // name.  Runs automatically at exit; safe to call earlier for
+    // intermediate snapshots.
+    void report()
+    {
+      pthread_mutex_lock(&mtx_);
+
+      table_t merged;
+
+      std::vector<table_t *>::iterator it;
+      for(it = tables_.begin(); it != tables_.end(); ++it)
+      {
+        table_t::iterator e;
+        for(e = (*it)->begin(); e != (*it)->end(); ++e)
+        {
+          counter & c = merged[e->first];
+
+          if(c.count == 0 || e->second.min < c.min) c.min = e->second.min;
+          if(c.count == 0 || e->second.max > c.max) c.max = e->second.max;
+          c.sum   += e->second.sum;
+          c.count += e->second.count;
+        }
+      }
+
+      table_t::iterator m;
+      for(m = merged.begin(); m != merged.end(); ++m)
+      {
+        counter const & c = m->second;
+        double mean = (c.count != 0) ? c.sum / c.count : 0.0;
+
+        fprintf(stderr,
+                "profiler: %-32s total %10.6f s  count %8lu  "
+                "mean %10.6f s  min %10.6f s  max %10.6f s\n",
+                m->first.c_str(), c.sum, c.count, mean, c.min, c.max);
+      }
+
+      pthread_mutex_unlock(&mtx_);
+    }
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  times the enclosing scope and books the result under 'name' in the
+  //  calling thread's table
+  //
+  class scoped_timer
+  {
+  private:
+    char const * const    name_;
+    high_resolution_timer timer_;
+    bool                  measuring_;
+
+  public:
+    scoped_timer(char const * const name)
+      : name_(name), measuring_(true)
+    {
+    }
+
+    ~scoped_timer()
+    {
+      measure();
+    }
+
+    void restart()
+    {
+      measuring_ = true;
+      timer_.restart();
+    }
+
+    void measure()
+    {
+      if(measuring_)
+      {
+        registry::instance().local_table()[name_].add(timer_.elapsed());
+        measuring_ = false;
+      }
+    }
+  };
+}
+
+#endif // APPLICATIONS_COMMON_PROFILER_HPP
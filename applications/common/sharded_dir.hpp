@@ -0,0 +1,248 @@
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef APPLICATIONS_COMMON_SHARDED_DIR_HPP
+#define APPLICATIONS_COMMON_SHARDED_DIR_HPP
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include <saga/saga.hpp>
+
+#include "handle_cache.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+//  A sharded advert directory, for flat work queues.
+//
+//  Every application in this tree keeps its work items in one flat advert
+//  directory, and every list() on that directory is O(entries) on the advert
+//  server - with a few thousand items the directory scan dominates the
+//  server load.  This wrapper spreads the entries over a fixed number of
+//  subdirectories ('shards'), routing each entry by a hash of its name, so
+//  a single shard stays small.  Readers scan all shards with asynchronous
+//  list() tasks awaited together, so the wall-time cost of a full scan is
+//  one (small) round trip instead of one large one.
+//
+//  The shard count is agreed on through an attribute on the root directory:
+//  whoever creates the queue writes it, later openers read it.  Concurrent
+//  creation is harmless as long as both sides pass the same count - the
+//  attribute write is idempotent then.
+//
+//  Removals are batched: tombstone() only records the entry name, and
+//  flush_tombstones() retires all recorded entries in one bulk of
+//  asynchronous removes.  Consumers that claim-and-delete thousands of
+//  entries thus pay one wait per batch instead of one round trip per entry.
+//
+//  The header is self-contained and depends on saga only.  It is included
+//  via a path relative to the applications/ directory.
+//
+namespace sharded_dir
+{
+  // shard count used when a queue gets created and the caller does not
+  // specify one.  Small on purpose: the win is bounding the per-shard
+  // entry count, not the shard count itself.
+  static const int default_shard_count = 8;
+
+  // root directory attribute carrying the agreed shard count
+  static const char * const shard_count_key = "SHARD_COUNT";
+
+  class directory
+  {
+  private:
+
+    saga::advert::directory                root_;
+    std::vector<saga::advert::directory>   shards_;
+    std::vector<std::string>               tombstones_;
+
+    // stable string hash (djb2) - all parties route an entry name to the
+    // same shard, so hash stability across builds matters more than
+    // distribution quality
+    static unsigned int hash_(std::string const & name)
+    {
+      unsigned int h = 5381;
+
+      for(std::string::size_type i = 0; i < name.size(); ++i)
+      {
+        h = h * 33 + (unsigned char) name[i];
+      }
+
+      return h;
+    }
+
+    saga::advert::directory & shard_(std::string const & name)
+    {
+      return shards_[hash_(name) % shards_.size()];
+    }
+
+  public:
+
+    directory()
+    {
+    }
+
+    // wraps the given root directory.  If the root already carries a shard
+    // count (someone created the queue before us), that count wins;
+    // otherwise 'shards' is written to the root for later openers.  The
+    // given mode is reused for the shard subdirectories, so creators pass
+    // saga::advert::Create and plain readers do not.
+    directory(saga::advert::directory root, int mode,
+              int shards = default_shard_count)
+      : root_(root)
+    {
+      if(root_.attribute_exists(shard_count_key))
+      {
+        shards = ::atoi(root_.get_attribute(shard_count_key).c_str());
+      }
+      else
+      {
+        root_.set_attribute(shard_count_key,
+          boost::lexical_cast<std::string>(shards));
+      }
+
+      if(shards < 1) shards = 1;
+
+      for(int s = 0; s < shards; ++s)
+      {
+        shards_.push_back(root_.open_dir(
+          "shard_" + boost::lexical_cast<std::string>(s), mode));
+      }
+    }
+
+    int shard_count(void) const
+    {
+      return (int) shards_.size();
+    }
+
+    saga::advert::directory & root(void)
+    {
+      return root_;
+    }
+
+    // opens (or, with saga::advert::Create in the mode, creates) the named
+    // entry in its shard.  Names are plain entry names, not paths.
+    saga::advert::entry open(std::string const & name, int mode)
+    {
+      return shard_(name).open(saga::url(name), mode);
+    }
+
+    // like open(), but memoized through the process-wide handle cache
+    // (see handle_cache.hpp): pollers re-visiting the same entries every
+    // round resolve each entry once instead of once per round.  The
+    // caller must not close() the returned handle - it is shared with
+    // the cache - and must call invalidate() once the entry is known to
+    // be gone.
+    saga::advert::entry open_cached(std::string const & name, int mode)
+    {
+      return handle_cache::cache::instance().open_entry(
+        shard_(name), name, mode);
+    }
+
+    // drops the cached handle of the named entry, so the next
+    // open_cached() resolves it afresh
+    void invalidate(std::string const & name)
+    {
+      handle_cache::cache::instance().invalidate(shard_(name), name);
+    }
+
+    // lists the entry names of all shards.  The per-shard list() calls are
+    // submitted as asynchronous tasks and awaited together, so the scan
+    // costs one round-trip latency regardless of the shard count.
+    std::vector<std::string> list(void)
+    {
+      std::vector<saga::task> tasks;
+      saga::task_container    tc;
+
+      for(std::vector<saga::advert::directory>::size_type s = 0;
+          s < shards_.size(); ++s)
+      {
+        saga::task t =
+          shards_[s].list<saga::task_base::Async>("*");
+        tasks.push_back(t);
+        tc.add_task(t);
+      }
+
+      tc.wait();
+
+      std::vector<std::string> names;
+
+      std::vector<saga::task>::iterator tit;
+      for(tit = tasks.begin(); tit != tasks.end(); ++tit)
+      {
+        std::vector<saga::url> listing =
+          tit->get_result<std::vector<saga::url> >();
+
+        std::vector<saga::url>::iterator it;
+        for(it = listing.begin(); it != listing.end(); ++it)
+        {
+          // reduce the url to the last path component
+          std::string name((*it).get_path());
+          std::string::size_type pos = name.rfind("/");
+          if(pos != std::string::npos) name = name.substr(pos + 1);
+
+          names.push_back(name);
+        }
+      }
+
+      return names;
+    }
+
+    // records the named entry for removal; nothing is contacted until
+    // flush_tombstones()
+    void tombstone(std::string const & name)
+    {
+      tombstones_.push_back(name);
+    }
+
+    std::vector<std::string>::size_type pending_tombstones(void) const
+    {
+      return tombstones_.size();
+    }
+
+    // retires all recorded entries in one bulk of asynchronous removes.
+    // Individual failures are swallowed - a tombstoned entry somebody
+    // else removed first is exactly as gone as we want it.
+    void flush_tombstones(void)
+    {
+      if(tombstones_.empty()) return;
+
+      std::vector<saga::task> tasks;
+
+      std::vector<std::string>::iterator it;
+      for(it = tombstones_.begin(); it != tombstones_.end(); ++it)
+      {
+        // a removed entry must not linger in the handle cache
+        invalidate(*it);
+
+        try
+        {
+          tasks.push_back(shard_(*it).remove<saga::task_base::Async>(
+            saga::url(*it), saga::advert::None));
+        }
+        catch(saga::exception const &)
+        {
+          // already gone
+        }
+      }
+
+      std::vector<saga::task>::iterator tit;
+      for(tit = tasks.begin(); tit != tasks.end(); ++tit)
+      {
+        try
+        {
+          tit->wait();
+        }
+        catch(saga::exception const &)
+        {
+          // already gone
+        }
+      }
+
+      tombstones_.clear();
+    }
+  };
+}
+
+#endif // APPLICATIONS_COMMON_SHARDED_DIR_HPP
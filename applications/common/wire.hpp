@@ -0,0 +1,280 @@
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef APPLICATIONS_COMMON_WIRE_HPP
+#define APPLICATIONS_COMMON_WIRE_HPP
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <saga/saga.hpp>
+
+#include "buffer_pool.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+//  Framed messages for the master/worker command streams.
+//
+//  The master/worker conversations in this tree (MapReduce, AllPairs) grew
+//  as sequences of bare string tokens: every step is one small write, read
+//  into a fixed char buff[255], compared against a string constant, and
+//  acked with another small write.  That is fragile - a token split or
+//  coalesced by the transport is misparsed - and slow, because every
+//  handshake step is a sub-MSS write that runs into Nagle/delayed-ack
+//  stalls.
+//
+//  This header frames the conversation instead.  One message is
+//
+//      [4-byte length][varint type][varint part count][parts...]
+//
+//  where each part is varint length plus bytes.  A message gathers any
+//  number of parts (an id plus a whole list of urls, say) into a single
+//  frame and sends it with ONE stream write; the receiver reads whole
+//  frames into a buffer that is reused across messages, looping over
+//  partial reads, so a frame arrives intact no matter how the transport
+//  chops it.  Message types are small app-defined integers.
+//
+//  The header is self-contained and depends on saga only.  It is included
+//  via a path relative to the applications/ directory.
+//
+namespace wire
+{
+  typedef unsigned long msg_type;
+
+  //  hard upper bound for one frame; anything larger is a desynced or
+  //  hostile peer, not a real message
+  const std::size_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+  class error : public std::runtime_error
+  {
+   public:
+    explicit error(const std::string &message) : std::runtime_error(message) {}
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  varint coding (LEB128, low 7 bits first), shared by frame layout and
+  //  anyone who wants compact ints inside a part
+  inline void appendVarint(std::string &out, unsigned long value)
+  {
+     while(value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+     }
+     out.push_back(static_cast<char>(value));
+  }
+
+  inline bool readVarint(const char *data, std::size_t size,
+                         std::size_t &pos, unsigned long &value)
+  {
+     value = 0;
+     unsigned int shift = 0;
+     while(pos < size) {
+        unsigned char byte = static_cast<unsigned char>(data[pos++]);
+        value |= static_cast<unsigned long>(byte & 0x7F) << shift;
+        if((byte & 0x80) == 0) {
+           return true;
+        }
+        shift += 7;
+        if(shift > 63) {
+           return false;
+        }
+     }
+     return false;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  reads exactly size bytes, looping over short reads.  Returns false
+  //  only when the peer closed before the first byte; a close mid-frame
+  //  is an error.
+  template <typename Stream>
+  bool readFull(Stream &s, char *data, std::size_t size)
+  {
+     std::size_t have = 0;
+     while(have < size) {
+        saga::ssize_t n = s.read(saga::buffer(data + have, size - have));
+        if(n <= 0) {
+           if(have == 0) {
+              return false;
+           }
+           throw error("peer closed mid-frame");
+        }
+        have += n;
+     }
+     return true;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  one outgoing message: a type plus gathered parts.  send() lays the
+  //  whole frame out in the caller-reusable scratch buffer and hands it
+  //  to the stream in a single write, so a multi-step payload (id, url
+  //  list, ...) costs one packet-sized write instead of many tiny ones.
+  class message
+  {
+   public:
+     explicit message(msg_type type) : type_(type) {}
+
+     message &add(const std::string &part)
+     {
+        parts_.push_back(part);
+        return *this;
+     }
+
+     message &add(const char *data, std::size_t size)
+     {
+        parts_.push_back(std::string(data, size));
+        return *this;
+     }
+
+     msg_type type(void) const { return type_; }
+
+     void build(std::string &frame) const
+     {
+        std::string body;
+        appendVarint(body, type_);
+        appendVarint(body, parts_.size());
+        for(std::vector<std::string>::size_type p = 0; p < parts_.size(); p++) {
+           appendVarint(body, parts_[p].size());
+           body.append(parts_[p]);
+        }
+        if(body.size() > MAX_FRAME_SIZE) {
+           throw error("frame too large");
+        }
+        frame.clear();
+        frame.push_back(static_cast<char>((body.size() >> 24) & 0xFF));
+        frame.push_back(static_cast<char>((body.size() >> 16) & 0xFF));
+        frame.push_back(static_cast<char>((body.size() >>  8) & 0xFF));
+        frame.push_back(static_cast<char>( body.size()        & 0xFF));
+        frame.append(body);
+     }
+
+     template <typename Stream>
+     void send(Stream &s, std::string &scratch) const
+     {
+        build(scratch);
+        s.write(saga::buffer(scratch, scratch.size()));
+     }
+
+     template <typename Stream>
+     void send(Stream &s) const
+     {
+        buffer_pool::handle<std::string> scratch;
+        send(s, *scratch);
+     }
+
+   private:
+     msg_type type_;
+     std::vector<std::string> parts_;
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  receives whole frames.  The frame buffer comes from the shared
+  //  buffer pool (see buffer_pool.hpp): it grows to the largest frame
+  //  seen, is reused for every following message, and outlives the
+  //  receiver - the next conversation on this thread gets it back
+  //  already grown.  Parts are kept as offsets into that buffer and
+  //  copied out on access.
+  class receiver
+  {
+   public:
+     receiver() : type_(0) {}
+
+     //  reads the next frame; false when the peer closed cleanly
+     //  between messages
+     template <typename Stream>
+     bool recv(Stream &s)
+     {
+        char header[4];
+        if(!readFull(s, header, 4)) {
+           return false;
+        }
+        std::size_t size =
+           (static_cast<std::size_t>(static_cast<unsigned char>(header[0])) << 24) |
+           (static_cast<std::size_t>(static_cast<unsigned char>(header[1])) << 16) |
+           (static_cast<std::size_t>(static_cast<unsigned char>(header[2])) <<  8) |
+            static_cast<std::size_t>(static_cast<unsigned char>(header[3]));
+        if(size > MAX_FRAME_SIZE) {
+           throw error("frame too large");
+        }
+        if(buff_->size() < size) {
+           buff_->resize(size);
+        }
+        if(size > 0 && !readFull(s, &(*buff_)[0], size)) {
+           throw error("peer closed mid-frame");
+        }
+        parse_(size);
+        return true;
+     }
+
+     msg_type type(void) const { return type_; }
+
+     std::size_t parts(void) const { return parts_.size(); }
+
+     std::string part(std::size_t index = 0) const
+     {
+        if(index >= parts_.size()) {
+           throw error("no such message part");
+        }
+        return std::string(&(*buff_)[parts_[index].first], parts_[index].second);
+     }
+
+   private:
+     void parse_(std::size_t size)
+     {
+        parts_.clear();
+        std::size_t pos = 0;
+        unsigned long count;
+        if(!readVarint(&(*buff_)[0], size, pos, type_) ||
+           !readVarint(&(*buff_)[0], size, pos, count)) {
+           throw error("malformed frame header");
+        }
+        for(unsigned long p = 0; p < count; p++) {
+           unsigned long partSize;
+           //compare without adding: pos + partSize can wrap for a
+           //malformed partSize near the type's maximum, which would
+           //pass the check and blow up in part() instead of here.
+           //readVarint never moves pos past size, so the subtraction
+           //is safe
+           if(!readVarint(&(*buff_)[0], size, pos, partSize) ||
+              partSize > size - pos) {
+              throw error("malformed frame part");
+           }
+           parts_.push_back(std::make_pair(pos, static_cast<std::size_t>(partSize)));
+           pos += partSize;
+        }
+     }
+
+     buffer_pool::handle<std::vector<char> > buff_;
+     msg_type type_;
+     std::vector<std::pair<std::size_t, std::size_t> > parts_;
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  //  conveniences for the ubiquitous one-token and token+payload steps
+  template <typename Stream>
+  void send(Stream &s, msg_type type)
+  {
+     message(type).send(s);
+  }
+
+  template <typename Stream>
+  void send(Stream &s, msg_type type, const std::string &payload)
+  {
+     message(type).add(payload).send(s);
+  }
+
+  //  receives the next message and checks its type
+  template <typename Stream>
+  void expect(Stream &s, receiver &rx, msg_type type)
+  {
+     if(!rx.recv(s)) {
+        throw error("peer closed, expected message");
+     }
+     if(rx.type() != type) {
+        throw error("unexpected message type");
+     }
+  }
+}
+
+#endif // APPLICATIONS_COMMON_WIRE_HPP
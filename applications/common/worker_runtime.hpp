@@ -0,0 +1,294 @@
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef APPLICATIONS_COMMON_WORKER_RUNTIME_HPP
+#define APPLICATIONS_COMMON_WORKER_RUNTIME_HPP
+
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <saga/saga.hpp>
+
+#include "advert_bulk.hpp"
+#include "handle_cache.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+//  The shared worker runtime.
+//
+//  Every framework in this tree ships a worker with the same lifecycle:
+//  register under the session's advert directory, publish a set of system
+//  information attributes, keep a LAST_SEEN heartbeat alive, and poll the
+//  master for commands.  Each copy of that lifecycle has independently
+//  grown its own performance fixes (bulk attribute writes here, connect
+//  backoff there), and every new fix had to be applied once per
+//  framework.  This header collects the lifecycle into three small
+//  pieces, so a fix lands once:
+//
+//    registry         one registration transaction: session directory
+//                     (through the shared handle cache), worker
+//                     directory, attribute bulk, master endpoint lookup
+//    heartbeat        adaptive keepalive: cadence snaps to a minimum
+//                     while the worker is busy and backs off toward a
+//                     maximum while it idles
+//    stream_transport the master command channel over saga::stream,
+//                     connected with exponential backoff; frameworks
+//                     whose masters speak one conversation per
+//                     connection use fresh(), persistent protocols use
+//                     shared()
+//
+//  The conversation protocols themselves stay with the frameworks - they
+//  differ for good reasons - only the plumbing underneath is shared.  A
+//  transport polling an advert entry instead of a stream fits behind the
+//  same calls when a framework needs one.
+//
+//  The header is self-contained and depends on saga and the neighbouring
+//  common headers only.  It is included via a path relative to the
+//  applications/ directory.
+//
+namespace worker_runtime
+{
+  // advert layout shared by the frameworks: workers register under
+  // <session>/WORKERS/<uuid>/, the master's endpoint lives in the
+  // <session>/SERVER entry
+  const char * const workers_dir_name  = "WORKERS";
+  const char * const server_entry_name = "SERVER";
+  const char * const attr_last_seen    = "LAST_SEEN";
+
+  ///////////////////////////////////////////////////////////////////////////
+  //  One registration transaction with the orchestrator database.
+  //
+  class registry
+  {
+  private:
+
+    saga::advert::directory session_dir_;
+    saga::advert::directory worker_dir_;
+    saga::url               server_url_;
+
+  public:
+
+    registry()
+    {
+    }
+
+    // registers the worker: opens the session base directory (served
+    // from the process-wide handle cache), creates the worker's own
+    // directory, publishes the given attributes as one asynchronous
+    // bulk, and reads the master's endpoint entry.  Throws the
+    // underlying saga::exception on failure.
+    void connect(std::string const & database,
+                 std::string const & session_uuid,
+                 std::string const & worker_uuid,
+                 std::vector<std::pair<std::string, std::string> > const &
+                   attributes)
+    {
+      int mode = saga::advert::ReadWrite;
+
+      std::string base = database + "//" + session_uuid + "/";
+
+      session_dir_ =
+        handle_cache::cache::instance().open_dir(saga::url(base), mode);
+
+      worker_dir_ = saga::advert::directory(
+        saga::url(base + workers_dir_name + "/" + worker_uuid + "/"),
+        mode | saga::advert::Create);
+
+      if(!attributes.empty())
+      {
+        advert_bulk::set_attributes(worker_dir_, attributes);
+      }
+
+      saga::advert::entry server = handle_cache::cache::instance().open_entry(
+        session_dir_, server_entry_name, mode);
+
+      server_url_ = saga::url(server.retrieve_string());
+    }
+
+    // the session base directory - frameworks read their session-wide
+    // settings (tuning, benchmark mode, ...) off its attributes
+    saga::advert::directory & session_dir(void)
+    {
+      return session_dir_;
+    }
+
+    // this worker's own advert directory
+    saga::advert::directory & worker_dir(void)
+    {
+      return worker_dir_;
+    }
+
+    // creates (or opens) a framework-specific subdirectory of the
+    // worker directory
+    saga::advert::directory open_subdir(std::string const & name)
+    {
+      return worker_dir_.open_dir(saga::url(name),
+        saga::advert::ReadWrite | saga::advert::Create);
+    }
+
+    // the master's command endpoint, from the session's SERVER entry
+    saga::url const & server_url(void) const
+    {
+      return server_url_;
+    }
+  };
+
+  ///////////////////////////////////////////////////////////////////////////
+  //  Adaptive keepalive against the worker's advert directory.
+  //
+  //  beat() may be called as often as convenient - once per main loop
+  //  iteration, say - and publishes only when the current cadence says
+  //  so.  A busy worker beats every min_interval seconds; while idle the
+  //  interval doubles up to max_interval, so a fleet of parked workers
+  //  does not hammer the advert service with keepalives.
+  //
+  class heartbeat
+  {
+  private:
+
+    saga::advert::directory dir_;
+    bool                    bound_;
+    std::time_t             last_;
+    int                     interval_;
+    int                     min_interval_;
+    int                     max_interval_;
+
+  public:
+
+    heartbeat()
+      : bound_(false), last_(0), interval_(0),
+        min_interval_(5), max_interval_(60)
+    {
+    }
+
+    void bind(saga::advert::directory dir,
+              int min_interval = 5, int max_interval = 60)
+    {
+      dir_          = dir;
+      bound_        = true;
+      min_interval_ = min_interval;
+      max_interval_ = max_interval;
+      interval_     = min_interval;
+      last_         = 0;
+    }
+
+    // publishes LAST_SEEN plus any extra attributes (current load, ...)
+    // as one bulk, if a beat is due.  Returns whether it published.
+    bool beat(bool busy,
+              std::vector<std::pair<std::string, std::string> > const & extra
+                = std::vector<std::pair<std::string, std::string> >())
+    {
+      if(!bound_) return false;
+
+      std::time_t now = std::time(NULL);
+
+      if(busy) interval_ = min_interval_;
+
+      if(last_ != 0 && (now - last_) < interval_) return false;
+
+      std::vector<std::pair<std::string, std::string> > attributes(extra);
+      attributes.push_back(std::make_pair(std::string(attr_last_seen),
+        boost::lexical_cast<std::string>(now)));
+
+      advert_bulk::set_attributes(dir_, attributes);
+      last_ = now;
+
+      if(!busy)
+      {
+        interval_ *= 2;
+        if(interval_ > max_interval_) interval_ = max_interval_;
+      }
+
+      return true;
+    }
+  };
+
+  ///////////////////////////////////////////////////////////////////////////
+  //  The command channel to the master, over saga::stream.
+  //
+  //  Both connection styles retry with exponential backoff, so a slow
+  //  master start does not turn a worker fleet into a connect storm.
+  //
+  class stream_transport
+  {
+  private:
+
+    saga::url                                url_;
+    boost::shared_ptr<saga::stream::stream>  stream_;
+    int                                      max_attempts_;
+
+    boost::shared_ptr<saga::stream::stream> connect_(void)
+    {
+      int delay = 1;
+
+      for(int attempt = 0; ; attempt++)
+      {
+        try
+        {
+          boost::shared_ptr<saga::stream::stream> s(
+            new saga::stream::stream(url_));
+          s->connect();
+          return s;
+        }
+        catch(saga::exception const &)
+        {
+          if(attempt >= max_attempts_)
+          {
+            throw;
+          }
+          ::sleep(delay);
+          if(delay < 32) delay *= 2;
+        }
+      }
+    }
+
+  public:
+
+    stream_transport()
+      : max_attempts_(10)
+    {
+    }
+
+    void set_url(saga::url const & url)
+    {
+      url_ = url;
+    }
+
+    // the persistent connection, established on first use and after
+    // every reset(); for masters that keep one conversation stream per
+    // worker alive
+    saga::stream::stream & shared(void)
+    {
+      if(!stream_)
+      {
+        stream_ = connect_();
+      }
+      return *stream_;
+    }
+
+    bool connected(void) const
+    {
+      return stream_ ? true : false;
+    }
+
+    // drops the persistent connection; the next shared() reconnects
+    // with backoff
+    void reset(void)
+    {
+      stream_.reset();
+    }
+
+    // a new connection per call, for masters that expect one
+    // conversation per accepted connection
+    saga::stream::stream fresh(void)
+    {
+      return *connect_();
+    }
+  };
+}
+
+#endif // APPLICATIONS_COMMON_WORKER_RUNTIME_HPP
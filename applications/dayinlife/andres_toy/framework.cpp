@@ -8,6 +8,12 @@
 #define DEFAULT_APP_NAME    "DayInLife"
 #define ADVERT_DIR          "/workload/"
 
+// how many work iterations to run per instance before migrating on.  One
+// iteration per hop made the demo mostly migration overhead; a handful per
+// leg keeps the demo fast while still exercising migration every few
+// seconds.
+#define ITERATIONS_PER_LEG  5
+
 // fw ctor
 framework::framework (logger & log, int argc, char** argv)
   : log_ (log)
@@ -49,8 +55,26 @@ void framework::run (workload & w)
   w.set_input  (in_.get_string ());  // tell worker where to retr. data
   w.set_output (out_.get_string ()); // tell worker where to store data
 
-  // let worker do whatever it does
-  w.work ();
+  // let worker do whatever it does - several iterations per leg, with
+  // a checkpoint at every iteration boundary.  A migration (or a kill)
+  // can thus only ever lose the iteration in flight, never completed
+  // work.
+  int leg = 0;
+
+  while ( w.test () && leg < ITERATIONS_PER_LEG )
+  {
+    w.work       ();
+    w.checkpoint ();
+
+    leg++;
+  }
+
+  // if there was nothing to do at all, still recreate the on-disk state
+  // we had before running
+  if ( 0 == leg )
+  {
+    w.checkpoint ();
+  }
 
   // check if worker is done
   if ( w.test () )
@@ -0,0 +1,141 @@
+
+#include "kernel.hpp"
+
+#include <vector>
+
+// how much data each kernel streams over per iteration.  A megabyte of
+// doubles per array keeps one iteration in the millisecond range, which
+// is real work without slowing down the demo.
+#define KERNEL_SIZE (1024 * 1024)
+
+
+// --------------------------------------------------------------------
+// triad: the STREAM triad, a[i] = b[i] + s * c[i].  Three flat arrays,
+// one fused multiply-add per element, no branches - the compiler turns
+// this into vector code on any target that has it.
+class kernel_triad : public kernel
+{
+  private:
+    logger & log_;
+
+    std::vector <double> a_;
+    std::vector <double> b_;
+    std::vector <double> c_;
+
+  public:
+    kernel_triad (logger & log)
+      : log_ (log)
+      , a_   (KERNEL_SIZE, 0.0)
+      , b_   (KERNEL_SIZE, 1.0)
+      , c_   (KERNEL_SIZE, 2.0)
+    {
+      log_.log (" -- kernel triad ctor\n");
+    }
+
+    ~kernel_triad (void)
+    {
+      log_.log (" -- kernel triad dtor\n");
+    }
+
+    std::string name (void)
+    {
+      return "triad";
+    }
+
+    void iterate (long iter)
+    {
+      // scratch only: the scale factor depends on nothing but the
+      // iteration counter, so a restarted instance redoes the exact
+      // same iteration it lost
+      double s = 1.0 + (double) (iter % 7);
+
+      double * a = &a_[0];
+      double * b = &b_[0];
+      double * c = &c_[0];
+
+      for ( long i = 0; i < KERNEL_SIZE; i++ )
+      {
+        a[i] = b[i] + s * c[i];
+      }
+
+      // feed the result back so the loop is not dead code
+      b_.swap (a_);
+    }
+};
+
+
+// --------------------------------------------------------------------
+// dot: sum of a[i] * b[i], with four partial accumulators so the
+// floating point dependency chain does not serialize the loop.  The
+// checksum goes to the log - handy to eyeball that a migrated instance
+// really continued the same computation.
+class kernel_dot : public kernel
+{
+  private:
+    logger & log_;
+
+    std::vector <double> a_;
+    std::vector <double> b_;
+
+  public:
+    kernel_dot (logger & log)
+      : log_ (log)
+      , a_   (KERNEL_SIZE, 0.5)
+      , b_   (KERNEL_SIZE, 2.0)
+    {
+      log_.log (" -- kernel dot ctor\n");
+    }
+
+    ~kernel_dot (void)
+    {
+      log_.log (" -- kernel dot dtor\n");
+    }
+
+    std::string name (void)
+    {
+      return "dot";
+    }
+
+    void iterate (long iter)
+    {
+      double * a = &a_[0];
+      double * b = &b_[0];
+
+      double s0 = 0.0;
+      double s1 = 0.0;
+      double s2 = 0.0;
+      double s3 = 0.0;
+
+      for ( long i = 0; i < KERNEL_SIZE; i += 4 )
+      {
+        s0 += a[i    ] * b[i    ];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+      }
+
+      double sum = s0 + s1 + s2 + s3;
+
+      // perturb the inputs with the iteration counter, so every
+      // iteration has its own checksum
+      a[iter % KERNEL_SIZE] += 1.0;
+
+      log_.log (" -- kernel dot checksum: ");
+      log_.log (sum);
+      log_.log ("\n");
+    }
+};
+
+
+// --------------------------------------------------------------------
+// factory.  Unknown names fall back to triad - the demo should run, not
+// argue about spelling.
+kernel * kernel::create (const std::string & name, logger & log)
+{
+  if ( name == "dot" )
+  {
+    return new kernel_dot (log);
+  }
+
+  return new kernel_triad (log);
+}
@@ -0,0 +1,44 @@
+#ifndef KERNEL_HPP
+#define KERNEL_HPP
+
+#include "logger.hpp"
+
+#include <string>
+
+
+// a kernel is the pure compute inside one workload iteration.  The
+// contract matters more than the math:
+//
+//   - iterate() runs exactly one iteration, and one iteration is the
+//     checkpoint granularity of the whole demo: the framework only
+//     checkpoints (and only migrates) between two iterate() calls, so
+//     a migration can lose at most the iteration in flight;
+//
+//   - everything a kernel keeps between iterations is scratch - it is
+//     rebuilt from the iteration counter on startup, and never written
+//     to the checkpoint.  Durable state (the counter itself) lives in
+//     the workload.
+//
+// The sample kernels are written as plain indexed loops over flat
+// arrays, so the compiler can vectorize them - one iteration is a few
+// milliseconds of real memory-bound work instead of a counter bump,
+// which is what makes the migration demos representative and still
+// lets a full run finish in seconds.
+
+class kernel
+{
+  public:
+    // factory: returns the kernel registered under 'name' ("triad" or
+    // "dot"), or the triad kernel for anything unknown
+    static kernel * create (const std::string & name, logger & log);
+
+    virtual ~kernel (void) {}
+
+    virtual std::string name    (void)      = 0;
+
+    // run one full iteration; 'iter' seeds the data so consecutive
+    // iterations do distinguishable work
+    virtual void        iterate (long iter) = 0;
+};
+
+#endif // KERNEL_HPP
@@ -22,6 +22,21 @@ workload::workload (logger & log, int argc, char** argv)
     log_.log (max_);
     log_.log ("\n");
   }
+
+  // pick the compute kernel.  Kernel state is pure scratch (see
+  // kernel.hpp), so recreating it after a migration is fine.
+  std::string kernel_name = "triad";
+
+  if ( argc >= 4 )
+  {
+    kernel_name = argv[3];
+  }
+
+  kernel_ = kernel::create (kernel_name, log_);
+
+  log_.log (" -- wl kernel: ");
+  log_.log (kernel_->name ());
+  log_.log ("\n");
 }
 
 
@@ -29,6 +44,8 @@ workload::workload (logger & log, int argc, char** argv)
 workload::~workload (void)
 {
   log_.log (" -- wl dtor\n");
+
+  delete kernel_;
 }
 
 
@@ -62,7 +79,7 @@ void workload::set_input (std::string in)
   {
     // default: start from zero
     log_.log (" -- wl has no input - reset\n");
-    cnt_ = 0;   
+    cnt_ = 0;
   }
 
   return;
@@ -70,7 +87,8 @@ void workload::set_input (std::string in)
 
 
 // someone tells us where we are supposed to store output data.  We open that
-// file (to check if thats a valid location), and save the handle for later I/O
+// file (to check if thats a valid location), and save the name for the
+// checkpoint writes
 void workload::set_output (std::string out)
 {
   log_.log (" -- wl set_output: ");
@@ -78,13 +96,16 @@ void workload::set_output (std::string out)
   log_.log ("\n");
 
   // check if valid - throw if not
-  f_out_.open (out.c_str (), std::fstream::out);
+  std::fstream f (out.c_str (), std::fstream::out);
+
+  f_out_ = out;
 }
 
 
 
-// we perform one chunk of work.  When that is done, we store the intermediate
-// data in the earlier opened output file.
+// we perform one chunk of work: one kernel iteration, then bump the counter.
+// Note that work() does NOT write state anymore - that is checkpoint()'s job,
+// and the framework calls it right after us, at the iteration boundary.
 void workload::work (void)
 {
   log_.log (" -- wl work\n");
@@ -97,8 +118,11 @@ void workload::work (void)
     log_.log (cnt_);
     log_.log ("\n");
 
+    // the actual compute.  If we get killed in here, the checkpoint
+    // still holds cnt_, and a restart redoes just this iteration.
+    kernel_->iterate (cnt_);
+
     cnt_++;
-    // ::sleep (1);
 
     log_.log (" -- new count: ");
     log_.log (cnt_);
@@ -111,23 +135,32 @@ void workload::work (void)
     log_.log (cnt_);
     log_.log ("\n");
   }
+}
+
+
+
+// write the durable state (the counter) to the output file.  This is only
+// meaningful between work() calls - the state is inconsistent while a kernel
+// iteration is in flight, which is exactly why the framework owns the call.
+void workload::checkpoint (void)
+{
+  log_.log (" -- wl checkpoint: ");
+  log_.log (cnt_);
+  log_.log ("\n");
 
+  std::fstream f (f_out_.c_str (), std::fstream::out);
 
-  // write data
-  //
-  // we do that even if there is nothing to do, to recreate the state we had
-  // before running
-  f_out_ << "max: " << max_ << std::endl;
-  f_out_ << "cnt: " << cnt_ << std::endl;
+  f << "max: " << max_ << std::endl;
+  f << "cnt: " << cnt_ << std::endl;
 
-  f_out_.close ();
+  f.close ();
 }
 
 
 
 // this routine determines if work() managed to finish our _global_ task.  If
 // not, it returns true, indicating that we need to continue
-bool workload::test (void) 
+bool workload::test (void)
 {
   log_.log (" -- wl test:   ");
   log_.log (cnt_);
@@ -3,6 +3,7 @@
 #define WORKLOAD_HPP
 
 #include "logger.hpp"
+#include "kernel.hpp"
 
 #include <string>
 
@@ -15,23 +16,30 @@
 // this class represents the work to be performed.  work() has to be called
 // until test() returns true, indicating that all work is done.
 //
-// Our specific instance just increases the counter until it reaches the value
-// of the first command line argument.
+// Our specific instance runs one iteration of a compute kernel (see
+// kernel.hpp) per work() call, and counts iterations until the counter
+// reaches the value of the second command line argument.  After each
+// work() call the state is consistent, and checkpoint() can write it out
+// - that is the only point where migration is safe.
 //
-// the c'tor args assume two entries
-//   arg 1: string name - uniquely identifies this workload instance
-//   arg 2: int    max  - maximum number of iterations to perform
+// the c'tor args assume three entries
+//   arg 1: string name   - uniquely identifies this workload instance
+//   arg 2: int    max    - maximum number of iterations to perform
+//   arg 3: string kernel - compute kernel to run ("triad" or "dot",
+//                          optional, defaults to triad)
 
-class workload 
+class workload
 {
   private:
     logger & log_;
 
-    long cnt_;           // data to work on
-    long max_;           // break condition
+    long cnt_;             // data to work on
+    long max_;             // break condition
 
-    std::fstream f_in_;  // input  file
-    std::fstream f_out_; // output file
+    kernel    * kernel_;   // compute kernel, runs one iteration per work()
+
+    std::fstream f_in_;    // input  file
+    std::string  f_out_;   // output file name (written on checkpoint)
 
   public:
     workload (logger & log, int argc, char** argv);
@@ -40,8 +48,9 @@ class workload
     void set_input  (std::string in);   // register input  data file with worker
     void set_output (std::string out);  // register output data file with worker
 
-    void work (void);  // perform a piece of work 
-    bool test (void);  // check if there is more to be done
+    void work       (void);  // perform a piece of work
+    void checkpoint (void);  // write state out - only valid between work() calls
+    bool test       (void);  // check if there is more to be done
 };
 
 #endif // WORKLOAD_HPP
@@ -59,6 +59,10 @@ application::application(int argc, char *argv[], char const* name)
     this->base_type::set_input_filename(common::get_infile_name());
     this->base_type::set_output_filename(common::get_outfile_name());
 
+    // register our state with the incremental capture machinery
+    this->base_type::set_segment("counter",
+        boost::lexical_cast<std::string>(counter_));
+
     // the first two arguments are the next resource manager and the next 
     // host name; if there is a 3rd parameter it gives the number of times
     // this application should be instantiated
@@ -70,7 +74,16 @@ application::application(int argc, char *argv[], char const* name)
 // This is called after successful initialization of the application
 void application::read_data()
 {
-    // The base class provides us with a local copy of the data file as 
+    // prefer the incremental snapshot shipped by the previous instance; the
+    // full data file is only consulted if no captured state is available
+    if (this->base_type::restore_state())
+    {
+        counter_ = boost::lexical_cast<int>(
+            this->base_type::get_segment("counter"));
+        return;
+    }
+
+    // The base class provides us with a local copy of the data file as
     // written by the previous instance of this application
     saga::filesystem::file infile;
     if (this->base_type::begin_read_data(infile)) 
@@ -106,7 +119,15 @@ bool application::compute()
 // This is called just after the compute() function returned
 void application::write_data()
 {
-    // The base class provides us with a saga::filesystem::file object we can 
+    // ship only the changed state segments; the full data file below is
+    // refreshed on baseline captures only, so frequent migrations cost
+    // proportional to the change rate
+    this->base_type::set_segment("counter",
+        boost::lexical_cast<std::string>(counter_));
+    if (!this->base_type::capture_state())
+        return;
+
+    // The base class provides us with a saga::filesystem::file object we can
     // use to store our data in
     saga::filesystem::file outfile;
     if (this->base_type::begin_write_data(outfile)) 
@@ -8,8 +8,15 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <algorithm>
 
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/xtime.hpp>
+#include <boost/bind.hpp>
+
 #include <saga/saga.hpp>
 
 #include "common_helpers.hpp"
@@ -20,9 +27,16 @@ namespace migrating
     ///////////////////////////////////////////////////////////////////////////
     //  This class provides the basic functionality to:
     //    - register the running application (job) with the advert service
-    //    - register the current host with the advert service (overlaps with 
+    //    - register the current host with the advert service (overlaps with
     //      migration to next host
     //    - register the next host with the advert service
+    //    - capture application state incrementally: the derived class
+    //      registers named state segments, and on every capture only the
+    //      segments whose hash changed are shipped to the advert service
+    //      (with a periodic full baseline)
+    //    - pre-copy migration: a background thread streams the captured
+    //      segments while compute() keeps running, so migrate() only has
+    //      to stop-and-copy the final delta
     template <typename Derived> 
     class application
     {
@@ -30,8 +44,11 @@ namespace migrating
         
     public:
         application(int argc, char *argv[], char const* name) 
-          : name_(name), next_rm_(common::current_host()), 
-            next_host_(common::current_host())
+          : name_(name), next_rm_(common::current_host()),
+            next_host_(common::current_host()),
+            captures_(0), baseline_period_(10),
+            precopy_interval_(5), precopy_stop_(false),
+            precopy_thread_(NULL)
         {
         // if there are parameters on the command line we interpret these as the
         // next resource manager and next host name where we should migrate to
@@ -41,21 +58,23 @@ namespace migrating
                     next_host_ = argv[2];
             }
         }
-        ~application() {}
+        ~application() { stop_precopy(); }
 
     // do what has to be done :-P
         int run()
         {
             Derived& d = derived();
             bool finished = true;
-            
+
             if (d.startup()) {
                 d.read_data();                  // read input data
+                start_precopy();                // stream state while computing
                 finished = d.compute();         // do useful stuff
                 d.write_data();                 // write output data
                 if (!finished)
                     d.migrate();                // migrate if not finished
-            }                
+                stop_precopy();
+            }
             return d.terminate(finished);
         }
 
@@ -262,6 +281,120 @@ namespace migrating
             }
         }
 
+    // incremental state capture
+
+    // register a named state segment or update its contents; the segment
+    // becomes dirty only if its contents actually changed since the last
+    // capture
+        void set_segment(std::string const& name, std::string const& data)
+        {
+            boost::mutex::scoped_lock lock(segments_mtx_);
+            state_segment& seg = segments_[name];
+            unsigned long hash = hash_string(data);
+            if (0 == seg.captures || hash != seg.hash) {
+                seg.data = data;
+                seg.hash = hash;
+                seg.dirty = true;
+            }
+        }
+
+        std::string get_segment(std::string const& name)
+        {
+            boost::mutex::scoped_lock lock(segments_mtx_);
+            return segments_[name].data;
+        }
+
+    // how many captures between two full baselines (every Nth capture
+    // ships all segments, changed or not)
+        void set_baseline_period(unsigned int period)
+        {
+            if (period > 0)
+                baseline_period_ = period;
+        }
+
+    // ship the registered segments to the advert service. Only dirty
+    // segments are written, so frequent captures cost proportional to the
+    // change rate; every baseline_period_'th capture writes all segments.
+    // Returns true if this capture was a full baseline.
+        bool capture_state()
+        {
+            bool baseline;
+            {
+                boost::mutex::scoped_lock lock(segments_mtx_);
+                baseline = (0 == captures_++ % baseline_period_);
+            }
+            capture_segments(baseline);
+            return baseline;
+        }
+
+    // pre-copy: stream the captured state in the background while the
+    // application keeps computing. run() starts the streamer before
+    // compute() and migrate() stops it, so the stop-and-copy window
+    // covers only the delta since the streamer's last round.
+        void set_precopy_interval(unsigned int seconds)
+        {
+            if (seconds > 0)
+                precopy_interval_ = seconds;
+        }
+
+        void start_precopy()
+        {
+            {
+                boost::mutex::scoped_lock lock(segments_mtx_);
+                if (segments_.empty())
+                    return;     // nothing registered, nothing to stream
+            }
+            if (NULL != precopy_thread_)
+                return;
+            precopy_stop_ = false;
+            precopy_thread_ = new boost::thread(
+                boost::bind(&application::precopy_worker, this));
+        }
+
+        void stop_precopy()
+        {
+            if (NULL == precopy_thread_)
+                return;
+            {
+                boost::mutex::scoped_lock lock(precopy_mtx_);
+                precopy_stop_ = true;
+                precopy_cond_.notify_all();
+            }
+            precopy_thread_->join();
+            delete precopy_thread_;
+            precopy_thread_ = NULL;
+        }
+
+    // load all registered segments back from the advert service; returns
+    // false (leaving the segments untouched) if no capture is available,
+    // e.g. on the very first instance of the application
+        bool restore_state()
+        {
+            using namespace saga;
+            boost::mutex::scoped_lock lock(segments_mtx_);
+            try {
+                typename segment_map_type::iterator end = segments_.end();
+                for (typename segment_map_type::iterator it = segments_.begin();
+                     it != end; ++it)
+                {
+                    advert::entry adv (common::get_db_path(name_,
+                        "State_" + (*it).first));
+                    (*it).second.data = adv.retrieve_string();
+                    (*it).second.hash = hash_string((*it).second.data);
+                    (*it).second.dirty = false;
+                }
+            }
+            catch (saga::exception const& e) {
+                if (BadParameter != e.get_error() && DoesNotExist != e.get_error())
+                    throw;    // something more serious
+                return false; // no captured state, just restart
+            }
+
+            common::writelog(common::get_log_path(this->get_name()),
+                "application::restore_state");
+            return true;
+        }
+
     // This is called if the compute function returned true
         void migrate()
         {
@@ -272,9 +405,18 @@ namespace migrating
         {
             using namespace saga;
             try {
-                common::writelog(common::get_log_path(this->get_name()), 
+                common::writelog(common::get_log_path(this->get_name()),
                     "application::migrate");
 
+                // stop-and-copy: with the streamer halted, only the
+                // segments dirtied since its last round remain to ship,
+                // so the downtime window is the final delta, not the
+                // whole state
+                stop_precopy();
+                std::size_t delta = capture_segments(false);
+                common::writelog(common::get_log_path(this->get_name()),
+                    "application::migrate: final delta segments: ", delta);
+
                 // get our own job description
                 job::service js(common::current_rm(next_rm_));
                 job::job self (js.get_self());
@@ -338,6 +480,17 @@ namespace migrating
                 // remove our host name in the advert service as well
                     advert::entry advhost (common::get_db_path(name_, "Host"), mode);
                     advhost.remove();
+
+                // remove any captured state segments, nobody will restart
+                // from them anymore
+                    typename segment_map_type::iterator end = segments_.end();
+                    for (typename segment_map_type::iterator it = segments_.begin();
+                         it != end; ++it)
+                    {
+                        advert::entry advseg (common::get_db_path(name_,
+                            "State_" + (*it).first), mode);
+                        advseg.remove();
+                    }
                 }
             }
             catch (saga::exception const& e) {
@@ -365,11 +518,120 @@ namespace migrating
         }
 
     private:
+        //  one registered state segment: the current contents, the hash of
+        //  the last captured contents, and whether it needs to be shipped
+        struct state_segment
+        {
+            state_segment() : hash(0), dirty(false), captures(0) {}
+
+            std::string data;
+            unsigned long hash;
+            bool dirty;
+            unsigned int captures;
+        };
+        typedef std::map<std::string, state_segment> segment_map_type;
+
+        //  FNV-1a; cheap and good enough to detect a changed segment
+        static unsigned long hash_string(std::string const& data)
+        {
+            unsigned long hash = 2166136261UL;
+            for (std::string::size_type i = 0; i < data.size(); ++i) {
+                hash ^= (unsigned char)data[i];
+                hash *= 16777619UL;
+            }
+            return hash;
+        }
+
+        //  ship segments to the advert service (all of them on a
+        //  baseline, only the dirty ones otherwise). The contents are
+        //  snapshotted under the lock and written without it, so the
+        //  compute thread never blocks behind an advert write; a segment
+        //  is marked clean only if it did not change while in flight.
+        std::size_t capture_segments(bool baseline)
+        {
+            using namespace saga;
+            std::vector<std::string> names;
+            std::vector<std::string> datas;
+            std::vector<unsigned long> hashes;
+            {
+                boost::mutex::scoped_lock lock(segments_mtx_);
+                typename segment_map_type::iterator end = segments_.end();
+                for (typename segment_map_type::iterator it = segments_.begin();
+                     it != end; ++it)
+                {
+                    if (!baseline && !(*it).second.dirty)
+                        continue;
+                    names.push_back((*it).first);
+                    datas.push_back((*it).second.data);
+                    hashes.push_back((*it).second.hash);
+                }
+            }
+
+            std::size_t shipped = 0;
+            try {
+                int mode = advert::CreateParents | advert::ReadWrite;
+                for (std::size_t i = 0; i < names.size(); ++i)
+                {
+                    advert::entry adv (common::get_db_path(name_,
+                        "State_" + names[i]), mode);
+                    adv.store_string(datas[i]);
+                    ++shipped;
+
+                    boost::mutex::scoped_lock lock(segments_mtx_);
+                    state_segment& seg = segments_[names[i]];
+                    if (seg.hash == hashes[i])
+                        seg.dirty = false;
+                    ++seg.captures;
+                }
+
+                common::writelog(common::get_log_path(this->get_name()),
+                    baseline ? "application::capture_state: baseline: "
+                             : "application::capture_state: incremental: ",
+                    shipped);
+            }
+            catch (saga::exception const& e) {
+                common::writelog(common::get_log_path(this->get_name()),
+                    "application::capture_state: failed: ", e.what());
+            }
+            return shipped;
+        }
+
+        //  background streamer: ship dirty segments every
+        //  precopy_interval_ seconds until told to stop
+        void precopy_worker()
+        {
+            boost::mutex::scoped_lock lock(precopy_mtx_);
+            while (!precopy_stop_) {
+                boost::xtime xt;
+                boost::xtime_get(&xt, boost::TIME_UTC);
+                xt.sec += precopy_interval_;
+                precopy_cond_.timed_wait(lock, xt);
+                if (precopy_stop_)
+                    break;
+
+                lock.unlock();
+                capture_segments(false);
+                lock.lock();
+            }
+        }
+
         std::string name_;
         std::string next_rm_;
         std::string next_host_;
         std::string input_filename_;
         std::string output_filename_;
+
+        segment_map_type segments_;
+        boost::mutex segments_mtx_;
+        unsigned int captures_;
+        unsigned int baseline_period_;
+
+        //  pre-copy streamer state
+        unsigned int precopy_interval_;
+        volatile bool precopy_stop_;
+        boost::mutex precopy_mtx_;
+        boost::condition precopy_cond_;
+        boost::thread* precopy_thread_;
     };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -18,12 +18,14 @@
 #include "node.hpp"
 #include "edge.hpp"
 #include "checkpoint.hpp"
+#include "util/thread.hpp"
 #include "util/zfstream.h"
 
 namespace digedag 
 {
   checkpoint_mgr::checkpoint_mgr (void)
   : dagcomplete ( true )
+  , pending_ ( 0 )
   {
 	checkpoint_.compress = true;
 	checkpoint_.verbose  = true;
@@ -31,6 +33,7 @@ namespace digedag
 	checkpoint_.filename = "";
 	checkpoint_.method   = LocalFile;
 	checkpoint_.hashlog  = true;
+	checkpoint_.compact_every = 256;
 	//checkpoint_.rm_log_on_complete = false;
   }
 
@@ -112,6 +115,16 @@ namespace digedag
 	return checkpoint_.hashlog;
   }
 
+  void checkpoint_mgr::set_compact_interval (int n)
+  {
+	checkpoint_.compact_every = n;
+  }
+
+  int checkpoint_mgr::get_compact_interval (void)
+  {
+	return checkpoint_.compact_every;
+  }
+
   void checkpoint_mgr::set_method (checkpoint_method m)
   {
 	checkpoint_.method = m;
@@ -139,7 +152,7 @@ namespace digedag
         }
 
 	nodeset[nodepos] = 1;
-	dumptofile();
+	appendtolog('n', nodepos);
   }
 
   // hooks to scheduler::hook_edge_run_done
@@ -162,16 +175,79 @@ namespace digedag
 
 	// edgeset[edgepos] = 1;
 	edgeset[e->get_id()-1] = 1;
-	dumptofile();
+	appendtolog('e', e->get_id()-1);
   }
 
   // hooks to scheduler::hook_dag_run_post
   void checkpoint_mgr::dag_complete (void)
   {
 	remove(checkpoint_.filename.c_str());
+	remove(incfilename().c_str());
 	std::cout << "CR: DAG is complete, removing recover log." << std::endl;
   }
 
+  std::string checkpoint_mgr::incfilename (void)
+  {
+	return checkpoint_.filename + ".inc";
+  }
+
+  // incremental checkpointing: each completed node or edge appends one
+  // transition record ("n <pos>" / "e <pos>") to a plain append-only
+  // journal next to the snapshot file, so the per-commit checkpoint cost
+  // is one line of i/o instead of a full bitmap rewrite.  Every
+  // compact_every transitions the journal is folded into a fresh full
+  // snapshot and truncated.
+  void checkpoint_mgr::appendtolog (char type, unsigned int pos)
+  {
+	if (checkpoint_.method != LocalFile) {
+		// advert backend has no incremental path (yet) - fall back
+		// to the full dump
+		dumptofile();
+		return;
+	}
+
+	std::ofstream incjournal;
+	incjournal.open(incfilename().c_str(), std::ios::out | std::ios::app);
+
+	if (!incjournal.is_open()) {
+		std::cerr << "error opening incremental journal " << incfilename()
+			  << " for append - falling back to full dump" << std::endl;
+		dumptofile();
+		return;
+	}
+
+	incjournal << type << " " << pos << std::endl;
+	incjournal.close();
+
+	if (checkpoint_.verbose) {
+		std::cout << "CR: journaled transition: " << type << " " << pos << std::endl;
+	}
+
+	pending_++;
+
+	if (pending_ >= checkpoint_.compact_every)
+		compact();
+  }
+
+  // fold the incremental journal into a full snapshot: the in-memory
+  // bitsets already carry all journaled transitions, so a plain dump
+  // supersedes the log, which can then be truncated
+  void checkpoint_mgr::compact (void)
+  {
+	if (checkpoint_.verbose) {
+		std::cout << "CR: compacting journal after " << pending_
+			  << " transitions" << std::endl;
+	}
+
+	dumptofile();
+
+	std::ofstream incjournal;
+	incjournal.open(incfilename().c_str(), std::ios::out | std::ios::trunc);
+	incjournal.close();
+
+	pending_ = 0;
+  }
+
   void checkpoint_mgr::dump (std::map <node_id_t, node_map_t> dag_nodes,
                              std::map <edge_id_t, edge_map_t> dag_edges)
   {
@@ -345,6 +421,116 @@ namespace digedag
 	std::cout << "CR: dumptoadvert() method stub, not yet implemented" << std::endl;
     }
 
+    namespace
+    {
+      // one slice of the restore replay.  The records in the restored
+      // bitmaps are independent of each other - each one sets a single
+      // node or edge Done - so the replay is cut into contiguous slices
+      // handled by concurrent workers.  Edges replay before nodes (node
+      // state syncs against edge state), so each phase gets its own
+      // worker set, joined in between.
+      //
+      // The edge phase also verifies the staged data: a Done edge is
+      // only trusted if its target file survived the crash (see
+      // edge::verify_done).  Those opens go to the storage endpoints,
+      // and are the expensive part of a large restore - spreading them
+      // over the workers overlaps the per-endpoint latencies.
+      class restore_worker : public util::thread
+      {
+        public:
+          enum phase { Edges = 0, Nodes = 1 };
+
+          restore_worker (phase p, unsigned int lo, unsigned int hi,
+                          std::vector <boost::shared_ptr <edge> > & edges,
+                          std::vector <boost::shared_ptr <node> > & nodes,
+                          boost::dynamic_bitset <> & bitmap_edges,
+                          boost::dynamic_bitset <> & bitmap_nodes,
+                          bool verbose)
+            : phase_        (p)
+            , lo_           (lo)
+            , hi_           (hi)
+            , edges_        (edges)
+            , nodes_        (nodes)
+            , bitmap_edges_ (bitmap_edges)
+            , bitmap_nodes_ (bitmap_nodes)
+            , verbose_      (verbose)
+            , missing_      (0)
+            , incomplete_   (false)
+          {
+          }
+
+          void thread_work (void)
+          {
+            if ( phase_ == Edges )
+            {
+              for ( unsigned int i = lo_; i < hi_; i++ )
+              {
+                // prevent restoration failure, in case DAG has been altered
+                if ( i >= bitmap_edges_.size () || ! bitmap_edges_.test (i) )
+                  continue;
+
+                if ( edges_[i]->verify_done () )
+                {
+                  edges_[i]->set_state (Done);
+
+                  if ( verbose_ )
+                  {
+                    std::cout << "CHECKPOINT setting edgeset[" << i << "] = 1" <<
+                                 " ( " << edges_[i]->get_name () << " ) " << std::endl;
+                  }
+                }
+                else
+                {
+                  // target data gone - leave the edge Incomplete, so
+                  // the enactment re-stages it
+                  missing_++;
+                }
+              }
+            }
+            else
+            {
+              for ( unsigned int i = lo_; i < hi_; i++ )
+              {
+                if ( i < bitmap_nodes_.size () && bitmap_nodes_.test (i) )
+                {
+                  nodes_[i]->set_state (Done);
+
+                  if ( verbose_ )
+                  {
+                    std::cout << "CHECKPOINT restoring nodeset[" << i << "] = 1" <<
+                                 " ( " << nodes_[i]->get_name () << " ) " << std::endl;
+                  }
+                }
+
+                // sync node-internal edge-state against the restored edges
+                nodes_[i]->sync_state (verbose_);
+
+                if ( nodes_[i]->return_state () != Done )
+                  incomplete_ = true;
+              }
+            }
+          }
+
+          unsigned int missing    (void) const { return missing_;    }
+          bool         incomplete (void) const { return incomplete_; }
+
+        private:
+          phase                                     phase_;
+          unsigned int                              lo_;
+          unsigned int                              hi_;
+          std::vector <boost::shared_ptr <edge> > & edges_;
+          std::vector <boost::shared_ptr <node> > & nodes_;
+          boost::dynamic_bitset <>                & bitmap_edges_;
+          boost::dynamic_bitset <>                & bitmap_nodes_;
+          bool                                      verbose_;
+          unsigned int                              missing_;
+          bool                                      incomplete_;
+      };
+
+      // number of concurrent restore workers per phase
+      const unsigned int restore_workers = 4;
+    }
+
     void checkpoint_mgr::restorefromfile(std::map <node_id_t, node_map_t> &dag_nodes, std::map <edge_id_t, edge_map_t> &dag_edges)
     {
 	std::cout << "CHECKPOINT: entering restorefromfile()" << std::endl;
@@ -353,51 +539,92 @@ namespace digedag
 
 	std::cout << "CHECKPOINT: restorefromfile(): " << checkpoint_.filename << std::endl;
 
-	if (checkpoint_.compress) 
+	bool have_snapshot = true;
+
+	if (checkpoint_.compress)
         {
           gzifstream zjournal;
           zjournal.open(checkpoint_.filename.c_str(), std::ifstream::in);
 
-          if (zjournal.is_open()) 
+          if (zjournal.is_open())
           {
             getline(zjournal, nodeline);
             getline(zjournal, edgeline);
           }
-          else 
+          else
           {
-            std::cerr << "no checkpoint restore journal file found corresponding to the supplied DAG"
-                      << " ( " << get_filename() << " )" << std::endl;
-            return;
+            have_snapshot = false;
           }
 
           zjournal.close();
 	}
-	else if (!checkpoint_.compress) 
-        {	
+	else if (!checkpoint_.compress)
+        {
           std::ifstream journal;
           journal.open(checkpoint_.filename.c_str(), std::ifstream::in);
 
-          if (journal.is_open()) 
+          if (journal.is_open())
           {
             getline(journal, nodeline);
             getline(journal, edgeline);
             //std::cout << nodeline << std::endl << edgeline << std::endl;
           }
-          else 
+          else
           {
-            std::cerr << "no checkpoint restore journal file found corresponding to the supplied DAG"
-                      << " ( " << get_filename() << " )" << std::endl;
-            return;
+            have_snapshot = false;
           }
 
           journal.close();
 	}
 
+	std::ifstream incjournal(incfilename().c_str());
+
+	if (!have_snapshot && !incjournal.is_open())
+	{
+	  std::cerr << "no checkpoint restore journal file found corresponding to the supplied DAG"
+	            << " ( " << get_filename() << " )" << std::endl;
+	  return;
+	}
+
         std::cout << nodeline << std::endl << edgeline << std::endl;
 
 	boost::dynamic_bitset<> bitmap_nodes(nodeline);
 	boost::dynamic_bitset<> bitmap_edges(edgeline);
 
+	// a crash before the first compaction leaves us with the journal
+	// alone - replay it over empty, properly sized bitmaps then
+	if (bitmap_nodes.size() < nodeset.size())
+		bitmap_nodes.resize(nodeset.size());
+	if (bitmap_edges.size() < edgeset.size())
+		bitmap_edges.resize(edgeset.size());
+
+	// replay the incremental journal over the snapshot: each line is
+	// one node/edge completion recorded since the last compaction, so
+	// restore cost tracks the amount of change, not the graph size
+	if (incjournal.is_open())
+	{
+	  char         type;
+	  unsigned int pos;
+	  unsigned int replayed = 0;
+
+	  while (incjournal >> type >> pos)
+	  {
+	    if (type == 'n' && pos < bitmap_nodes.size()) {
+		bitmap_nodes[pos] = 1;
+		replayed++;
+	    }
+	    else if (type == 'e' && pos < bitmap_edges.size()) {
+		bitmap_edges[pos] = 1;
+		replayed++;
+	    }
+	  }
+
+	  incjournal.close();
+
+	  std::cout << "CHECKPOINT: replayed " << replayed
+	            << " journaled transition(s)" << std::endl;
+	}
+
 	nodeset = bitmap_nodes;
 	edgeset = bitmap_edges;
 
@@ -408,54 +635,83 @@ namespace digedag
 		    << "CHECKPOINT: bitmap_edges: " << bitmap_edges << std::endl;
 	}
 
-	// iterator for two bitsets, and set node/edge maps by ref
-        // fill bitmaps with node and edge statuses
+	// apply the restored bitmaps to the node/edge maps (passed by ref).
+	// The records are independent, so the replay runs on a small pool
+	// of concurrent workers (see restore_worker above): the edge phase
+	// verifies staged outputs against the storage endpoints in
+	// parallel, the node phase syncs node state once all edges are
+	// final.  Flattening the maps first gives the workers cheap
+	// contiguous slices.
 
-        // edges are restored before nodes, so that node state can be synced
-        // according to outgoing edge status
+	std::vector <boost::shared_ptr <edge> > edge_vec;
+	std::vector <boost::shared_ptr <node> > node_vec;
 
         std::map <edge_id_t, edge_map_t > :: iterator edge_it;
         std::map <edge_id_t, edge_map_t > :: iterator edge_begin = dag_edges.begin ();
         std::map <edge_id_t, edge_map_t > :: iterator edge_end   = dag_edges.end ();
 
-        unsigned int i = 0;
         for ( edge_it = edge_begin; edge_it != edge_end; edge_it++ ) {
-	   if ( i < bitmap_edges.size() ) { // prevent restoration failure, in case DAG has been altered
-           	if (bitmap_edges.test(i)) {
-                	edge_it->second->set_state(Done);
-                	if (checkpoint_.verbose) {
-                	std::cout << "CHECKPOINT setting edgeset[" << i << "] = 1" <<
-                             	     " ( " << edge_it->second->get_name() << " ) " << std::endl;
-                	}
-          	}
-          	i++;
-	  }
-        }
+		edge_vec.push_back(edge_it->second);
+	}
 
         std::map <node_id_t, boost::shared_ptr <node> > :: iterator node_it;
         std::map <node_id_t, boost::shared_ptr <node> > :: iterator node_begin = dag_nodes.begin ();
         std::map <node_id_t, boost::shared_ptr <node> > :: iterator node_end   = dag_nodes.end ();
 
-        i = 0;
         for ( node_it = node_begin; node_it != node_end; node_it++ ) {
-	   if ( i < bitmap_nodes.size() ) {
-	        if (bitmap_nodes.test(i)) {
-			node_it->second->set_state(Done);
-                	if (checkpoint_.verbose) {
-                		std::cout << "CHECKPOINT restoring nodeset[" << i << "] = 1" <<
-                             		     " ( " << node_it->second->get_name() << " ) " << std::endl;
-                	}
-           	}
-	   i++;
+		node_vec.push_back(node_it->second);
+	}
 
-	   // sync node-internal edge-state, and fire any unresolved outgoing edges
-	   node_it->second->sync_state(checkpoint_.verbose); 
-	   //node_it->second->get_state(); // update node-internal state, depending on edge-status
+	// phase 1: edges, restored before nodes so that node state can be
+	// synced according to outgoing edge status
+	unsigned int missing = 0;
 
-	   if (node_it->second->return_state() != Done)
-		dagcomplete = 0;
-	  }
-        }
+	{
+		std::vector <restore_worker *> workers;
+
+		for ( unsigned int w = 0; w < restore_workers; w++ ) {
+			unsigned int lo = (w    ) * edge_vec.size() / restore_workers;
+			unsigned int hi = (w + 1) * edge_vec.size() / restore_workers;
+
+			workers.push_back(new restore_worker(restore_worker::Edges,
+				lo, hi, edge_vec, node_vec,
+				bitmap_edges, bitmap_nodes, checkpoint_.verbose));
+			workers.back()->thread_run();
+		}
+
+		for ( unsigned int w = 0; w < workers.size(); w++ ) {
+			workers[w]->thread_wait();
+			missing += workers[w]->missing();
+			delete workers[w];
+		}
+	}
+
+	if (missing) {
+		std::cout << "CHECKPOINT: " << missing << " staged output(s) missing"
+			  << " - those edges (and their dependent nodes) re-run" << std::endl;
+	}
+
+	// phase 2: nodes
+	{
+		std::vector <restore_worker *> workers;
+
+		for ( unsigned int w = 0; w < restore_workers; w++ ) {
+			unsigned int lo = (w    ) * node_vec.size() / restore_workers;
+			unsigned int hi = (w + 1) * node_vec.size() / restore_workers;
+
+			workers.push_back(new restore_worker(restore_worker::Nodes,
+				lo, hi, edge_vec, node_vec,
+				bitmap_edges, bitmap_nodes, checkpoint_.verbose));
+			workers.back()->thread_run();
+		}
+
+		for ( unsigned int w = 0; w < workers.size(); w++ ) {
+			workers[w]->thread_wait();
+			if (workers[w]->incomplete())
+				dagcomplete = 0;
+			delete workers[w];
+		}
+	}
 
 	   if (dagcomplete) {
 		std::cout << "CHECKPOINT: DAG is complete, exiting." << std::endl
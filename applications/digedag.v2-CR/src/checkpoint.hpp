@@ -23,18 +23,23 @@
 
 namespace digedag
 {
-  class checkpoint_mgr 
+  class checkpoint_mgr
   {
     private:
       boost::dynamic_bitset<> nodeset;
       boost::dynamic_bitset<> edgeset;
       bool                dagcomplete;
 
+      // number of transitions appended to the incremental journal since
+      // the last full snapshot (see appendtolog/compact)
+      int                 pending_;
+
       struct checkpoint_conf_t
       {
         bool             compress;
         bool             verbose;
         bool		 hashlog;
+        int		 compact_every; // transitions between compactions
         checkpoint_method method;
         std::string      filename;
         std::string	 filepath;
@@ -42,6 +47,9 @@ namespace digedag
 
       void dumptofile        (void);
       void dumptoadvert      (void);
+      void appendtolog       (char type, unsigned int pos);
+      void compact           (void);
+      std::string incfilename (void);
       void restorefromfile   (std::map <node_id_t, node_map_t> &dag_nodes, std::map <edge_id_t, edge_map_t> &dag_edges);
       void restorefromadvert (void);
 
@@ -59,6 +67,8 @@ namespace digedag
       bool get_compress            (void);
       void set_hashlog             (bool flag);
       bool get_hashlog             (void);
+      void set_compact_interval    (int n);
+      int  get_compact_interval    (void);
       void set_method              (checkpoint_method m);
       checkpoint_method get_method (void);
 
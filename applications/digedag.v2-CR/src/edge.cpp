@@ -218,6 +218,35 @@ namespace digedag
   }
 
 
+  // verify_done() checks, on checkpoint restore, whether the staged
+  // target data of an edge recorded as Done actually still exists - a
+  // crash may have taken scratch space with it, and then the edge (and
+  // its dependent nodes) must re-run instead of being restored as Done.
+  bool edge::verify_done (void)
+  {
+    if ( is_void_ )
+      return true;
+
+    if ( tgt_url_.get_string ().empty () )
+      return true;
+
+    try
+    {
+      saga::filesystem::file f_tgt (session_, tgt_url_);
+      f_tgt.get_size ();
+    }
+    catch ( const saga::exception & e )
+    {
+      std::cout << " === edge " << get_name ()
+                << " : restore target missing (" << tgt_url_ << ")"
+                << std::endl;
+      return false;
+    }
+
+    return true;
+  }
+
+
   void edge::work_done (void)
   {
     // std::cout << " === edge done?" << std::endl;
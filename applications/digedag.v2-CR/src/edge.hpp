@@ -75,6 +75,7 @@ namespace digedag
       void                     erase_tgt     (void);
       void                     add_src_node  (boost::shared_ptr <node> src);
       void                     add_tgt_node  (boost::shared_ptr <node> tgt);
+      bool                     verify_done   (void);
       void                     set_state     (state s);
       state                    get_state     (void);
       std::string              get_name      (void) const;
@@ -0,0 +1,218 @@
+
+#include "dag.hpp"
+#include "node.hpp"
+#include "edge.hpp"
+#include "batcher.hpp"
+#include "scheduler.hpp"
+#include "util/util.hpp"
+
+namespace digedag
+{
+  batcher::batcher (boost::shared_ptr <scheduler> s,
+                    saga::session                 session,
+                    int                           size,
+                    int                           wait_ms)
+    : s_       (s)
+    , session_ (session)
+    , size_    (size)
+    , wait_ms_ (wait_ms)
+    , todo_    (true)
+  {
+    thread_run ();
+  }
+
+
+  batcher::~batcher (void)
+  {
+    {
+      util::scoped_lock l (mtx_);
+      todo_ = false;
+      cond_.notify_all ();
+    }
+    thread_join ();
+  }
+
+
+  // take ownership of a ready node, adding it to the growing batch for
+  // its resource.  Full batches are submitted right away; partial ones
+  // are left to age in thread_work.
+  bool batcher::accept (boost::shared_ptr <node> n)
+  {
+    if ( size_ <= 1 )
+    {
+      return false;
+    }
+
+    if ( n->is_void () )
+    {
+      // void nodes complete instantly - nothing to amortize
+      return false;
+    }
+
+    batch_t full;
+
+    {
+      util::scoped_lock l (mtx_);
+
+      // nodes on the same submission endpoint and host share a batch
+      std::string key = n->get_rm () + "|" + n->get_host ();
+
+      batch_t & b = open_[key];
+
+      if ( b.members.empty () )
+      {
+        // freshly created batch - start its age
+        b.rm     = n->get_rm ();
+        b.age_ms = 0;
+      }
+
+      b.members.push_back (n);
+
+      if ( (int) b.members.size () >= size_ )
+      {
+        full = b;
+        open_.erase (key);
+      }
+    }
+
+    if ( full.members.size () )
+    {
+      // submission can take seconds - run it outside the lock
+      submit_ (full);
+    }
+
+    return true;
+  }
+
+
+  // submit one wrapper job which runs all member commands sequentially.
+  // The commands are chained with '&&', so a failing member fails the
+  // whole wrapper - and thereby all its members, which matches the
+  // one-job-fails-all-fail semantics of the unbatched path.
+  void batcher::submit_ (batch_t & b)
+  {
+    std::string cmd;
+
+    for ( unsigned int i = 0; i < b.members.size (); i++ )
+    {
+      if ( i ) cmd += " && ";
+
+      cmd += b.members[i]->get_cmd ();
+    }
+
+    std::cout << " === batcher submits " << b.members.size ()
+              << " node(s) to '" << b.rm << "'" << std::endl;
+
+    try
+    {
+      saga::job::description jd;
+
+      std::vector <std::string> args;
+      args.push_back ("-c");
+      args.push_back (cmd);
+
+      jd.set_attribute        (saga::job::attributes::description_executable, "/bin/sh");
+      jd.set_vector_attribute (saga::job::attributes::description_arguments,  args);
+
+      saga::job::service js (session_, b.rm);
+      saga::job::job     j  = js.create_job (jd);
+
+      j.run ();
+
+      for ( unsigned int i = 0; i < b.members.size (); i++ )
+      {
+        b.members[i]->work_start_batched (j);
+      }
+
+      flight_t f;
+      f.task    = j;
+      f.members = b.members;
+
+      util::scoped_lock l (mtx_);
+      flight_.push_back (f);
+    }
+    catch ( const saga::exception & e )
+    {
+      std::cout << " === batch submission to '" << b.rm << "' failed: \n"
+                << e.what () << std::endl;
+
+      s_->batch_finished (b.members, false);
+    }
+  }
+
+
+  // age the open batches, flush the overdue ones, and watch the wrapper
+  // jobs in flight.  Completed wrappers report all their members to the
+  // scheduler at once.
+  void batcher::thread_work (void)
+  {
+    while ( true )
+    {
+      std::vector <batch_t>  overdue;
+      std::vector <flight_t> finals;
+      bool                   failed = false;
+
+      {
+        util::scoped_lock l (mtx_);
+
+        if ( ! todo_ )
+        {
+          return;
+        }
+
+        util::timed_wait_ms (cond_, l, 100);
+
+        // age open batches, and collect those which waited long enough
+        std::map <std::string, batch_t> :: iterator it = open_.begin ();
+
+        while ( it != open_.end () )
+        {
+          it->second.age_ms += 100;
+
+          if ( (int) it->second.age_ms >= wait_ms_ )
+          {
+            overdue.push_back (it->second);
+            open_.erase (it++);
+          }
+          else
+          {
+            it++;
+          }
+        }
+
+        // collect wrapper jobs which reached a final state
+        for ( unsigned int i = 0; i < flight_.size (); i++ )
+        {
+          saga::task::state s = flight_[i].task.get_state ();
+
+          if ( s == saga::task::Done   ||
+               s == saga::task::Failed )
+          {
+            finals.push_back (flight_[i]);
+            flight_.erase (flight_.begin () + i);
+            i--;
+          }
+        }
+      }
+
+      for ( unsigned int i = 0; i < overdue.size (); i++ )
+      {
+        submit_ (overdue[i]);
+      }
+
+      for ( unsigned int i = 0; i < finals.size (); i++ )
+      {
+        failed = (finals[i].task.get_state () != saga::task::Done);
+
+        std::cout << " === batch of " << finals[i].members.size ()
+                  << " node(s) is final: "
+                  << (failed ? "Failed" : "Done")
+                  << std::endl;
+
+        s_->batch_finished (finals[i].members, ! failed);
+      }
+    }
+  }
+
+} // namespace digedag
+
@@ -0,0 +1,84 @@
+
+#ifndef DIGEDAG_BATCHER_HPP
+#define DIGEDAG_BATCHER_HPP
+
+#include <map>
+#include <vector>
+#include <string>
+
+#include <saga/saga.hpp>
+
+#include "util/mutex.hpp"
+#include "util/thread.hpp"
+#include "util/scoped_lock.hpp"
+#include "util/condition.hpp"
+
+
+namespace digedag
+{
+  // the batcher groups ready nodes which target the same resource into
+  // a single clustered submission: one wrapper job runs the commands of
+  // all batch members sequentially, so the per-job submission overhead
+  // of the middleware is paid once per batch instead of once per node.
+  //
+  // A batch is flushed when it reaches 'size' members, or when
+  // 'wait_ms' milliseconds passed since its first member arrived -
+  // whatever comes first.  Both knobs come from the scheduler's policy
+  // file ('batch size <n>', 'batch wait <ms>'); a size of 1 disables
+  // batching altogether.
+  //
+  // Wrapper jobs are watched by the batcher thread; on completion, all
+  // batch members are reported back to the scheduler at once.
+  class node;
+  class scheduler;
+  class batcher : public digedag::util::thread
+  {
+    private:
+      struct batch_t
+      {
+        std::string                             rm;       // submission endpoint
+        std::vector <boost::shared_ptr <node> > members;
+        unsigned int                            age_ms;   // since first member
+      };
+
+      struct flight_t
+      {
+        saga::task                              task;     // the wrapper job
+        std::vector <boost::shared_ptr <node> > members;
+      };
+
+      boost::shared_ptr <scheduler>   s_;
+      saga::session                   session_;
+      int                             size_;
+      int                             wait_ms_;
+      bool                            todo_;
+
+      std::map <std::string, batch_t> open_;    // growing batches, by resource
+      std::vector <flight_t>          flight_;  // submitted wrapper jobs
+
+      util::mutex                     mtx_;
+      util::condition                 cond_;
+
+      void submit_ (batch_t & b);
+
+    public:
+      batcher (boost::shared_ptr <scheduler> s,
+               saga::session                 session,
+               int                           size,
+               int                           wait_ms);
+
+      ~batcher (void);
+
+      // take ownership of a ready node.  Returns false when the node
+      // is not batchable (void node, or batching disabled) - the
+      // caller then submits it directly, as before.
+      bool accept (boost::shared_ptr <node> n);
+
+      void thread_work (void);
+  };
+
+} // namespace digedag
+
+
+#endif // DIGEDAG_BATCHER_HPP
+
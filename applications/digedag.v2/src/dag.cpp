@@ -12,6 +12,7 @@ namespace digedag
     , input_     (new node (scheduler_, session_))
     , output_    (new node (scheduler_, session_))
     , edge_cnt_  (0)
+    , adj_valid_ (false)
   { 
     // add special nodes to dag already
     add_node ("INPUT",  input_);
@@ -38,27 +39,15 @@ namespace digedag
     scheduler_->stop ();
 
     // stop nodes
+    for ( unsigned int i = 0; i < node_list_.size (); i++ )
     {
-      std::map <node_id_t, boost::shared_ptr <node> > :: iterator it;
-      std::map <node_id_t, boost::shared_ptr <node> > :: iterator begin = nodes_.begin ();
-      std::map <node_id_t, boost::shared_ptr <node> > :: iterator end   = nodes_.end ();
-
-      for ( it = begin; it != end; it++ )
-      {
-        it->second->stop ();
-      }
+      node_list_[i]->stop ();
     }
 
     // stop edges
+    for ( unsigned int i = 0; i < edge_list_.size (); i++ )
     {
-      std::map <edge_id_t, edge_map_t> :: iterator it;
-      std::map <edge_id_t, edge_map_t> :: iterator begin = edges_.begin ();
-      std::map <edge_id_t, edge_map_t> :: iterator end   = edges_.end ();
-
-      for ( it = begin; it != end; it++ )
-      {
-        it->second->stop ();
-      }
+      edge_list_[i]->stop ();
     }
     
 
@@ -124,7 +113,28 @@ namespace digedag
       return;
     }
 
-    nodes_[name] = node;
+    {
+      // graph growth takes the exclusive side of the graph lock, and
+      // releases it before the scheduler hook runs - the hook may well
+      // want to traverse via a dag_view.
+      util::unique_scoped_lock gl (graph_mtx_);
+
+      // intern the node name: known names keep their index, new ones get
+      // appended to the contiguous node list
+      std::map <node_id_t, int> :: iterator it = node_idx_.find (name);
+
+      if ( it != node_idx_.end () )
+      {
+        node_list_[it->second] = node;
+      }
+      else
+      {
+        node_idx_[name] = (int) node_list_.size ();
+        node_list_.push_back (node);
+      }
+
+      adj_valid_ = false;
+    }
 
     node->set_name (name);
 
@@ -144,24 +154,16 @@ namespace digedag
   {
     util::scoped_lock (mtx_);
 
-    boost::shared_ptr <node> n_src;
-    boost::shared_ptr <node> n_tgt;
+    boost::shared_ptr <node> n_src = get_node (src);
+    boost::shared_ptr <node> n_tgt = get_node (tgt);
 
-    if ( nodes_.find (src) != nodes_.end () )
-    {
-      n_src = nodes_[src];
-    }
-    else
+    if ( ! n_src )
     {
       std::cout << " !!! add_edge: could not find src node with id " << src << std::endl; 
       return;
     }
 
-    if ( nodes_.find (tgt) != nodes_.end () )
-    {
-      n_tgt = nodes_[tgt];
-    }
-    else
+    if ( ! n_tgt )
     {
       std::cout << " !!! add_edge: could not find tgt node with id " << tgt << std::endl; 
       return;
@@ -192,8 +194,14 @@ namespace digedag
     src->add_edge_out (e);
     tgt->add_edge_in  (e);
 
-    // register new edge
-    edges_[e->get_id ()] = e;
+    {
+      // register new edge - exclusive side, see add_node
+      util::unique_scoped_lock gl (graph_mtx_);
+
+      edge_list_.push_back (e);
+
+      adj_valid_ = false;
+    }
 
     // ### scheduler hook
     scheduler_->hook_edge_add (e);
@@ -204,15 +212,11 @@ namespace digedag
   {
     util::scoped_lock (mtx_);
 
-    std::map <node_id_t, boost::shared_ptr <node> > :: iterator it;
-    std::map <node_id_t, boost::shared_ptr <node> > :: iterator begin = nodes_.begin ();
-    std::map <node_id_t, boost::shared_ptr <node> > :: iterator end   = nodes_.end ();
-
     state_ = Pending;
 
-    for ( it = begin; it != end; it++ )
+    for ( unsigned int i = 0; i < node_list_.size (); i++ )
     {
-      it->second->reset ();
+      node_list_[i]->reset ();
     }
   }
 
@@ -225,20 +229,39 @@ namespace digedag
 
     std::cout << " dryun:  dag" << std::endl;
 
-    std::map <node_id_t, boost::shared_ptr <node> > :: iterator it;
-    std::map <node_id_t, boost::shared_ptr <node> > :: iterator begin = nodes_.begin ();
-    std::map <node_id_t, boost::shared_ptr <node> > :: iterator end   = nodes_.end ();
-
-    for ( it = begin; it != end; it++ )
+    for ( unsigned int i = 0; i < node_list_.size (); i++ )
     {
-      if ( it->second->get_state () == Pending )
+      if ( node_list_[i]->get_state () == Pending )
       {
-        it->second->dryrun ();
+        node_list_[i]->dryrun ();
       }
     }
   }
 
 
+  // simulator mode: predict the makespan of this dag under the current
+  // scheduler policy, without any real saga calls.  Unlike dryrun, which
+  // walks the nodes one by one, this replays the full dependency
+  // propagation with modeled durations - useful to evaluate policy files
+  // and concurrency limits before committing to a long enactment.
+  double dag::simulate (void)
+  {
+    util::scoped_lock (mtx_);
+
+    std::cout << " simulate:  dag" << std::endl;
+
+    return scheduler_->simulate ();
+  }
+
+
+  scheduler_stats dag::get_stats (void)
+  {
+    util::scoped_lock (mtx_);
+
+    return scheduler_->get_stats ();
+  }
+
+
   void dag::fire (void)
   {
     util::scoped_lock (mtx_);
@@ -275,17 +298,13 @@ namespace digedag
     // that node, etc.
     //
     // if no nodes can be fired, complain.  Graph may be cyclic.
-    std::map <node_id_t, boost::shared_ptr <node> > :: iterator it;
-    std::map <node_id_t, boost::shared_ptr <node> > :: iterator begin = nodes_.begin ();
-    std::map <node_id_t, boost::shared_ptr <node> > :: iterator end   = nodes_.end ();
-
-    for ( it = begin; it != end; it++ )
+    for ( unsigned int i = 0; i < node_list_.size (); i++ )
     {
-      if ( Pending == it->second->get_state () )
+      if ( Pending == node_list_[i]->get_state () )
       {
         std::cout << std::string (" ===   dag fires node w/o incomplete edges: ") 
-                  << it->second->get_id () << std::endl;
-        it->second->fire ();
+                  << node_list_[i]->get_id () << std::endl;
+        node_list_[i]->fire ();
         state_ = Running;
       }
     }
@@ -355,22 +374,11 @@ namespace digedag
 
     {
       // count node states
-      std::map <node_id_t, boost::shared_ptr <node> > :: const_iterator it;
-      std::map <node_id_t, boost::shared_ptr <node> > :: const_iterator begin = nodes_.begin ();
-      std::map <node_id_t, boost::shared_ptr <node> > :: const_iterator end   = nodes_.end ();
-
-      int i = 0;
-      for ( it = begin; it != end; it++ )
+      for ( unsigned int i = 0; i < node_list_.size (); i++ )
       {
-        if ( ! (i++ % 5) )
-        {
- //       std::cout << std::endl;
-        }
-
         state_total++;
 
-        state s = it->second->get_state ();
- //     std::cout << it->first << ":" << state_to_string (s) <<  "\t";
+        state s = node_list_[i]->get_state ();
 
         switch ( s )
         {
@@ -399,23 +407,11 @@ namespace digedag
 
     {
       // count edge states
-      std::map <edge_id_t, edge_map_t> :: const_iterator it;
-      std::map <edge_id_t, edge_map_t> :: const_iterator begin = edges_.begin ();
-      std::map <edge_id_t, edge_map_t> :: const_iterator end   = edges_.end ();
-
-      int cnt = 0;
-      for ( it = begin; it != end; it++ )
+      for ( unsigned int i = 0; i < edge_list_.size (); i++ )
       {
-        if ( ! (cnt++ % 2) )
-        {
-          // std::cout << std::endl;
-        }
-
         state_total++;
 
-        state s = it->second->get_state ();
-        // std::cout << it->second[i]->get_name () 
-        //           << ":" << state_to_string (s) <<  "\t", false << std::endl;
+        state s = edge_list_[i]->get_state ();
 
         switch ( s )
         {
@@ -500,26 +496,18 @@ namespace digedag
 
     std::cout << " -  NODES  ----------------------------------\n" << std::endl;
     {
-      std::map <node_id_t, boost::shared_ptr <node> > :: const_iterator it;
-      std::map <node_id_t, boost::shared_ptr <node> > :: const_iterator begin = nodes_.begin ();
-      std::map <node_id_t, boost::shared_ptr <node> > :: const_iterator end   = nodes_.end ();
-
-      for ( it = begin; it != end; it++ )
+      for ( unsigned int i = 0; i < node_list_.size (); i++ )
       {
-        it->second->dump ();
+        node_list_[i]->dump ();
       }
     }
     std::cout << " -  NODES  ----------------------------------\n" << std::endl;
 
     std::cout << " -  EDGES  ----------------------------------\n" << std::endl;
     {
-      std::map <edge_id_t, edge_map_t> :: const_iterator it;
-      std::map <edge_id_t, edge_map_t> :: const_iterator begin = edges_.begin ();
-      std::map <edge_id_t, edge_map_t> :: const_iterator end   = edges_.end ();
-
-      for ( it = begin; it != end; it++ )
+      for ( unsigned int i = 0; i < edge_list_.size (); i++ )
       {
-        it->second->dump ();
+        edge_list_[i]->dump ();
       }
     }
     std::cout << " -  DAG    ----------------------------------\n" << std::endl;
@@ -530,13 +518,124 @@ namespace digedag
   {
     util::scoped_lock (mtx_);
 
-    if ( nodes_.find (name) != nodes_.end () )
+    boost::shared_ptr <node> n = get_node (name);
+
+    if ( n )
     {
-      nodes_[name]->dump ();
+      n->dump ();
     }
   }
 
 
+  // resolve an interned node name to its instance, or to an empty
+  // pointer for unknown names
+  boost::shared_ptr <node> dag::get_node (const node_id_t & name)
+  {
+    util::scoped_lock (mtx_);
+
+    boost::shared_ptr <node> n;
+
+    std::map <node_id_t, int> :: const_iterator it = node_idx_.find (name);
+
+    if ( it != node_idx_.end () )
+    {
+      n = node_list_[it->second];
+    }
+
+    return n;
+  }
+
+
+  // resolve an interned node name to its integer id (-1 for unknown names)
+  int dag::node_index (const node_id_t & name)
+  {
+    util::scoped_lock (mtx_);
+
+    std::map <node_id_t, int> :: const_iterator it = node_idx_.find (name);
+
+    if ( it != node_idx_.end () )
+    {
+      return it->second;
+    }
+
+    return -1;
+  }
+
+
+  // build the CSR adjacency arrays from the edge list.  Both arrays are
+  // rebuilt in two passes (count, then fill), so the edge indices of
+  // node i end up contiguous in adj_edges_.
+  void dag::build_adjacency_ (void)
+  {
+    if ( adj_valid_ )
+    {
+      return;
+    }
+
+    adj_offsets_.assign (node_list_.size () + 1, 0);
+    adj_edges_.assign   (edge_list_.size (),     0);
+
+    // pass one: count outgoing edges per node
+    for ( unsigned int i = 0; i < edge_list_.size (); i++ )
+    {
+      int src = node_index (edge_list_[i]->get_src_node ()->get_id ());
+
+      if ( src >= 0 )
+      {
+        adj_offsets_[src + 1]++;
+      }
+    }
+
+    // prefix sum over the counts
+    for ( unsigned int i = 1; i < adj_offsets_.size (); i++ )
+    {
+      adj_offsets_[i] += adj_offsets_[i - 1];
+    }
+
+    // pass two: fill in the edge indices
+    std::vector <int> cursor (adj_offsets_.begin (), adj_offsets_.end () - 1);
+
+    for ( unsigned int i = 0; i < edge_list_.size (); i++ )
+    {
+      int src = node_index (edge_list_[i]->get_src_node ()->get_id ());
+
+      if ( src >= 0 )
+      {
+        adj_edges_[cursor[src]++] = (int) i;
+      }
+    }
+
+    adj_valid_ = true;
+  }
+
+
+  // bring the CSR adjacency up to date.  The rebuild mutates the graph
+  // structure, so it takes the exclusive side of the graph lock - a
+  // dag_view calls this before it enters its shared section.
+  void dag::ensure_adjacency_ (void)
+  {
+    util::unique_scoped_lock gl (graph_mtx_);
+
+    build_adjacency_ ();
+  }
+
+
+  const std::vector <int> & dag::adjacency_offsets (void)
+  {
+    ensure_adjacency_ ();
+
+    return adj_offsets_;
+  }
+
+
+  const std::vector <int> & dag::adjacency_edges (void)
+  {
+    ensure_adjacency_ ();
+
+    return adj_edges_;
+  }
+
+
   void dag::schedule (void)
   {
     util::scoped_lock (mtx_);
@@ -3,9 +3,11 @@
 #define DIGEDAG_DAG_HPP
 
 #include <map>
+#include <vector>
 
 #include "util/mutex.hpp"
 #include "util/scoped_lock.hpp"
+#include "util/shared_mutex.hpp"
 #include "util/thread.hpp"
 
 #include "config.hpp"
@@ -13,6 +15,7 @@
 #include "node.hpp"
 #include "edge.hpp"
 #include "node_description.hpp"
+#include "stats.hpp"
 
 
 namespace digedag
@@ -29,13 +32,36 @@ namespace digedag
   // attributes of edges and nodes, such as its assigment to a specific
   // resource.
   class scheduler;
+  class dag_view;
   class dag : public util::enable_shared_from_this <dag>
   {
     private:
       saga::session                    session_;   // saga session to be used everywhere 
 
-      std::map <node_id_t, node_map_t> nodes_;     // dag node names and instances
-      std::map <edge_id_t, edge_map_t> edges_;     // dag edge names and instances
+      // interned graph storage: node names map to integer indices into
+      // the contiguous node_list_, and edges live contiguously as well.
+      // Traversals thus walk flat arrays instead of string-keyed maps.
+      std::vector <boost::shared_ptr <node> > node_list_;
+      std::vector <boost::shared_ptr <edge> > edge_list_;
+      std::map    <node_id_t, int>            node_idx_;
+
+      // CSR style adjacency over the interned ids: the outgoing edge
+      // indices of node i live in adj_edges_ in the range
+      // [adj_offsets_[i], adj_offsets_[i+1]).  Rebuilt on demand, as
+      // the graph only grows during construction.
+      std::vector <int>                       adj_offsets_;
+      std::vector <int>                       adj_edges_;
+      bool                                    adj_valid_;
+
+      void build_adjacency_  (void);
+      void ensure_adjacency_ (void);
+
+      // guards the graph *structure* (node and edge lists, the name
+      // index and the CSR adjacency): traversals hold the shared side
+      // via dag_view, structural growth holds the exclusive side.
+      // Node and edge state is not covered here - state updates thus
+      // never contend with a traversal.
+      util::shared_mutex                      graph_mtx_;
 
       state                            state_;     // see get_state ()
       boost::shared_ptr <scheduler>    scheduler_; // scheduler instance operating on the dag
@@ -53,11 +79,22 @@ namespace digedag
 
     protected:
       // allow our friend, the sxheduler, full access to the dag data.
-      // FIXME: we need to make sure that the scheduler is not changing these
-      // data when we are operating on them...
-      std::map <node_id_t, node_map_t> get_nodes (void) { return nodes_; }
-      std::map <edge_id_t, edge_map_t> get_edges (void) { return edges_; }
+      // These are no-copy views: traversing the graph does not duplicate
+      // it anymore.
+      // NOTE: these accessors do no locking at all - for anything longer
+      // than a single peek, hold a dag_view, which keeps the graph
+      // structure stable for its lifetime.
+      const std::vector <boost::shared_ptr <node> > & get_node_list (void) { return node_list_; }
+      const std::vector <boost::shared_ptr <edge> > & get_edge_list (void) { return edge_list_; }
+
+      boost::shared_ptr <node> get_node   (const node_id_t & name);
+      int                      node_index (const node_id_t & name);
+
+      const std::vector <int> & adjacency_offsets (void);
+      const std::vector <int> & adjacency_edges   (void);
+
       friend class scheduler;
+      friend class dag_view;
 
 
     public:
@@ -87,6 +124,7 @@ namespace digedag
 
       // operations on a dag
       void  dryrun    (void);
+      double simulate (void);
       void  reset     (void);
       void  fire      (void);
       void  wait      (void);
@@ -97,6 +135,51 @@ namespace digedag
       // inspection
       void  dump      (void);
       void  dump_node (std::string name);
+
+      // enactment statistics of the dag's scheduler (see stats.hpp)
+      scheduler_stats get_stats (void);
+  };
+
+
+  // a dag_view is a read-locked, zero-copy snapshot of the graph
+  // structure: for its lifetime it holds the dag's shared graph lock,
+  // so any number of traversals can run concurrently while add_node and
+  // add_edge are held off - no copy of the node or edge list is ever
+  // made.  Node and edge *state* (host assignments, run states) is not
+  // frozen by a view; changing it does not contend with traversals.
+  //
+  // Keep views short-lived: a live view blocks graph growth.  And since
+  // the underlying lock is not recursive, do not add nodes or edges
+  // while holding one.
+  class dag_view
+  {
+    public:
+      explicit dag_view (dag * d)
+        : dag_ (d)
+      {
+        // the adjacency rebuild needs the exclusive side, so it has to
+        // happen before we enter the shared section
+        dag_->ensure_adjacency_ ();
+        dag_->graph_mtx_.lock_shared ();
+      }
+
+      ~dag_view (void)
+      {
+        dag_->graph_mtx_.unlock_shared ();
+      }
+
+      const std::vector <boost::shared_ptr <node> > & nodes (void) const { return dag_->node_list_; }
+      const std::vector <boost::shared_ptr <edge> > & edges (void) const { return dag_->edge_list_; }
+
+      const std::vector <int> & adjacency_offsets (void) const { return dag_->adj_offsets_; }
+      const std::vector <int> & adjacency_edges   (void) const { return dag_->adj_edges_;   }
+
+    private:
+      dag * dag_;
+
+      // a view's lifetime is its lock - no copies
+      dag_view (const dag_view &);
+      dag_view & operator= (const dag_view &);
   };
 
 } // namespace digedag
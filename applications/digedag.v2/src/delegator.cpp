@@ -0,0 +1,533 @@
+
+#include "dag.hpp"
+#include "node.hpp"
+#include "edge.hpp"
+#include "delegator.hpp"
+#include "scheduler.hpp"
+#include "util/util.hpp"
+
+
+namespace digedag
+{
+  delegator::delegator (boost::shared_ptr <scheduler> s,
+                        saga::session                 session,
+                        dag                         * d,
+                        int                           min_size)
+    : s_        (s)
+    , session_  (session)
+    , dag_      (d)
+    , min_size_ (min_size > 0 ? min_size : 0)
+    , todo_     (true)
+    , built_    (false)
+  {
+    thread_run ();
+  }
+
+
+  delegator::~delegator (void)
+  {
+    {
+      util::scoped_lock l (mtx_);
+      todo_ = false;
+      cond_.notify_all ();
+    }
+    thread_join ();
+  }
+
+
+  unsigned int delegator::find_ (std::vector <unsigned int> & parent,
+                                 unsigned int                 i)
+  {
+    while ( parent[i] != i )
+    {
+      // path halving keeps the trees flat
+      parent[i] = parent[parent[i]];
+      i         = parent[i];
+    }
+
+    return i;
+  }
+
+
+  // identify the delegable clusters: connected components of nodes which
+  // are bound to the same resource, linked by the dag's edges.  Built
+  // once, lazily, on the first accept - by then the dag is scheduled and
+  // every node knows its resource.
+  void delegator::build_clusters_ (void)
+  {
+    dag_view view (dag_);
+
+    const std::vector <boost::shared_ptr <node> > & nodes = view.nodes ();
+    const std::vector <boost::shared_ptr <edge> > & edges = view.edges ();
+
+    // nodes without an explicit resource binding stay with the central
+    // enactor - we cannot tell where they will run
+    std::vector <std::string> key (nodes.size ());
+    std::map <std::string, unsigned int> pos;
+
+    for ( unsigned int i = 0; i < nodes.size (); i++ )
+    {
+      if ( ! nodes[i]->is_void ()           &&
+           ! nodes[i]->get_rm ().empty ()   )
+      {
+        key[i] = nodes[i]->get_rm () + "|" + nodes[i]->get_host ();
+      }
+
+      pos[nodes[i]->get_id ()] = i;
+    }
+
+    // union-find over the edges: two same-resource endpoints join one
+    // component
+    std::vector <unsigned int> parent (nodes.size ());
+
+    for ( unsigned int i = 0; i < nodes.size (); i++ )
+    {
+      parent[i] = i;
+    }
+
+    for ( unsigned int i = 0; i < edges.size (); i++ )
+    {
+      boost::shared_ptr <node> src = edges[i]->get_src_node ();
+      boost::shared_ptr <node> tgt = edges[i]->get_tgt_node ();
+
+      if ( ! src || ! tgt )
+      {
+        continue;
+      }
+
+      unsigned int si = pos[src->get_id ()];
+      unsigned int ti = pos[tgt->get_id ()];
+
+      if ( ! key[si].empty ()  &&
+           key[si] == key[ti]  )
+      {
+        parent[find_ (parent, si)] = find_ (parent, ti);
+      }
+    }
+
+    // keep the components large enough to amortize a handoff
+    std::map <unsigned int, unsigned int> sizes;
+
+    for ( unsigned int i = 0; i < nodes.size (); i++ )
+    {
+      if ( ! key[i].empty () )
+      {
+        sizes[find_ (parent, i)]++;
+      }
+    }
+
+    std::map <unsigned int, int> idx_of_root;
+
+    for ( unsigned int i = 0; i < nodes.size (); i++ )
+    {
+      if ( key[i].empty () )
+      {
+        continue;
+      }
+
+      unsigned int root = find_ (parent, i);
+
+      if ( sizes[root] < min_size_ )
+      {
+        continue;
+      }
+
+      if ( idx_of_root.find (root) == idx_of_root.end () )
+      {
+        cluster_t c;
+
+        c.rm       = nodes[i]->get_rm ();
+        c.launched = false;
+        c.finished = false;
+        c.ok       = false;
+
+        idx_of_root[root] = clusters_.size ();
+        clusters_.push_back (c);
+      }
+
+      cluster_t & c = clusters_[idx_of_root[root]];
+
+      c.members.push_back (nodes[i]);
+      c.ids.insert        (nodes[i]->get_id ());
+
+      cluster_of_[nodes[i]->get_id ()] = idx_of_root[root];
+    }
+
+    if ( clusters_.size () )
+    {
+      std::cout << " === delegator found " << clusters_.size ()
+                << " sub-dag cluster(s)" << std::endl;
+    }
+  }
+
+
+  // the readiness of a cluster's external inputs: edges reaching into
+  // the cluster from outside.  Returns +1 when all are Done, -1 when one
+  // Failed, 0 while some are still pending.
+  int delegator::inputs_state_ (cluster_t & c)
+  {
+    int ret = 1;
+
+    for ( unsigned int i = 0; i < c.members.size (); i++ )
+    {
+      std::vector <boost::shared_ptr <edge> > in = c.members[i]->get_edges_in ();
+
+      for ( unsigned int j = 0; j < in.size (); j++ )
+      {
+        boost::shared_ptr <node> src = in[j]->get_src_node ();
+
+        if ( src && c.ids.find (src->get_id ()) != c.ids.end () )
+        {
+          // intra-cluster dependency - the wrapper script orders it
+          continue;
+        }
+
+        state s = in[j]->get_state ();
+
+        if ( s == Failed )
+        {
+          return -1;
+        }
+
+        if ( s != Done )
+        {
+          ret = 0;
+        }
+      }
+    }
+
+    return ret;
+  }
+
+
+  // the wrapper script: all member commands, chained with '&&' in a
+  // topological order of the intra-cluster edges, so every command sees
+  // its in-cluster dependencies satisfied.  As in the batcher, a failing
+  // member fails the whole wrapper and thereby all members.
+  std::string delegator::script_ (const std::vector <boost::shared_ptr <node> > & members)
+  {
+    std::map <std::string, unsigned int> pos;
+    std::vector <unsigned int>           indeg (members.size (), 0);
+
+    for ( unsigned int i = 0; i < members.size (); i++ )
+    {
+      pos[members[i]->get_id ()] = i;
+    }
+
+    for ( unsigned int i = 0; i < members.size (); i++ )
+    {
+      std::vector <boost::shared_ptr <edge> > in = members[i]->get_edges_in ();
+
+      for ( unsigned int j = 0; j < in.size (); j++ )
+      {
+        boost::shared_ptr <node> src = in[j]->get_src_node ();
+
+        if ( src && pos.find (src->get_id ()) != pos.end () )
+        {
+          indeg[i]++;
+        }
+      }
+    }
+
+    std::vector <unsigned int> order;
+    std::vector <unsigned int> ready;
+
+    for ( unsigned int i = 0; i < members.size (); i++ )
+    {
+      if ( ! indeg[i] )
+      {
+        ready.push_back (i);
+      }
+    }
+
+    while ( ready.size () )
+    {
+      unsigned int i = ready.back ();
+      ready.pop_back ();
+      order.push_back (i);
+
+      std::vector <boost::shared_ptr <edge> > out = members[i]->get_edges_out ();
+
+      for ( unsigned int j = 0; j < out.size (); j++ )
+      {
+        boost::shared_ptr <node> tgt = out[j]->get_tgt_node ();
+
+        if ( tgt && pos.find (tgt->get_id ()) != pos.end () )
+        {
+          if ( ! --indeg[pos[tgt->get_id ()]] )
+          {
+            ready.push_back (pos[tgt->get_id ()]);
+          }
+        }
+      }
+    }
+
+    std::string cmd;
+
+    for ( unsigned int i = 0; i < order.size (); i++ )
+    {
+      if ( i ) cmd += " && ";
+
+      cmd += members[order[i]]->get_cmd ();
+    }
+
+    return cmd;
+  }
+
+
+  // take ownership of a ready node when it belongs to a delegable
+  // cluster.  The first member whose cluster has all external inputs
+  // staged triggers the handoff; members surfacing after the wrapper
+  // finished are completed on sight - their command already ran.
+  bool delegator::accept (boost::shared_ptr <node> n)
+  {
+    if ( min_size_ < 2 )
+    {
+      return false;
+    }
+
+    if ( n->is_void () )
+    {
+      return false;
+    }
+
+    bool launch   = false;
+    bool finished = false;
+    bool ok       = false;
+    int  idx      = -1;
+
+    {
+      util::scoped_lock l (mtx_);
+
+      if ( ! built_ )
+      {
+        build_clusters_ ();
+        built_ = true;
+      }
+
+      std::map <std::string, int> :: iterator it = cluster_of_.find (n->get_id ());
+
+      if ( it == cluster_of_.end () )
+      {
+        return false;
+      }
+
+      idx = it->second;
+
+      cluster_t & c = clusters_[idx];
+
+      if ( c.finished )
+      {
+        finished = true;
+        ok       = c.ok;
+      }
+      else
+      {
+        // either the wrapper carries this node already (launched), or
+        // it will once the handoff happens - record it for the final
+        // report either way
+        c.accepted.push_back (n);
+
+        if ( ! c.launched && inputs_state_ (c) > 0 )
+        {
+          launch = true;
+        }
+      }
+    }
+
+    if ( finished )
+    {
+      // the wrapper already ran this node's command remotely - report
+      // it without resubmitting
+      std::vector <boost::shared_ptr <node> > one;
+      one.push_back (n);
+
+      s_->batch_finished (one, ok);
+
+      return true;
+    }
+
+    if ( launch )
+    {
+      launch_ (idx);
+    }
+
+    return true;
+  }
+
+
+  // hand one cluster off: submit its wrapper job and mark the members
+  // handed in so far as running under it.  Members still upstream join
+  // the flight via accept when the firers release them.
+  void delegator::launch_ (int idx)
+  {
+    std::vector <boost::shared_ptr <node> > members;
+    std::vector <boost::shared_ptr <node> > accepted;
+    std::string                             rm;
+
+    {
+      util::scoped_lock l (mtx_);
+
+      cluster_t & c = clusters_[idx];
+
+      if ( c.launched )
+      {
+        return;
+      }
+
+      c.launched = true;
+
+      members  = c.members;
+      accepted = c.accepted;
+      rm       = c.rm;
+    }
+
+    std::string cmd = script_ (members);
+
+    std::cout << " === delegator hands sub-dag of " << members.size ()
+              << " node(s) to '" << rm << "'" << std::endl;
+
+    try
+    {
+      saga::job::description jd;
+
+      std::vector <std::string> args;
+      args.push_back ("-c");
+      args.push_back (cmd);
+
+      jd.set_attribute        (saga::job::attributes::description_executable, "/bin/sh");
+      jd.set_vector_attribute (saga::job::attributes::description_arguments,  args);
+
+      saga::job::service js (session_, rm);
+      saga::job::job     j  = js.create_job (jd);
+
+      j.run ();
+
+      for ( unsigned int i = 0; i < accepted.size (); i++ )
+      {
+        accepted[i]->work_start_batched (j);
+      }
+
+      flight_t f;
+      f.task    = j;
+      f.cluster = idx;
+
+      util::scoped_lock l (mtx_);
+      flight_.push_back (f);
+    }
+    catch ( const saga::exception & e )
+    {
+      std::cout << " === sub-dag handoff to '" << rm << "' failed: \n"
+                << e.what () << std::endl;
+
+      {
+        util::scoped_lock l (mtx_);
+
+        cluster_t & c = clusters_[idx];
+
+        c.finished = true;
+        c.ok       = false;
+        c.accepted.clear ();
+      }
+
+      s_->batch_finished (accepted, false);
+    }
+  }
+
+
+  // watch the external inputs of unlaunched clusters and the wrapper
+  // jobs in flight.  A completed wrapper reports all members handed in
+  // so far at once - aggregate progress, one report per sub-dag.
+  void delegator::thread_work (void)
+  {
+    while ( true )
+    {
+      std::vector <int> launches;
+
+      std::vector <std::vector <boost::shared_ptr <node> > > reports;
+      std::vector <bool>                                     oks;
+
+      {
+        util::scoped_lock l (mtx_);
+
+        if ( ! todo_ )
+        {
+          return;
+        }
+
+        util::timed_wait_ms (cond_, l, 100);
+
+        // unlaunched clusters with members waiting: launch when the
+        // external inputs became ready, fail when one of them failed
+        for ( unsigned int i = 0; i < clusters_.size (); i++ )
+        {
+          cluster_t & c = clusters_[i];
+
+          if ( c.launched || c.finished || c.accepted.empty () )
+          {
+            continue;
+          }
+
+          int s = inputs_state_ (c);
+
+          if ( s > 0 )
+          {
+            launches.push_back (i);
+          }
+          else if ( s < 0 )
+          {
+            c.finished = true;
+            c.ok       = false;
+
+            reports.push_back (c.accepted);
+            oks.push_back     (false);
+
+            c.accepted.clear ();
+          }
+        }
+
+        // collect wrapper jobs which reached a final state
+        for ( unsigned int i = 0; i < flight_.size (); i++ )
+        {
+          saga::task::state s = flight_[i].task.get_state ();
+
+          if ( s == saga::task::Done   ||
+               s == saga::task::Failed )
+          {
+            cluster_t & c = clusters_[flight_[i].cluster];
+
+            c.finished = true;
+            c.ok       = (s == saga::task::Done);
+
+            std::cout << " === sub-dag of " << c.members.size ()
+                      << " node(s) is final: "
+                      << (c.ok ? "Done" : "Failed")
+                      << std::endl;
+
+            reports.push_back (c.accepted);
+            oks.push_back     (c.ok);
+
+            c.accepted.clear ();
+
+            flight_.erase (flight_.begin () + i);
+            i--;
+          }
+        }
+      }
+
+      for ( unsigned int i = 0; i < launches.size (); i++ )
+      {
+        launch_ (launches[i]);
+      }
+
+      for ( unsigned int i = 0; i < reports.size (); i++ )
+      {
+        if ( reports[i].size () )
+        {
+          s_->batch_finished (reports[i], oks[i]);
+        }
+      }
+    }
+  }
+
+} // namespace digedag
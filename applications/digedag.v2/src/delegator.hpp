@@ -0,0 +1,105 @@
+
+#ifndef DIGEDAG_DELEGATOR_HPP
+#define DIGEDAG_DELEGATOR_HPP
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+
+#include <saga/saga.hpp>
+
+#include "util/mutex.hpp"
+#include "util/thread.hpp"
+#include "util/scoped_lock.hpp"
+#include "util/condition.hpp"
+
+
+namespace digedag
+{
+  // hierarchical enactment: for dags with dense same-resource subgraphs,
+  // central enactment pays one WAN job submission per node.  The
+  // delegator identifies clusters of nodes which are bound to the same
+  // resource and connected among each other, and hands each cluster off
+  // as a whole: one wrapper job runs the member commands in dependency
+  // order on that resource, so a cluster of a thousand nodes costs one
+  // submission instead of a thousand.
+  //
+  // The handoff happens when all of a cluster's external inputs are
+  // staged.  The wrapper reports aggregate progress - its completion
+  // finishes all members which the firers handed in; members which were
+  // not ready yet at launch time flow through the ready queue later and
+  // are completed on sight, since their command already ran remotely.
+  // Data movement stays with the central enactor: intra-cluster edges
+  // are host-local on the delegated resource, where they optimize away
+  // (see edge::optimize_).
+  //
+  // Delegation is enabled with the 'delegate size <n>' policy
+  // directive; clusters smaller than <n> keep the per-node path, as a
+  // handoff amortizes nothing for them.
+  class dag;
+  class node;
+  class edge;
+  class scheduler;
+  class delegator : public digedag::util::thread
+  {
+    private:
+      struct cluster_t
+      {
+        std::string                             rm;        // submission endpoint
+        std::vector <boost::shared_ptr <node> > members;   // all member nodes
+        std::set    <std::string>               ids;       // member node ids
+        std::vector <boost::shared_ptr <node> > accepted;  // handed in by firers
+        bool                                    launched;
+        bool                                    finished;
+        bool                                    ok;
+      };
+
+      struct flight_t
+      {
+        saga::task                              task;      // the wrapper job
+        int                                     cluster;   // index into clusters_
+      };
+
+      boost::shared_ptr <scheduler>   s_;
+      saga::session                   session_;
+      dag                           * dag_;
+      unsigned int                    min_size_;
+      bool                            todo_;
+      bool                            built_;
+
+      std::vector <cluster_t>         clusters_;
+      std::map <std::string, int>     cluster_of_;  // node id -> cluster index
+      std::vector <flight_t>          flight_;
+
+      util::mutex                     mtx_;
+      util::condition                 cond_;
+
+      void        build_clusters_ (void);
+      int         inputs_state_   (cluster_t & c);
+      void        launch_         (int idx);
+      std::string script_         (const std::vector <boost::shared_ptr <node> > & members);
+
+      static unsigned int find_   (std::vector <unsigned int> & parent,
+                                   unsigned int                 i);
+
+    public:
+      delegator (boost::shared_ptr <scheduler> s,
+                 saga::session                 session,
+                 dag                         * d,
+                 int                           min_size);
+
+      ~delegator (void);
+
+      // take ownership of a ready node when it belongs to a delegable
+      // cluster.  Returns false otherwise - the caller then submits the
+      // node directly, as before.
+      bool accept (boost::shared_ptr <node> n);
+
+      void thread_work (void);
+  };
+
+} // namespace digedag
+
+
+#endif // DIGEDAG_DELEGATOR_HPP
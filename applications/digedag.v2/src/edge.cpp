@@ -231,10 +231,26 @@ namespace digedag
       task_ = f_src.copy <saga::task::Async> (tgt_url_, saga::filesystem::Overwrite
                                                       | saga::filesystem::CreateParents);
 
-      std::cout << " === edge run : " << get_name () 
+      std::cout << " === edge run : " << get_name ()
                 << " (" << src_url_ << " -> " << tgt_url_ << ") - "
-                << task_.get_id () 
+                << task_.get_id ()
                 << std::endl;
+
+      // streaming mode: when the target node's executable is marked
+      // stream-capable ('stream <exe>' policy directive), fire it right
+      // away.  The node launches while the copy is still writing
+      // tgt_url_ and reads input as data arrives, so the remaining
+      // transfer hides behind compute.  node::fire's readiness
+      // accounting treats this edge as satisfied; the second fire from
+      // work_done is a no-op.  A transfer failing after the node
+      // started surfaces as the node failing on truncated input.
+      if ( tgt_node_ && scheduler_->streams (tgt_node_->get_cmd ()) )
+      {
+        std::cout << " === edge " << get_name () << " streams into "
+                  << tgt_node_->get_id () << std::endl;
+
+        tgt_node_->fire (shared_from_this ());
+      }
     }
 
     task_valid_ = true;
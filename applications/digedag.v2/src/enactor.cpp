@@ -1,4 +1,6 @@
 
+#include <boost/bind.hpp>
+
 #include "dag.hpp"
 #include "node.hpp"
 #include "edge.hpp"
@@ -8,72 +10,141 @@
 
 namespace digedag
 {
-  enactor::enactor (boost::shared_ptr <scheduler> s, 
+  enactor::enactor (boost::shared_ptr <scheduler> s,
                     std::string                   flag)
-    : s_    (s)
-    , f_    (flag)
-    , todo_ (true)
+    : s_      (s)
+    , f_      (flag)
+    , todo_   (true)
+    , use_cb_ (true)
   {
     thread_run ();
   }
 
-  
+
   enactor::~enactor (void)
   {
-    todo_ = false;
+    {
+      util::scoped_lock l (mtx_);
+      todo_ = false;
+      cond_.notify_all ();
+    }
     thread_join ();
   }
 
   void enactor::queue_task (saga::task t)
   {
-    util::scoped_lock (mtx_);
+    util::scoped_lock l (mtx_);
     tc_.add_task (t);
+
+    if ( use_cb_ )
+    {
+      try
+      {
+        // get notified on state changes instead of polling.  The task
+        // itself is bound into the callback, as the callback's object
+        // parameter is of little use to re-identify it.
+        t.add_callback (saga::metrics::task_state,
+                        boost::bind (&enactor::task_state_cb, this,
+                                     t, _1, _2, _3));
+      }
+      catch ( saga::exception const & e )
+      {
+        // adaptor does not support monitoring -- poll for all tasks
+        std::cout << " === task monitoring unavailable ("
+                  << e.what () << "), falling back to polling"
+                  << std::endl;
+        use_cb_ = false;
+      }
+    }
+
+    cond_.notify_one ();
   }
 
 
-  void enactor::thread_work (void)
+  // runs in the saga engine's callback context: park the final task on the
+  // completion queue and wake the worker thread.
+  bool enactor::task_state_cb (saga::task    t,
+                               saga::object  o,
+                               saga::metric  m,
+                               saga::context c)
   {
-    std::vector <saga::task> tasks;
+    saga::task::state s = t.get_state ();
+
+    if ( s == saga::task::Done   ||
+         s == saga::task::Failed )
+    {
+      util::scoped_lock l (mtx_);
+      finished_.push_back (t);
+      cond_.notify_one ();
+
+      // final state reached - drop the callback
+      return false;
+    }
 
+    // intermediate state change - stay registered
+    return true;
+  }
+
+
+  void enactor::thread_work (void)
+  {
     while ( todo_ )
     {
+      std::vector <saga::task> finals;
+
       {
-        util::scoped_lock (mtx_);
-        tasks = tc_.list_tasks ();
-      }
+        util::scoped_lock l (mtx_);
 
-      // by default, so unless we find interesting task state changes, we
-      // sleep a little to avoid busy waits.  Task container notifications
-      // will help once implemented.
-      bool do_wait = true;
+        if ( finished_.empty () )
+        {
+          // sleep until a callback signals a completion.  The timeout
+          // keeps the polling fallback alive and lets us notice todo_.
+          util::timed_wait_ms (cond_, l, 100);
+        }
+
+        while ( ! finished_.empty () )
+        {
+          finals.push_back (finished_.front ());
+          finished_.pop_front ();
+        }
+      }
 
-      for ( unsigned int i = 0; i < tasks.size (); i++ )
+      // without callbacks, cycle over the task container as before
+      if ( ! use_cb_ && finals.empty () )
       {
-        saga::task        t = tasks[i];
-        saga::task::state s = t.get_state ();
+        std::vector <saga::task> tasks;
 
-        if ( s == saga::task::Done   || 
-             s == saga::task::Failed )
         {
-          std::cout << " === task " << t.get_id () << " is final: " 
-                    << saga_state_to_string (t.get_state ()) 
-                    << std::endl;
+          util::scoped_lock l (mtx_);
+          tasks = tc_.list_tasks ();
+        }
+
+        for ( unsigned int i = 0; i < tasks.size (); i++ )
+        {
+          saga::task        t = tasks[i];
+          saga::task::state s = t.get_state ();
 
+          if ( s == saga::task::Done   ||
+               s == saga::task::Failed )
           {
-            util::scoped_lock (mtx_);
-            tc_.remove_task   (t);
-            s_->work_finished (t, f_);
+            finals.push_back (t);
           }
-
-          // just check task container again immediately
-          do_wait = false;
         }
       }
 
-      // avoid busy wait
-      if ( do_wait )
+      for ( unsigned int i = 0; i < finals.size (); i++ )
       {
-        util::ms_sleep (100);
+        saga::task t = finals[i];
+
+        std::cout << " === task " << t.get_id () << " is final: "
+                  << saga_state_to_string (t.get_state ())
+                  << std::endl;
+
+        {
+          util::scoped_lock l (mtx_);
+          tc_.remove_task   (t);
+          s_->work_finished (t, f_);
+        }
       }
     } // while (todo_)
   }
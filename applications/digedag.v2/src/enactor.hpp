@@ -11,14 +11,17 @@
 #include "util/mutex.hpp"
 #include "util/thread.hpp"
 #include "util/scoped_lock.hpp"
+#include "util/condition.hpp"
 
 
 namespace digedag
 {
-  // task_container are broken, we use this watch_tasks class for notification
-  // on finished tasks.  It will constantly cycle over the contents of a given
-  // task container in its worker thread, and will call 'cb' in the main thread
-  // if any task changed its state to Done or Failed.
+  // task_container are broken, so the enactor watches tasks itself.  Each
+  // queued task gets a callback on its state metric, which pushes the task
+  // onto a condition-signaled completion queue once it turns Done or
+  // Failed -- the worker thread sleeps until then and only forwards
+  // completions to the scheduler.  When an adaptor does not support
+  // monitoring, we fall back to cycling over the task container as before.
 
   class dag;
   class node;
@@ -31,13 +34,22 @@ namespace digedag
       boost::shared_ptr <scheduler>     s_;
       std::string                       f_;
       bool                              todo_;
+      bool                              use_cb_;
+
+      std::deque <saga::task>           finished_;
 
       util::mutex                       mtx_;
+      util::condition                   cond_;
       void lock                (void) { mtx_.lock   (); };
       void unlock              (void) { mtx_.unlock (); };
 
+      bool task_state_cb (saga::task    t,
+                          saga::object  o,
+                          saga::metric  m,
+                          saga::context c);
+
     public:
-      enactor (boost::shared_ptr <scheduler> s, 
+      enactor (boost::shared_ptr <scheduler> s,
                std::string                   flag);
 
       ~enactor (void);
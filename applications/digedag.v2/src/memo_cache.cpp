@@ -0,0 +1,70 @@
+
+#include <fstream>
+#include <sstream>
+
+#include "memo_cache.hpp"
+
+#include "util/scoped_lock.hpp"
+
+namespace digedag
+{
+  memo_cache::memo_cache (const std::string & path)
+    : path_ (path)
+  {
+    // load digests recorded by earlier enactments
+    std::ifstream fin (path_.c_str ());
+    std::string   line;
+
+    while ( std::getline (fin, line) )
+    {
+      if ( ! line.empty () )
+      {
+        known_.insert (line);
+      }
+    }
+  }
+
+  bool memo_cache::lookup (const std::string & digest)
+  {
+    util::scoped_lock sl (mtx_);
+
+    return known_.find (digest) != known_.end ();
+  }
+
+  void memo_cache::record (const std::string & digest)
+  {
+    util::scoped_lock sl (mtx_);
+
+    if ( known_.find (digest) != known_.end () )
+    {
+      return;
+    }
+
+    known_.insert (digest);
+
+    // append-only, flushed per entry, so a crashed enactment keeps the
+    // hits it earned
+    std::ofstream fout (path_.c_str (), std::ios::app);
+    fout << digest << std::endl;
+  }
+
+  std::string memo_cache::digest (const std::string & data)
+  {
+    // FNV-1a, 64 bit - we need a stable fingerprint, not a
+    // cryptographic one
+    unsigned long long h = 14695981039346656037ULL;
+
+    for ( std::string::size_type i = 0; i < data.size (); i++ )
+    {
+      h ^= (unsigned char) data[i];
+      h *= 1099511628211ULL;
+    }
+
+    std::stringstream ss;
+    ss << std::hex << h;
+
+    return ss.str ();
+  }
+
+} // namespace digedag
+
@@ -0,0 +1,42 @@
+
+#ifndef DIGEDAG_MEMO_CACHE_HPP
+#define DIGEDAG_MEMO_CACHE_HPP
+
+#include <set>
+#include <string>
+
+#include "util/mutex.hpp"
+
+namespace digedag
+{
+  // persistent memoization cache for node results.  A node's work is
+  // identified by a digest over its command line and the content stamps
+  // of its input files; digests of successfully completed nodes are
+  // recorded in an append-only file, one per line.  A later enactment
+  // which produces the same digest can skip the node and reuse the
+  // outputs left by the earlier run - this assumes the workflow runs in
+  // the same workspace, as is the case for our re-enactments.
+  //
+  // enabled via the 'memoize <path>' policy directive (see
+  // scheduler::parse_src).
+  class memo_cache
+  {
+    private:
+      std::string            path_;
+      std::set <std::string> known_;
+      util::mutex            mtx_;
+
+    public:
+      memo_cache (const std::string & path);
+
+      bool lookup (const std::string & digest);
+      void record (const std::string & digest);
+
+      // stable (non-cryptographic) fingerprint of a signature string
+      static std::string digest (const std::string & data);
+  };
+
+} // namespace digedag
+
+#endif // DIGEDAG_MEMO_CACHE_HPP
+
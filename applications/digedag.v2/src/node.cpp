@@ -1,12 +1,14 @@
 
 #include <vector>
 #include <sstream>
+#include <algorithm>
 
 #include <saga/saga.hpp>
 
 
 #include "node.hpp"
 #include "scheduler.hpp"
+#include "memo_cache.hpp"
 #include "util/split.hpp"
 #include "util/util.hpp"
 
@@ -27,6 +29,8 @@ namespace digedag
     , scheduler_  (       scheduler)
     , session_    (         session)
     , this_fires_ (           false)
+    , pending_in_ (               0)
+    , failed_in_  (               0)
   {
     std::stringstream ss;
 
@@ -65,6 +69,8 @@ namespace digedag
     , scheduler_  (       scheduler)
     , session_    (         session)
     , this_fires_ (           false)
+    , pending_in_ (               0)
+    , failed_in_  (               0)
   {
     // parse cmd into node description
     std::vector <std::string> elems = split (cmd_);
@@ -89,6 +95,8 @@ namespace digedag
     , scheduler_  (       scheduler)
     , session_    (         session)
     , this_fires_ (           false)
+    , pending_in_ (               0)
+    , failed_in_  (               0)
   {
   }
 
@@ -118,8 +126,19 @@ namespace digedag
     util::scoped_lock (mtx_);
     edges_in_.push_back (e);
 
-    // set initial input edge state
+    // set initial input edge state (kept for debugging dumps only)
     edges_state_[e->get_name ()] = e->get_state ();
+
+    // account for the new predecessor
+    if ( Done != e->get_state () )
+    {
+      __sync_add_and_fetch (&pending_in_, 1);
+    }
+
+    if ( Failed == e->get_state () )
+    {
+      __sync_add_and_fetch (&failed_in_, 1);
+    }
   }
 
   void node::add_edge_out (boost::shared_ptr <edge> e)
@@ -132,17 +151,11 @@ namespace digedag
   void node::dryrun (void)
   {
     util::scoped_lock (mtx_);
-    // check if all input data are ready
-    std::map <std::string, state> :: iterator begin = edges_state_.begin ();
-    std::map <std::string, state> :: iterator end   = edges_state_.end   ();
-    std::map <std::string, state> :: iterator it;
 
-    for ( it = begin; it != end; it++ )
+    // check if all input data are ready
+    if ( 0 < pending_in_ )
     {
-      if ( Done != it->second )
-      {
-        return;
-      }
+      return;
     }
 
     // update state
@@ -192,6 +205,14 @@ namespace digedag
     //           << e->get_name () << " fired me: " << state_to_string (e->get_state ()) 
     //           << std::endl;
 
+    // one predecessor less to wait for.  This is the hot path of
+    // dependency resolution, so it is a plain atomic decrement - the
+    // string-keyed map below is only updated for debugging dumps.
+    if ( Done != edges_state_[e->get_name ()] )
+    {
+      __sync_sub_and_fetch (&pending_in_, 1);
+    }
+
     // store state of firing edge
     edges_state_[e->get_name ()] = Done;
 
@@ -216,9 +237,29 @@ namespace digedag
       return;
     }
 
+    // memoization: when the scheduler carries a result cache and this
+    // node's command and input stamps digest to a recorded entry, an
+    // earlier enactment completed identical work - skip execution and
+    // reuse its outputs (still in place, see memo_cache.hpp).
+    if ( scheduler_->memo () )
+    {
+      std::string sig = memo_signature_ ();
+
+      if ( ! sig.empty () && scheduler_->memo ()->lookup (sig) )
+      {
+        std::cout << std::string (" ===     node ") << get_name ()
+                  << " (" << get_cmd () << ") "
+                  << " memo hit - skipping run"
+                  << std::endl;
+
+        work_done ();
+        return;
+      }
+    }
+
     // all input edges are Done, i.e. all input data are available.  We
     // can thus really execute the node application.
-    // 
+    //
     // ### scheduler hook - leave it to the scheduler to call our work routine
     boost::shared_ptr <node> me = shared_from_this ();
     assert (me);
@@ -314,6 +355,31 @@ namespace digedag
   }
 
 
+  // batched submission: the batcher runs our command as part of a shared
+  // wrapper job.  Mark the node Running and track the wrapper task for
+  // state queries - completion is reported by the batcher via
+  // work_done/work_failed as usual.
+  void node::work_start_batched (saga::task t)
+  {
+    util::scoped_lock (mtx_);
+
+    if ( state_ == Stopped ) return;
+
+    assert ( state_ == Pending );
+
+    state_      = Running;
+    task_       = t;
+    valid_task_ = true;
+
+    std::cout << " === node run : "
+              << get_name ()
+              << " (batched): "
+              << state_to_string (state_)
+              << " - " << task_.get_id ()
+              << std::endl;
+  }
+
+
   void node::work_done (void)
   {
     // scope for scoped lock
@@ -329,10 +395,22 @@ namespace digedag
       state_ = Done;
 
       std::cout << std::string (" === node done: ")
-                << get_name () 
-                << " (" << get_cmd () << ") " 
+                << get_name ()
+                << " (" << get_cmd () << ") "
                 << std::endl;
 
+      // remember real (non-memoized) successful runs, so an identical
+      // re-enactment can skip this node
+      if ( valid_task_ && scheduler_->memo () )
+      {
+        std::string sig = memo_signature_ ();
+
+        if ( ! sig.empty () )
+        {
+          scheduler_->memo ()->record (sig);
+        }
+      }
+
       // we report done before we call the edge's fire, to be able to release the
       // lock (see below)
       // ### scheduler hook
@@ -438,6 +516,20 @@ namespace digedag
     return name_;
   }
 
+  std::string node::get_host (void) const
+  {
+    util::scoped_lock (mtx_);
+
+    return host_;
+  }
+
+  std::string node::get_rm (void) const
+  {
+    util::scoped_lock (mtx_);
+
+    return rm_;
+  }
+
   node_description node::get_description (void) const
   {
     util::scoped_lock (mtx_);
@@ -473,30 +565,17 @@ namespace digedag
     if ( state_ == Incomplete )
     {
       // check if any input data failed
-      std::map <std::string, state> :: iterator begin = edges_state_.begin ();
-      std::map <std::string, state> :: iterator end   = edges_state_.end   ();
-      std::map <std::string, state> :: iterator it;
-
-      for ( it = begin; it != end; it++ )
+      if ( 0 < failed_in_ )
       {
-        if ( Failed == it->second )
-        {
-          // std::cout << " !!! node " << get_name () << " failed due to edge " << it->first << std::endl;
-          state_ = Failed;
-          return state_;
-        }
+        state_ = Failed;
+        return state_;
       }
 
       // check if all input data are ready
-      for ( it = begin; it != end; it++ )
+      if ( 0 < pending_in_ )
       {
-        if ( Done != it->second )
-        {
-          // std::cout << " === node " << get_name () << " : input '"
-          //            << it->first << "' is missing: " << state_to_string (it->second) << std::endl; 
-          state_ = Incomplete;
-          return state_;
-        }
+        state_ = Incomplete;
+        return state_;
       }
 
       // no dep failed, all Done - we are pending!
@@ -678,6 +757,57 @@ namespace digedag
     }
   }
 
+  std::string node::memo_signature_ (void)
+  {
+    util::scoped_lock (mtx_);
+
+    if ( is_void_ )
+    {
+      return "";
+    }
+
+    // stamp every input file with its url and size.  A file we cannot
+    // stat disables memoization for the node - better to re-run than to
+    // reuse stale outputs.
+    std::vector <std::string> stamps;
+
+    for ( unsigned int i = 0; i < edges_in_.size (); i++ )
+    {
+      saga::url in (edges_in_[i]->get_tgt ());
+
+      if ( in.get_string ().empty () )
+      {
+        continue;
+      }
+
+      try
+      {
+        saga::filesystem::file f (session_, in, saga::filesystem::Read);
+
+        std::stringstream ss;
+        ss << in.get_string () << "=" << f.get_size ();
+
+        stamps.push_back (ss.str ());
+      }
+      catch ( const saga::exception & )
+      {
+        return "";
+      }
+    }
+
+    // input order must not change the digest
+    std::sort (stamps.begin (), stamps.end ());
+
+    std::string buf = get_cmd ();
+
+    for ( unsigned int i = 0; i < stamps.size (); i++ )
+    {
+      buf += "|" + stamps[i];
+    }
+
+    return memo_cache::digest (buf);
+  }
+
   std::string node::get_cmd (void)
   {
     util::scoped_lock (mtx_);
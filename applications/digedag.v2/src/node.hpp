@@ -25,6 +25,14 @@ namespace digedag
       std::vector <boost::shared_ptr <edge> > edges_in_;    // input  data
       std::vector <boost::shared_ptr <edge> > edges_out_;   // output data
       std::map    <std::string, state>        edges_state_; // states of incoming edges
+                                                            // (kept for debugging dumps only)
+
+      // hot path of dependency resolution: count of incoming edges which
+      // are not Done yet, and count of failed ones.  Updated with atomic
+      // increments/decrements when edges register or fire, so readiness
+      // checks are O(1) instead of walking the string-keyed map.
+      volatile int                            pending_in_;
+      volatile int                            failed_in_;
 
       std::string                             rm_;
       std::string                             cmd_;
@@ -47,7 +55,10 @@ namespace digedag
       bool                                    this_fires_;
       util::mutex                             mtx_;
 
-      std::string   get_cmd (void);
+      // digest identifying this node's work for the memoization cache:
+      // command line plus content stamps of all input files.  Empty when
+      // the node cannot be memoized (void node, unstampable input).
+      std::string memo_signature_ (void);
 
 
     public:
@@ -77,10 +88,15 @@ namespace digedag
       void             stop            (void);
       void             dump            (void);
       saga::task       work_start      (void);
+      void             work_start_batched (saga::task t);
       void             work_done       (void);
       void             work_failed     (void);
       std::string      get_id          (void) const;
       std::string      get_name        (void) const;
+      std::string      get_host        (void) const;
+      std::string      get_rm          (void) const;
+      std::string      get_cmd         (void);
+      bool             is_void         (void) const { return is_void_; }
       node_description get_description (void) const;
       void             set_state       (state s);
       state            get_state       (void);
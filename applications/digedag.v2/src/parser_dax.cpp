@@ -1,5 +1,10 @@
 
+#include <ctype.h>
+
+#include <map>
+#include <set>
 #include <string>
+#include <fstream>
 #include <iostream>
 #include <unistd.h>
 
@@ -12,7 +17,234 @@ namespace digedag
 {
   namespace dax
   {
-    parser::parser (const std::string & dag_file, 
+    // minimal streaming xml scanner for the dax subset we understand.
+    // It reads the document front to back with bounded memory, and
+    // reports begin tags (with attributes), text, and end tags, one at
+    // a time.  It is not a general xml parser: DTDs, namespaces and
+    // exotic entities are not handled - when a scan goes wrong, the
+    // caller falls back to the DOM based code path below.
+    class dax_scanner
+    {
+      public:
+        typedef std::map <std::string, std::string> attribs_t;
+
+        enum token
+        {
+          Begin = 1,   // <name attr="val">
+          End   = 2,   // </name>
+          Text  = 3,   // character data
+          Eof   = 4,
+          Error = 5
+        };
+
+        dax_scanner (std::istream & in) : in_ (in) { }
+
+        token next (std::string & name,
+                    attribs_t   & attribs,
+                    std::string & text);
+
+      private:
+        std::istream & in_;
+        std::string    pending_end_; // deferred end token for '<name/>'
+
+        std::string decode_ (const std::string & s);
+    };
+
+
+    // scan the next token.  name and attribs are set for Begin, name for
+    // End, and text for Text.  An empty element '<name/>' yields Begin,
+    // and the matching End on the next call.
+    dax_scanner::token dax_scanner::next (std::string & name,
+                                          attribs_t   & attribs,
+                                          std::string & text)
+    {
+      name.clear    ();
+      attribs.clear ();
+      text.clear    ();
+
+      if ( ! pending_end_.empty () )
+      {
+        name = pending_end_;
+        pending_end_.clear ();
+        return End;
+      }
+
+      int c = in_.get ();
+
+      if ( ! in_.good () )
+      {
+        return Eof;
+      }
+
+      if ( c != '<' )
+      {
+        // character data, up to the next tag
+        while ( in_.good () && c != '<' )
+        {
+          text += (char) c;
+          c     = in_.get ();
+        }
+
+        if ( in_.good () )
+        {
+          in_.unget ();
+        }
+
+        text = decode_ (text);
+        return Text;
+      }
+
+      // some sort of markup - read up to the closing '>', minding quotes
+      std::string raw;
+      char        quote = 0;
+
+      c = in_.get ();
+
+      while ( in_.good () && ( quote || c != '>' ) )
+      {
+        if ( quote && c == quote )
+        {
+          quote = 0;
+        }
+        else if ( ! quote && ( c == '"' || c == '\'' ) )
+        {
+          quote = (char) c;
+        }
+
+        raw += (char) c;
+        c    = in_.get ();
+      }
+
+      if ( ! in_.good () || raw.empty () )
+      {
+        return Error;
+      }
+
+      if ( 0 == raw.compare (0, 3, "!--") )
+      {
+        // comments may contain '>', so read on until '-->'
+        while ( in_.good () && 0 != raw.compare (raw.size () - 2, 2, "--") )
+        {
+          raw += '>';
+
+          while ( in_.good () && (c = in_.get ()) != '>' )
+          {
+            raw += (char) c;
+          }
+        }
+
+        return next (name, attribs, text);
+      }
+
+      if ( raw[0] == '?' ||
+           raw[0] == '!' )
+      {
+        // xml declaration, doctype etc - skip
+        return next (name, attribs, text);
+      }
+
+      bool is_end   = (raw[0]               == '/');
+      bool is_empty = (raw[raw.size () - 1] == '/');
+
+      size_t b = is_end   ? 1               : 0;
+      size_t e = is_empty ? raw.size () - 1 : raw.size ();
+
+      std::string body = raw.substr (b, e - b);
+
+      // tag name
+      size_t i = 0;
+
+      while ( i < body.size () && ! isspace (body[i]) )
+      {
+        i++;
+      }
+
+      name = body.substr (0, i);
+
+      if ( is_end )
+      {
+        return End;
+      }
+
+      // attributes: key="val" or key='val'
+      while ( i < body.size () )
+      {
+        while ( i < body.size () && isspace (body[i]) )
+        {
+          i++;
+        }
+
+        size_t k = i;
+
+        while ( i < body.size () && body[i] != '=' && ! isspace (body[i]) )
+        {
+          i++;
+        }
+
+        std::string key = body.substr (k, i - k);
+
+        while ( i < body.size () && ( isspace (body[i]) || body[i] == '=' ) )
+        {
+          i++;
+        }
+
+        if ( i >= body.size () || ( body[i] != '"' && body[i] != '\'' ) )
+        {
+          if ( key.empty () )
+          {
+            break;
+          }
+
+          attribs[key] = "";
+          continue;
+        }
+
+        char   q = body[i++];
+        size_t v = i;
+
+        while ( i < body.size () && body[i] != q )
+        {
+          i++;
+        }
+
+        attribs[key] = decode_ (body.substr (v, i - v));
+        i++;
+      }
+
+      if ( is_empty )
+      {
+        pending_end_ = name;
+      }
+
+      return Begin;
+    }
+
+
+    // resolve the predefined xml entities
+    std::string dax_scanner::decode_ (const std::string & s)
+    {
+      if ( s.find ('&') == std::string::npos )
+      {
+        return s;
+      }
+
+      std::string out;
+
+      for ( size_t i = 0; i < s.size (); i++ )
+      {
+        if      ( 0 == s.compare (i, 4, "&lt;"   ) ) { out += '<';  i += 3; }
+        else if ( 0 == s.compare (i, 4, "&gt;"   ) ) { out += '>';  i += 3; }
+        else if ( 0 == s.compare (i, 5, "&amp;"  ) ) { out += '&';  i += 4; }
+        else if ( 0 == s.compare (i, 6, "&quot;" ) ) { out += '"';  i += 5; }
+        else if ( 0 == s.compare (i, 6, "&apos;" ) ) { out += '\''; i += 5; }
+        else                                         { out += s[i];        }
+      }
+
+      return out;
+    }
+
+
+    parser::parser (const std::string & dag_file,
                     const std::string & scheduler_file)
       : dag_file_       (dag_file)
       , scheduler_file_ (scheduler_file)
@@ -30,6 +262,198 @@ namespace digedag
       return dag_; 
     }
 
+    // streaming code path: scan the document front to back, and create
+    // nodes as soon as their job element is complete, instead of loading
+    // the whole document into a DOM first.  Only the input/output file
+    // lists are kept until the end of the scan, where they get resolved
+    // into edges - so parse memory is bound by the number of
+    // dependencies, not by the document size, and consumers see nodes
+    // appear while the file is still being read.
+    bool parser::parse_dag_streaming (void)
+    {
+      std::ifstream fin (dag_file_.c_str ());
+
+      if ( ! fin.good () )
+      {
+        return false;
+      }
+
+      dax_scanner scanner (fin);
+
+      std::string            name;
+      dax_scanner::attribs_t attribs;
+      std::string            text;
+
+      // state of the job element currently being read
+      bool                      in_job      = false;
+      bool                      in_argument = false;
+      std::string               job_id;
+      std::vector <std::string> job_args;
+      node_description          job_nd;
+
+      // file/job pairs, for edge resolution after the scan
+      std::vector <std::pair <std::string, std::string> > inputs;
+      std::map    <std::string, std::string>              outputs;
+
+      unsigned int n_nodes = 0;
+
+      while ( true )
+      {
+        dax_scanner::token tok = scanner.next (name, attribs, text);
+
+        if ( tok == dax_scanner::Eof )
+        {
+          break;
+        }
+
+        if ( tok == dax_scanner::Error )
+        {
+          return false;
+        }
+
+        if ( tok == dax_scanner::Begin )
+        {
+          if ( name == "job" )
+          {
+            in_job = true;
+            job_id = attribs["id"];
+
+            job_args.clear ();
+
+            job_nd = node_description ();
+            job_nd.set_attribute ("Executable", attribs["name"]);
+          }
+          else if ( in_job && name == "argument" )
+          {
+            in_argument = true;
+          }
+          else if ( in_argument )
+          {
+            // file references within the argument list
+            job_args.push_back (attribs["file"]);
+          }
+          else if ( in_job && name == "uses" )
+          {
+            std::string s_file = attribs["file"];
+            std::string s_link = attribs["link"];
+
+            if ( s_link == "input" )
+            {
+              inputs.push_back (std::pair <std::string, std::string> (s_file, job_id));
+            }
+            else if ( s_link == "output" )
+            {
+              // keep the first producer, as the DOM code path does
+              if ( outputs.find (s_file) == outputs.end () )
+              {
+                outputs[s_file] = job_id;
+              }
+            }
+            else
+            {
+              std::cerr << "cannot handle link type " << s_link << std::endl;
+            }
+          }
+        }
+        else if ( tok == dax_scanner::Text )
+        {
+          if ( in_argument )
+          {
+            // tokens go straight from the text into job_args, without
+            // an intermediate vector of strings
+            line_splitter ls (text);
+
+            const char * tok     = NULL;
+            std::size_t  tok_len = 0;
+
+            while ( ls.next (&tok, &tok_len) )
+            {
+              job_args.push_back (std::string (tok, tok_len));
+            }
+          }
+        }
+        else if ( tok == dax_scanner::End )
+        {
+          if ( name == "argument" )
+          {
+            in_argument = false;
+          }
+          else if ( name == "job" && in_job )
+          {
+            if ( job_args.size () )
+            {
+              job_nd.set_vector_attribute ("Arguments", job_args);
+            }
+
+            // the node is complete - hand it to the dag right away
+            boost::shared_ptr <node> n = dag_->create_node (job_nd, job_id);
+
+            dag_->add_node (job_id, n);
+
+            in_job = false;
+            n_nodes++;
+          }
+        }
+      }
+
+      if ( 0 == n_nodes )
+      {
+        // nothing recognized - probably not a dax file we understand
+        return false;
+      }
+
+      // resolve dependencies.  Same semantics as the DOM code path, but
+      // the producer lookup is a map instead of a nested loop.  Inputs
+      // not produced by some outputting node are staged in from a data
+      // src (INPUT); outputs not consumed by another node are staged to
+      // a data sink (OUTPUT).
+      std::set <std::string> consumed;
+
+      for ( unsigned int i = 0; i < inputs.size (); i++ )
+      {
+        std::string file   = inputs[i].first;
+        std::string i_node = inputs[i].second;
+
+        consumed.insert (file);
+
+        std::map <std::string, std::string> :: const_iterator o = outputs.find (file);
+
+        if ( o == outputs.end () )
+        {
+          saga::url loc (file);
+          loc.set_scheme ("any");
+          boost::shared_ptr <edge> e = dag_->create_edge (loc);
+
+          dag_->add_edge (e, "INPUT", i_node);
+        }
+        else if ( o->second != i_node )
+        {
+          saga::url loc (file);
+          loc.set_scheme ("any");
+          boost::shared_ptr <edge> e = dag_->create_edge (loc);
+
+          dag_->add_edge (e, o->second, i_node);
+        }
+      }
+
+      std::map <std::string, std::string> :: const_iterator it;
+
+      for ( it = outputs.begin (); it != outputs.end (); it++ )
+      {
+        if ( consumed.find (it->first) == consumed.end () )
+        {
+          saga::url loc (it->first);
+          loc.set_scheme ("any");
+          boost::shared_ptr <edge> e = dag_->create_edge (loc);
+
+          dag_->add_edge (e, it->second, "OUTPUT");
+        }
+      }
+
+      return true;
+    }
+
+
     // Note that, when parsing file names and arguments, paths are interpreted
     // to be relative to the applications working directory.
     void parser::parse_dag (void)
@@ -37,6 +461,20 @@ namespace digedag
       dag_ = boost::shared_ptr <dag> (new dag (scheduler_file_));
 
       std::cout << "parsing " << dag_file_ << std::endl;
+
+      // try the streaming scanner first: it keeps parse memory bound and
+      // creates nodes while still reading.  On any scan trouble we start
+      // over with the DOM based code path below.
+      if ( parse_dag_streaming () )
+      {
+        std::cout << "parsing " << dag_file_ << " done" << std::endl;
+        return;
+      }
+
+      std::cout << "streaming parse failed - falling back to DOM parse" << std::endl;
+
+      dag_ = boost::shared_ptr <dag> (new dag (scheduler_file_));
+
       try
       {
         ticpp::Document doc (dag_file_);
@@ -89,18 +527,14 @@ namespace digedag
 
                 if ( tmp.size () )
                 {
-                  std::vector <std::string> s_tmp = split (tmp);
+                  line_splitter ls (tmp);
+
+                  const char * tok     = NULL;
+                  std::size_t  tok_len = 0;
 
-                  for ( unsigned int j = 0; j < s_tmp.size (); j++ )
+                  while ( ls.next (&tok, &tok_len) )
                   {
-                    if ( s_tmp [j] == "." )
-                    {
-                      s_args.push_back (s_tmp[j]);
-                    }
-                    else
-                    {
-                      s_args.push_back (s_tmp[j]);
-                    }
+                    s_args.push_back (std::string (tok, tok_len));
                   }
                 }
               }
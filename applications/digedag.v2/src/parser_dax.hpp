@@ -25,6 +25,10 @@ namespace digedag
         void parse_node (const std::string spec);
         void parse_edge (const std::string spec);
 
+        // streaming code path for large dax files - falls back to the
+        // DOM based parse_dag on failure
+        bool parse_dag_streaming (void);
+
 
       public:
         parser (const std::string & dag_file, 
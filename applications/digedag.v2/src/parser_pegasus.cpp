@@ -1,8 +1,11 @@
 
 #include <string>
+#include <sstream>
 #include <fstream>
 #include <iostream>
 
+#include <unistd.h>
+
 #include "util/split.hpp"
 #include "parser_pegasus.hpp"
 
@@ -10,6 +13,206 @@ namespace digedag
 {
   namespace pegasus
   {
+    // -----------------------------------------------------------------
+    //
+    // one JOB line's description file, parsed on the shared worker
+    // pool.  The job only fills its own node_description - the dag is
+    // not touched here, so any number of files parse concurrently and
+    // the merge step below stays trivial.  Output is collected into a
+    // per-job log and printed at merge time, so the chatter of
+    // concurrent parses does not interleave.
+    //
+    class node_parse_job : public util::thread
+    {
+      public:
+        std::string        name;    // node name from the JOB line
+        std::string        fname;   // description file to parse
+        node_description   nd;
+        bool               ok;
+        std::string        error;
+        std::ostringstream log;
+
+        node_parse_job (void)
+          : ok (false)
+        {
+        }
+
+        void thread_work (void)
+        {
+          std::fstream fin;
+          std::string  line;
+
+          fin.open (fname.c_str (), std::ios::in);
+
+          if ( fin.fail () )
+          {
+            error = "opening " + fname + " failed";
+            return;
+          }
+
+          try
+          {
+            // reused across lines - split_into recycles the word buffers
+            std::vector <std::string> words;
+            std::vector <std::string> env;
+
+            while ( std::getline (fin, line) )
+            {
+              std::string key = "";
+              split_into (line, words);
+
+              if ( words.size () > 2 )
+              {
+                key = words[0];
+
+                // remove keyword and '='
+                words.erase (words.begin () + 0);
+                words.erase (words.begin () + 0); // index shifted!
+              }
+
+              if ( key == "executable" )
+              {
+                log << "EXE LINE \n";
+                log << words[0] << "\n";
+
+                nd.set_attribute ("Executable", words[0]);
+              }
+
+              else if ( key == "arguments" )
+              {
+                log << "ARG LINE \n";
+
+                // remove '"' from first and last element
+                words[0]                .erase (words[0]                .begin () + 0);
+                words[words.size () - 1].erase (words[words.size () - 1].end ()   - 1);
+
+                log << "   ";
+                for ( unsigned int i = 0; i < words.size (); i++ )
+                  log << words[i] << " ";
+                log << "\n";
+
+                nd.set_vector_attribute ("Arguments", words);
+              }
+
+              else if ( key == "environment" )
+              {
+                log << "ENV LINE \n";
+
+                split_into (words[0], env, ";");
+
+                for ( unsigned int i = 0; i < env.size (); i++ )
+                  log << "   " << env[i] << "\n";
+
+                nd.set_vector_attribute ("Environment", env);
+              }
+
+              else if ( key == "input" )
+              {
+                log << "IN  LINE \n";
+                log << words[0] << "\n";
+
+                nd.set_attribute ("Input", words[0]);
+              }
+
+              else if ( key == "output" )
+              {
+                log << "OUT LINE \n";
+                log << words[0] << "\n";
+
+                nd.set_attribute ("Output", words[0]);
+              }
+
+              else if ( key == "error" )
+              {
+                log << "ERR LINE \n";
+                log << words[0] << "\n";
+
+                nd.set_attribute ("Error", words[0]);
+              }
+            }
+
+            ok = true;
+          }
+          catch ( ... )
+          {
+            error = "reading " + fname + " failed";
+          }
+        }
+    };
+
+
+    // -----------------------------------------------------------------
+    //
+    // the deferred validation pass.  parse_dag hands it a copy of the
+    // checkable bits of every node and lets it run on the worker pool,
+    // so URL resolution and executable lookup - file system and name
+    // service round trips - overlap with early scheduling instead of
+    // delaying parse-to-first-task.  Problems are warnings: the
+    // enactor produces the authoritative error when it actually runs
+    // the node.
+    //
+    class validate_job : public util::thread
+    {
+      public:
+        struct entry
+        {
+          std::string name;
+          std::string exe;
+          std::string input;
+          std::string output;
+        };
+
+        std::vector <entry> entries;
+
+        void thread_work (void)
+        {
+          for ( unsigned int i = 0; i < entries.size (); i++ )
+          {
+            const entry & e = entries[i];
+
+            if ( e.exe.empty () )
+            {
+              std::cerr << "validate: node " << e.name
+                        << " has no executable\n";
+            }
+            else if ( e.exe.find ("://") == std::string::npos )
+            {
+              // a plain absolute path should exist and be runnable
+              // here; relative paths and anything with a scheme get
+              // resolved at staging time
+              if ( e.exe[0] == '/' && 0 != ::access (e.exe.c_str (), X_OK) )
+              {
+                std::cerr << "validate: node " << e.name
+                          << ": executable " << e.exe << " not found\n";
+              }
+            }
+            else
+            {
+              check_url (e.name, "executable", e.exe);
+            }
+
+            if ( ! e.input.empty  () ) check_url (e.name, "input",  e.input);
+            if ( ! e.output.empty () ) check_url (e.name, "output", e.output);
+          }
+        }
+
+        void check_url (const std::string & name,
+                        const std::string & what,
+                        const std::string & spec)
+        {
+          try
+          {
+            saga::url u (spec);
+          }
+          catch ( saga::exception const & )
+          {
+            std::cerr << "validate: node " << name << ": " << what
+                      << " " << spec << " is not a valid url\n";
+          }
+        }
+    };
+
+
     parser::parser (const std::string & dag_file,
                     const std::string & scheduler_file)
       : dag_file_       (dag_file)
@@ -22,19 +225,34 @@ namespace digedag
 
     parser::~parser (void)
     {
+      // the validator holds copies only, but must not outlive us on
+      // the pool
+      wait_validated ();
+    }
+
+    void parser::wait_validated (void)
+    {
+      if ( validator_ )
+      {
+        validator_->thread_join ();
+        validator_.reset ();
+      }
     }
 
     void parser::parse_dag (void)
     {
       dag_ = boost::shared_ptr <dag> (new dag (scheduler_file_));
 
-      // first, we read the base dag file, and axtract the following infos:
-      //  - list of sub elements w/o cleanup and staging elements
-      //  - list of cleanup elements
-      //  - list of staging elements
+      // first, we read the base dag file, and extract the job and edge
+      // lines.  This pass is cheap - the per-job description files it
+      // references are where the parse time goes, so those are handed
+      // to the worker pool below and parsed concurrently.
       std::fstream fin;
       std::string  line;
 
+      std::vector <std::string> job_specs;
+      std::vector <std::string> edge_specs;
+
       fin.open (dag_file_.c_str (), std::ios::in);
 
       if ( fin.fail () )
@@ -43,25 +261,34 @@ namespace digedag
         throw "Cannot open file";
       }
 
-      try 
+      try
       {
+        // reused across lines - split_into recycles the word buffers
+        std::vector <std::string> words;
+
         while ( std::getline (fin, line) )
         {
-          std::vector <std::string> words = split (line);
+          split_into (line, words);
+
+          if ( words.empty () )
+          {
+            continue;
+          }
 
           if ( words[0] == "JOB" )
           {
             std::cout << "JOB LINE: " << line << std::endl;
 
-            parse_node (line);
+            job_specs.push_back (line);
           }
 
-          else if ( words[0] == "PARENT" && 
+          else if ( words[0] == "PARENT" &&
+                    words.size () > 2    &&
                     words[2] == "CHILD"  )
           {
             std::cout << "edge LINE: " << line << std::endl;
 
-            parse_edge (line);
+            edge_specs.push_back (line);
           }
         }
       }
@@ -71,121 +298,68 @@ namespace digedag
         throw "file read error";
       }
 
-      // dag_->dump ();
-    }
-
-
-    void parser::parse_node (const std::string spec)
-    {
-      std::cout << "\n";
-
-      std::vector <std::string> elems = split (spec);
-
-      std::fstream fin;
-      std::string  line;
-      std::string  name  = elems[1];
-      std::string  fname = basedir_ + elems[2];
-
-      fin.open (fname.c_str (), std::ios::in);
-
-      if ( fin.fail () )
-      {
-        std::cerr << "opening " << fname << " failed\n";
-        throw "Cannot open file";
-      }
+      // fan the description files out over the worker pool
+      std::vector <boost::shared_ptr <node_parse_job> > jobs;
 
-      try 
+      for ( unsigned int i = 0; i < job_specs.size (); i++ )
       {
-        node_description nd;
+        std::vector <std::string> elems = split (job_specs[i]);
 
-        while ( std::getline (fin, line) )
-        {
-          std::string key = "";
-          std::vector <std::string> words = split (line);
+        boost::shared_ptr <node_parse_job> j (new node_parse_job ());
 
-          if ( words.size () > 2 )
-          {
-            key = words[0];
+        j->name  = elems[1];
+        j->fname = basedir_ + elems[2];
 
-            // remove keyword and '='
-            words.erase (words.begin () + 0);
-            words.erase (words.begin () + 0); // index shifted!
-          }
-
-          if ( key == "executable" )
-          {
-            std::cout << "EXE LINE " << std::endl;
-
-            std::cout << words[0] << "\n";
-
-            nd.set_attribute ("Executable", words[0]);
-          }
-
-          else if ( key == "arguments" )
-          {
-            std::cout << "ARG LINE " << std::endl;
-
-            // remove '"' from first and last element
-            words[0]                .erase (words[0]                .begin () + 0);
-            words[words.size () - 1].erase (words[words.size () - 1].end ()   - 1);
-
-            std::cout << "   ";
-            for ( unsigned int i = 0; i < words.size (); i++ )
-              std::cout << words[i] << " ";
-            std::cout << "\n";
-
-            nd.set_vector_attribute ("Arguments", words);
-          }
-
-          else if ( key == "environment" )
-          {
-            std::cout << "ENV LINE " << std::endl;
-
-            std::vector <std::string> env = split (words[0], ";");
-
-            for ( unsigned int i = 0; i < env.size (); i++ )
-              std::cout << "   " << env[i] << "\n";
-
-            nd.set_vector_attribute ("Environment", env);
-          }
-
-          else if ( key == "input" )
-          {
-            std::cout << "IN  LINE " << std::endl;
-
-            std::cout << words[0] << "\n";
+        jobs.push_back (j);
+        j->thread_run ();
+      }
 
-            nd.set_attribute ("Input", words[0]);
-          }
+      // merge: nodes enter the dag in file order, as each parse joins.
+      // The validation copies are collected along the way.
+      boost::shared_ptr <validate_job> v (new validate_job ());
 
-          else if ( key == "output" )
-          {
-            std::cout << "OUT LINE " << std::endl;
+      for ( unsigned int i = 0; i < jobs.size (); i++ )
+      {
+        boost::shared_ptr <node_parse_job> j = jobs[i];
 
-            std::cout << words[0] << "\n";
+        j->thread_join ();
 
-            nd.set_attribute ("Output", words[0]);
-          }
+        std::cout << "\n" << j->log.str ();
 
-          else if ( key == "error" )
-          {
-            std::cout << "ERR LINE " << std::endl;
+        if ( ! j->ok )
+        {
+          std::cerr << j->error << "\n";
+          throw "file read error";
+        }
 
-            std::cout << words[0] << "\n";
+        boost::shared_ptr <node> n = dag_->create_node (j->nd);
+        dag_->add_node (j->name, n);
 
-            nd.set_attribute ("Error", words[0]);
-          }
+        validate_job::entry e;
 
-        }
+        e.name = j->name;
+        if ( j->nd.attribute_exists ("Executable") )
+          e.exe    = j->nd.get_attribute ("Executable");
+        if ( j->nd.attribute_exists ("Input") )
+          e.input  = j->nd.get_attribute ("Input");
+        if ( j->nd.attribute_exists ("Output") )
+          e.output = j->nd.get_attribute ("Output");
 
-        boost::shared_ptr <node> n = dag_->create_node (nd);
-        dag_->add_node (name, n);
+        v->entries.push_back (e);
       }
-      catch ( ... )
+
+      // edges only need the node names, which are all known now
+      for ( unsigned int i = 0; i < edge_specs.size (); i++ )
       {
-        std::cerr << "reading " << fname << " failed\n";
-        throw "file read error";
+        parse_edge (edge_specs[i]);
       }
+
+      // the dag is complete and schedulable - the expensive checks run
+      // behind it on the pool
+      validator_ = v;
+      v->thread_run ();
+
+      // dag_->dump ();
     }
 
 
@@ -193,7 +367,7 @@ namespace digedag
     {
       std::vector <std::string> elems = split (spec);
 
-      boost::shared_ptr <edge> e = dag_->create_edge ("file://localhost/TODO", 
+      boost::shared_ptr <edge> e = dag_->create_edge ("file://localhost/TODO",
                                                       "file://localhost/FIXME");
       dag_->add_edge (e, elems[1], elems[3]);
     }
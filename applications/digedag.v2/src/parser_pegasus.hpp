@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "util/split.hpp"
+#include "util/thread.hpp"
 #include "digedag.hpp"
 
 
@@ -25,8 +26,12 @@ namespace digedag
         std::string               basedir_;
         std::vector <std::string> files_;
 
+        // the expensive checks (URL resolution, executable lookup) run
+        // on the worker pool after parse_dag returned, overlapping
+        // with early scheduling - see wait_validated
+        boost::shared_ptr <util::thread> validator_;
+
         void        parse_dag  (void);
-        void        parse_node (const std::string spec);
         void        parse_edge (const std::string spec);
 
         std::string get_name   (const std::string filename);
@@ -34,14 +39,20 @@ namespace digedag
 
 
       public:
-        parser (const std::string & dag_file, 
+        parser (const std::string & dag_file,
                 const std::string & scheduler_file);
         ~parser (void);
 
-        boost::shared_ptr <dag> get_dag (void) 
-        { 
-          return dag_; 
+        boost::shared_ptr <dag> get_dag (void)
+        {
+          return dag_;
         }
+
+        // joins the deferred validation pass.  Problems are reported
+        // as warnings while the pass runs; call this (at the latest,
+        // the destructor does) when you want to be sure all node
+        // descriptions have been checked.
+        void wait_validated (void);
     };
   }
 } // namespace digedag
@@ -1,4 +1,7 @@
 
+#include <stdlib.h>
+#include <sys/time.h>
+
 #include <vector>
 #include <fstream>
 
@@ -12,14 +15,44 @@
 #include "node.hpp"
 #include "edge.hpp"
 #include "enactor.hpp"
+#include "batcher.hpp"
+#include "delegator.hpp"
+#include "memo_cache.hpp"
 #include "scheduler.hpp"
 #include "util/util.hpp"
 
-#define MAX_NODES 20
-#define MAX_EDGES 20
+// default concurrency caps and firing pool size -- all of them can be
+// overridden via 'limit' directives in the policy file (see parse_src)
+#define MAX_NODES  20
+#define MAX_EDGES  20
+#define NUM_FIRERS  4
+
+// default cap on concurrent transfers touching one storage endpoint
+// (0 = unlimited; override via 'limit transfers ...')
+#define MAX_HOST_TRANSFERS 4
+
+// initial runtime estimate (seconds) for executables we have not seen
+// complete yet, and number of completions between critical path weight
+// refreshes
+#define RUNTIME_EST_DEFAULT 1.0
+#define PRIO_REFRESH        64
+
+// modeled duration (seconds) of a real data transfer in the dry-run
+// simulator (see simulate)
+#define SIM_XFER_SECS       0.1
 
 namespace digedag
 {
+  // wallclock seconds, for runtime estimate bookkeeping
+  static double now_secs_ (void)
+  {
+    struct timeval tv;
+
+    ::gettimeofday (&tv, NULL);
+
+    return (double) tv.tv_sec + (double) tv.tv_usec / 1000000.0;
+  }
+
   scheduler::scheduler (dag               * d, 
                         const std::string & policy, 
                         saga::session       session)
@@ -28,10 +61,17 @@ namespace digedag
     , policy_        (   policy)
     , initialized_   (    false)
     , stopped_       (    false)
+    , max_host_transfers_ (MAX_HOST_TRANSFERS)
+    , batch_size_    (         1)
+    , batch_wait_ms_ (      1000)
+    , delegate_min_  (         0)
     , max_nodes_     (MAX_NODES)
     , max_edges_     (MAX_EDGES)
     , active_nodes_  (        0)
     , active_edges_  (        0)
+    , prio_stale_    (        0)
+    , prio_valid_    (    false)
+    , num_firers_    (NUM_FIRERS)
   {
     parse_src ();
   }
@@ -43,16 +83,23 @@ namespace digedag
 
     std::cout << " === scheduler destructed" << std::endl;
 
-    util::scoped_lock sl (mtx_);
-
+    // do not hold mtx_ here: the firers need it to notice stopped_
     thread_exit ();
+
+    for ( unsigned int i = 0; i < firers_.size (); i++ )
+    {
+      firers_[i]->thread_join ();
+    }
   }
 
   void scheduler::stop (void)
   {
     util::scoped_lock sl (mtx_);
-    
+
     stopped_ = true;
+
+    // wake all firers, so that they can terminate
+    cond_.notify_all ();
   }
 
   void scheduler::parse_src (void)
@@ -82,9 +129,14 @@ namespace digedag
 
     unsigned int lnum = 1;
 
+    // kept across lines: split_into reuses the strings' buffers, so
+    // parsing a large policy file is not one allocation per word
+    std::vector <std::string> words;
+    std::vector <std::string> elems;
+
     while ( std::getline (fin, line) )
     {
-      std::vector <std::string> words = split (line);
+      split_into (line, words);
 
       if ( words.size () < 1 )
       {
@@ -107,7 +159,7 @@ namespace digedag
           for ( unsigned int i = 1; i < words.size (); i++ )
           {
             // all other words, split at '='
-            std::vector <std::string> elems = split (words[i], "=", 2);
+            split_into (words[i], elems, "=", 2);
 
             if ( 0 == elems.size () )
             {
@@ -176,7 +228,138 @@ namespace digedag
           }
         }
       }
-      
+      else if ( words[0] == "limit" )
+      {
+        // concurrency limits:
+        //   limit nodes  <n>        max concurrently running nodes
+        //   limit edges  <n>        max concurrently running edges
+        //   limit firers <n>        size of the firing thread pool
+        //   limit host <host> <n>   max concurrent nodes on <host>
+        //   limit transfers <n>          default per-endpoint transfer cap
+        //   limit transfers <host> <n>   transfer cap for one endpoint
+        //   limit rate <host> <n> [<b>]  submissions per second to <host>,
+        //                                with burst capacity <b> (default n)
+        if ( words.size () == 3 && words[1] == "nodes" )
+        {
+          max_nodes_ = ::atoi (words[2].c_str ());
+        }
+        else if ( words.size () == 3 && words[1] == "edges" )
+        {
+          max_edges_ = ::atoi (words[2].c_str ());
+        }
+        else if ( words.size () == 3 && words[1] == "firers" )
+        {
+          num_firers_ = ::atoi (words[2].c_str ());
+        }
+        else if ( words.size () == 4 && words[1] == "host" )
+        {
+          host_limits_[words[2]] = ::atoi (words[3].c_str ());
+        }
+        else if ( words.size () == 3 && words[1] == "transfers" )
+        {
+          max_host_transfers_ = ::atoi (words[2].c_str ());
+        }
+        else if ( words.size () == 4 && words[1] == "transfers" )
+        {
+          xfer_limits_[words[2]] = ::atoi (words[3].c_str ());
+        }
+        else if ( ( words.size () == 4 ||
+                    words.size () == 5 ) && words[1] == "rate" )
+        {
+          token_bucket_t tb;
+
+          tb.rate  = ::atof (words[3].c_str ());
+          tb.burst = ( words.size () == 5 ) ? ::atof (words[4].c_str ())
+                                            : tb.rate;
+
+          // a bucket needs room for at least one token
+          if ( tb.burst < 1.0 )
+          {
+            tb.burst = 1.0;
+          }
+
+          if ( tb.rate <= 0.0 )
+          {
+            std::cerr << "parser error (5) in " << policy_ << " at line " << lnum << std::endl;
+          }
+          else
+          {
+            // buckets start full, so the first wave still bursts
+            tb.tokens = tb.burst;
+            tb.last   = now_secs_ ();
+
+            rate_limits_[words[2]] = tb;
+          }
+        }
+        else
+        {
+          std::cerr << "parser error (5) in " << policy_ << " at line " << lnum << std::endl;
+        }
+      }
+      else if ( words[0] == "batch" )
+      {
+        // clustered submission of ready nodes:
+        //   batch size <n>     nodes per wrapper job (1 disables batching)
+        //   batch wait <ms>    max age of a partial batch before it is
+        //                      submitted anyway
+        if ( words.size () == 3 && words[1] == "size" )
+        {
+          batch_size_ = ::atoi (words[2].c_str ());
+        }
+        else if ( words.size () == 3 && words[1] == "wait" )
+        {
+          batch_wait_ms_ = ::atoi (words[2].c_str ());
+        }
+        else
+        {
+          std::cerr << "parser error (6) in " << policy_ << " at line " << lnum << std::endl;
+        }
+      }
+      else if ( words[0] == "delegate" )
+      {
+        // hierarchical enactment of same-resource node clusters:
+        //   delegate size <n>   minimum cluster size worth a sub-dag
+        //                       handoff (below 2 disables delegation)
+        if ( words.size () == 3 && words[1] == "size" )
+        {
+          delegate_min_ = ::atoi (words[2].c_str ());
+        }
+        else
+        {
+          std::cerr << "parser error (9) in " << policy_ << " at line " << lnum << std::endl;
+        }
+      }
+      else if ( words[0] == "memoize" )
+      {
+        // 'memoize <path>': persistent node result cache.  Nodes whose
+        // command and input stamps digest to a recorded entry are
+        // skipped, reusing the outputs of the earlier run (see
+        // memo_cache.hpp).
+        if ( words.size () == 2 )
+        {
+          memo_.reset (new digedag::memo_cache (words[1]));
+        }
+        else
+        {
+          std::cerr << "parser error (7) in " << policy_ << " at line " << lnum << std::endl;
+        }
+      }
+      else if ( words[0] == "stream" )
+      {
+        // 'stream <exe>': nodes running <exe> consume their staged-in
+        // inputs as a stream.  Edges fire such nodes as soon as their
+        // transfer starts, so compute overlaps the remaining copy (see
+        // edge::work_start).
+        if ( words.size () == 2 )
+        {
+          stream_exes_.insert (words[1]);
+        }
+        else
+        {
+          std::cerr << "parser error (8) in " << policy_ << " at line " << lnum << std::endl;
+        }
+      }
+
 
       lnum++;
     }
@@ -194,6 +377,18 @@ namespace digedag
     enact_nodes_.reset (new digedag::enactor (shared_from_this (), "node"));
     enact_edges_.reset (new digedag::enactor (shared_from_this (), "edge"));
 
+    if ( batch_size_ > 1 )
+    {
+      batcher_.reset (new digedag::batcher (shared_from_this (), session_,
+                                            batch_size_, batch_wait_ms_));
+    }
+
+    if ( delegate_min_ > 1 )
+    {
+      delegator_.reset (new digedag::delegator (shared_from_this (), session_,
+                                                dag_, delegate_min_));
+    }
+
     initialized_ = true;
 
     if ( stopped_ ) 
@@ -231,13 +426,15 @@ namespace digedag
     }
 
     // walk throgh the dag, and assign execution host for nodes, and data
-    // prefixes for edges
-    std::map <node_id_t, node_map_t> nodes = dag_->get_nodes ();
-    std::map <edge_id_t, edge_map_t> edges = dag_->get_edges ();
+    // prefixes for edges.  The view holds the dag's shared graph lock
+    // for the scope of this walk: no copy of the graph is made, and the
+    // graph cannot grow under our feet.
+    dag_view view (dag_);
+    const std::vector <boost::shared_ptr <node> > & nodes = view.nodes ();
 
     // first, fix pwd and host for INPUT and OUTPUT nodes
-    boost::shared_ptr <node> input  = nodes["INPUT"];
-    boost::shared_ptr <node> output = nodes["OUTPUT"];
+    boost::shared_ptr <node> input  = dag_->get_node ("INPUT");
+    boost::shared_ptr <node> output = dag_->get_node ("OUTPUT");
 
     input->set_pwd   (data_src_pwd_);
     input->set_host  (data_src_host_);
@@ -247,14 +444,10 @@ namespace digedag
 
     // now fix all other nodes, too
     {
-      std::map <node_id_t, node_map_t> :: const_iterator it;
-      std::map <node_id_t, node_map_t> :: const_iterator begin = nodes.begin ();
-      std::map <node_id_t, node_map_t> :: const_iterator end   = nodes.end ();
-
-      for ( it = begin; it != end; it++ )
+      for ( unsigned int i = 0; i < nodes.size (); i++ )
       {
-        std::string id = it->first;
-        boost::shared_ptr <node> n  = it->second;
+        boost::shared_ptr <node> n  = nodes[i];
+        std::string              id = n->get_id ();
 
         if ( job_info_.find (id) != job_info_.end () )
         {
@@ -385,9 +578,11 @@ namespace digedag
   }
 
 
-  bool scheduler::hook_node_run_pre (boost::shared_ptr <node> n)           
+  bool scheduler::hook_node_run_pre (boost::shared_ptr <node> n)
   {
+    double t_lock = now_secs_ ();
     util::scoped_lock sl (mtx_);
+    lock_waited_ (now_secs_ () - t_lock);
 
     if ( stopped_ ) 
     {
@@ -411,16 +606,21 @@ namespace digedag
     known_nodes_.insert (n->get_name ());
 
 
-    // queue the node for work
+    // queue the node for work, and wake a firer
     queue_nodes_.push_back (n);
+    queued_at_[n->get_id ()] = now_secs_ ();
+
+    cond_.notify_one ();
 
     return true;
   }
 
 
-  bool scheduler::hook_node_run_done (boost::shared_ptr <node> n)           
+  bool scheduler::hook_node_run_done (boost::shared_ptr <node> n)
   {
+    double t_lock = now_secs_ ();
     util::scoped_lock sl (mtx_);
+    lock_waited_ (now_secs_ () - t_lock);
 
     if ( stopped_ ) 
     {
@@ -480,6 +680,47 @@ namespace digedag
   }
 
 
+  bool scheduler::streams (const std::string & cmd)
+  {
+    util::scoped_lock sl (mtx_);
+
+    if ( stream_exes_.empty () )
+    {
+      return false;
+    }
+
+    // only the first word matters, so scan it out of the command line
+    // instead of splitting the whole thing
+    line_splitter ls (cmd);
+
+    const char * tok     = NULL;
+    std::size_t  tok_len = 0;
+
+    if ( ! ls.next (&tok, &tok_len) || 0 == tok_len )
+    {
+      return false;
+    }
+
+    std::string exe (tok, tok_len);
+
+    // match both the full path and the basename of the executable
+    if ( stream_exes_.end () != stream_exes_.find (exe) )
+    {
+      return true;
+    }
+
+    std::string::size_type slash = exe.rfind ('/');
+
+    if ( slash != std::string::npos &&
+         stream_exes_.end () != stream_exes_.find (exe.substr (slash + 1)) )
+    {
+      return true;
+    }
+
+    return false;
+  }
+
+
   bool scheduler::hook_edge_run_pre (boost::shared_ptr <edge> e)           
   {
     util::scoped_lock sl (mtx_);
@@ -491,9 +732,11 @@ namespace digedag
       return false;
     }
 
-    // add edge to queue
+    // add edge to queue, and wake a firer
     queue_edges_.push_back (e);
 
+    cond_.notify_one ();
+
     std::cout << " === adding   edge to   queue: " << e->get_name () << std::endl;
 
     return true;
@@ -512,6 +755,9 @@ namespace digedag
     active_files_.erase (e->get_src ().get_string ());
     active_files_.erase (e->get_tgt ().get_string ());
 
+    // edges waiting on these files may be startable now
+    cond_.notify_one ();
+
     unlock ();
 
     // std::cout << " === egde done: " << e->get_name () << std::endl;
@@ -532,6 +778,8 @@ namespace digedag
     active_files_.erase (e->get_src ().get_string ());
     active_files_.erase (e->get_tgt ().get_string ());
 
+    cond_.notify_one ();
+
     unlock ();
 
     // FIXME: should be handled in the DAG
@@ -559,30 +807,83 @@ namespace digedag
     }
 
 
-    // work the node and edge queues:
-    // 
-    // if 
-    //  - work is in the queues  
-    //    AND
-    //  - not more than max_nodes/max_edges are running
-    // then
-    //  - start new nodes/edges, removing them from the queue
+    // spin up the firing pool.  The firers pull ready nodes and edges
+    // off the queues and start them; this thread joins the pool itself,
+    // so one firer is always accounted for.
+    {
+      util::scoped_lock sl (mtx_);
+
+      for ( int i = 1; i < num_firers_; i++ )
+      {
+        boost::shared_ptr <firer> f (new firer (this));
+
+        firers_.push_back (f);
+        f->thread_run ();
+      }
+    }
+
+    fire_work ();
+
+    std::cout << " === scheduler queue watch finished " << std::endl;
+  }
+
+
+  // workload of the firing threads.  Pull one ready node or edge off the
+  // queues, start it, and hand the resulting task to the respective
+  // enactor.  The queues are guarded by mtx_; cond_ is signaled whenever
+  // new work gets queued or capacity frees up, so instead of the old
+  // 100ms polling loop we sleep until there is something to do.  The
+  // work_start() call itself runs outside the lock, as it may block in
+  // the adaptor for a while.
+  void scheduler::fire_work (void)
+  {
     while ( true )
     {
-      // std::cout << " === scheduler queue watch begins " << std::endl;
+      boost::shared_ptr <node> n;
+      boost::shared_ptr <edge> e;
 
-      while ( max_nodes_           > active_nodes_ &&
-              queue_nodes_.size () > 0             )
       {
+        double t_lock = now_secs_ ();
         util::scoped_lock sl (mtx_);
+        lock_waited_ (now_secs_ () - t_lock);
+
+        if ( stopped_ )
+        {
+          return;
+        }
+
+        n = next_node_ ();
+
+        if ( ! n )
+        {
+          e = next_edge_ ();
+        }
 
-        // std::cout << " === scheduler is checking node queue " << std::endl;
+        if ( ! n && ! e )
+        {
+          // nothing is ready, or all resources are saturated.  Sleep
+          // until something changes (the timeout guards against missed
+          // signals).
+          util::timed_wait_ms (cond_, sl, 100);
+          continue;
+        }
+      }
 
-        // get node from queue
-        boost::shared_ptr <node> n = queue_nodes_.front ();
-        queue_nodes_.pop_front ();
+      if ( n )
+      {
+        // hierarchical enactment: whole same-resource clusters leave as
+        // one sub-dag handoff (see delegator.hpp)
+        if ( delegator_ && delegator_->accept (n) )
+        {
+          continue;
+        }
 
-        // n->dump ();
+        // clustered submission: the batcher takes batchable nodes and
+        // reports them back via batch_finished
+        if ( batcher_ && batcher_->accept (n) )
+        {
+          continue;
+        }
 
         // std::cout << " === scheduler starts node " << n->get_name () << std::endl;
         saga::task t = n->work_start ();
@@ -590,88 +891,351 @@ namespace digedag
         // FIXME: we need to verify here if the task is valid (correct state
         // etc).  Or simply catch for SAGA exceptions?
 
-        active_nodes_++;
+        {
+          util::scoped_lock sl (mtx_);
+
+          // map the task before the enactor can report it as finished
+          node_task_map_[t] = n;
+        }
 
         enact_nodes_->queue_task (t);
-        // std::cout << " === mapping task " 
-        //           << t.get_id () 
-        //           << " to node " 
-        //           << n->get_name () 
-        //           << std::endl;
+      }
+      else
+      {
+        // std::cout << " === scheduler starts edge " << e->get_name () << std::endl;
+        saga::task t = e->work_start ();
+
+        {
+          util::scoped_lock sl (mtx_);
+
+          edge_task_map_[t] = e;
+        }
+
+        enact_edges_->queue_task (t);
+      }
+    }
+  }
+
+
+  // pick the next startable node from the ready queue.  Called under
+  // lock.  Respects the global node cap, the per-host limits and the
+  // per-host submission rate buckets (the firer's timed wait doubles
+  // as the retry for rate-limited nodes), and
+  // among the fireable candidates dispatches the one with the highest
+  // critical path weight, so long chains are not starved behind bulk
+  // parallel work.
+  boost::shared_ptr <node> scheduler::next_node_ (void)
+  {
+    boost::shared_ptr <node> none;
+
+    if ( active_nodes_ >= max_nodes_ )
+    {
+      return none;
+    }
+
+    if ( ! prio_valid_ )
+    {
+      refresh_priorities_ ();
+    }
+
+    int    best_idx  = -1;
+    double best_prio = 0.0;
+
+    for ( unsigned int i = 0; i < queue_nodes_.size (); i++ )
+    {
+      boost::shared_ptr <node> n = queue_nodes_[i];
 
-        node_task_map_[t] = n;
+      std::string host = n->get_host ();
+
+      if ( host_limits_.find (host) != host_limits_.end () &&
+           host_active_[host]       >= host_limits_[host]  )
+      {
+        // this resource is full
+        continue;
+      }
+
+      if ( ! rate_ok_ (host) )
+      {
+        // submission bucket is empty: the node stays queued and waits
+        // for a token, it is not failed or bounced
+        continue;
       }
 
+      double p = priority_ (n);
 
-      while ( max_edges_           > active_edges_ &&
-              queue_edges_.size () > 0             )
+      if ( best_idx < 0 || p > best_prio )
       {
-        util::scoped_lock sl (mtx_);
+        best_idx  = (int) i;
+        best_prio = p;
+      }
+    }
 
-        // std::cout << " === scheduler is checking edge queue " << std::endl;
+    if ( best_idx < 0 )
+    {
+      return none;
+    }
+
+    boost::shared_ptr <node> n = queue_nodes_[best_idx];
+
+    queue_nodes_.erase (queue_nodes_.begin () + best_idx);
 
-        // FIXME:  
-        // At the moment, the local file adaptor is not supporting atomic
-        // operations, not even close.  So, we need to take care not to run
-        // edges concurrently which operate on the same data files (src/tgt).
-        // Thus we have a peek at the next edge, and if it does not fit the
-        // bill, it is ignored for this while iteration.
-        //
-        // Note that active_files is emptied by the scheduler
-        // edge_run_done and edge_run_failed hooks.
+    active_nodes_++;
+    host_active_[n->get_host ()]++;
+    rate_take_   (n->get_host ());
 
-        // get edge from queue
-        boost::shared_ptr <edge> e = queue_edges_.front ();
-        queue_edges_.pop_front ();
+    // note the start time, for the runtime estimate refinement
+    node_started_[n->get_id ()] = now_secs_ ();
 
-        // e->dump ();
+    // account the ready queue residence of this node
+    std::map <std::string, double>::iterator qit = queued_at_.find (n->get_id ());
+    if ( qit != queued_at_.end () )
+    {
+      double wait = node_started_[n->get_id ()] - qit->second;
+
+      stats_.ready_wait_sum += wait;
+      if ( wait > stats_.ready_wait_max ) stats_.ready_wait_max = wait;
+
+      queued_at_.erase (qit);
+    }
+    stats_.nodes_fired++;
 
-        if ( active_files_.find (e->get_src ().get_string ()) != active_files_.end () ||
-             active_files_.find (e->get_tgt ().get_string ()) != active_files_.end () )
+    return n;
+  }
+
+
+  // ---- critical path machinery, all called under lock ----
+
+  // runtime estimates are kept per executable: workflows tend to run
+  // the same programs many times, so completed instances predict the
+  // pending ones
+  std::string scheduler::exe_key_ (boost::shared_ptr <node> n)
+  {
+    std::string cmd = n->get_cmd ();
+
+    std::string::size_type pos = cmd.find (' ');
+
+    if ( pos != std::string::npos )
+    {
+      cmd = cmd.substr (0, pos);
+    }
+
+    if ( cmd.empty () )
+    {
+      cmd = n->get_id ();
+    }
+
+    return cmd;
+  }
+
+
+  double scheduler::estimate_ (boost::shared_ptr <node> n)
+  {
+    std::map <std::string, double> :: const_iterator it
+      = runtime_est_.find (exe_key_ (n));
+
+    if ( it != runtime_est_.end () )
+    {
+      return it->second;
+    }
+
+    return RUNTIME_EST_DEFAULT;
+  }
+
+
+  double scheduler::priority_ (boost::shared_ptr <node> n)
+  {
+    std::map <std::string, double> :: const_iterator it
+      = node_priority_.find (n->get_id ());
+
+    if ( it != node_priority_.end () )
+    {
+      return it->second;
+    }
+
+    return 0.0;
+  }
+
+
+  // recompute the longest-path-to-exit weight of every node, bottom up.
+  // The explicit stack keeps deep workflows from exhausting the call
+  // stack; back edges (which a proper dag does not have) are skipped.
+  void scheduler::refresh_priorities_ (void)
+  {
+    node_priority_.clear ();
+
+    if ( NULL == dag_ )
+    {
+      return;
+    }
+
+    // traverse under a read view - priority refreshes can then run
+    // while other threads update node states
+    dag_view view (dag_);
+    const std::vector <boost::shared_ptr <node> > & nodes = view.nodes ();
+
+    std::set <std::string> visiting;
+
+    for ( unsigned int i = 0; i < nodes.size (); i++ )
+    {
+      std::vector <boost::shared_ptr <node> > stack;
+
+      stack.push_back (nodes[i]);
+
+      while ( ! stack.empty () )
+      {
+        boost::shared_ptr <node> n = stack.back ();
+
+        if ( node_priority_.find (n->get_id ()) != node_priority_.end () )
         {
-          // stop handling that edge for now, and put it to the back of the queue
-          queue_edges_.push_back (e);
+          visiting.erase (n->get_id ());
+          stack.pop_back ();
           continue;
         }
 
-        // this edge is being executed - so lock src and tgt as long as it is
-        // active
+        visiting.insert (n->get_id ());
 
-        // only insert clones
-        active_files_.insert (e->get_src ().get_string ());
-        active_files_.insert (e->get_tgt ().get_string ());
+        std::vector <boost::shared_ptr <edge> > out = n->get_edges_out ();
 
-        active_edges_++;
+        bool   have_deps = true;
+        double best      = 0.0;
 
-        // std::cout << " === scheduler starts edge " << e->get_name () << std::endl;
-        saga::task t = e->work_start ();
-        
-        enact_edges_->queue_task (t);
-        
-        edge_task_map_[t] = e;
+        for ( unsigned int j = 0; j < out.size (); j++ )
+        {
+          boost::shared_ptr <node> tgt = out[j]->get_tgt_node ();
+
+          if ( ! tgt )
+          {
+            continue;
+          }
 
-        // std::cout << " === mapping task " 
-        //           << t.get_id () 
-        //           << " to edge " 
-        //           << e->get_name () 
-        //           << std::endl;
+          std::map <std::string, double> :: const_iterator it
+            = node_priority_.find (tgt->get_id ());
+
+          if ( it == node_priority_.end () )
+          {
+            if ( visiting.find (tgt->get_id ()) == visiting.end () )
+            {
+              stack.push_back (tgt);
+              have_deps = false;
+            }
+
+            // else: back edge - ignore it
+          }
+          else if ( it->second > best )
+          {
+            best = it->second;
+          }
+        }
 
-        // dump_map (edge_task_map_);
+        if ( have_deps )
+        {
+          node_priority_[n->get_id ()] = estimate_ (n) + best;
+
+          visiting.erase (n->get_id ());
+          stack.pop_back ();
+        }
       }
+    }
 
-      std::cout << " === scheduler queue watch done " << std::endl;
+    prio_valid_ = true;
+    prio_stale_ = 0;
+  }
 
-      util::ms_sleep (100);
+
+  // pick the next startable edge from the ready queue.  Called under
+  // lock.
+  //
+  // FIXME:
+  // At the moment, the local file adaptor is not supporting atomic
+  // operations, not even close.  So, we need to take care not to run
+  // edges concurrently which operate on the same data files (src/tgt).
+  // Edges whose files are busy rotate to the back of the queue.
+  //
+  // Note that active_files is emptied by the scheduler edge_run_done
+  // and edge_run_failed hooks.
+  boost::shared_ptr <edge> scheduler::next_edge_ (void)
+  {
+    boost::shared_ptr <edge> none;
+
+    if ( active_edges_ >= max_edges_ )
+    {
+      return none;
     }
 
-    std::cout << " === scheduler queue watch finished " << std::endl;
+    for ( unsigned int i = 0; i < queue_edges_.size (); i++ )
+    {
+      boost::shared_ptr <edge> e = queue_edges_.front ();
+      queue_edges_.pop_front ();
+
+      if ( active_files_.find (e->get_src ().get_string ()) != active_files_.end () ||
+           active_files_.find (e->get_tgt ().get_string ()) != active_files_.end () )
+      {
+        // stop handling that edge for now, and put it to the back of the queue
+        queue_edges_.push_back (e);
+        continue;
+      }
+
+      std::string src_host = e->get_src ().get_host ();
+      std::string tgt_host = e->get_tgt ().get_host ();
+
+      if ( endpoint_full_ (src_host) ||
+           endpoint_full_ (tgt_host) )
+      {
+        // one of the storage endpoints is at its transfer cap - try
+        // the next candidate
+        queue_edges_.push_back (e);
+        continue;
+      }
+
+      // this edge is being executed - so lock src and tgt as long as it
+      // is active
+      active_files_.insert (e->get_src ().get_string ());
+      active_files_.insert (e->get_tgt ().get_string ());
+
+      // remember the original source for the replica bookkeeping below
+      std::string src = e->get_src ().get_string ();
+
+      edge_src_[e->get_id ()] = src;
+
+      // multicast style distribution: if this file reached the target
+      // host for some earlier edge already, copy from that host-local
+      // replica instead of going back to the source endpoint
+      if ( ! src.empty () && ! tgt_host.empty () )
+      {
+        std::map <std::string, std::map <std::string, std::string> > :: iterator s
+          = staged_.find (src);
+
+        if ( s != staged_.end ()                                &&
+             s->second.find (tgt_host) != s->second.end ()      &&
+             s->second[tgt_host] != e->get_tgt ().get_string () )
+        {
+          std::cout << " === edge " << e->get_name ()
+                    << " reuses replica " << s->second[tgt_host] << std::endl;
+
+          e->get_src_url () = saga::url (s->second[tgt_host]);
+
+          src_host = tgt_host;
+        }
+      }
+
+      xfer_begin_ (src_host);
+      xfer_begin_ (tgt_host);
+
+      active_edges_++;
+
+      return e;
+    }
+
+    return none;
   }
 
-  void scheduler::work_finished (saga::task  t, 
+  void scheduler::work_finished (saga::task  t,
                                  std::string flag)
   {
     {
+      double t_lock = now_secs_ ();
       util::scoped_lock sl (mtx_);
+      lock_waited_ (now_secs_ () - t_lock);
 
       // std::cout << " === work finished for task " << t.get_id () << std::endl;
 
@@ -694,6 +1258,39 @@ namespace digedag
         n = node_task_map_[t];
 
         node_task_map_.erase (t);
+
+        if ( n )
+        {
+          host_active_[n->get_host ()]--;
+
+          // refine the runtime estimate for this executable with the
+          // observed duration (running mean), and mark the critical
+          // path weights for a refresh once enough estimates changed
+          std::map <std::string, double> :: iterator it
+            = node_started_.find (n->get_id ());
+
+          if ( it != node_started_.end () )
+          {
+            double dur = now_secs_ () - it->second;
+            node_started_.erase (it);
+
+            if ( dur >= 0.0 )
+            {
+              std::string key = exe_key_ (n);
+
+              runtime_cnt_[key]++;
+              runtime_est_[key] += (dur - runtime_est_[key]) / runtime_cnt_[key];
+
+              if ( ++prio_stale_ >= PRIO_REFRESH )
+              {
+                prio_valid_ = false;
+              }
+            }
+          }
+        }
+
+        // capacity freed up - wake a firer
+        cond_.notify_one ();
       }
       // scoped lock dies here, so that the work_done call below can call back
       // into the scheduler.
@@ -727,7 +1324,29 @@ namespace digedag
 
         e = edge_task_map_[t];
 
-        node_task_map_.erase (t);
+        edge_task_map_.erase (t);
+
+        if ( e )
+        {
+          // transfer planner bookkeeping: release the endpoints, and
+          // remember the new replica for multicast style reuse
+          xfer_end_ (e->get_src ().get_host ());
+          xfer_end_ (e->get_tgt ().get_host ());
+
+          std::string src = edge_src_[e->get_id ()];
+
+          if ( t.get_state () == saga::task::Done &&
+               ! src.empty ()                     &&
+               ! e->get_tgt ().get_host ().empty () )
+          {
+            staged_[src][e->get_tgt ().get_host ()] = e->get_tgt ().get_string ();
+          }
+
+          edge_src_.erase (e->get_id ());
+        }
+
+        // capacity freed up - wake a firer
+        cond_.notify_one ();
       }
       // scoped lock dies here, so that the work_done call below can call back
       // into the scheduler.
@@ -757,6 +1376,400 @@ namespace digedag
   }
 
 
+  // ---- transfer planner helpers, all called under lock ----
+
+  // is the endpoint at its concurrent transfer cap?
+  bool scheduler::endpoint_full_ (const std::string & host)
+  {
+    if ( host.empty () )
+    {
+      return false;
+    }
+
+    int limit = max_host_transfers_;
+
+    if ( xfer_limits_.find (host) != xfer_limits_.end () )
+    {
+      limit = xfer_limits_[host];
+    }
+
+    if ( limit <= 0 )
+    {
+      // unlimited
+      return false;
+    }
+
+    return ( xfer_active_[host] >= limit );
+  }
+
+
+  void scheduler::xfer_begin_ (const std::string & host)
+  {
+    if ( ! host.empty () )
+    {
+      xfer_active_[host]++;
+    }
+  }
+
+
+  void scheduler::xfer_end_ (const std::string & host)
+  {
+    if ( ! host.empty () )
+    {
+      xfer_active_[host]--;
+    }
+  }
+
+
+  // submission rate limiting, both called under lock.  rate_ok_ brings
+  // the host's token bucket up to date and peeks for a token;
+  // rate_take_ consumes one when a node actually gets dispatched.
+  // Hosts without a 'limit rate' directive are never limited.
+  bool scheduler::rate_ok_ (const std::string & host)
+  {
+    std::map <std::string, token_bucket_t> :: iterator it
+      = rate_limits_.find (host);
+
+    if ( it == rate_limits_.end () )
+    {
+      return true;
+    }
+
+    token_bucket_t & tb = it->second;
+
+    double now = now_secs_ ();
+
+    tb.tokens += (now - tb.last) * tb.rate;
+    tb.last    = now;
+
+    if ( tb.tokens > tb.burst )
+    {
+      tb.tokens = tb.burst;
+    }
+
+    return ( tb.tokens >= 1.0 );
+  }
+
+
+  void scheduler::rate_take_ (const std::string & host)
+  {
+    std::map <std::string, token_bucket_t> :: iterator it
+      = rate_limits_.find (host);
+
+    if ( it != rate_limits_.end () )
+    {
+      it->second.tokens -= 1.0;
+    }
+  }
+
+
+  // completion report from the batcher: all members of a clustered
+  // submission finished together.  Release their capacity under lock,
+  // then run the work_done/work_failed callbacks unlocked, as they call
+  // back into the scheduler.
+  void scheduler::batch_finished (const std::vector <boost::shared_ptr <node> > & members,
+                                  bool ok)
+  {
+    {
+      util::scoped_lock sl (mtx_);
+
+      if ( stopped_ )
+      {
+        return;
+      }
+
+      for ( unsigned int i = 0; i < members.size (); i++ )
+      {
+        active_nodes_--;
+        assert (active_nodes_ >= 0);
+
+        host_active_[members[i]->get_host ()]--;
+
+        // batched members share one wrapper job, so their individual
+        // durations are not meaningful for the runtime estimates
+        node_started_.erase (members[i]->get_id ());
+      }
+
+      // capacity freed up - wake the firers
+      cond_.notify_all ();
+    }
+
+    for ( unsigned int i = 0; i < members.size (); i++ )
+    {
+      if ( ok )
+      {
+        members[i]->work_done ();
+      }
+      else
+      {
+        members[i]->work_failed ();
+      }
+    }
+  }
+
+
+  // folds one instrumented lock acquisition into the statistics.
+  // Called right after the lock was taken, so it runs under mtx_.
+  // Anything below 10us is clock noise from the two gettimeofday
+  // calls, not contention, and is not counted as a wait.
+  void scheduler::lock_waited_ (double wait)
+  {
+    stats_.lock_acquires++;
+
+    if ( wait > 1.0e-5 )
+    {
+      stats_.lock_waits++;
+      stats_.lock_wait_sum += wait;
+      if ( wait > stats_.lock_wait_max ) stats_.lock_wait_max = wait;
+    }
+  }
+
+
+  scheduler_stats scheduler::get_stats (void)
+  {
+    util::scoped_lock sl (mtx_);
+
+    return stats_;
+  }
+
+
+  // dry-run simulator: replay the full dependency propagation of the
+  // dag as a discrete event simulation, with modeled task durations
+  // (the runtime estimates, see estimate_) and transfer times instead
+  // of real saga calls.  The simulation honors the same policy caps as
+  // the live engine (node/edge/host/transfer limits) and the same
+  // priority dispatch order, so the predicted makespan reflects the
+  // effect of a policy file without running the enactment.
+  double scheduler::simulate (void)
+  {
+    util::scoped_lock sl (mtx_);
+
+    if ( NULL == dag_ )
+    {
+      return 0.0;
+    }
+
+    // refresh priorities before opening our own view: the refresh
+    // takes a view of its own, and the graph lock is not recursive
+    refresh_priorities_ ();
+
+    dag_view view (dag_);
+    const std::vector <boost::shared_ptr <node> > & nodes = view.nodes ();
+    const std::vector <boost::shared_ptr <edge> > & edges = view.edges ();
+
+    // intern node ids, and count unsatisfied dependencies per node
+    std::map <std::string, int> idx;
+    std::vector <int>           indeg (nodes.size (), 0);
+
+    for ( unsigned int i = 0; i < nodes.size (); i++ )
+    {
+      idx[nodes[i]->get_id ()] = (int) i;
+    }
+
+    for ( unsigned int i = 0; i < edges.size (); i++ )
+    {
+      indeg[idx[edges[i]->get_tgt_node ()->get_id ()]]++;
+    }
+
+    std::map <edge_id_t, int> eidx;
+
+    for ( unsigned int i = 0; i < edges.size (); i++ )
+    {
+      eidx[edges[i]->get_id ()] = (int) i;
+    }
+
+    // simulated engine state, mirroring the live counters
+    std::vector <int>           ready_nodes;
+    std::deque  <int>           ready_edges;
+    std::map    <std::string, int> host_run;
+    std::map    <std::string, int> xfer_run;
+
+    int run_nodes = 0;
+    int run_edges = 0;
+
+    for ( unsigned int i = 0; i < nodes.size (); i++ )
+    {
+      if ( 0 == indeg[i] )
+      {
+        ready_nodes.push_back ((int) i);
+      }
+    }
+
+    // pending events, ordered by finish time ('n' node / 'e' edge)
+    std::multimap <double, std::pair <char, int> > events;
+
+    double clock    = 0.0;
+    int    done_cnt = 0;
+
+    while ( true )
+    {
+      // start ready nodes, highest critical path weight first
+      while ( run_nodes < max_nodes_ && ! ready_nodes.empty () )
+      {
+        int best_idx  = -1;
+        double best_p = 0.0;
+
+        for ( unsigned int i = 0; i < ready_nodes.size (); i++ )
+        {
+          boost::shared_ptr <node> n = nodes[ready_nodes[i]];
+
+          std::string host = n->get_host ();
+
+          if ( host_limits_.find (host) != host_limits_.end () &&
+               host_run[host]           >= host_limits_[host]  )
+          {
+            continue;
+          }
+
+          double p = priority_ (n);
+
+          if ( best_idx < 0 || p > best_p )
+          {
+            best_idx = (int) i;
+            best_p   = p;
+          }
+        }
+
+        if ( best_idx < 0 )
+        {
+          break;
+        }
+
+        int ni = ready_nodes[best_idx];
+        ready_nodes.erase (ready_nodes.begin () + best_idx);
+
+        boost::shared_ptr <node> n = nodes[ni];
+
+        double dur = n->is_void () ? 0.0 : estimate_ (n);
+
+        run_nodes++;
+        host_run[n->get_host ()]++;
+
+        events.insert (std::make_pair (clock + dur,
+                                       std::make_pair ('n', ni)));
+      }
+
+      // start ready edges, honoring the per-endpoint transfer caps
+      for ( unsigned int i = 0; run_edges < max_edges_ &&
+                                i < ready_edges.size  () ; )
+      {
+        int ei = ready_edges[i];
+
+        boost::shared_ptr <edge> e = edges[ei];
+
+        std::string src_host = e->get_src ().get_host ();
+        std::string tgt_host = e->get_tgt ().get_host ();
+
+        bool src_full = false;
+        bool tgt_full = false;
+
+        if ( ! src_host.empty () )
+        {
+          int limit = max_host_transfers_;
+          if ( xfer_limits_.find (src_host) != xfer_limits_.end () )
+            limit = xfer_limits_[src_host];
+          src_full = ( limit > 0 && xfer_run[src_host] >= limit );
+        }
+
+        if ( ! tgt_host.empty () )
+        {
+          int limit = max_host_transfers_;
+          if ( xfer_limits_.find (tgt_host) != xfer_limits_.end () )
+            limit = xfer_limits_[tgt_host];
+          tgt_full = ( limit > 0 && xfer_run[tgt_host] >= limit );
+        }
+
+        if ( src_full || tgt_full )
+        {
+          i++;
+          continue;
+        }
+
+        ready_edges.erase (ready_edges.begin () + i);
+
+        // void edges (no urls) complete instantly
+        double dur = e->get_src ().get_string ().empty () ? 0.0
+                                                          : SIM_XFER_SECS;
+
+        run_edges++;
+        if ( ! src_host.empty () ) xfer_run[src_host]++;
+        if ( ! tgt_host.empty () ) xfer_run[tgt_host]++;
+
+        events.insert (std::make_pair (clock + dur,
+                                       std::make_pair ('e', ei)));
+      }
+
+      if ( events.empty () )
+      {
+        break;
+      }
+
+      // advance the clock to the next completion
+      std::multimap <double, std::pair <char, int> > :: iterator ev
+        = events.begin ();
+
+      clock = ev->first;
+
+      char type = ev->second.first;
+      int  i    = ev->second.second;
+
+      events.erase (ev);
+      done_cnt++;
+
+      if ( 'n' == type )
+      {
+        boost::shared_ptr <node> n = nodes[i];
+
+        run_nodes--;
+        host_run[n->get_host ()]--;
+
+        // the finished node fires its outgoing edges
+        std::vector <boost::shared_ptr <edge> > out = n->get_edges_out ();
+
+        for ( unsigned int j = 0; j < out.size (); j++ )
+        {
+          ready_edges.push_back (eidx[out[j]->get_id ()]);
+        }
+      }
+      else
+      {
+        boost::shared_ptr <edge> e = edges[i];
+
+        run_edges--;
+
+        std::string src_host = e->get_src ().get_host ();
+        std::string tgt_host = e->get_tgt ().get_host ();
+
+        if ( ! src_host.empty () ) xfer_run[src_host]--;
+        if ( ! tgt_host.empty () ) xfer_run[tgt_host]--;
+
+        // the finished edge satisfies one dependency of its target
+        int ti = idx[e->get_tgt_node ()->get_id ()];
+
+        if ( 0 == --indeg[ti] )
+        {
+          ready_nodes.push_back (ti);
+        }
+      }
+    }
+
+    if ( done_cnt < (int) (nodes.size () + edges.size ()) )
+    {
+      std::cout << " === simulate: stuck after " << done_cnt << " of "
+                << (nodes.size () + edges.size ())
+                << " entities - cyclic graph or zero limits?" << std::endl;
+    }
+
+    std::cout << " === simulate: " << nodes.size () << " node(s), "
+              << edges.size ()     << " edge(s), predicted makespan "
+              << clock             << "s"
+              << " (caps: "        << max_nodes_ << " nodes, "
+              << max_edges_        << " edges)"  << std::endl;
+
+    return clock;
+  }
+
+
   void scheduler::dump_map (const std::map <saga::task, boost::shared_ptr <edge> >  & map)
   {
     util::scoped_lock sl (mtx_);
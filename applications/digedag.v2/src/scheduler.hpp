@@ -11,10 +11,12 @@
 #include "dag.hpp"
 #include "node.hpp"
 #include "edge.hpp"
+#include "stats.hpp"
 
 #include "util/mutex.hpp"
 #include "util/thread.hpp"
 #include "util/scoped_lock.hpp"
+#include "util/condition.hpp"
 
 
 namespace digedag
@@ -23,7 +25,10 @@ namespace digedag
   class node;
   class edge;
   class enactor;
-  class scheduler : public digedag::util::thread, 
+  class batcher;
+  class delegator;
+  class memo_cache;
+  class scheduler : public digedag::util::thread,
                     public util::enable_shared_from_this <scheduler>
   {
     private:
@@ -55,24 +60,135 @@ namespace digedag
       std::deque <boost::shared_ptr <node> > queue_nodes_;
       std::deque <boost::shared_ptr <edge> > queue_edges_;
 
-      std::set <std::string>                 active_files_; // see FIXME in task_run 
+      std::set <std::string>                 active_files_; // see FIXME in task_run
+
+      // transfer planner state (see next_edge_): completed transfers by
+      // source url and destination host.  When a file was already
+      // transferred to the destination host for another edge, later
+      // edges copy from that host-local replica instead of going back
+      // to the source endpoint.
+      std::map <std::string, std::map <std::string, std::string> > staged_;
+      std::map <edge_id_t, std::string>      edge_src_;     // pre-rewrite src per active edge
+
+      // per-endpoint transfer caps ('limit transfers ...'), so stage-in
+      // and stage-out phases cannot flood a single storage server
+      std::map <std::string, int>            xfer_limits_;
+      std::map <std::string, int>            xfer_active_;
+      int                                    max_host_transfers_;
 
       boost::shared_ptr <enactor>            enact_nodes_;
       boost::shared_ptr <enactor>            enact_edges_;
 
+      // clustered submission of ready nodes (see batcher.hpp).  A batch
+      // size of 1 disables batching, and nodes get submitted directly.
+      boost::shared_ptr <batcher>            batcher_;
+      int                                    batch_size_;
+      int                                    batch_wait_ms_;
+
+      // hierarchical enactment of same-resource node clusters (see
+      // delegator.hpp).  A minimum cluster size below 2 disables
+      // delegation.
+      boost::shared_ptr <delegator>          delegator_;
+      int                                    delegate_min_;
+
+      // persistent node result cache ('memoize <path>'), consulted by
+      // node::fire to skip re-runs of unchanged work (see memo_cache.hpp)
+      boost::shared_ptr <memo_cache>         memo_;
+
+      // executables marked stream-capable ('stream <exe>'): their nodes
+      // consume staged-in data as it arrives, so edges fire them when
+      // the transfer starts instead of when it completes
+      std::set <std::string>                 stream_exes_;
+
       int                                    max_nodes_;
       int                                    max_edges_;
-      
+
       int                                    active_nodes_;
       int                                    active_edges_;
 
+      // per-host concurrency limits and current usage, as set by the
+      // 'limit host <host> <n>' policy directives
+      std::map <std::string, int>            host_limits_;
+      std::map <std::string, int>            host_active_;
+
+      // per-host submission token buckets ('limit rate <host> <n> [<b>]'):
+      // every node dispatch to a host consumes one token, and the bucket
+      // refills at n tokens per second up to the burst size b.  A host
+      // with an empty bucket keeps its ready nodes queued - they wait
+      // for a token instead of flooding a shared gateway into
+      // submission timeouts.
+      struct token_bucket_t
+      {
+        double rate;    // tokens per second
+        double burst;   // bucket capacity
+        double tokens;  // current fill
+        double last;    // time of last refill
+      };
+
+      std::map <std::string, token_bucket_t> rate_limits_;
+
+      // critical path scheduling: longest-path-to-exit weight per node
+      // id, computed from per-executable runtime estimates.  The
+      // estimates start uniform and get refined online from observed
+      // completion times; the ready queue dispatches by descending
+      // weight, so the critical path is not starved by bulk work.
+      std::map <std::string, double>         node_priority_;
+      std::map <std::string, double>         runtime_est_;
+      std::map <std::string, int>            runtime_cnt_;
+      std::map <std::string, double>         node_started_;
+      int                                    prio_stale_; // completions since refresh
+      bool                                   prio_valid_;
+
+      // enactment statistics (see stats.hpp): queued_at_ remembers when
+      // a node entered the ready queue, lock_waited_ folds one
+      // instrumented lock acquisition into the counters.  Both are
+      // touched under mtx_ only.
+      scheduler_stats                        stats_;
+      std::map <std::string, double>         queued_at_;
+      void                                   lock_waited_ (double wait);
+
       std::map <saga::task, boost::shared_ptr <node> > node_task_map_;
       std::map <saga::task, boost::shared_ptr <edge> > edge_task_map_;
 
       util::mutex                            mtx_;
+      util::condition                        cond_;
       void lock                     (void) { mtx_.lock   (); };
       void unlock                   (void) { mtx_.unlock (); };
 
+      // the firer threads pull ready nodes and edges off the queues and
+      // start them.  They live inside the scheduler, so the workload
+      // method simply calls back into fire_work().
+      class firer : public digedag::util::thread
+      {
+        private:
+          scheduler * s_;
+
+        public:
+          firer (scheduler * s) : s_ (s) { }
+          void thread_work (void) { s_->fire_work (); }
+      };
+
+      friend class firer;
+
+      int                                      num_firers_;
+      std::vector <boost::shared_ptr <firer> > firers_;
+
+      boost::shared_ptr <node> next_node_ (void);
+      boost::shared_ptr <edge> next_edge_ (void);
+      void                     fire_work  (void);
+
+      bool endpoint_full_ (const std::string & host);
+      void xfer_begin_    (const std::string & host);
+      void xfer_end_      (const std::string & host);
+
+      bool rate_ok_       (const std::string & host);
+      void rate_take_     (const std::string & host);
+
+      void        refresh_priorities_ (void);
+      double      priority_ (boost::shared_ptr <node> n);
+      double      estimate_ (boost::shared_ptr <node> n);
+      std::string exe_key_  (boost::shared_ptr <node> n);
+
       // list of known nodes and edges, which helps to avoid scheduling them
       // twice.  Its actually only used for nodes right now, as edges get only
       // fired once anyway.  Nodes however can get fired multiple times.
@@ -115,9 +231,29 @@ namespace digedag
       saga::session
            hook_saga_get_session (void);
 
-      void work_finished         (saga::task  t, 
+      // the node result cache, or an empty pointer when memoization is
+      // not configured
+      boost::shared_ptr <memo_cache>
+           memo                  (void) { return memo_; }
+
+      // true when the executable of the given command line was marked
+      // stream-capable via 'stream <exe>'
+      bool streams               (const std::string & cmd);
+
+      void work_finished         (saga::task  t,
                                   std::string flag);
 
+      // dry-run simulator: predict the makespan (seconds) of the dag
+      // under the current policy without touching saga
+      double simulate            (void);
+
+      // snapshot of the enactment statistics (see stats.hpp)
+      scheduler_stats get_stats  (void);
+
+      // completion report for a whole batch of clustered nodes
+      void batch_finished        (const std::vector <boost::shared_ptr <node> > & members,
+                                  bool ok);
+
       void dump_map              (const std::map <saga::task, boost::shared_ptr <edge> >  & map);
   };
 
@@ -0,0 +1,43 @@
+#ifndef DIGEDAG_STATS_HPP
+#define DIGEDAG_STATS_HPP
+
+namespace digedag
+{
+  // enactment statistics, collected by the scheduler and snapshotted
+  // via scheduler::get_stats (or dag::get_stats).  All times are in
+  // seconds.
+  //
+  // 'ready wait' is the time a node spends between becoming ready
+  // (entering the scheduler's ready queue) and being dispatched by a
+  // firer thread - the engine's contribution to node latency.  The
+  // lock counters cover the instrumented acquisitions of the central
+  // scheduler lock on the per-node paths (enqueue, dispatch,
+  // completion); an acquisition counts as a wait when the lock was
+  // held by another thread at that moment.
+  struct scheduler_stats
+  {
+    long   nodes_fired;     // nodes dispatched by the firer threads
+
+    double ready_wait_sum;  // total ready queue residence
+    double ready_wait_max;
+
+    long   lock_acquires;   // instrumented lock acquisitions
+    long   lock_waits;      // ... of which had to wait
+    double lock_wait_sum;   // total time spent waiting
+    double lock_wait_max;
+
+    scheduler_stats (void)
+      : nodes_fired    (0)
+      , ready_wait_sum (0.0)
+      , ready_wait_max (0.0)
+      , lock_acquires  (0)
+      , lock_waits     (0)
+      , lock_wait_sum  (0.0)
+      , lock_wait_max  (0.0)
+    {
+    }
+  };
+
+} // namespace digedag
+
+#endif // DIGEDAG_STATS_HPP
@@ -0,0 +1,50 @@
+
+#ifndef DIGEDAG_UTIL_CONDITION_HPP
+#define DIGEDAG_UTIL_CONDITION_HPP
+
+#define USE_BOOST
+
+#ifdef USE_BOOST
+# include <boost/thread/condition.hpp>
+# include <boost/thread/xtime.hpp>
+#else
+# include <pthread.h>
+#endif
+
+#include "util/mutex.hpp"
+#include "util/scoped_lock.hpp"
+
+namespace digedag
+{
+  namespace util
+  {
+    // This class provides a condition variable to pair with util::mutex, so
+    // that consumers can sleep until signaled instead of polling.
+#ifdef USE_BOOST
+
+    typedef boost::condition condition;
+
+    // wait on cond for at most ms milliseconds.  Returns true when
+    // signaled, false on timeout.
+    inline bool timed_wait_ms (condition    & cond,
+                               scoped_lock  & lock,
+                               unsigned int   ms)
+    {
+      boost::xtime xt;
+      boost::xtime_get (&xt, boost::TIME_UTC);
+
+      xt.nsec += ms * 1000000;
+      xt.sec  += xt.nsec / 1000000000;
+      xt.nsec  = xt.nsec % 1000000000;
+
+      return cond.timed_wait (lock, xt);
+    }
+
+#endif // USE_BOOST
+
+  } // namespace util
+
+} // namespace digedag
+
+#endif // DIGEDAG_UTIL_CONDITION_HPP
+
@@ -0,0 +1,127 @@
+
+#ifndef DIGEDAG_UTIL_SHARED_MUTEX_HPP
+#define DIGEDAG_UTIL_SHARED_MUTEX_HPP
+
+#define USE_BOOST
+
+#ifdef USE_BOOST
+# include <boost/thread/shared_mutex.hpp>
+# include <boost/thread/locks.hpp>
+#else
+# include <pthread.h>
+#endif
+
+// FIXME: check lock call return values
+
+namespace digedag
+{
+  namespace util
+  {
+    // A reader/writer mutex in the shape of util::mutex: any number of
+    // threads may hold the shared (read) side at the same time, the
+    // exclusive (write) side is held alone.  Unlike util::mutex this
+    // lock is NOT recursive - do not re-acquire it from within a locked
+    // section.
+#ifdef USE_BOOST
+
+    typedef boost::shared_mutex                      shared_mutex;
+    typedef boost::shared_lock <boost::shared_mutex> shared_scoped_lock;
+    typedef boost::unique_lock <boost::shared_mutex> unique_scoped_lock;
+
+#else // USE_BOOST
+
+    class shared_mutex
+    {
+      private:
+        pthread_rwlock_t * mtx_;
+
+
+      public:
+        shared_mutex (void)
+        {
+          mtx_ = new pthread_rwlock_t;
+          assert (mtx_);
+          pthread_rwlock_init (mtx_, NULL);
+        }
+
+        shared_mutex (const shared_mutex & src)
+        {
+          this->mtx_ = src.mtx_;
+        }
+
+        // dtor
+        ~shared_mutex (void)
+        {
+          assert (mtx_);
+          pthread_rwlock_destroy (mtx_);
+        }
+
+        void lock (void)
+        {
+          assert (mtx_);
+          pthread_rwlock_wrlock (mtx_);
+        }
+
+        void unlock (void)
+        {
+          assert (mtx_);
+          pthread_rwlock_unlock (mtx_);
+        }
+
+        void lock_shared (void)
+        {
+          assert (mtx_);
+          pthread_rwlock_rdlock (mtx_);
+        }
+
+        void unlock_shared (void)
+        {
+          assert (mtx_);
+          pthread_rwlock_unlock (mtx_);
+        }
+    };
+
+    class shared_scoped_lock
+    {
+      private:
+        shared_mutex & mtx_;
+
+      public:
+        shared_scoped_lock (shared_mutex & mtx)
+          : mtx_ (mtx)
+        {
+          mtx_.lock_shared ();
+        }
+
+        ~shared_scoped_lock (void)
+        {
+          mtx_.unlock_shared ();
+        }
+    };
+
+    class unique_scoped_lock
+    {
+      private:
+        shared_mutex & mtx_;
+
+      public:
+        unique_scoped_lock (shared_mutex & mtx)
+          : mtx_ (mtx)
+        {
+          mtx_.lock ();
+        }
+
+        ~unique_scoped_lock (void)
+        {
+          mtx_.unlock ();
+        }
+    };
+
+#endif // USE_BOOST
+
+  } // namespace util
+
+} // namespace digedag
+
+#endif // DIGEDAG_UTIL_SHARED_MUTEX_HPP
+
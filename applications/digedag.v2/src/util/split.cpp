@@ -84,5 +84,64 @@ namespace digedag
     return list;
   }
 
+
+  void split_into (const std::string         & line,
+                   std::vector <std::string> & list,
+                   const std::string         & delim,
+                   int                         number)
+  {
+    std::size_t n = 0;  // tokens stored so far
+
+    if ( 0 != number )
+    {
+      line_splitter ls (line, delim.c_str ());
+
+      const char * tok     = NULL;
+      std::size_t  tok_len = 0;
+
+      while ( ls.next (&tok, &tok_len) )
+      {
+        if ( number > 0 && (int) n == number )
+        {
+          // concatenate the superflous elements to the last element,
+          // joined with the first delimiter char - as split () does
+          list[n - 1] += delim[0];
+          list[n - 1].append (tok, tok_len);
+          continue;
+        }
+
+        // assign into an existing slot when we have one, so its
+        // buffer gets reused
+        if ( n < list.size () )
+        {
+          list[n].assign (tok, tok_len);
+        }
+        else
+        {
+          list.push_back (std::string (tok, tok_len));
+        }
+
+        n++;
+      }
+
+      // just fill up with empty fields
+      while ( number > 0 && (int) n < number )
+      {
+        if ( n < list.size () )
+        {
+          list[n].clear ();
+        }
+        else
+        {
+          list.push_back ("");
+        }
+
+        n++;
+      }
+    }
+
+    list.resize (n);
+  }
+
 } // namespace digedag
 
@@ -2,14 +2,139 @@
 #ifndef DIGEDAG_UTIL_SPLIT_HPP
 #define DIGEDAG_UTIL_SPLIT_HPP
 
+#include <cstring>
 #include <string>
 #include <vector>
 
 namespace digedag
 {
-  std::vector <std::string> split (std::string line, 
-                                   std::string delim  = " \t", 
+  std::vector <std::string> split (std::string line,
+                                   std::string delim  = " \t",
                                    int         number = -1);
+
+  // line_splitter yields the tokens of a line one by one, as spans of
+  // the original string - no vector, no string copies.  Token
+  // boundaries match split () exactly (delimiter runs compress, a
+  // leading or trailing delimiter yields an empty token), so callers
+  // can switch between the two freely.  The spans stay valid only as
+  // long as the line does.
+  class line_splitter
+  {
+    public:
+      line_splitter (const std::string & line,
+                     const char        * delim = " \t")
+        : line_  (line.c_str ()),
+          len_   (line.size ()),
+          delim_ (delim),
+          pos_   (0),
+          start_ (true),
+          trail_ (false),
+          done_  (false)
+      {
+      }
+
+      bool next (const char ** tok, std::size_t * tok_len)
+      {
+        if ( done_ )
+        {
+          return false;
+        }
+
+        if ( start_ )
+        {
+          start_ = false;
+
+          if ( 0 == len_ )
+          {
+            // the empty line is one empty token
+            done_    = true;
+            *tok     = line_;
+            *tok_len = 0;
+            return true;
+          }
+
+          if ( is_delim_ (line_[0]) )
+          {
+            // leading delimiter run: empty first token
+            skip_delims_ ();
+            *tok     = line_;
+            *tok_len = 0;
+            return true;
+          }
+        }
+
+        if ( pos_ >= len_ )
+        {
+          if ( trail_ )
+          {
+            // trailing delimiter run: empty last token
+            trail_   = false;
+            done_    = true;
+            *tok     = line_ + len_;
+            *tok_len = 0;
+            return true;
+          }
+
+          done_ = true;
+          return false;
+        }
+
+        std::size_t start = pos_;
+
+        while ( pos_ < len_ && ! is_delim_ (line_[pos_]) )
+        {
+          pos_++;
+        }
+
+        *tok     = line_ + start;
+        *tok_len = pos_ - start;
+
+        if ( pos_ < len_ )
+        {
+          skip_delims_ ();
+        }
+
+        return true;
+      }
+
+    private:
+      bool is_delim_ (char c) const
+      {
+        return NULL != ::strchr (delim_, c);
+      }
+
+      void skip_delims_ (void)
+      {
+        while ( pos_ < len_ && is_delim_ (line_[pos_]) )
+        {
+          pos_++;
+        }
+
+        if ( pos_ >= len_ )
+        {
+          trail_ = true;
+        }
+      }
+
+      const char * line_;
+      std::size_t  len_;
+      const char * delim_;
+      std::size_t  pos_;
+      bool         start_;
+      bool         trail_;
+      bool         done_;
+  };
+
+  // split_into is the drop-in replacement for split () in per-line
+  // loops: the caller keeps one vector alive across lines and the
+  // tokens are assigned into the existing strings, so steady-state
+  // parsing reuses their buffers instead of allocating fresh ones for
+  // every line.
+  void split_into (const std::string         & line,
+                   std::vector <std::string> & list,
+                   const std::string         & delim  = " \t",
+                   int                         number = -1);
+
 } // namespace digedag
 
 #endif // DIGEDAG_UTIL_SPLIT_HPP
@@ -3,25 +3,166 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <deque>
 
 #include <saga/saga.hpp>
 
-#define DO_THREADS 
+#define DO_THREADS
+
+// idle workers above the core count retire after this many milliseconds
+#define POOL_LINGER_MS 10000
 
-namespace digedag 
+namespace digedag
 {
   namespace util
   {
+    // the shared worker pool behind the thread class.  It keeps about
+    // one worker per core alive and hands queued workloads to idle
+    // workers; only when all workers are occupied (e.g. by the long
+    // running scheduler and enactor threads) does a new worker get
+    // spawned.  Surplus idle workers retire after a linger period, so
+    // the pool settles back to its core proportional size.
+    class thread_pool
+    {
+      private:
+        pthread_mutex_t        mtx_;
+        pthread_cond_t         cond_;
+
+        std::deque <thread *>  queue_;
+
+        int                    workers_;  // workers alive
+        int                    idle_;     // workers waiting for work
+        int                    min_;      // workers we always keep
+
+
+      public:
+        thread_pool (void)
+          : workers_ (0)
+          , idle_    (0)
+        {
+          pthread_mutex_init (&mtx_,  NULL);
+          pthread_cond_init  (&cond_, NULL);
+
+          long n = ::sysconf (_SC_NPROCESSORS_ONLN);
+
+          min_ = ( n > 2 ) ? (int) n : 2;
+        }
+
+        // the singleton leaks on purpose: detached workers may still be
+        // around at exit, and must not find their pool destructed
+        static thread_pool & instance (void)
+        {
+          static thread_pool * p = new thread_pool ();
+          return *p;
+        }
+
+
+        void enqueue (thread * t)
+        {
+          pthread_mutex_lock (&mtx_);
+
+          queue_.push_back (t);
+
+          if ( 0 == idle_ )
+          {
+            // all workers are occupied - grow the pool, so that long
+            // running workloads cannot starve the queued ones
+            pthread_t      pt;
+            pthread_attr_t attr;
+
+            pthread_attr_init           (&attr);
+            pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+            if ( 0 == pthread_create (&pt, &attr, thread_startup_, this) )
+            {
+              workers_++;
+            }
+
+            pthread_attr_destroy (&attr);
+          }
+
+          pthread_cond_signal   (&cond_);
+          pthread_mutex_unlock  (&mtx_);
+        }
+
+
+        // the worker loop: pull workloads off the queue and run them.
+        // Workers beyond the core count exit when the queue stays empty
+        // for the linger period.
+        void worker_loop (void)
+        {
+          pthread_mutex_lock (&mtx_);
+
+          while ( true )
+          {
+            while ( queue_.empty () )
+            {
+              idle_++;
+
+              if ( workers_ > min_ )
+              {
+                // surplus worker - wait with a deadline, and retire on
+                // timeout
+                struct timespec ts;
+                struct timeval  tv;
+
+                ::gettimeofday (&tv, NULL);
+
+                ts.tv_sec  = tv.tv_sec  +  POOL_LINGER_MS / 1000;
+                ts.tv_nsec = tv.tv_usec * 1000
+                           + (POOL_LINGER_MS % 1000) * 1000000;
+
+                if ( ts.tv_nsec >= 1000000000 )
+                {
+                  ts.tv_sec  += 1;
+                  ts.tv_nsec -= 1000000000;
+                }
+
+                int ret = pthread_cond_timedwait (&cond_, &mtx_, &ts);
+
+                idle_--;
+
+                if ( ETIMEDOUT == ret && queue_.empty () )
+                {
+                  workers_--;
+                  pthread_mutex_unlock (&mtx_);
+                  return;
+                }
+              }
+              else
+              {
+                pthread_cond_wait (&cond_, &mtx_);
+                idle_--;
+              }
+            }
+
+            thread * t = queue_.front ();
+            queue_.pop_front ();
+
+            pthread_mutex_unlock (&mtx_);
+
+            t->thread_start ();
+
+            pthread_mutex_lock (&mtx_);
+          }
+        }
+    };
+
+
     extern "C"
     {
-      // the thread main routine, as argument to pthread_create, needs to be
+      // the worker main routine, as argument to pthread_create, needs to be
       // a C function, not a C++ member method.  Thus, we define an "C" external
-      // function here, which takes a pointer to an instance of our thread class,
-      // and calls its thread_start method.
+      // function here, which takes a pointer to the thread pool, and runs its
+      // worker loop.
       void * thread_startup_ (void * arg)
       {
-        digedag::util::thread * t = (digedag::util::thread *) arg;
-        return t->thread_start ();
+        digedag::util::thread_pool * p = (digedag::util::thread_pool *) arg;
+        p->worker_loop ();
+        return NULL;
       }
     }
 
@@ -29,8 +170,10 @@ namespace digedag
     // the c'tor does nothing than setting the state to 'New'
     thread::thread (void)
       : thread_state_ (ThreadNew)
-      , joined_       (true) // don't join threads which did not even start
+      , done_         (true) // don't wait for threads which did not even start
     {
+      pthread_mutex_init (&done_mtx_,  NULL);
+      pthread_cond_init  (&done_cond_, NULL);
     }
 
     // Note that the d'tor does not wait for the thread to finish.  Thus, we
@@ -38,7 +181,7 @@ namespace digedag
     // FIXME: a clean thread_cancel should be used.  pthread_kill has trouble if
     // the thread is owning locks.  boost.thread.kill only works for often
     // irrelevant cancelation points.
-    thread::~thread () 
+    thread::~thread ()
     {
       thread_join ();
     }
@@ -46,7 +189,7 @@ namespace digedag
 
     // called by the inheriting classes, or by other consumers, to get the
     // thread going.  If the state is not 'New', this method does nothing.
-    // Otherwise, the external "C" thread_startup_ routine is called, and state
+    // Otherwise, the workload gets queued on the shared pool, and state
     // is changed to Running.
     void thread::thread_run (void)
     {
@@ -59,32 +202,29 @@ namespace digedag
       thread_state_ = ThreadRunning;
 
 #ifdef DO_THREADS
-      if ( 0 != pthread_create (&thread_, NULL, digedag::util::thread_startup_, this) )
-      {
-        thread_state_ = ThreadFailed;
-        joined_       = true; // don't join failed threads
-        throw (strerror (errno));
-      }
-      else
       {
-        joined_       = false; // we can join the created thread later on
+        pthread_mutex_lock   (&done_mtx_);
+        done_ = false;
+        pthread_mutex_unlock (&done_mtx_);
       }
+
+      thread_pool::instance ().enqueue (this);
 #else
       thread_start ();
 #endif
     }
 
 
-    // thread_start is called by the external "C" function 'thread_startup_'
-    // defined above.  It represents the running thread, and calls thread_work,
-    // which holds the threads workload.
+    // thread_start is run by a pool worker (see worker_loop above).  It
+    // represents the running workload, and calls thread_work, which holds
+    // the threads workload.
     void * thread::thread_start (void)
     {
       try
       {
         // startup is completed - call the (custom) workload
         this->thread_work ();
-        
+
         // the thread workload is done - update state
         thread_state_ = ThreadDone;
       }
@@ -104,17 +244,19 @@ namespace digedag
         thread_state_ = ThreadFailed;
       }
 
-      // nothing more to do: close thread
-#ifdef DO_THREADS
-      pthread_exit (NULL);
-#endif
+      // nothing more to do: wake the joiners, and hand the worker back
+      // to the pool
+      pthread_mutex_lock     (&done_mtx_);
+      done_ = true;
+      pthread_cond_broadcast (&done_cond_);
+      pthread_mutex_unlock   (&done_mtx_);
 
       return NULL;
     }
 
 
     // thread_join allows to simply wait 'til the thread finishes on its own.
-    // All state setting etc is done by the thread.  
+    // All state setting etc is done by the thread.
     void thread::thread_wait (void)
     {
       thread_join ();
@@ -129,27 +271,24 @@ namespace digedag
     }
 
 
-    // allow the consumer to wait for thread completion
+    // allow the consumer to wait for thread completion.  There is no OS
+    // thread to join on - the workload runs on a pooled worker - so we
+    // wait for the completion flag instead.
     void thread::thread_join (void)
     {
-      if ( joined_ ) return;
+      pthread_mutex_lock (&done_mtx_);
 
-#ifdef DO_THREADS
-      pthread_join (thread_, NULL);
-#endif
+      while ( ! done_ )
+      {
+        pthread_cond_wait (&done_cond_, &done_mtx_);
+      }
 
-      joined_ = true;
+      pthread_mutex_unlock (&done_mtx_);
     }
 
     thread::state thread::thread_state (void)
     {
-      // reap threads at this opportunity
-      if ( thread_state_ == ThreadDone && ! joined_ )
-      {
-        thread_join ();
-      }
-
-      return thread_state_; 
+      return thread_state_;
     }
 
   } // namespace util
@@ -6,16 +6,15 @@
 
 #include <pthread.h>
 
-namespace digedag 
+namespace digedag
 {
   namespace util
   {
     extern "C"
     {
-      // the thread main routine, as argument to pthread_create, needs to be
+      // the worker main routine, as argument to pthread_create, needs to be
       // a C function, not a C++ member method.  Thus, we define an "C" external
-      // function here, which takes a pointer to an instance of our thread class,
-      // and calls its thread_start method.
+      // function here, which runs the shared worker loop of the thread pool.
       void * thread_startup_ (void * arg);
     }
 
@@ -23,6 +22,14 @@ namespace digedag
     // this class, and overloads the following method
     //   void thread_work (void)
     //
+    // Workloads do not get a dedicated OS thread anymore: thread_run
+    // enqueues the instance on a shared worker pool (see thread.cpp),
+    // which keeps about one worker per core around and reuses them, so
+    // that firing many short lived workloads does not spend its time in
+    // pthread_create.  The pool grows when all workers are occupied, so
+    // long running workloads (scheduler, enactors, ...) behave as
+    // before.  The public interface is unchanged.
+    class thread_pool;
     class thread
     {
       public:
@@ -32,15 +39,20 @@ namespace digedag
           ThreadNew       = 0,
           ThreadRunning   = 1,
           ThreadDone      = 2,
-          ThreadFailed    = 3, 
+          ThreadFailed    = 3,
           ThreadCancelled = 4
         };
 
       private:
         // state management
-        state         thread_state_;
-        pthread_t     thread_;
-        bool          joined_;
+        state           thread_state_;
+
+        // completion flag and its waiting place, for thread_join.  The
+        // workload runs on a pooled worker, so there is no pthread_t to
+        // join on - joiners wait for done_ instead.
+        bool            done_;
+        pthread_mutex_t done_mtx_;
+        pthread_cond_t  done_cond_;
 
 
       public:
@@ -50,9 +62,8 @@ namespace digedag
 
 
       private:
-        // the external "C" startup helper is a friend, so that it can
-        // run thread_start_
-        friend void * thread_startup_ (void * arg);
+        // the pool workers run thread_start_
+        friend class thread_pool;
 
       protected:
         // thread startup method, which manages the workload
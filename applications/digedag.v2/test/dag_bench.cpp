@@ -0,0 +1,236 @@
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <sys/time.h>
+
+#include "digedag.hpp"
+
+// dag_bench - workflow enactment benchmark.
+//
+// Generates parametric DAGs of void nodes (zero work, see
+// node::is_void_), enacts them, and reports what the *engine* costs:
+// per-node enactment overhead, ready queue latency, and contention on
+// the central scheduler lock (see stats.hpp).  Since the nodes do no
+// work and the edges move no data, everything measured is overhead.
+//
+//   dag_bench chain   <n>                - n nodes in a line
+//   dag_bench fan     <n>                - root -> n leaves -> sink
+//   dag_bench diamond <n>                - n stacked diamond motifs
+//   dag_bench layers  <d> <w> [<seed>]   - d layers of w nodes, each
+//                                          node with 1-3 random parents
+//                                          in the previous layer
+
+static double now_secs (void)
+{
+  struct timeval tv;
+
+  ::gettimeofday (&tv, NULL);
+
+  return double (tv.tv_sec) + double (tv.tv_usec) / 1000000.0;
+}
+
+static std::string name_of (int i)
+{
+  std::stringstream ss;
+  ss << "n_" << i;
+  return ss.str ();
+}
+
+// adds one void node to the dag, returns its shared_ptr
+static boost::shared_ptr <digedag::node>
+add_void_node (boost::shared_ptr <digedag::dag> d, int i,
+               std::vector <boost::shared_ptr <digedag::node> > & nodes)
+{
+  boost::shared_ptr <digedag::node> n = d->create_node ();
+
+  d->add_node (name_of (i), n);
+  nodes.push_back (n);
+
+  return n;
+}
+
+// adds a void (no data) dependency edge between two nodes
+static void link (boost::shared_ptr <digedag::dag>  d,
+                  boost::shared_ptr <digedag::node> src,
+                  boost::shared_ptr <digedag::node> tgt)
+{
+  boost::shared_ptr <digedag::edge> e = d->create_edge ();
+
+  d->add_edge (e, src, tgt);
+}
+
+
+static void build_chain (boost::shared_ptr <digedag::dag> d, int n)
+{
+  std::vector <boost::shared_ptr <digedag::node> > nodes;
+
+  for ( int i = 0; i < n; i++ )
+  {
+    add_void_node (d, i, nodes);
+
+    if ( i > 0 )
+    {
+      link (d, nodes[i - 1], nodes[i]);
+    }
+  }
+}
+
+static void build_fan (boost::shared_ptr <digedag::dag> d, int n)
+{
+  std::vector <boost::shared_ptr <digedag::node> > nodes;
+
+  boost::shared_ptr <digedag::node> root = add_void_node (d, 0,     nodes);
+  boost::shared_ptr <digedag::node> sink = add_void_node (d, n + 1, nodes);
+
+  for ( int i = 0; i < n; i++ )
+  {
+    boost::shared_ptr <digedag::node> leaf = add_void_node (d, i + 1, nodes);
+
+    link (d, root, leaf);
+    link (d, leaf, sink);
+  }
+}
+
+static void build_diamond (boost::shared_ptr <digedag::dag> d, int n)
+{
+  std::vector <boost::shared_ptr <digedag::node> > nodes;
+
+  // n stacked diamonds: each join is the next diamond's split
+  boost::shared_ptr <digedag::node> split = add_void_node (d, 0, nodes);
+  int id = 1;
+
+  for ( int i = 0; i < n; i++ )
+  {
+    boost::shared_ptr <digedag::node> left  = add_void_node (d, id++, nodes);
+    boost::shared_ptr <digedag::node> right = add_void_node (d, id++, nodes);
+    boost::shared_ptr <digedag::node> join  = add_void_node (d, id++, nodes);
+
+    link (d, split, left );
+    link (d, split, right);
+    link (d, left,  join );
+    link (d, right, join );
+
+    split = join;
+  }
+}
+
+static void build_layers (boost::shared_ptr <digedag::dag> d,
+                          int depth, int width, unsigned int seed)
+{
+  ::srandom (seed);
+
+  std::vector <boost::shared_ptr <digedag::node> > prev;
+  int id = 0;
+
+  for ( int l = 0; l < depth; l++ )
+  {
+    std::vector <boost::shared_ptr <digedag::node> > layer;
+
+    for ( int w = 0; w < width; w++ )
+    {
+      std::vector <boost::shared_ptr <digedag::node> > tmp;
+      boost::shared_ptr <digedag::node> n = add_void_node (d, id++, tmp);
+
+      if ( ! prev.empty () )
+      {
+        int parents = 1 + (int) (::random () % 3);
+
+        for ( int p = 0; p < parents; p++ )
+        {
+          link (d, prev[::random () % prev.size ()], n);
+        }
+      }
+
+      layer.push_back (n);
+    }
+
+    prev = layer;
+  }
+}
+
+
+int main (int argc, char** argv)
+{
+  if ( argc < 3 )
+  {
+    std::cerr << "\n\tusage: " << argv[0]
+              << " chain|fan|diamond <n>  |  layers <d> <w> [<seed>]\n"
+              << std::endl;
+    return 1;
+  }
+
+  std::string shape (argv[1]);
+
+  try
+  {
+    boost::shared_ptr <digedag::dag> d (new digedag::dag);
+
+    double t0 = now_secs ();
+
+    if      ( shape == "chain"   ) build_chain   (d, atoi (argv[2]));
+    else if ( shape == "fan"     ) build_fan     (d, atoi (argv[2]));
+    else if ( shape == "diamond" ) build_diamond (d, atoi (argv[2]));
+    else if ( shape == "layers"  )
+    {
+      if ( argc < 4 )
+      {
+        std::cerr << "layers needs <depth> <width>" << std::endl;
+        return 1;
+      }
+
+      build_layers (d, atoi (argv[2]), atoi (argv[3]),
+                    argc > 4 ? (unsigned int) atoi (argv[4]) : 42);
+    }
+    else
+    {
+      std::cerr << "unknown shape: " << shape << std::endl;
+      return 1;
+    }
+
+    double t_build = now_secs () - t0;
+
+    t0 = now_secs ();
+
+    d->fire ();
+    d->wait ();
+
+    double t_enact = now_secs () - t0;
+
+    digedag::scheduler_stats stats = d->get_stats ();
+
+    long fired = stats.nodes_fired ? stats.nodes_fired : 1;
+
+    std::cout << "\n"
+              << " dag_bench " << shape << "\n"
+              << "   nodes fired     : " << stats.nodes_fired << "\n"
+              << "   build time      : " << t_build << " s\n"
+              << "   enactment time  : " << t_enact << " s\n"
+              << "   overhead / node : " << (t_enact / fired) * 1000000.0 << " us\n"
+              << "   ready queue wait: " << (stats.ready_wait_sum / fired) * 1000000.0
+              << " us avg, " << stats.ready_wait_max * 1000000.0 << " us max\n"
+              << "   sched lock      : " << stats.lock_acquires << " acquires, "
+              << stats.lock_waits << " contended, "
+              << stats.lock_wait_sum * 1000000.0 << " us waited ("
+              << stats.lock_wait_max * 1000000.0 << " us max)\n"
+              << std::endl;
+  }
+  catch ( const char * s )
+  {
+    std::cerr << "char* exception: " << s << std::endl;
+    return 1;
+  }
+  catch ( const std::string & s )
+  {
+    std::cerr << "string exception: " << s << std::endl;
+    return 1;
+  }
+  catch ( const saga::exception & e )
+  {
+    std::cerr << "saga exception: " << e.what () << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
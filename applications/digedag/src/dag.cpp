@@ -265,12 +265,18 @@ namespace digedag
     // ### scheduler hook
     scheduler_->hook_dag_wait (this);
 
+    // the scheduler hooks call notify () whenever a node or edge
+    // reaches a final state, so we sleep on the condition and only
+    // recount states after an actual event.  The timed fallback
+    // covers notifications lost during state transitions.
     state s = get_state ();
-    while ( s != Done   && 
+    while ( s != Done   &&
             s != Failed )
     {
-      log ("dag    waiting...");
-      ::sleep (1);
+      {
+        util::scoped_lock sl (mtx_);
+        util::timed_wait_ms (cond_, sl, 1000);
+      }
       s = get_state ();
     }
 
@@ -516,6 +522,11 @@ namespace digedag
     mtx_.unlock ();
   }
 
+  void dag::notify (void)
+  {
+    cond_.notify_all ();
+  }
+
   void dag::set_scheduler (std::string s)
   {
     scheduler_->set_scheduler (s);
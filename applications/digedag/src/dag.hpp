@@ -5,6 +5,7 @@
 #include <map>
 
 #include "util/scoped_lock.hpp"
+#include "util/condition.hpp"
 
 #include "enum.hpp"
 #include "node.hpp"
@@ -40,6 +41,10 @@ namespace digedag
 
       util::mutex           mtx_;
 
+      // signaled (via notify) whenever a node or edge reaches a final
+      // state, so wait () can sleep instead of polling
+      util::condition       cond_;
+
 
     protected:
       // allow our friend, the sxheduler, full access to the dag data.
@@ -81,6 +86,7 @@ namespace digedag
       // other tools
       void  lock      (void);
       void  unlock    (void);
+      void  notify    (void);
       void  log       (std::string msg = "", 
                        bool        eol = true);
 
@@ -137,7 +137,9 @@ namespace digedag
       // the local file adaptor is not thread save if operating on the same
       // directory structure
 
-      saga::session session = scheduler_->hook_saga_get_session (dag_);
+      // the engine-wide session, by reference - no per-edge session
+      // copy, no re-established contexts
+      saga::session & session = scheduler_->hook_saga_get_session (dag_);
 
       saga::filesystem::file f_src (session, src_url_);
 
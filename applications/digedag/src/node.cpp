@@ -209,12 +209,14 @@ namespace digedag
     }
     else
     {
-      saga::session session = scheduler_->hook_saga_get_session (dag_);
-
       // not void: there is work to do
       try {
+        // the job service for our resource is shared across all nodes
+        // (see scheduler.hpp) - its session and security contexts were
+        // established once, at enactment start, so this submission
+        // pays no per-node handshake
         saga::job::description jd (nd_);
-        saga::job::service     js (session, rm_);
+        saga::job::service   & js = scheduler_->hook_saga_get_job_service (dag_, rm_);
         saga::job::job     j = js.create_job (jd);
 
         j.run  ();
@@ -354,6 +356,11 @@ namespace digedag
     rm_ = rm;
   }
 
+  std::string node::get_rm (void) const
+  {
+    return rm_;
+  }
+
 
   void node::set_host (std::string host)
   {
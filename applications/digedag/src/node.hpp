@@ -68,6 +68,7 @@ namespace digedag
       digedag::state get_state       (void);
       void            set_pwd         (std::string pwd);
       void            set_rm          (std::string rm);
+      std::string     get_rm          (void) const;
       void            set_host        (std::string host);
       void            set_path        (std::string path);
 
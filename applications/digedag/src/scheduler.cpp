@@ -13,6 +13,8 @@
 #include "edge.hpp"
 #include "scheduler.hpp"
 
+#include "../../common/profiler.hpp"
+
 #define RETRY_MAX 10
 
 namespace digedag
@@ -20,11 +22,17 @@ namespace digedag
   scheduler::scheduler (void)
     :stopped_ (false)
   {
-    pthread_mutex_t m = mtx_.get ();
   }
 
   scheduler::~scheduler (void)
   {
+    // tear down the cached per-resource job services
+    std::map <std::string, saga::job::service *> :: iterator it;
+
+    for ( it = job_services_.begin (); it != job_services_.end (); it++ )
+    {
+      delete it->second;
+    }
   }
 
   void scheduler::stop (void)
@@ -169,6 +177,8 @@ namespace digedag
     if ( stopped_ ) return;
     util::scoped_lock sl (mtx_);
 
+    profiler::scoped_timer timing ("scheduler.dag_schedule");
+
     // walk throgh the dag, and assign execution host for nodes, and data
     // prefixes for edges
     std::map <node_id_t, node_map_t> nodes = d->get_nodes ();
@@ -207,10 +217,36 @@ namespace digedag
   }
 
 
-  void scheduler::hook_dag_run_pre (digedag::dag * d)                     
+  void scheduler::hook_dag_run_pre (digedag::dag * d)
   {
     if ( stopped_ ) return;
     util::scoped_lock sl (mtx_);
+
+    profiler::scoped_timer timing ("scheduler.context_warmup");
+
+    // warm up one job service per resource the dag will touch, before
+    // any node fires.  The context handshake thus happens here, once
+    // per resource, instead of inside the first (and, before caching,
+    // every) node submission on that resource.
+    std::map <node_id_t, node_map_t> nodes = d->get_nodes ();
+
+    std::map <node_id_t, node_map_t> :: const_iterator it;
+
+    for ( it = nodes.begin (); it != nodes.end (); it++ )
+    {
+      try
+      {
+        (void) job_service_ (it->second->get_rm ());
+      }
+      catch ( const saga::exception & e )
+      {
+        // a resource we cannot reach now may still come up before its
+        // node fires - the node submission will retry, and report the
+        // error in context if it persists
+        std::cerr << "warmup for '" << it->second->get_rm ()
+                  << "' failed: " << e.what () << std::endl;
+      }
+    }
   }
 
 
@@ -249,7 +285,6 @@ namespace digedag
                                  digedag::node * n)           
   {
     if ( stopped_ ) return;
-    pthread_mutex_t m = mtx_.get ();
     util::scoped_lock sl (mtx_);
   }
 
@@ -267,14 +302,21 @@ namespace digedag
   {
     if ( stopped_ ) return;
     util::scoped_lock sl (mtx_);
+
+    // times the per-node scheduling decision (currently only lock
+    // acquisition - the baseline we want to see in the report)
+    profiler::scoped_timer timing ("scheduler.node_run_pre");
   }
 
 
   void scheduler::hook_node_run_done (digedag::dag  * d,
-                                      digedag::node * n)           
+                                      digedag::node * n)
   {
     if ( stopped_ ) return;
     util::scoped_lock sl (mtx_);
+
+    // a node reached a final state - wake whoever waits on the dag
+    d->notify ();
   }
 
 
@@ -349,10 +391,13 @@ namespace digedag
 
 
   void scheduler::hook_edge_run_done (digedag::dag  * d,
-                                      digedag::edge * e)           
+                                      digedag::edge * e)
   {
     if ( stopped_ ) return;
     util::scoped_lock sl (mtx_);
+
+    // an edge reached a final state - wake whoever waits on the dag
+    d->notify ();
   }
 
 
@@ -366,11 +411,41 @@ namespace digedag
   }
 
 
-  saga::session scheduler::hook_saga_get_session (digedag::dag  * d)
+  // hand out the engine-wide session by reference - all nodes and
+  // edges run on the same session, and the contexts added from the
+  // policy file are established exactly once
+  saga::session & scheduler::hook_saga_get_session (digedag::dag  * d)
   {
-    util::scoped_lock sl (mtx_);
     return session_;
   }
 
+
+  saga::job::service & scheduler::hook_saga_get_job_service (digedag::dag * d,
+                                                             std::string    rm)
+  {
+    util::scoped_lock sl (mtx_);
+
+    return job_service_ (rm);
+  }
+
+
+  // return the cached job service for rm, creating it on first use.
+  // Called with mtx_ held (from the hook above, or from the warmup in
+  // hook_dag_run_pre).
+  saga::job::service & scheduler::job_service_ (std::string rm)
+  {
+    std::map <std::string, saga::job::service *> :: iterator it
+      = job_services_.find (rm);
+
+    if ( it == job_services_.end () )
+    {
+      job_services_[rm] = new saga::job::service (session_, rm);
+
+      it = job_services_.find (rm);
+    }
+
+    return *(it->second);
+  }
+
 } // namespace digedag
 
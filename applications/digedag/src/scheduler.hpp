@@ -40,8 +40,21 @@ namespace digedag
 
       std::map <std::string, job_info_t> job_info_;
 
+      // the one engine-wide saga session.  All nodes and edges share
+      // it (by reference, see hook_saga_get_session), so security
+      // contexts from the policy file are established once and reused
+      // for every job submission and file copy.
       saga::session session_;
 
+      // one job service per resource manager, created on the shared
+      // session and cached for the lifetime of the scheduler.  The
+      // expensive part of a node fire - context handshake and backend
+      // connection setup - thus happens once per resource, not once
+      // per node.
+      std::map <std::string, saga::job::service *> job_services_;
+
+      saga::job::service & job_service_ (std::string rm);
+
 
     public:
       scheduler (void);
@@ -72,8 +85,10 @@ namespace digedag
       void hook_edge_run_done    (digedag::dag * d, digedag::edge * e);
       void hook_edge_run_fail    (digedag::dag * d, digedag::edge * e);
 
-      saga::session
-           hook_saga_get_session (digedag::dag * d);
+      saga::session &
+           hook_saga_get_session     (digedag::dag * d);
+      saga::job::service &
+           hook_saga_get_job_service (digedag::dag * d, std::string rm);
   };
 
 } // namespace digedag
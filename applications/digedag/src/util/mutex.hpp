@@ -2,7 +2,13 @@
 #ifndef DIGEDAG_UTIL_MUTEX_HPP
 #define DIGEDAG_UTIL_MUTEX_HPP
 
-#include <pthread.h>
+#define USE_BOOST
+
+#ifdef USE_BOOST
+# include <boost/thread/recursive_mutex.hpp>
+#else
+# include <pthread.h>
+#endif
 
 // FIXME: check mutex call return values
 
@@ -13,6 +19,12 @@ namespace digedag
     // This class provides a wrapper around a pthread mutex's, and allows to
     // lock/unlock them.  The class should be exception save, i.e. the mutex
     // gets destroyed if the classes destructor is called.
+#ifdef USE_BOOST
+    
+    typedef boost::recursive_mutex mutex;
+
+#else // USE_BOOST
+
     class mutex 
     {
       private:
@@ -23,6 +35,7 @@ namespace digedag
         mutex (void)
         {
           mtx_ = new pthread_mutex_t;
+          assert (mtx_);
           pthread_mutex_init (mtx_, NULL);
         }
 
@@ -34,16 +47,19 @@ namespace digedag
         // dtor
         ~mutex (void)
         {
+          assert (mtx_);
           pthread_mutex_destroy (mtx_);
         }
 
         void lock (void) 
         {
+          assert (mtx_);
           pthread_mutex_lock (mtx_);
         }
 
         void unlock (void) 
         {
+          assert (mtx_);
           pthread_mutex_unlock (mtx_);
         } 
 
@@ -53,6 +69,8 @@ namespace digedag
         }
     };
 
+#endif // USE_BOOST
+
   } // namespace util
 
 } // namespace digedag
@@ -1,6 +1,8 @@
 #ifndef DIGEDAG_UTIL_SCOPEDLOCK_HPP
 #define DIGEDAG_UTIL_SCOPEDLOCK_HPP
 
+#define USE_BOOST
+
 #include "util/mutex.hpp"
 
 
@@ -8,6 +10,13 @@ namespace digedag
 {
   namespace util
   {
+
+#ifdef USE_BOOST
+
+    typedef boost::recursive_mutex::scoped_lock scoped_lock;
+
+#else // USE_BOOST
+
     // This class provides a simple scoped lock, based on the
     // util::mutex class.
     class scoped_lock 
@@ -21,7 +30,7 @@ namespace digedag
           mtx_.lock ();
         }
 
-        // sometimes, the user provides its own mutex for lokking
+        // sometimes, the user provides its own mutex for locking
         scoped_lock (util::mutex & mtx)
         {
           mtx_ = mtx;
@@ -34,6 +43,8 @@ namespace digedag
         }
     };
 
+#endif // USE_BOOST
+
   } // namespace util
 
 } // namespace digedag
@@ -0,0 +1,283 @@
+
+#include "gpu_kernel.hpp"
+
+#ifdef HAVE_OPENCL
+
+#include <string.h>
+
+#include <string>
+#include <iostream>
+
+#ifdef __APPLE__
+# include <OpenCL/opencl.h>
+#else
+# include <CL/cl.h>
+#endif
+
+// one pixel per work item, same semantics as the scalar loop in
+// mandelbrot_client.cpp (non-escaping pixels count to limit + 1)
+static const char * mandel_source =
+  "#pragma OPENCL EXTENSION cl_khr_fp64 : enable                     \n"
+  "__kernel void mandel (const double c0_0,  const double c0_step,   \n"
+  "                      const double c1_0,  const double c1_step,   \n"
+  "                      const int    size_x, const int   size_y,    \n"
+  "                      const int    limit,  const double esc2,     \n"
+  "                      __global int * out)                         \n"
+  "{                                                                 \n"
+  "  int gid = get_global_id (0);                                    \n"
+  "                                                                  \n"
+  "  if ( gid >= size_x * size_y )                                   \n"
+  "    return;                                                       \n"
+  "                                                                  \n"
+  "  int x = gid / size_y;                                           \n"
+  "  int y = gid % size_y;                                           \n"
+  "                                                                  \n"
+  "  double c0 = c0_0 + x * c0_step;                                 \n"
+  "  double c1 = c1_0 + y * c1_step;                                 \n"
+  "  double z0 = 0.0;                                                \n"
+  "  double z1 = 0.0;                                                \n"
+  "                                                                  \n"
+  "  int iter;                                                       \n"
+  "                                                                  \n"
+  "  for ( iter = 0; iter <= limit; iter++ )                         \n"
+  "  {                                                               \n"
+  "    double t = z0 * z0 - z1 * z1 + c0;                            \n"
+  "                                                                  \n"
+  "    z1 = 2.0 * z0 * z1 + c1;                                      \n"
+  "    z0 = t;                                                       \n"
+  "                                                                  \n"
+  "    if ( z0 * z0 + z1 * z1 > esc2 )                               \n"
+  "      break;                                                      \n"
+  "  }                                                               \n"
+  "                                                                  \n"
+  "  out[gid] = iter;                                                \n"
+  "}                                                                 \n";
+
+
+// lazily initialized device state.  The client computes boxes one at
+// a time, so no locking is needed here.
+namespace
+{
+  bool              gpu_tried   = false;
+  bool              gpu_ok      = false;
+
+  cl_context        gpu_ctx     = NULL;
+  cl_command_queue  gpu_queue   = NULL;
+  cl_kernel         gpu_kernel  = NULL;
+
+  // pinned result buffer, grown on demand
+  cl_mem            gpu_out     = NULL;
+  size_t            gpu_out_cap = 0;
+
+
+  bool gpu_init (void)
+  {
+    if ( gpu_tried )
+    {
+      return gpu_ok;
+    }
+
+    gpu_tried = true;
+
+    cl_platform_id platform;
+    cl_device_id   device;
+    cl_int         err;
+
+    if ( CL_SUCCESS != clGetPlatformIDs (1, &platform, NULL) )
+    {
+      return false;
+    }
+
+    if ( CL_SUCCESS != clGetDeviceIDs (platform, CL_DEVICE_TYPE_GPU,
+                                       1, &device, NULL) )
+    {
+      return false;
+    }
+
+    // the iteration needs doubles - a deep zoom exhausts floats long
+    // before it gets interesting
+    char exts[4096] = "";
+
+    clGetDeviceInfo (device, CL_DEVICE_EXTENSIONS,
+                     sizeof (exts) - 1, exts, NULL);
+
+    if ( NULL == ::strstr (exts, "cl_khr_fp64") )
+    {
+      std::cerr << "gpu: device has no double support - ignored" << std::endl;
+      return false;
+    }
+
+    gpu_ctx = clCreateContext (NULL, 1, &device, NULL, NULL, &err);
+
+    if ( CL_SUCCESS != err )
+    {
+      return false;
+    }
+
+    gpu_queue = clCreateCommandQueue (gpu_ctx, device, 0, &err);
+
+    if ( CL_SUCCESS != err )
+    {
+      return false;
+    }
+
+    cl_program program = clCreateProgramWithSource (gpu_ctx, 1,
+                                                    &mandel_source,
+                                                    NULL, &err);
+
+    if ( CL_SUCCESS != err )
+    {
+      return false;
+    }
+
+    if ( CL_SUCCESS != clBuildProgram (program, 1, &device,
+                                       NULL, NULL, NULL) )
+    {
+      char log[8192] = "";
+
+      clGetProgramBuildInfo (program, device, CL_PROGRAM_BUILD_LOG,
+                             sizeof (log) - 1, log, NULL);
+
+      std::cerr << "gpu: kernel build failed:\n" << log << std::endl;
+
+      return false;
+    }
+
+    gpu_kernel = clCreateKernel (program, "mandel", &err);
+
+    if ( CL_SUCCESS != err )
+    {
+      return false;
+    }
+
+    gpu_ok = true;
+
+    return true;
+  }
+
+
+  // make sure the pinned result buffer holds 'bytes'
+  bool gpu_out_reserve (size_t bytes)
+  {
+    if ( gpu_out != NULL && gpu_out_cap >= bytes )
+    {
+      return true;
+    }
+
+    if ( gpu_out != NULL )
+    {
+      clReleaseMemObject (gpu_out);
+      gpu_out     = NULL;
+      gpu_out_cap = 0;
+    }
+
+    cl_int err;
+
+    // ALLOC_HOST_PTR pins the buffer, so the readback below is a DMA
+    // into mappable memory, not a bounce through pageable heap
+    gpu_out = clCreateBuffer (gpu_ctx,
+                              CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR,
+                              bytes, NULL, &err);
+
+    if ( CL_SUCCESS != err )
+    {
+      gpu_out = NULL;
+      return false;
+    }
+
+    gpu_out_cap = bytes;
+
+    return true;
+  }
+}
+
+
+bool gpu::available (void)
+{
+  return gpu_init ();
+}
+
+
+bool gpu::compute_box (double   c0_0,
+                       double   c0_step,
+                       double   c1_0,
+                       double   c1_step,
+                       int      size_x,
+                       int      size_y,
+                       int      limit,
+                       double   esc2,
+                       int    * iters)
+{
+  if ( ! gpu_init () )
+  {
+    return false;
+  }
+
+  size_t pixels = (size_t) size_x * (size_t) size_y;
+  size_t bytes  = pixels * sizeof (cl_int);
+
+  if ( ! gpu_out_reserve (bytes) )
+  {
+    return false;
+  }
+
+  if ( CL_SUCCESS != clSetKernelArg (gpu_kernel, 0, sizeof (cl_double), &c0_0   ) ||
+       CL_SUCCESS != clSetKernelArg (gpu_kernel, 1, sizeof (cl_double), &c0_step) ||
+       CL_SUCCESS != clSetKernelArg (gpu_kernel, 2, sizeof (cl_double), &c1_0   ) ||
+       CL_SUCCESS != clSetKernelArg (gpu_kernel, 3, sizeof (cl_double), &c1_step) ||
+       CL_SUCCESS != clSetKernelArg (gpu_kernel, 4, sizeof (cl_int)   , &size_x ) ||
+       CL_SUCCESS != clSetKernelArg (gpu_kernel, 5, sizeof (cl_int)   , &size_y ) ||
+       CL_SUCCESS != clSetKernelArg (gpu_kernel, 6, sizeof (cl_int)   , &limit  ) ||
+       CL_SUCCESS != clSetKernelArg (gpu_kernel, 7, sizeof (cl_double), &esc2   ) ||
+       CL_SUCCESS != clSetKernelArg (gpu_kernel, 8, sizeof (cl_mem)   , &gpu_out) )
+  {
+    return false;
+  }
+
+  // round the global size up to a friendly multiple; the kernel
+  // discards the overhang
+  size_t global = (pixels + 63) / 64 * 64;
+
+  if ( CL_SUCCESS != clEnqueueNDRangeKernel (gpu_queue, gpu_kernel,
+                                             1, NULL, &global, NULL,
+                                             0, NULL, NULL) )
+  {
+    return false;
+  }
+
+  cl_int err;
+
+  void * mapped = clEnqueueMapBuffer (gpu_queue, gpu_out, CL_TRUE,
+                                      CL_MAP_READ, 0, bytes,
+                                      0, NULL, NULL, &err);
+
+  if ( CL_SUCCESS != err || NULL == mapped )
+  {
+    return false;
+  }
+
+  ::memcpy (iters, mapped, bytes);
+
+  clEnqueueUnmapMemObject (gpu_queue, gpu_out, mapped, 0, NULL, NULL);
+  clFinish                (gpu_queue);
+
+  return true;
+}
+
+#else // HAVE_OPENCL
+
+// no OpenCL at build time - the client always takes the CPU path
+
+bool gpu::available (void)
+{
+  return false;
+}
+
+bool gpu::compute_box (double, double, double, double,
+                       int, int, int, double, int *)
+{
+  return false;
+}
+
+#endif // HAVE_OPENCL
+
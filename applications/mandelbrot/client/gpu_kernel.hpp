@@ -0,0 +1,42 @@
+
+#ifndef SAGA_MANDELBROT_GPU_KERNEL_HPP
+#define SAGA_MANDELBROT_GPU_KERNEL_HPP
+
+// optional GPU backend for the iteration kernel (OpenCL).
+//
+// The GPU path sits behind the same box-compute contract as the
+// scalar/SSE2 loop in mandelbrot_client.cpp: it fills the box' iters
+// array (row major, non-escaping pixels count to limit + 1) and
+// reports success - on any failure (no OpenCL at build time, no GPU,
+// no fp64 support, runtime error) it returns false and the caller
+// falls back to the CPU workers.
+//
+// Selection is per endpoint: pass 'gpu' via the endpoint's args key
+// in mandelbrot_backend.ini, like the awol/lazy/joke test commands.
+//
+// Results come back through a pinned (CL_MEM_ALLOC_HOST_PTR) buffer,
+// so the device-to-host copy runs as DMA instead of a bounce through
+// pageable memory.
+
+namespace gpu
+{
+  // true if a usable GPU device (with double precision) exists.
+  // First call initializes the device; cheap afterwards.
+  bool available (void);
+
+  // compute one box: C = (c0_0 + x * c0_step, c1_0 + y * c1_step),
+  // results into iters[size_x * size_y].  False on any failure -
+  // nothing was written then, compute the box on the CPU.
+  bool compute_box (double   c0_0,
+                    double   c0_step,
+                    double   c1_0,
+                    double   c1_step,
+                    int      size_x,
+                    int      size_y,
+                    int      limit,
+                    double   esc2,
+                    int    * iters);
+}
+
+#endif // SAGA_MANDELBROT_GPU_KERNEL_HPP
+
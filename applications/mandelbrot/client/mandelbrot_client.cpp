@@ -1,4 +1,16 @@
 
+#include <sys/time.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
 #include <string>
 #include <complex>
 #include <sstream>
@@ -7,9 +19,12 @@
 #include <saga/saga.hpp>
 #include <saga/saga/adaptors/utils.hpp>
 
+#include "../../common/sharded_dir.hpp"
+
 #include "../version.hpp"
+#include "gpu_kernel.hpp"
 
-namespace util 
+namespace util
 {
   std::string itoa (int i)
   {
@@ -19,6 +34,644 @@ namespace util
 
     return ss.str ();
   }
+
+  // queue one half of a split box as a fresh work item (see the
+  // adaptive splitting below)
+  void queue_child (sharded_dir::directory  & queue_dir,
+                    std::string               name,
+                    std::string               boxnum_s,
+                    int                       off_x,
+                    int                       off_y,
+                    int                       size_x,
+                    int                       size_y)
+  {
+    saga::advert::entry child = queue_dir.open (name,
+                                                saga::advert::Create    |
+                                                saga::advert::ReadWrite );
+
+    child.set_attribute ("name"  , name);
+    child.set_attribute ("boxnum", boxnum_s);
+    child.set_attribute ("off_x" , util::itoa (off_x ));
+    child.set_attribute ("off_y" , util::itoa (off_y ));
+    child.set_attribute ("size_x", util::itoa (size_x));
+    child.set_attribute ("size_y", util::itoa (size_y));
+    child.set_attribute ("state" , "work");
+  }
+
+
+  // send one finished box to the master as a binary frame (see the
+  // master's stream_listen for the frame layout: all integers network
+  // byte order, payload length first).  Returns false when the channel
+  // fails - the caller then falls back to the advert data attribute.
+  bool send_frame (std::string               stream_url,
+                   std::string               name,
+                   const std::vector <int> & counts)
+  {
+    try
+    {
+      uint32_t name_len = name.size ();
+      uint32_t count    = counts.size ();
+
+      std::vector <char> buf (4 + 4 + name_len + 4 + 4 * count);
+
+      char * p = &buf[0];
+
+      *(uint32_t *) p = htonl (4 + name_len + 4 + 4 * count);  p += 4;
+      *(uint32_t *) p = htonl (name_len);                      p += 4;
+
+      ::memcpy (p, name.c_str (), name_len);                   p += name_len;
+
+      *(uint32_t *) p = htonl (count);                         p += 4;
+
+      for ( uint32_t i = 0; i < count; i++ )
+      {
+        *(uint32_t *) p = htonl ((uint32_t) counts[i]);        p += 4;
+      }
+
+      saga::stream::stream s (stream_url);
+
+      s.connect ();
+
+      unsigned int sent = 0;
+
+      while ( sent < buf.size () )
+      {
+        saga::ssize_t n = s.write (saga::buffer (&buf[sent],
+                                                 buf.size () - sent),
+                                   buf.size () - sent);
+
+        if ( n <= 0 )
+        {
+          return false;
+        }
+
+        sent += n;
+      }
+
+      s.close ();
+
+      return true;
+    }
+    catch ( saga::exception const & )
+    {
+      return false;
+    }
+  }
+
+
+  // read exactly 'want' bytes off the stream (it may deliver less per
+  // call); false on error or connection close
+  bool read_exact (saga::stream::stream & s, char * buf, unsigned int want)
+  {
+    unsigned int got = 0;
+
+    while ( got < want )
+    {
+      saga::ssize_t n = s.read (saga::buffer (buf + got, want - got), want - got);
+
+      if ( n <= 0 )
+      {
+        return false;
+      }
+
+      got += n;
+    }
+
+    return true;
+  }
+
+
+  // write the full buffer onto the stream; false on error
+  bool write_exact (saga::stream::stream & s, char * buf, unsigned int len)
+  {
+    unsigned int sent = 0;
+
+    while ( sent < len )
+    {
+      saga::ssize_t n = s.write (saga::buffer (buf + sent, len - sent),
+                                 len - sent);
+
+      if ( n <= 0 )
+      {
+        return false;
+      }
+
+      sent += n;
+    }
+
+    return true;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//
+// the iteration kernel.  Rows of a box are computed in parallel by one
+// worker thread per core, and each row is iterated two pixels at a time
+// in SSE2 double lanes where available (that is baseline on x86-64; set
+// SAGA_MANDELBROT_NOSIMD to force the scalar path).  The workers pull
+// rows off a shared counter, so imbalanced rows do not idle any core.
+//
+namespace kernel
+{
+  // one box worth of work, shared between the worker threads
+  struct box_job
+  {
+    // geometry mapping: row x, pixel y iterates C = (c0, c1) with
+    //   c0 = c0_0 + x * c0_step
+    //   c1 = c1_0 + y * c1_step
+    // (the steps are negative for mirrored 'joke' boxes)
+    double         c0_0;
+    double         c0_step;
+    double         c1_0;
+    double         c1_step;
+
+    int            size_x;
+    int            size_y;
+    int            limit;
+    double         esc2;      // escape * escape, to save the sqrt
+    bool           simd;
+
+    int          * iters;     // size_x * size_y results, row major
+
+    volatile int   next_row;  // shared row counter
+    volatile int   rows_done;
+    volatile int   abort_;    // set to stop early (box gets split)
+  };
+
+
+  // scalar iteration of one pixel - same semantics as the old
+  // std::complex loop: non-escaping pixels count to limit + 1
+  inline int iterate_scalar (double c0, double c1, int limit, double esc2)
+  {
+    double z0 = 0.0;
+    double z1 = 0.0;
+
+    int iter;
+
+    for ( iter = 0; iter <= limit; iter++ )
+    {
+      double t = z0 * z0 - z1 * z1 + c0;
+
+      z1 = 2.0 * z0 * z1 + c1;
+      z0 = t;
+
+      if ( z0 * z0 + z1 * z1 > esc2 )
+        break;
+    }
+
+    return iter;
+  }
+
+
+#ifdef __SSE2__
+  // iterate two pixels concurrently in the two double lanes of an SSE2
+  // register.  Escaped lanes keep their iteration count via masked
+  // blending; the loop ends when both lanes escaped, or at the limit.
+  inline void iterate_pair_sse2 (double c0,  double c1a, double c1b,
+                                 int  limit, double esc2,
+                                 int * out_a, int * out_b)
+  {
+    __m128d cr      = _mm_set1_pd  (c0);
+    __m128d ci      = _mm_set_pd   (c1b, c1a);
+    __m128d zr      = _mm_setzero_pd ();
+    __m128d zi      = _mm_setzero_pd ();
+    __m128d esc     = _mm_set1_pd  (esc2);
+    __m128d escaped = _mm_setzero_pd ();             // per lane: escaped yet?
+    __m128d result  = _mm_set1_pd  ((double) (limit + 1));
+
+    for ( int iter = 0; iter <= limit; iter++ )
+    {
+      // z = z * z + c
+      __m128d t = _mm_add_pd (_mm_sub_pd (_mm_mul_pd (zr, zr),
+                                          _mm_mul_pd (zi, zi)), cr);
+
+      zi = _mm_add_pd (_mm_mul_pd (_mm_set1_pd (2.0),
+                                   _mm_mul_pd (zr, zi)), ci);
+      zr = t;
+
+      __m128d mag   = _mm_add_pd (_mm_mul_pd (zr, zr),
+                                  _mm_mul_pd (zi, zi));
+
+      // lanes which escape in this very iteration record 'iter'
+      __m128d now   = _mm_cmpgt_pd  (mag, esc);
+      __m128d newly = _mm_andnot_pd (escaped, now);
+
+      result  = _mm_or_pd (_mm_andnot_pd (newly, result),
+                           _mm_and_pd    (newly, _mm_set1_pd ((double) iter)));
+      escaped = _mm_or_pd (escaped, now);
+
+      if ( 0x3 == _mm_movemask_pd (escaped) )
+        break;
+    }
+
+    double res[2];
+    _mm_storeu_pd (res, result);
+
+    *out_a = (int) res[0];
+    *out_b = (int) res[1];
+  }
+#endif // __SSE2__
+
+
+  // compute one full row of the box
+  inline void iterate_row (const box_job * job, int x)
+  {
+    double c0  = job->c0_0 + x * job->c0_step;
+    int  * out = job->iters + x * job->size_y;
+
+    int y = 0;
+
+#ifdef __SSE2__
+    if ( job->simd )
+    {
+      for ( ; y + 1 < job->size_y; y += 2 )
+      {
+        iterate_pair_sse2 (c0,
+                           job->c1_0 +  y      * job->c1_step,
+                           job->c1_0 + (y + 1) * job->c1_step,
+                           job->limit, job->esc2,
+                           &out[y], &out[y + 1]);
+      }
+    }
+#endif // __SSE2__
+
+    for ( ; y < job->size_y; y++ )
+    {
+      out[y] = iterate_scalar (c0, job->c1_0 + y * job->c1_step,
+                               job->limit, job->esc2);
+    }
+  }
+
+
+  extern "C"
+  {
+    // worker thread main: pull rows until the box is done, or aborted
+    void * box_worker (void * arg)
+    {
+      box_job * job = (box_job *) arg;
+
+      while ( ! job->abort_ )
+      {
+        int x = __sync_fetch_and_add (&job->next_row, 1);
+
+        if ( x >= job->size_x )
+          break;
+
+        iterate_row (job, x);
+
+        __sync_fetch_and_add (&job->rows_done, 1);
+      }
+
+      return NULL;
+    }
+  }
+
+
+  // drive one box job through the kernel: the GPU backend first when
+  // selected (it computes the whole box in one launch - no row
+  // progress to watch, so no splitting), else one CPU worker per core,
+  // with the split clock watching the row progress.  Returns the
+  // compute time in ms; a true *aborted means the box exceeded
+  // split_ms and should be split (the iteration data is partial then).
+  long run_box (box_job & job, bool use_gpu, int split_ms, bool * aborted)
+  {
+    struct timeval tv_start;
+    ::gettimeofday (&tv_start, NULL);
+
+    bool gpu_done = false;
+
+    if ( use_gpu )
+    {
+      gpu_done = gpu::compute_box (job.c0_0, job.c0_step,
+                                   job.c1_0, job.c1_step,
+                                   job.size_x, job.size_y,
+                                   job.limit, job.esc2,
+                                   job.iters);
+
+      if ( gpu_done )
+      {
+        job.rows_done = job.size_x;
+      }
+    }
+
+    if ( ! gpu_done )
+    {
+      // one worker per core
+      int nthreads = (int) ::sysconf (_SC_NPROCESSORS_ONLN);
+
+      if ( nthreads < 1 )
+      {
+        nthreads = 1;
+      }
+
+      std::vector <pthread_t> tids (nthreads);
+
+      for ( int t = 0; t < nthreads; t++ )
+      {
+        if ( 0 != ::pthread_create (&tids[t], NULL,
+                                    kernel::box_worker, &job) )
+        {
+          tids[t] = pthread_t ();
+          nthreads = t;
+          break;
+        }
+      }
+
+      if ( 0 == nthreads )
+      {
+        // no workers - compute inline
+        kernel::box_worker (&job);
+      }
+
+      // watch the clock while the workers crunch - expensive boxes
+      // get aborted and split
+      bool can_split = ( split_ms > 0 && ( job.size_x >= 32 ||
+                                           job.size_y >= 32 ) );
+
+      while ( can_split && job.rows_done < job.size_x && ! job.abort_ )
+      {
+        struct timeval tv_now;
+        ::gettimeofday (&tv_now, NULL);
+
+        long elapsed_ms = (tv_now.tv_sec  - tv_start.tv_sec ) * 1000
+                        + (tv_now.tv_usec - tv_start.tv_usec) / 1000;
+
+        if ( elapsed_ms > split_ms )
+        {
+          job.abort_ = 1;
+        }
+        else
+        {
+          ::usleep (10000);
+        }
+      }
+
+      for ( int t = 0; t < nthreads; t++ )
+      {
+        ::pthread_join (tids[t], NULL);
+      }
+    }
+
+    *aborted = ( job.rows_done < job.size_x );
+
+    struct timeval tv_end;
+    ::gettimeofday (&tv_end, NULL);
+
+    return (tv_end.tv_sec  - tv_start.tv_sec ) * 1000
+         + (tv_end.tv_usec - tv_start.tv_usec) / 1000;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//
+// streaming work mode: one persistent connection to the master, over
+// which box geometries arrive and results leave as length-prefixed
+// frames (all integers network byte order, payload length first):
+//
+//   hello  :  the client's job number (sent once, on connect)
+//   work   :  u32 name len, name, 5 * i32 (boxnum, off_x, off_y,
+//             size_x, size_y); a zero name length drains the client
+//   result :  u32 name len, name, u32 status, u32 cost ms, then
+//             status 0 (done) : u32 count, count * i32 iterations
+//             status 1 (split): 8 * i32, the two child geometries
+//
+// The master keeps a small window of boxes in flight per connection,
+// so the next box is already queued behind the current one - per-box
+// overhead is one frame each way, instead of two advert round trips.
+// Returns false when the channel could not be established; the caller
+// then falls back to the advert queue.
+//
+static bool stream_work (std::string work_url,
+                         std::string job_id,
+                         std::string cmd,
+                         bool        use_gpu,
+                         int         split_ms,
+                         double      plane_x_0,
+                         double      plane_y_0,
+                         double      plane_box_step_x,
+                         double      plane_box_step_y,
+                         int         limit,
+                         int         escap)
+{
+  saga::stream::stream s;
+
+  try
+  {
+    s = saga::stream::stream (work_url);
+
+    s.connect ();
+
+    // hello: identify ourselves by job number
+    uint32_t id_len = job_id.size ();
+
+    std::vector <char> hello (4 + id_len);
+
+    *(uint32_t *) &hello[0] = htonl (id_len);
+
+    ::memcpy (&hello[4], job_id.c_str (), id_len);
+
+    if ( ! util::write_exact (s, &hello[0], hello.size ()) )
+    {
+      return false;
+    }
+  }
+  catch ( saga::exception const & )
+  {
+    return false;
+  }
+
+  std::cout << "client: work stream connected" << std::endl;
+
+  try
+  {
+    while ( true )
+    {
+      // next work frame
+      uint32_t len_n;
+
+      if ( ! util::read_exact (s, (char *) &len_n, 4) )
+      {
+        break;
+      }
+
+      uint32_t len = ntohl (len_n);
+
+      if ( len < 4 || len > 4096 )
+      {
+        break;
+      }
+
+      std::vector <char> payload (len);
+
+      if ( ! util::read_exact (s, &payload[0], len) )
+      {
+        break;
+      }
+
+      uint32_t name_len = ntohl (*(uint32_t *) &payload[0]);
+
+      if ( 0 == name_len )
+      {
+        // drained - the run is complete
+        std::cout << "client: work stream drained - exit" << std::endl;
+        break;
+      }
+
+      if ( 4 + name_len + 20 > len )
+      {
+        break;
+      }
+
+      std::string name (&payload[4], name_len);
+
+      char * p = &payload[4 + name_len];
+
+      int boxnum   = (int) ntohl (*(uint32_t *) p);  p += 4;
+      int off_px_x = (int) ntohl (*(uint32_t *) p);  p += 4;
+      int off_px_y = (int) ntohl (*(uint32_t *) p);  p += 4;
+      int size_x   = (int) ntohl (*(uint32_t *) p);  p += 4;
+      int size_y   = (int) ntohl (*(uint32_t *) p);  p += 4;
+
+      if ( size_x <= 0 || size_y <= 0 )
+      {
+        break;
+      }
+
+      std::cout << " boxnum           : " << boxnum
+                << " ("  << off_px_x << ", "  << off_px_y
+                << " / " << size_x   << "x"   << size_y
+                << ")"   << std::endl;
+
+      // set up the iteration kernel job - the same plane mapping the
+      // advert path uses
+      std::vector <int> iters (size_x * size_y, 0);
+
+      kernel::box_job job;
+
+      job.c0_0    = plane_x_0 + off_px_x * plane_box_step_x;
+      job.c0_step = plane_box_step_x;
+      job.c1_0    = plane_y_0 + off_px_y * plane_box_step_y;
+      job.c1_step = plane_box_step_y;
+
+      if ( cmd == "joke" )
+      {
+        // mirror box :-P
+        job.c0_0    = job.c0_0 + size_x * plane_box_step_x;
+        job.c0_step = -plane_box_step_x;
+        job.c1_0    = job.c1_0 + size_y * plane_box_step_y;
+        job.c1_step = -plane_box_step_y;
+      }
+
+      job.size_x    = size_x;
+      job.size_y    = size_y;
+      job.limit     = limit;
+      job.esc2      = (double) escap * (double) escap;
+      job.simd      = (NULL == ::getenv ("SAGA_MANDELBROT_NOSIMD"));
+      job.iters     = &iters[0];
+      job.next_row  = 0;
+      job.rows_done = 0;
+      job.abort_    = 0;
+
+      bool split   = false;
+      long cost_ms = kernel::run_box (job, use_gpu, split_ms, &split);
+
+      if ( split )
+      {
+        // too expensive - report the halves, split along the larger
+        // dimension; the master adopts them into its work queue
+        std::cout << " splitting box    : " << name
+                  << " (" << cost_ms << "ms)" << std::endl;
+
+        int a[4]; // off_x, off_y, size_x, size_y
+        int b[4];
+
+        if ( size_x >= size_y )
+        {
+          int half = size_x / 2;
+
+          a[0] = off_px_x;        a[1] = off_px_y;
+          a[2] = half;            a[3] = size_y;
+          b[0] = off_px_x + half; b[1] = off_px_y;
+          b[2] = size_x - half;   b[3] = size_y;
+        }
+        else
+        {
+          int half = size_y / 2;
+
+          a[0] = off_px_x;        a[1] = off_px_y;
+          a[2] = size_x;          a[3] = half;
+          b[0] = off_px_x;        b[1] = off_px_y + half;
+          b[2] = size_x;          b[3] = size_y - half;
+        }
+
+        std::vector <char> buf (4 + 4 + name_len + 4 + 4 + 32);
+
+        char * q = &buf[0];
+
+        *(uint32_t *) q = htonl (4 + name_len + 4 + 4 + 32);    q += 4;
+        *(uint32_t *) q = htonl (name_len);                     q += 4;
+
+        ::memcpy (q, name.c_str (), name_len);                  q += name_len;
+
+        *(uint32_t *) q = htonl (1);                            q += 4;
+        *(uint32_t *) q = htonl ((uint32_t) cost_ms);           q += 4;
+
+        for ( int i = 0; i < 4; i++ )
+        {
+          *(uint32_t *) q = htonl ((uint32_t) a[i]);            q += 4;
+        }
+
+        for ( int i = 0; i < 4; i++ )
+        {
+          *(uint32_t *) q = htonl ((uint32_t) b[i]);            q += 4;
+        }
+
+        if ( ! util::write_exact (s, &buf[0], buf.size ()) )
+        {
+          break;
+        }
+      }
+      else
+      {
+        uint32_t count = iters.size ();
+
+        std::vector <char> buf (4 + 4 + name_len + 4 + 4 + 4 + 4 * count);
+
+        char * q = &buf[0];
+
+        *(uint32_t *) q = htonl (4 + name_len + 12 + 4 * count);  q += 4;
+        *(uint32_t *) q = htonl (name_len);                       q += 4;
+
+        ::memcpy (q, name.c_str (), name_len);                    q += name_len;
+
+        *(uint32_t *) q = htonl (0);                              q += 4;
+        *(uint32_t *) q = htonl ((uint32_t) cost_ms);             q += 4;
+        *(uint32_t *) q = htonl (count);                          q += 4;
+
+        for ( uint32_t i = 0; i < count; i++ )
+        {
+          *(uint32_t *) q = htonl ((uint32_t) iters[i]);          q += 4;
+        }
+
+        if ( ! util::write_exact (s, &buf[0], buf.size ()) )
+        {
+          break;
+        }
+      }
+    }
+
+    s.close ();
+  }
+  catch ( saga::exception const & )
+  {
+    // channel died mid-run - the master re-queues our in-flight boxes
+    // for the remaining clients
+    std::cout << "client: work stream failed - exit" << std::endl;
+  }
+
+  return true;
 }
 
 
@@ -44,13 +697,29 @@ int main (int argc, char** argv)
       if ( cmd != "awol" &&
            cmd != "lazy" &&
            cmd != "joke" &&
-           cmd != "bomb" )
+           cmd != "bomb" &&
+           cmd != "gpu"  )
       {
         std::cerr << "unknown command " << cmd << " given - exit" << std::endl;
         return -2;
       }
     }
 
+    // 'gpu' routes the iteration kernel to the GPU backend (see
+    // gpu_kernel.hpp) - set per endpoint via the args ini key.  If no
+    // usable device exists, we keep running on the CPU path.
+    bool use_gpu = false;
+
+    if ( cmd == "gpu" )
+    {
+      use_gpu = gpu::available ();
+
+      std::cout << "gpu: "
+                << (use_gpu ? "device initialized"
+                            : "no usable device - cpu fallback")
+                << std::endl;
+    }
+
     if ( cmd == "awol" )
     {
       while ( true )
@@ -93,11 +762,23 @@ int main (int argc, char** argv)
                                                      // saga::advert::Exclusive | 
                                                         saga::advert::ReadWrite );
 
-    // add a version tag, so that a master can ensure version matching. 
-    // FIXME: Alas, that leads to a race condition, as long as the advert 
+    // add a version tag, so that a master can ensure version matching.
+    // FIXME: Alas, that leads to a race condition, as long as the advert
     // service does not support locking (or atomic move).
     job_dir.set_attribute ("version", SAGA_MANDELBROT_VERSION);
 
+    // open the shared work queue bucket.  All clients pull their boxes
+    // from here (work stealing), so nothing is stranded on a slow
+    // client.  Create is allowed, as we may come up before the master
+    // filled the queue.  The bucket is sharded - the wrapper routes
+    // entries by name and scans all shards in one go (see
+    // common/sharded_dir.hpp).
+    sharded_dir::directory queue_dir (app_dir.open_dir ("queue",
+                                                        saga::advert::Create    |
+                                                        saga::advert::ReadWrite ),
+                                      saga::advert::Create    |
+                                      saga::advert::ReadWrite );
+
     // we registered, now we can sleep if that was requested
     if ( cmd == "lazy" )
     {
@@ -124,7 +805,8 @@ int main (int argc, char** argv)
         ::gettimeofday (&tv, NULL);
         ::srand (tv.tv_sec + tv.tv_usec);
 
-        std::vector <saga::url> victims = job_dir.list ();
+        // the work items live in the shared queue bucket nowadays
+        std::vector <std::string> victims = queue_dir.list ();
 
         std::cout << "victims: " << victims.size () << std::endl;
 
@@ -135,7 +817,7 @@ int main (int argc, char** argv)
           {
             // kaboom!
             std::cout << " bomb hit    target " << i << " >:-)" << std::endl;
-            saga::advert::entry victim = job_dir.open (victims[i], saga::advert::ReadWrite);
+            saga::advert::entry victim = queue_dir.open (victims[i], saga::advert::ReadWrite);
             victim.set_attribute ("state", "bombed");
           }
           else
@@ -164,6 +846,31 @@ int main (int argc, char** argv)
     int    limit      = ::atoi (app_dir.get_attribute ("limit"     ).c_str ());
     int    escap      = ::atoi (app_dir.get_attribute ("escape"    ).c_str ());
 
+    // adaptive box sizing threshold (ms, 0 = off).  Old masters do not
+    // publish it.
+    int    split_ms   = 0;
+
+    if ( app_dir.attribute_exists ("split_ms") )
+    {
+      split_ms = ::atoi (app_dir.get_attribute ("split_ms").c_str ());
+    }
+
+    // binary result channel endpoint (empty = advert attributes)
+    std::string stream_url;
+
+    if ( app_dir.attribute_exists ("stream_url") )
+    {
+      stream_url = app_dir.get_attribute ("stream_url");
+    }
+
+    // streaming work channel endpoint (empty = advert queue dispatch)
+    std::string work_url;
+
+    if ( app_dir.attribute_exists ("work_url") )
+    {
+      work_url = app_dir.get_attribute ("work_url");
+    }
+
     std::cout << " plane_x_0        : " << plane_x_0  << std::endl;
     std::cout << " plane_y_0        : " << plane_y_0  << std::endl;
     std::cout << " plane_x_1        : " << plane_x_1  << std::endl;
@@ -174,6 +881,9 @@ int main (int argc, char** argv)
     std::cout << " box_num_y        : " << box_num_y  << std::endl;
     std::cout << " limit            : " << limit      << std::endl;
     std::cout << " escap            : " << escap      << std::endl;
+    std::cout << " split_ms         : " << split_ms   << std::endl;
+    std::cout << " stream_url       : " << stream_url << std::endl;
+    std::cout << " work_url         : " << work_url   << std::endl;
 
 
     int box_size_x = (int) floor (img_size_x / box_num_x);
@@ -203,6 +913,26 @@ int main (int argc, char** argv)
     std::cout << " plane_box_step_x : " << plane_box_step_x  << std::endl;
     std::cout << " plane_box_step_y : " << plane_box_step_y  << std::endl;
 
+    // streaming work mode: when the master runs a work channel, hold
+    // one persistent connection and let it push the boxes (see
+    // stream_work above).  The advert queue below remains the
+    // fallback for when the channel cannot be established.  'bomb'
+    // keeps the advert path - sabotaging the queue is its very job.
+    if ( ! work_url.empty () &&
+         cmd != "bomb"       )
+    {
+      if ( stream_work (work_url, job_id, cmd, use_gpu, split_ms,
+                        plane_x_0, plane_y_0,
+                        plane_box_step_x, plane_box_step_y,
+                        limit, escap) )
+      {
+        return 0;
+      }
+
+      std::cout << "client: work stream unavailable - advert fallback"
+                << std::endl;
+    }
+
     // work as long as there is work
     bool busy      = true;
     bool work_done = false;
@@ -239,12 +969,23 @@ int main (int argc, char** argv)
       // by default we wait, unless there is work to do
       should_wait = true;
 
-      // find work ads for this job
-      std::vector <saga::url> work_ads = job_dir.list ();
+      // find work ads in the shared queue (one scan across all shards)
+      std::vector <std::string> work_ads = queue_dir.list ();
+
+      // claim markers are not work items - count the real ones
+      unsigned int work_cnt = 0;
+
+      for ( unsigned int i = 0; i < work_ads.size (); i++ )
+      {
+        if ( std::string::npos == work_ads[i].rfind ("_claim") )
+        {
+          work_cnt++;
+        }
+      }
 
-      // wait for work 
+      // wait for work
       // TODO: replace with notification
-      if ( 0 == work_ads.size () )
+      if ( 0 == work_cnt )
       {
         if ( work_done ) 
         {
@@ -261,10 +1002,10 @@ int main (int argc, char** argv)
         continue;
       }
 
-      std::cout << "client: found " << work_ads.size () << " work ads" << std::endl;
+      std::cout << "client: found " << work_cnt << " work ads" << std::endl;
 
-      // found some ads.  Now pick those which are flagged active, and work on
-      // them
+      // found some ads.  Now pick those which are flagged active, claim
+      // them, and work on them
       for ( unsigned int i = 0; i < work_ads.size (); i++ )
       {
         // FIXME: this loop circles over 'done' items forever, until the master
@@ -279,26 +1020,90 @@ int main (int argc, char** argv)
         // FIXME: the current advert service impl seems to be lazy in state
         // updates though, so we may get incorrect state results (dir lingers
         // but stays empty).
-        try 
+        try
         {
-          saga::advert::entry ad = job_dir.open (work_ads[i], saga::advert::ReadWrite);
+          // skip claim markers
+          std::string name = work_ads[i];
+
+          if ( std::string::npos != name.rfind ("_claim") )
+          {
+            continue;
+          }
+
+          // open via the handle cache: the loop revisits the same ads
+          // every round (in particular 'done' items, until the master
+          // deletes them), so re-resolving them each time just burns a
+          // namespace round trip per ad per round
+          saga::advert::entry ad = queue_dir.open_cached (work_ads[i],
+                                                          saga::advert::ReadWrite);
 
           // still an active item?
           if ( ad.get_attribute ("state") == "work" )
           {
+            // try to claim the box.  Exclusive create is the one atomic
+            // primitive the advert service offers, so the claim marker
+            // doubles as compare-and-claim: exactly one client wins,
+            // everybody else moves on to the next box.
+            try
+            {
+              saga::advert::entry claim = queue_dir.open (name + "_claim",
+                                                          saga::advert::Create    |
+                                                          saga::advert::Exclusive |
+                                                          saga::advert::ReadWrite );
+              claim.set_attribute ("worker", job_id);
+            }
+            catch ( saga::exception const & )
+            {
+              // somebody else got there first
+              continue;
+            }
+
+            // the box is ours - identify ourselves on the work item
+            ad.set_attribute ("worker", job_id);
+
             // get box id to work on
             int boxnum = boost::lexical_cast <int> (ad.get_attribute ("boxnum"));
 
-            // box indicee coordinates
-            int box_x  =              boxnum % box_num_y ;
-            int box_y  = (int) floor (boxnum / box_num_y);
+            // box pixel geometry: prefer the explicit attributes (the
+            // box may be a split fraction of the initial grid), fall
+            // back to the boxnum-derived grid position
+            int off_px_x = -1;
+            int off_px_y = -1;
+            int size_x   = -1;
+            int size_y   = -1;
 
-            std::cout << " boxnum           : " << boxnum 
-                      << " (" << box_x << ", "  << box_y << ")" << std::endl;
+            try
+            {
+              off_px_x = ::atoi (ad.get_attribute ("off_x" ).c_str ());
+              off_px_y = ::atoi (ad.get_attribute ("off_y" ).c_str ());
+              size_x   = ::atoi (ad.get_attribute ("size_x").c_str ());
+              size_y   = ::atoi (ad.get_attribute ("size_y").c_str ());
+            }
+            catch ( saga::exception const & )
+            {
+              size_x = -1;
+            }
+
+            if ( size_x <= 0 || size_y <= 0 )
+            {
+              // box indicee coordinates
+              int box_x  =              boxnum % box_num_y ;
+              int box_y  = (int) floor (boxnum / box_num_y);
+
+              off_px_x = box_y * box_size_x;
+              off_px_y = box_x * box_size_y;
+              size_x   = box_size_x;
+              size_y   = box_size_y;
+            }
 
-            // we use boxnum to compute the box offsets in the complex plane
-            double plane_box_off_x = plane_x_0 + box_y * plane_box_ext_x;
-            double plane_box_off_y = plane_y_0 + box_x * plane_box_ext_y;
+            std::cout << " boxnum           : " << boxnum
+                      << " ("  << off_px_x << ", "  << off_px_y
+                      << " / " << size_x   << "x"   << size_y
+                      << ")"   << std::endl;
+
+            // box offsets in the complex plane, from the pixel offsets
+            double plane_box_off_x = plane_x_0 + off_px_x * plane_box_step_x;
+            double plane_box_off_y = plane_y_0 + off_px_y * plane_box_step_y;
 
 
             // point in complex plane to iterate over is (c0, c1)
@@ -306,64 +1111,127 @@ int main (int argc, char** argv)
             // data to paint
             std::stringstream data;
 
-            // iterate over all pixels in complex plane
-            for ( int x = 0; x < box_size_x; x++ )
+            // set up the iteration kernel job (see namespace kernel)
+            std::vector <int> iters (size_x * size_y, 0);
+
+            kernel::box_job job;
+
+            job.c0_0    = plane_box_off_x;
+            job.c0_step = plane_box_step_x;
+            job.c1_0    = plane_box_off_y;
+            job.c1_step = plane_box_step_y;
+
+            if ( cmd == "joke" )
             {
-              // x coordinate of pixel in complex plane (real part)
-              double c0 = plane_box_off_x + x * plane_box_step_x;
+              // mirror box :-P
+              job.c0_0    = plane_box_off_x + size_x * plane_box_step_x;
+              job.c0_step = -plane_box_step_x;
+              job.c1_0    = plane_box_off_y + size_y * plane_box_step_y;
+              job.c1_step = -plane_box_step_y;
+            }
 
-              if ( cmd == "joke" )
+            job.size_x    = size_x;
+            job.size_y    = size_y;
+            job.limit     = limit;
+            job.esc2      = (double) escap * (double) escap;
+            job.simd      = (NULL == ::getenv ("SAGA_MANDELBROT_NOSIMD"));
+            job.iters     = &iters[0];
+            job.next_row  = 0;
+            job.rows_done = 0;
+            job.abort_    = 0;
+
+            // run the kernel (see kernel::run_box); the measured
+            // compute time is reported to the master either way
+            bool split   = false;
+            long cost_ms = kernel::run_box (job, use_gpu, split_ms, &split);
+
+            if ( split )
+            {
+              // too expensive - split along the larger dimension, queue
+              // the halves, and hand the box back to the master
+              std::string name     = ad.get_attribute ("name");
+              std::string boxnum_s = ad.get_attribute ("boxnum");
+
+              std::cout << " splitting box    : " << name
+                        << " (" << cost_ms << "ms)" << std::endl;
+
+              if ( size_x >= size_y )
               {
-                // mirror box :-P
-                c0 = plane_box_off_x + (box_size_x - x) * plane_box_step_x;
-              }
+                int half = size_x / 2;
 
-              for ( int y = 0; y < box_size_y; y++ )
+                util::queue_child (queue_dir, name + "a", boxnum_s,
+                                   off_px_x,        off_px_y, half,          size_y);
+                util::queue_child (queue_dir, name + "b", boxnum_s,
+                                   off_px_x + half, off_px_y, size_x - half, size_y);
+              }
+              else
               {
-                // y coordinate of pixel in complex plane (imaginary part)
-                double c1 = plane_box_off_y + y * plane_box_step_y;
+                int half = size_y / 2;
 
-                if ( cmd == "joke" )
-                {
-                  // mirror box :-P
-                  c1 = plane_box_off_y + (box_size_y - y) * plane_box_step_y;
-                }
+                util::queue_child (queue_dir, name + "a", boxnum_s,
+                                   off_px_x, off_px_y,        size_x, half);
+                util::queue_child (queue_dir, name + "b", boxnum_s,
+                                   off_px_x, off_px_y + half, size_x, size_y - half);
+              }
+
+              ad.set_attribute ("children", name + "a " + name + "b");
+              ad.set_attribute ("cost",     boost::lexical_cast <std::string> (cost_ms));
+              ad.set_attribute ("state",    "split");
+
+              should_wait = false;
+            }
+            else
+            {
+              // the cost goes onto the advert in any case - the master
+              // reads it from there for its cost records
+              ad.set_attribute ("cost", boost::lexical_cast <std::string> (cost_ms));
 
-                std::complex <double> C (c0, c1);
-                std::complex <double> Z (.0, .0); // initial value for iteration Z
+              // report the result: preferably as one binary frame over
+              // the stream channel, falling back to the advert data
+              // attribute
+              bool sent = false;
 
-                int iter;
+              if ( ! stream_url.empty () )
+              {
+                sent = util::send_frame (stream_url,
+                                         ad.get_attribute ("name"),
+                                         iters);
+              }
 
-                for ( iter = 0; iter <= limit; iter++ )
+              if ( ! sent )
+              {
+                // serialize the iteration counts, same order as before
+                for ( int x = 0; x < size_x; x++ )
                 {
-                  Z = Z * Z + C;
-
-                  if ( abs (Z) > escap )
-                    break;
+                  for ( int y = 0; y < size_y; y++ )
+                  {
+                    data << iters[x * size_y + y] << " ";
+                  }
                 }
 
-                // store the number of iteration needed to escape the limit
-                data << iter << " ";
+                // signal work done
+                ad.set_attribute ("data",  data.str ());
+                ad.set_attribute ("state", "done");
               }
-            }
-
-            // signal work done
-            ad.set_attribute ("data",  data.str ());
-            ad.set_attribute ("state", "done");
 
-            // flag that we did some work.  (a) we don't sleep before next work
-            // item check, and also, once we run out of work, we can terminate
-            work_done   = true;
-            should_wait = false;
+              // flag that we did some work.  (a) we don't sleep before next work
+              // item check, and also, once we run out of work, we can terminate
+              work_done   = true;
+              should_wait = false;
+            }
 
           } // if ad.state == "work"
 
-          ad.close ();
+          // no close: the handle lives on in the cache for the next round
         }
         catch ( saga::exception const & e )
         {
-          // this advert failed for some reason.  
-          // Simply continue with the next one.
+          // this advert failed for some reason - most likely the master
+          // deleted a finished item under us.  Drop the cached handle so
+          // the next round resolves it afresh (or finds it gone), and
+          // simply continue with the next one.
+          queue_dir.invalidate (work_ads[i]);
+
           std::cout << "client: SAGA Exception for advert op" << std::endl;
           std::cout << e.what () << std::endl;
           ::sleep (1); // relax chance of race conditions.
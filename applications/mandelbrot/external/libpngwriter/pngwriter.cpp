@@ -1873,6 +1873,79 @@ void pngwriter::setcompressionlevel(int level)
    compressionlevel_ = level;
 }
 
+//////////////////////////////////////////////////////
+void pngwriter::setbitdepth(int depth)
+{
+   if( (depth != 8)&&(depth != 16) )
+     {
+	std::cerr << " PNGwriter::setbitdepth - ERROR **: Called with wrong bit depth: should be 8 or 16, was: " << depth << "." << std::endl;
+	return;
+     }
+
+   if(depth == bit_depth_)
+     {
+	return;
+     }
+
+   int oldbytes = (bit_depth_ == 16) ? 6 : 3;
+   int newbytes = (depth      == 16) ? 6 : 3;
+
+   for(int vhhh = 0; vhhh < height_; vhhh++)
+     {
+	png_bytep newrow = (png_bytep)malloc(newbytes*width_ * sizeof(png_byte));
+	if(newrow == NULL)
+	  {
+	     std::cerr << " PNGwriter::setbitdepth - ERROR **:  Not able to allocate memory for image." << std::endl;
+	     return;
+	  }
+
+	for(int hhh = 0; hhh < width_; hhh++)
+	  {
+	     for(int channel = 0; channel < 3; channel++)
+	       {
+		  if(newbytes < oldbytes)
+		    {
+		       // 16 -> 8: keep the high byte of each channel
+		       newrow[newbytes*hhh + channel] =
+			 graph_[vhhh][oldbytes*hhh + 2*channel];
+		    }
+		  else
+		    {
+		       // 8 -> 16: replicate the byte into both halves
+		       newrow[newbytes*hhh + 2*channel]     =
+			 graph_[vhhh][oldbytes*hhh + channel];
+		       newrow[newbytes*hhh + 2*channel + 1] =
+			 graph_[vhhh][oldbytes*hhh + channel];
+		    }
+	       }
+	  }
+
+	free(graph_[vhhh]);
+	graph_[vhhh] = newrow;
+     }
+
+   bit_depth_ = depth;
+   rowbytes_  = newbytes*width_;
+}
+
+//////////////////////////////////////////////////////
+void pngwriter::plot8(int x, int y, unsigned char red, unsigned char green, unsigned char blue)
+{
+   if(bit_depth_ != 8)
+     {
+	this->plot(x, y, 257*(int)red, 257*(int)green, 257*(int)blue);
+	return;
+     }
+
+   if( (y<height_+1) && (y>0) && (x>0) && (x<width_+1) )
+     {
+	int tempindex = 3*x-3;
+	graph_[height_-y][tempindex]   = red;
+	graph_[height_-y][tempindex+1] = green;
+	graph_[height_-y][tempindex+2] = blue;
+     };
+}
+
 // An implementation of a Bezier curve.
 void pngwriter::bezier(  int startPtX, int startPtY,
 			 int startControlX, int startControlY,
@@ -368,6 +368,26 @@ class pngwriter
     * */
     void setcompressionlevel(int level);
 
+   /* Set Bit Depth
+    * Selects the in-memory framebuffer layout: 16 (the default, two bytes
+    * per channel) or 8 (one byte per channel). The 8-bit layout halves the
+    * image memory and the amount of data libpng has to filter and deflate
+    * on close(), and is all a caller needs when its colours are derived
+    * from 8-bit values anyway. Can be called at any time; the current
+    * image content is converted in place (16 to 8 keeps the high byte of
+    * each channel).
+    * */
+    void setbitdepth(int depth);
+
+   /* Plot 8-bit
+    * Writes one pixel as plain 8-bit channel values, without any
+    * coefficient scaling or clamping - the fast path for callers that
+    * already hold 8-bit colours (e.g. palette lookups). Only touches the
+    * framebuffer directly when the bit depth is 8 (see setbitdepth());
+    * otherwise it falls back to the regular plot().
+    * */
+    void plot8(int x, int y, unsigned char red, unsigned char green, unsigned char blue);
+
    /* Get Bit Depth
     * When you open a PNG with readfromfile() you can find out its bit depth with this function.
     * Mostly for troubleshooting uses.
@@ -395,7 +415,7 @@ class pngwriter
    double getgamma(void);
 
    /* Bezier Curve
-    * (After Frenchman Pierre B�zier from Regie Renault)
+    * (After Frenchman Pierre B�zier from Regie Renault)
     * A collection of formulae for describing curved lines 
     * and surfaces, first used in 1972 to model automobile surfaces. 
     *             (from the The Free On-line Dictionary of Computing)
@@ -1,11 +1,13 @@
 
 #include "endpoint.hpp"
+#include "ini_bind.hpp"
 
 endpoint::endpoint (std::string           name,
                     mb_util::ini::section ini)
   : name_      (name)
   , ini_       (ini)
-  , valid_     (false)
+  , valid_     (true)
+  , connected_ (false)
   , cnt_jreq_  (0)
   , cnt_jrun_  (0)
   , cnt_jreg_  (0)
@@ -13,22 +15,43 @@ endpoint::endpoint (std::string           name,
   , cnt_iok_   (0)
   , cancelled_ (false)
 {
-  ctype_  =         ini_.get_entry ("ctype", "" );
-  url_    =         ini_.get_entry ("url"  , "" );
-  user_   =         ini_.get_entry ("user" , "" );
-  pass_   =         ini_.get_entry ("pass" , "" );
-  cert_   =         ini_.get_entry ("cert" , "" );
-  key_    =         ini_.get_entry ("key"  , "" );
-  proxy_  =         ini_.get_entry ("proxy", "" );
-  cadir_  =         ini_.get_entry ("cadir", "" );
-  exe_    =         ini_.get_entry ("exe"  , "" );
-  args_   =         ini_.get_entry ("args" , "" );
-  pwd_    =         ini_.get_entry ("pwd"  , "" );
-  njobs_  = ::atoi (ini_.get_entry ("njobs", "1").c_str ());
-  debug_  = ::atoi (ini_.get_entry ("debug", "0").c_str ());
+  // typed binding of the backend section (see ini_bind.hpp) - the
+  // same table style as the master section, and shared between the
+  // main ini and a merged mandelbrot_backend.ini.  A mistyped njobs
+  // aborts here, before the endpoint's submission thread spins up.
+  mb_util::ini::binder bind (ini_);
+
+  bind.bind ("ctype", ctype_, "")
+      .bind ("url"  , url_  , "")
+      .bind ("user" , user_ , "")
+      .bind ("pass" , pass_ , "")
+      .bind ("cert" , cert_ , "")
+      .bind ("key"  , key_  , "")
+      .bind ("proxy", proxy_, "")
+      .bind ("cadir", cadir_, "")
+      .bind ("exe"  , exe_  , "")
+      .bind ("args" , args_ , "")
+      .bind ("pwd"  , pwd_  , "")
+      .bind ("njobs", njobs_, 1u)
+      .flag ("debug", debug_, false);
+
+  bind.check ("backend section [" + name_ + "]");
 
   // ini_.dump ();
 
+  // note: no remote contact here.  Creating the job service blocks
+  // for the full connect timeout on a dead gatekeeper, so that is
+  // deferred to validate(), which runs on the submission thread.
+}
+
+
+bool endpoint::validate (void)
+{
+  if ( connected_ )
+  {
+    return true;
+  }
+
   try
   {
     saga::session s;
@@ -63,17 +86,18 @@ endpoint::endpoint (std::string           name,
 
     saga::job::service js (s, url_);
 
-    service_ = js;
-    valid_   = true;
+    service_   = js;
+    connected_ = true;
   }
   catch ( const saga::exception & e )
   {
-    std::cout << "endpoint startup failed:\n";
-    std::cout << e.what () << std::endl;
-
     log_ << "endpoint startup failed:\n";
     log_ << e.what ();
+
+    valid_ = false;
   }
+
+  return connected_;
 }
 
 
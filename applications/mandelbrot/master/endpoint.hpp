@@ -18,6 +18,11 @@ class endpoint
                mb_util::ini::section ini);
     ~endpoint (void);
 
+    // create session, context and job service.  This is the part
+    // that blocks on a dead gatekeeper, so it runs on the endpoint's
+    // submission thread, not during construction.
+    bool validate (void);
+
     void cancel (void);
     void dump   (void);
 
@@ -26,6 +31,7 @@ class endpoint
     mb_util::ini::section   ini_;
     std::stringstream       log_;
     bool                    valid_;
+    bool                    connected_;  // validate succeeded?
 
     std::string             url_;
     std::string             ctype_;
@@ -0,0 +1,170 @@
+
+#include <time.h>
+
+#include <fstream>
+#include <iostream>
+
+#include "endpoint_cache.hpp"
+
+// file format, one endpoint per line:
+//
+//   <name> <last_ok> <last_try> <submit_ms> <samples>
+
+
+endpoint_cache::endpoint_cache (std::string file)
+  : file_ (file)
+{
+  ::pthread_mutex_init (&mtx_, NULL);
+
+  std::ifstream in (file_.c_str ());
+
+  std::string name;
+  stats_t     s;
+
+  while ( in >> name >> s.last_ok >> s.last_try >> s.submit_ms >> s.samples )
+  {
+    stats_[name] = s;
+  }
+
+  if ( stats_.size () )
+  {
+    std::cout << "liveness: " << stats_.size ()
+              << " endpoint(s) from " << file_ << std::endl;
+  }
+}
+
+
+endpoint_cache::~endpoint_cache (void)
+{
+  ::pthread_mutex_lock   (&mtx_);
+  save_ ();
+  ::pthread_mutex_unlock (&mtx_);
+}
+
+
+// write the cache out.  Called after every update - the file is tiny,
+// and a crashed run then still leaves fresh liveness data behind.
+void endpoint_cache::save_ (void)
+{
+  std::ofstream out (file_.c_str ());
+
+  if ( ! out )
+  {
+    return;
+  }
+
+  std::map <std::string, stats_t> :: iterator it;
+
+  for ( it = stats_.begin (); it != stats_.end (); it++ )
+  {
+    out << it->first             << " "
+        << it->second.last_ok    << " "
+        << it->second.last_try   << " "
+        << it->second.submit_ms  << " "
+        << it->second.samples    << "\n";
+  }
+}
+
+
+bool endpoint_cache::known_dead (std::string name)
+{
+  ::pthread_mutex_lock (&mtx_);
+
+  bool dead = false;
+
+  std::map <std::string, stats_t> :: iterator it = stats_.find (name);
+
+  if ( it != stats_.end () )
+  {
+    dead = ( it->second.last_try > it->second.last_ok );
+  }
+
+  ::pthread_mutex_unlock (&mtx_);
+
+  return dead;
+}
+
+
+double endpoint_cache::submit_ms (std::string name)
+{
+  ::pthread_mutex_lock (&mtx_);
+
+  double ms = 0.0;
+
+  std::map <std::string, stats_t> :: iterator it = stats_.find (name);
+
+  if ( it != stats_.end () )
+  {
+    ms = it->second.submit_ms;
+  }
+
+  ::pthread_mutex_unlock (&mtx_);
+
+  return ms;
+}
+
+
+void endpoint_cache::record_ok (std::string name, double submit_ms)
+{
+  ::pthread_mutex_lock (&mtx_);
+
+  if ( stats_.find (name) == stats_.end () )
+  {
+    stats_t z;
+
+    z.last_ok   = 0;
+    z.last_try  = 0;
+    z.submit_ms = 0.0;
+    z.samples   = 0;
+
+    stats_[name] = z;
+  }
+
+  stats_t & s = stats_[name];
+
+  s.last_ok  = ::time (NULL);
+  s.last_try = s.last_ok;
+
+  if ( s.samples <= 0 )
+  {
+    s.submit_ms = submit_ms;
+    s.samples   = 1;
+  }
+  else
+  {
+    // rolling average, recent runs dominate
+    s.submit_ms = 0.7 * s.submit_ms + 0.3 * submit_ms;
+    s.samples  += 1;
+  }
+
+  save_ ();
+
+  ::pthread_mutex_unlock (&mtx_);
+}
+
+
+void endpoint_cache::record_fail (std::string name)
+{
+  ::pthread_mutex_lock (&mtx_);
+
+  if ( stats_.find (name) == stats_.end () )
+  {
+    stats_t z;
+
+    z.last_ok   = 0;
+    z.last_try  = 0;
+    z.submit_ms = 0.0;
+    z.samples   = 0;
+
+    stats_[name] = z;
+  }
+
+  stats_t & s = stats_[name];
+
+  s.last_try = ::time (NULL);
+
+  save_ ();
+
+  ::pthread_mutex_unlock (&mtx_);
+}
+
@@ -0,0 +1,56 @@
+
+#ifndef SAGA_MANDELBROT_ENDPOINT_CACHE_HPP
+#define SAGA_MANDELBROT_ENDPOINT_CACHE_HPP
+
+#include <map>
+#include <string>
+
+#include <pthread.h>
+
+// endpoint liveness cache, persisted between runs (mandelbrot.endpoints,
+// next to mandelbrot.cost).
+//
+// Per endpoint we keep the timestamps of the last successful and the
+// last attempted validation, plus a rolling average of the submission
+// latency.  The job starter consults the cache at startup: endpoints
+// whose last attempt failed are started in the background and not
+// waited for, so a dead gatekeeper no longer adds its connect timeout
+// to the render.
+//
+// record_ok / record_fail are called from the per-endpoint submission
+// threads, hence the mutex.
+
+class endpoint_cache
+{
+  private:
+    struct stats_t
+    {
+      long   last_ok;    // epoch seconds of last successful validation
+      long   last_try;   // epoch seconds of last attempt
+      double submit_ms;  // rolling average submission latency
+      long   samples;    // number of latency samples folded in
+    };
+
+    std::string                     file_;
+    std::map <std::string, stats_t> stats_;
+    pthread_mutex_t                 mtx_;
+
+    void save_ (void);  // caller holds mtx_
+
+  public:
+    endpoint_cache (std::string file);
+   ~endpoint_cache (void);
+
+    // did the last attempt on this endpoint fail?  (unknown
+    // endpoints report false - they get one synchronous chance)
+    bool known_dead (std::string name);
+
+    // rolling submission latency, 0 if unknown
+    double submit_ms (std::string name);
+
+    void record_ok   (std::string name, double submit_ms);
+    void record_fail (std::string name);
+};
+
+#endif // SAGA_MANDELBROT_ENDPOINT_CACHE_HPP
+
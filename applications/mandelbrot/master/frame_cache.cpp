@@ -0,0 +1,183 @@
+
+#include <fstream>
+#include <iostream>
+
+#include "frame_cache.hpp"
+
+// file format, all text (like mandelbrot.cost):
+//
+//   mandelbrot-frame 1 <img_x> <img_y> <x0> <y0> <x1> <y1> <limit> <escape>
+//   <img_x * img_y iteration counts, row major, -1 == unknown>
+
+static const char * frame_magic   = "mandelbrot-frame";
+static const int    frame_version = 1;
+
+
+frame_cache::frame_cache (void)
+  : valid_ (false)
+{
+}
+
+
+bool frame_cache::load (std::string file)
+{
+  valid_ = false;
+
+  std::ifstream in (file.c_str ());
+
+  if ( ! in )
+  {
+    return false;
+  }
+
+  std::string magic;
+  int         version = 0;
+
+  in >> magic >> version;
+
+  if ( magic != frame_magic || version != frame_version )
+  {
+    return false;
+  }
+
+  in >> img_x_ >> img_y_
+     >> plane_x_0_ >> plane_y_0_ >> plane_x_1_ >> plane_y_1_
+     >> limit_ >> escape_;
+
+  if ( ! in || img_x_ <= 0 || img_y_ <= 0 )
+  {
+    return false;
+  }
+
+  counts_.resize (img_x_ * img_y_);
+
+  for ( int i = 0; i < img_x_ * img_y_; i++ )
+  {
+    if ( ! (in >> counts_[i]) )
+    {
+      // truncated file - don't reuse half a frame
+      counts_.clear ();
+      return false;
+    }
+  }
+
+  valid_ = true;
+
+  return true;
+}
+
+
+void frame_cache::save (std::string               file,
+                        int                       img_x,
+                        int                       img_y,
+                        double                    plane_x_0,
+                        double                    plane_y_0,
+                        double                    plane_x_1,
+                        double                    plane_y_1,
+                        int                       limit,
+                        int                       escape,
+                        const std::vector <int> & counts)
+{
+  std::ofstream out (file.c_str ());
+
+  if ( ! out )
+  {
+    std::cerr << "warning: cannot write frame cache " << file << std::endl;
+    return;
+  }
+
+  // plane coordinates need full precision - a zoom step is a small
+  // relative change of the window
+  out.precision (17);
+
+  out << frame_magic << " " << frame_version << " "
+      << img_x << " " << img_y << " "
+      << plane_x_0 << " " << plane_y_0 << " "
+      << plane_x_1 << " " << plane_y_1 << " "
+      << limit << " " << escape << "\n";
+
+  for ( unsigned int i = 0; i < counts.size (); i++ )
+  {
+    out << counts[i] << ((i + 1) % 32 ? " " : "\n");
+  }
+
+  out << "\n";
+}
+
+
+bool frame_cache::usable (int limit, int escape) const
+{
+  return ( valid_ && limit == limit_ && escape == escape_ );
+}
+
+
+bool frame_cache::reuse (double                             c0_0,
+                         double                             c0_step,
+                         double                             c1_0,
+                         double                             c1_step,
+                         int                                size_x,
+                         int                                size_y,
+                         double                             max_scale,
+                         std::vector <std::vector <int> > & data) const
+{
+  if ( ! valid_ )
+  {
+    return false;
+  }
+
+  // resolution of the cached frame
+  double cached_step_x = (plane_x_1_ - plane_x_0_) / img_x_;
+  double cached_step_y = (plane_y_1_ - plane_y_0_) / img_y_;
+
+  // new-detail check: rescaling coarse pixels onto a much finer grid
+  // smears visibly, so such boxes get recomputed
+  if ( cached_step_x > max_scale * c0_step ||
+       cached_step_y > max_scale * c1_step )
+  {
+    return false;
+  }
+
+  std::vector <std::vector <int> > out;
+
+  for ( int x = 0; x < size_x; x++ )
+  {
+    std::vector <int> line;
+
+    // sample at the pixel center, like the iteration does
+    double c0 = c0_0 + (x + 0.5) * c0_step;
+    int    ix = (int) ((c0 - plane_x_0_) / cached_step_x);
+
+    if ( ix < 0 || ix >= img_x_ )
+    {
+      return false;
+    }
+
+    for ( int y = 0; y < size_y; y++ )
+    {
+      double c1 = c1_0 + (y + 0.5) * c1_step;
+      int    iy = (int) ((c1 - plane_y_0_) / cached_step_y);
+
+      if ( iy < 0 || iy >= img_y_ )
+      {
+        return false;
+      }
+
+      int v = counts_[ix * img_y_ + iy];
+
+      if ( v < 0 )
+      {
+        // previous run never computed this pixel
+        return false;
+      }
+
+      line.push_back (v);
+    }
+
+    out.push_back (line);
+  }
+
+  data.swap (out);
+
+  return true;
+}
+
@@ -0,0 +1,78 @@
+
+#ifndef SAGA_MANDELBROT_FRAME_CACHE_HPP
+#define SAGA_MANDELBROT_FRAME_CACHE_HPP
+
+#include <string>
+#include <vector>
+
+// frame-to-frame reuse for zoom sequences.
+//
+// The master persists the finished frame (its plane window and the raw
+// iteration counts) to a cache file, next to mandelbrot.cost.  The next
+// run loads that file, and every box whose plane region falls inside
+// the cached window gets rescaled from the cached pixels instead of
+// being dispatched to a client - at typical zoom rates only boundary
+// and new-detail boxes remain to compute.
+//
+// Pixels the previous run never computed (missing boxes painted black)
+// are stored as -1, and poison reuse of any box that samples them.
+
+class frame_cache
+{
+  private:
+
+    bool               valid_;    // load succeeded?
+
+    int                img_x_;    // cached frame geometry
+    int                img_y_;
+    double             plane_x_0_;
+    double             plane_y_0_;
+    double             plane_x_1_;
+    double             plane_y_1_;
+    int                limit_;
+    int                escape_;
+
+    std::vector <int>  counts_;   // img_x * img_y iteration counts,
+                                  // row major, -1 == unknown
+
+  public:
+    frame_cache (void);
+
+    // load the frame of the previous run.  Unreadable or stale files
+    // (version or format mismatch) just leave the cache invalid.
+    bool load (std::string file);
+
+    // persist a finished frame for the next run
+    static void save (std::string               file,
+                      int                       img_x,
+                      int                       img_y,
+                      double                    plane_x_0,
+                      double                    plane_y_0,
+                      double                    plane_x_1,
+                      double                    plane_y_1,
+                      int                       limit,
+                      int                       escape,
+                      const std::vector <int> & counts);
+
+    // true if the cached frame was computed with the same iteration
+    // parameters (counts are not comparable otherwise)
+    bool usable (int limit, int escape) const;
+
+    // try to fill a box from the cache by nearest-neighbor rescaling.
+    // The box iterates C = (c0_0 + x * c0_step, c1_0 + y * c1_step),
+    // the same mapping the clients use.  Fails (false) when any sample
+    // falls outside the cached window, hits an unknown pixel, or the
+    // cached resolution is coarser than max_scale times the requested
+    // one (new-detail box - rescaling would smear).
+    bool reuse (double                             c0_0,
+                double                             c0_step,
+                double                             c1_0,
+                double                             c1_step,
+                int                                size_x,
+                int                                size_y,
+                double                             max_scale,
+                std::vector <std::vector <int> > & data) const;
+};
+
+#endif // SAGA_MANDELBROT_FRAME_CACHE_HPP
+
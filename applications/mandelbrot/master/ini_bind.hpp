@@ -0,0 +1,205 @@
+
+#ifndef SAGA_MANDELBROT_INI_BIND_HPP
+#define SAGA_MANDELBROT_INI_BIND_HPP
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+
+#include "ini.hpp"
+
+//////////////////////////////////////////////////////////////////////
+//
+// typed binding of ini entries to members.
+//
+// mb_util::ini hands back strings, and every consumer used to convert
+// them field by field with ::atoi/::atof - which silently reads a
+// mistyped "1O24" as 1.  The binder below makes those conversions
+// declarative: one bind () call per field names the key, the typed
+// target member and its default, and check () reports *all* mistyped
+// entries of a section in one go, before any endpoint is contacted or
+// job submitted.
+//
+//   mb_util::ini::binder b (cfg);
+//
+//   b.bind ("limit" , limit_ ,  256)
+//    .bind ("escape", escape_,    4)
+//    .flag ("debug" , debug_ , false);
+//
+//   b.check ("mandelbrot.ini [mandelbrot]");
+//
+// Missing keys take their default silently (as get_entry did); only
+// present-but-unconvertible values are errors.
+//
+namespace mb_util
+{
+  namespace ini
+  {
+    class binder
+    {
+      private:
+        section                   sec_;
+        std::vector <std::string> errors_;
+
+        // entry value with surrounding whitespace removed - numeric
+        // defaults were traditionally padded for alignment, and hand
+        // edited files pick up stray blanks easily
+        static std::string trim_ (std::string s)
+        {
+          std::string::size_type b = s.find_first_not_of (" \t");
+          std::string::size_type e = s.find_last_not_of  (" \t");
+
+          if ( std::string::npos == b )
+          {
+            return "";
+          }
+
+          return s.substr (b, e - b + 1);
+        }
+
+        void complain_ (const char *        key,
+                        const std::string & val,
+                        const char *        want)
+        {
+          errors_.push_back (std::string ("'") + key + "' = '" + val
+                             + "' is not " + want);
+        }
+
+      public:
+        explicit binder (const section & sec)
+          : sec_ (sec)
+        {
+        }
+
+        binder & bind (const char * key, std::string & tgt,
+                       const std::string & dflt)
+        {
+          tgt = sec_.get_entry (key, dflt);
+          return *this;
+        }
+
+        binder & bind (const char * key, int & tgt, int dflt)
+        {
+          tgt = dflt;
+
+          if ( sec_.has_entry (key) )
+          {
+            std::string val = trim_ (sec_.get_entry (key));
+            char      * end = NULL;
+            long        l   = ::strtol (val.c_str (), &end, 10);
+
+            if ( val.empty () || *end != '\0' )
+            {
+              complain_ (key, val, "an integer");
+            }
+            else
+            {
+              tgt = (int) l;
+            }
+          }
+
+          return *this;
+        }
+
+        binder & bind (const char * key, unsigned int & tgt,
+                       unsigned int dflt)
+        {
+          int tmp = (int) dflt;
+
+          bind (key, tmp, (int) dflt);
+
+          if ( tmp < 0 )
+          {
+            complain_ (key, sec_.get_entry (key, ""), "a positive integer");
+            tmp = (int) dflt;
+          }
+
+          tgt = (unsigned int) tmp;
+          return *this;
+        }
+
+        binder & bind (const char * key, double & tgt, double dflt)
+        {
+          tgt = dflt;
+
+          if ( sec_.has_entry (key) )
+          {
+            std::string val = trim_ (sec_.get_entry (key));
+            char      * end = NULL;
+            double      d   = ::strtod (val.c_str (), &end);
+
+            if ( val.empty () || *end != '\0' )
+            {
+              complain_ (key, val, "a number");
+            }
+            else
+            {
+              tgt = d;
+            }
+          }
+
+          return *this;
+        }
+
+        // boolean flags: yes/no, true/false, 1/0
+        binder & flag (const char * key, bool & tgt, bool dflt)
+        {
+          tgt = dflt;
+
+          if ( sec_.has_entry (key) )
+          {
+            std::string val = trim_ (sec_.get_entry (key));
+
+            if      ( val == "yes" || val == "true"  || val == "1" )
+            {
+              tgt = true;
+            }
+            else if ( val == "no"  || val == "false" || val == "0" )
+            {
+              tgt = false;
+            }
+            else
+            {
+              complain_ (key, val, "a yes/no flag");
+            }
+          }
+
+          return *this;
+        }
+
+        bool ok (void) const
+        {
+          return errors_.empty ();
+        }
+
+        // throws one std::runtime_error naming every bad entry of the
+        // section, so a misedited config fails the run at startup
+        // instead of after the endpoints spun up
+        void check (const std::string & what) const
+        {
+          if ( errors_.empty () )
+          {
+            return;
+          }
+
+          std::stringstream msg;
+
+          msg << "invalid configuration (" << what << "):";
+
+          for ( unsigned int i = 0; i < errors_.size (); i++ )
+          {
+            msg << "\n  " << errors_[i];
+          }
+
+          throw std::runtime_error (msg.str ());
+        }
+    };
+
+  } // namespace ini
+
+} // namespace mb_util
+
+#endif // SAGA_MANDELBROT_INI_BIND_HPP
+
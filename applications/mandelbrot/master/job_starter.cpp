@@ -1,4 +1,6 @@
 
+#include <sys/time.h>
+
 #include <sstream>
 #include <iostream>
 #include <fstream>
@@ -6,12 +8,14 @@
 #include <saga/saga/adaptors/utils.hpp>
 
 #include "job_starter.hpp"
+#include "ini_bind.hpp"
 
 
 //////////////////////////////////////////////////////////////////////
-job_starter::job_starter (std::string       a_dir, 
+job_starter::job_starter (std::string       a_dir,
                           mb_util::ini::ini ini)
-  : ini_ (ini)
+  : ini_   (ini)
+  , cache_ ("mandelbrot.endpoints")
 {
   // first, initialize all endpoints according to the ini file.
   // the main ini section MAY contain a key 'backend_ini' which
@@ -31,7 +35,9 @@ job_starter::job_starter (std::string       a_dir,
 
   mb_util::ini::entry_map :: iterator it;
 
-  debug_ = ::atoi (cfg.get_entry ("debug", "0").c_str ());
+  mb_util::ini::binder bind (cfg);
+  bind.flag  ("debug", debug_, false);
+  bind.check ("[mandelbrot]");
 
   for ( it = backends.begin (); it != backends.end (); it++ )
   {
@@ -47,165 +53,327 @@ job_starter::job_starter (std::string       a_dir,
       std::string url = backend_config.get_entry ("url"  , "");
       std::cout << "creating  endpoint " << key << " \t ... " << std::flush;
 
+      // construction only parses the config - the actual (and
+      // possibly slow) endpoint contact happens on the submission
+      // thread, in endpoint::validate
       boost::shared_ptr <endpoint> ep (new endpoint (key, backend_config));
 
-      if ( ep->valid_ )
-      {
-        endpoints_.push_back (ep);
-        std::cout << "ok (" << url << ")" << std::endl;
-      }
-      else
+      endpoints_.push_back (ep);
+
+      double ms = cache_.submit_ms (key);
+
+      std::cout << "queued (" << url << ")";
+
+      if ( ms > 0.0 )
       {
-        std::cout << "failed (" << url << ")" << std::endl;
+        std::cout << " ~" << (long) ms << "ms/job";
       }
+
+      std::cout << std::endl;
     }
   }
 
 
-  // for each endpoint, we run 'njobs' jobs.  
+  // for each endpoint, we run 'njobs' jobs.  Submission runs in one
+  // thread per endpoint: remote submission latencies are large, and
+  // would otherwise add up over the endpoint list.  Each endpoint gets
+  // a fixed block of client numbers up front, so that the numbers are
+  // stable no matter how the threads interleave (failed submissions
+  // thus leave gaps in the numbering - see num_map_).
+  //
+  // Endpoints whose last validation failed (per the liveness cache)
+  // are demoted: their threads are not joined here but in the d'tor,
+  // so they re-validate in the background while the render proceeds
+  // with the live endpoints.  If such an endpoint recovered, its
+  // clients join late and pull boxes off the shared queue like any
+  // other.
+  a_dir_ = a_dir;
+
+  pthread_mutex_init (&client_mtx_, NULL);
+
+  sargs_.resize (endpoints_.size ());
+  tids_.resize  (endpoints_.size ());
+  pending_.resize (endpoints_.size (), false);
+
+  std::vector <bool> demoted (endpoints_.size (), false);
+
+  unsigned int base = 0;
+
+  for ( unsigned int e = 0; e < endpoints_.size (); e++ )
+  {
+    sargs_[e].js   = this;
+    sargs_[e].ep   = e;
+    sargs_[e].base = base;
+
+    base += endpoints_[e]->njobs_;
+
+    demoted[e] = cache_.known_dead (endpoints_[e]->name_);
+
+    if ( demoted[e] )
+    {
+      std::cout << "demoting  endpoint " << endpoints_[e]->name_
+                << " (failed last run - revalidating in background)"
+                << std::endl;
+    }
+
+    if ( 0 == pthread_create (&tids_[e], NULL, job_starter_submit_main, &sargs_[e]) )
+    {
+      pending_[e] = true;
+    }
+    else
+    {
+      // cannot thread - submit inline
+      submit_jobs (e, sargs_[e].base);
+    }
+  }
+
   for ( unsigned int e = 0; e < endpoints_.size (); e++ )
   {
-    // try the next endpoint
-    boost::shared_ptr <endpoint> ep = endpoints_[e];
+    if ( pending_[e] && ! demoted[e] )
+    {
+      pthread_join (tids_[e], NULL);
+      pending_[e] = false;
+    }
+  }
+
+  // if the live endpoints produced no client at all, wait for the
+  // demoted ones after all - rendering without clients aborts anyway
+  pthread_mutex_lock (&client_mtx_);
+  bool none = clients_.empty ();
+  pthread_mutex_unlock (&client_mtx_);
 
-    if ( ep->valid_ )
+  if ( none )
+  {
+    for ( unsigned int e = 0; e < endpoints_.size (); e++ )
     {
-      for ( unsigned int j = 0; j < ep->njobs_; j++ )
+      if ( pending_[e] )
       {
-        try
-        {
-          int         jobnum = clients_.size ();
-          std::string ident  = boost::lexical_cast <std::string> (jobnum);
+        pthread_join (tids_[e], NULL);
+        pending_[e] = false;
+      }
+    }
 
-          // create a job description
-          saga::job::description jd;
-          jd.set_attribute (saga::job::attributes::description_executable, ep->exe_);
+    if ( clients_.size () == 0 )
+    {
+      throw "Could not start any jobs!";
+    }
+  }
+}
 
-          // client parameters:
-          // 0: path to advert directory to be used (job bucket)
-          // 1: jobnum, == name of work bucket for that job (is that in loop later)
-          std::vector <std::string> args;
-          args.push_back ("mandelbrot_client ");
-          args.push_back (a_dir);
-          args.push_back (ident);
 
-          // append ep args
-          std::vector <std::string> epargs = saga::adaptors::utils::split (ep->args_, ' ');
-          for ( unsigned int a = 0; a < epargs.size (); a++ )
-          {
-            args.push_back (epargs[a]);
-          }
+//////////////////////////////////////////////////////////////////////
+//
+// submit all jobs for one endpoint.  Runs on its own thread (see
+// job_starter_submit_main); per-attempt console output is collected in
+// a stringstream, and printed in one go under the client mutex, so that
+// the submission threads do not shred each others lines.
+//
+void job_starter::submit_jobs (unsigned int e, unsigned int base)
+{
+  boost::shared_ptr <endpoint> ep = endpoints_[e];
+
+  if ( ! ep->valid_ )
+  {
+    return;
+  }
+
+  // first contact with the endpoint happens here, on this thread
+  struct timeval tv_validate;
+  ::gettimeofday (&tv_validate, NULL);
+
+  if ( ! ep->validate () )
+  {
+    cache_.record_fail (ep->name_);
+
+    pthread_mutex_lock (&client_mtx_);
+    std::cout << "endpoint  " << ep->name_
+              << " failed validation" << std::endl;
+    pthread_mutex_unlock (&client_mtx_);
+
+    return;
+  }
+
+  for ( unsigned int j = 0; j < ep->njobs_; j++ )
+  {
+    std::stringstream out;
+
+    try
+    {
+      int         jobnum = base + j;
+      std::string ident  = boost::lexical_cast <std::string> (jobnum);
+
+      // create a job description
+      saga::job::description jd;
+      jd.set_attribute (saga::job::attributes::description_executable, ep->exe_);
+
+      // client parameters:
+      // 0: path to advert directory to be used (job bucket)
+      // 1: jobnum, == name of work bucket for that job (is that in loop later)
+      std::vector <std::string> args;
+      args.push_back ("mandelbrot_client ");
+      args.push_back (a_dir_);
+      args.push_back (ident);
+
+      // append ep args
+      std::vector <std::string> epargs = saga::adaptors::utils::split (ep->args_, ' ');
+      for ( unsigned int a = 0; a < epargs.size (); a++ )
+      {
+        args.push_back (epargs[a]);
+      }
 
 
-          jd.set_vector_attribute (saga::job::attributes::description_arguments, args);
+      jd.set_vector_attribute (saga::job::attributes::description_arguments, args);
 
-          if ( ! ep->pwd_.empty () )
-          {
-            jd.set_attribute (saga::job::attributes::description_working_directory, ep->pwd_);
-          }
+      if ( ! ep->pwd_.empty () )
+      {
+        jd.set_attribute (saga::job::attributes::description_working_directory, ep->pwd_);
+      }
 
 #if 0
-          // let the clients store stdout/stderr to /tmp/mandelbrot_client.[id].out/err
-          // FIXME: this should get enabled once the bes adaptor supports it, and
-          // is able to stage the output files back into the pwd
-          {
-            std::string out;
-            std::string err;
-
-            out += "/tmp/mandelbrot_client." + ident + ".out";
-            err += "/tmp/mandelbrot_client." + ident + ".err";
-
-            jd.set_attribute (saga::job::attributes::description_output, out);
-            jd.set_attribute (saga::job::attributes::description_error,  err);
-          }
+      // let the clients store stdout/stderr to /tmp/mandelbrot_client.[id].out/err
+      // FIXME: this should get enabled once the bes adaptor supports it, and
+      // is able to stage the output files back into the pwd
+      {
+        std::string out;
+        std::string err;
+
+        out += "/tmp/mandelbrot_client." + ident + ".out";
+        err += "/tmp/mandelbrot_client." + ident + ".err";
+
+        jd.set_attribute (saga::job::attributes::description_output, out);
+        jd.set_attribute (saga::job::attributes::description_error,  err);
+      }
 #endif
 
-          ep->cnt_jreq_++;
-          std::cout << "starting  job "
-                    << ident
-                    << " on "
-                    << ep->name_ 
-                    << " \t ... " << std::flush;
-
-
-          saga::job::job j = ep->service_.create_job (jd);
-
-          j.run ();
-
-          if ( saga::job::Running != j.get_state () )
-          {
-            std::cout << "failure - could not run " 
-                      << ep->exe_ << " " << ep->args_ 
-                      << std::endl;
-            j.cancel (); // clean up resources
-
-            ep->log_ << "job spawning failed [1]: " << ep->exe_ << " " << ep->args_ << "\n";
-
-            // do not use this job
-          }
-          else
-          {
-            // keep job (wrapped in client)
-            boost::shared_ptr <client> c (new client (ident, j, ep)); 
-            clients_.push_back (c);
-            client_map_[c->id_] = c;
-
-            // store full jobid in ep log
-            ep->cnt_jrun_++;
-            std::cout << "ok "              << c->id_short_ << std::endl;
-            ep->log_  << "spawned client "  << jobnum 
-                      << " on "             << ep->name_ 
-                      << ": "               << c->id_short_
-                      << "\n";
-          }
-
-          if ( debug_ )
-          {
-            std::cout << " command       : " << ep->exe_;
-            for ( unsigned int i = 0; i < args.size (); i++ )
-            {
-              std::cout << " " << args[i];
-            }
-            std::cout <<  std::endl;
-          }
-        }
-        catch ( const saga::exception & e )
-        {
-          std::cout << "failure - could not start exe " << ep->exe_ << " " << ep->args_ 
-                    << std::endl;
-          ep->log_  << "job spawning failed [2]: " << ep->exe_ << " " << ep->args_ << "\n" << e.what () << "\n\n";
-        }
-        catch ( const std::exception & e )
-        {
-          std::cout << "failure - could not start exe " << ep->exe_ << " " << ep->args_ 
-                    << std::endl;
-          ep->log_ << "job spawning failed [2]: " << ep->exe_ << " " << ep->args_ << "\n" << e.what () << "\n\n";
-        }
-        catch ( char const * s )
-        {
-          std::cout << "failure - could not start exe " << ep->exe_ << " " << ep->args_ 
-                    << std::endl;
-          ep->log_ << "job spawning failed [2]: " << ep->exe_ << " " << ep->args_ << "\n" << s << "\n\n";
-        }
-        catch ( ... )
+      ep->cnt_jreq_++;
+      out << "starting  job "
+          << ident
+          << " on "
+          << ep->name_
+          << " \t ... ";
+
+
+      saga::job::job job = ep->service_.create_job (jd);
+
+      job.run ();
+
+      if ( saga::job::Running != job.get_state () )
+      {
+        out << "failure - could not run "
+            << ep->exe_ << " " << ep->args_
+            << "\n";
+        job.cancel (); // clean up resources
+
+        ep->log_ << "job spawning failed [1]: " << ep->exe_ << " " << ep->args_ << "\n";
+
+        // do not use this job
+      }
+      else
+      {
+        // keep job (wrapped in client)
+        boost::shared_ptr <client> c (new client (ident, job, ep));
+
+        // store full jobid in ep log
+        ep->cnt_jrun_++;
+        out << "ok "              << c->id_short_ << "\n";
+        ep->log_  << "spawned client "  << jobnum
+                  << " on "             << ep->name_
+                  << ": "               << c->id_short_
+                  << "\n";
+
+        pthread_mutex_lock (&client_mtx_);
+        clients_.push_back (c);
+        client_map_[c->id_] = c;
+        num_map_   [jobnum] = c;
+        pthread_mutex_unlock (&client_mtx_);
+      }
+
+      if ( debug_ )
+      {
+        out << " command       : " << ep->exe_;
+        for ( unsigned int i = 0; i < args.size (); i++ )
         {
-          std::cout << "failure - could not start exe " << ep->exe_ << " " << ep->args_ 
-                    << std::endl;
-          ep->log_ << "job spawning failed [2]: " << ep->exe_ << " " << ep->args_ << "\n";
+          out << " " << args[i];
         }
+        out << "\n";
       }
     }
+    catch ( const saga::exception & ex )
+    {
+      out << "failure - could not start exe " << ep->exe_ << " " << ep->args_
+          << "\n";
+      ep->log_  << "job spawning failed [2]: " << ep->exe_ << " " << ep->args_ << "\n" << ex.what () << "\n\n";
+    }
+    catch ( const std::exception & ex )
+    {
+      out << "failure - could not start exe " << ep->exe_ << " " << ep->args_
+          << "\n";
+      ep->log_ << "job spawning failed [2]: " << ep->exe_ << " " << ep->args_ << "\n" << ex.what () << "\n\n";
+    }
+    catch ( char const * s )
+    {
+      out << "failure - could not start exe " << ep->exe_ << " " << ep->args_
+          << "\n";
+      ep->log_ << "job spawning failed [2]: " << ep->exe_ << " " << ep->args_ << "\n" << s << "\n\n";
+    }
+    catch ( ... )
+    {
+      out << "failure - could not start exe " << ep->exe_ << " " << ep->args_
+          << "\n";
+      ep->log_ << "job spawning failed [2]: " << ep->exe_ << " " << ep->args_ << "\n";
+    }
+
+    pthread_mutex_lock (&client_mtx_);
+    std::cout << out.str () << std::flush;
+    pthread_mutex_unlock (&client_mtx_);
   }
 
-  if ( clients_.size () == 0 )
+  // fold the outcome into the liveness cache: rolling average wall
+  // time per submitted job, consulted (and printed) by the next run
+  struct timeval tv_done;
+  ::gettimeofday (&tv_done, NULL);
+
+  double total_ms = (tv_done.tv_sec  - tv_validate.tv_sec ) * 1000.0
+                  + (tv_done.tv_usec - tv_validate.tv_usec) / 1000.0;
+
+  if ( ep->cnt_jrun_ > 0 )
+  {
+    cache_.record_ok (ep->name_, total_ms / ep->cnt_jrun_);
+  }
+  else
   {
-    throw "Could not start any jobs!";
+    cache_.record_fail (ep->name_);
   }
 }
 
 
+//////////////////////////////////////////////////////////////////////
+//
+// the submission thread main routine: unpack the argument, and run the
+// per-endpoint submission loop
+//
+void * job_starter_submit_main (void * arg)
+{
+  job_starter::submit_arg_t * sa = (job_starter::submit_arg_t *) arg;
+
+  sa->js->submit_jobs (sa->ep, sa->base);
+
+  return NULL;
+}
+
+
 job_starter::~job_starter (void)
 {
+  // collect the background submission threads of demoted endpoints
+  for ( unsigned int e = 0; e < endpoints_.size (); e++ )
+  {
+    if ( pending_[e] )
+    {
+      pthread_join (tids_[e], NULL);
+      pending_[e] = false;
+    }
+  }
+
   for ( unsigned int e = 0; e < endpoints_.size (); e++ )
   {
     std::cout << "closing   endpoint " << e << std::endl;
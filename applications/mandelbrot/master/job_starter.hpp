@@ -6,22 +6,60 @@
 #include <string>
 #include <vector>
 
+#include <pthread.h>
+
 #include <saga/saga.hpp>
 
 #include "ini.hpp"
 #include "endpoint.hpp"
+#include "endpoint_cache.hpp"
 #include "client.hpp"
 
-class job_starter 
+// thread main of the per-endpoint submission threads (see submit_jobs)
+void * job_starter_submit_main (void * arg);
+
+class job_starter
 {
   private:
     mb_util::ini::section   ini_;
+    std::string             a_dir_;
     std::vector <boost::shared_ptr <endpoint> > endpoints_;
     std::vector <boost::shared_ptr <client>   > clients_;
 
     // the client_map_ allows to map from a job id to the respective client
-    // instance
+    // instance; num_map_ maps from the client number.  Client numbers are
+    // handed out in per-endpoint blocks, so failed submissions leave gaps -
+    // the client number is thus *not* an index into clients_.
     std::map    <std::string, boost::shared_ptr <client> > client_map_;
+    std::map    <int,         boost::shared_ptr <client> > num_map_;
+
+    // jobs are submitted by one thread per endpoint; this is the thread
+    // argument, and the mutex serializes access to the client containers
+    // (and to stdout)
+    struct submit_arg_t
+    {
+      job_starter * js;
+      unsigned int  ep;    // index into endpoints_
+      unsigned int  base;  // first client number for this endpoint
+    };
+
+    pthread_mutex_t client_mtx_;
+
+    // endpoint liveness, persisted between runs.  Endpoints whose
+    // last validation failed are demoted: their submission threads
+    // run in the background (joined in the d'tor, not the c'tor), so
+    // a dead gatekeeper's connect timeout does not delay the render.
+    endpoint_cache             cache_;
+
+    // thread state must outlive the c'tor - demoted endpoints keep
+    // submitting while the render runs
+    std::vector <submit_arg_t> sargs_;
+    std::vector <pthread_t>    tids_;
+    std::vector <bool>         pending_;  // started, not yet joined
+
+    void submit_jobs (unsigned int ep, unsigned int base);
+
+    friend void * job_starter_submit_main (void * arg);
 
     bool debug_;
 
@@ -32,14 +70,33 @@ class job_starter
                   mb_util::ini::ini ini);   // control data
     ~job_starter (void);
 
+    // accessors lock: demoted endpoints keep registering clients in
+    // the background while the render runs
     std::vector <boost::shared_ptr <client> > get_clients (void)
     {
-      return clients_;
+      pthread_mutex_lock   (&client_mtx_);
+      std::vector <boost::shared_ptr <client> > ret = clients_;
+      pthread_mutex_unlock (&client_mtx_);
+
+      return ret;
     }
 
     boost::shared_ptr <client> get_client (std::string id)
     {
-      return client_map_[id];
+      pthread_mutex_lock   (&client_mtx_);
+      boost::shared_ptr <client> ret = client_map_[id];
+      pthread_mutex_unlock (&client_mtx_);
+
+      return ret;
+    }
+
+    boost::shared_ptr <client> get_client (int num)
+    {
+      pthread_mutex_lock   (&client_mtx_);
+      boost::shared_ptr <client> ret = num_map_[num];
+      pthread_mutex_unlock (&client_mtx_);
+
+      return ret;
     }
 
 };
@@ -1,15 +1,21 @@
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <arpa/inet.h>
 
 #include <complex>
 #include <sstream>
+#include <fstream>
 #include <iostream>
 #include <string>
 
 #include <saga/saga/adaptors/utils.hpp>
 
 #include "mandelbrot.hpp"
+#include "ini_bind.hpp"
+
+#include "output_null.hpp"
 
 #ifdef HAVE_X11
 # include "output_x11.hpp"
@@ -17,6 +23,7 @@
 
 #ifdef HAVE_PNG
 # include "output_png.hpp"
+# include "output_png_stream.hpp"
 #endif
 
 namespace util 
@@ -38,7 +45,7 @@ namespace util
 //
 // constructor
 //
-mandelbrot::mandelbrot (void)
+mandelbrot::mandelbrot (bool bench)
 {
   ////////////////////////////////////////////////////////////////////
   // mandelbrot assumes it runs in some working directory.  
@@ -94,32 +101,84 @@ mandelbrot::mandelbrot (void)
   ini_ = mb_util::ini::ini (ini_file_);
   mb_util::ini::section cfg = ini_.get_section ("mandelbrot");
 
-  // job bucket container
-  advert_dir_         =         cfg.get_entry ("advert_dir" , "/tmp/");
-
-  // mandelbrot algorithm parameters
-  plane_x_0_          = ::atof (cfg.get_entry ("plane_x_0" , "-2.0").c_str ());
-  plane_y_0_          = ::atof (cfg.get_entry ("plane_y_0" , "-1.0").c_str ());
-  plane_x_1_          = ::atof (cfg.get_entry ("plane_x_1" , "+1.0").c_str ());
-  plane_y_1_          = ::atof (cfg.get_entry ("plane_y_1" , "+1.0").c_str ());
-  limit_              = ::atoi (cfg.get_entry ("limit"     , " 256").c_str ());
-  escape_             = ::atoi (cfg.get_entry ("escape"    , "   4").c_str ());
-
-  // work item definitions (box == work item)
-  img_size_x_         = ::atoi (cfg.get_entry ("img_size_x", "1200").c_str ());
-  img_size_y_         = ::atoi (cfg.get_entry ("img_size_y", " 800").c_str ());
-  box_num_x_          = ::atoi (cfg.get_entry ("box_num_x" , "   2").c_str ());
-  box_num_y_          = ::atoi (cfg.get_entry ("box_num_y" , "  10").c_str ());
+  // typed, table style binding of the section (see ini_bind.hpp):
+  // every mistyped entry is reported in one go, and the run aborts
+  // here - before any endpoint spins up
+  bool        use_out_dev_x11;
+  bool        use_out_dev_png;
+  bool        use_out_dev_png_stream;
+  bool        use_out_dev_null;
+  std::string out_png_file;
+
+  mb_util::ini::binder bind (cfg);
+
+      // job bucket container
+  bind.bind ("advert_dir"           , advert_dir_            , "/tmp/")
+
+      // mandelbrot algorithm parameters
+      .bind ("plane_x_0"            , plane_x_0_             , -2.0)
+      .bind ("plane_y_0"            , plane_y_0_             , -1.0)
+      .bind ("plane_x_1"            , plane_x_1_             , +1.0)
+      .bind ("plane_y_1"            , plane_y_1_             , +1.0)
+      .bind ("limit"                , limit_                 ,  256)
+      .bind ("escape"               , escape_                ,    4)
+
+      // work item definitions (box == work item)
+      .bind ("img_size_x"           , img_size_x_            , 1200)
+      .bind ("img_size_y"           , img_size_y_            ,  800)
+      .bind ("box_num_x"            , box_num_x_             ,    2)
+      .bind ("box_num_y"            , box_num_y_             ,   10)
+
+      // adaptive box sizing: compute time threshold (ms) above which
+      // clients split a box and re-queue the halves (0 = off)
+      .bind ("split_ms"             , split_ms_              , 1000)
+
+      // frame-to-frame reuse for zoom sequences (the demo configs
+      // render one frame per run): max_scale bounds how much coarser
+      // the cached resolution may be before a box counts as new detail
+      .flag ("frame_cache"          , frame_cache_on_        , false)
+      .bind ("frame_cache_file"     , frame_cache_file_      , "mandelbrot.frame")
+      .bind ("frame_cache_max_scale", frame_cache_max_scale_ , 1.5)
+
+      // binary result channel endpoint (empty = use advert attributes)
+      .bind ("stream_url"           , stream_url_            , "")
+
+      // streaming work mode: endpoint over which boxes get pushed to
+      // the clients, and the per-client in-flight window (empty url =
+      // advert queue dispatch)
+      .bind ("work_url"             , work_url_              , "")
+      .bind ("work_window"          , work_window_           , 4)
+
+      // requested output devices
+      .flag ("output_device_x11"       , use_out_dev_x11        , false)
+      .flag ("output_device_png"       , use_out_dev_png        , false)
+      .flag ("output_device_png_stream", use_out_dev_png_stream , false)
+      .flag ("output_device_null"      , use_out_dev_null       , false)
+      .bind ("output_png_filename"     , out_png_file           , "mandelbrot.png")
+
+      // flags
+      .flag ("debug"                , debug_                 , false);
+
+  bind.check (ini_file_ + " [mandelbrot]");
+
+  // a benchmark run (--bench) measures the dispatch fabric itself, so
+  // the null device replaces whatever devices the ini requested -
+  // neither X11 nor PNG encoding is allowed to distort the numbers
+  if ( bench )
+  {
+    use_out_dev_x11        = false;
+    use_out_dev_png        = false;
+    use_out_dev_png_stream = false;
+    use_out_dev_null       = true;
+  }
 
   box_size_x_         = floor (img_size_x_ / box_num_x_);
   box_size_y_         = floor (img_size_y_ / box_num_y_);
 
-  // check if we suport the requested device
-  std::string use_out_dev_x11 = cfg.get_entry ("output_device_x11" , "no");
-  std::string use_out_dev_png = cfg.get_entry ("output_device_png" , "no");
-
-  // flags
-  debug_              = ::atoi (cfg.get_entry ("output_device_png" , "0").c_str ());
+  stream_run_         = 0;
+  work_run_           = 0;
+  work_remaining_     = 0;
+  cleanup_run_        = 0;
 
   ////////////////////////////////////////////////////////////////////
   //
@@ -134,6 +193,55 @@ mandelbrot::mandelbrot (void)
   ::chdir (pwd_.c_str ());
 
 
+  ////////////////////////////////////////////////////////////////////
+  //
+  // load the per-region cost records of the previous run, if any.
+  // Regions which were expensive last time get decomposed finer right
+  // away (see compute) - on zoom sequences, successive frames revisit
+  // the same expensive regions, so this seeds a much better initial
+  // load balance.
+  //
+  {
+    std::ifstream costs ("mandelbrot.cost");
+
+    int region;
+    int cost;
+
+    while ( costs >> region >> cost )
+    {
+      region_cost_[region] = cost;
+    }
+
+    if ( region_cost_.size () )
+    {
+      std::cout << "costs   : " << region_cost_.size ()
+                << " region(s) from mandelbrot.cost" << std::endl;
+    }
+  }
+
+
+  ////////////////////////////////////////////////////////////////////
+  //
+  // load the previous frame, if frame reuse is enabled.  Consecutive
+  // frames of a zoom sequence share most of the plane, so boxes
+  // covered by the last frame get rescaled instead of recomputed
+  // (see compute).
+  //
+  if ( frame_cache_on_ )
+  {
+    if ( prev_frame_.load (frame_cache_file_) )
+    {
+      std::cout << "frame   : cached frame from "
+                << frame_cache_file_ << std::endl;
+    }
+
+    // collect this frame for the next run; -1 marks pixels we never
+    // received (those must not be reused)
+    frame_counts_.assign ((box_size_x_ * box_num_x_) *
+                          (box_size_y_ * box_num_y_), -1);
+  }
+
+
   ////////////////////////////////////////////////////////////////////
   //
   // init output devices
@@ -144,7 +252,7 @@ mandelbrot::mandelbrot (void)
   //
   // init X11 device
   //
-  if ( use_out_dev_x11 == "yes" )
+  if ( use_out_dev_x11 )
   {
 #ifdef HAVE_X11
     // initialize output device
@@ -168,10 +276,10 @@ mandelbrot::mandelbrot (void)
   //
   // init png device
   //
-  if ( use_out_dev_png == "yes" )
+  if ( use_out_dev_png )
   {
 #ifdef HAVE_PNG
-    std::string file = cfg.get_entry ("output_png_filename" , "mandelbrot.png");
+    std::string file = out_png_file;
     output_base * dev = new output_png (box_size_x_ * box_num_x_, // window size, x
                                         box_size_y_ * box_num_y_, // window size, y
                                         limit_,                   // number of colors
@@ -188,6 +296,54 @@ mandelbrot::mandelbrot (void)
 #endif
   }
 
+
+  //////////////////////////////////////////////////////////////////////
+  //
+  // init streaming png device.  Unlike the plain png device, this one
+  // does not buffer the full image, but encodes completed row bands as
+  // boxes arrive - the device of choice for very large renders.
+  //
+  if ( use_out_dev_png_stream )
+  {
+#ifdef HAVE_PNG
+    std::string file = out_png_file;
+    output_base * dev = new output_png_stream (box_size_x_ * box_num_x_, // window size, x
+                                               box_size_y_ * box_num_y_, // window size, y
+                                               limit_,                   // number of colors
+                                               file);                    // output file name
+    if ( NULL == dev )
+    {
+      throw "could not init streaming png output device";
+    }
+
+    odevs_.push_back (dev);
+    std::cout << "png-stream ";
+#else
+    std::cerr << "warning: output device png-stream is not supported" << std::endl;
+#endif
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  //
+  // init null benchmark device.  It validates and discards incoming
+  // boxes, and reports per-client work item latencies and the
+  // aggregate pixel throughput on shutdown (see output_null.hpp).
+  //
+  if ( use_out_dev_null )
+  {
+    output_base * dev = new output_null (box_size_x_ * box_num_x_, // window size, x
+                                         box_size_y_ * box_num_y_, // window size, y
+                                         limit_);                  // number of colors
+    if ( NULL == dev )
+    {
+      throw "could not init null output device";
+    }
+
+    odevs_.push_back (dev);
+    std::cout << "null ";
+  }
+
+
   // out devices
   std::cout << std::endl;
 
@@ -238,6 +394,66 @@ mandelbrot::mandelbrot (void)
   job_bucket_.set_attribute ("img_size_y", boost::lexical_cast <std::string> (img_size_y_));
   job_bucket_.set_attribute ("box_num_x" , boost::lexical_cast <std::string> (box_num_x_ ));
   job_bucket_.set_attribute ("box_num_y" , boost::lexical_cast <std::string> (box_num_y_ ));
+  job_bucket_.set_attribute ("split_ms"  , boost::lexical_cast <std::string> (split_ms_  ));
+
+  //////////////////////////////////////////////////////////////////////
+  //
+  // start the binary result channel, if configured.  Its url is
+  // published on the job bucket - the advert stays in use for
+  // discovery and claiming only.
+  //
+  if ( ! stream_url_.empty () )
+  {
+    job_bucket_.set_attribute ("stream_url", stream_url_);
+
+    ::pthread_mutex_init (&frame_mtx_, NULL);
+
+    stream_run_ = 1;
+
+    if ( 0 != ::pthread_create (&stream_tid_, NULL,
+                                mandelbrot_stream_main, this) )
+    {
+      stream_run_ = 0;
+      std::cerr << "warning: could not start result stream listener" << std::endl;
+    }
+    else
+    {
+      std::cout << "stream  : " << stream_url_ << std::endl;
+    }
+  }
+
+
+  //////////////////////////////////////////////////////////////////////
+  //
+  // start the streaming work channel, if configured.  Its url is
+  // published on the job bucket - clients which see it connect once
+  // and get their boxes pushed, instead of polling the advert queue.
+  //
+  if ( ! work_url_.empty () )
+  {
+    if ( work_window_ < 1 )
+    {
+      work_window_ = 1;
+    }
+
+    job_bucket_.set_attribute ("work_url", work_url_);
+
+    ::pthread_mutex_init (&work_mtx_, NULL);
+
+    work_run_ = 1;
+
+    if ( 0 != ::pthread_create (&work_tid_, NULL,
+                                mandelbrot_work_main, this) )
+    {
+      work_run_ = 0;
+      std::cerr << "warning: could not start work channel listener" << std::endl;
+    }
+    else
+    {
+      std::cout << "work    : " << work_url_
+                << " (window " << work_window_ << ")" << std::endl;
+    }
+  }
 
 
   //////////////////////////////////////////////////////////////////////
@@ -247,39 +463,670 @@ mandelbrot::mandelbrot (void)
   //
   job_startup ();
 
-  //////////////////////////////////////////////////////////////////////
-}
+  //////////////////////////////////////////////////////////////////////
+}
+
+
+
+///////////////////////////////////////////////////////////////////////
+//
+// on destruction, we close the output device and terminate all
+// clients which did not end by themself.  Also, remove the job
+// bucket, to keep the advert service free of trash.
+//
+mandelbrot::~mandelbrot (void)
+{
+  // stop the result stream listener
+  if ( stream_run_ )
+  {
+    stream_run_ = 0;
+    ::pthread_join (stream_tid_, NULL);
+  }
+
+  // stop the work channel listener (it joins its connection threads)
+  if ( work_run_ )
+  {
+    work_run_ = 0;
+    ::pthread_join (work_tid_, NULL);
+  }
+
+  // Usually, we don't need to cancel clients, as they'll terminate
+  // when running out of work.  But in case we finish
+  // prematurely, we take care of termination
+  for ( unsigned int i = 0; i < clients_.size (); i++)
+  {
+    std::cout << "cancel    job " << i << std::endl;
+    clients_[i]->cancel ();
+  }
+
+
+  // wait for the background bucket teardown (see compute).  If it
+  // never started - we finished prematurely - take the bucket down
+  // now, after the clients are gone.
+  if ( cleanup_run_ )
+  {
+    ::pthread_join (cleanup_tid_, NULL);
+    cleanup_run_ = 0;
+  }
+  else
+  {
+    bucket_cleanup ();
+  }
+
+
+  // close output devices
+  for ( unsigned int d = 0; d < odevs_.size (); d++ )
+  {
+    delete odevs_[d];
+    odevs_[d] = NULL;
+  }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////
+//
+// remove this session's job bucket from the advert service.  We first
+// try the one-shot server side recursive remove - where the adaptor
+// supports it, the whole bucket is gone in a single round trip.
+// Adaptors without recursive remove throw, and we fall back to taking
+// the entries down as bulks of asynchronous removes, depth first.
+//
+// thread main needs C linkage for pthread_create
+void * mandelbrot_cleanup_main (void * arg)
+{
+  ((mandelbrot *) arg)->bucket_cleanup ();
+  return NULL;
+}
+
+void mandelbrot::bucket_cleanup (void)
+{
+  try
+  {
+    job_bucket_.remove (saga::advert::Recursive);
+
+    std::cout << "cleanup : job bucket removed (recursive)" << std::endl;
+    return;
+  }
+  catch ( saga::exception const & )
+  {
+    // no server side recursion - remove the entries in parallel
+  }
+
+  try
+  {
+    cleanup_dir_ (job_bucket_);
+
+    std::cout << "cleanup : job bucket removed (parallel)" << std::endl;
+  }
+  catch ( saga::exception const & e )
+  {
+    // teardown is best effort: leftover entries cost advert service
+    // space, not correctness
+    std::cout << "cleanup : incomplete - " << e.what () << std::endl;
+  }
+}
+
+// empty one advert directory: subdirectories are emptied recursively,
+// the plain entries go out as one bulk of asynchronous removes, then
+// the directory itself is removed
+void mandelbrot::cleanup_dir_ (saga::advert::directory & dir)
+{
+  std::vector <saga::url> entries = dir.list ("*");
+
+  std::vector <saga::task> tasks;
+
+  for ( unsigned int i = 0; i < entries.size (); i++ )
+  {
+    if ( dir.is_dir (entries[i]) )
+    {
+      saga::advert::directory sub = dir.open_dir (entries[i],
+                                                  saga::advert::ReadWrite);
+      cleanup_dir_ (sub);
+    }
+    else
+    {
+      tasks.push_back (dir.remove <saga::task_base::Async> (entries[i],
+                                                            saga::advert::None));
+    }
+  }
+
+  for ( unsigned int i = 0; i < tasks.size (); i++ )
+  {
+    try
+    {
+      tasks[i].wait ();
+    }
+    catch ( saga::exception const & )
+    {
+      // already gone
+    }
+  }
+
+  dir.remove ();
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//
+// the result stream listener thread.
+//
+// thread main needs C linkage for pthread_create
+void * mandelbrot_stream_main (void * arg)
+{
+  ((mandelbrot *) arg)->stream_listen ();
+  return NULL;
+}
+
+
+// read exactly 'want' bytes off the stream (it may deliver less per
+// call); false on error or connection close
+static bool read_exact (saga::stream::stream & s, char * buf, unsigned int want)
+{
+  unsigned int got = 0;
+
+  while ( got < want )
+  {
+    saga::ssize_t n = s.read (saga::buffer (buf + got, want - got), want - got);
+
+    if ( n <= 0 )
+    {
+      return false;
+    }
+
+    got += n;
+  }
+
+  return true;
+}
+
+
+// write the full buffer onto the stream; false on error
+static bool write_exact (saga::stream::stream & s, char * buf, unsigned int len)
+{
+  unsigned int sent = 0;
+
+  while ( sent < len )
+  {
+    saga::ssize_t n = s.write (saga::buffer (buf + sent, len - sent),
+                               len - sent);
+
+    if ( n <= 0 )
+    {
+      return false;
+    }
+
+    sent += n;
+  }
+
+  return true;
+}
+
+
+// accept client connections, and read length-prefixed result frames:
+//
+//   uint32 payload length  |  uint32 name length, name,
+//                             uint32 count, count * int32 iterations
+//
+// all integers in network byte order.  Complete frames are queued for
+// compute() to paint.  Clients connect per frame, so one connection at
+// a time suffices.
+//
+void mandelbrot::stream_listen (void)
+{
+  try
+  {
+    saga::stream::server server (stream_url_);
+
+    while ( stream_run_ )
+    {
+      try
+      {
+        saga::stream::stream s = server.serve (1.0);
+
+        while ( true )
+        {
+          uint32_t len_n;
+
+          if ( ! read_exact (s, (char *) &len_n, 4) )
+          {
+            break;
+          }
+
+          uint32_t len = ntohl (len_n);
+
+          if ( len < 8 || len > (64 << 20) )
+          {
+            // bogus frame - drop the connection
+            break;
+          }
+
+          std::vector <char> payload (len);
+
+          if ( ! read_exact (s, &payload[0], len) )
+          {
+            break;
+          }
+
+          // parse the frame
+          uint32_t name_len = ntohl (*(uint32_t *) &payload[0]);
+
+          if ( 8 + name_len > len )
+          {
+            break;
+          }
+
+          frame_t frame;
+
+          frame.name.assign (&payload[4], name_len);
+
+          uint32_t count = ntohl (*(uint32_t *) &payload[4 + name_len]);
+
+          if ( 8 + name_len + 4 * count > len )
+          {
+            break;
+          }
+
+          frame.data.resize (count);
+
+          for ( uint32_t i = 0; i < count; i++ )
+          {
+            frame.data[i] =
+              (int) ntohl (*(uint32_t *) &payload[8 + name_len + 4 * i]);
+          }
+
+          ::pthread_mutex_lock   (&frame_mtx_);
+          frames_.push_back (frame);
+          ::pthread_mutex_unlock (&frame_mtx_);
+        }
+
+        s.close ();
+      }
+      catch ( const saga::exception & )
+      {
+        // serve timeout - check stream_run_ and go again
+      }
+    }
+
+    server.close ();
+  }
+  catch ( const saga::exception & e )
+  {
+    std::cerr << "warning: result stream listener failed: \n"
+              << e.what () << std::endl;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//
+// the work channel listener thread: accept client connections, and
+// hand each one to its own connection thread - a streaming client
+// holds one persistent connection for the whole run (see work_serve
+// and mandelbrot_client.cpp for the frame layouts).
+//
+// thread main needs C linkage for pthread_create
+void * mandelbrot_work_main (void * arg)
+{
+  ((mandelbrot *) arg)->work_listen ();
+  return NULL;
+}
+
+
+// per-connection handoff to the connection threads
+struct work_conn_t
+{
+  mandelbrot           * mb;
+  saga::stream::stream   s;
+
+  work_conn_t (mandelbrot * m, saga::stream::stream stream)
+    : mb (m),
+      s  (stream)
+  {
+  }
+};
+
+void * mandelbrot_work_conn_main (void * arg)
+{
+  work_conn_t * conn = (work_conn_t *) arg;
+
+  conn->mb->work_serve (conn->s);
+
+  delete conn;
+  return NULL;
+}
+
+
+void mandelbrot::work_listen (void)
+{
+  std::vector <pthread_t> conns;
+
+  try
+  {
+    saga::stream::server server (work_url_);
+
+    while ( work_run_ )
+    {
+      try
+      {
+        saga::stream::stream s = server.serve (1.0);
+
+        work_conn_t * conn = new work_conn_t (this, s);
+
+        pthread_t tid;
+
+        if ( 0 == ::pthread_create (&tid, NULL,
+                                    mandelbrot_work_conn_main, conn) )
+        {
+          conns.push_back (tid);
+        }
+        else
+        {
+          delete conn;
+        }
+      }
+      catch ( const saga::exception & )
+      {
+        // serve timeout - check work_run_ and go again
+      }
+    }
+
+    server.close ();
+  }
+  catch ( const saga::exception & e )
+  {
+    std::cerr << "warning: work channel listener failed: \n"
+              << e.what () << std::endl;
+  }
+
+  for ( unsigned int i = 0; i < conns.size (); i++ )
+  {
+    ::pthread_join (conns[i], NULL);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//
+// serve one streaming client: read its hello frame, then keep up to
+// work_window_ boxes in flight on the connection - every result frame
+// frees a slot, and the refill goes out right away, so the client
+// always has its next box queued locally.  Splits are adopted into
+// the work queue here; a failing connection re-queues its in-flight
+// boxes for the remaining clients.
+//
+void mandelbrot::work_serve (saga::stream::stream s)
+{
+  std::string worker ("?");
+
+  std::map <std::string, work_box_t> inflight;
+
+  try
+  {
+    uint32_t len_n;
+
+    // hello frame: the payload is the client's job number
+    if ( read_exact (s, (char *) &len_n, 4) )
+    {
+      uint32_t len = ntohl (len_n);
+
+      if ( len > 0 && len <= 64 )
+      {
+        std::vector <char> payload (len);
+
+        if ( read_exact (s, &payload[0], len) )
+        {
+          worker.assign (&payload[0], len);
+        }
+      }
+    }
+
+    if ( worker == "?" )
+    {
+      s.close ();
+      return;
+    }
+
+    std::cout << "work    : client " << worker << " connected" << std::endl;
+
+    while ( work_run_ )
+    {
+      // refill the client's window from the work queue
+      std::vector <work_box_t> to_send;
+      bool                     drained = false;
+
+      ::pthread_mutex_lock (&work_mtx_);
+
+      while ( (int) (inflight.size () + to_send.size ()) < work_window_ &&
+              ! work_pending_.empty () )
+      {
+        to_send.push_back (work_pending_.front ());
+        work_pending_.pop_front ();
+      }
+
+      if ( inflight.empty () && to_send.empty () )
+      {
+        drained = ( 0 == work_remaining_ );
+      }
+
+      ::pthread_mutex_unlock (&work_mtx_);
+
+      bool ok = true;
+
+      for ( unsigned int i = 0; ok && i < to_send.size (); i++ )
+      {
+        const work_box_t & box = to_send[i];
+
+        uint32_t name_len = box.name.size ();
+
+        std::vector <char> buf (4 + 4 + name_len + 20);
+
+        char * p = &buf[0];
+
+        *(uint32_t *) p = htonl (4 + name_len + 20);      p += 4;
+        *(uint32_t *) p = htonl (name_len);               p += 4;
+
+        ::memcpy (p, box.name.c_str (), name_len);        p += name_len;
+
+        *(uint32_t *) p = htonl ((uint32_t) box.boxnum);  p += 4;
+        *(uint32_t *) p = htonl ((uint32_t) box.off_x );  p += 4;
+        *(uint32_t *) p = htonl ((uint32_t) box.off_y );  p += 4;
+        *(uint32_t *) p = htonl ((uint32_t) box.size_x);  p += 4;
+        *(uint32_t *) p = htonl ((uint32_t) box.size_y);  p += 4;
+
+        if ( write_exact (s, &buf[0], buf.size ()) )
+        {
+          inflight[box.name] = box;
+        }
+        else
+        {
+          // channel failed - the unsent boxes go back into the queue
+          ok = false;
+
+          ::pthread_mutex_lock (&work_mtx_);
+
+          for ( unsigned int j = i; j < to_send.size (); j++ )
+          {
+            work_pending_.push_back (to_send[j]);
+          }
+
+          ::pthread_mutex_unlock (&work_mtx_);
+        }
+      }
+
+      if ( ! ok )
+      {
+        break;
+      }
+
+      if ( drained )
+      {
+        // the run is complete - drain the client
+        char buf[8];
+
+        *(uint32_t *) &buf[0] = htonl (4);
+        *(uint32_t *) &buf[4] = htonl (0);
+
+        write_exact (s, buf, 8);
+        break;
+      }
+
+      if ( inflight.empty () )
+      {
+        // no work at hand, but other clients may still split boxes
+        ::usleep (100000);
+        continue;
+      }
+
+      // read one result frame
+      if ( ! read_exact (s, (char *) &len_n, 4) )
+      {
+        break;
+      }
+
+      uint32_t len = ntohl (len_n);
+
+      if ( len < 12 || len > (64 << 20) )
+      {
+        break;
+      }
+
+      std::vector <char> payload (len);
+
+      if ( ! read_exact (s, &payload[0], len) )
+      {
+        break;
+      }
+
+      uint32_t name_len = ntohl (*(uint32_t *) &payload[0]);
+
+      if ( 4 + name_len + 8 > len )
+      {
+        break;
+      }
+
+      std::string name (&payload[4], name_len);
+
+      char * p = &payload[4 + name_len];
+
+      uint32_t status  =        ntohl (*(uint32_t *) p);  p += 4;
+      long     cost_ms = (long) ntohl (*(uint32_t *) p);  p += 4;
+
+      std::map <std::string, work_box_t> :: iterator it = inflight.find (name);
+
+      if ( it == inflight.end () )
+      {
+        // not a box of ours - drop the connection
+        break;
+      }
+
+      work_box_t box = it->second;
+
+      inflight.erase (it);
+
+      if ( 0 == status )
+      {
+        if ( 4 + name_len + 12 > len )
+        {
+          break;
+        }
+
+        uint32_t count = ntohl (*(uint32_t *) p);  p += 4;
+
+        if ( 4 + name_len + 12 + 4 * count > len )
+        {
+          break;
+        }
+
+        work_done_t d;
+
+        d.box     = box;
+        d.worker  = worker;
+        d.cost_ms = cost_ms;
+
+        d.data.resize (count);
+
+        for ( uint32_t k = 0; k < count; k++ )
+        {
+          d.data[k] = (int) ntohl (*(uint32_t *) p);  p += 4;
+        }
+
+        ::pthread_mutex_lock (&work_mtx_);
+        work_done_.push_back (d);
+        work_remaining_--;
+        ::pthread_mutex_unlock (&work_mtx_);
+      }
+      else if ( 1 == status )
+      {
+        // the client found the box too expensive and split it - adopt
+        // the halves (two children replace one parent)
+        if ( 4 + name_len + 8 + 32 > len )
+        {
+          break;
+        }
+
+        work_box_t child_a = box;
+        work_box_t child_b = box;
 
+        child_a.name = box.name + "a";
+        child_b.name = box.name + "b";
 
+        child_a.off_x  = (int) ntohl (*(uint32_t *) p);  p += 4;
+        child_a.off_y  = (int) ntohl (*(uint32_t *) p);  p += 4;
+        child_a.size_x = (int) ntohl (*(uint32_t *) p);  p += 4;
+        child_a.size_y = (int) ntohl (*(uint32_t *) p);  p += 4;
 
-///////////////////////////////////////////////////////////////////////
-//
-// on destruction, we close the output device and terminate all
-// clients which did not end by themself.  Also, remove the job
-// bucket, to keep the advert service free of trash.
-//
-mandelbrot::~mandelbrot (void)
-{
-  // Usually, we don't need to cancel clients, as they'll terminate
-  // when running out of work.  But in case we finish
-  // prematurely, we take care of termination
-  for ( unsigned int i = 0; i < clients_.size (); i++)
+        child_b.off_x  = (int) ntohl (*(uint32_t *) p);  p += 4;
+        child_b.off_y  = (int) ntohl (*(uint32_t *) p);  p += 4;
+        child_b.size_x = (int) ntohl (*(uint32_t *) p);  p += 4;
+        child_b.size_y = (int) ntohl (*(uint32_t *) p);  p += 4;
+
+        std::cout << "adopting  box " << child_a.name
+                  << ", "             << child_b.name
+                  << " (split of "    << box.name
+                  << ")" << std::endl;
+
+        ::pthread_mutex_lock (&work_mtx_);
+        work_pending_.push_back (child_a);
+        work_pending_.push_back (child_b);
+        work_remaining_++;
+        ::pthread_mutex_unlock (&work_mtx_);
+      }
+      else
+      {
+        // bogus frame - drop the connection
+        break;
+      }
+    }
+
+    s.close ();
+  }
+  catch ( const saga::exception & )
   {
-    std::cout << "cancel    job " << i << std::endl;
-    clients_[i]->cancel ();
+    // connection failed
   }
 
-
-  // close output devices
-  for ( unsigned int d = 0; d < odevs_.size (); d++ )
+  // whatever is still in flight on this connection goes back into the
+  // queue, for the remaining clients
+  if ( inflight.size () )
   {
-    delete odevs_[d];
-    odevs_[d] = NULL;
+    std::cout << "work    : client " << worker << " lost - re-queueing "
+              << inflight.size () << " box(es)" << std::endl;
+
+    ::pthread_mutex_lock (&work_mtx_);
+
+    std::map <std::string, work_box_t> :: iterator it;
+
+    for ( it = inflight.begin (); it != inflight.end (); it++ )
+    {
+      work_pending_.push_back (it->second);
+    }
+
+    ::pthread_mutex_unlock (&work_mtx_);
   }
 }
 
 
-
 ///////////////////////////////////////////////////////////////////////
 //
 // start the client clients, and setup the work buckets
@@ -303,7 +1150,12 @@ void mandelbrot::job_startup (void)
   {
     if ( clients_[n]->valid_ )
     {
-      std::cout << "asking    job " << n << " to bootstrap \t ... " << std::flush;
+      // the client registers under its own number, which is not an
+      // index into clients_ (jobs are submitted per endpoint in
+      // parallel, and failed submissions leave numbering gaps)
+      std::string cnum = clients_[n]->name_;
+
+      std::cout << "asking    job " << cnum << " to bootstrap \t ... " << std::flush;
 
       int  time   = 0;
       bool check  = true;
@@ -312,8 +1164,8 @@ void mandelbrot::job_startup (void)
 
       while ( check )
       {
-        if ( ! job_bucket_.exists (util::itoa (n)) &&
-             ! job_bucket_.is_dir (util::itoa (n)) )
+        if ( ! job_bucket_.exists (cnum) &&
+             ! job_bucket_.is_dir (cnum) )
         {
           saga::job::state s = clients_[n]->get_state ();
 
@@ -348,7 +1200,7 @@ void mandelbrot::job_startup (void)
           // we also check the client's version.  Alas, we meet a race condition
           // here, as adverts don't support locks, yet.  So we allow again for
           // a timeout for the version tag to appear
-          saga::advert::directory job_dir = job_bucket_.open_dir (util::itoa (n),
+          saga::advert::directory job_dir = job_bucket_.open_dir (cnum,
                                                                   saga::advert::Read);
           bool version_check = true;
 
@@ -425,66 +1277,122 @@ int mandelbrot::compute (void)
   // the worker adverts
   std::vector <saga::advert::entry> ads;
 
-  // Schedule all boxes in round robin fashion over the
-  // available clients
+  // All boxes go into one shared work queue bucket, and the clients
+  // pull them from there: each client claims the next box atomically
+  // (see the exclusive claim adverts in mandelbrot_client.cpp), so a
+  // slow client no longer strands pre-assigned boxes while fast
+  // clients idle - frame completion tracks aggregate throughput.
+  //
+  // The bucket is sharded (see common/sharded_dir.hpp): with splitting
+  // active a frame can grow into thousands of entries, and a flat
+  // directory makes every list() O(entries) on the advert server.
+  sharded_dir::directory queue_dir (job_bucket_.open_dir ("queue",
+                                                          saga::advert::Create    |
+                                                          saga::advert::ReadWrite ),
+                                    saga::advert::Create    |
+                                    saga::advert::ReadWrite );
+
   unsigned int boxes_scheduled = 0;
-  unsigned int jobnum = 0;
+  unsigned int boxes_reused    = 0;
+
+  // plane resolution of this frame (the same mapping the clients use)
+  double plane_step_x = (plane_x_1_ - plane_x_0_) / (box_size_x_ * box_num_x_);
+  double plane_step_y = (plane_y_1_ - plane_y_0_) / (box_size_y_ * box_num_y_);
 
   for ( int x = 0; x < box_num_x_; x++ )
   {
     for ( int y = 0; y < box_num_y_; y++ )
     {
-      // serial number of box
+      // serial number of box == its region id for cost accounting
       int boxnum = x * box_num_y_ + y;
 
-      // this boxed is assigned to clients in round robin fashion
-      // so find next usable job (running state), and roll over 
-      // at clients_.size ();
-      jobnum++;
-      jobnum %= clients_.size ();
+      // pixel geometry of the box (same mapping the painting uses)
+      int off_x  = x * box_size_x_;
+      int off_y  = y * box_size_y_;
 
-      unsigned int rollover = 0;
-      while ( ! clients_[jobnum]->valid_ )
-      {
-        jobnum++;
-        jobnum %= clients_.size ();
+      std::string name = boost::lexical_cast <std::string> (boxnum);
 
-        rollover++;
-        if ( rollover > clients_.size () )
+      // boxes covered by the previous frame get rescaled from the
+      // cache and painted right away - only boundary and new-detail
+      // boxes are dispatched to the clients
+      if ( frame_cache_on_ && prev_frame_.usable (limit_, escape_) )
+      {
+        std::vector <std::vector <int> > data;
+
+        if ( prev_frame_.reuse (plane_x_0_ + off_x * plane_step_x,
+                                plane_step_x,
+                                plane_y_0_ + off_y * plane_step_y,
+                                plane_step_y,
+                                box_size_x_, box_size_y_,
+                                frame_cache_max_scale_,
+                                data) )
         {
-          throw "Can't find any job to assign boxes to.";
+          std::string id = name + " (cache)";
+
+          for ( unsigned int d = 0; d < odevs_.size (); d++ )
+          {
+            odevs_[d]->paint_box (off_x, box_size_x_,
+                                  off_y, box_size_y_,
+                                  data, id);
+          }
+
+          record_frame_counts_ (off_x, box_size_x_,
+                                off_y, box_size_y_, data);
+
+          std::cout << "reusing   box " << boxnum << " (cache)" << std::endl;
+          boxes_reused++;
+
+          continue;
         }
       }
 
-      std::cout << "assigning box " << boxnum
-                << " to job "       << jobnum 
-                << " ("             << clients_[jobnum]->ep_->name_ << ")"
-                << std::endl;
+      // regions which were expensive in the previous run get split
+      // right away, instead of waiting for a client to notice
+      int seed_cost = 0;
+
+      if ( region_cost_.find (boxnum) != region_cost_.end () )
+      {
+        seed_cost = region_cost_[boxnum];
+      }
 
-      // the clients work bucket is its jobnum, the work item advert
-      // is simply numbered by its serial number, i
-      std::stringstream advert_name;
-      advert_name << jobnum << "/" << boxnum;
+      if ( split_ms_   > 0         &&
+           seed_cost   > split_ms_ &&
+           box_size_x_ > 1         &&
+           box_size_y_ > 1         )
+      {
+        std::cout << "queueing  box " << boxnum
+                  << " (pre-split, cost " << seed_cost << "ms)" << std::endl;
 
-      // create a work item in the clients work bucket
-      saga::advert::entry ad = job_bucket_.open (advert_name.str (),
-                                                 saga::advert::Create        |
-                                                 saga::advert::CreateParents |
-                                                 saga::advert::ReadWrite     );
+        // split along the larger dimension
+        if ( box_size_x_ >= box_size_y_ )
+        {
+          int half = box_size_x_ / 2;
 
-      std::string boxnum_s = boost::lexical_cast <std::string> (boxnum);
+          dispatch_box (queue_dir, ads, name + "a", boxnum,
+                        off_x,        off_y, half,               box_size_y_);
+          dispatch_box (queue_dir, ads, name + "b", boxnum,
+                        off_x + half, off_y, box_size_x_ - half, box_size_y_);
+        }
+        else
+        {
+          int half = box_size_y_ / 2;
 
-      // signal for work to do: set boxnum to work on, and state to 'work'
-      ad.set_attribute ("boxnum", boxnum_s);
-      ad.set_attribute ("jobid", clients_[jobnum]->id_);
-      ad.set_attribute ("state", "work");
+          dispatch_box (queue_dir, ads, name + "a", boxnum,
+                        off_x, off_y,        box_size_x_, half);
+          dispatch_box (queue_dir, ads, name + "b", boxnum,
+                        off_x, off_y + half, box_size_x_, box_size_y_ - half);
+        }
 
-      // keep a list of active work items
-      ads.push_back (ad);
-      boxes_scheduled++;
+        boxes_scheduled += 2;
+      }
+      else
+      {
+        std::cout << "queueing  box " << boxnum << std::endl;
 
-      clients_[jobnum]->cnt_iass_++;
-      clients_[jobnum]->ep_->cnt_iass_++;
+        dispatch_box (queue_dir, ads, name, boxnum,
+                      off_x, off_y, box_size_x_, box_size_y_);
+        boxes_scheduled++;
+      }
     }
   }
 
@@ -498,6 +1406,50 @@ int mandelbrot::compute (void)
   unsigned int boxes_done =  0;
   bool         todo       = true;
 
+  // streaming dispatch: the work channel connections deliver finished
+  // boxes into work_done_ - paint them as they arrive, until no box
+  // is outstanding.  Splits are adopted by the connection threads
+  // directly, so they only surface here as two finished children.
+  while ( work_run_ && todo )
+  {
+    std::deque <work_done_t> got;
+    unsigned int             remaining;
+
+    ::pthread_mutex_lock (&work_mtx_);
+    got.swap (work_done_);
+    remaining = work_remaining_;
+    ::pthread_mutex_unlock (&work_mtx_);
+
+    for ( unsigned int f = 0; f < got.size (); f++ )
+    {
+      paint_work (got[f]);
+      boxes_done++;
+    }
+
+    if ( got.size () )
+    {
+      waited = 0;
+      continue;
+    }
+
+    if ( 0 == remaining )
+    {
+      // all boxes are in
+      todo = false;
+      continue;
+    }
+
+    if ( waited > max_wait )
+    {
+      std::cout << "waiting too long for more results - abort" << std::endl;
+      todo = false;
+      continue;
+    }
+
+    waited++;
+    ::sleep (timeout);
+  }
+
   while ( todo && ads.size () )
   {
     // if no box is done at all, we sleep for a bit.  On anything else, we loop
@@ -521,23 +1473,51 @@ int mandelbrot::compute (void)
         {
           // get data from client
           std::string       boxnum_s (ads[j].get_attribute ("boxnum"));
-          std::string       jobid_s  (ads[j].get_attribute ("jobid"));
+          std::string       worker_s (ads[j].get_attribute ("worker"));
           std::stringstream data_ss  (ads[j].get_attribute ("data"));
 
-          // log work item on client
-          js_->get_client (jobid_s)->cnt_iok_++;
-          js_->get_client (jobid_s)->ep_->cnt_iok_++;
+          // the claiming client identified itself by its jobnum
+          boost::shared_ptr <client> worker = js_->get_client (::atoi (worker_s.c_str ()));
+
+          // log work item on client - assignment happens at claim
+          // time now, so both counters tick on completion
+          if ( worker )
+          {
+            worker->cnt_iass_++;
+            worker->cnt_iok_++;
+            worker->ep_->cnt_iass_++;
+            worker->ep_->cnt_iok_++;
+          }
+
+          // work items carry their pixel geometry (boxes may be
+          // client-split fractions of the initial grid)
+          int box_off_x = ::atoi (ads[j].get_attribute ("off_x" ).c_str ());
+          int box_off_y = ::atoi (ads[j].get_attribute ("off_y" ).c_str ());
+          int size_x    = ::atoi (ads[j].get_attribute ("size_x").c_str ());
+          int size_y    = ::atoi (ads[j].get_attribute ("size_y").c_str ());
+
+          // record the measured compute cost on the box' region, for
+          // the cost file written below
+          try
+          {
+            cost_seen_[::atoi (boxnum_s.c_str ())] +=
+                ::atoi (ads[j].get_attribute ("cost").c_str ());
+          }
+          catch ( ... )
+          {
+            // clients of older vintage do not report costs
+          }
 
           // data to paint
           std::vector <std::vector <int> > data;
 
           // iterate over all lines in data set
-          for ( int k = 0; k < box_size_x_; k++ )
+          for ( int k = 0; k < size_x; k++ )
           {
             std::vector <int> line;
 
             // iterate over all pixels in line
-            for ( int l = 0; l < box_size_y_; l++ )
+            for ( int l = 0; l < size_y; l++ )
             {
               std::string num;
               data_ss >> num;
@@ -547,31 +1527,28 @@ int mandelbrot::compute (void)
             data.push_back (line);
           }
 
-          // calculate box coordinates from box_num
-          int boxnum = ::atoi (boxnum_s.c_str ());
-
-          // box indicee coordinates
-          int box_x  =        boxnum % box_num_y_ ;
-          int box_y  = floor (boxnum / box_num_y_);
-
-          // box pixel coordinates
-          int box_off_x = box_y * box_size_x_;
-          int box_off_y = box_x * box_size_y_;
-
-          std::string id = boxnum_s + " (" + js_->get_client (jobid_s)->ep_->name_ + ") " + jobid_s;
+          std::string id = boxnum_s + " (" +
+                           (worker ? worker->ep_->name_ : "?") + ") " + worker_s;
 
           for ( unsigned int d = 0; d < odevs_.size (); d++ )
           {
-            odevs_[d]->paint_box (box_off_x, box_size_x_,
-                                  box_off_y, box_size_y_,
+            odevs_[d]->paint_box (box_off_x, size_x,
+                                  box_off_y, size_y,
                                   data, id);
           }
 
-          std::cout << "painting  box " << boxnum_s  << std::endl;
+          record_frame_counts_ (box_off_x, size_x,
+                                box_off_y, size_y, data);
+
+          std::cout << "painting  box " << ads[j].get_attribute ("name")
+                    << std::endl;
           boxes_done++;
 
-          // remove finished ad
-          ads[j].remove ();
+          // tombstone the claim marker and the finished box - the
+          // removals go out in one batch per poll round
+          queue_dir.tombstone (ads[j].get_attribute ("name") + "_claim");
+          queue_dir.tombstone (ads[j].get_attribute ("name"));
+
           ads.erase (ads.begin () + j);
 
           j--; // make sure we don't skip the next ad
@@ -579,7 +1556,35 @@ int mandelbrot::compute (void)
           // may have more to do
           should_wait = false;
         }
-        else 
+        else if ( state == "split" )
+        {
+          // the claiming client found this box too expensive, split it,
+          // and queued the halves - adopt them, and drop the parent
+          std::vector <std::string> children =
+              saga::adaptors::utils::split (ads[j].get_attribute ("children"), ' ');
+
+          for ( unsigned int c = 0; c < children.size (); c++ )
+          {
+            std::cout << "adopting  box " << children[c]
+                      << " (split of "    << ads[j].get_attribute ("name")
+                      << ")" << std::endl;
+
+            ads.push_back (queue_dir.open (children[c],
+                                           saga::advert::ReadWrite));
+            boxes_scheduled++;
+          }
+
+          // tombstone the parent's claim marker and the parent itself
+          queue_dir.tombstone (ads[j].get_attribute ("name") + "_claim");
+          queue_dir.tombstone (ads[j].get_attribute ("name"));
+
+          ads.erase (ads.begin () + j);
+
+          j--; // make sure we don't skip the next ad
+
+          should_wait = false;
+        }
+        else
         {
           paint_it_black (ads[j], "invalid");
 
@@ -610,6 +1615,53 @@ int mandelbrot::compute (void)
       }
     }
 
+    // paint boxes which arrived over the binary result channel.  The
+    // matching advert is only needed for its meta data, and gets
+    // removed along with its claim.
+    if ( stream_run_ )
+    {
+      std::deque <frame_t> got;
+
+      ::pthread_mutex_lock   (&frame_mtx_);
+      got.swap (frames_);
+      ::pthread_mutex_unlock (&frame_mtx_);
+
+      for ( unsigned int f = 0; f < got.size (); f++ )
+      {
+        for ( unsigned int j = 0; j < ads.size (); j++ )
+        {
+          try
+          {
+            if ( ads[j].get_attribute ("name") != got[f].name )
+            {
+              continue;
+            }
+
+            paint_frame (ads[j], got[f].data);
+
+            boxes_done++;
+
+            // tombstone the claim marker and the work item
+            queue_dir.tombstone (got[f].name + "_claim");
+            queue_dir.tombstone (got[f].name);
+
+            ads.erase (ads.begin () + j);
+          }
+          catch ( const saga::exception & )
+          {
+            continue;
+          }
+
+          should_wait = false;
+          break;
+        }
+      }
+    }
+
+    // retire this round's tombstones in one bulk, before (possibly)
+    // idling - finished boxes then disappear from the client scans
+    queue_dir.flush_tombstones ();
+
     // if there was nothing to do in the last round, we might as
     // well idle for a bit...
     if ( should_wait )
@@ -634,32 +1686,355 @@ int mandelbrot::compute (void)
     paint_it_black (ads[j], "missing");
   }
 
+  // all boxes are accounted for - start tearing the job bucket down in
+  // the background.  The removal round trips overlap the cost and
+  // frame persistence below, and for frame sequence demos the next
+  // frame's job_startup: buckets are named by session uuid, so the
+  // runs cannot collide.
+  cleanup_run_ = 1;
+
+  if ( 0 != ::pthread_create (&cleanup_tid_, NULL,
+                              mandelbrot_cleanup_main, this) )
+  {
+    // no thread - clean up right here
+    cleanup_run_ = 0;
+    bucket_cleanup ();
+  }
+
+  // persist the measured per-region costs, to seed the decomposition
+  // of the next run (see the constructor)
+  if ( cost_seen_.size () )
+  {
+    std::ofstream costs ("mandelbrot.cost");
+
+    std::map <int, int> :: iterator it;
+
+    for ( it = cost_seen_.begin (); it != cost_seen_.end (); it++ )
+    {
+      costs << it->first << " " << it->second << "\n";
+    }
+
+    std::cout << "costs   : " << cost_seen_.size ()
+              << " region(s) written to mandelbrot.cost" << std::endl;
+  }
+
+  // persist this frame, to seed the reuse of the next one
+  if ( frame_cache_on_ )
+  {
+    frame_cache::save (frame_cache_file_,
+                       box_size_x_ * box_num_x_,
+                       box_size_y_ * box_num_y_,
+                       plane_x_0_, plane_y_0_,
+                       plane_x_1_, plane_y_1_,
+                       limit_, escape_,
+                       frame_counts_);
+
+    std::cout << "frame   : " << boxes_reused << " of "
+              << boxes_reused + boxes_scheduled
+              << " boxes reused from the previous frame" << std::endl;
+  }
+
   return 0;
 }
 
+
+///////////////////////////////////////////////////////////////////////
+//
+// enqueue one work item (box) into the shared queue bucket.  The box
+// carries its pixel geometry, so client-side splits can queue
+// arbitrary fractions of the initial grid.
+//
+saga::advert::entry mandelbrot::queue_box (sharded_dir::directory  & queue_dir,
+                                           std::string               name,
+                                           int                       region,
+                                           int                       off_x,
+                                           int                       off_y,
+                                           int                       size_x,
+                                           int                       size_y)
+{
+  saga::advert::entry ad = queue_dir.open (name,
+                                           saga::advert::Create    |
+                                           saga::advert::ReadWrite );
+
+  ad.set_attribute ("name"  , name);
+  ad.set_attribute ("boxnum", boost::lexical_cast <std::string> (region));
+  ad.set_attribute ("off_x" , boost::lexical_cast <std::string> (off_x ));
+  ad.set_attribute ("off_y" , boost::lexical_cast <std::string> (off_y ));
+  ad.set_attribute ("size_x", boost::lexical_cast <std::string> (size_x));
+  ad.set_attribute ("size_y", boost::lexical_cast <std::string> (size_y));
+
+  // signal for work to do.  The 'worker' attribute gets set by
+  // whichever client claims the box.
+  ad.set_attribute ("state" , "work");
+
+  return ad;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//
+// route one box to the active dispatch fabric: with the work channel
+// up it goes into the push queue (no advert is created at all), else
+// it is queued as an advert for the clients to claim.
+//
+void mandelbrot::dispatch_box (sharded_dir::directory            & queue_dir,
+                               std::vector <saga::advert::entry> & ads,
+                               std::string                         name,
+                               int                                 region,
+                               int                                 off_x,
+                               int                                 off_y,
+                               int                                 size_x,
+                               int                                 size_y)
+{
+  if ( work_run_ )
+  {
+    work_box_t box;
+
+    box.name   = name;
+    box.boxnum = region;
+    box.off_x  = off_x;
+    box.off_y  = off_y;
+    box.size_x = size_x;
+    box.size_y = size_y;
+
+    ::pthread_mutex_lock (&work_mtx_);
+    work_pending_.push_back (box);
+    work_remaining_++;
+    ::pthread_mutex_unlock (&work_mtx_);
+  }
+  else
+  {
+    ads.push_back (queue_box (queue_dir, name, region,
+                              off_x, off_y, size_x, size_y));
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//
+// paint a box which arrived over the work channel.  All meta data
+// travels in the frames - no advert is involved at all.
+//
+void mandelbrot::paint_work (const work_done_t & d)
+{
+  boost::shared_ptr <client> worker = js_->get_client (::atoi (d.worker.c_str ()));
+
+  if ( worker )
+  {
+    worker->cnt_iass_++;
+    worker->cnt_iok_++;
+    worker->ep_->cnt_iass_++;
+    worker->ep_->cnt_iok_++;
+  }
+
+  cost_seen_[d.box.boxnum] += d.cost_ms;
+
+  // data to paint - short frames get padded black
+  std::vector <std::vector <int> > data;
+
+  for ( int k = 0; k < d.box.size_x; k++ )
+  {
+    std::vector <int> line;
+
+    for ( int l = 0; l < d.box.size_y; l++ )
+    {
+      unsigned int idx = k * d.box.size_y + l;
+
+      line.push_back (idx < d.data.size () ? d.data[idx] : 0);
+    }
+
+    data.push_back (line);
+  }
+
+  std::string id = boost::lexical_cast <std::string> (d.box.boxnum) + " (" +
+                   (worker ? worker->ep_->name_ : "?") + ") " + d.worker;
+
+  for ( unsigned int dev = 0; dev < odevs_.size (); dev++ )
+  {
+    odevs_[dev]->paint_box (d.box.off_x, d.box.size_x,
+                            d.box.off_y, d.box.size_y,
+                            data, id);
+  }
+
+  record_frame_counts_ (d.box.off_x, d.box.size_x,
+                        d.box.off_y, d.box.size_y, data);
+
+  std::cout << "painting  box " << d.box.name
+            << " (work stream)" << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////
+//
+// paint a box whose iteration counts arrived as a binary frame.  The
+// advert only contributes the meta data (geometry, worker, cost).
+//
+void mandelbrot::paint_frame (saga::advert::entry     & ad,
+                              const std::vector <int> & counts)
+{
+  std::string boxnum_s (ad.get_attribute ("boxnum"));
+  std::string worker_s ("?");
+
+  try { worker_s = ad.get_attribute ("worker"); } catch ( ... ) { }
+
+  boost::shared_ptr <client> worker;
+
+  if ( worker_s != "?" )
+  {
+    worker = js_->get_client (::atoi (worker_s.c_str ()));
+  }
+
+  if ( worker )
+  {
+    worker->cnt_iass_++;
+    worker->cnt_iok_++;
+    worker->ep_->cnt_iass_++;
+    worker->ep_->cnt_iok_++;
+  }
+
+  int box_off_x = ::atoi (ad.get_attribute ("off_x" ).c_str ());
+  int box_off_y = ::atoi (ad.get_attribute ("off_y" ).c_str ());
+  int size_x    = ::atoi (ad.get_attribute ("size_x").c_str ());
+  int size_y    = ::atoi (ad.get_attribute ("size_y").c_str ());
+
+  try
+  {
+    cost_seen_[::atoi (boxnum_s.c_str ())] +=
+        ::atoi (ad.get_attribute ("cost").c_str ());
+  }
+  catch ( ... )
+  {
+    // no cost reported
+  }
+
+  // data to paint - short frames get padded black
+  std::vector <std::vector <int> > data;
+
+  for ( int k = 0; k < size_x; k++ )
+  {
+    std::vector <int> line;
+
+    for ( int l = 0; l < size_y; l++ )
+    {
+      unsigned int idx = k * size_y + l;
+
+      line.push_back (idx < counts.size () ? counts[idx] : 0);
+    }
+
+    data.push_back (line);
+  }
+
+  std::string id = boxnum_s + " (" +
+                   (worker ? worker->ep_->name_ : "?") + ") " + worker_s;
+
+  for ( unsigned int d = 0; d < odevs_.size (); d++ )
+  {
+    odevs_[d]->paint_box (box_off_x, size_x,
+                          box_off_y, size_y,
+                          data, id);
+  }
+
+  record_frame_counts_ (box_off_x, size_x,
+                        box_off_y, size_y, data);
+
+  std::cout << "painting  box " << ad.get_attribute ("name")
+            << " (stream)" << std::endl;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//
+// fold one painted box into the frame buffer kept for the next run.
+// Boxes painted black (missing, corrupted) are *not* recorded - their
+// pixels stay -1, and the next frame recomputes them.
+//
+void mandelbrot::record_frame_counts_ (int off_x, int size_x,
+                                       int off_y, int size_y,
+                                       const std::vector <std::vector <int> > & data)
+{
+  if ( ! frame_cache_on_ )
+  {
+    return;
+  }
+
+  int img_x = box_size_x_ * box_num_x_;
+  int img_y = box_size_y_ * box_num_y_;
+
+  for ( int x = 0; x < size_x && x < (int) data.size (); x++ )
+  {
+    for ( int y = 0; y < size_y && y < (int) data[x].size (); y++ )
+    {
+      int px = off_x + x;
+      int py = off_y + y;
+
+      if ( px >= 0 && px < img_x &&
+           py >= 0 && py < img_y )
+      {
+        frame_counts_[px * img_y + py] = data[x][y];
+      }
+    }
+  }
+}
+
+
 void mandelbrot::paint_it_black (saga::advert::entry ad,
                                  std::string         msg)
 {
-  // try to get meta-data from client
+  // try to get meta-data from client.  Unclaimed boxes from the pull
+  // queue never got a worker attached.
   std::string boxnum_s ("");
-  std::string jobid_s  ("[?]-[?]");
+  std::string worker_s ("?");
 
   try { boxnum_s = (ad.get_attribute ("boxnum")); } catch ( ... ) {  }
-  try { jobid_s  = (ad.get_attribute ("jobid" )); } catch ( ... ) {  }
+  try { worker_s = (ad.get_attribute ("worker")); } catch ( ... ) {  }
 
   // we simply do now know *where* to paint w/o boxnum...
   if ( ! boxnum_s.empty () )
   {
+    // box geometry: prefer the explicit attributes, fall back to the
+    // boxnum-derived grid position
+    int box_off_x = -1;
+    int box_off_y = -1;
+    int size_x    = -1;
+    int size_y    = -1;
+
+    try
+    {
+      box_off_x = ::atoi (ad.get_attribute ("off_x" ).c_str ());
+      box_off_y = ::atoi (ad.get_attribute ("off_y" ).c_str ());
+      size_x    = ::atoi (ad.get_attribute ("size_x").c_str ());
+      size_y    = ::atoi (ad.get_attribute ("size_y").c_str ());
+    }
+    catch ( ... )
+    {
+      size_x = -1;
+    }
+
+    if ( size_x <= 0 || size_y <= 0 )
+    {
+      // calculate box coordinates from box_num
+      int boxnum = ::atoi (boxnum_s.c_str ());
+
+      // box indicee coordinates
+      int box_x  =        boxnum % box_num_y_ ;
+      int box_y  = floor (boxnum / box_num_y_);
+
+      // box pixel coordinates
+      box_off_x = box_y * box_size_x_;
+      box_off_y = box_x * box_size_y_;
+      size_x    = box_size_x_;
+      size_y    = box_size_y_;
+    }
+
     // data to paint
     std::vector <std::vector <int> > data;
 
     // iterate over all lines in data set
-    for ( int k = 0; k < box_size_x_; k++ )
+    for ( int k = 0; k < size_x; k++ )
     {
       std::vector <int> line;
 
       // iterate over all pixels in line
-      for ( int l = 0; l < box_size_y_; l++ )
+      for ( int l = 0; l < size_y; l++ )
       {
         line.push_back (0);
       }
@@ -667,23 +2042,20 @@ void mandelbrot::paint_it_black (saga::advert::entry ad,
       data.push_back (line);
     }
 
-    // calculate box coordinates from box_num
-    int boxnum = ::atoi (boxnum_s.c_str ());
-
-    // box indicee coordinates
-    int box_x  =        boxnum % box_num_y_ ;
-    int box_y  = floor (boxnum / box_num_y_);
+    boost::shared_ptr <client> worker;
 
-    // box pixel coordinates
-    int box_off_x = box_y * box_size_x_;
-    int box_off_y = box_x * box_size_y_;
+    if ( worker_s != "?" )
+    {
+      worker = js_->get_client (::atoi (worker_s.c_str ()));
+    }
 
-    std::string id = boxnum_s + " (" + js_->get_client (jobid_s)->ep_->name_ + ") " + jobid_s;
+    std::string id = boxnum_s + " (" +
+                     (worker ? worker->ep_->name_ : "?") + ") " + worker_s;
 
     for ( unsigned int d = 0; d < odevs_.size (); d++ )
     {
-      odevs_[d]->paint_box (box_off_x, box_size_x_,
-                            box_off_y, box_size_y_,
+      odevs_[d]->paint_box (box_off_x, size_x,
+                            box_off_y, size_y,
                             data, id, msg);
     }
 
@@ -2,11 +2,20 @@
 #ifndef SAGA_MANDELBROT_HPP
 #define SAGA_MANDELBROT_HPP
 
+#include <map>
+#include <deque>
+#include <vector>
+
+#include <pthread.h>
+
 #include <saga/saga.hpp>
 
+#include "../../common/sharded_dir.hpp"
+
 #include "ini.hpp"
 #include "client.hpp"
 #include "output_base.hpp"
+#include "frame_cache.hpp"
 #include "job_starter.hpp"
 #include "../version.hpp"
 
@@ -14,7 +23,18 @@
 // this class encapsulates a master/worker paradigm.  We start
 // the jobs, and distribute work items to them.
 
-class mandelbrot 
+// thread main of the result stream listener (see stream_listen)
+void * mandelbrot_stream_main (void * arg);
+
+// thread mains of the work channel listener and its per-client
+// connection handlers (see work_listen)
+void * mandelbrot_work_main      (void * arg);
+void * mandelbrot_work_conn_main (void * arg);
+
+// thread main of the background bucket teardown (see bucket_cleanup)
+void * mandelbrot_cleanup_main (void * arg);
+
+class mandelbrot
 {
   private:
 
@@ -35,6 +55,15 @@ class mandelbrot
     void paint_it_black (saga::advert::entry ad,
                          std::string         msg);
 
+    // enqueue one work item (box) with explicit pixel geometry
+    saga::advert::entry queue_box (sharded_dir::directory  & queue_dir,
+                                   std::string               name,
+                                   int                       region,
+                                   int                       off_x,
+                                   int                       off_y,
+                                   int                       size_x,
+                                   int                       size_y);
+
     // all job buckets are created under that advert directory, by
     // appending the session uid and the client jobnum:
     // saga::advert::directory (<advert_dir>/<session_id>/<client_id>
@@ -56,11 +85,124 @@ class mandelbrot
     int box_num_x_;
     int box_num_y_;
 
+    // adaptive box sizing: clients split boxes whose compute time
+    // exceeds split_ms_ (0 disables).  Measured per-region costs are
+    // persisted to mandelbrot.cost, and seed the decomposition of the
+    // next run (zoom sequences revisit the same expensive regions).
+    int                 split_ms_;
+    std::map <int, int> region_cost_;  // seed costs, from the last run
+    std::map <int, int> cost_seen_;    // costs measured in this run
+
+    // frame-to-frame reuse for zoom sequences: boxes covered by the
+    // previous frame's plane window are rescaled from its cached
+    // iteration counts instead of being dispatched (see frame_cache.hpp)
+    bool                frame_cache_on_;
+    std::string         frame_cache_file_;
+    double              frame_cache_max_scale_;
+    frame_cache         prev_frame_;
+    std::vector <int>   frame_counts_;  // this frame, row major, -1 == unknown
+
+    // fold one painted box into frame_counts_
+    void record_frame_counts_ (int off_x, int size_x,
+                               int off_y, int size_y,
+                               const std::vector <std::vector <int> > & data);
+
+    // binary result channel: clients send finished boxes as
+    // length-prefixed frames over a saga::stream connection instead of
+    // stuffing pixel data into advert attributes; the advert is then
+    // only used for discovery and claiming.  Disabled when the
+    // 'stream_url' ini key is empty - clients fall back to the advert
+    // data attribute either way.
+    struct frame_t
+    {
+      std::string       name;  // work item name
+      std::vector <int> data;  // raw iteration counts, row major
+    };
+
+    std::string           stream_url_;
+    volatile int          stream_run_;
+    pthread_t             stream_tid_;
+    pthread_mutex_t       frame_mtx_;
+    std::deque <frame_t>  frames_;
+
+    void stream_listen (void);
+    void paint_frame   (saga::advert::entry     & ad,
+                        const std::vector <int> & counts);
+
+    // streaming work mode: instead of queueing boxes as adverts for
+    // the clients to poll, the master pushes box geometries over
+    // persistent per-client stream connections and receives the
+    // results on them, keeping work_window_ boxes in flight per
+    // client - the next box is already queued behind the current one,
+    // so per-box overhead is one frame each way instead of two advert
+    // round trips.  The advert queue carries no work items then.
+    // Disabled when the 'work_url' ini key is empty.
+    struct work_box_t
+    {
+      std::string name;
+      int         boxnum;
+      int         off_x;
+      int         off_y;
+      int         size_x;
+      int         size_y;
+    };
+
+    struct work_done_t
+    {
+      work_box_t        box;
+      std::string       worker;   // client job number
+      long              cost_ms;
+      std::vector <int> data;     // raw iteration counts, row major
+    };
+
+    std::string              work_url_;
+    int                      work_window_;
+    volatile int             work_run_;
+    pthread_t                work_tid_;
+    pthread_mutex_t          work_mtx_;
+    std::deque <work_box_t>  work_pending_;    // boxes not handed out yet
+    std::deque <work_done_t> work_done_;       // results to paint
+    unsigned int             work_remaining_;  // boxes not finished yet
+
+    void work_listen (void);
+    void work_serve  (saga::stream::stream s);
+    void paint_work  (const work_done_t & d);
+
+    // route one box to the active dispatch fabric: the streaming work
+    // channel when it is up, the advert queue otherwise
+    void dispatch_box (sharded_dir::directory            & queue_dir,
+                       std::vector <saga::advert::entry> & ads,
+                       std::string                         name,
+                       int                                 region,
+                       int                                 off_x,
+                       int                                 off_y,
+                       int                                 size_x,
+                       int                                 size_y);
+
+    // background teardown of the session's job bucket: started as soon
+    // as the last box is in, joined in the destructor.  The removal
+    // round trips thus overlap the cost/frame persistence, and - as
+    // buckets are named by session uuid - the next frame's job_startup
+    // in a frame sequence.
+    volatile int          cleanup_run_;
+    pthread_t             cleanup_tid_;
+
+    void bucket_cleanup (void);
+    void cleanup_dir_   (saga::advert::directory & dir);
+
+    friend void * mandelbrot_stream_main    (void * arg);
+    friend void * mandelbrot_work_main      (void * arg);
+    friend void * mandelbrot_work_conn_main (void * arg);
+    friend void * mandelbrot_cleanup_main   (void * arg);
+
     // flags
     bool debug_;
 
   public:
-    mandelbrot   (void);
+    // bench == true replaces the configured output devices with the
+    // null benchmark device (see output_null.hpp and the --bench flag
+    // in mandelbrot_master.cpp)
+    mandelbrot   (bool bench = false);
     ~mandelbrot  (void);
 
     int compute  (void);
@@ -6,6 +6,27 @@
 
 int main (int argc, char** argv)
 {
+  ////////////////////////////////////////////////////////////////////
+  // --bench: benchmark the dispatch fabric.  The configured output
+  // devices are replaced with the null benchmark device, which
+  // validates and discards boxes and reports per-client work item
+  // latencies and pixel throughput (see output_null.hpp).  All other
+  // parameters still come from the ini file.
+  bool bench = false;
+
+  for ( int i = 1; i < argc; i++ )
+  {
+    if ( std::string ("--bench") == argv[i] )
+    {
+      bench = true;
+    }
+    else
+    {
+      std::cerr << "usage: " << argv[0] << " [--bench]" << std::endl;
+      return 1;
+    }
+  }
+
   ////////////////////////////////////////////////////////////////////
   // timestamp
   std::cout << "start   : " << std::flush;
@@ -17,7 +38,7 @@ int main (int argc, char** argv)
   {
     ////////////////////////////////////////////////////////////////////
     // create our mandelbrot master
-    mandelbrot m;
+    mandelbrot m (bench);
 
     ////////////////////////////////////////////////////////////////////
     // compute() distributes the work, gathers the
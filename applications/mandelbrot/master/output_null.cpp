@@ -0,0 +1,223 @@
+
+#include <sys/time.h>
+
+#include <cstdio>
+#include <sstream>
+#include <iostream>
+
+#include "output_null.hpp"
+
+
+// wallclock with microsecond resolution
+static double now_secs (void)
+{
+  struct timeval tv;
+
+  ::gettimeofday (&tv, NULL);
+
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+// latency histogram bucket limits (milliseconds).  The last bucket is
+// open ended.
+static const int    bucket_ms_ []  = {    1,    2,    5,   10,   20,   50,
+                                        100,  200,  500, 1000, 2000, 5000 };
+static const size_t bucket_num_    = sizeof (bucket_ms_) / sizeof (int) + 1;
+
+
+output_null::client_stats::client_stats (void)
+    : boxes     (0),
+      lat_sum   (0.0),
+      last_seen (0.0),
+      histo     (bucket_num_, 0)
+{
+}
+
+
+output_null::output_null (unsigned int size_x,
+                          unsigned int size_y,
+                          unsigned int cnum)
+    : size_x_   (size_x),
+      size_y_   (size_y),
+      cnum_     (cnum),
+      boxes_    (0),
+      dropped_  (0),
+      pixels_   (0),
+      t_start_  (now_secs ()),
+      t_last_   (now_secs ())
+{
+}
+
+
+// report per-client latencies and the aggregate throughput.  The
+// devices get deleted after the last box is painted (see ~mandelbrot),
+// so this is the natural reporting point.
+output_null::~output_null (void)
+{
+  std::cout << "bench   : " << boxes_ << " box(es), "
+            << pixels_      << " pixel(s)";
+
+  if ( dropped_ )
+  {
+    std::cout << ", " << dropped_ << " dropped";
+  }
+
+  double elapsed = t_last_ - t_start_;
+
+  if ( elapsed > 0.0 && pixels_ > 0 )
+  {
+    std::cout << " in " << elapsed << "s - "
+              << (long long) (pixels_ / elapsed) << " pixels/sec";
+  }
+
+  std::cout << std::endl;
+
+  std::map <std::string, client_stats> :: iterator it;
+
+  for ( it = clients_.begin (); it != clients_.end (); it++ )
+  {
+    client_stats & cs = it->second;
+
+    std::cout << "bench   : client " << it->first
+              << " - " << cs.boxes   << " box(es)";
+
+    // the first box only arms the clock (see paint_box), so there is
+    // one latency less than there are boxes
+    if ( cs.boxes > 1 )
+    {
+      std::cout << ", avg latency "
+                << (long) (cs.lat_sum / (cs.boxes - 1) * 1000.0) << "ms";
+    }
+
+    // histogram: '<limit>ms:<count>', empty buckets are skipped
+    std::cout << " [";
+
+    for ( size_t b = 0; b < bucket_num_; b++ )
+    {
+      if ( ! cs.histo[b] )
+      {
+        continue;
+      }
+
+      if ( b < bucket_num_ - 1 )
+      {
+        std::cout << " <" << bucket_ms_[b] << "ms:" << cs.histo[b];
+      }
+      else
+      {
+        std::cout << " >" << bucket_ms_[bucket_num_ - 2] << "ms:" << cs.histo[b];
+      }
+    }
+
+    std::cout << " ]" << std::endl;
+  }
+}
+
+
+// validate a box and throw it away.  Malformed data vectors are an
+// error, like on the real devices - out-of-window geometry and
+// out-of-range iteration counts as well, as nothing downstream would
+// catch them here.
+void output_null::paint_box (unsigned int x0, unsigned int n_x,
+                             unsigned int y0, unsigned int n_y,
+                             std::vector <std::vector <int> > & data,
+                             std::string ident,
+                             std::string msg)
+{
+  double now = now_secs ();
+
+  // sanity check.
+  if ( data.size () != n_x )
+  {
+    std::stringstream ss;
+    ss << "incorrect box size (x): " << data.size () << " - " << n_x;
+    throw ss.str ().c_str ();
+  }
+
+  if ( x0 + n_x > size_x_ ||
+       y0 + n_y > size_y_ )
+  {
+    std::stringstream ss;
+    ss << "box outside window: " << x0 << "+" << n_x
+       << " x "                  << y0 << "+" << n_y;
+    throw ss.str ().c_str ();
+  }
+
+  // iterate over all lines
+  for ( unsigned int x = 0; x < n_x; x++ )
+  {
+    std::vector <int> & line = data[x];
+
+    // line sanity check
+    if ( line.size () != n_y )
+    {
+      std::stringstream ss;
+      ss << "incorrect line size (x): " << line.size () << " - " << n_y;
+      throw ss.str ().c_str ();
+    }
+
+    // iterate over all pixels in line
+    for ( unsigned int y = 0; y < n_y; y++ )
+    {
+      if ( line[y] < 0 || line[y] > (int) cnum_ )
+      {
+        std::stringstream ss;
+        ss << "iteration count out of range: " << line[y]
+           << " (limit " << cnum_ << ")";
+        throw ss.str ().c_str ();
+      }
+    }
+  }
+
+  // boxes painted with a message (missing, corrupted, invalid) never
+  // went through a client - count them, but keep them out of the
+  // latency and throughput numbers
+  if ( ! msg.empty () )
+  {
+    dropped_++;
+    return;
+  }
+
+  boxes_++;
+  pixels_ += (long long) n_x * n_y;
+  t_last_  = now;
+
+  // the box label reads '<boxnum> (<endpoint>) <worker>' (see
+  // compute in mandelbrot.cpp) - everything after the first blank
+  // identifies the client.  Cache reuses ('<boxnum> (cache)') form
+  // their own bin.
+  std::string client = ident;
+
+  std::string::size_type blank = ident.find (' ');
+
+  if ( blank != std::string::npos )
+  {
+    client = ident.substr (blank + 1);
+  }
+
+  client_stats & cs = clients_[client];
+
+  if ( cs.boxes )
+  {
+    // latency == gap to the client's previous box.  The first box has
+    // no meaningful predecessor (it includes client bootstrap), so it
+    // only arms the clock.
+    double lat = now - cs.last_seen;
+
+    cs.lat_sum += lat;
+
+    size_t b = 0;
+
+    while ( b < bucket_num_ - 1 && lat * 1000.0 >= bucket_ms_[b] )
+    {
+      b++;
+    }
+
+    cs.histo[b]++;
+  }
+
+  cs.boxes++;
+  cs.last_seen = now;
+}
+
@@ -0,0 +1,73 @@
+
+#ifndef SAGA_MANDELBROT_OUTPUT_NULL_HPP
+#define SAGA_MANDELBROT_OUTPUT_NULL_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "output_base.hpp"
+
+// This class implements the abstract output_base, and can thus serve as
+// output device for the mandelbrot class.  It does not display anything:
+// incoming boxes are validated and discarded, and the device keeps
+//
+//   - a per-client histogram of work item latencies (the time between
+//     successive boxes delivered by the same client), and
+//   - the aggregate pixel throughput of the run.
+//
+// Both are reported on shutdown.  With only this device active (see the
+// --bench flag in mandelbrot_master.cpp), a run thus measures the
+// master/client dispatch fabric itself, without X11 or PNG encoding
+// noise - which is how we benchmark new SAGA adaptors.
+//
+class output_null : public output_base
+{
+  private:
+    // per-client accounting.  Latencies land in fixed millisecond
+    // buckets (see bucket_ms_ in output_null.cpp).
+    struct client_stats
+    {
+      long                 boxes;     // boxes delivered
+      double               lat_sum;   // sum of latencies (secs)
+      double               last_seen; // arrival of the previous box
+      std::vector <long>   histo;     // latency histogram
+
+      client_stats (void);
+    };
+
+    // window size - boxes must lie inside
+    unsigned int         size_x_;
+    unsigned int         size_y_;
+
+    // max legal iteration count
+    unsigned int         cnum_;
+
+    // aggregate counters
+    long                 boxes_;     // valid boxes
+    long                 dropped_;   // boxes painted with a msg (missing etc.)
+    long long            pixels_;    // pixels in valid boxes
+    double               t_start_;   // device creation
+    double               t_last_;    // last valid box
+
+    std::map <std::string, client_stats> clients_;
+
+
+  public:
+    // the c'tor takes the size of the window.  The user of the device
+    // needs to ensure that all drawing requests lie inside that window.
+     output_null (unsigned int size_x,
+                  unsigned int size_y,
+                  unsigned int cnum);
+    ~output_null (void);
+
+    // validate and discard a rectangular box
+    void paint_box (unsigned int x0, unsigned int n_x,
+                    unsigned int y0, unsigned int n_y,
+                    std::vector <std::vector <int> > & data,
+                    std::string ident,
+                    std::string msg = "");
+};
+
+#endif // SAGA_MANDELBROT_OUTPUT_NULL_HPP
+
@@ -17,6 +17,24 @@ output_png::output_png (unsigned int size_x,
       png_      (size_x_, size_y_, (int) cnum_, file.c_str ()),
       file_     (file)
 {
+  // all our colours derive from 8-bit iteration-count lookups, so the
+  // compact 8-bit framebuffer suffices: half the image memory, and
+  // half the data libpng has to filter and deflate on close().
+  png_.setbitdepth (8);
+
+  // precompute the colormap: the same colour arithmetic paint_box used
+  // to do per pixel, done once per colour index instead
+  palette_.resize (cnum_ * 3);
+
+  for ( unsigned int c = 0; c < cnum_; c++ )
+  {
+    int g = (256 * c) % (cnum_ - 2) + 2;
+
+    palette_[3 * c + 0] = 0;
+    palette_[3 * c + 1] = (unsigned char) (g / 257);
+    palette_[3 * c + 2] = (unsigned char) (g / 257);
+  }
+
   // try to open font file
   char * saga_loc = ::getenv ("SAGA_LOCATION");
 
@@ -71,26 +89,24 @@ void output_png::paint_box (unsigned int x0, unsigned int n_x,
     // iterate over all pixels in line
     for ( unsigned int y = 0; y < n_y; y++ )
     {
-      int r = 0;
-      int g = (256 * line[y]) % (cnum_ - 2) + 2;
-      int b = (256 * line[y]) % (cnum_ - 2) + 2;
+      unsigned int c = 3 * (line[y] % cnum_);
 
-      png_.plot (x0 + x, y0 + y, r, g, b);
+      png_.plot8 (x0 + x, y0 + y, palette_[c], palette_[c + 1], palette_[c + 2]);
     }
   }
 
-  
+
   // for demo purposes, we also draw box boundaries
   for ( unsigned int bx = 0; bx < n_x; bx++ )
   {
-    png_.plot (x0 + bx, y0 + 0  , 1.0, 1.0, 1.0);
-    png_.plot (x0 + bx, y0 + n_y, 1.0, 1.0, 1.0);
+    png_.plot8 (x0 + bx, y0 + 0  , 255, 255, 255);
+    png_.plot8 (x0 + bx, y0 + n_y, 255, 255, 255);
   }
 
   for ( unsigned int by = 0; by < n_y; by++ )
   {
-    png_.plot (x0 + 0  , y0 + by, 1.0, 1.0, 1.0);
-    png_.plot (x0 + n_x, y0 + by, 1.0, 1.0, 1.0);
+    png_.plot8 (x0 + 0  , y0 + by, 255, 255, 255);
+    png_.plot8 (x0 + n_x, y0 + by, 255, 255, 255);
   }
   
 
@@ -23,9 +23,11 @@ class output_png : public output_base
     unsigned int         size_x_;
     unsigned int         size_y_;
 
-    // colormap
-    unsigned int         cnum_; // number of colors
-    std::vector <long>   colors_;
+    // colormap: 8-bit RGB triples indexed by iteration count (modulo
+    // cnum_), computed once in the c'tor.  Painting a pixel is a table
+    // lookup plus three byte stores into the 8-bit framebuffer.
+    unsigned int              cnum_; // number of colors
+    std::vector <unsigned char> palette_;
 
     // font location
     std::string          font_loc_;
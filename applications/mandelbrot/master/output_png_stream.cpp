@@ -0,0 +1,201 @@
+
+#ifdef HAVE_PNG
+
+#include <sstream>
+#include <iostream>
+
+#include "output_png_stream.hpp"
+
+
+output_png_stream::output_png_stream (unsigned int size_x,
+                                      unsigned int size_y,
+                                      unsigned int cnum,
+                                      std::string  file)
+    : size_x_   (size_x),
+      size_y_   (size_y),
+      cnum_     (cnum * 256 - 1),
+      fp_       (NULL),
+      png_      (NULL),
+      info_     (NULL),
+      file_     (file),
+      fill_     (size_y, 0),
+      written_  (0)
+{
+  fp_ = ::fopen (file_.c_str (), "wb");
+
+  if ( NULL == fp_ )
+  {
+    throw "could not open png output file";
+  }
+
+  png_ = png_create_write_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+
+  if ( NULL != png_ )
+  {
+    info_ = png_create_info_struct (png_);
+  }
+
+  if ( NULL == info_ )
+  {
+    throw "could not init png writer";
+  }
+
+  // note: as for the pngwriter write path, we leave libpng's default
+  // error handling in place - write errors are fatal anyway
+
+  png_init_io  (png_, fp_);
+
+  png_set_IHDR (png_, info_, size_x_, size_y_, 8,
+                PNG_COLOR_TYPE_RGB,
+                PNG_INTERLACE_NONE,
+                PNG_COMPRESSION_TYPE_DEFAULT,
+                PNG_FILTER_TYPE_DEFAULT);
+
+  png_write_info (png_, info_);
+}
+
+
+output_png_stream::~output_png_stream (void)
+{
+  // flush whatever rows are still pending - incomplete rows (e.g. from
+  // boxes lost to failing endpoints) go out as painted so far, which
+  // keeps the file valid.
+  while ( written_ < size_y_ )
+  {
+    png_write_row (png_, (png_bytep) & (row_ (size_y_ - 1 - written_))[0]);
+    written_++;
+  }
+
+  png_write_end (png_, info_);
+
+  png_destroy_write_struct (&png_, &info_);
+
+  ::fclose (fp_);
+
+  std::cout << "result  : " << file_ << std::endl;
+}
+
+
+// return the pending 8-bit RGB buffer for row y, creating it (black) on
+// first touch
+std::vector <unsigned char> & output_png_stream::row_ (unsigned int y)
+{
+  std::map <unsigned int, std::vector <unsigned char> > :: iterator it = rows_.find (y);
+
+  if ( it == rows_.end () )
+  {
+    it = rows_.insert (std::make_pair (y, std::vector <unsigned char> (size_x_ * 3, 0))).first;
+  }
+
+  return it->second;
+}
+
+
+// set a single pixel, ignoring plots which fall outside the window, or
+// into rows which are already encoded (box boundaries overlap into
+// neighbouring boxes by one pixel)
+void output_png_stream::plot_ (unsigned int  x, unsigned int  y,
+                               unsigned char r, unsigned char g, unsigned char b)
+{
+  if ( x >= size_x_ || y >= size_y_ - written_ )
+  {
+    return;
+  }
+
+  std::vector <unsigned char> & row = row_ (y);
+
+  row[x * 3 + 0] = r;
+  row[x * 3 + 1] = g;
+  row[x * 3 + 2] = b;
+}
+
+
+// encode and release leading rows which are completely painted.  Rows
+// are written top down, i.e. with y counting down from size_y_ - 1.
+void output_png_stream::flush_ (void)
+{
+  while ( written_ < size_y_ )
+  {
+    unsigned int y = size_y_ - 1 - written_;
+
+    if ( fill_[y] < size_x_ )
+    {
+      break;
+    }
+
+    png_write_row (png_, (png_bytep) & (row_ (y))[0]);
+
+    rows_.erase (y);
+    written_++;
+  }
+}
+
+
+// paint a rectangular box.  The given data determine the color index of the
+// pixels to be drawn.  The identifier is accepted for interface
+// compatibility, but not drawn (see class doc).
+void output_png_stream::paint_box (unsigned int x0, unsigned int n_x,
+                                   unsigned int y0, unsigned int n_y,
+                                   std::vector <std::vector <int> > & data,
+                                   std::string ident,
+                                   std::string msg)
+{
+  // sanity check.
+  if ( data.size () != n_x )
+  {
+    std::stringstream ss;
+    ss << "incorrect box size (x): " << data.size () << " - " << n_x;
+    throw ss.str ().c_str ();
+  }
+
+  // iterate over all lines
+  for ( unsigned int x = 0; x < n_x; x++ )
+  {
+    std::vector <int> line = data[x];
+
+    // line sanity check
+    if ( line.size () != n_y )
+    {
+      std::stringstream ss;
+      ss << "incorrect line size (x): " << line.size () << " - " << n_y;
+      throw ss.str ().c_str ();
+    }
+
+    // iterate over all pixels in line.  The color mapping matches
+    // output_png, scaled down from pngwriter's 16-bit channels.
+    for ( unsigned int y = 0; y < n_y; y++ )
+    {
+      int           v = (256 * line[y]) % (cnum_ - 2) + 2;
+      unsigned char c = (unsigned char) (v >> 8);
+
+      plot_ (x0 + x, y0 + y, 0, c, c);
+    }
+  }
+
+
+  // for demo purposes, we also draw box boundaries
+  for ( unsigned int bx = 0; bx < n_x; bx++ )
+  {
+    plot_ (x0 + bx, y0 + 0  , 255, 255, 255);
+    plot_ (x0 + bx, y0 + n_y, 255, 255, 255);
+  }
+
+  for ( unsigned int by = 0; by < n_y; by++ )
+  {
+    plot_ (x0 + 0  , y0 + by, 255, 255, 255);
+    plot_ (x0 + n_x, y0 + by, 255, 255, 255);
+  }
+
+
+  // the box covers exactly n_x pixels on each of its rows - account for
+  // them, and hand complete leading rows to the encoder
+  for ( unsigned int y = y0; y < y0 + n_y && y < size_y_; y++ )
+  {
+    fill_[y] += n_x;
+  }
+
+  flush_ ();
+}
+
+#endif // HAVE_PNG
+
@@ -0,0 +1,81 @@
+
+#ifdef HAVE_PNG
+
+#ifndef SAGA_MANDELBROT_OUTPUT_PNG_STREAM_HPP
+#define SAGA_MANDELBROT_OUTPUT_PNG_STREAM_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cstdio>
+
+#include <png.h>
+
+#include "output_base.hpp"
+
+// This class implements the abstract output_base, like output_png, but
+// encodes the image incrementally: arriving boxes are converted to
+// 8-bit RGB rows right away, and leading rows whose pixels are all
+// accounted for are handed to libpng and released.  The full image
+// buffer of the pngwriter based device is thus replaced by a sliding
+// window of pending rows, which keeps master memory flat even for very
+// large renders.
+//
+// Boxes arrive in arbitrary order, and split boxes cover arbitrary
+// rectangles - we thus keep a per-row count of painted pixels, and
+// flush rows only once they are completely covered.  The demo box
+// boundaries are drawn as for output_png; the text labels are not, as
+// those would need the buffered pngwriter/freetype path.
+//
+class output_png_stream : public output_base
+{
+  private:
+    // window size
+    unsigned int size_x_;
+    unsigned int size_y_;
+
+    // colormap
+    unsigned int cnum_; // number of colors
+
+    // libpng state
+    std::FILE  * fp_;
+    png_structp  png_;
+    png_infop    info_;
+
+    std::string  file_;
+
+    // pending rows, keyed by row index (y counts bottom-up, matching
+    // pngwriter), plus the number of painted pixels per row
+    std::map <unsigned int, std::vector <unsigned char> > rows_;
+    std::vector <unsigned int> fill_;
+
+    unsigned int written_; // rows encoded so far (image top down)
+
+    std::vector <unsigned char> & row_  (unsigned int y);
+
+    void plot_  (unsigned int  x, unsigned int  y,
+                 unsigned char r, unsigned char g, unsigned char b);
+    void flush_ (void);
+
+  public:
+    // the c'tor takes the size the window.  The user of the device needs to
+    // ensure that all drawing requests lie inside that window.
+     output_png_stream  (unsigned int size_x,
+                         unsigned int size_y,
+                         unsigned int cnum,
+                         std::string  file);
+    ~output_png_stream (void);
+
+    // paint a rectangular box
+    void paint_box (unsigned int x0, unsigned int n_x,
+                    unsigned int y0, unsigned int n_y,
+                    std::vector <std::vector <int> > & data,
+                    std::string ident,
+                    std::string msg = "");
+};
+
+#endif // SAGA_MANDELBROT_OUTPUT_PNG_STREAM_HPP
+
+#endif // HAVE_PNG
+
@@ -106,20 +106,147 @@ output_x11::output_x11 (unsigned int size_x,
 
   // map window to the screen
   XMapWindow   (dpy_, win_);
+
+  // create the client-side back buffer.  paint_box only ever touches
+  // this image; the window is updated by blitting the dirty rectangle
+  // in flush_, at most every flush_ms_ milliseconds.
+  img_ = XCreateImage (dpy_, DefaultVisual (dpy_, scr_),
+                       DefaultDepth (dpy_, scr_), ZPixmap, 0,
+                       (char *) ::calloc (size_x_ * size_y_, 4),
+                       size_x_, size_y_, 32, 0);
+
+  if ( NULL == img_ )
+  {
+    throw "could not create x11 back buffer";
+  }
+
+  flush_ms_ = 100;
+
+  char * flush_env = ::getenv ("SAGA_MANDELBROT_X11_FLUSH_MS");
+
+  if ( flush_env != NULL )
+  {
+    flush_ms_ = ::atol (flush_env);
+  }
+
+  ::gettimeofday (&last_flush_, NULL);
+
+  // nothing dirty yet
+  dirty_x0_ = 1;
+  dirty_x1_ = 0;
+  dirty_y0_ = 1;
+  dirty_y1_ = 0;
 }
 
 output_x11::~output_x11 (void)
 {
+  // make sure the last boxes reach the screen
+  flush_ (true);
+
   std::cout << "press enter to close x11 output" << std::flush << std::endl;
   ::getchar ();
 
-  // shut down X11
+  // shut down X11 (XDestroyImage frees the buffer, too)
+  XDestroyImage  (img_);
   XFreeGC        (dpy_, gc_);
   XDestroyWindow (dpy_, win_);
   XCloseDisplay  (dpy_);
 }
 
 
+// set one pixel of the back buffer.  Out-of-window pixels (the demo
+// box boundaries paint one row/column past the box) are dropped -
+// XPutPixel would scribble over foreign memory.
+void output_x11::put_pixel_ (int x, int y, unsigned long pixel)
+{
+  if ( x < 0 || x >= (int) size_x_ ||
+       y < 0 || y >= (int) size_y_ )
+  {
+    return;
+  }
+
+  XPutPixel (img_, x, y, pixel);
+}
+
+
+// grow the dirty bounding rectangle
+void output_x11::mark_dirty_ (int x0, int y0, int x1, int y1)
+{
+  if ( x1 >= (int) size_x_ ) { x1 = size_x_ - 1; }
+  if ( y1 >= (int) size_y_ ) { y1 = size_y_ - 1; }
+  if ( x0 <  0             ) { x0 = 0;           }
+  if ( y0 <  0             ) { y0 = 0;           }
+
+  if ( dirty_x0_ > dirty_x1_ )
+  {
+    // nothing was dirty
+    dirty_x0_ = x0;
+    dirty_y0_ = y0;
+    dirty_x1_ = x1;
+    dirty_y1_ = y1;
+    return;
+  }
+
+  if ( x0 < dirty_x0_ ) { dirty_x0_ = x0; }
+  if ( y0 < dirty_y0_ ) { dirty_y0_ = y0; }
+  if ( x1 > dirty_x1_ ) { dirty_x1_ = x1; }
+  if ( y1 > dirty_y1_ ) { dirty_y1_ = y1; }
+}
+
+
+// blit the dirty rectangle of the back buffer to the window, and draw
+// the pending box labels on top.  Unless forced, this is a no-op until
+// flush_ms_ milliseconds have passed since the last blit - that caps
+// the X traffic at a few updates per second, no matter how fast boxes
+// arrive.
+void output_x11::flush_ (bool force)
+{
+  if ( dirty_x0_ > dirty_x1_ && labels_.empty () )
+  {
+    return;
+  }
+
+  struct timeval now;
+  ::gettimeofday (&now, NULL);
+
+  long elapsed_ms = (now.tv_sec  - last_flush_.tv_sec ) * 1000
+                  + (now.tv_usec - last_flush_.tv_usec) / 1000;
+
+  if ( ! force && elapsed_ms < flush_ms_ )
+  {
+    return;
+  }
+
+  if ( dirty_x0_ <= dirty_x1_ )
+  {
+    XPutImage (dpy_, win_, gc_, img_,
+               dirty_x0_,                 dirty_y0_,  // src
+               dirty_x0_,                 dirty_y0_,  // dst
+               dirty_x1_ - dirty_x0_ + 1,
+               dirty_y1_ - dirty_y0_ + 1);
+  }
+
+  XSetForeground (dpy_, gc_, WhitePixel (dpy_, scr_));
+
+  for ( unsigned int l = 0; l < labels_.size (); l++ )
+  {
+    XDrawString (dpy_, win_, gc_, labels_[l].x, labels_[l].y,
+                 labels_[l].txt.c_str (), labels_[l].txt.size ());
+  }
+
+  XFlush (dpy_);
+
+  labels_.clear ();
+
+  dirty_x0_ = 1;
+  dirty_x1_ = 0;
+  dirty_y0_ = 1;
+  dirty_y1_ = 0;
+
+  last_flush_ = now;
+}
+
+
 // paint a rectangular box.  The given data determine the color index of the
 // pixels to be drawn.  The identifier determines the box's label to be printed.
 void output_x11::paint_box (unsigned int x0, unsigned int n_x, 
@@ -136,7 +263,8 @@ void output_x11::paint_box (unsigned int x0, unsigned int n_x,
     throw ss.str ().c_str ();
   }
 
-  // iterate over all lines
+  // iterate over all lines.  All drawing goes into the client-side
+  // back buffer - no X round-trips here.
   for ( unsigned int x = 0; x < n_x; x++ )
   {
     std::vector <int> line = data[x];
@@ -152,36 +280,28 @@ void output_x11::paint_box (unsigned int x0, unsigned int n_x,
     // iterate over all pixels in line
     for ( unsigned int y = 0; y < n_y; y++ )
     {
-      // set paint color according to data value
-      // (first two colors are reserved
-      XSetForeground (dpy_, gc_, colors_[line[y] % (cnum_ - 2) + 2]);
-
-      // draw the point at given coordinates
-      XDrawPoint     (dpy_, win_, gc_, 
-                      x0 + x, 
-                      y0 + y);
+      // paint color according to data value
+      // (first two colors are reserved)
+      put_pixel_ (x0 + x, y0 + y, colors_[line[y] % (cnum_ - 2) + 2]);
     }
   }
 
   // for demo purposes, we also draw box boundaries
   for ( unsigned int bx = 0; bx < n_x; bx++ )
   {
-    XSetForeground (dpy_, gc_, colors_[cnum_ + (bx % 2)]);
-    XDrawPoint     (dpy_, win_, gc_, x0 + bx, y0 + 0);
-    XDrawPoint     (dpy_, win_, gc_, x0 + bx, y0 + n_y);
+    put_pixel_ (x0 + bx, y0 + 0,   colors_[cnum_ + (bx % 2)]);
+    put_pixel_ (x0 + bx, y0 + n_y, colors_[cnum_ + (bx % 2)]);
   }
 
   for ( unsigned int by = 0; by < n_y; by++ )
   {
-    XSetForeground (dpy_, gc_, colors_[cnum_ + (by % 2)]);
-    XDrawPoint     (dpy_, win_, gc_, x0 + 0,   y0 + by);
-    XDrawPoint     (dpy_, win_, gc_, x0 + n_x, y0 + by);
+    put_pixel_ (x0 + 0,   y0 + by, colors_[cnum_ + (by % 2)]);
+    put_pixel_ (x0 + n_x, y0 + by, colors_[cnum_ + (by % 2)]);
   }
-  
 
-  // print identifier as box label
+
+  // queue identifier as box label (drawn on top of the next blit)
   std::string tmp (ident);
-  int         len = tmp.size ();
 
   if ( tmp.size () > 53 )
   {
@@ -189,23 +309,30 @@ void output_x11::paint_box (unsigned int x0, unsigned int n_x,
     tmp[51] = '.';
     tmp[52] = '.';
     tmp.resize (53);
-    len     = 53;
   }
 
+  label_t label;
 
-  XSetForeground (dpy_, gc_, WhitePixel (dpy_, scr_));
-  XDrawString    (dpy_, win_, gc_, x0 + 10, y0 + 20, 
-                  tmp.c_str (), len);
+  label.x   = x0 + 10;
+  label.y   = y0 + 20;
+  label.txt = tmp;
+
+  labels_.push_back (label);
 
   if ( ! msg.empty () )
   {
-    int x_off = msg.size () * 10;
-    XDrawString  (dpy_, win_, gc_, x0 + n_x - 20 - x_off, y0 + n_y - 20, 
-                  msg.c_str (), msg.size ());
+    label.x   = x0 + n_x - 20 - msg.size () * 10;
+    label.y   = y0 + n_y - 20;
+    label.txt = msg;
+
+    labels_.push_back (label);
   }
 
-  // flush window contents to make sure everything gets drawn
-  XFlush (dpy_);
+  mark_dirty_ (x0, y0, x0 + n_x, y0 + n_y);
+
+  // blit the dirty rectangle - a no-op until flush_ms_ passed since
+  // the last update
+  flush_ (false);
 }
 
 #endif // HAVE_X11
@@ -4,7 +4,10 @@
 #ifndef SAGA_MANDELBROT_OUTPUT_X11_HPP
 #define SAGA_MANDELBROT_OUTPUT_X11_HPP
 
+#include <sys/time.h>
+
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
 #include <X11/Xcms.h>
 
 #include "output_base.hpp"
@@ -36,6 +39,34 @@ class output_x11 : public output_base
     Colormap             cmap_;
     std::vector <long>   colors_;
 
+    // double buffering: results are painted into this client-side
+    // image (no X round-trips), and the dirty rectangle is blitted
+    // to the window at most every flush_ms_ - so display cost no
+    // longer throttles result ingestion (paint_box runs on the same
+    // thread that pops results)
+    XImage             * img_;
+    long                 flush_ms_;
+    struct timeval       last_flush_;
+
+    int                  dirty_x0_;  // dirty bounding rect; x0 > x1
+    int                  dirty_y0_;  // means nothing is dirty
+    int                  dirty_x1_;
+    int                  dirty_y1_;
+
+    // box labels are server-side text, drawn after the blit
+    struct label_t
+    {
+      int         x;
+      int         y;
+      std::string txt;
+    };
+
+    std::vector <label_t> labels_;
+
+    void put_pixel_  (int x, int y, unsigned long pixel);
+    void mark_dirty_ (int x0, int y0, int x1, int y1);
+    void flush_      (bool force);
+
     // others
     bool                 fallback_;
 
@@ -0,0 +1,94 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstdlib>
+#include <iostream>
+
+#include <master_worker.hpp>
+
+#include "../../../common/profiler.hpp"
+
+///////////////////////////////////////////////////////////////////////
+//
+// the hello_world master, doubling as the framework benchmark: it
+// pushes n items through however many workers connect, and reports
+// the item throughput.
+//
+//   mw_helloworld_master [n] [url] [advert_path]
+//
+//   n            number of items           (default 1000)
+//   url          stream endpoint to serve  (default tcp://localhost:8085)
+//   advert_path  if given, the endpoint is published there for
+//                advert-based worker discovery
+//
+
+namespace
+{
+  class count_results : public saga_pm::master_worker::result_handler
+  {
+    public:
+      unsigned long count;
+
+      count_results (void)
+        : count (0)
+      {
+      }
+
+      void handle_result (unsigned long id, std::string const & result)
+      {
+        count++;
+
+        if ( 1 == count )
+        {
+          // show one result, so the example stays an example
+          std::cout << "first result (item " << id << "): "
+                    << result << std::endl;
+        }
+      }
+  };
+}
+
+
+int main (int argc, char * argv[])
+{
+  unsigned long n   = (argc > 1) ? ::atol (argv[1]) : 1000;
+  saga::url     url ((argc > 2) ? argv[2] : "tcp://localhost:8085");
+
+  try
+  {
+    saga_pm::master_worker::master m (url);
+
+    if ( argc > 3 )
+    {
+      m.advertise (argv[3]);
+    }
+
+    for ( unsigned long i = 0; i < n; i++ )
+    {
+      m.add_item (saga_pm::master_worker::work_item (i, "hello world"));
+    }
+
+    m.no_more_items ();
+
+    count_results results;
+
+    profiler::high_resolution_timer timer;
+
+    m.run (results);
+
+    double elapsed = timer.elapsed ();
+
+    std::cout << results.count << " items in " << elapsed << " s ("
+              << (elapsed > 0.0 ? double (results.count) / elapsed : 0.0)
+              << " items/s)" << std::endl;
+  }
+  catch ( saga::exception const & e )
+  {
+    std::cerr << "saga exception: " << e.what () << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
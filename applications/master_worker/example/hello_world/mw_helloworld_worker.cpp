@@ -0,0 +1,61 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <iostream>
+#include <string>
+
+#include <master_worker.hpp>
+
+///////////////////////////////////////////////////////////////////////
+//
+// the hello_world worker.
+//
+//   mw_helloworld_worker [url_or_advert_path]
+//
+// the argument is either the master's stream endpoint, or (if it has
+// an advert scheme) the advert path the master published its endpoint
+// under.
+//
+
+namespace
+{
+  class hello_handler : public saga_pm::master_worker::item_handler
+  {
+    public:
+      std::string handle_item (unsigned long id, std::string const & payload)
+      {
+        return payload + "!";
+      }
+  };
+}
+
+
+int main (int argc, char * argv[])
+{
+  std::string target = (argc > 1) ? argv[1] : "tcp://localhost:8085";
+
+  try
+  {
+    hello_handler handler;
+
+    if ( 0 == target.find ("advert://") )
+    {
+      saga_pm::master_worker::worker w (target);
+      w.run (handler);
+    }
+    else
+    {
+      saga_pm::master_worker::worker w (saga::url (target));
+      w.run (handler);
+    }
+  }
+  catch ( saga::exception const & e )
+  {
+    std::cerr << "saga exception: " << e.what () << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
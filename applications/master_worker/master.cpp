@@ -0,0 +1,257 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <boost/bind.hpp>
+
+#include "wire.hpp"
+#include "master.hpp"
+
+namespace saga_pm
+{
+  namespace master_worker
+  {
+    ///////////////////////////////////////////////////////////////////
+    //
+    master::master (saga::url url, unsigned int pipeline_depth)
+      : url_            (url)
+      , pipeline_depth_ (pipeline_depth)
+      , outstanding_    (0)
+      , done_adding_    (false)
+      , shutdown_       (false)
+      , handler_        (NULL)
+    {
+      if ( pipeline_depth_ < 1 )
+      {
+        pipeline_depth_ = 1;
+      }
+    }
+
+
+    master::~master (void)
+    {
+      for ( unsigned int i = 0; i < threads_.size (); i++ )
+      {
+        delete threads_[i];
+      }
+    }
+
+
+    ///////////////////////////////////////////////////////////////////
+    //
+    void master::advertise (std::string advert_path)
+    {
+      int mode = saga::advert::CreateParents | saga::advert::ReadWrite;
+
+      saga::advert::entry adv (advert_path, mode);
+      adv.store_string (url_.get_url ());
+    }
+
+
+    ///////////////////////////////////////////////////////////////////
+    //
+    void master::add_item (work_item const & item)
+    {
+      boost::mutex::scoped_lock lock (mtx_);
+
+      queue_.push_back (item);
+      cond_.notify_one ();
+    }
+
+
+    void master::no_more_items (void)
+    {
+      boost::mutex::scoped_lock lock (mtx_);
+
+      done_adding_ = true;
+      cond_.notify_all ();
+    }
+
+
+    ///////////////////////////////////////////////////////////////////
+    //
+    bool master::next_item (work_item & item, bool block)
+    {
+      boost::mutex::scoped_lock lock (mtx_);
+
+      while ( queue_.empty () && ! done_adding_ && ! shutdown_ )
+      {
+        if ( ! block )
+        {
+          return false;
+        }
+
+        cond_.wait (lock);
+      }
+
+      if ( queue_.empty () )
+      {
+        return false;
+      }
+
+      item = queue_.front ();
+      queue_.pop_front ();
+
+      outstanding_++;
+
+      return true;
+    }
+
+
+    void master::requeue (std::deque <work_item> & in_flight)
+    {
+      boost::mutex::scoped_lock lock (mtx_);
+
+      while ( ! in_flight.empty () )
+      {
+        // to the front - these items are older than anything queued
+        queue_.push_front (in_flight.back ());
+        in_flight.pop_back ();
+
+        outstanding_--;
+      }
+
+      cond_.notify_all ();
+    }
+
+
+    ///////////////////////////////////////////////////////////////////
+    //
+    // one thread per connected worker.  The pipeline is kept topped up
+    // to pipeline_depth_ items before each result read, so the worker
+    // finds its next item already in its receive buffer and never
+    // idles on our round trip.
+    //
+    void master::serve_connection (saga::stream::stream s)
+    {
+      std::deque <work_item> in_flight;
+
+      try
+      {
+        while ( true )
+        {
+          // top up the pipeline.  Only block for an item if nothing is
+          // in flight - otherwise go read results
+          while ( in_flight.size () < pipeline_depth_ )
+          {
+            work_item item;
+
+            if ( ! next_item (item, in_flight.empty ()) )
+            {
+              break;
+            }
+
+            if ( ! wire::write_all (s, item.frame ().data (),
+                                       item.frame ().size ()) )
+            {
+              in_flight.push_back (item);
+              requeue (in_flight);
+              return;
+            }
+
+            in_flight.push_back (item);
+          }
+
+          if ( in_flight.empty () )
+          {
+            // no work now, and none will come - release the worker
+            std::string bye = wire::make_frame (wire::shutdown_id, "");
+            wire::write_all (s, bye.data (), bye.size ());
+            s.close ();
+            return;
+          }
+
+          uint32_t    id;
+          std::string result;
+
+          if ( ! wire::read_frame (s, id, result) )
+          {
+            // connection died - hand the items to other workers
+            requeue (in_flight);
+            return;
+          }
+
+          // drop the answered item from the in-flight list
+          for ( std::deque <work_item>::iterator it = in_flight.begin ();
+                it != in_flight.end (); ++it )
+          {
+            if ( (*it).id () == (unsigned long) id )
+            {
+              in_flight.erase (it);
+              break;
+            }
+          }
+
+          {
+            boost::mutex::scoped_lock lock (handler_mtx_);
+            handler_->handle_result (id, result);
+          }
+
+          {
+            boost::mutex::scoped_lock lock (mtx_);
+            outstanding_--;
+            cond_.notify_all ();
+          }
+        }
+      }
+      catch ( saga::exception const & )
+      {
+        requeue (in_flight);
+      }
+    }
+
+
+    ///////////////////////////////////////////////////////////////////
+    //
+    void master::run (result_handler & handler)
+    {
+      handler_ = &handler;
+
+      saga::stream::server server (url_);
+
+      while ( true )
+      {
+        {
+          boost::mutex::scoped_lock lock (mtx_);
+
+          if ( done_adding_ && queue_.empty () && 0 == outstanding_ )
+          {
+            break;
+          }
+        }
+
+        try
+        {
+          // short timeout, so we notice completion without a new
+          // connection coming in
+          saga::stream::stream s = server.serve (1.0);
+
+          threads_.push_back (new boost::thread (
+            TR1::bind (&master::serve_connection, this, s)));
+        }
+        catch ( saga::exception const & )
+        {
+          // serve timed out - check the exit condition again
+        }
+      }
+
+      // wake serving threads blocked on an empty queue; they will send
+      // their workers the shutdown frame
+      {
+        boost::mutex::scoped_lock lock (mtx_);
+        shutdown_ = true;
+        cond_.notify_all ();
+      }
+
+      for ( unsigned int i = 0; i < threads_.size (); i++ )
+      {
+        threads_[i]->join ();
+      }
+
+      server.close ();
+    }
+
+  } // namespace master_worker
+
+} // namespace saga_pm
@@ -0,0 +1,114 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef SAGA_PM_MASTER_WORKER_MASTER_HPP
+#define SAGA_PM_MASTER_WORKER_MASTER_HPP
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <saga/saga.hpp>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+
+#include "work_item.hpp"
+
+namespace saga_pm
+{
+  namespace master_worker
+  {
+    ///////////////////////////////////////////////////////////////////
+    //
+    // callback for finished work items.  Results may arrive from any
+    // worker in any order; the framework serializes the calls.
+    //
+    class result_handler
+    {
+      public:
+        virtual ~result_handler (void)
+        {
+        }
+
+        virtual void handle_result (unsigned long       id,
+                                    std::string const & result) = 0;
+    };
+
+
+    ///////////////////////////////////////////////////////////////////
+    //
+    // the master end of the framework.  It listens on one stream
+    // endpoint and multiplexes any number of workers over persistent
+    // connections: each accepted worker gets a serving thread which
+    // keeps 'pipeline_depth' items on the wire, so the worker receives
+    // its next item while the master still waits for the previous
+    // result.  Items in flight on a dying connection go back into the
+    // queue and are re-sent to other workers.
+    //
+    // usage:
+    //
+    //   master m (saga::url ("tcp://localhost:8085"));
+    //   m.advertise ("advert://host//my_app/master");   // optional
+    //   m.add_item (work_item (1, "..."));
+    //   m.no_more_items ();
+    //   m.run (my_handler);                             // blocks
+    //
+    class master
+    {
+      private:
+        saga::url    url_;
+        unsigned int pipeline_depth_;
+
+        // the work queue, and the number of items handed out but not
+        // yet answered
+        std::deque <work_item> queue_;
+        unsigned int           outstanding_;
+        bool                   done_adding_;
+        bool                   shutdown_;
+
+        boost::mutex     mtx_;
+        boost::condition cond_;
+
+        result_handler * handler_;
+        boost::mutex     handler_mtx_;
+
+        std::vector <boost::thread *> threads_;
+
+        // fetch the next item.  Blocks if 'block' is set and the queue
+        // is merely empty; returns false once no item will ever come
+        // again (or, non-blocking, if none is available right now)
+        bool next_item (work_item & item, bool block);
+
+        // put items from a dead connection back into the queue
+        void requeue (std::deque <work_item> & in_flight);
+
+        // one thread per connected worker
+        void serve_connection (saga::stream::stream s);
+
+      public:
+        master (saga::url url, unsigned int pipeline_depth = 2);
+        ~master (void);
+
+        // discovery hook: publish the stream endpoint in the advert
+        // service, where worker (std::string) picks it up
+        void advertise (std::string advert_path);
+
+        void add_item (work_item const & item);
+
+        // no further add_item calls will follow; run() returns once
+        // the queue is drained
+        void no_more_items (void);
+
+        // serve workers until all items are answered.  Blocks.
+        void run (result_handler & handler);
+    };
+
+  } // namespace master_worker
+
+} // namespace saga_pm
+
+#endif // SAGA_PM_MASTER_WORKER_MASTER_HPP
@@ -0,0 +1,15 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef SAGA_PM_MASTER_WORKER_HPP
+#define SAGA_PM_MASTER_WORKER_HPP
+
+// umbrella header for the master/worker programming abstraction
+
+#include "work_item.hpp"
+#include "master.hpp"
+#include "worker.hpp"
+
+#endif // SAGA_PM_MASTER_WORKER_HPP
@@ -0,0 +1,10 @@
+#  Copyright (c) 2005-2006 Andre Merzky (andre@merzky.net)
+#
+#  Distributed under the Boost Software License, Version 1.0. (See accompanying
+#  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+# build glue for master_worker examples: pick up the library headers,
+# and link against the library built in $(SAGA_MW_ROOT)
+
+SAGA_CXXFLAGS += -I$(SAGA_MW_ROOT)
+SAGA_LDFLAGS  += -L$(SAGA_MW_ROOT) -lsaga_pm_master_worker
@@ -0,0 +1,139 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef SAGA_PM_MASTER_WORKER_WIRE_HPP
+#define SAGA_PM_MASTER_WORKER_WIRE_HPP
+
+#include <string>
+
+#include <arpa/inet.h>
+
+#include <saga/saga.hpp>
+
+///////////////////////////////////////////////////////////////////////
+//
+// the wire format shared by master and worker.  Both directions use the
+// same length-prefixed frame:
+//
+//   uint32 item id  |  uint32 payload length  |  payload bytes
+//
+// all integers in network byte order.  The master sends item frames,
+// the worker answers with result frames carrying the same id, so
+// several items can be on the wire at once and results can be matched
+// up out of order.
+//
+namespace saga_pm
+{
+  namespace master_worker
+  {
+    namespace wire
+    {
+      // the pseudo item id which tells a worker to shut down
+      static const uint32_t shutdown_id = 0xFFFFFFFFu;
+
+      // frames larger than this are considered bogus and kill the
+      // connection
+      static const uint32_t max_payload = 64 << 20;
+
+
+      // read exactly 'want' bytes off the stream (it may deliver less
+      // per call); false on error or connection close
+      inline bool read_exact (saga::stream::stream & s,
+                              char * buf, unsigned int want)
+      {
+        unsigned int got = 0;
+
+        while ( got < want )
+        {
+          saga::ssize_t n = s.read (saga::buffer (buf + got, want - got),
+                                    want - got);
+
+          if ( n <= 0 )
+          {
+            return false;
+          }
+
+          got += n;
+        }
+
+        return true;
+      }
+
+
+      // write all 'len' bytes to the stream; false on error
+      inline bool write_all (saga::stream::stream & s,
+                             char const * buf, unsigned int len)
+      {
+        unsigned int sent = 0;
+
+        while ( sent < len )
+        {
+          saga::ssize_t n = s.write (saga::buffer (buf + sent, len - sent),
+                                     len - sent);
+
+          if ( n <= 0 )
+          {
+            return false;
+          }
+
+          sent += n;
+        }
+
+        return true;
+      }
+
+
+      // serialize one frame.  This is the only place the layout lives.
+      inline std::string make_frame (uint32_t id, std::string const & payload)
+      {
+        char head[8];
+
+        *(uint32_t *) (head)     = htonl (id);
+        *(uint32_t *) (head + 4) = htonl ((uint32_t) payload.size ());
+
+        std::string frame (head, 8);
+        frame += payload;
+
+        return frame;
+      }
+
+
+      // read one complete frame; false on error, close, or a bogus
+      // length
+      inline bool read_frame (saga::stream::stream & s,
+                              uint32_t & id, std::string & payload)
+      {
+        char head[8];
+
+        if ( ! read_exact (s, head, 8) )
+        {
+          return false;
+        }
+
+        id = ntohl (*(uint32_t *) (head));
+        uint32_t len = ntohl (*(uint32_t *) (head + 4));
+
+        if ( len > max_payload )
+        {
+          return false;
+        }
+
+        payload.resize (len);
+
+        if ( len > 0 && ! read_exact (s, &payload[0], len) )
+        {
+          return false;
+        }
+
+        return true;
+      }
+
+    } // namespace wire
+
+  } // namespace master_worker
+
+} // namespace saga_pm
+
+#endif // SAGA_PM_MASTER_WORKER_WIRE_HPP
@@ -0,0 +1,65 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef SAGA_PM_MASTER_WORKER_WORK_ITEM_HPP
+#define SAGA_PM_MASTER_WORKER_WORK_ITEM_HPP
+
+#include <string>
+
+#include "wire.hpp"
+
+namespace saga_pm
+{
+  namespace master_worker
+  {
+    ///////////////////////////////////////////////////////////////////
+    //
+    // one unit of work.  The wire frame is built once at construction
+    // time, so handing the item to any number of workers (including
+    // re-sending it after a worker died) costs a buffer write, not a
+    // serialization.
+    //
+    class work_item
+    {
+      private:
+        unsigned long id_;
+        std::string   payload_;
+        std::string   frame_;
+
+      public:
+        work_item (void)
+          : id_ (0)
+        {
+        }
+
+        work_item (unsigned long id, std::string const & payload)
+          : id_      (id)
+          , payload_ (payload)
+          , frame_   (wire::make_frame ((uint32_t) id, payload))
+        {
+        }
+
+        unsigned long id (void) const
+        {
+          return id_;
+        }
+
+        std::string const & payload (void) const
+        {
+          return payload_;
+        }
+
+        // the pre-serialized frame as it goes onto the stream
+        std::string const & frame (void) const
+        {
+          return frame_;
+        }
+    };
+
+  } // namespace master_worker
+
+} // namespace saga_pm
+
+#endif // SAGA_PM_MASTER_WORKER_WORK_ITEM_HPP
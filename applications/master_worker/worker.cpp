@@ -0,0 +1,61 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include "wire.hpp"
+#include "worker.hpp"
+
+namespace saga_pm
+{
+  namespace master_worker
+  {
+    ///////////////////////////////////////////////////////////////////
+    //
+    worker::worker (saga::url master_url)
+      : url_ (master_url)
+    {
+    }
+
+
+    worker::worker (std::string advert_path)
+    {
+      saga::advert::entry adv (advert_path, saga::advert::Read);
+
+      url_ = saga::url (adv.retrieve_string ());
+    }
+
+
+    ///////////////////////////////////////////////////////////////////
+    //
+    void worker::run (item_handler & handler)
+    {
+      saga::stream::stream s (url_);
+
+      s.connect ();
+
+      uint32_t    id;
+      std::string payload;
+
+      while ( wire::read_frame (s, id, payload) )
+      {
+        if ( wire::shutdown_id == id )
+        {
+          break;
+        }
+
+        std::string result = handler.handle_item (id, payload);
+        std::string frame  = wire::make_frame (id, result);
+
+        if ( ! wire::write_all (s, frame.data (), frame.size ()) )
+        {
+          break;
+        }
+      }
+
+      s.close ();
+    }
+
+  } // namespace master_worker
+
+} // namespace saga_pm
@@ -0,0 +1,62 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef SAGA_PM_MASTER_WORKER_WORKER_HPP
+#define SAGA_PM_MASTER_WORKER_WORKER_HPP
+
+#include <string>
+
+#include <saga/saga.hpp>
+
+namespace saga_pm
+{
+  namespace master_worker
+  {
+    ///////////////////////////////////////////////////////////////////
+    //
+    // callback computing the result for one work item
+    //
+    class item_handler
+    {
+      public:
+        virtual ~item_handler (void)
+        {
+        }
+
+        virtual std::string handle_item (unsigned long       id,
+                                         std::string const & payload) = 0;
+    };
+
+
+    ///////////////////////////////////////////////////////////////////
+    //
+    // the worker end of the framework.  It holds one persistent
+    // connection to the master and answers item frames until the
+    // master sends the shutdown frame.  Thanks to the master side
+    // pipelining the next item is normally already in the receive
+    // buffer when a result goes out.
+    //
+    class worker
+    {
+      private:
+        saga::url url_;
+
+      public:
+        // connect to a known master endpoint
+        worker (saga::url master_url);
+
+        // discovery hook: look the master endpoint up in the advert
+        // service (the path given to master::advertise ())
+        worker (std::string advert_path);
+
+        // process items until the master releases us.  Blocks.
+        void run (item_handler & handler);
+    };
+
+  } // namespace master_worker
+
+} // namespace saga_pm
+
+#endif // SAGA_PM_MASTER_WORKER_WORKER_HPP
@@ -0,0 +1,72 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef SAGA_MERGESORT_COMMON_HPP
+#define SAGA_MERGESORT_COMMON_HPP
+
+#include <string>
+
+#include <sys/time.h>
+
+#include <boost/cstdint.hpp>
+
+///////////////////////////////////////////////////////////////////////
+//
+// shared bits of the distributed external mergesort.
+//
+// the data format is deliberately trivial: a file of unsigned 64 bit
+// keys, host byte order, 8 bytes each.  That keeps the sample readable
+// and makes the sort throughput numbers directly comparable between
+// storage endpoints.
+//
+// coordination goes through the advert service:
+//
+//   <base>/                 INPUT, OUTPUT, RUNS, RUN_SIZE
+//   <base>/RUNS/run_<i>     OFFSET, LENGTH, OUTPUT, STATE
+//
+// the master cuts the input into runs and posts one advert entry per
+// run; workers claim runs (STATE "" -> their id), sort them into run
+// files on the shared scratch filesystem, and mark them DONE; the
+// master then merges the run files into the output.
+//
+namespace mergesort
+{
+  typedef boost::uint64_t key_type;
+
+  static const unsigned int key_size = sizeof (key_type);
+
+
+  // advert attribute names
+  static char const * const attr_input    = "INPUT";
+  static char const * const attr_output   = "OUTPUT";
+  static char const * const attr_runs     = "RUNS";
+  static char const * const attr_run_size = "RUN_SIZE";
+  static char const * const attr_offset   = "OFFSET";
+  static char const * const attr_length   = "LENGTH";
+  static char const * const attr_state    = "STATE";
+
+  static char const * const state_done    = "DONE";
+
+  static char const * const dir_runs      = "RUNS";
+
+
+  // wall clock in seconds, for the phase timings
+  inline double now (void)
+  {
+    struct timeval tv;
+    gettimeofday (&tv, 0);
+    return (double) tv.tv_sec + (double) tv.tv_usec * 1e-6;
+  }
+
+
+  // bytes/seconds -> MB/s, guarded against zero elapsed time
+  inline double rate (double bytes, double seconds)
+  {
+    return (seconds > 0.0) ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+  }
+
+} // namespace mergesort
+
+#endif // SAGA_MERGESORT_COMMON_HPP
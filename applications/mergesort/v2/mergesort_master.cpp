@@ -0,0 +1,308 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <saga/saga.hpp>
+
+#include <boost/lexical_cast.hpp>
+
+#include "mergesort_common.hpp"
+
+///////////////////////////////////////////////////////////////////////
+//
+// the mergesort master.
+//
+//   mergesort_master <input> <output> <advert_base> [run_size_mb]
+//
+// cuts the input into runs, posts one advert entry per run under
+// <base>/RUNS/ for the workers to claim, waits until all runs are
+// sorted, and then streams a k-way merge of the run files into the
+// output.  Input, output and the run files live on the shared scratch
+// filesystem; the advert service carries only the coordination.
+//
+// each phase is timed and reported with its throughput, so a full run
+// doubles as an I/O benchmark for the storage endpoint holding the
+// data.
+//
+
+namespace
+{
+  // default run size: 256 MB - large enough for the sort to be compute
+  // bound, small enough for several runs to sort in parallel
+  const size_t default_run_size = 256 * 1024 * 1024;
+
+  // streaming buffers for the merge: 1 MB per run, 4 MB for the output
+  const size_t merge_buf_keys = (1024 * 1024) / mergesort::key_size;
+  const size_t out_buf_keys   = (4 * 1024 * 1024) / mergesort::key_size;
+
+
+  ///////////////////////////////////////////////////////////////////
+  //
+  // buffered reader over one sorted run file
+  //
+  class run_reader
+  {
+    private:
+      FILE * f_;
+      std::vector <mergesort::key_type> buf_;
+      size_t pos_;
+      size_t avail_;
+
+      bool refill (void)
+      {
+        avail_ = ::fread (&buf_[0], mergesort::key_size, buf_.size (), f_);
+        pos_   = 0;
+        return avail_ > 0;
+      }
+
+    public:
+      run_reader (std::string const & path)
+        : f_     (::fopen (path.c_str (), "rb"))
+        , buf_   (merge_buf_keys)
+        , pos_   (0)
+        , avail_ (0)
+      {
+      }
+
+      ~run_reader (void)
+      {
+        if ( f_ )
+        {
+          ::fclose (f_);
+        }
+      }
+
+      bool ok (void) const
+      {
+        return NULL != f_;
+      }
+
+      bool next (mergesort::key_type & key)
+      {
+        if ( pos_ >= avail_ && ! refill () )
+        {
+          return false;
+        }
+
+        key = buf_[pos_++];
+        return true;
+      }
+  };
+}
+
+
+int main (int argc, char * argv[])
+{
+  if ( argc < 4 )
+  {
+    std::cerr << "usage: " << argv[0]
+              << " <input> <output> <advert_base> [run_size_mb]"
+              << std::endl;
+    return -1;
+  }
+
+  std::string input  (argv[1]);
+  std::string output (argv[2]);
+  std::string base   (argv[3]);
+
+  size_t run_size = (argc > 4)
+                  ? (size_t) ::atol (argv[4]) * 1024 * 1024
+                  : default_run_size;
+
+  // runs must hold whole keys
+  run_size -= run_size % mergesort::key_size;
+
+  struct stat st;
+  if ( 0 != ::stat (input.c_str (), &st) )
+  {
+    std::cerr << "cannot stat " << input << std::endl;
+    return -1;
+  }
+
+  size_t size = st.st_size;
+  size_t runs = (size + run_size - 1) / run_size;
+
+  double t_start = mergesort::now ();
+
+  try
+  {
+    ///////////////////////////////////////////////////////////////////
+    // phase 1: post the runs for the workers
+    int mode = saga::advert::CreateParents | saga::advert::ReadWrite;
+
+    saga::advert::directory basedir (base, mode);
+    basedir.set_attribute (mergesort::attr_input,  input);
+    basedir.set_attribute (mergesort::attr_output, output);
+    basedir.set_attribute (mergesort::attr_runs,
+                           boost::lexical_cast <std::string> (runs));
+    basedir.set_attribute (mergesort::attr_run_size,
+                           boost::lexical_cast <std::string> (run_size));
+
+    saga::advert::directory runsdir =
+      basedir.open_dir (mergesort::dir_runs, mode);
+
+    for ( size_t i = 0; i < runs; i++ )
+    {
+      size_t offset = i * run_size;
+      size_t length = std::min (run_size, size - offset);
+
+      saga::advert::entry run = runsdir.open (
+        "run_" + boost::lexical_cast <std::string> (i), mode);
+
+      run.set_attribute (mergesort::attr_input,  input);
+      run.set_attribute (mergesort::attr_output,
+        output + ".run" + boost::lexical_cast <std::string> (i));
+      run.set_attribute (mergesort::attr_offset,
+        boost::lexical_cast <std::string> (offset));
+      run.set_attribute (mergesort::attr_length,
+        boost::lexical_cast <std::string> (length));
+      run.set_attribute (mergesort::attr_state, "");
+    }
+
+    std::cout << "posted " << runs << " runs (" << size << " bytes) under "
+              << base << std::endl;
+
+    ///////////////////////////////////////////////////////////////////
+    // phase 2: wait for the workers
+    while ( true )
+    {
+      size_t done = 0;
+
+      std::vector <saga::url> entries = runsdir.list ("*");
+
+      for ( unsigned int i = 0; i < entries.size (); i++ )
+      {
+        saga::advert::entry run = runsdir.open (entries[i],
+                                                saga::advert::Read);
+
+        if ( mergesort::state_done ==
+             run.get_attribute (mergesort::attr_state) )
+        {
+          done++;
+        }
+      }
+
+      if ( done >= runs )
+      {
+        break;
+      }
+
+      ::sleep (5);
+    }
+
+    double t_merge = mergesort::now ();
+
+    std::cout << "all runs sorted after " << (t_merge - t_start) << " s"
+              << std::endl;
+
+    ///////////////////////////////////////////////////////////////////
+    // phase 3: streaming k-way merge of the run files
+    std::vector <run_reader *> readers;
+
+    for ( size_t i = 0; i < runs; i++ )
+    {
+      run_reader * r = new run_reader (
+        output + ".run" + boost::lexical_cast <std::string> (i));
+
+      if ( ! r->ok () )
+      {
+        std::cerr << "cannot open run file " << i << std::endl;
+        return -1;
+      }
+
+      readers.push_back (r);
+    }
+
+    FILE * out = ::fopen (output.c_str (), "wb");
+
+    if ( NULL == out )
+    {
+      std::cerr << "cannot create " << output << std::endl;
+      return -1;
+    }
+
+    typedef std::pair <mergesort::key_type, size_t> head_t;
+
+    std::priority_queue <head_t, std::vector <head_t>,
+                         std::greater <head_t> > heap;
+
+    mergesort::key_type key;
+
+    for ( size_t i = 0; i < readers.size (); i++ )
+    {
+      if ( readers[i]->next (key) )
+      {
+        heap.push (head_t (key, i));
+      }
+    }
+
+    std::vector <mergesort::key_type> outbuf;
+    outbuf.reserve (out_buf_keys);
+
+    while ( ! heap.empty () )
+    {
+      head_t head = heap.top ();
+      heap.pop ();
+
+      outbuf.push_back (head.first);
+
+      if ( outbuf.size () >= out_buf_keys )
+      {
+        ::fwrite (&outbuf[0], mergesort::key_size, outbuf.size (), out);
+        outbuf.clear ();
+      }
+
+      if ( readers[head.second]->next (key) )
+      {
+        heap.push (head_t (key, head.second));
+      }
+    }
+
+    if ( ! outbuf.empty () )
+    {
+      ::fwrite (&outbuf[0], mergesort::key_size, outbuf.size (), out);
+    }
+
+    ::fclose (out);
+
+    for ( size_t i = 0; i < readers.size (); i++ )
+    {
+      delete readers[i];
+      ::remove ((output + ".run"
+                 + boost::lexical_cast <std::string> (i)).c_str ());
+    }
+
+    double t_end = mergesort::now ();
+
+    ///////////////////////////////////////////////////////////////////
+    // the benchmark report.  The merge reads and writes every byte
+    // once, so its rate is the streaming throughput of the endpoint
+    std::cout << "sort  phase: " << (t_merge - t_start) << " s" << std::endl
+              << "merge phase: " << (t_end - t_merge) << " s ("
+              << mergesort::rate (2.0 * size, t_end - t_merge)
+              << " MB/s streamed)" << std::endl
+              << "total      : " << (t_end - t_start) << " s ("
+              << mergesort::rate (size, t_end - t_start)
+              << " MB/s sorted)" << std::endl;
+  }
+  catch ( saga::exception const & e )
+  {
+    std::cerr << "saga exception: " << e.what () << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,227 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <saga/saga.hpp>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+#include "mergesort_common.hpp"
+
+///////////////////////////////////////////////////////////////////////
+//
+// the mergesort worker.
+//
+//   mergesort_worker <advert_base> [threads]
+//
+// claims runs from <base>/RUNS/, sorts each one and writes the sorted
+// run file.  The input run is memory mapped (the data plane is plain
+// POSIX - SAGA carries only the coordination), and the run is sorted
+// with one thread per core: the keys are cut into per-thread blocks,
+// each block is sorted independently, and the blocks are then folded
+// together with inplace_merge.
+//
+
+namespace
+{
+  // sort one block; boost::thread entry
+  void sort_block (mergesort::key_type * begin, mergesort::key_type * end)
+  {
+    std::sort (begin, end);
+  }
+
+
+  // sort 'count' keys with 'threads' threads
+  void parallel_sort (mergesort::key_type * keys, size_t count,
+                      unsigned int threads)
+  {
+    if ( threads < 2 || count < 2 * threads )
+    {
+      std::sort (keys, keys + count);
+      return;
+    }
+
+    size_t block = count / threads;
+
+    std::vector <size_t> bounds;
+    for ( unsigned int i = 0; i < threads; i++ )
+    {
+      bounds.push_back (i * block);
+    }
+    bounds.push_back (count);
+
+    std::vector <boost::thread *> pool;
+    for ( unsigned int i = 0; i < threads; i++ )
+    {
+      pool.push_back (new boost::thread (
+        boost::bind (&sort_block, keys + bounds[i], keys + bounds[i + 1])));
+    }
+    for ( unsigned int i = 0; i < pool.size (); i++ )
+    {
+      pool[i]->join ();
+      delete pool[i];
+    }
+
+    // fold the sorted blocks together, doubling the merged prefix each
+    // round: lg (threads) passes over the data
+    for ( size_t width = block; width < count; width *= 2 )
+    {
+      for ( size_t lo = 0; lo + width < count; lo += 2 * width )
+      {
+        size_t hi = std::min (lo + 2 * width, count);
+        std::inplace_merge (keys + lo, keys + lo + width, keys + hi);
+      }
+    }
+  }
+
+
+  // process one claimed run: mmap the input slice, sort, write the run
+  // file.  False on any I/O problem.
+  bool process_run (std::string input, std::string output,
+                    off_t offset, size_t length, unsigned int threads)
+  {
+    int fd = ::open (input.c_str (), O_RDONLY);
+
+    if ( fd < 0 )
+    {
+      std::cerr << "cannot open " << input << std::endl;
+      return false;
+    }
+
+    void * map = ::mmap (0, length, PROT_READ, MAP_PRIVATE, fd, offset);
+
+    if ( MAP_FAILED == map )
+    {
+      std::cerr << "cannot mmap " << input << std::endl;
+      ::close (fd);
+      return false;
+    }
+
+    size_t count = length / mergesort::key_size;
+
+    // the map is read only - sort a copy
+    std::vector <mergesort::key_type> keys (count);
+    std::copy ((mergesort::key_type *) map,
+               (mergesort::key_type *) map + count, keys.begin ());
+
+    ::munmap (map, length);
+    ::close (fd);
+
+    double t_sort = mergesort::now ();
+
+    parallel_sort (&keys[0], count, threads);
+
+    double t_write = mergesort::now ();
+
+    FILE * out = ::fopen (output.c_str (), "wb");
+
+    if ( NULL == out )
+    {
+      std::cerr << "cannot create " << output << std::endl;
+      return false;
+    }
+
+    bool ok = (count == ::fwrite (&keys[0], mergesort::key_size, count, out));
+
+    ::fclose (out);
+
+    double t_end = mergesort::now ();
+
+    std::cout << "run " << output << ": " << length << " bytes, sort "
+              << (t_write - t_sort) << " s, write " << (t_end - t_write)
+              << " s (" << mergesort::rate (length, t_end - t_write)
+              << " MB/s)" << std::endl;
+
+    return ok;
+  }
+}
+
+
+int main (int argc, char * argv[])
+{
+  if ( argc < 2 )
+  {
+    std::cerr << "usage: " << argv[0] << " <advert_base> [threads]"
+              << std::endl;
+    return -1;
+  }
+
+  unsigned int threads = (argc > 2) ? ::atoi (argv[2])
+                                    : ::sysconf (_SC_NPROCESSORS_ONLN);
+  if ( threads < 1 )
+  {
+    threads = 1;
+  }
+
+  // our claim tag
+  std::string id = "worker_" + boost::lexical_cast <std::string> (::getpid ());
+
+  try
+  {
+    saga::advert::directory runs (std::string (argv[1]) + "/"
+                                  + mergesort::dir_runs,
+                                  saga::advert::ReadWrite);
+
+    unsigned int sorted = 0;
+
+    std::vector <saga::url> entries = runs.list ("*");
+
+    for ( unsigned int i = 0; i < entries.size (); i++ )
+    {
+      saga::advert::entry run = runs.open (entries[i],
+                                           saga::advert::ReadWrite);
+
+      // claim: empty STATE -> our id.  Two workers racing here at worst
+      // sort the same run twice, which is wasted work but still correct
+      if ( "" != run.get_attribute (mergesort::attr_state) )
+      {
+        continue;
+      }
+
+      run.set_attribute (mergesort::attr_state, id);
+
+      std::string input  = run.get_attribute (mergesort::attr_input);
+      std::string output = run.get_attribute (mergesort::attr_output);
+
+      off_t  offset = boost::lexical_cast <off_t> (
+                        run.get_attribute (mergesort::attr_offset));
+      size_t length = boost::lexical_cast <size_t> (
+                        run.get_attribute (mergesort::attr_length));
+
+      if ( process_run (input, output, offset, length, threads) )
+      {
+        run.set_attribute (mergesort::attr_state, mergesort::state_done);
+        sorted++;
+      }
+      else
+      {
+        // release the run for another worker
+        run.set_attribute (mergesort::attr_state, "");
+      }
+    }
+
+    std::cout << id << ": sorted " << sorted << " runs" << std::endl;
+  }
+  catch ( saga::exception const & e )
+  {
+    std::cerr << "saga exception: " << e.what () << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
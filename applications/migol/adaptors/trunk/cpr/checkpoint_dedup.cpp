@@ -0,0 +1,374 @@
+//  Copyright (c) 2005-2008 Hartmut Kaiser
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <map>
+#include <set>
+
+#include <unistd.h>
+
+#include <boost/cstdint.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <saga/saga.hpp>
+
+#include "config.hpp"
+#include "checkpoint_dedup.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+namespace
+{
+  ///////////////////////////////////////////////////////////////////////////////
+  //  self-contained SHA-1 (FIPS 180-1). The chunk store addresses chunks by
+  //  digest, so unlike the per-stripe transfer checksum this one has to be
+  //  collision resistant - a collision would silently splice the wrong bytes
+  //  into a restored checkpoint. Carried here because the boost shipped with
+  //  our target installations predates a reusable SHA-1
+  struct sha1
+  {
+      boost::uint32_t h_[5];
+      boost::uint64_t length_;
+      unsigned char   block_[64];
+      std::size_t     fill_;
+
+      sha1()
+      {
+          h_[0] = 0x67452301; h_[1] = 0xefcdab89; h_[2] = 0x98badcfe;
+          h_[3] = 0x10325476; h_[4] = 0xc3d2e1f0;
+          length_ = 0;
+          fill_ = 0;
+      }
+
+      static boost::uint32_t rol(boost::uint32_t x, int n)
+      {
+          return (x << n) | (x >> (32 - n));
+      }
+
+      void process_block()
+      {
+          boost::uint32_t w[80];
+          for (int i = 0; i < 16; ++i)
+          {
+              w[i] = (boost::uint32_t(block_[i * 4]) << 24)
+                   | (boost::uint32_t(block_[i * 4 + 1]) << 16)
+                   | (boost::uint32_t(block_[i * 4 + 2]) << 8)
+                   |  boost::uint32_t(block_[i * 4 + 3]);
+          }
+          for (int i = 16; i < 80; ++i)
+          {
+              w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+          }
+
+          boost::uint32_t a = h_[0], b = h_[1], c = h_[2],
+                          d = h_[3], e = h_[4];
+          for (int i = 0; i < 80; ++i)
+          {
+              boost::uint32_t f, k;
+              if (i < 20)      { f = (b & c) | (~b & d);           k = 0x5a827999; }
+              else if (i < 40) { f = b ^ c ^ d;                    k = 0x6ed9eba1; }
+              else if (i < 60) { f = (b & c) | (b & d) | (c & d);  k = 0x8f1bbcdc; }
+              else             { f = b ^ c ^ d;                    k = 0xca62c1d6; }
+
+              boost::uint32_t t = rol(a, 5) + f + e + k + w[i];
+              e = d; d = c; c = rol(b, 30); b = a; a = t;
+          }
+          h_[0] += a; h_[1] += b; h_[2] += c; h_[3] += d; h_[4] += e;
+      }
+
+      void update(unsigned char const * data, std::size_t len)
+      {
+          length_ += boost::uint64_t(len) * 8;
+          while (len > 0)
+          {
+              std::size_t take = 64 - fill_;
+              if (take > len) take = len;
+              std::memcpy(block_ + fill_, data, take);
+              fill_ += take;
+              data  += take;
+              len   -= take;
+              if (fill_ == 64)
+              {
+                  process_block();
+                  fill_ = 0;
+              }
+          }
+      }
+
+      std::string hexdigest()
+      {
+          boost::uint64_t len = length_;
+          unsigned char pad = 0x80;
+          update(&pad, 1);
+          unsigned char zero = 0;
+          while (fill_ != 56) update(&zero, 1);
+          unsigned char tail[8];
+          for (int i = 0; i < 8; ++i)
+          {
+              tail[i] = (unsigned char)(len >> (56 - i * 8));
+          }
+          length_ = 0;    //update() must not count the length field itself
+          update(tail, 8);
+
+          static char const hex[] = "0123456789abcdef";
+          std::string out;
+          for (int i = 0; i < 5; ++i)
+          {
+              for (int shift = 28; shift >= 0; shift -= 4)
+              {
+                  out += hex[(h_[i] >> shift) & 0xf];
+              }
+          }
+          return out;
+      }
+  };
+
+  std::string sha1_hex(unsigned char const * data, std::size_t len)
+  {
+      sha1 d;
+      d.update(data, len);
+      return d.hexdigest();
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  //  rolling hash for the cut points: a degree-63 polynomial over a 64 byte
+  //  window. Only the low bits decide where a chunk ends, so identical data
+  //  produces identical chunks regardless of where it sits in the file
+  const std::size_t     ROLL_WINDOW = 64;
+  const boost::uint64_t ROLL_PRIME  = 1099511628211ULL;
+
+  boost::uint64_t roll_prime_pow_window()
+  {
+      boost::uint64_t p = 1;
+      for (std::size_t i = 0; i < ROLL_WINDOW; ++i) p *= ROLL_PRIME;
+      return p;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  //  the in-memory digest index, one per chunk store url, shared by every
+  //  checkpoint of every series replicating into that store
+  boost::mutex index_mtx;
+  std::map<std::string, std::set<std::string> > index_by_store;
+
+  std::set<std::string> & seed_index(saga::url chunk_dir)
+  {
+      boost::mutex::scoped_lock lock(index_mtx);
+      std::string key = chunk_dir.get_url();
+      std::map<std::string, std::set<std::string> >::iterator it =
+          index_by_store.find(key);
+      if (it != index_by_store.end()) return it->second;
+
+      std::set<std::string> & index = index_by_store[key];
+      saga::filesystem::directory dir(chunk_dir,
+                                      saga::filesystem::Create |
+                                      saga::filesystem::CreateParents |
+                                      saga::filesystem::ReadWrite);
+      std::vector<saga::url> entries = dir.list();
+      for (std::size_t i = 0; i < entries.size(); ++i)
+      {
+          std::string path = entries[i].get_path();
+          std::string::size_type pos = path.rfind('/');
+          std::string name =
+              (pos == std::string::npos) ? path : path.substr(pos + 1);
+          //a .part file is an upload that died halfway - not a chunk
+          if (name.size() == 40 && name.find('.') == std::string::npos)
+          {
+              index.insert(name);
+          }
+      }
+      return index;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  std::vector<unsigned char> read_whole_file(saga::url src)
+  {
+      saga::filesystem::file f(src, saga::filesystem::Read);
+      std::size_t size = (std::size_t)f.get_size();
+      std::vector<unsigned char> data(size ? size : 1);
+      std::size_t total = 0;
+      while (total < size)
+      {
+          saga::ssize_t n = f.read(saga::buffer(&data[total], size - total),
+                                   size - total);
+          if (n <= 0)
+          {
+              throw std::runtime_error("checkpoint_dedup: short read");
+          }
+          total += (std::size_t)n;
+      }
+      data.resize(size);
+      return data;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+namespace cpr
+{
+
+  ///////////////////////////////////////////////////////////////////////////////
+  checkpoint_dedup::checkpoint_dedup(saga::url store_base)
+    : store_base_(store_base)
+  {
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  bool checkpoint_dedup::chunk_known(std::string const & digest)
+  {
+      saga::url chunk_dir(store_base_.get_url() + "/chunks");
+      std::set<std::string> & index = seed_index(chunk_dir);
+      boost::mutex::scoped_lock lock(index_mtx);
+      return index.count(digest) != 0;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  //  uploads go to a pid-suffixed temporary and are moved into place, so a
+  //  dying writer never leaves a half chunk under a valid digest name
+  void checkpoint_dedup::upload_chunk(std::string const & digest,
+                                      std::vector<unsigned char> const & data)
+  {
+      saga::url chunk_dir(store_base_.get_url() + "/chunks");
+      std::string tmp_name = digest + "."
+          + boost::lexical_cast<std::string>(::getpid()) + ".part";
+      {
+          saga::filesystem::file f(saga::url(chunk_dir.get_url() + "/" + tmp_name),
+                                   saga::filesystem::ReadWrite |
+                                   saga::filesystem::Create |
+                                   saga::filesystem::CreateParents);
+          f.write(saga::buffer(&data[0], data.size()), data.size());
+      }
+      saga::filesystem::directory dir(chunk_dir, saga::filesystem::ReadWrite);
+      dir.move(saga::url(tmp_name), saga::url(digest),
+               saga::name_space::Overwrite);
+
+      std::set<std::string> & index = seed_index(chunk_dir);
+      boost::mutex::scoped_lock lock(index_mtx);
+      index.insert(digest);
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  saga::url checkpoint_dedup::store(saga::url src,
+                                    std::string const & manifest_name)
+  {
+      std::vector<unsigned char> data = read_whole_file(src);
+
+      std::ostringstream manifest;
+      manifest << "#cpr-dedup-manifest 1\n"
+               << "#size " << data.size() << "\n";
+
+      std::size_t total_chunks = 0, novel_chunks = 0, novel_bytes = 0;
+      const boost::uint64_t pow_window = roll_prime_pow_window();
+
+      std::size_t begin = 0;
+      boost::uint64_t hash = 0;
+      for (std::size_t i = 0; i <= data.size(); ++i)
+      {
+          std::size_t length = i - begin;
+          bool cut = (i == data.size() && length > 0);
+          if (!cut && length >= chunk_min_)
+          {
+              cut = ((hash & chunk_mask_) == chunk_mask_)
+                 || (length >= chunk_max_);
+          }
+
+          if (cut)
+          {
+              std::string digest = sha1_hex(&data[begin], length);
+              manifest << digest << " " << length << "\n";
+              ++total_chunks;
+              if (!chunk_known(digest))
+              {
+                  std::vector<unsigned char> chunk(data.begin() + begin,
+                                                   data.begin() + i);
+                  upload_chunk(digest, chunk);
+                  ++novel_chunks;
+                  novel_bytes += length;
+              }
+              begin = i;
+              hash = 0;
+          }
+
+          if (i < data.size())
+          {
+              hash = hash * ROLL_PRIME + data[i];
+              if (i - begin >= ROLL_WINDOW)
+              {
+                  hash -= pow_window * data[i - ROLL_WINDOW];
+              }
+          }
+      }
+
+      std::string text = manifest.str();
+      saga::url manifest_url(store_base_.get_url() + "/manifests/"
+                             + manifest_name);
+      saga::filesystem::file mf(manifest_url,
+                                saga::filesystem::ReadWrite |
+                                saga::filesystem::Create |
+                                saga::filesystem::CreateParents |
+                                saga::filesystem::Truncate);
+      mf.write(saga::buffer(text.c_str(), text.size()), text.size());
+
+      SAGA_VERBOSE (SAGA_VERBOSE_LEVEL_INFO)
+      {
+          std::cout << "checkpoint_dedup: " << src << " -> " << manifest_url
+                    << " (" << data.size() << " bytes, " << total_chunks
+                    << " chunks, " << novel_chunks << " novel, "
+                    << novel_bytes << " bytes transferred)" << std::endl;
+      }
+
+      return manifest_url;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  void checkpoint_dedup::restore(saga::url manifest, saga::url dst)
+  {
+      std::vector<unsigned char> raw = read_whole_file(manifest);
+      std::istringstream in(std::string(raw.begin(), raw.end()));
+
+      std::string base = manifest.get_url();
+      std::string::size_type pos = base.rfind("/manifests/");
+      if (pos == std::string::npos)
+      {
+          throw std::runtime_error(
+              "checkpoint_dedup: manifest url outside a chunk store: "
+              + base);
+      }
+      std::string chunk_base = base.substr(0, pos) + "/chunks/";
+
+      saga::filesystem::file out(dst, saga::filesystem::ReadWrite |
+                                      saga::filesystem::Create |
+                                      saga::filesystem::Truncate);
+
+      std::string line;
+      while (std::getline(in, line))
+      {
+          if (line.empty() || line[0] == '#') continue;
+
+          std::istringstream fields(line);
+          std::string digest;
+          std::size_t length = 0;
+          if (!(fields >> digest >> length) || digest.size() != 40)
+          {
+              throw std::runtime_error(
+                  "checkpoint_dedup: malformed manifest line: " + line);
+          }
+
+          std::vector<unsigned char> chunk =
+              read_whole_file(saga::url(chunk_base + digest));
+          if (chunk.size() != length
+              || sha1_hex(&chunk[0], chunk.size()) != digest)
+          {
+              throw std::runtime_error(
+                  "checkpoint_dedup: chunk " + digest
+                  + " fails verification - store is damaged");
+          }
+          out.write(saga::buffer(&chunk[0], chunk.size()), chunk.size());
+      }
+  }
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace cpr
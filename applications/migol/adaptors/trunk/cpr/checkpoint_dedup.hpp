@@ -0,0 +1,68 @@
+//  Copyright (c) 2005-2008 Hartmut Kaiser
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef ADAPTORS_MIGOL_CPR_CHECKPOINT_DEDUP_HPP
+#define ADAPTORS_MIGOL_CPR_CHECKPOINT_DEDUP_HPP
+
+#include <string>
+#include <vector>
+
+#include <saga/saga.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+namespace cpr
+{
+    ///////////////////////////////////////////////////////////////////////////
+    //  Deduplicated checkpoint replication.
+    //
+    //  Successive checkpoints of an iterative solver are mostly identical,
+    //  so copying each one in full wastes both transfer volume and registry
+    //  entries. Instead the checkpoint is cut into content-defined chunks
+    //  (a rolling hash picks the cut points, so an insertion early in the
+    //  file only perturbs the chunks around it, not everything after it),
+    //  each chunk is named by its SHA-1 digest and uploaded into a shared
+    //  chunk store only if no chunk of that digest is there already. What
+    //  gets registered per checkpoint is a small manifest listing the
+    //  digests in order; restore() reassembles the original bytes from it.
+    //
+    //  Store layout under the configured base url:
+    //
+    //      <base>/chunks/<digest>          one file per unique chunk
+    //      <base>/manifests/<name>         one manifest per checkpoint
+    //
+    //  A digest index of the chunks already in the store is kept in memory
+    //  per store url, seeded from a directory listing on first use, so the
+    //  steady-state cost of an unchanged chunk is one index lookup - no
+    //  remote round trip at all.
+    class checkpoint_dedup
+    {
+    public:
+        explicit checkpoint_dedup(saga::url store_base);
+
+        //chunks src, uploads the novel chunks and writes the manifest
+        //named manifest_name; returns the manifest url. Throws
+        //std::runtime_error on failure.
+        saga::url store(saga::url src, std::string const & manifest_name);
+
+        //reassembles the checkpoint described by the manifest into dst,
+        //verifying each chunk's digest on the way
+        static void restore(saga::url manifest, saga::url dst);
+
+    private:
+        saga::url store_base_;
+
+        //average/minimum/maximum chunk size; the rolling hash fires a
+        //cut point once per 2^20 bytes on average
+        static const std::size_t chunk_mask_ = (1u << 20) - 1;
+        static const std::size_t chunk_min_  = 256 * 1024;
+        static const std::size_t chunk_max_  = 4 * 1024 * 1024;
+
+        bool chunk_known(std::string const & digest);
+        void upload_chunk(std::string const & digest,
+                          std::vector<unsigned char> const & data);
+    };
+}
+
+#endif // ADAPTORS_MIGOL_CPR_CHECKPOINT_DEDUP_HPP
@@ -0,0 +1,176 @@
+//  Copyright (c) 2005-2008 Hartmut Kaiser
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <saga/saga.hpp>
+
+#include "config.hpp"
+#include "checkpoint_transfer.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+namespace cpr
+{
+
+  ///////////////////////////////////////////////////////////////////////////////
+  //  constructor
+  checkpoint_transfer::checkpoint_transfer(int num_streams,
+                                           saga::off_t stripe_size)
+    : num_streams_(num_streams),
+      stripe_size_(stripe_size),
+      next_stripe_(0),
+      num_stripes_(0)
+  {
+      if (num_streams_ < 1) num_streams_ = 1;
+      if (stripe_size_ < 1) stripe_size_ = 1;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  //  adler-32 style rolling checksum - cheap enough to run at stream speed
+  //  and sufficient to catch a corrupted or short stripe
+  unsigned long checkpoint_transfer::checksum(unsigned char const * data,
+                                              std::size_t length)
+  {
+      unsigned long a = 1, b = 0;
+      for (std::size_t i = 0; i < length; ++i)
+      {
+          a = (a + data[i]) % 65521;
+          b = (b + a) % 65521;
+      }
+      return (b << 16) | a;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  bool checkpoint_transfer::transfer_stripe(saga::filesystem::file & fsrc,
+                                            saga::filesystem::file & fdst,
+                                            saga::off_t offset,
+                                            saga::off_t length)
+  {
+      std::size_t len = (std::size_t)length;
+      boost::scoped_array<unsigned char> data(new unsigned char[len]);
+
+      fsrc.seek(offset, saga::filesystem::Start);
+      std::size_t total = 0;
+      while (total < len)
+      {
+          saga::ssize_t n = fsrc.read(saga::buffer(data.get() + total,
+                                                   len - total),
+                                      len - total);
+          if (n <= 0) return false;    //short source read
+          total += (std::size_t)n;
+      }
+
+      unsigned long src_sum = checksum(data.get(), len);
+
+      fdst.seek(offset, saga::filesystem::Start);
+      fdst.write(saga::buffer(data.get(), len), len);
+
+      //verify: read the stripe back from the destination and compare
+      //checksums. This costs a second pass over the stripe, but it is the
+      //only end-to-end check available without server-side checksumming
+      fdst.seek(offset, saga::filesystem::Start);
+      total = 0;
+      while (total < len)
+      {
+          saga::ssize_t n = fdst.read(saga::buffer(data.get() + total,
+                                                   len - total),
+                                      len - total);
+          if (n <= 0) return false;
+          total += (std::size_t)n;
+      }
+
+      return checksum(data.get(), len) == src_sum;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  //  one worker: own file handles (own transport streams), pulls stripe
+  //  indices off the shared counter until the file is exhausted
+  void checkpoint_transfer::worker(saga::url src, saga::url dst,
+                                   saga::off_t size)
+  {
+      try
+      {
+          saga::filesystem::file fsrc(src, saga::filesystem::Read);
+          saga::filesystem::file fdst(dst, saga::filesystem::ReadWrite |
+                                           saga::filesystem::Create);
+          while (true)
+          {
+              saga::off_t stripe;
+              {
+                  boost::mutex::scoped_lock lock(mtx_);
+                  if (error_ != "" || next_stripe_ >= num_stripes_) return;
+                  stripe = next_stripe_++;
+              }
+
+              saga::off_t offset = stripe * stripe_size_;
+              saga::off_t length = stripe_size_;
+              if (offset + length > size) length = size - offset;
+
+              //one retransmit per stripe before giving up
+              if (!transfer_stripe(fsrc, fdst, offset, length) &&
+                  !transfer_stripe(fsrc, fdst, offset, length))
+              {
+                  boost::mutex::scoped_lock lock(mtx_);
+                  error_ = "checksum mismatch on stripe "
+                         + boost::lexical_cast<std::string>(stripe);
+                  return;
+              }
+          }
+      }
+      catch (saga::exception const & e)
+      {
+          boost::mutex::scoped_lock lock(mtx_);
+          if (error_ == "") error_ = e.what();
+      }
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  void checkpoint_transfer::copy(saga::url src, saga::url dst)
+  {
+      saga::off_t size = 0;
+      {
+          saga::filesystem::file fsrc(src, saga::filesystem::Read);
+          size = fsrc.get_size();
+      }
+
+      next_stripe_ = 0;
+      num_stripes_ = (size + stripe_size_ - 1) / stripe_size_;
+      error_ = "";
+
+      int streams = num_streams_;
+      if (num_stripes_ < (saga::off_t)streams) streams = (int)num_stripes_;
+
+      SAGA_VERBOSE (SAGA_VERBOSE_LEVEL_INFO)
+      {
+          std::cout << "checkpoint_transfer: " << src << " -> " << dst
+                    << " (" << size << " bytes, " << num_stripes_
+                    << " stripes, " << streams << " streams)" << std::endl;
+      }
+
+      std::vector<boost::thread *> threads;
+      for (int i = 0; i < streams; ++i)
+      {
+          threads.push_back(new boost::thread(
+              TR1::bind(&checkpoint_transfer::worker, this, src, dst, size)));
+      }
+      for (std::size_t i = 0; i < threads.size(); ++i)
+      {
+          threads[i]->join();
+          delete threads[i];
+      }
+
+      if (error_ != "")
+      {
+          throw std::runtime_error("checkpoint_transfer: " + error_);
+      }
+  }
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace cpr
@@ -0,0 +1,58 @@
+//  Copyright (c) 2005-2008 Hartmut Kaiser
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef ADAPTORS_MIGOL_CPR_CHECKPOINT_TRANSFER_HPP
+#define ADAPTORS_MIGOL_CPR_CHECKPOINT_TRANSFER_HPP
+
+#include <string>
+#include <vector>
+
+#include <saga/saga.hpp>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+///////////////////////////////////////////////////////////////////////////////
+namespace cpr
+{
+    ///////////////////////////////////////////////////////////////////////////
+    //  Striped parallel file transfer for checkpoint replication.
+    //
+    //  The file is cut into fixed-size stripes; num_streams worker threads
+    //  each open their own source/destination file handles (and thus their
+    //  own transport streams) and pull stripes off a shared counter, so a
+    //  large checkpoint moves over several concurrent streams instead of
+    //  being bounded by one TCP window. Every stripe is checksummed as it
+    //  is read and verified by reading it back from the destination; a
+    //  mismatched stripe is retransmitted once before the transfer fails.
+    class checkpoint_transfer
+    {
+    public:
+        checkpoint_transfer(int num_streams, saga::off_t stripe_size);
+
+        //copies src to dst; throws std::runtime_error on failure
+        void copy(saga::url src, saga::url dst);
+
+    private:
+        int num_streams_;
+        saga::off_t stripe_size_;
+
+        //shared between the worker threads
+        saga::off_t next_stripe_;
+        saga::off_t num_stripes_;
+        boost::mutex mtx_;
+        std::string error_;
+
+        void worker(saga::url src, saga::url dst, saga::off_t size);
+        bool transfer_stripe(saga::filesystem::file & fsrc,
+                             saga::filesystem::file & fdst,
+                             saga::off_t offset, saga::off_t length);
+
+        static unsigned long checksum(unsigned char const * data,
+                                      std::size_t length);
+    };
+}
+
+#endif // ADAPTORS_MIGOL_CPR_CHECKPOINT_TRANSFER_HPP
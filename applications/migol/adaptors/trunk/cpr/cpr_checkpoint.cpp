@@ -5,8 +5,10 @@
 
 #include <map>
 #include <vector>
+#include <ctime>
 
 #include <boost/assert.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/tokenizer.hpp>
 
 #include <saga/saga.hpp>
@@ -18,6 +20,8 @@
 
 #include "config.hpp"
 #include "cpr_checkpoint.hpp"
+#include "checkpoint_transfer.hpp"
+#include "checkpoint_dedup.hpp"
 
 ///////////////////////////////////////////////////////////////////////////////
 namespace cpr
@@ -302,17 +306,59 @@ namespace cpr
           SAGA_ADAPTOR_THROW(SAGA_OSSTREAM_GETSTRING(strm), saga::BadParameter);
       }
       
-      bool result = false;
+      // registration is asynchronous: the call returns once the request
+      // is queued, and the migol background thread drains it to the AIS
+      // with retry/backoff - the application's checkpoint path no longer
+      // stalls on the registry round trip
+      migol::instance()->register_checkpoint_async(guid, url.get_url());
+
+      // optional adaptor-side replication: if a replica store is
+      // configured, ship the checkpoint there and register the replica
+      // as well. With replica_dedup set the checkpoint is chunked and
+      // only novel chunks travel - successive checkpoints of an
+      // iterative solver are mostly identical, so this cuts transfer
+      // volume by an order of magnitude - and what gets registered is
+      // the manifest url; otherwise the full file moves over striped
+      // parallel streams as before
+      std::string replica_location = migol::instance()->get_replica_location();
+      if (replica_location != "")
       {
-          result =  migol::instance()->register_checkpoint(guid, url.get_url());
-      }
-      
-      if (!result)
-      { 
-          SAGA_OSSTREAM strm;
-          strm << "cpr::migol_cpr_checkpoint_cpi_impl::add_file: "
-          "cannot handle checkpoint name: " << url.get_url();
-          SAGA_ADAPTOR_THROW(SAGA_OSSTREAM_GETSTRING(strm), saga::BadParameter);
+          try {
+              std::string path (url.get_path());
+              std::string::size_type pos = path.rfind('/');
+              std::string basename =
+                  (pos == std::string::npos) ? path : path.substr(pos + 1);
+
+              if (migol::instance()->get_replica_dedup() != 0)
+              {
+                  checkpoint_dedup dedup ((saga::url(replica_location)));
+                  std::string manifest_name = guid + "." + basename + "."
+                      + boost::lexical_cast<std::string>(::time(NULL))
+                      + ".manifest";
+                  saga::url manifest_url = dedup.store (url, manifest_name);
+
+                  migol::instance()->register_checkpoint_async(guid,
+                                                               manifest_url.get_url());
+              }
+              else
+              {
+                  saga::url replica_url (replica_location + "/" + basename);
+
+                  checkpoint_transfer xfer (
+                      migol::instance()->get_replica_streams(),
+                      migol::instance()->get_replica_stripe_size());
+                  xfer.copy (url, replica_url);
+
+                  migol::instance()->register_checkpoint_async(guid,
+                                                               replica_url.get_url());
+              }
+          }
+          catch (std::exception const & e) {
+              SAGA_OSSTREAM strm;
+              strm << "cpr::migol_cpr_checkpoint_cpi_impl::add_file: "
+              "could not replicate checkpoint " << url << ": " << e.what();
+              SAGA_ADAPTOR_THROW(SAGA_OSSTREAM_GETSTRING(strm), saga::NoSuccess);
+          }
       }
   }
     
@@ -30,6 +30,7 @@ extern "C" {
 #include <boost/algorithm/string.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <sstream>
+#include <vector>
 
 //#include <saga/types.hpp>
 //#include <saga/exception.hpp>
@@ -51,6 +52,38 @@ extern "C" {
 
 #define MAX_CLASSPATH 20000
 
+//attempts per queued checkpoint registration before it is dropped
+#define MAX_REGISTRATION_RETRIES 5
+
+//seconds for which a bulk job state snapshot answers single-job lookups
+#define JOB_STATE_SNAPSHOT_TTL 5
+
+//serve loop with a compact fast path for the high-frequency monitoring
+//calls (defined after the gSOAP handlers at the bottom of this file)
+static int monitor_serve_fast (struct soap *soap);
+
+//retained deserialization arena, one per serving context (the helpers
+//are defined next to the serve loop); installed as the context's
+//fmalloc hook, with the context's arena hanging off soap->user
+namespace {
+    struct monitor_arena_t {
+        char  *base;
+        size_t size;
+        size_t used;
+        size_t cycle;              //bytes requested since last reset
+        std::vector<void*> overflow;
+        monitor_arena_t() : base(NULL), size(0), used(0), cycle(0) {}
+    };
+}
+static void *monitor_arena_malloc (struct soap *soap, size_t n);
+static void monitor_arena_reset (struct soap *soap);
+static void monitor_arena_release (struct soap *soap);
+
+//bounded request queue of the threaded monitorable server: connections
+//beyond this are dropped at accept (the monitoring service retries its
+//poll), and one client ip may hold at most half the slots
+static const int MONITOR_QUEUE_MAX = 128;
+
 namespace cpr {
 
     //singleton instance
@@ -64,8 +97,15 @@ namespace cpr {
     ais_global_cls(NULL),
     terminate(false),
     initialized(false),
+    monitor_threads_(4),
     external_monitoring_host("") ,
-    monitorable_thread(TR1::bind(&migol::monitorable_server, this))
+    replica_location(""),
+    replica_streams(4),
+    replica_stripe_size(16*1024*1024),
+    replica_dedup(0),
+    job_state_snapshot_time_(0),
+    monitorable_thread(TR1::bind(&migol::monitorable_server, this)),
+    registration_thread_(NULL)
     {
         SAGA_VERBOSE (SAGA_VERBOSE_LEVEL_INFO)
         {
@@ -86,6 +126,15 @@ namespace cpr {
             ais_url = prefs.has_entry("ais_url") ? prefs.get_entry("ais_url") : "";
             globus_location = prefs.has_entry("globus_location") ? prefs.get_entry("globus_location") : "";
             external_monitoring_host =(prefs.has_entry("external_monitoring_host") ? prefs.get_entry("external_monitoring_host") : "");
+            replica_location = (prefs.has_entry("replica_location") ? prefs.get_entry("replica_location") : "");
+            if (prefs.has_entry("replica_streams"))
+                replica_streams = boost::lexical_cast<int>(prefs.get_entry("replica_streams"));
+            if (prefs.has_entry("replica_stripe_size"))
+                replica_stripe_size = boost::lexical_cast<long>(prefs.get_entry("replica_stripe_size"));
+            if (prefs.has_entry("replica_dedup"))
+                replica_dedup = boost::lexical_cast<int>(prefs.get_entry("replica_dedup"));
+            if (prefs.has_entry("monitor_threads"))
+                monitor_threads_ = boost::lexical_cast<int>(prefs.get_entry("monitor_threads"));
             // boost::trim(external_monitoring_host);
             //        boost::trim(ais_url);
             //        boost::trim(globus_location);
@@ -110,8 +159,15 @@ namespace cpr {
     ais_global_cls(NULL),
     terminate(false),
     initialized(false),
+    monitor_threads_(4),
     external_monitoring_host(""),
-    monitorable_thread(TR1::bind(&migol::monitorable_server, this))
+    replica_location(""),
+    replica_streams(4),
+    replica_stripe_size(16*1024*1024),
+    replica_dedup(0),
+    job_state_snapshot_time_(0),
+    monitorable_thread(TR1::bind(&migol::monitorable_server, this)),
+    registration_thread_(NULL)
 {
     SAGA_LOG_INFO("Migol Constructor");
     while(initialized==false){
@@ -124,6 +180,15 @@ namespace cpr {
         ais_url = prefs.has_entry("ais_url") ? prefs.get_entry("ais_url") : "";
         globus_location = prefs.has_entry("globus_location") ? prefs.get_entry("globus_location") : "";
         external_monitoring_host =(prefs.has_entry("external_monitoring_host") ? prefs.get_entry("external_monitoring_host") : "");
+        replica_location = (prefs.has_entry("replica_location") ? prefs.get_entry("replica_location") : "");
+        if (prefs.has_entry("replica_streams"))
+            replica_streams = boost::lexical_cast<int>(prefs.get_entry("replica_streams"));
+        if (prefs.has_entry("replica_stripe_size"))
+            replica_stripe_size = boost::lexical_cast<long>(prefs.get_entry("replica_stripe_size"));
+        if (prefs.has_entry("replica_dedup"))
+            replica_dedup = boost::lexical_cast<int>(prefs.get_entry("replica_dedup"));
+        if (prefs.has_entry("monitor_threads"))
+            monitor_threads_ = boost::lexical_cast<int>(prefs.get_entry("monitor_threads"));
         SAGA_VERBOSE (SAGA_VERBOSE_LEVEL_INFO)
         {
             std::cout<<"AIS URL: " << ais_url <<std::endl;
@@ -140,7 +205,16 @@ namespace cpr {
 /** Destructor **/
 migol::~migol(){
     SAGA_LOG_INFO("D'tor ~migol begin: Terminate Migol ...");
-    terminate=true;
+    {//set under the registration lock so the worker cannot miss the wakeup
+        boost::mutex::scoped_lock lock(registration_mtx_);
+        terminate=true;
+        registration_cond_.notify_all();
+    }
+    if (registration_thread_ != NULL) {
+        SAGA_LOG_BLURB("Wait for registration thread ...");
+        registration_thread_->join();
+        delete registration_thread_;
+    }
     //destroyJVM();
     SAGA_LOG_BLURB("Wait for monitorable thread ...");
     monitorable_thread.join();    
@@ -265,8 +339,12 @@ void migol::monitorable_server(){
     }    
     //scoped_lock lk(mutex);
     int m, s;      // master and slave sockets
-    // init soap environment
-    struct soap *soap = soap_new();
+    // init soap environment with HTTP keep-alive: the monitoring service
+    // polls this endpoint periodically, and without keep-alive every poll
+    // pays a full TCP connect/teardown. With keep-alive monitor_serve()
+    // keeps serving requests on one accepted connection until the peer
+    // closes it or max_keep_alive is reached.
+    struct soap *soap = soap_new2(SOAP_IO_KEEPALIVE, SOAP_IO_KEEPALIVE);
     soap_set_namespaces (soap, monitor_namespaces);
     do
     {
@@ -290,8 +368,20 @@ void migol::monitorable_server(){
     initialized=true;
     //lk.unlock();
     //cond.notify_all();
-    //casoap->accept_timeout = 1000 mSec; 
+    //casoap->accept_timeout = 1000 mSec;
     soap->accept_timeout = 1;
+    // bound a kept-alive connection so a stalled client cannot wedge the
+    // single-threaded serve loop: cap requests per connection and drop
+    // connections that stay idle
+    soap->max_keep_alive = 100;
+    soap->recv_timeout = 30;
+    soap->send_timeout = 30;
+    // every soap_malloc of the deserializers comes out of a retained
+    // arena instead of the heap; the arena is rewound after each request.
+    // This one backs the serial mode only - pool workers bring their own
+    monitor_arena_t serial_arena;
+    soap->fmalloc = monitor_arena_malloc;
+    soap->user    = &serial_arena;
     while (!terminate)
     {
         s = soap_accept (soap);
@@ -299,25 +389,93 @@ void migol::monitorable_server(){
         {
             //soap_print_fault (soap, stderr);
             continue;
-        }   
+        }
         SAGA_VERBOSE (SAGA_VERBOSE_LEVEL_INFO)
         {
-            std::cout<< "Connection from: " << ((soap->ip >> 24) & 0xFF) << "." 
+            std::cout<< "Connection from: " << ((soap->ip >> 24) & 0xFF) << "."
             << ((soap->ip >> 16) & 0xFF) <<"."<< ((soap->ip >> 8) & 0xFF)
             <<"." <<  ((soap->ip) & 0xFF) <<std::endl;
         }
-        monitor_serve (soap);  // process RPC request
+        // threaded mode (monitor_threads preference, default 4): only
+        // accept here, then hand the connection to a fixed worker pool,
+        // so a burst of monitoring calls from a large job's ranks is
+        // parsed and answered in parallel instead of serializing on
+        // this one soap context.  The queue is bounded - beyond
+        // MONITOR_QUEUE_MAX the connection is dropped and the monitor
+        // retries its poll - and one client ip may hold at most half
+        // the slots, so a single chatty job cannot crowd out the rest.
+        // monitor_threads = 0 restores the serial in-loop serve.
+        if (monitor_threads_ > 0)
+        {
+            // lazy pool start: by the time the first monitoring
+            // connection arrives, the preferences have been parsed
+            if (monitor_pool_.empty ())
+            {
+                for (int i = 0; i < monitor_threads_; i++)
+                {
+                    monitor_pool_.push_back (new boost::thread (
+                        TR1::bind (&migol::monitor_worker, this)));
+                }
+            }
+            struct soap *tsoap = soap_copy (soap);
+            if (tsoap == NULL)
+            {
+                soap_closesock (soap);
+                continue;
+            }
+            // the copy inherited the serial arena; the serving worker
+            // installs its own before anything is deserialized
+            tsoap->user = NULL;
+            boost::mutex::scoped_lock lock (monitor_mtx_);
+            std::map<unsigned long, int>::iterator cl =
+                monitor_inflight_.find (tsoap->ip);
+            int inflight = (cl != monitor_inflight_.end ()) ? cl->second : 0;
+            if ((int) monitor_queue_.size () >= MONITOR_QUEUE_MAX
+                || inflight >= MONITOR_QUEUE_MAX / 2)
+            {
+                // shed load while the request is still cheap: nothing
+                // has been read from the socket yet
+                lock.unlock ();
+                tsoap->keep_alive = 0;
+                soap_free (tsoap);
+                continue;
+            }
+            monitor_inflight_[tsoap->ip] = inflight + 1;
+            monitor_queue_.push_back (tsoap);
+            monitor_cond_.notify_one ();
+            continue;
+        }
+        monitor_serve_fast (soap);  // process RPC request
         SAGA_VERBOSE (SAGA_VERBOSE_LEVEL_INFO)
         {
             std::cout<< "Request served\n";
         }
         soap_end (soap);  // clean up everything and close socket
-    }  
+        monitor_arena_reset (soap);
+    }
+    // wind down the pool: wake everyone, join, and free what was still
+    // queued but never served
+    {
+        boost::mutex::scoped_lock lock (monitor_mtx_);
+        monitor_cond_.notify_all ();
+    }
+    for (size_t i = 0; i < monitor_pool_.size (); i++)
+    {
+        monitor_pool_[i]->join ();
+        delete monitor_pool_[i];
+    }
+    monitor_pool_.clear ();
+    while (!monitor_queue_.empty ())
+    {
+        soap_free (monitor_queue_.front ());
+        monitor_queue_.pop_front ();
+    }
     SAGA_VERBOSE (SAGA_VERBOSE_LEVEL_INFO)
     {
         std::cout<<"call soap done" <<std::endl;
     }
     soap_done (soap);
+    monitor_arena_release (soap);
     SAGA_VERBOSE (SAGA_VERBOSE_LEVEL_INFO)
     {
         std::cout<<"call soap free" <<std::endl;
@@ -504,6 +662,69 @@ bool
         return false;
 }
 
+/******************************************************************************/
+void
+    migol::register_checkpoint_async(std::string guid, std::string fileName){
+        boost::mutex::scoped_lock lock(registration_mtx_);
+        //lazy start of the drain thread on the first registration
+        if (registration_thread_ == NULL) {
+            registration_thread_ = new boost::thread(
+                TR1::bind(&migol::registration_worker, this));
+        }
+        registration_request req;
+        req.guid = guid;
+        req.file_name = fileName;
+        req.attempts = 0;
+        registration_queue_.push_back(req);
+        SAGA_VERBOSE (SAGA_VERBOSE_LEVEL_INFO)
+        {
+            std::cout<<"queued checkpoint registration: " << guid
+                     << " file: " << fileName <<std::endl;
+        }
+        registration_cond_.notify_one();
+}
+
+/******************************************************************************/
+/** drains queued checkpoint registrations to the AIS. A failed
+    registration is retried with exponential backoff (2, 4, ... seconds)
+    up to MAX_REGISTRATION_RETRIES attempts; on shutdown the remaining
+    queue is flushed with one attempt per entry **/
+void
+    migol::registration_worker(){
+        boost::mutex::scoped_lock lock(registration_mtx_);
+        while (true) {
+            while (registration_queue_.empty() && !terminate) {
+                registration_cond_.wait(lock);
+            }
+            if (registration_queue_.empty()) {
+                break;    //terminated and nothing left to flush
+            }
+            registration_request req = registration_queue_.front();
+            registration_queue_.pop_front();
+
+            lock.unlock();
+            bool result = register_checkpoint(req.guid, req.file_name);
+            lock.lock();
+
+            if (!result) {
+                req.attempts++;
+                if (req.attempts >= MAX_REGISTRATION_RETRIES || terminate) {
+                    std::cerr<< "Error registering checkpoint " << req.file_name
+                             << " after " << req.attempts
+                             << " attempts - giving up" <<std::endl;
+                } else {
+                    //backoff before the retry; new registrations or
+                    //shutdown cut the wait short
+                    boost::xtime xt;
+                    boost::xtime_get(&xt, boost::TIME_UTC);
+                    xt.sec += (1 << req.attempts);
+                    registration_cond_.timed_wait(lock, xt);
+                    registration_queue_.push_back(req);
+                }
+            }
+        }
+}
+
 /******************************************************************************/
 bool migol::change_service_state(std::string guid, std::string newState) {
     jmethodID mid;
@@ -992,8 +1213,21 @@ bool migol::submit_job(std::string guid,
     
 /******************************************************************************/
     /** get job state from GRAM2/AIS **/
-    std::string migol::get_job_state(std::string guid){        
+    std::string migol::get_job_state(std::string guid){
         std::string state;
+        {   //terminal states are immutable, and a fresh bulk snapshot
+            //can answer without a registry round-trip
+            boost::mutex::scoped_lock lock(job_state_mtx_);
+            std::map<std::string, std::string>::const_iterator hit =
+                job_state_cache_.find(guid);
+            if (hit != job_state_cache_.end())
+                return hit->second;
+            if (time(NULL) - job_state_snapshot_time_ <= JOB_STATE_SNAPSHOT_TTL) {
+                hit = job_state_snapshot_.find(guid);
+                if (hit != job_state_snapshot_.end())
+                    return hit->second;
+            }
+        }
         jstring jais_url, jguid, jstate;
         jclass gram2client;
         jmethodID jmid;
@@ -1015,7 +1249,8 @@ bool migol::submit_job(std::string guid,
                     }
                     env->ReleaseStringUTFChars(jstate, NULL);
                     env->ReleaseStringUTFChars(jguid, NULL);
-                    env->ReleaseStringUTFChars(jais_url, NULL);  
+                    env->ReleaseStringUTFChars(jais_url, NULL);
+                    cache_job_state(guid, state);
                     return state;
                 } else {
                     printFault(env, "Error finding GRAM2JniClient\n");
@@ -1033,6 +1268,105 @@ bool migol::submit_job(std::string guid,
         return NULL;    
     }
     
+/******************************************************************************/
+    /** remember terminal (immutable) job states so later lookups stay
+        local **/
+    void migol::cache_job_state(std::string guid, std::string state){
+        if (state == "done") {
+            boost::mutex::scoped_lock lock(job_state_mtx_);
+            job_state_cache_[guid] = state;
+        }
+    }
+
+/******************************************************************************/
+    /** get states for many jobs from GRAM2/AIS in one registry call.
+        Gang-restarted applications reconcile hundreds of jobs at
+        reconnect; querying them one by one costs one registry
+        round-trip each. States already known to be terminal are served
+        from the cache, the rest are resolved with a single bulk call,
+        and the result is kept as a short-lived snapshot so the per-job
+        get_job_state() calls that follow stay local. A registry client
+        without the bulk method falls back to one query per job **/
+    std::map<std::string, std::string> migol::get_job_states(std::vector<std::string> guids){
+        std::map<std::string, std::string> states;
+        std::vector<std::string> missing;
+        {   //serve what the terminal-state cache already knows
+            boost::mutex::scoped_lock lock(job_state_mtx_);
+            for (unsigned int i = 0; i < guids.size(); i++) {
+                std::map<std::string, std::string>::const_iterator hit =
+                    job_state_cache_.find(guids[i]);
+                if (hit != job_state_cache_.end())
+                    states[guids[i]] = hit->second;
+                else
+                    missing.push_back(guids[i]);
+            }
+        }
+        if (missing.empty())
+            return states;
+
+        jclass gram2client;
+        jmethodID jmid;
+        JNIEnv *env;
+        env = initJVM();
+        if (jvm != NULL)   {
+            gram2client = env->FindClass("org/globus/ogsa/migol/GRAM2JniClient");
+            if(gram2client !=0)    {
+                jmid = env->GetStaticMethodID(gram2client, "getStates",
+                                              "(Ljava/lang/String;[Ljava/lang/String;)[Ljava/lang/String;");
+                if(jmid != 0)   {
+                    jstring jais_url;
+                    init_jstring(env, ais_url, jais_url);
+                    jobjectArray jguids = env->NewObjectArray((jsize) missing.size(),
+                                              env->FindClass("java/lang/String"), NULL);
+                    for (unsigned int i = 0; i < missing.size(); i++) {
+                        env->SetObjectArrayElement(jguids, (jsize) i,
+                                                   env->NewStringUTF(missing[i].c_str()));
+                    }
+                    //call java method - states come back in request order
+                    jobjectArray jstates = (jobjectArray)
+                        env->CallStaticObjectMethod(gram2client, jmid, jais_url, jguids);
+                    if(jstates != NULL){
+                        jint len = env->GetArrayLength(jstates);
+                        for (int i = 0; i < len && i < (int) missing.size(); i++) {
+                            jstring jstate = (jstring) env->GetObjectArrayElement(jstates, i);
+                            if (jstate == NULL)
+                                continue;
+                            std::string state((env->GetStringUTFChars(jstate, NULL)));
+                            states[missing[i]] = state;
+                            cache_job_state(missing[i], state);
+                            env->ReleaseStringUTFChars(jstate, NULL);
+                        }
+                    }
+                    env->ReleaseStringUTFChars(jais_url, NULL);
+                } else {
+                    //deployed registry client has no bulk call - resolve
+                    //the old way, one query per job
+                    env->ExceptionClear();
+                    SAGA_VERBOSE (SAGA_VERBOSE_LEVEL_WARNING)
+                    {
+                        std::cout<< "No bulk getStates in GRAM2JniClient - "
+                                 << "falling back to per-job queries" <<std::endl;
+                    }
+                    for (unsigned int i = 0; i < missing.size(); i++) {
+                        states[missing[i]] = get_job_state(missing[i]);
+                    }
+                }
+            } else {
+                printFault(env, "Error finding GRAM2JniClient\n");
+            }
+        }
+        else {
+            printFault(env, "Error creating JVM\n");
+        }
+
+        {   //publish the snapshot for the per-job lookups that follow
+            boost::mutex::scoped_lock lock(job_state_mtx_);
+            job_state_snapshot_ = states;
+            job_state_snapshot_time_ = time(NULL);
+        }
+        return states;
+    }
+
 /******************************************************************************/
 
     void migol::init_jstring(JNIEnv *env, std::string input_string, jstring &output_string){
@@ -1352,6 +1686,25 @@ migol::get_ip ()
     return ipString;
 }
 
+/*
+ * striped replication preferences (see migol_cpr_adaptor.ini)
+ */
+std::string migol::get_replica_location() {
+    return replica_location;
+}
+
+int migol::get_replica_streams() {
+    return replica_streams;
+}
+
+long migol::get_replica_stripe_size() {
+    return replica_stripe_size;
+}
+
+int migol::get_replica_dedup() {
+    return replica_dedup;
+}
+
 /*
  * builds URL from PORT and local ip address
  */
@@ -1453,3 +1806,258 @@ int __migol__Destroy(struct soap*, _lifetime__Destroy *lifetime__Destroy, _lifet
     return SOAP_OK;
 }
 
+/** Compact fast path for the high-frequency monitoring calls.
+
+    checkService (heartbeat) and checkPoint arrive once per second per
+    rank, and the generated monitor_serve_request() answers each of them
+    through the full gSOAP machinery: a counting pass plus an
+    element-by-element serialization pass, for what is a constant
+    one-boolean reply. The helpers below build both reply envelopes once
+    - the boolean is the only value that ever changes - and push the
+    chosen one out with a single raw send from the prebuilt buffer.
+    The request is still parsed by the generated deserializers, and any
+    other call is handed back to monitor_serve_request(), so the
+    WSDL-facing slow path is untouched. **/
+
+static std::string build_monitor_response (const char *tag, const char *value)
+{
+    //same envelope the generated serializer would emit, with the
+    //namespace list taken from monitor.nsmap so both stay in sync
+    std::string xml ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+                     "<SOAP-ENV:Envelope");
+    for (const struct Namespace *ns = monitor_namespaces; ns->id != NULL; ns++) {
+        xml.append(" xmlns:");
+        xml.append(ns->id);
+        xml.append("=\"");
+        xml.append(ns->ns);
+        xml.append("\"");
+    }
+    xml.append("><SOAP-ENV:Body><");
+    xml.append(tag);
+    xml.append(">");
+    xml.append(value);
+    xml.append("</");
+    xml.append(tag);
+    xml.append("></SOAP-ENV:Body></SOAP-ENV:Envelope>");
+    return xml;
+}
+
+static int send_prebuilt_response (struct soap *soap, const std::string &body)
+{
+    //soap_response() picks the content length up from soap->count, so no
+    //counting pass is needed
+    soap->count = body.length();
+    if (soap_response (soap, SOAP_OK)
+     || soap_send_raw (soap, body.data(), body.length())
+     || soap_end_send (soap))
+        return soap->error;
+    return soap_closesock (soap);
+}
+
+static int serve_checkService_fast (struct soap *soap)
+{
+    struct __migol__checkService request;
+    soap_default___migol__checkService (soap, &request);
+    soap->encodingStyle = NULL;
+    if (!soap_get___migol__checkService (soap, &request, "-migol:checkService", NULL))
+        return soap->error;
+    if (soap_body_end_in (soap)
+     || soap_envelope_end_in (soap)
+     || soap_end_recv (soap))
+        return soap->error;
+    bool response = false;
+    soap->error = __migol__checkService (soap, request.migoldef__checkService, response);
+    if (soap->error)
+        return soap->error;
+    static const std::string reply_true  = build_monitor_response ("migoldef:checkServiceResponse", "true");
+    static const std::string reply_false = build_monitor_response ("migoldef:checkServiceResponse", "false");
+    return send_prebuilt_response (soap, response ? reply_true : reply_false);
+}
+
+static int serve_checkPoint_fast (struct soap *soap)
+{
+    struct __migol__checkPoint request;
+    soap_default___migol__checkPoint (soap, &request);
+    soap->encodingStyle = NULL;
+    if (!soap_get___migol__checkPoint (soap, &request, "-migol:checkPoint", NULL))
+        return soap->error;
+    if (soap_body_end_in (soap)
+     || soap_envelope_end_in (soap)
+     || soap_end_recv (soap))
+        return soap->error;
+    bool response = false;
+    soap->error = __migol__checkPoint (soap, request.migoldef__checkPoint, response);
+    if (soap->error)
+        return soap->error;
+    static const std::string reply_true  = build_monitor_response ("migoldef:checkPointResponse", "true");
+    static const std::string reply_false = build_monitor_response ("migoldef:checkPointResponse", "false");
+    return send_prebuilt_response (soap, response ? reply_true : reply_false);
+}
+
+/** Retained deserialization arena for the monitoring context.
+
+    gSOAP's soap_malloc normally takes every deserialized string and
+    struct from the heap and soap_end walks and frees them one by one -
+    per request, forever, for a context that lives as long as the
+    process.  The fmalloc hook hands that duty to us: memory obtained
+    through it is caller-managed and invisible to soap_end.  The arena
+    below bump-allocates from one retained block that grows to the
+    high-water mark of the busiest request ever seen; a reset is a
+    pointer rewind.  After warm-up the monitoring path allocates
+    nothing at all.  Every serving context owns exactly one arena
+    (soap->user points at it, the struct lives at the top of this
+    file), so neither the serial loop nor the pool workers need any
+    locking around allocation. **/
+
+static void *monitor_arena_malloc (struct soap *soap, size_t n)
+{
+    monitor_arena_t *arena = static_cast<monitor_arena_t*> (soap->user);
+    if (arena == NULL)     //fmalloc is only ever installed alongside
+        return malloc (n); //an arena; plain malloc keeps misuse benign
+    //align like soap_malloc does
+    n += (-(long)n) & (sizeof(void*) - 1);
+    arena->cycle += n;
+    if (arena->base == NULL) {
+        arena->size = 64 * 1024;
+        arena->base = (char*) malloc (arena->size);
+    }
+    if (arena->base && arena->used + n <= arena->size) {
+        void *p = arena->base + arena->used;
+        arena->used += n;
+        return p;
+    }
+    //outsized request: plain malloc, freed on the next reset
+    void *p = malloc (n);
+    if (p != NULL)
+        arena->overflow.push_back (p);
+    return p;
+}
+
+static void monitor_arena_reset (struct soap *soap)
+{
+    monitor_arena_t *arena = static_cast<monitor_arena_t*> (soap->user);
+    if (arena == NULL)
+        return;
+    for (size_t i = 0; i < arena->overflow.size (); i++)
+        free (arena->overflow[i]);
+    arena->overflow.clear ();
+    //a request that spilled grows the block to its high-water mark, so
+    //the spill happens once per size, not once per request
+    if (arena->cycle > arena->size) {
+        free (arena->base);
+        arena->size = arena->cycle;
+        arena->base = (char*) malloc (arena->size);
+    }
+    arena->used  = 0;
+    arena->cycle = 0;
+}
+
+static void monitor_arena_release (struct soap *soap)
+{
+    monitor_arena_t *arena = static_cast<monitor_arena_t*> (soap->user);
+    if (arena == NULL)
+        return;
+    monitor_arena_reset (soap);
+    free (arena->base);
+    arena->base = NULL;
+    arena->size = 0;
+}
+
+//mirrors the generated monitor_serve() keep-alive loop, but routes the
+//two hot calls through the prebuilt-reply handlers above.  Unlike the
+//generated loop, each request's deserialized data is torn down right
+//here - a rewind of the retained arena - instead of accumulating until
+//the connection closes
+static int monitor_serve_fast (struct soap *soap)
+{
+    unsigned int k = soap->max_keep_alive;
+    do
+    {
+        soap_begin (soap);
+        if (soap->max_keep_alive > 0 && !--k)
+            soap->keep_alive = 0;
+        if (soap_begin_recv (soap))
+        {
+            if (soap->error < SOAP_STOP)
+                return soap_send_fault (soap);
+            soap_closesock (soap);
+            continue;
+        }
+        if (soap_envelope_begin_in (soap)
+         || soap_recv_header (soap)
+         || soap_body_begin_in (soap))
+            return soap_send_fault (soap);
+        soap_peek_element (soap);
+        int result;
+        if (!soap_match_tag (soap, soap->tag, "migoldef:checkService"))
+            result = serve_checkService_fast (soap);
+        else if (!soap_match_tag (soap, soap->tag, "migoldef:checkPoint"))
+            result = serve_checkPoint_fast (soap);
+        else
+        {
+            //everything else takes the generated, WSDL-exact slow path;
+            //revert the peeked element so it can dispatch on it again
+            soap_revert (soap);
+            result = monitor_serve_request (soap);
+        }
+        if (result || (soap->fserveloop && soap->fserveloop (soap)))
+            return soap_send_fault (soap);
+        //request done: delete instantiated C++ objects, then rewind
+        //the arena holding every deserialized copy
+        soap_destroy (soap);
+        soap_end (soap);
+        monitor_arena_reset (soap);
+    } while (soap->keep_alive);
+    return SOAP_OK;
+}
+
+namespace cpr {
+
+/** Pool worker of the threaded monitorable server.  Workers block on
+    the bounded queue the accept loop fills, serve one connection at a
+    time through the same fast keep-alive loop the serial mode uses,
+    and exit once terminate is set and the queue has drained.  Each
+    worker owns one retained arena that survives across connections,
+    so the warm-block behaviour of the serial mode carries over.  A
+    stalled client wedges at most its one worker, and only within the
+    context's receive timeout and keep-alive cap. **/
+void migol::monitor_worker ()
+{
+    monitor_arena_t arena;
+    while (true)
+    {
+        struct soap *tsoap = NULL;
+        {
+            boost::mutex::scoped_lock lock (monitor_mtx_);
+            while (monitor_queue_.empty () && !terminate)
+                monitor_cond_.wait (lock);
+            if (monitor_queue_.empty ())
+                break;
+            tsoap = monitor_queue_.front ();
+            monitor_queue_.pop_front ();
+        }
+        tsoap->user    = &arena;
+        tsoap->fmalloc = monitor_arena_malloc;
+        monitor_serve_fast (tsoap);  // process RPC request(s)
+        soap_destroy (tsoap);
+        soap_end (tsoap);
+        monitor_arena_reset (tsoap);
+        unsigned long ip = tsoap->ip;
+        tsoap->user = NULL;
+        soap_free (tsoap);           // done + free, closes the socket
+        {
+            boost::mutex::scoped_lock lock (monitor_mtx_);
+            std::map<unsigned long, int>::iterator it =
+                monitor_inflight_.find (ip);
+            if (it != monitor_inflight_.end () && --it->second <= 0)
+                monitor_inflight_.erase (it);
+        }
+    }
+    //release this worker's retained block
+    for (size_t i = 0; i < arena.overflow.size (); i++)
+        free (arena.overflow[i]);
+    free (arena.base);
+}
+
+}   // namespace cpr
+
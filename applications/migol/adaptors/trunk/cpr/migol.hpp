@@ -13,11 +13,19 @@
 //#include <saga/adaptors/attribute.hpp>
 
 
+#include <deque>
+#include <map>
+#include <vector>
+#include <ctime>
+
 #include <boost/utility.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition.hpp>
 
+//gSOAP context of the monitorable server (see stdsoap2.h)
+struct soap;
+
 ///////////////////////////////////////////////////////////////////////////////
 namespace cpr
 {
@@ -46,6 +54,9 @@ namespace cpr
         std::string register_service(std::string url, std::string service_name, std::string state) ;
         bool change_service_state(std::string guid, std::string newState);
         bool register_checkpoint(std::string guid, std::string fileName);
+        /** queue a checkpoint registration and return immediately; a
+            background thread drains the queue to the AIS with retry/backoff **/
+        void register_checkpoint_async(std::string guid, std::string fileName);
         std::vector<saga::url> get_files (std::string guid);
         std::map<saga::url, std::map<std::string, std::string> > get_files_map (std::string guid);
         bool update_machine(std::string guid, std::string url);
@@ -55,6 +66,12 @@ namespace cpr
         
         /** Checkpoint Replication Service **/
         bool replicate(std::string guid, int automatic_replication);
+
+        /** adaptor-side striped replication (preferences section) **/
+        std::string get_replica_location();
+        int get_replica_streams();
+        long get_replica_stripe_size();
+        int get_replica_dedup();
                 
         /** Monitoring **/
         void init_external_monitoring();
@@ -76,6 +93,10 @@ namespace cpr
                         std::string number_procs,
                         std::string queue                     );
         std::string get_job_state(std::string guid);
+        /** resolve the states of many jobs in one registry round-trip;
+            terminal states are cached, and the returned snapshot serves
+            single-job lookups for a few seconds **/
+        std::map<std::string, std::string> get_job_states(std::vector<std::string> guids);
         void cancel_job(std::string guid);
         
         
@@ -121,14 +142,54 @@ namespace cpr
         volatile bool terminate;
         volatile bool initialized;
         void monitorable_server();
+
+        //threaded monitorable server: the accept loop feeds a fixed
+        //worker pool over a bounded queue (see monitorable_server).
+        //monitor_threads_ is the pool size (preference monitor_threads;
+        //0 restores the serial serve loop); monitor_inflight_ counts
+        //queued + running requests per client ip for fairness
+        int monitor_threads_;
+        std::deque<struct soap*> monitor_queue_;
+        std::map<unsigned long, int> monitor_inflight_;
+        boost::mutex monitor_mtx_;
+        boost::condition monitor_cond_;
+        std::vector<boost::thread*> monitor_pool_;
+        void monitor_worker();
         
         
         std::string external_monitoring_host;
 
+        //adaptor-side striped checkpoint replication
+        std::string replica_location;
+        int replica_streams;
+        long replica_stripe_size;
+        int replica_dedup;
+
         pid_t reverse_proxy_pid;
         
         boost::thread monitorable_thread;
         boost::thread *reverse_proxy_thread;
+
+        //asynchronous checkpoint registration
+        struct registration_request {
+            std::string guid;
+            std::string file_name;
+            int attempts;
+        };
+        //job state reconciliation: terminal states never change and are
+        //cached for good; the last bulk query is kept as a short-lived
+        //snapshot so per-job lookups right after it stay local
+        std::map<std::string, std::string> job_state_cache_;
+        std::map<std::string, std::string> job_state_snapshot_;
+        time_t job_state_snapshot_time_;
+        boost::mutex job_state_mtx_;
+        void cache_job_state(std::string guid, std::string state);
+
+        std::deque<registration_request> registration_queue_;
+        boost::mutex registration_mtx_;
+        boost::condition registration_cond_;
+        boost::thread *registration_thread_;
+        void registration_worker();
         //boost::mutex mutex;
         //boost::condition cond;
         
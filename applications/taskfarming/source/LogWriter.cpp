@@ -21,10 +21,13 @@
 // THE SOFTWARE.
 
 #include <time.h>
+#include <cstdio>
 #include <ostream>
 
 #include "defines.hpp"
 #include "LogWriter.hpp"
+#include "chunk_codec.hpp"
+#include <boost/bind.hpp>
 
 using namespace saga;
 using namespace TaskFarmer;
@@ -32,25 +35,51 @@ using namespace TaskFarmer;
 ///////////////////////////////////////////////////////////////////////////////
 //
 LogWriter::LogWriter(void)
-: appName_(""), out_(std::cout)
+: appName_(""), toFile_(false), binary_(false),
+  maxBytes_(0), keepFiles_(0), bytes_(0),
+  out_(std::cout), ring_(RING_SIZE),
+  head_(0), queued_(0), dropped_(0), running_(true),
+  writer_(boost::bind(&LogWriter::writerLoop_, this))
 {
-  
+
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //
 LogWriter::LogWriter(std::string appName)
-: appName_(appName), out_(std::cout)
+: appName_(appName), toFile_(false), binary_(false),
+  maxBytes_(0), keepFiles_(0), bytes_(0),
+  out_(std::cout), ring_(RING_SIZE),
+  head_(0), queued_(0), dropped_(0), running_(true),
+  writer_(boost::bind(&LogWriter::writerLoop_, this))
 {
-  
+
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //
 LogWriter::LogWriter(std::string appName, std::ostream& logStream = std::cout)
-: appName_(appName), out_(logStream)
+: appName_(appName), toFile_(false), binary_(false),
+  maxBytes_(0), keepFiles_(0), bytes_(0),
+  out_(logStream), ring_(RING_SIZE),
+  head_(0), queued_(0), dropped_(0), running_(true),
+  writer_(boost::bind(&LogWriter::writerLoop_, this))
 {
-  
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+LogWriter::LogWriter(std::string appName, std::string logFile,
+                     std::size_t maxBytes, unsigned int keepFiles,
+                     bool binary)
+: appName_(appName), toFile_(true), binary_(binary),
+  logFile_(logFile), maxBytes_(maxBytes), keepFiles_(keepFiles), bytes_(0),
+  out_(file_), ring_(RING_SIZE),
+  head_(0), queued_(0), dropped_(0), running_(true),
+  writer_(boost::bind(&LogWriter::writerLoop_, this))
+{
+  openFile_();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -58,7 +87,24 @@ LogWriter::LogWriter(std::string appName, std::ostream& logStream = std::cout)
 
 LogWriter::~LogWriter()
 {
-  
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    running_ = false;
+    notEmpty_.notify_all();
+  }
+  writer_.join();
+  // write out anything still parked on the ring
+  while(queued_ > 0) {
+    emit_(ring_[head_]);
+    head_ = (head_ + 1) % RING_SIZE;
+    queued_--;
+  }
+  if(dropped_ > 0) {
+    std::ostringstream msg;
+    msg << "LogWriter: dropped " << dropped_ << " messages (ring full)";
+    emit_(binary_ ? encodeRecord_(msg.str(), LOGLEVEL_WARNING)
+                  : format_(msg.str(), LOGLEVEL_WARNING));
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -66,36 +112,172 @@ LogWriter::~LogWriter()
 
 void LogWriter::write(std::string message, unsigned int logLevel)
 {
+  std::string entry = binary_ ? encodeRecord_(message, logLevel)
+                              : format_(message, logLevel);
+  boost::mutex::scoped_lock lock(mutex_);
+  if(queued_ == RING_SIZE) {
+    dropped_++;
+    return;
+  }
+  ring_[(head_ + queued_) % RING_SIZE] = entry;
+  queued_++;
+  notEmpty_.notify_one();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void LogWriter::writerLoop_()
+{
+  while(true) {
+    std::string entry;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while(queued_ == 0) {
+        if(!running_) {
+          return;
+        }
+        notEmpty_.wait(lock);
+      }
+      entry.swap(ring_[head_]);
+      head_ = (head_ + 1) % RING_SIZE;
+      queued_--;
+    }
+    emit_(entry);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void LogWriter::emit_(std::string const &entry)
+{
+  // rotate before the entry that would push the file over the bound,
+  // so a file never exceeds maxBytes_ (entries larger than the bound
+  // go into a file of their own)
+  if(toFile_ && bytes_ > 0 && bytes_ + entry.size() > maxBytes_) {
+    rotate_();
+  }
+  out_ << entry;
+  bytes_ += entry.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void LogWriter::openFile_()
+{
+  std::ios::openmode mode = std::ios::out | std::ios::app;
+  if(binary_) {
+    mode |= std::ios::binary;
+  }
+  file_.open(logFile_.c_str(), mode);
+  file_.seekp(0, std::ios::end);
+  bytes_ = (file_.tellp() > 0) ? (std::size_t) file_.tellp() : 0;
+
+  // a fresh binary file starts with a header naming the application,
+  // so the records themselves don't have to repeat it
+  if(binary_ && bytes_ == 0) {
+    std::string header("TFL1;");
+    chunk_codec::detail::appendField(header, appName_);
+    file_ << header;
+    bytes_ = header.size();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+void LogWriter::rotate_()
+{
+  // shift the numbered backups up (<file>.1 is the youngest), drop
+  // the one falling off the end, and start over on an empty file
+  file_.close();
+
+  std::ostringstream oldest;
+  oldest << logFile_ << "." << keepFiles_;
+  std::remove(oldest.str().c_str());
+
+  for(unsigned int i = keepFiles_; i > 1; i--) {
+    std::ostringstream from, to;
+    from << logFile_ << "." << (i - 1);
+    to   << logFile_ << "." << i;
+    std::rename(from.str().c_str(), to.str().c_str());
+  }
+
+  if(keepFiles_ > 0) {
+    std::string first(logFile_ + ".1");
+    std::rename(logFile_.c_str(), first.c_str());
+  }
+  else {
+    std::remove(logFile_.c_str());
+  }
+
+  openFile_();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+std::string LogWriter::format_(std::string const &message, unsigned int logLevel)
+{
+  std::ostringstream out;
   // generate timestamp string
   time_t rawTime; struct tm * timeInfo;
   time(&rawTime); timeInfo = localtime(&rawTime);
-  out_ << timeInfo->tm_mon << "/" << timeInfo->tm_mday << "/" 
-       << timeInfo->tm_year << " ";
-  out_ << timeInfo->tm_hour << ":" << timeInfo->tm_min << ":" 
-       << timeInfo->tm_sec << "\t ";
+  out << timeInfo->tm_mon << "/" << timeInfo->tm_mday << "/" 
+      << timeInfo->tm_year << " ";
+  out << timeInfo->tm_hour << ":" << timeInfo->tm_min << ":" 
+      << timeInfo->tm_sec << "\t ";
   
   // append application name
-  out_ << appName_ << "\t ";
+  out << appName_ << "\t ";
   
   // append debug level
   switch(logLevel) {
       
     case(LOGLEVEL_DEBUG):
-      out_ << "[DEBUG]\t"; break;
+      out << "[DEBUG]\t"; break;
       
     case(LOGLEVEL_INFO):
-      out_ << "[INFO]\t"; break;
+      out << "[INFO]\t"; break;
       
     case(LOGLEVEL_WARNING):
-      out_ << "[WARNING]\t"; break;
+      out << "[WARNING]\t"; break;
 
     case(LOGLEVEL_ERROR):
-      out_ << "[ERROR]\t"; break;
+      out << "[ERROR]\t"; break;
       
     case(LOGLEVEL_FATAL):
-      out_ << "[FATAL]\t"; break;
+      out << "[FATAL]\t"; break;
   }
   
   //append message
-  out_ << message << std::endl;
+  out << message << std::endl;
+  return out.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+
+std::string LogWriter::encodeRecord_(std::string const &message, unsigned int logLevel)
+{
+  // one structured record: timestamp (epoch seconds), level and
+  // message as length-prefixed fields in the chunk_codec framing -
+  // no text formatting on the write path, and a message can hold
+  // any byte
+  time_t rawTime;
+  time(&rawTime);
+
+  char num[24];
+  std::string rec;
+
+  ::sprintf(num, "%lu", (unsigned long) rawTime);
+  chunk_codec::detail::appendField(rec, num);
+
+  ::sprintf(num, "%u", logLevel);
+  chunk_codec::detail::appendField(rec, num);
+
+  chunk_codec::detail::appendField(rec, message);
+  return rec;
 }
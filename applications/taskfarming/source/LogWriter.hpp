@@ -24,27 +24,79 @@
 #define TF_LOG_WRITER_HPP
 
 #include <string>
+#include <sstream>
+#include <fstream>
+#include <vector>
 #include <saga/saga.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
 
-namespace TaskFarmer 
+namespace TaskFarmer
 {
+  // Log entries are formatted by the caller, parked on a bounded
+  // ring and written to the output sink by a background thread.
+  // A full ring drops the entry (and counts it) rather than making
+  // the caller wait on stream I/O.
+  //
+  // The sink is either a caller-supplied stream, or a size-bounded
+  // rotating file: when the current file would exceed maxBytes, it
+  // is rotated into numbered backups (<file>.1 is the youngest) and
+  // at most keepFiles backups are kept - a long farm's logging cost
+  // and footprint stay flat over its lifetime.  The rotating sink
+  // optionally writes binary structured records instead of text:
+  // a "TFL1;" header naming the application, then per entry the
+  // timestamp, level and message as length-prefixed fields in the
+  // chunk_codec framing (see chunk_codec.hpp).
   class LogWriter {
 
   private:
-    
+
+    static const std::size_t RING_SIZE = 1024;
+
     std::string appName_;
+
+    // rotating file sink state; unused (toFile_ == false) for the
+    // stream constructors
+    std::ofstream    file_;
+    bool             toFile_;
+    bool             binary_;
+    std::string      logFile_;
+    std::size_t      maxBytes_;
+    unsigned int     keepFiles_;
+    std::size_t      bytes_;   // written to the current file so far
+
     std::ostream & out_;
-    
+
+    std::vector<std::string> ring_;
+    std::size_t      head_;
+    std::size_t      queued_;
+    std::size_t      dropped_;
+    bool             running_;
+    boost::mutex     mutex_;
+    boost::condition notEmpty_;
+    boost::thread    writer_; // started last, after the ring
+
+    std::string format_(std::string const &message, unsigned int logLevel);
+    std::string encodeRecord_(std::string const &message, unsigned int logLevel);
+    void openFile_();
+    void rotate_();
+    void emit_(std::string const &entry);
+    void writerLoop_();
+
   public:
-    
+
     LogWriter();
     LogWriter(std::string appName);
     LogWriter(std::string appName, std::ostream& logStream);
-    
+    LogWriter(std::string appName, std::string logFile,
+              std::size_t maxBytes, unsigned int keepFiles = 3,
+              bool binary = false);
+
     ~LogWriter();
-    
+
     void write(std::string, unsigned int logLevel);
-    
+
   };
 }
 
@@ -21,11 +21,15 @@
 // THE SOFTWARE.
 
 #include "../defines.hpp"
+#include "../chunk_codec.hpp"
 #include "version.hpp"
 
 #include "AgentApp.hpp"
 #include "SystemInfo.hpp"
 
+#include <cstdlib>
+#include <algorithm>
+
 #include <boost/lexical_cast.hpp>
 
 using namespace saga;
@@ -72,12 +76,17 @@ AgentApp::~AgentApp()
 void AgentApp::run()
 {
   // get some environment information
-  
+
   // register with the db
   registerWithDB_();
-  
+
+  // start the health manager - it owns the keepalive traffic from
+  // here on (adaptive interval, per-host leader aggregation)
+  healthManager_ = HealthManager(sessionBaseDir_, agentAdvertDir_);
+  healthManager_.init(uuid_, systemInfo_.hostName(), 5);
+
   // run the main loop
-  mainLoop_(5);
+  mainLoop_();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -93,7 +102,7 @@ void AgentApp::registerWithDB_()
   advertKey += database_ + "//" + sessionUUID_ + "/" ;
   
   try {
-    advert::directory(advertKey, mode);
+    sessionBaseDir_ = advert::directory(advertKey, mode);
   }
   catch(saga::exception const & e) {
     std::cout << "FAILED (" << e.get_error() << ")" << std::endl;
@@ -147,14 +156,30 @@ void AgentApp::registerWithDB_()
   //(4) set the last seen (keep alive) timestamp ==============================
   time_t timestamp; time(&timestamp);
   try {
-    agentAdvertDir_.set_attribute(ATTR_LAST_SEEN, 
+    agentAdvertDir_.set_attribute(ATTR_LAST_SEEN,
       boost::lexical_cast<std::string>(timestamp));
   }
   catch(saga::exception const & e) {
     std::cout << "FAILED (" << e.get_error() << ")" << std::endl;
     throw;
   }
-  
+
+  //(5) open the session's chunk (work) directory =============================
+  try {
+    std::string chunksKey("advert://");
+    chunksKey += database_ + "//" + sessionUUID_ + "/";
+    chunksKey += ADVERT_DIR_CHUNKS;
+    chunksKey += "/";
+
+    // the shard count is read from the directory the submitter created
+    chunksDir_ = sharded_dir::directory(advert::directory(chunksKey, mode),
+                                        mode);
+  }
+  catch(saga::exception const & e) {
+    std::cout << "FAILED (" << e.get_error() << ")" << std::endl;
+    throw;
+  }
+
   std::cout << "SUCCESSFUL" << std::endl;
   std::cout << "\tContact URL = " << agentAdvertDir_.get_url() << std::endl;
 }
@@ -220,13 +245,350 @@ int AgentApp::getFrontendCommand_()
 
 ///////////////////////////////////////////////////////////////////////////////
 //
-void AgentApp::mainLoop_(unsigned int updateInterval)
+void AgentApp::prefetchTasks_()
+{
+  // claim up to TF_AGENT_PREFETCH_DEPTH chunks ahead of time in one pass
+  // over the chunk directory, so short tasks don't pay one directory scan
+  // each and the agent keeps working through its local queue while the
+  // advert service is slow
+  if(taskQueue_.size() >= TF_AGENT_PREFETCH_DEPTH) return;
+
+  std::cout << std::endl << "Prefetching work chunks: " << std::flush;
+
+  unsigned int claimed = 0;
+
+  try {
+    std::vector<std::string> chunks = chunksDir_.list();
+
+    std::vector<std::string>::iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
+    {
+      if(taskQueue_.size() >= TF_AGENT_PREFETCH_DEPTH) break;
+
+      advert::entry adv = chunksDir_.open(*it, advert::ReadWrite);
+
+      // skip chunks another agent already claimed or finished. The
+      // claim itself is a plain attribute write - two agents racing
+      // for the same chunk at worst process it twice, which farmed
+      // tasks have to tolerate anyway
+      if(adv.attribute_exists(ATTR_CHUNK_STATE)
+         && !adv.get_attribute(ATTR_CHUNK_STATE).empty()) {
+        continue;
+      }
+
+      time_t now; time(&now);
+
+      adv.set_attribute(ATTR_CHUNK_STATE,
+                        std::string(CHUNK_STATE_CLAIMED) + ":" + uuid_);
+      adv.set_attribute(ATTR_CHUNK_CLAIM_TIME,
+                        boost::lexical_cast<std::string>(now));
+      adv.set_attribute(ATTR_CHUNK_EPOCH, "1");
+
+      claimed += enqueueChunk_(*it, adv, 1);
+    }
+  }
+  catch(saga::exception const & e) {
+    std::cout << "FAILED (" << e.get_error() << ")" << std::endl;
+    throw;
+  }
+
+  std::cout << "SUCCESSFUL (" << claimed << " claimed, "
+            << taskQueue_.size() << " queued)" << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+unsigned int AgentApp::enqueueChunk_(const std::string   & name,
+                                     saga::advert::entry & adv,
+                                     int                   epoch)
+{
+  unsigned int queued = 0;
+
+  if(adv.attribute_exists(ATTR_BLOCK_CHUNKS))
+  {
+    // a submission block - unpack all serialized chunks into the
+    // local queue. The block is claimed and completed as a unit,
+    // so only the last chunk carries the completion report. A
+    // block may overshoot the prefetch depth; that only makes the
+    // local queue a little deeper
+    std::string packed = adv.get_attribute(ATTR_BLOCK_CHUNKS);
+
+    if(TaskFarmer::chunk_codec::isBundle(packed))
+    {
+      // a compiled chunk bundle (see chunk_codec.hpp): the submitter
+      // parsed the XML once, we just lift the records out
+      std::vector<TaskFarmer::chunk_codec::ChunkRecord> recs;
+
+      if(!TaskFarmer::chunk_codec::parseBundle(packed, recs)) {
+        std::cout << std::endl << "Corrupt chunk bundle " << name
+                  << " - skipping" << std::endl;
+        return 0;
+      }
+
+      for(unsigned int i = 0; i < recs.size(); ++i)
+      {
+        TaskChunk task;
+        task.advert       = adv;
+        task.report       = (i + 1 == recs.size());
+        task.epoch        = epoch;
+        task.name         = recs[i].name;
+        task.invokeString = recs[i].invokeString;
+
+        for(unsigned int f = 0; f < recs[i].inFiles.size(); ++f) {
+          task.inFiles += recs[i].inFiles[f] + ";";
+        }
+
+        taskQueue_.push_back(task);
+        ++queued;
+      }
+
+      return queued;
+    }
+
+    // legacy text block: '<uuid>|<in-files>' records joined by newlines
+    std::string::size_type last = 0;
+    while(last < packed.length())
+    {
+      std::string::size_type pos = packed.find("\n", last);
+      std::string record = packed.substr(last, pos - last);
+
+      TaskChunk task;
+      task.advert = adv;
+      task.report = false;
+      task.epoch  = epoch;
+
+      std::string::size_type sep = record.find("|");
+      task.name    = record.substr(0, sep);
+      if(sep != std::string::npos) {
+        task.inFiles = record.substr(sep + 1);
+      }
+
+      if(pos == std::string::npos) {
+        task.report = true;
+        taskQueue_.push_back(task);
+        ++queued;
+        break;
+      }
+
+      taskQueue_.push_back(task);
+      ++queued;
+      last = pos + 1;
+    }
+  }
+  else
+  {
+    // a single (unblocked) chunk entry
+    TaskChunk task;
+    task.name   = name;
+    task.advert = adv;
+    task.report = true;
+    task.epoch  = epoch;
+
+    if(adv.attribute_exists(ATTR_CHUNK_IN_FILES)) {
+      task.inFiles = adv.get_attribute(ATTR_CHUNK_IN_FILES);
+    }
+
+    if(adv.attribute_exists(ATTR_CHUNK_INVOKE_STR)) {
+      task.invokeString = adv.get_attribute(ATTR_CHUNK_INVOKE_STR);
+    }
+
+    taskQueue_.push_back(task);
+    ++queued;
+  }
+
+  return queued;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// an entry of the steal candidate list: a still-claimed chunk and the
+// age of its claim
+namespace {
+  struct StealCandidate
+  {
+    long                age;
+    std::string         name;
+    saga::advert::entry advert;
+  };
+
+  bool olderClaimFirst(const StealCandidate & a, const StealCandidate & b)
+  {
+    return a.age > b.age;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+void AgentApp::stealTasks_()
+{
+  // the farm ran dry, but other agents may still hold claims - near
+  // the end of a farm that means a few agents grind long chunks while
+  // the rest idles.  The claim attributes on the chunk adverts form
+  // the farm's in-progress table: re-claim duplicates of the
+  // longest-running chunks and bump their epoch.  The first finisher
+  // wins; the loser's report is discarded (see reportCompleted_).
+  std::cout << std::endl << "Farm looks empty - stealing work: "
+            << std::flush;
+
+  unsigned int stolen = 0;
+
+  try {
+    time_t now; time(&now);
+
+    std::vector<StealCandidate> candidates;
+
+    std::vector<std::string> chunks = chunksDir_.list();
+
+    std::vector<std::string>::iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
+    {
+      advert::entry adv = chunksDir_.open(*it, advert::ReadWrite);
+
+      if(!adv.attribute_exists(ATTR_CHUNK_STATE)) continue;
+
+      std::string state = adv.get_attribute(ATTR_CHUNK_STATE);
+
+      // only chunks somebody else is still working on are worth a
+      // duplicate - our own claims sit in the local queue anyway
+      if(state.find(CHUNK_STATE_CLAIMED) != 0) continue;
+      if(state == std::string(CHUNK_STATE_CLAIMED) + ":" + uuid_) continue;
+
+      StealCandidate cand;
+      cand.name   = *it;
+      cand.advert = adv;
+      cand.age    = TF_AGENT_STEAL_MIN_AGE;  // unknown claim age: old enough
+
+      if(adv.attribute_exists(ATTR_CHUNK_CLAIM_TIME)) {
+        cand.age = (long) (now - boost::lexical_cast<time_t>(
+          adv.get_attribute(ATTR_CHUNK_CLAIM_TIME)));
+      }
+
+      if(cand.age < TF_AGENT_STEAL_MIN_AGE) continue;
+
+      candidates.push_back(cand);
+    }
+
+    // longest-running claims first
+    std::sort(candidates.begin(), candidates.end(), olderClaimFirst);
+
+    for(unsigned int i = 0;
+        i < candidates.size() && stolen < TF_AGENT_STEAL_MAX; ++i)
+    {
+      advert::entry & adv = candidates[i].advert;
+
+      // the original owner may have finished while we were scanning
+      if(adv.get_attribute(ATTR_CHUNK_STATE).find(CHUNK_STATE_DONE) == 0) {
+        continue;
+      }
+
+      int epoch = 1;
+      if(adv.attribute_exists(ATTR_CHUNK_EPOCH)) {
+        epoch = ::atoi(adv.get_attribute(ATTR_CHUNK_EPOCH).c_str());
+      }
+      ++epoch;
+
+      adv.set_attribute(ATTR_CHUNK_STATE,
+                        std::string(CHUNK_STATE_CLAIMED) + ":" + uuid_);
+      adv.set_attribute(ATTR_CHUNK_CLAIM_TIME,
+                        boost::lexical_cast<std::string>(now));
+      adv.set_attribute(ATTR_CHUNK_EPOCH,
+                        boost::lexical_cast<std::string>(epoch));
+
+      std::cout << candidates[i].name << " (claim age "
+                << candidates[i].age << "s, epoch " << epoch << ") "
+                << std::flush;
+
+      stolen += enqueueChunk_(candidates[i].name, adv, epoch);
+    }
+  }
+  catch(saga::exception const & e) {
+    // stealing is opportunistic - on trouble, go back to the normal
+    // prefetch/heartbeat cycle instead of taking the agent down
+    std::cout << "FAILED (" << e.get_error() << ")" << std::endl;
+    return;
+  }
+
+  std::cout << "SUCCESSFUL (" << stolen << " stolen)" << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+void AgentApp::processTask_(TaskChunk & task)
+{
+  // this is where the actual chunk execution (stage-in, invocation,
+  // stage-out) hooks in; for now we just log the work item
+  std::cout << std::endl << "Processing chunk " << task.name
+            << " (invoke: "   << task.invokeString
+            << ", stage-in: " << task.inFiles << ")" << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+void AgentApp::reportCompleted_()
+{
+  // report all finished chunks in one bulk of asynchronous writes with
+  // a single wait, instead of one round trip per chunk
+  if(completedTasks_.empty()) return;
+
+  std::cout << std::endl << "Reporting " << completedTasks_.size()
+            << " completed chunk(s): " << std::flush;
+
+  unsigned int duplicates = 0;
+
+  try {
+    saga::task_container tc;
+
+    std::vector<TaskChunk>::iterator it;
+    for(it = completedTasks_.begin(); it != completedTasks_.end(); ++it)
+    {
+      // chunks of a submission block share one advert entry; only
+      // the last chunk of the block reports
+      if(!(*it).report) continue;
+
+      // first finisher wins: if the chunk went DONE while we worked
+      // on it (we stole it, or somebody stole it from us), this
+      // result is a duplicate and gets discarded
+      if((*it).advert.attribute_exists(ATTR_CHUNK_STATE)
+         && (*it).advert.get_attribute(ATTR_CHUNK_STATE)
+              .find(CHUNK_STATE_DONE) == 0) {
+        ++duplicates;
+        continue;
+      }
+
+      // note the epoch our claim ran under, so consumers can match
+      // the winning attempt's outputs
+      tc.add_task((*it).advert.set_attribute<saga::task_base::Async>(
+        ATTR_CHUNK_DONE_EPOCH,
+        boost::lexical_cast<std::string>((*it).epoch)));
+
+      tc.add_task((*it).advert.set_attribute<saga::task_base::Async>(
+        ATTR_CHUNK_STATE, CHUNK_STATE_DONE));
+    }
+
+    tc.wait();
+    completedTasks_.clear();
+  }
+  catch(saga::exception const & e) {
+    std::cout << "FAILED (" << e.get_error() << ")" << std::endl;
+    throw;
+  }
+
+  std::cout << "SUCCESSFUL";
+  if(duplicates) {
+    std::cout << " (" << duplicates << " duplicate(s) discarded)";
+  }
+  std::cout << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+void AgentApp::mainLoop_()
 {
   while(1) {
-    
+
     //(1) read command from orchestrator
     int command = getFrontendCommand_();
-    switch(command) 
+    switch(command)
     {
       case AGENT_COMMAND_DISCARD:
         break;
@@ -235,18 +597,56 @@ void AgentApp::mainLoop_(unsigned int updateInterval)
       case AGENT_COMMAND_PAUSE:
         break;
       case AGENT_COMMAND_QUIT:
+        reportCompleted_();
         return;
         break;
       default:
         break;
     }
-    
-      
-    //(2) write some statistics + ping signal 
-    updateStatus_();
-        
-    //(3) sleep for a while
-    sleep(updateInterval);
+
+    //(2) refill the local task queue and work through it. Completions
+    //    are reported in batches while we go
+    prefetchTasks_();
+
+    // nothing left to claim, but the farm may still have stragglers:
+    // duplicate the longest-running claims instead of idling out the
+    // tail on a reserved allocation
+    if(taskQueue_.empty()) {
+      stealTasks_();
+    }
+
+    while(!taskQueue_.empty())
+    {
+      TaskChunk task = taskQueue_.front();
+      taskQueue_.pop_front();
+
+      processTask_(task);
+      completedTasks_.push_back(task);
+
+      if(completedTasks_.size() >= TF_AGENT_COMPLETION_BATCH) {
+        reportCompleted_();
+      }
+
+      // top the queue up before it runs dry
+      if(taskQueue_.size() <= TF_AGENT_PREFETCH_DEPTH / 2) {
+        prefetchTasks_();
+      }
+    }
+
+    reportCompleted_();
+
+    //(3) keepalive: the health manager decides whether this agent has
+    //    to ping at all (the host's leader beats for everyone), and the
+    //    leader also refreshes the per-host statistics
+    healthManager_.heartbeat();
+
+    if(healthManager_.isLeader()) {
+      updateStatus_();
+    }
+
+    //(4) sleep until the next heartbeat is due (interval scales with
+    //    the farm size, jittered)
+    sleep(healthManager_.nextHeartbeatDelay());
   }
 }
 
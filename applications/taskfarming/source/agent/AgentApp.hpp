@@ -24,35 +24,73 @@
 #define TF_AGENT_TFAGENTAPP_HPP
 
 #include <time.h>
+#include <deque>
 #include <string>
+#include <vector>
 #include <saga/saga.hpp>
 
+#include "../../../common/sharded_dir.hpp"
+
 #include "SystemInfo.hpp"
+#include "HealthManager.hpp"
 #include "../LogWriter.hpp"
 
-namespace TaskFarmer 
+namespace TaskFarmer
 {
-  namespace Agent 
+  namespace Agent
   {
-    class AgentApp 
+    // a work chunk claimed from the farm, held in the agent's local queue.
+    // Chunks unpacked from a submission block all share the block's
+    // advert; only the last one of a block carries the completion report
+    struct TaskChunk
+    {
+      std::string         name;
+      std::string         inFiles;
+      std::string         invokeString;
+      saga::advert::entry advert;
+      bool                report;
+      int                 epoch;   // claim epoch we run under (see stealTasks_)
+    };
+
+    class AgentApp
     {
       private:
         std::string uuid_;
         std::string sessionUUID_;
         std::string database_;
-        
+
         time_t startupTime_;
         SystemInfo systemInfo_;
-        
+
+        saga::advert::directory sessionBaseDir_;
         saga::advert::directory agentAdvertDir_;
+
+        // the farm's work directory, sharded so the per-prefetch scan
+        // stays cheap (see common/sharded_dir.hpp)
+        sharded_dir::directory  chunksDir_;
         TaskFarmer::LogWriter * logWriter_;
-        
+
+        HealthManager healthManager_;
+
+        // prefetched chunks waiting to be processed, and finished
+        // chunks waiting to be reported back in one bulk
+        std::deque<TaskChunk>  taskQueue_;
+        std::vector<TaskChunk> completedTasks_;
+
         void updateStatus_();
         void registerWithDB_();
-        void mainLoop_(unsigned int updateInterval);
-        
+        void mainLoop_();
+
+        void prefetchTasks_();
+        void stealTasks_();
+        unsigned int enqueueChunk_(const std::string   & name,
+                                   saga::advert::entry & adv,
+                                   int                   epoch);
+        void processTask_(TaskChunk & task);
+        void reportCompleted_();
+
         void cleanup_();
-        
+
         int getFrontendCommand_();
         
       public:
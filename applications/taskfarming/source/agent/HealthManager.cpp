@@ -20,21 +20,30 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <cstdlib>
+#include <ctime>
+
+#include <boost/lexical_cast.hpp>
+
+#include "../defines.hpp"
 #include "HealthManager.hpp"
 
 using namespace saga;
 using namespace TaskFarmer::Agent;
 
 HealthManager::HealthManager()
+: sessionBaseDir_(0), agentBaseDir_(0), baseInterval_(5), beatCount_(0),
+  farmSize_(1), isLeader_(true)
 {
 
 }
 
 HealthManager::HealthManager(saga::advert::directory & sessionBaseDir,
                              saga::advert::directory & agentBaseDir)
-: sessionBaseDir_(&sessionBaseDir), agentBaseDir_(&agentBaseDir)
+: sessionBaseDir_(&sessionBaseDir), agentBaseDir_(&agentBaseDir),
+  baseInterval_(5), beatCount_(0), farmSize_(1), isLeader_(true)
 {
-  
+
 }
 
 HealthManager::~HealthManager()
@@ -42,18 +51,117 @@ HealthManager::~HealthManager()
 
 }
 
+void HealthManager::init(std::string uuid, std::string hostName,
+                         unsigned int baseInterval)
+{
+  uuid_ = uuid;
+  hostName_ = hostName;
+  baseInterval_ = baseInterval;
+
+  agentsDir_ = sessionBaseDir_->open_dir(ADVERT_DIR_AGENTS,
+                                         advert::ReadWrite);
+
+  // de-align the jitter of agents started in the same second
+  srand(static_cast<unsigned int>(time(NULL))
+        ^ static_cast<unsigned int>(uuid_[0]));
+
+  startElection_();
+}
+
 void HealthManager::startElection_()
 {
-  
+  // deterministic per-host election, no extra advert traffic beyond
+  // one directory scan: every agent reads the farm's agent list, and
+  // among the agents on its own host the lexicographically smallest
+  // UUID leads. All co-located agents reach the same verdict without
+  // talking to each other
+  std::vector<saga::url> agents = agentsDir_.list("*");
+
+  farmSize_ = agents.size();
+  if(farmSize_ == 0) farmSize_ = 1;
+
+  std::string leader(uuid_);
+  std::vector<saga::advert::directory> peers;
+
+  std::vector<saga::url>::iterator it;
+  for(it = agents.begin(); it != agents.end(); ++it)
+  {
+    try {
+      advert::directory peer = agentsDir_.open_dir(*it, advert::ReadWrite);
+
+      if(!peer.attribute_exists(ATTR_HOST_NAME)) continue;
+      if(peer.get_attribute(ATTR_HOST_NAME) != hostName_) continue;
+
+      // the entry name is the peer's UUID
+      std::string peerUUID((*it).get_path());
+      std::string::size_type pos = peerUUID.rfind("/");
+      if(pos != std::string::npos) peerUUID = peerUUID.substr(pos + 1);
+
+      if(peerUUID < leader) leader = peerUUID;
+      peers.push_back(peer);
+    }
+    catch(saga::exception const & e) {
+      // a peer vanishing mid-scan is normal farm churn - skip it
+      continue;
+    }
+  }
+
+  isLeader_ = (leader == uuid_);
+
+  if(isLeader_) peers_ = peers;
+  else          peers_.clear();
 }
 
 void HealthManager::runAsLeader_()
 {
-  
+  // beat once for the whole host: the keepalive timestamps of all
+  // co-located agents are written as one bulk of asynchronous tasks
+  // with a single wait
+  time_t timestamp; time(&timestamp);
+  std::string now(boost::lexical_cast<std::string>(timestamp));
+
+  saga::task_container tc;
+
+  std::vector<saga::advert::directory>::iterator it;
+  for(it = peers_.begin(); it != peers_.end(); ++it)
+  {
+    tc.add_task((*it).set_attribute<saga::task_base::Async>(
+      ATTR_LAST_SEEN, now));
+  }
+
+  tc.wait();
 }
 
 void HealthManager::runAsSlave_()
 {
+  // nothing to send - the host's leader heartbeats for us. If the
+  // leader dies, the next election (at most TF_HB_ELECTION_PERIOD
+  // beats away) promotes the next agent in line
+}
+
+void HealthManager::heartbeat()
+{
+  if(isLeader_) runAsLeader_();
+  else          runAsSlave_();
+
+  if(++beatCount_ % TF_HB_ELECTION_PERIOD == 0)
+  {
+    startElection_();
+  }
+}
+
+unsigned int HealthManager::nextHeartbeatDelay()
+{
+  // scale the interval with the farm size - a 2k-agent farm must not
+  // spend the advert service's capacity on keepalives - and jitter it
+  // by +/-25% so the heartbeats of the farm don't arrive in lockstep
+  unsigned int interval =
+    baseInterval_ * (1 + farmSize_ / TF_HB_SCALE_AGENTS);
+
+  unsigned int jitter = interval / 2;
+  if(jitter > 0) interval = interval - (jitter / 2) + (rand() % jitter);
 
+  if(interval == 0) interval = 1;
+  return interval;
 }
 
@@ -24,29 +24,66 @@
 #define TF_AGENT_HEALTH_MANAGER_HPP
 
 #include <string>
+#include <vector>
 #include <saga/saga.hpp>
 
-namespace TaskFarmer 
+namespace TaskFarmer
 {
-  namespace Agent 
+  namespace Agent
   {
+    // HealthManager owns the agent's keepalive traffic. Two things keep
+    // the advert load sub-linear in the farm size:
+    //
+    //  - the heartbeat interval scales with the number of agents in the
+    //    farm (plus jitter, so agents don't align), and
+    //  - per host, one elected leader heartbeats on behalf of all
+    //    co-located agents in a single bulk, instead of every agent
+    //    pinging the database itself.
     class HealthManager {
-    
+
     private:
       saga::advert::directory * sessionBaseDir_;
       saga::advert::directory * agentBaseDir_;
-      
+
+      saga::advert::directory agentsDir_;
+
+      std::string uuid_;
+      std::string hostName_;
+
+      unsigned int baseInterval_;
+      unsigned int beatCount_;
+      unsigned int farmSize_;
+      bool isLeader_;
+
+      // the agent directories this leader heartbeats for (includes our
+      // own); empty while we run as slave
+      std::vector<saga::advert::directory> peers_;
+
       void startElection_();
       void runAsLeader_();
       void runAsSlave_();
-      
+
     public:
       HealthManager();
       HealthManager(saga::advert::directory & sessionBaseDir,
                     saga::advert::directory & agentBaseDir);
-      
+
       ~HealthManager();
-    
+
+      // announces this agent; must be called once before heartbeat()
+      void init(std::string uuid, std::string hostName,
+                unsigned int baseInterval);
+
+      // sends (or, as slave, skips) one keepalive and re-elects the
+      // per-host leader every TF_HB_ELECTION_PERIOD beats
+      void heartbeat();
+
+      // seconds until the next heartbeat: the base interval scaled to
+      // the farm size, with +/-25% jitter
+      unsigned int nextHeartbeatDelay();
+
+      bool isLeader() const { return isLeader_; }
+
     };
   }
 }
@@ -0,0 +1,156 @@
+// The MIT License
+//
+// Copyright (c) 2007 Ole Weidner (oweidner@cct.lsu.edu)
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef TF_CHUNK_CODEC_HPP
+#define TF_CHUNK_CODEC_HPP
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// compiled chunk bundles, shared between SubmitApp (encode) and the
+// agent (decode).
+//
+// The task descriptors are parsed from XML exactly once, at submit
+// time; what goes into a block advert is a compact record bundle the
+// agents consume without any parsing beyond a few substr calls.  The
+// bundle starts with the magic "TFB1;", followed by one record per
+// chunk.  A record is a sequence of length-prefixed fields
+// '<len>:<bytes>' - name, invoke string, stage-in file count, then
+// the files.  Field content can hold any byte, so chunk names and
+// invoke strings no longer have to avoid the separators of the old
+// '<uuid>|<in-files>' text records (which also silently dropped the
+// invoke string altogether).
+//
+namespace TaskFarmer
+{
+  namespace chunk_codec
+  {
+    static const char * const bundle_magic     = "TFB1;";
+    static const unsigned int bundle_magic_len = 5;
+
+    struct ChunkRecord
+    {
+      std::string              name;
+      std::string              invokeString;
+      std::vector<std::string> inFiles;
+    };
+
+    namespace detail
+    {
+      inline void appendField(std::string & blob, const std::string & field)
+      {
+        char len[24];
+        ::sprintf(len, "%lu:", (unsigned long) field.size());
+        blob += len;
+        blob += field;
+      }
+
+      inline bool parseField(const std::string      & blob,
+                             std::string::size_type & pos,
+                             std::string            & field)
+      {
+        std::string::size_type sep = blob.find(':', pos);
+        if(sep == std::string::npos) return false;
+
+        char * end = NULL;
+        unsigned long len = ::strtoul(blob.c_str() + pos, &end, 10);
+
+        if(end != blob.c_str() + sep)   return false;
+        if(sep + 1 + len > blob.size()) return false;
+
+        field.assign(blob, sep + 1, len);
+        pos = sep + 1 + len;
+        return true;
+      }
+    }
+
+    inline bool isBundle(const std::string & blob)
+    {
+      return blob.compare(0, bundle_magic_len, bundle_magic) == 0;
+    }
+
+    inline void beginBundle(std::string & blob)
+    {
+      blob = bundle_magic;
+    }
+
+    inline void appendChunk(std::string & blob, const ChunkRecord & rec)
+    {
+      detail::appendField(blob, rec.name);
+      detail::appendField(blob, rec.invokeString);
+
+      char cnt[24];
+      ::sprintf(cnt, "%lu", (unsigned long) rec.inFiles.size());
+      detail::appendField(blob, cnt);
+
+      for(unsigned int i = 0; i < rec.inFiles.size(); ++i) {
+        detail::appendField(blob, rec.inFiles[i]);
+      }
+    }
+
+    // decode a whole bundle; false (and no records) on anything
+    // malformed - a corrupt bundle must not be half-executed
+    inline bool parseBundle(const std::string        & blob,
+                            std::vector<ChunkRecord> & recs)
+    {
+      recs.clear();
+
+      if(!isBundle(blob)) return false;
+
+      std::string::size_type pos = bundle_magic_len;
+
+      while(pos < blob.size())
+      {
+        ChunkRecord rec;
+        std::string cnt;
+
+        if(!detail::parseField(blob, pos, rec.name) ||
+           !detail::parseField(blob, pos, rec.invokeString) ||
+           !detail::parseField(blob, pos, cnt))
+        {
+          recs.clear();
+          return false;
+        }
+
+        unsigned long n = ::strtoul(cnt.c_str(), NULL, 10);
+
+        // a file count beyond the blob size cannot be genuine
+        if(n > blob.size()) { recs.clear(); return false; }
+
+        for(unsigned long i = 0; i < n; ++i)
+        {
+          std::string f;
+          if(!detail::parseField(blob, pos, f)) { recs.clear(); return false; }
+          rec.inFiles.push_back(f);
+        }
+
+        recs.push_back(rec);
+      }
+
+      return true;
+    }
+  } // namespace chunk_codec
+} // namespace TaskFarmer
+
+#endif //TF_CHUNK_CODEC_HPP
@@ -45,6 +45,46 @@
 #define ATTR_CHUNK_OUT_FILES  "CHUNK_OUT_FILES"
 #define ATTR_CHUNK_INVOKE_STR "CHUNK_INVOKE_STR"
 
+#define ATTR_CHUNK_STATE      "CHUNK_STATE"
+#define CHUNK_STATE_CLAIMED   "CLAIMED"
+#define CHUNK_STATE_DONE      "DONE"
+
+// work stealing (see AgentApp::stealTasks_): the claim bookkeeping on
+// the chunk adverts doubles as the farm's in-progress table.  An idle
+// agent re-claims the longest-running chunks; every (re)claim bumps
+// the epoch, the first finisher wins, and the winning epoch is noted
+// so duplicate results can be told apart
+#define ATTR_CHUNK_CLAIM_TIME "CHUNK_CLAIM_TIME"
+#define ATTR_CHUNK_EPOCH      "CHUNK_EPOCH"
+#define ATTR_CHUNK_DONE_EPOCH "CHUNK_DONE_EPOCH"
+
+// a claim younger than this (seconds) is not worth duplicating, and at
+// most this many chunks are stolen per idle pass
+#define TF_AGENT_STEAL_MIN_AGE     30
+#define TF_AGENT_STEAL_MAX          2
+
+// a submission block: one advert entry carrying many serialized chunks
+// (a compiled bundle, see chunk_codec.hpp), claimed and completed as a
+// unit by one agent
+#define ATTR_BLOCK_CHUNKS     "BLOCK_CHUNKS"
+#define TF_SUBMIT_BLOCK_SIZE  64
+
+// number of shard subdirectories the chunk directory is spread over
+// (see common/sharded_dir.hpp).  Only the submitter uses this constant;
+// agents read the actual count from the directory itself
+#define TF_CHUNK_SHARDS       8
+
+// number of chunks an agent claims ahead of time into its local queue,
+// and number of finished chunks reported back in one bulk
+#define TF_AGENT_PREFETCH_DEPTH    8
+#define TF_AGENT_COMPLETION_BATCH  8
+
+// heartbeat scaling: the keepalive interval grows by the base interval
+// for every TF_HB_SCALE_AGENTS agents in the farm, and the per-host
+// leader election is repeated every TF_HB_ELECTION_PERIOD heartbeats
+#define TF_HB_SCALE_AGENTS         64
+#define TF_HB_ELECTION_PERIOD      10
+
 #define ADVERT_DIR_AGENTS     "AGENTS"
 #define ADVERT_DIR_BINARIES   "BINARIES"
 #define ADVERT_DIR_CHUNKS     "CHUNKS"
@@ -1,4 +1,319 @@
+//  Copyright (c) 2005-2008 Andre Merzky (andre@merzky.net)
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
-// dummy source for the build system - I will fix that soon!
-// Andre.
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
 
+#include <time.h>
+#include <sys/time.h>
+
+#include <saga/saga.hpp>
+
+#include <boost/cstdint.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+#include "defines.hpp"
+#include "LogWriter.hpp"
+
+///////////////////////////////////////////////////////////////////////
+//
+// perf_matrix: measures the endpoint-to-endpoint transfer matrix over
+// a set of storage endpoints.
+//
+//   perf_matrix <endpoints_file> <matrix_out> [payload_mb]
+//
+// <endpoints_file> holds one directory url per line.  A probe file of
+// payload_mb (default 16) is seeded onto every endpoint, and then all
+// ordered endpoint pairs are probed with a timed third-party copy.
+//
+// the probes run concurrently in waves: each wave is one round of a
+// round-robin tournament schedule over the endpoints, so every
+// endpoint takes part in at most one pair per wave and probes never
+// share an endpoint's link - that is the interference avoidance which
+// lets the whole matrix finish in n-1 waves instead of n*(n-1)
+// serial probes.
+//
+// the result goes to <matrix_out> as a binary matrix so the scheduler
+// can mmap it:
+//
+//   char[4] "PMTX" | uint32 version (1) | uint32 n | uint64 start time
+//   n*n records, row-major (row = source):
+//     uint64 probe time (epoch seconds) | double seconds | double MB/s
+//
+// the diagonal is zero.  A text rendering is printed as well.
+//
+
+namespace
+{
+  struct probe_result
+  {
+    boost::uint64_t timestamp;
+    double          seconds;
+    double          mbps;
+
+    probe_result (void)
+      : timestamp (0), seconds (0.0), mbps (0.0)
+    {
+    }
+  };
+
+
+  double now (void)
+  {
+    struct timeval tv;
+    gettimeofday (&tv, 0);
+    return (double) tv.tv_sec + (double) tv.tv_usec * 1e-6;
+  }
+
+
+  std::string probe_url (std::string const & endpoint, int i)
+  {
+    return endpoint + "/perf_probe_"
+         + boost::lexical_cast <std::string> (i) + ".dat";
+  }
+
+
+  // one timed copy: the probe file of endpoint src, copied to
+  // endpoint dst.  Run in its own thread, one per pair and direction
+  // within a wave
+  void probe_pair (std::vector <std::string> const * endpoints,
+                   int src, int dst, size_t payload,
+                   std::vector <std::vector <probe_result> > * matrix)
+  {
+    probe_result & res = (*matrix)[src][dst];
+
+    res.timestamp = (boost::uint64_t) ::time (NULL);
+
+    try
+    {
+      saga::filesystem::file f (saga::url (probe_url ((*endpoints)[src],
+                                                      src)));
+
+      double start = now ();
+
+      f.copy (saga::url (probe_url ((*endpoints)[dst], src)),
+              saga::filesystem::Overwrite);
+
+      res.seconds = now () - start;
+      res.mbps    = (res.seconds > 0.0)
+                  ? (double) payload / (1024.0 * 1024.0) / res.seconds
+                  : 0.0;
+    }
+    catch ( saga::exception const & )
+    {
+      // leave the cell zero - an unreachable pair is a result, too
+      res.seconds = 0.0;
+      res.mbps    = 0.0;
+    }
+  }
+}
+
+
+int main (int argc, char * argv[])
+{
+  if ( argc < 3 )
+  {
+    std::cerr << "usage: " << argv[0]
+              << " <endpoints_file> <matrix_out> [payload_mb]" << std::endl;
+    return -1;
+  }
+
+  size_t payload = ((argc > 3) ? ::atol (argv[3]) : 16) * 1024 * 1024;
+
+  TaskFarmer::LogWriter log (std::string ("perf_matrix"), std::cout);
+
+  // read the endpoint list
+  std::vector <std::string> endpoints;
+  {
+    std::ifstream in (argv[1]);
+    std::string line;
+
+    while ( std::getline (in, line) )
+    {
+      if ( ! line.empty () )
+      {
+        endpoints.push_back (line);
+      }
+    }
+  }
+
+  int n = (int) endpoints.size ();
+
+  if ( n < 2 )
+  {
+    log.write ("Need at least two endpoints. ABORTING", LOGLEVEL_FATAL);
+    return -1;
+  }
+
+  boost::uint64_t start_time = (boost::uint64_t) ::time (NULL);
+
+  std::vector <std::vector <probe_result> >
+    matrix (n, std::vector <probe_result> (n));
+
+  try
+  {
+    ///////////////////////////////////////////////////////////////////
+    // seed every endpoint with its probe file
+    log.write ("Seeding probe files ("
+               + boost::lexical_cast <std::string> (payload)
+               + " bytes each)...", LOGLEVEL_INFO);
+
+    std::string local ("/tmp/perf_matrix_payload.dat");
+    {
+      FILE * f = ::fopen (local.c_str (), "wb");
+      std::vector <char> block (1024 * 1024, 'x');
+      for ( size_t i = 0; i < payload; i += block.size () )
+      {
+        ::fwrite (&block[0], 1, block.size (), f);
+      }
+      ::fclose (f);
+    }
+
+    for ( int i = 0; i < n; i++ )
+    {
+      saga::filesystem::file f (saga::url ("file://localhost" + local));
+      f.copy (saga::url (probe_url (endpoints[i], i)),
+              saga::filesystem::Overwrite
+              | saga::filesystem::CreateParents);
+    }
+
+    ///////////////////////////////////////////////////////////////////
+    // the probe waves: round-robin tournament over the endpoints.
+    // Endpoint 0 stays put, the others rotate; n odd gets a bye (-1)
+    std::vector <int> ring;
+    for ( int i = 0; i < n; i++ )
+    {
+      ring.push_back (i);
+    }
+    if ( n % 2 )
+    {
+      ring.push_back (-1);
+    }
+
+    int slots = (int) ring.size ();
+
+    for ( int wave = 0; wave < slots - 1; wave++ )
+    {
+      log.write ("Probe wave "
+                 + boost::lexical_cast <std::string> (wave + 1) + "/"
+                 + boost::lexical_cast <std::string> (slots - 1) + "...",
+                 LOGLEVEL_INFO);
+
+      std::vector <boost::thread *> threads;
+
+      for ( int k = 0; k < slots / 2; k++ )
+      {
+        int a = ring[k];
+        int b = ring[slots - 1 - k];
+
+        if ( a < 0 || b < 0 )
+        {
+          continue;    // the bye
+        }
+
+        // both directions stay within this pair, so the wave still
+        // touches every endpoint at most once
+        threads.push_back (new boost::thread (
+          boost::bind (&probe_pair, &endpoints, a, b, payload, &matrix)));
+        threads.push_back (new boost::thread (
+          boost::bind (&probe_pair, &endpoints, b, a, payload, &matrix)));
+      }
+
+      for ( size_t t = 0; t < threads.size (); t++ )
+      {
+        threads[t]->join ();
+        delete threads[t];
+      }
+
+      // rotate all but the first slot
+      ring.insert (ring.begin () + 1, ring.back ());
+      ring.pop_back ();
+    }
+
+    ///////////////////////////////////////////////////////////////////
+    // clean up the probe files (ours, and the copies the probes left)
+    for ( int i = 0; i < n; i++ )
+    {
+      for ( int j = 0; j < n; j++ )
+      {
+        try
+        {
+          saga::filesystem::file f (saga::url (probe_url (endpoints[i], j)));
+          f.remove ();
+        }
+        catch ( saga::exception const & )
+        {
+          // never seeded or never copied - fine
+        }
+      }
+    }
+
+    ::remove (local.c_str ());
+  }
+  catch ( saga::exception const & e )
+  {
+    log.write (std::string ("Probe run failed: ") + e.what (),
+               LOGLEVEL_FATAL);
+    return -1;
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // write the binary matrix
+  {
+    FILE * out = ::fopen (argv[2], "wb");
+
+    if ( NULL == out )
+    {
+      log.write ("Cannot create matrix file. ABORTING", LOGLEVEL_FATAL);
+      return -1;
+    }
+
+    boost::uint32_t version = 1;
+    boost::uint32_t dim     = n;
+
+    ::fwrite ("PMTX", 1, 4, out);
+    ::fwrite (&version, sizeof (version), 1, out);
+    ::fwrite (&dim, sizeof (dim), 1, out);
+    ::fwrite (&start_time, sizeof (start_time), 1, out);
+
+    for ( int i = 0; i < n; i++ )
+    {
+      for ( int j = 0; j < n; j++ )
+      {
+        probe_result const & r = matrix[i][j];
+
+        ::fwrite (&r.timestamp, sizeof (r.timestamp), 1, out);
+        ::fwrite (&r.seconds, sizeof (r.seconds), 1, out);
+        ::fwrite (&r.mbps, sizeof (r.mbps), 1, out);
+      }
+    }
+
+    ::fclose (out);
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // and a text rendering for the log
+  std::cout << std::endl << "bandwidth matrix [MB/s], rows = source:"
+            << std::endl;
+
+  for ( int i = 0; i < n; i++ )
+  {
+    for ( int j = 0; j < n; j++ )
+    {
+      std::cout << std::fixed << std::setprecision (1) << std::setw (9)
+                << matrix[i][j].mbps;
+    }
+    std::cout << "    " << endpoints[i] << std::endl;
+  }
+
+  return 0;
+}
@@ -24,6 +24,10 @@
 #include "defines.hpp"
 #include "SubmitApp.hpp"
 
+#include "../chunk_codec.hpp"
+
+#include <boost/lexical_cast.hpp>
+
 using namespace saga;
 using namespace TaskFarmer::Frontend;
 
@@ -122,7 +126,9 @@ void SubmitApp::createNewSession_()
 	
     agentsDir_   = sessionBaseDir_.open_dir(ADVERT_DIR_AGENTS, mode);
     binariesDir_ = sessionBaseDir_.open_dir(ADVERT_DIR_BINARIES, mode);
-    chunksDir_   = sessionBaseDir_.open_dir(ADVERT_DIR_CHUNKS, mode);
+    chunksDir_   = sharded_dir::directory(
+                     sessionBaseDir_.open_dir(ADVERT_DIR_CHUNKS, mode),
+                     mode, TF_CHUNK_SHARDS);
   }
   catch(saga::exception const & e) {
     message += "FAILED ("; message += e.what(); message += ")";
@@ -168,41 +174,84 @@ void SubmitApp::populateBinariesList_(void)
 //
 void SubmitApp::populateChunkList_(void)
 {
+  // chunks are submitted in blocks: TF_SUBMIT_BLOCK_SIZE chunks are
+  // compiled into a single advert entry as a chunk bundle (see
+  // chunk_codec.hpp), and the payload writes are asynchronous with one
+  // wait at the very end. Seeding a large farm costs one advert entry
+  // per block instead of one per chunk, the XML is parsed exactly once
+  // right here, and agents decode the records without any parsing
   unsigned int successCounter = 0;
+  unsigned int blockCounter = 0;
+
   vector<ChunkDescription> chunkList = cfgFileParser_.getChunkList();
   vector<ChunkDescription>::const_iterator chunkListIT = chunkList.begin();
+
+  saga::task_container tc;
+  std::string blockPayload("");
+  unsigned int blockFill = 0;
+
   while(chunkListIT != chunkList.end())
   {
     // create a UUID for this chunk
     string chunkUUID = uuid().string();
-    string message("Adding new chunk with UUID "+ chunkUUID + " to session...");
+
+    // compile the chunk into the current block bundle
+    if(blockFill == 0) TaskFarmer::chunk_codec::beginBundle(blockPayload);
+
+    TaskFarmer::chunk_codec::ChunkRecord rec;
+    rec.name         = chunkUUID;
+    rec.invokeString = (*chunkListIT).invokeString;
+    rec.inFiles      = (*chunkListIT).stageInFiles;
+
+    TaskFarmer::chunk_codec::appendChunk(blockPayload, rec);
+    ++blockFill;
+    ++successCounter;
+    ++chunkListIT;
+
+    if(blockFill < TF_SUBMIT_BLOCK_SIZE && chunkListIT != chunkList.end()) {
+      continue;
+    }
+
+    // block full (or list exhausted) - post it. Only the entry
+    // creation is synchronous; the payload write overlaps with the
+    // next block and with agents already consuming
+    string blockUUID = uuid().string();
+    string message("Adding chunk block "+ blockUUID + " ("
+                   + boost::lexical_cast<std::string>(blockFill)
+                   + " chunks) to session...");
     try {
       int mode = advert::ReadWrite | advert::Create;
-      advert::entry adv = chunksDir_.open(chunkUUID, mode);
-  
-      // iterate over stage-in files
-      std::string inFileList("");
-      vector<string>::const_iterator inFilesIT = (*chunkListIT).stageInFiles.begin();
-      while(inFilesIT != (*chunkListIT).stageInFiles.end()) 
-      {
-        inFileList += (*inFilesIT) + ";";
-        ++inFilesIT;
-      }
-
-      adv.set_attribute(ATTR_CHUNK_IN_FILES, inFileList);
+      advert::entry adv = chunksDir_.open(blockUUID, mode);
+
+      tc.add_task(adv.set_attribute<saga::task_base::Async>(
+        ATTR_BLOCK_CHUNKS, blockPayload));
+
       message += "SUCCESS"; log->write(message, LOGLEVEL_INFO);
-      ++successCounter;
+      ++blockCounter;
     }
     catch(saga::exception const & e) {
       message += "FAILED ("; message += e.what(); message += ")";
       log->write(message, LOGLEVEL_ERROR);
-    }    
-    ++chunkListIT;
+      successCounter -= blockFill;
+    }
+
+    blockPayload = "";
+    blockFill = 0;
   }
+
+  // drain the submission pipeline
+  tc.wait();
+
   if(successCounter == 0) {
     log->write("No chunks defined for this session. ABORTING", LOGLEVEL_FATAL);
     APPLICATION_ABORT;
   }
+
+  log->write("Submitted "
+             + boost::lexical_cast<std::string>(successCounter)
+             + " chunks in "
+             + boost::lexical_cast<std::string>(blockCounter)
+             + " blocks", LOGLEVEL_INFO);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
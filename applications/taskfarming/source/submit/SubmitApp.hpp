@@ -24,6 +24,9 @@
 #define TF_FRONTEND_SUBMITAPP_HPP
 
 #include <saga/saga.hpp>
+
+#include "../../../common/sharded_dir.hpp"
+
 #include "ConfigFileParser.hpp"
 #include "LogWriter.hpp"
 
@@ -43,7 +46,9 @@ namespace TaskFarmer
         saga::advert::directory sessionBaseDir_;
         saga::advert::directory agentsDir_;
         saga::advert::directory binariesDir_;
-        saga::advert::directory chunksDir_;
+
+        // the farm's work directory, sharded so agent scans stay cheap
+        sharded_dir::directory  chunksDir_;
         
         TaskFarmer::LogWriter * log;
         ConfigFileParser cfgFileParser_;